@@ -0,0 +1,97 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+#include "SkBenchmark.h"
+#include "SkBitmap.h"
+#include "SkBitmapScaler.h"
+#include "SkCanvas.h"
+#include "SkPaint.h"
+#include "SkRandom.h"
+#include "SkScaledImageCache.h"
+#include "SkString.h"
+
+static void make_bitmap(SkBitmap* bitmap, int size) {
+    bitmap->setConfig(SkBitmap::kARGB_8888_Config, size, size);
+    bitmap->allocPixels();
+    bitmap->eraseColor(SK_ColorWHITE);
+    bitmap->setIsOpaque(true);
+
+    SkCanvas canvas(*bitmap);
+    SkRandom rand;
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    for (int i = 0; i < 50; ++i) {
+        paint.setColor(rand.nextU() | 0xFF000000);
+        canvas.drawCircle(rand.nextUScalar1() * size, rand.nextUScalar1() * size,
+                          rand.nextUScalar1() * size / 8, paint);
+    }
+}
+
+// Resamples a 512x512 bitmap to 100x100 without the cache.
+class BitmapScalerBench : public SkBenchmark {
+    enum { N = SkBENCHLOOP(10) };
+    SkBitmap                        fBitmap;
+    SkBitmapScaler::ResizeMethod    fMethod;
+    SkString                        fName;
+
+public:
+    BitmapScalerBench(void* param, SkBitmapScaler::ResizeMethod method, const char name[])
+        : INHERITED(param), fMethod(method) {
+        make_bitmap(&fBitmap, 512);
+        fName.printf("bitmap_scaler_%s", name);
+        fIsRendering = false;
+    }
+
+protected:
+    virtual const char* onGetName() SK_OVERRIDE {
+        return fName.c_str();
+    }
+
+    virtual void onDraw(SkCanvas*) SK_OVERRIDE {
+        SkBitmap scaled;
+        for (int i = 0; i < N; ++i) {
+            SkBitmapScaler::Resize(&scaled, fBitmap, fMethod, 100, 100);
+        }
+    }
+
+private:
+    typedef SkBenchmark INHERITED;
+};
+
+// Draws the same bitmap minified with high quality filtering, which resamples
+// once and then draws from the cache.
+class BitmapScalerDrawBench : public SkBenchmark {
+    enum { N = SkBENCHLOOP(100) };
+    SkBitmap    fBitmap;
+
+public:
+    BitmapScalerDrawBench(void* param) : INHERITED(param) {
+        make_bitmap(&fBitmap, 512);
+    }
+
+protected:
+    virtual const char* onGetName() SK_OVERRIDE {
+        return "bitmap_scaler_draw_cached";
+    }
+
+    virtual void onDraw(SkCanvas* canvas) SK_OVERRIDE {
+        SkPaint paint;
+        this->setupPaint(&paint);
+        paint.setHighQualityFilterBitmap(true);
+        SkRect dst = SkRect::MakeWH(100, 100);
+        for (int i = 0; i < N; ++i) {
+            canvas->drawBitmapRectToRect(fBitmap, NULL, dst, &paint);
+        }
+    }
+
+private:
+    typedef SkBenchmark INHERITED;
+};
+
+DEF_BENCH(return new BitmapScalerBench(p, SkBitmapScaler::kBox_ResizeMethod, "box"))
+DEF_BENCH(return new BitmapScalerBench(p, SkBitmapScaler::kMitchell_ResizeMethod, "mitchell"))
+DEF_BENCH(return new BitmapScalerBench(p, SkBitmapScaler::kLanczos3_ResizeMethod, "lanczos3"))
+DEF_BENCH(return new BitmapScalerDrawBench(p))
@@ -107,9 +107,54 @@ private:
     SimpleNotificationClient fNotificationClient;
 };
 
+// Test that records draw operations that take a while to rasterize, and plays
+// them back on the recording thread or on a thread of their own.
+// This benchmark aims to capture how much of the playback threaded playback
+// overlaps with recording.
+class DeferredPlaybackBench : public DeferredCanvasBench {
+public:
+    DeferredPlaybackBench(void* param, bool threaded)
+        : INHERITED(param, threaded ? "playback_threaded" : "playback")
+        , fThreaded(threaded) {
+    }
+
+    enum {
+        M = SkBENCHLOOP(100),   // number of individual draws in each loop
+    };
+protected:
+
+    virtual void initDeferredCanvas(SkDeferredCanvas& canvas) SK_OVERRIDE {
+        canvas.setThreadedPlayback(fThreaded);
+    }
+
+    virtual void drawInDeferredCanvas(SkDeferredCanvas& canvas) SK_OVERRIDE {
+        SkPaint paint;
+        paint.setAntiAlias(true);
+        for (int i = 0; i < M; i++) {
+            SkRect rect;
+            rect.setXYWH(SkIntToScalar(i * 27 % CANVAS_WIDTH), SkIntToScalar(i * 13 % CANVAS_HEIGHT),
+                         SkIntToScalar(100), SkIntToScalar(100));
+            paint.setColor(0x80000000 | (i * 0x010305));
+            SkPath path;
+            path.addOval(rect);
+            canvas.drawPath(path, paint);
+        }
+    }
+
+    virtual void finalizeDeferredCanvas(SkDeferredCanvas& canvas) SK_OVERRIDE {
+    }
+
+private:
+    typedef DeferredCanvasBench INHERITED;
+    bool fThreaded;
+};
 
 ///////////////////////////////////////////////////////////////////////////////
 
 static SkBenchmark* Fact0(void* p) { return new DeferredRecordBench(p); }
+static SkBenchmark* Fact1(void* p) { return new DeferredPlaybackBench(p, false); }
+static SkBenchmark* Fact2(void* p) { return new DeferredPlaybackBench(p, true); }
 
 static BenchRegistry gReg0(Fact0);
+static BenchRegistry gReg1(Fact1);
+static BenchRegistry gReg2(Fact2);
@@ -223,11 +223,16 @@ private:
 class Gradient2Bench : public SkBenchmark {
     SkString fName;
     bool     fHasAlpha;
+    bool     fSameColors;
 
 public:
-    Gradient2Bench(void* param, bool hasAlpha) : INHERITED(param) {
-        fName.printf("gradient_create_%s", hasAlpha ? "alpha" : "opaque");
+    // With sameColors, every shader created has the same colors, as when a
+    // client recreates its shaders for each frame.
+    Gradient2Bench(void* param, bool hasAlpha, bool sameColors = false) : INHERITED(param) {
+        fName.printf("gradient_create_%s%s", hasAlpha ? "alpha" : "opaque",
+                     sameColors ? "_same" : "");
         fHasAlpha = hasAlpha;
+        fSameColors = sameColors;
     }
 
 protected:
@@ -246,7 +251,7 @@ protected:
         };
 
         for (int i = 0; i < SkBENCHLOOP(1000); i++) {
-            const int gray = i % 256;
+            const int gray = fSameColors ? 0x80 : i % 256;
             const int alpha = fHasAlpha ? gray : 0xFF;
             SkColor colors[] = {
                 SK_ColorBLACK,
@@ -266,6 +271,7 @@ private:
 
 DEF_BENCH( return new GradientBench(p, kLinear_GradType); )
 DEF_BENCH( return new GradientBench(p, kLinear_GradType, SkShader::kMirror_TileMode); )
+DEF_BENCH( return new GradientBench(p, kLinear_GradType, SkShader::kRepeat_TileMode); )
 
 // Draw a radial gradient of radius 1/2 on a rectangle; half the lines should
 // be completely pinned, the other half should pe partially pinned
@@ -276,10 +282,15 @@ DEF_BENCH( return new GradientBench(p, kRadial_GradType, SkShader::kClamp_TileMo
 DEF_BENCH( return new GradientBench(p, kRadial_GradType, SkShader::kClamp_TileMode, kOval_GeomType); )
 
 DEF_BENCH( return new GradientBench(p, kRadial_GradType, SkShader::kMirror_TileMode); )
+DEF_BENCH( return new GradientBench(p, kRadial_GradType, SkShader::kRepeat_TileMode); )
 DEF_BENCH( return new GradientBench(p, kSweep_GradType); )
 DEF_BENCH( return new GradientBench(p, kRadial2_GradType); )
 DEF_BENCH( return new GradientBench(p, kRadial2_GradType, SkShader::kMirror_TileMode); )
 DEF_BENCH( return new GradientBench(p, kConical_GradType); )
+DEF_BENCH( return new GradientBench(p, kConical_GradType, SkShader::kMirror_TileMode); )
+DEF_BENCH( return new GradientBench(p, kConical_GradType, SkShader::kRepeat_TileMode); )
 
 DEF_BENCH( return new Gradient2Bench(p, false); )
 DEF_BENCH( return new Gradient2Bench(p, true); )
+DEF_BENCH( return new Gradient2Bench(p, false, true); )
+DEF_BENCH( return new Gradient2Bench(p, true, true); )
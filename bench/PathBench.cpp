@@ -17,14 +17,19 @@
 
 
 enum Flags {
-    kStroke_Flag = 1 << 0,
-    kBig_Flag    = 1 << 1
+    kStroke_Flag   = 1 << 0,
+    kBig_Flag      = 1 << 1,
+    kAnalytic_Flag = 1 << 2     // fill with SkPaint::kAnalyticAA_Flag
 };
 
 #define FLAGS00  Flags(0)
 #define FLAGS01  Flags(kStroke_Flag)
 #define FLAGS10  Flags(kBig_Flag)
 #define FLAGS11  Flags(kStroke_Flag | kBig_Flag)
+#define FLAGSA0  Flags(kAnalytic_Flag)
+#define FLAGSA1  Flags(kAnalytic_Flag | kStroke_Flag)
+#define FLAGSA2  Flags(kAnalytic_Flag | kBig_Flag)
+#define FLAGSA3  Flags(kAnalytic_Flag | kStroke_Flag | kBig_Flag)
 
 class PathBench : public SkBenchmark {
     SkPaint     fPaint;
@@ -49,12 +54,16 @@ protected:
                      fFlags & kStroke_Flag ? "stroke" : "fill",
                      fFlags & kBig_Flag ? "big" : "small");
         this->appendName(&fName);
+        if (fFlags & kAnalytic_Flag) {
+            fName.append("_analytic");
+        }
         return fName.c_str();
     }
 
     virtual void onDraw(SkCanvas* canvas) SK_OVERRIDE {
         SkPaint paint(fPaint);
         this->setupPaint(&paint);
+        paint.setAnalyticAA(SkToBool(fFlags & kAnalytic_Flag));
 
         SkPath path;
         this->makePath(&path);
@@ -898,6 +907,20 @@ DEF_BENCH( return new LongCurvedPathBench(p, FLAGS01); )
 DEF_BENCH( return new LongLinePathBench(p, FLAGS00); )
 DEF_BENCH( return new LongLinePathBench(p, FLAGS01); )
 
+// The same fills, antialiased by area coverage rather than supersampling.
+DEF_BENCH( return new TrianglePathBench(p, FLAGSA0); )
+DEF_BENCH( return new TrianglePathBench(p, FLAGSA2); )
+DEF_BENCH( return new OvalPathBench(p, FLAGSA0); )
+DEF_BENCH( return new OvalPathBench(p, FLAGSA2); )
+DEF_BENCH( return new CirclePathBench(p, FLAGSA0); )
+DEF_BENCH( return new CirclePathBench(p, FLAGSA1); )
+DEF_BENCH( return new CirclePathBench(p, FLAGSA2); )
+DEF_BENCH( return new CirclePathBench(p, FLAGSA3); )
+DEF_BENCH( return new SawToothPathBench(p, FLAGSA0); )
+DEF_BENCH( return new LongCurvedPathBench(p, FLAGSA0); )
+DEF_BENCH( return new LongCurvedPathBench(p, FLAGSA1); )
+DEF_BENCH( return new LongLinePathBench(p, FLAGSA0); )
+
 DEF_BENCH( return new PathCreateBench(p); )
 DEF_BENCH( return new PathCopyBench(p); )
 DEF_BENCH( return new PathTransformBench(true, p); )
@@ -182,12 +182,53 @@ private:
     typedef PictureRecordBench INHERITED;
 };
 
+/*
+ *  Populates the SkPaint and SkMatrix dictionaries with a large number of
+ *  unique objects, each of which is used a few times, as on a page with many
+ *  differently styled elements.
+ */
+class UniquePaintMatrixDictionaryRecordBench : public PictureRecordBench {
+public:
+    UniquePaintMatrixDictionaryRecordBench(void* param)
+        : INHERITED(param, "unique_paint_matrix_dictionary") { }
+
+    enum {
+        ObjCount = SkBENCHLOOP(30000),  // number of unique paint and matrix objects
+        Repeats = 3,                    // number of times each object is used
+    };
+protected:
+    virtual float innerLoopScale() const SK_OVERRIDE { return 0.04f; }
+    virtual void recordCanvas(SkCanvas* canvas) {
+        SkRandom rand;
+        SkRect rect = SkRect::MakeWH(SkIntToScalar(10), SkIntToScalar(10));
+        for (int i = 0; i < ObjCount; i++) {
+            SkPaint paint;
+            paint.setColor(rand.nextU());
+            paint.setStrokeWidth(SkIntToScalar(i % 5));
+            SkMatrix matrix;
+            matrix.setTranslate(SkIntToScalar(i % PICTURE_WIDTH),
+                                SkIntToScalar(i / PICTURE_WIDTH));
+            for (int j = 0; j < Repeats; j++) {
+                canvas->save();
+                canvas->setMatrix(matrix);
+                canvas->drawRect(rect, paint);
+                canvas->restore();
+            }
+        }
+    }
+
+private:
+    typedef PictureRecordBench INHERITED;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 
 static SkBenchmark* Fact0(void* p) { return new DictionaryRecordBench(p); }
 static SkBenchmark* Fact1(void* p) { return new UniquePaintDictionaryRecordBench(p); }
 static SkBenchmark* Fact2(void* p) { return new RecurringPaintDictionaryRecordBench(p); }
+static SkBenchmark* Fact3(void* p) { return new UniquePaintMatrixDictionaryRecordBench(p); }
 
 static BenchRegistry gReg0(Fact0);
 static BenchRegistry gReg1(Fact1);
 static BenchRegistry gReg2(Fact2);
+static BenchRegistry gReg3(Fact3);
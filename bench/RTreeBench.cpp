@@ -17,6 +17,8 @@ static const int GENERATE_EXTENTS = 1000;
 static const int NUM_BUILD_RECTS = 500;
 static const int NUM_QUERY_RECTS = 5000;
 static const int NUM_QUERIES = 1000;
+// the size of the trees culling the commands of a large SKP
+static const int NUM_LARGE_RECTS = 100000;
 
 typedef SkIRect (*MakeRectProc)(SkRandom&, int, int);
 
@@ -24,11 +26,12 @@ typedef SkIRect (*MakeRectProc)(SkRandom&, int, int);
 class BBoxBuildBench : public SkBenchmark {
 public:
     BBoxBuildBench(void* param, const char* name, MakeRectProc proc, bool bulkLoad,
-                    SkBBoxHierarchy* tree)
+                    SkBBoxHierarchy* tree, int numRects = NUM_BUILD_RECTS)
         : INHERITED(param)
         , fTree(tree)
         , fProc(proc)
-        , fBulkLoad(bulkLoad) {
+        , fBulkLoad(bulkLoad)
+        , fNumRects(numRects) {
         fName.append("rtree_");
         fName.append(name);
         fName.append("_build");
@@ -46,9 +49,11 @@ protected:
     }
     virtual void onDraw(SkCanvas* canvas) {
         SkRandom rand;
-        for (int i = 0; i < SkBENCHLOOP(100); ++i) {
-            for (int j = 0; j < NUM_BUILD_RECTS; ++j) {
-                fTree->insert(reinterpret_cast<void*>(j), fProc(rand, j, NUM_BUILD_RECTS),
+        // build about as many rects in all, however many each tree has
+        int loops = SkMax32(1, 100 * NUM_BUILD_RECTS / fNumRects);
+        for (int i = 0; i < SkBENCHLOOP(loops); ++i) {
+            for (int j = 0; j < fNumRects; ++j) {
+                fTree->insert(reinterpret_cast<void*>(j), fProc(rand, j, fNumRects),
                               fBulkLoad);
             }
             fTree->flushDeferredInserts();
@@ -60,6 +65,7 @@ private:
     MakeRectProc fProc;
     SkString fName;
     bool fBulkLoad;
+    int fNumRects;
     typedef SkBenchmark INHERITED;
 };
 
@@ -74,24 +80,19 @@ public:
     };
 
     BBoxQueryBench(void* param, const char* name, MakeRectProc proc, bool bulkLoad,
-                    QueryType q, SkBBoxHierarchy* tree)
+                    QueryType q, SkBBoxHierarchy* tree, int numRects = NUM_QUERY_RECTS)
         : INHERITED(param)
         , fTree(tree)
         , fProc(proc)
         , fBulkLoad(bulkLoad)
-        , fQuery(q) {
+        , fQuery(q)
+        , fNumRects(numRects) {
         fName.append("rtree_");
         fName.append(name);
         fName.append("_query");
         if (fBulkLoad) {
             fName.append("_bulk");
         }
-        SkRandom rand;
-        for (int j = 0; j < SkBENCHLOOP(NUM_QUERY_RECTS); ++j) {
-            fTree->insert(reinterpret_cast<void*>(j), fProc(rand, j,
-                           SkBENCHLOOP(NUM_QUERY_RECTS)), fBulkLoad);
-        }
-        fTree->flushDeferredInserts();
         fIsRendering = false;
     }
     virtual ~BBoxQueryBench() {
@@ -101,6 +102,18 @@ protected:
     virtual const char* onGetName() {
         return fName.c_str();
     }
+    // Large trees take a while to build, so only build the tree of a bench that is run.
+    virtual void onPreDraw() {
+        if (0 != fTree->getCount()) {
+            return;
+        }
+        SkRandom rand;
+        for (int j = 0; j < SkBENCHLOOP(fNumRects); ++j) {
+            fTree->insert(reinterpret_cast<void*>(j), fProc(rand, j,
+                           SkBENCHLOOP(fNumRects)), fBulkLoad);
+        }
+        fTree->flushDeferredInserts();
+    }
     virtual void onDraw(SkCanvas* canvas) {
         SkRandom rand;
         for (int i = 0; i < SkBENCHLOOP(NUM_QUERIES); ++i) {
@@ -142,6 +155,7 @@ private:
     SkString fName;
     bool fBulkLoad;
     QueryType fQuery;
+    int fNumRects;
     typedef SkBenchmark INHERITED;
 };
 
@@ -210,8 +224,37 @@ static inline SkBenchmark* Fact4(void* p) {
                       BBoxQueryBench::kRandom_QueryType, SkRTree::Create(5, 16)));
 }
 
+static inline SkBenchmark* Fact5(void* p) {
+    return SkNEW_ARGS(BBoxBuildBench, (p, "point100k", &make_point_rects, true,
+                      SkRTree::Create(5, 16), NUM_LARGE_RECTS));
+}
+static inline SkBenchmark* Fact6(void* p) {
+    return SkNEW_ARGS(BBoxBuildBench, (p, "random100k", &make_random_rects, true,
+                      SkRTree::Create(5, 16), NUM_LARGE_RECTS));
+}
+static inline SkBenchmark* Fact7(void* p) {
+    return SkNEW_ARGS(BBoxQueryBench, (p, "point100k_small", &make_point_rects, true,
+                      BBoxQueryBench::kSmall_QueryType, SkRTree::Create(5, 16),
+                      NUM_LARGE_RECTS));
+}
+static inline SkBenchmark* Fact8(void* p) {
+    return SkNEW_ARGS(BBoxQueryBench, (p, "point100k_random", &make_point_rects, true,
+                      BBoxQueryBench::kRandom_QueryType, SkRTree::Create(5, 16),
+                      NUM_LARGE_RECTS));
+}
+static inline SkBenchmark* Fact9(void* p) {
+    return SkNEW_ARGS(BBoxQueryBench, (p, "random100k_small", &make_random_rects, true,
+                      BBoxQueryBench::kSmall_QueryType, SkRTree::Create(5, 16),
+                      NUM_LARGE_RECTS));
+}
+
 static BenchRegistry gReg0(Fact0);
 static BenchRegistry gReg1(Fact1);
 static BenchRegistry gReg2(Fact2);
 static BenchRegistry gReg3(Fact3);
 static BenchRegistry gReg4(Fact4);
+static BenchRegistry gReg5(Fact5);
+static BenchRegistry gReg6(Fact6);
+static BenchRegistry gReg7(Fact7);
+static BenchRegistry gReg8(Fact8);
+static BenchRegistry gReg9(Fact9);
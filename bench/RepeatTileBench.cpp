@@ -17,6 +17,10 @@ static const char* gConfigName[] = {
     "ERROR", "a1", "a8", "index8", "565", "4444", "8888"
 };
 
+static const char* gModeName[] = {
+    "clamp", "repeat", "mirror"
+};
+
 static void drawIntoBitmap(const SkBitmap& bm) {
     const int w = bm.width();
     const int h = bm.height();
@@ -86,9 +90,13 @@ static void convertToIndex666(const SkBitmap& src, SkBitmap* dst) {
 class RepeatTileBench : public SkBenchmark {
     SkPaint     fPaint;
     SkString    fName;
+    bool        fFilter;
     enum { N = SkBENCHLOOP(20) };
 public:
-    RepeatTileBench(void* param, SkBitmap::Config c, bool isOpaque = false) : INHERITED(param) {
+    RepeatTileBench(void* param, SkBitmap::Config c, bool isOpaque = false,
+                    SkShader::TileMode mode = SkShader::kRepeat_TileMode,
+                    bool filter = false, bool persp = false)
+        : INHERITED(param), fFilter(filter) {
         const int w = 50;
         const int h = 50;
         SkBitmap bm;
@@ -110,11 +118,23 @@ public:
             bm = tmp;
         }
 
-        SkShader* s = SkShader::CreateBitmapShader(bm,
-                                                   SkShader::kRepeat_TileMode,
-                                                   SkShader::kRepeat_TileMode);
+        SkShader* s = SkShader::CreateBitmapShader(bm, mode, mode);
+        if (persp) {
+            SkMatrix m;
+            m.setRotate(SkIntToScalar(30));
+            m.setPerspX(SkFloatToScalar(0.001f));
+            m.setPerspY(SkFloatToScalar(0.0005f));
+            s->setLocalMatrix(m);
+        }
         fPaint.setShader(s)->unref();
-        fName.printf("repeatTile_%s_%c", gConfigName[bm.config()], isOpaque ? 'X' : 'A');
+        fName.printf("%sTile_%s_%c", gModeName[mode], gConfigName[bm.config()],
+                     isOpaque ? 'X' : 'A');
+        if (filter) {
+            fName.append("_filter");
+        }
+        if (persp) {
+            fName.append("_persp");
+        }
     }
 
 protected:
@@ -125,6 +145,9 @@ protected:
     virtual void onDraw(SkCanvas* canvas) {
         SkPaint paint(fPaint);
         this->setupPaint(&paint);
+        if (fFilter) {
+            paint.setFilterBitmap(true);
+        }
 
         for (int i = 0; i < N; i++) {
             canvas->drawPaint(paint);
@@ -140,3 +163,16 @@ DEF_BENCH(return new RepeatTileBench(p, SkBitmap::kARGB_8888_Config, false))
 DEF_BENCH(return new RepeatTileBench(p, SkBitmap::kRGB_565_Config))
 DEF_BENCH(return new RepeatTileBench(p, SkBitmap::kARGB_4444_Config))
 DEF_BENCH(return new RepeatTileBench(p, SkBitmap::kIndex8_Config))
+
+DEF_BENCH(return new RepeatTileBench(p, SkBitmap::kARGB_8888_Config, true,
+                                     SkShader::kRepeat_TileMode, true))
+DEF_BENCH(return new RepeatTileBench(p, SkBitmap::kARGB_8888_Config, true,
+                                     SkShader::kRepeat_TileMode, true, true))
+DEF_BENCH(return new RepeatTileBench(p, SkBitmap::kARGB_8888_Config, true,
+                                     SkShader::kMirror_TileMode))
+DEF_BENCH(return new RepeatTileBench(p, SkBitmap::kARGB_8888_Config, true,
+                                     SkShader::kMirror_TileMode, true))
+DEF_BENCH(return new RepeatTileBench(p, SkBitmap::kRGB_565_Config, true,
+                                     SkShader::kRepeat_TileMode, true))
+DEF_BENCH(return new RepeatTileBench(p, SkBitmap::kRGB_565_Config, true,
+                                     SkShader::kClamp_TileMode, true, true))
@@ -68,3 +68,35 @@ static SkBenchmark* Fact2(void* p) { return new XfermodeBench(p, SkXfermode::kDa
 static BenchRegistry gReg0(Fact0);
 static BenchRegistry gReg1(Fact1);
 static BenchRegistry gReg2(Fact2);
+
+// The rest of the modes matter mostly to the raster backend, where each one
+// has its own xfer procs.
+#define XFERMODE_BENCH(mode) \
+    DEF_BENCH( return new XfermodeBench(p, SkXfermode::k##mode##_Mode); )
+
+XFERMODE_BENCH(Clear)
+XFERMODE_BENCH(Dst)
+XFERMODE_BENCH(DstOver)
+XFERMODE_BENCH(SrcIn)
+XFERMODE_BENCH(DstIn)
+XFERMODE_BENCH(SrcOut)
+XFERMODE_BENCH(DstOut)
+XFERMODE_BENCH(SrcATop)
+XFERMODE_BENCH(DstATop)
+XFERMODE_BENCH(Xor)
+XFERMODE_BENCH(Plus)
+XFERMODE_BENCH(Modulate)
+XFERMODE_BENCH(Screen)
+XFERMODE_BENCH(Overlay)
+XFERMODE_BENCH(Lighten)
+XFERMODE_BENCH(ColorDodge)
+XFERMODE_BENCH(ColorBurn)
+XFERMODE_BENCH(HardLight)
+XFERMODE_BENCH(SoftLight)
+XFERMODE_BENCH(Difference)
+XFERMODE_BENCH(Exclusion)
+XFERMODE_BENCH(Multiply)
+XFERMODE_BENCH(Hue)
+XFERMODE_BENCH(Saturation)
+XFERMODE_BENCH(Color)
+XFERMODE_BENCH(Luminosity)
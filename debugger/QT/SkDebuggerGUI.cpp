@@ -269,7 +269,7 @@ public:
             return;
         }
 
-        if (stream->readBool()) {
+        if (stream->readU32()) {
             fPlayback = SkNEW_ARGS(SkTimedPicturePlayback,
                                    (stream, info, proc, offsets, deletedCommands));
         }
@@ -957,7 +957,7 @@ public:
             return;
         }
 
-        if (stream->readBool()) {
+        if (stream->readU32()) {
             fPlayback = SkNEW_ARGS(SkOffsetPicturePlayback, (stream, info, proc));
         }
 
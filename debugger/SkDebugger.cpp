@@ -9,6 +9,8 @@
 #include "SkDebugger.h"
 #include "SkString.h"
 
+#include "PictureProfiler.h"
+
 
 SkDebugger::SkDebugger() {
     // Create this some other dynamic way?
@@ -46,6 +48,18 @@ SkPicture* SkDebugger::copyPicture() {
     return newPicture;
 }
 
+bool SkDebugger::writeProfile(SkCanvas* canvas, int repeats, SkWStream* stream) {
+    if (NULL == fPicture) {
+        return false;
+    }
+    sk_tools::PictureProfiler profiler;
+    if (!profiler.profile(fPicture, canvas, repeats)) {
+        return false;
+    }
+    profiler.writeReport(stream);
+    return true;
+}
+
 void SkDebugger::getOverviewText(const SkTDArray<double>* typeTimes,
                                  double totTime,
                                  SkString* overview,
@@ -15,6 +15,7 @@
 #include "SkTArray.h"
 
 class SkString;
+class SkWStream;
 
 class SkDebugger {
 public:
@@ -110,6 +111,14 @@ public:
     void getOverviewText(const SkTDArray<double>* typeTimes, double totTime,
                          SkString* overview, int numRuns);
 
+    /**
+     * Draws the loaded picture into canvas repeats times, timing each of its
+     * commands, and writes a JSON report of the times, the pixels each
+     * command covers and the totals by type to stream. Returns false if no
+     * picture is loaded, or this build can't profile (see PictureProfiler).
+     */
+    bool writeProfile(SkCanvas* canvas, int repeats, SkWStream* stream);
+
 private:
     SkDebugCanvas* fDebugCanvas;
     SkPicture* fPicture;
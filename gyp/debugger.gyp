@@ -92,6 +92,8 @@
         '../debugger/SkDrawCommand.cpp',
         '../debugger/SkObjectParser.h',
         '../debugger/SkObjectParser.cpp',
+        '../tools/PictureProfiler.h',
+        '../tools/PictureProfiler.cpp',
       ],
       'dependencies': [
         'skia_base_libs.gyp:skia_base_libs',
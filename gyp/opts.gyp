@@ -40,15 +40,21 @@
             [ 'skia_os != "android"', {
               'dependencies': [
                 'opts_ssse3',
+                'opts_avx2',
               ],
             }],
           ],
           'sources': [
             '../src/opts/opts_check_SSE2.cpp',
             '../src/opts/SkBitmapProcState_opts_SSE2.cpp',
+            '../src/opts/SkBitmapProcState_matrix_SSE2.h',
             '../src/opts/SkBlitRow_opts_SSE2.cpp',
             '../src/opts/SkBlitRect_opts_SSE2.cpp',
+            '../src/opts/SkBoxBlur_opts_SSE2.cpp',
+            '../src/opts/SkConvolver_opts_SSE2.cpp',
+            '../src/opts/SkGradient_opts_SSE2.cpp',
             '../src/opts/SkUtils_opts_SSE2.cpp',
+            '../src/opts/SkXfermode_opts_SSE2.cpp',
           ],
         }],
         [ 'skia_arch_type == "arm" and armv7 == 1', {
@@ -72,6 +78,10 @@
             '../src/opts/SkBitmapProcState_opts_arm.cpp',
             '../src/opts/SkBlitRow_opts_arm.cpp',
             '../src/opts/SkBlitRow_opts_arm.h',
+            '../src/opts/SkBoxBlur_opts_none.cpp',
+            '../src/opts/SkConvolver_opts_none.cpp',
+            '../src/opts/SkGradient_opts_none.cpp',
+            '../src/opts/SkXfermode_opts_none.cpp',
           ],
           'conditions': [
             [ 'arm_neon == 1 or arm_neon_optional == 1', {
@@ -93,7 +103,11 @@
           'sources': [
             '../src/opts/SkBitmapProcState_opts_none.cpp',
             '../src/opts/SkBlitRow_opts_none.cpp',
+            '../src/opts/SkBoxBlur_opts_none.cpp',
+            '../src/opts/SkConvolver_opts_none.cpp',
+            '../src/opts/SkGradient_opts_none.cpp',
             '../src/opts/SkUtils_opts_none.cpp',
+            '../src/opts/SkXfermode_opts_none.cpp',
           ],
         }],
       ],
@@ -133,6 +147,36 @@
         }],
       ],
     },
+    # Same again for AVX2 code, which is only called after checking for AVX2
+    # support at runtime (see opts_check_SSE2.cpp).
+    {
+      'target_name': 'opts_avx2',
+      'product_name': 'skia_opts_avx2',
+      'type': 'static_library',
+      'standalone_static_library': 1,
+      'include_dirs': [
+        '../include/config',
+        '../include/core',
+        '../src/core',
+      ],
+      'conditions': [
+        [ 'skia_os in ["linux", "freebsd", "openbsd", "solaris", "nacl"]', {
+          'cflags': [
+            '-mavx2',
+          ],
+        }],
+        [ 'skia_os in ["mac"]', {
+          'xcode_settings': {
+            'OTHER_CFLAGS': ['-mavx2',],
+          },
+        }],
+        [ 'skia_arch_type == "x86"', {
+          'sources': [
+            '../src/opts/SkBlitRow_opts_AVX2.cpp',
+          ],
+        }],
+      ],
+    },
     # NEON code must be compiled with -mfpu=neon which also affects scalar
     # code. To support dynamic NEON code paths, we need to build all
     # NEON-specific sources in a separate static library. The situation
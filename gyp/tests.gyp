@@ -18,12 +18,16 @@
       ],
       'sources': [
         '../tests/AAClipTest.cpp',
+        '../tests/AnalyticAATest.cpp',
         '../tests/AnnotationTest.cpp',
         '../tests/AtomicTest.cpp',
+        '../tests/BandedDeviceTest.cpp',
         '../tests/BitmapCopyTest.cpp',
         '../tests/BitmapFactoryTest.cpp',
         '../tests/BitmapGetColorTest.cpp',
         '../tests/BitmapHeapTest.cpp',
+        '../tests/BitmapScalerTest.cpp',
+        '../tests/BitmapTileTest.cpp',
         '../tests/BitmapTransformerTest.cpp',
         '../tests/BitSetTest.cpp',
         '../tests/BlitRowTest.cpp',
@@ -53,6 +57,7 @@
         '../tests/FontMgrTest.cpp',
         '../tests/FontNamesTest.cpp',
         '../tests/GeometryTest.cpp',
+        '../tests/GlyphCacheTest.cpp',
         '../tests/GLInterfaceValidation.cpp',
         '../tests/GLProgramsTest.cpp',
         '../tests/GpuBitmapCopyTest.cpp',
@@ -69,6 +74,7 @@
         '../tests/Matrix44Test.cpp',
         '../tests/MemsetTest.cpp',
         '../tests/MetaDataTest.cpp',
+        '../tests/MipMapTest.cpp',
         '../tests/PackBitsTest.cpp',
         '../tests/PaintTest.cpp',
         '../tests/ParsePathTest.cpp',
@@ -106,6 +112,7 @@
         '../tests/Test.cpp',
         '../tests/Test.h',
         '../tests/TestSize.cpp',
+        '../tests/ThreadPoolTest.cpp',
         '../tests/TileGridTest.cpp',
         '../tests/TLSTest.cpp',
         '../tests/TSetTest.cpp',
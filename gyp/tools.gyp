@@ -112,9 +112,12 @@
         '../bench/TimerData.cpp',
         '../tools/bench_pictures_main.cpp',
         '../tools/PictureBenchmark.cpp',
+        '../tools/PictureProfiler.h',
+        '../tools/PictureProfiler.cpp',
       ],
       'include_dirs': [
         '../bench',
+        '../src/core/',
         '../src/lazy/',
       ],
       'dependencies': [
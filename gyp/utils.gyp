@@ -31,6 +31,7 @@
         '../src/utils/SkCountdown.cpp',
         '../src/utils/SkThreadPool.cpp',
 
+        '../include/utils/SkBandedDevice.h',
         '../include/utils/SkBoundaryPatch.h',
         '../include/utils/SkCamera.h',
         '../include/utils/SkCubicInterval.h',
@@ -39,6 +40,7 @@
         '../include/utils/SkDeferredCanvas.h',
         '../include/utils/SkDumpCanvas.h',
         '../include/utils/SkInterpolator.h',
+        '../include/utils/SkJSON.h',
         '../include/utils/SkLayer.h',
         '../include/utils/SkMatrix44.h',
         '../include/utils/SkMeshUtils.h',
@@ -55,6 +57,7 @@
         '../include/utils/SkUnitMappers.h',
         '../include/utils/SkWGL.h',
 
+        '../src/utils/SkBandedDevice.cpp',
         '../src/utils/SkBase64.cpp',
         '../src/utils/SkBase64.h',
         '../src/utils/SkBitmapChecksummer.cpp',
@@ -73,6 +76,7 @@
         '../src/utils/SkDumpCanvas.cpp',
         '../src/utils/SkFloatUtils.h',
         '../src/utils/SkInterpolator.cpp',
+        '../src/utils/SkJSON.cpp',
         '../src/utils/SkLayer.cpp',
         '../src/utils/SkMatrix44.cpp',
         '../src/utils/SkMD5.cpp',
@@ -122,6 +122,18 @@
  */
 #define SK_DEFAULT_FONT_CACHE_LIMIT   (12 * 1024 * 1024)
 
+/*
+ *  To specify a different default limit for the cache of resampled bitmaps
+ *  and mipmaps, define this. If this is undefined, skia will use a built-in value.
+ */
+//#define SK_DEFAULT_IMAGE_CACHE_LIMIT  (8 * 1024 * 1024)
+
+/*
+ *  To specify a different default limit for the cache of gradient color
+ *  tables, define this. If this is undefined, skia will use a built-in value.
+ */
+//#define SK_DEFAULT_GRADIENT_CACHE_LIMIT  (1024 * 1024)
+
 /* If defined, use CoreText instead of ATSUI on OS X.
 */
 //#define SK_USE_MAC_CORE_TEXT
@@ -18,6 +18,7 @@
 
 struct SkIRect;
 struct SkRect;
+class SkMipMap;
 class SkPaint;
 class SkPixelRef;
 class SkRegion;
@@ -533,6 +534,12 @@ public:
     bool canCopyTo(Config newConfig) const;
 
     bool hasMipMap() const;
+
+    /** Builds the mipmap levels used when this bitmap is drawn minified. The
+        mipmap is shared through the global image cache, so bitmaps with the
+        same pixels (see getGenerationID()) build it only once. If
+        forceRebuild is true, it is rebuilt and replaces the cached one.
+    */
     void buildMipMap(bool forceRebuild = false);
     void freeMipMap();
 
@@ -642,8 +649,7 @@ public:
     SkDEVCODE(void toString(SkString* str) const;)
 
 private:
-    struct MipMap;
-    mutable MipMap* fMipMap;
+    mutable const SkMipMap* fMipMap;
 
     mutable SkPixelRef* fPixelRef;
     mutable size_t      fPixelRefOffset;
@@ -688,8 +694,6 @@ private:
     */
     void freePixels();
     void updatePixelsFromRef() const;
-
-    static SkFixed ComputeMipLevel(SkFixed sx, SkFixed dy);
 };
 
 class SkAutoLockPixels : public SkNoncopyable {
@@ -60,6 +60,25 @@ public:
      */
     static void PurgeFontCache();
 
+    /**
+     *  Return the number of bytes used by the cache of bitmaps resampled for
+     *  high quality filtering (see SkPaint::kHighQualityFilterBitmap_Flag)
+     *  and of mipmaps (see SkBitmap::buildMipMap()).
+     */
+    static size_t GetImageCacheBytesUsed();
+
+    /**
+     *  Return the max number of bytes that should be used by the image cache.
+     *  If the cache needs to allocate more, it will purge previous entries.
+     */
+    static size_t GetImageCacheByteLimit();
+
+    /**
+     *  Specify the max number of bytes that should be used by the image cache,
+     *  returning the previous setting.
+     */
+    static size_t SetImageCacheByteLimit(size_t newLimit);
+
     /**
      *  Applications with command line options may pass optional state, such
      *  as cache sizes, here, for instance:
@@ -90,6 +109,23 @@ public:
      */
     static void SetTLSFontCacheLimit(size_t bytes);
 
+    /**
+     *  Use the file at path as a persistent store of glyph images, so that
+     *  glyphs rasterized by earlier processes are read back instead of being
+     *  rasterized again. The file is memory-mapped now, and glyphs rasterized
+     *  from here on are added to it by FlushGlyphStore(). A missing or
+     *  incompatible file starts an empty store. Pass NULL to stop using a
+     *  store. Either way, this purges the font cache.
+     */
+    static void SetGlyphStorePath(const char path[]);
+
+    /**
+     *  Writes the glyph store's glyphs, including the ones rasterized since
+     *  SetGlyphStorePath(), to its file. Returns false if there is no store
+     *  or the file could not be written.
+     */
+    static bool FlushGlyphStore();
+
 private:
     /** This is automatically called by SkGraphics::Init(), and must be
         implemented by the host OS. This allows the host OS to register a callback
@@ -105,11 +105,13 @@ public:
         kAutoHinting_Flag     = 0x800,  //!< mask to force Freetype's autohinter
         kVerticalText_Flag    = 0x1000,
         kGenA8FromLCD_Flag    = 0x2000, // hack for GDI -- do not use if you can help it
+        kAnalyticAA_Flag      = 0x4000, //!< mask to antialias fills by exact area coverage
+        kHighQualityFilterBitmap_Flag = 0x8000, //!< mask to resample minified bitmaps
 
         // when adding extra flags, note that the fFlags member is specified
         // with a bit-width and you'll have to expand it.
 
-        kAllFlags = 0x3FFF
+        kAllFlags = 0xFFFF
     };
 
     /** Return the paint's flags. Use the Flag enum to test flag values.
@@ -206,6 +208,24 @@ public:
     */
     void setAutohinted(bool useAutohinter);
 
+    /** Helper for getFlags(), returning true if kAnalyticAA_Flag bit is set
+        @return true if the kAnalyticAA_Flag bit is set in the paint's flags
+    */
+    bool isAnalyticAA() const {
+        return SkToBool(this->getFlags() & kAnalyticAA_Flag);
+    }
+
+    /**
+     *  Helper for setFlags(), setting or clearing the kAnalyticAA_Flag bit.
+     *  When set (along with kAntiAlias_Flag), filled paths are antialiased by
+     *  accumulating the exact area each edge covers in every pixel, rather
+     *  than by 4x4 supersampling. This gives 256 coverage levels and visits
+     *  each pixel row once.
+     *  @param doAnalyticAA true to set the kAnalyticAA_Flag bit in the paint's
+     *                      flags, false to clear it.
+     */
+    void setAnalyticAA(bool doAnalyticAA);
+
     bool isVerticalText() const {
         return SkToBool(this->getFlags() & kVerticalText_Flag);
     }
@@ -278,6 +298,26 @@ public:
 
     void setFilterBitmap(bool filterBitmap);
 
+    /** Helper for getFlags(), returning true if kHighQualityFilterBitmap_Flag
+        bit is set
+        @return true if the kHighQualityFilterBitmap_Flag bit is set in the
+                paint's flags
+    */
+    bool isHighQualityFilterBitmap() const {
+        return SkToBool(this->getFlags() & kHighQualityFilterBitmap_Flag);
+    }
+
+    /**
+     *  Helper for setFlags(), setting or clearing the
+     *  kHighQualityFilterBitmap_Flag bit. When set, bitmaps drawn smaller than
+     *  their size under a scale/translate matrix are first resampled to the
+     *  drawn size with a Lanczos filter, and the result is cached for later
+     *  draws. Other matrices fall back to bilinear filtering.
+     *  @param doHighQualityFilter true to set the kHighQualityFilterBitmap_Flag
+     *                             bit in the paint's flags, false to clear it.
+     */
+    void setHighQualityFilterBitmap(bool doHighQualityFilter);
+
     /** Styles apply to rect, oval, path, and text.
         Bitmaps are always drawn in "fill", and lines are always drawn in
         "stroke".
@@ -11,10 +11,12 @@
 #define SkPicture_DEFINED
 
 #include "SkBitmap.h"
+#include "SkRect.h"
 #include "SkRefCnt.h"
 
 class SkBBoxHierarchy;
 class SkCanvas;
+class SkData;
 class SkPicturePlayback;
 class SkPictureRecord;
 class SkStream;
@@ -69,6 +71,26 @@ public:
      */
     SkPicture(SkStream*, bool* success, InstallPixelRefProc proc);
 
+    /**
+     *  Recreate a picture that was serialized into data, as SkPicture(SkStream*, ...)
+     *  does, but without copying its drawing commands or paths out of data:
+     *  they are read in place, and each path is only unflattened when it is
+     *  first drawn. The picture refs data, which must not change.
+     *  @param data Serialized picture data.
+     *  @param proc Function pointer for installing pixelrefs on SkBitmaps representing the
+     *              encoded bitmap data.
+     *  @return The new picture, or NULL if data does not hold a picture.
+     */
+    static SkPicture* CreateFromData(SkData* data, InstallPixelRefProc proc = NULL);
+
+    /**
+     *  Memory-map the file at path, and recreate the picture serialized in it
+     *  as CreateFromData() does. If the file can't be mapped, it is read as
+     *  SkPicture(SkStream*, ...) would.
+     *  @return The new picture, or NULL if the file does not hold a picture.
+     */
+    static SkPicture* CreateFromFile(const char path[], InstallPixelRefProc proc = NULL);
+
     virtual ~SkPicture();
 
     /**
@@ -139,6 +161,87 @@ public:
     */
     void endRecording();
 
+    /** Counts of the ops optimize() removed or rewrote, by optimization.
+    */
+    struct OptimizeStats {
+        OptimizeStats() { sk_bzero(this, sizeof(*this)); }
+
+        int fOpCount;           //!< ops in the picture before optimizing
+        int fDeadSaveRestores;  //!< save/restore pairs with nothing to undo
+        int fRedundantClips;    //!< clips that could not shrink the clip
+        int fMergedSaveLayers;  //!< saveLayers turned into saves
+        int fOccludedDraws;     //!< draws hidden by a later opaque draw
+        int fFoldedMatrixOps;   //!< matrix ops folded into a neighbour, or unneeded
+
+        /** Returns the number of ops that will no longer be played back. */
+        int removedOpCount() const {
+            return 2 * fDeadSaveRestores + fRedundantClips + fOccludedDraws + fFoldedMatrixOps;
+        }
+    };
+
+    /** Rewrites the recorded drawing commands so that playing them back does
+        less work, calling endRecording() first if needed. This
+        - removes save/restore pairs with no matrix or clip change between them
+        - removes clips that cannot shrink the clip they are applied to
+        - turns a saveLayer into a save when its alpha can be applied to the
+          draw inside it instead, or it has no effect
+        - removes draws covered by a later opaque drawPaint, clear or rect
+        - folds runs of matrix changes into a single one.
+        The result can differ from the original in the rounding of some
+        pixels. Removing covered draws assumes the picture will not be drawn
+        through an antialiased clip.
+        Copies and clones made before this call keep the original commands.
+        @param stats if not NULL, counts of what was optimized are added to it.
+    */
+    void optimize(OptimizeStats* stats = NULL);
+
+    /** Replaces what the picture draws inside rect with what replacement
+        draws there, without recording the rest of the picture again. This
+        calls endRecording() first if needed.
+        replacement is drawn in the picture's coordinates, clipped to rect, so
+        it should be recorded at the picture's size and hold what recording
+        the whole picture again would draw inside rect; it need not draw
+        anything outside it. If replacement is NULL, nothing is drawn inside
+        rect.
+        The commands already recorded are kept, with their bounding box
+        hierarchy, and drawn clipped out of every rect spliced over; a splice
+        over a rect that covers an earlier one drops the earlier replacement.
+        The picture refs replacement, which must not change afterwards.
+        Copies made before this call keep the original commands.
+        @param rect the area to replace, in the picture's coordinates.
+        @param replacement the picture to draw inside rect, or NULL.
+        @param damage if not NULL, set to the area that must be drawn again,
+                      when the picture is drawn with no matrix, for the
+                      change to show: rect rounded out, within the picture's
+                      bounds.
+    */
+    void splice(const SkRect& rect, SkPicture* replacement, SkIRect* damage = NULL);
+
+    /** What was found out about the drawing commands while they were
+        recorded, so that a picture can be planned for without playing it
+        back. It is kept when the picture is serialized.
+    */
+    struct Analysis {
+        Analysis() { sk_bzero(this, sizeof(*this)); }
+
+        SkRect  fBounds;        //!< bounds of what is drawn, within the picture's size
+        bool    fOpaque;        //!< every pixel within fBounds is drawn opaque
+        bool    fHasText;       //!< some commands draw text
+        bool    fHasBitmaps;    //!< some commands draw bitmaps
+        bool    fHasSaveLayers; //!< some commands draw to layers
+        int     fOpCount;       //!< commands played back, counting those of nested pictures
+        float   fRasterCost;    //!< pixels drawn, summed over the drawing commands, where
+                                //!< those that sample a bitmap or shader count twice
+    };
+
+    /** Describes what was recorded, as found out while recording it. If the
+        picture is still recording, describes what has been recorded so far.
+        Bounds and costs are estimates from each command's bounds, which err
+        on the side of being too large; fOpaque is only set when the picture
+        is known to be opaque.
+    */
+    void getAnalysis(Analysis* analysis) const;
+
     /** Replays the drawing commands on the specified canvas. This internally
         calls endRecording() if that has not already been called.
         @param surface the canvas receiving the drawing commands.
@@ -168,11 +271,20 @@ public:
      */
     typedef bool (*EncodeBitmap)(SkWStream*, const SkBitmap&);
 
+    enum SerializeFlags {
+        /** Pack the drawing commands into a compact, byte-oriented form,
+            often less than half their size. They have to be unpacked when the
+            picture is read, so can't be read in place by CreateFromData().
+        */
+        kPackOps_SerializeFlag = 0x01,
+    };
+
     /**
      *  Serialize to a stream. If non NULL, encoder will be used to encode
      *  any bitmaps in the picture.
+     *  @param flags A combination of SerializeFlags.
      */
-    void serialize(SkWStream*, EncodeBitmap encoder = NULL) const;
+    void serialize(SkWStream*, EncodeBitmap encoder = NULL, uint32_t flags = 0) const;
 
 #ifdef SK_BUILD_FOR_ANDROID
     /** Signals that the caller is prematurely done replaying the drawing
@@ -194,7 +306,11 @@ protected:
     // V9 : Allow the reader and writer of an SKP disagree on whether to support
     //      SK_SUPPORT_HINTING_SCALE_FACTOR
     // V10: add drawRRect, drawOval, clipRRect
-    static const uint32_t PICTURE_VERSION = 10;
+    // V11: keep the op data and flattened buffer 4-byte aligned, and record the
+    //      size of each flattened path, so that both can be read in place
+    // V12: optionally pack the op data
+    // V13: add the analysis made while recording
+    static const uint32_t PICTURE_VERSION = 13;
 
     // fPlayback, fRecord, fWidth & fHeight are protected to allow derived classes to
     // install their own SkPicturePlayback-derived players,SkPictureRecord-derived
@@ -208,7 +324,7 @@ protected:
     virtual SkBBoxHierarchy* createBBoxHierarchy() const;
 
 private:
-    void initFromStream(SkStream*, bool* success, InstallPixelRefProc);
+    void initFromStream(SkStream*, bool* success, InstallPixelRefProc, bool inPlace = false);
 
     friend class SkFlatPicture;
     friend class SkPicturePlayback;
@@ -46,11 +46,22 @@ public:
      */
     SkTileGridPicture(int width, int height, const TileGridInfo& info);
 
+    /**
+     * Constructor for when the tiling layout isn't known: the tile interval
+     * is picked from the bounds of what is recorded, when it is first
+     * played back. If no interval suits them, for instance because many of
+     * them are much larger than the rest, an R-Tree is used instead. The
+     * grid has no margin or offset.
+     * @param width recording canvas width in device pixels
+     * @param height recording canvas height in device pixels
+     */
+    SkTileGridPicture(int width, int height);
+
     virtual SkBBoxHierarchy* createBBoxHierarchy() const SK_OVERRIDE;
 
 private:
     int fXTileCount, fYTileCount;
-    TileGridInfo fInfo;
+    TileGridInfo fInfo;     // fTileInterval is empty when it is to be picked
 };
 
 #endif
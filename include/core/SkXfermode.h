@@ -267,6 +267,10 @@ protected:
         fProc = proc;
     }
 
+    SkXfermodeProc getProc() const {
+        return fProc;
+    }
+
 private:
     SkXfermodeProc  fProc;
 
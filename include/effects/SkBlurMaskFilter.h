@@ -12,6 +12,8 @@
 #include "SkMaskFilter.h"
 #include "SkScalar.h"
 
+class SkThreadPool;
+
 class SK_API SkBlurMaskFilter {
 public:
     enum BlurStyle {
@@ -53,6 +55,15 @@ public:
                                         SkScalar ambient, SkScalar specular,
                                         SkScalar blurRadius);
 
+    /** Large blurs, from these maskfilters and from SkBlurImageFilter, split
+        each pass into bands of rows and blur them concurrently on pool.
+        @param pool     The pool to blur on, which is not owned. NULL (the
+                        default) blurs on the calling thread.
+        @return The previous pool. It must not be deleted while a blur that
+                may be using it is still running.
+    */
+    static SkThreadPool* SetThreadPool(SkThreadPool* pool);
+
     SK_DECLARE_FLATTENABLE_REGISTRAR_GROUP()
 private:
     SkBlurMaskFilter(); // can't be instantiated
@@ -21,6 +21,18 @@ class SkUnitMapper;
 */
 class SK_API SkGradientShader {
 public:
+    enum Flags {
+        /** By default a gradient's colors are looked up in a table of 256
+            entries, shared by all of its stops, so a wide gradient with many
+            stops shows bands. With this flag, linear and radial gradients
+            drawn into 32-bit raster destinations instead interpolate each
+            pixel's color between the two stops around it. This is slower
+            than the table. Other gradients, 16-bit destinations and the GPU
+            ignore it.
+        */
+        kInterpolateColors_Flag = 1 << 0,
+    };
+
     /** Returns a shader that generates a linear gradient between the two
         specified points.
         <p />
@@ -37,11 +49,13 @@ public:
         @param  count   Must be >=2. The number of colors (and pos if not NULL) entries.
         @param  mode    The tiling mode
         @param  mapper  May be NULL. Callback to modify the spread of the colors.
+        @param  flags   Any of the Flags above, or 0.
     */
     static SkShader* CreateLinear(  const SkPoint pts[2],
                                     const SkColor colors[], const SkScalar pos[], int count,
                                     SkShader::TileMode mode,
-                                    SkUnitMapper* mapper = NULL);
+                                    SkUnitMapper* mapper = NULL,
+                                    uint32_t flags = 0);
 
     /** Returns a shader that generates a radial gradient given the center and radius.
         <p />
@@ -59,11 +73,13 @@ public:
         @param  count   Must be >= 2. The number of colors (and pos if not NULL) entries
         @param  mode    The tiling mode
         @param  mapper  May be NULL. Callback to modify the spread of the colors.
+        @param  flags   Any of the Flags above, or 0.
     */
     static SkShader* CreateRadial(  const SkPoint& center, SkScalar radius,
                                     const SkColor colors[], const SkScalar pos[], int count,
                                     SkShader::TileMode mode,
-                                    SkUnitMapper* mapper = NULL);
+                                    SkUnitMapper* mapper = NULL,
+                                    uint32_t flags = 0);
 
     /** Returns a shader that generates a radial gradient given the start position, start radius, end position and end radius.
         <p />
@@ -129,6 +145,26 @@ public:
                                  const SkColor colors[], const SkScalar pos[],
                                  int count, SkUnitMapper* mapper = NULL);
 
+    /**
+     *  Return the number of bytes used by the color tables that gradient
+     *  shaders share. Shaders created with the same colors and positions (and
+     *  no mapper) build their tables once, and find them here after that.
+     */
+    static size_t GetCacheBytesUsed();
+
+    /**
+     *  Return the number of bytes of color tables the cache will hold before
+     *  purging the least recently used ones.
+     */
+    static size_t GetCacheByteLimit();
+
+    /**
+     *  Specify the number of bytes of color tables the cache may hold, purging
+     *  tables if needed, and return the previous limit. Shaders keep their
+     *  own tables when the cache purges them.
+     */
+    static size_t SetCacheByteLimit(size_t newLimit);
+
     SK_DECLARE_FLATTENABLE_REGISTRAR_GROUP()
 };
 
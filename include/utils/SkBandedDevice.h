@@ -0,0 +1,86 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkBandedDevice_DEFINED
+#define SkBandedDevice_DEFINED
+
+#include "SkDevice.h"
+
+class SkBandDrawer;
+class SkThreadPool;
+
+/**
+ *  Raster device that rasterizes large path, rect and bitmap draws on several threads.
+ *
+ *  The device-space bounds of such a draw (clipped to the current clip) are split into
+ *  horizontal bands, and each band is drawn concurrently on an SkThreadPool with its own
+ *  SkDraw whose clip is restricted to that band. Edge building and scan conversion
+ *  (including antialiasing supersampling) therefore happen once per band, and the bands
+ *  never write to the same rows. The draw is complete when the call returns. Band
+ *  boundaries behave like clip edges, so pixels along them may be covered very slightly
+ *  differently than in a single unbanded pass.
+ *
+ *  Draws that are small, or whose paint holds state that cannot be shared between threads
+ *  (mask filters, rasterizers, path effects, non-bitmap shaders), are drawn on the calling
+ *  thread exactly as SkDevice would.
+ */
+class SkBandedDevice : public SkDevice {
+public:
+    /**
+     *  Draw into bitmap, using pool (which is not owned, and must outlive the device) to
+     *  rasterize bands. A pool with no threads makes this behave like SkDevice.
+     */
+    SkBandedDevice(const SkBitmap& bitmap, SkThreadPool* pool);
+
+    /**
+     *  Allocate the pixels, as SkDevice(config, width, height, isOpaque) does.
+     */
+    SkBandedDevice(SkBitmap::Config config, int width, int height, bool isOpaque,
+                   SkThreadPool* pool);
+
+    /**
+     *  Draws covering fewer than this many device pixels are not split. Defaults to
+     *  kDefaultMinPixelsToBand.
+     */
+    void setMinPixelsToBand(int pixels) { fMinPixelsToBand = pixels; }
+    int getMinPixelsToBand() const { return fMinPixelsToBand; }
+
+    enum {
+        kDefaultMinPixelsToBand = 256 * 256,
+        // Bands shorter than this spend more time building edges than filling spans.
+        kMinBandHeight = 16,
+    };
+
+protected:
+    virtual void drawRect(const SkDraw&, const SkRect& r,
+                          const SkPaint& paint) SK_OVERRIDE;
+    virtual void drawPath(const SkDraw&, const SkPath& path,
+                          const SkPaint& paint,
+                          const SkMatrix* prePathMatrix = NULL,
+                          bool pathIsMutable = false) SK_OVERRIDE;
+    virtual void drawBitmap(const SkDraw&, const SkBitmap& bitmap,
+                            const SkIRect* srcRectOrNull,
+                            const SkMatrix& matrix, const SkPaint& paint) SK_OVERRIDE;
+
+    virtual SkDevice* onCreateCompatibleDevice(SkBitmap::Config config,
+                                               int width, int height,
+                                               bool isOpaque,
+                                               Usage usage) SK_OVERRIDE;
+
+private:
+    bool canBand(const SkDraw&, const SkPaint&) const;
+    // Returns false, without drawing anything, if the draw should not be split after all.
+    bool drawInBands(const SkDraw&, const SkPaint&, const SkRect& devBounds,
+                     const SkBandDrawer&);
+
+    SkThreadPool* fPool;
+    int           fMinPixelsToBand;
+
+    typedef SkDevice INHERITED;
+};
+
+#endif
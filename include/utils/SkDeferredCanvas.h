@@ -126,6 +126,30 @@ public:
      */
     void silentFlush();
 
+    /**
+     *  Enable or disable threaded playback. When enabled, recorded draw
+     *  commands are played back into the device on a thread of its own, a
+     *  little at a time, while more are recorded. Recording only waits for
+     *  playback when the storage allocated for recording reaches the limit
+     *  given to setMaxRecordingStorage, and when the device's pixels are
+     *  accessed or the canvas is flushed, which wait for everything recorded
+     *  to be drawn. Commands that have been played already are not undone
+     *  by silentFlush.
+     *  Bitmaps are copied into the recording, and the device is drawn to
+     *  from the other thread, so this suits raster devices only. Where
+     *  SkCondVar is unavailable, playback stays on the recording thread.
+     *  Pending draw operations are flushed when the mode changes. This method
+     *  must not be called while the save/restore stack is in use.
+     *  @param threaded true/false
+     */
+    void setThreadedPlayback(bool threaded);
+
+    /**
+     *  Returns true if draw commands are currently played back on a thread
+     *  of their own.
+     */
+    bool isThreadedPlayback() const;
+
     // Overrides of the SkCanvas interface
     virtual int save(SaveFlags flags) SK_OVERRIDE;
     virtual int saveLayer(const SkRect* bounds, const SkPaint* paint,
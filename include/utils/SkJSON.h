@@ -12,6 +12,7 @@
 
 class SkStream;
 class SkString;
+class SkWStream;
 
 class SkJSON {
 public:
@@ -101,6 +102,11 @@ public:
 
         void toDebugf() const;
 
+        /**
+         *  Writes the object to the stream as JSON text.
+         */
+        void toStream(SkWStream*) const;
+
         /**
          *  Iterator class which returns all of the fields/slots in an Object,
          *  in the order that they were added.
@@ -179,7 +185,7 @@ public:
 
         const Slot* findSlot(const char name[], Type) const;
         Slot* addSlot(Slot*);
-        void dumpLevel(int level) const;
+        void dumpLevel(SkWStream*, int level) const;
 
         friend class Array;
     };
@@ -276,7 +282,7 @@ public:
         } fArray;
 
         void init(Type, int count, const void* src);
-        void dumpLevel(int level) const;
+        void dumpLevel(SkWStream*, int level) const;
 
         friend class Object;
     };
@@ -10,7 +10,9 @@
 
 #include "SkPicture.h"
 
+class SkBitmap;
 class SkData;
+class SkThreadPool;
 struct SkRect;
 
 class SK_API SkPictureUtils {
@@ -26,6 +28,27 @@ public:
      *  and remains unchanged.
      */
     static SkData* GatherPixelRefs(SkPicture* pict, const SkRect& area);
+
+    /**
+     *  Plays pict back into dst, as pict->draw() would on a canvas for dst,
+     *  using pool's threads as well as the calling thread. dst is split into
+     *  tiles of tileWidth x tileHeight, which the threads claim one at a time
+     *  and draw through a canvas clipped to the tile. If pict was recorded
+     *  with kOptimizeForClippedPlayback_RecordingFlag, its bounding box
+     *  hierarchy skips the draws outside each tile.
+     *
+     *  The op stream, bounding box hierarchy, paths and bitmaps are shared by
+     *  every thread. Paints holding effects (shaders, mask filters, ...) are
+     *  not safe to share, so each extra thread plays back its own clone() of
+     *  pict. Since each tile is rasterized through its own clip and origin,
+     *  antialiased or curved edges, and filters reading beyond the tile, can
+     *  differ slightly from a single draw.
+     *
+     *  Returns when dst is complete. With a NULL pool, or one without threads,
+     *  this simply draws pict into dst.
+     */
+    static void DrawParallel(SkPicture* pict, const SkBitmap& dst, SkThreadPool* pool,
+                             int tileWidth = 256, int tileHeight = 256);
 };
 
 #endif
@@ -10,11 +10,16 @@
 
 #include "SkCondVar.h"
 #include "SkTDArray.h"
-#include "SkTInternalLList.h"
 
 class SkRunnable;
-class SkThread;
+class SkTaskGroup;
 
+/**
+ *  Work-stealing thread pool. Each worker thread owns a deque of pending tasks: it pushes
+ *  and pops work at the back of its own deque, and when that runs dry it steals from the
+ *  front of the other workers' deques. There is no single queue shared by every thread, so
+ *  submitting and claiming tasks does not serialize on one lock.
+ */
 class SkThreadPool {
 
 public:
@@ -22,29 +27,101 @@ public:
      * Create a threadpool with exactly count (>=0) threads.
      */
     explicit SkThreadPool(int count);
+
+    /**
+     * Runs every task that has already been queued, then stops and joins all threads.
+     */
     ~SkThreadPool();
 
     /**
      * Queues up an SkRunnable to run when a thread is available, or immediately if
      * count is 0.  NULL is a safe no-op.  Does not take ownership.
+     *
+     * When called from one of this pool's own threads, the runnable is pushed onto that
+     * thread's deque; otherwise the pool's deques are filled round-robin.
      */
     void add(SkRunnable*);
 
- private:
-    struct LinkedRunnable {
-        // Unowned pointer.
-        SkRunnable* fRunnable;
+    /**
+     * Returns the number of threads owned by this pool.
+     */
+    int count() const { return fWorkers.count(); }
+
+    typedef void (*ParallelForProc)(void* context, int index);
 
-    private:
-        SK_DECLARE_INTERNAL_LLIST_INTERFACE(LinkedRunnable);
+    /**
+     * Calls proc(context, i) for every i in [0, count) and returns once all calls have
+     * completed. Indices are grouped into tasks of grainSize (>= 1) consecutive calls, which
+     * are spread across the pool. The calling thread helps run them while it waits.
+     */
+    void parallelFor(int count, ParallelForProc proc, void* context, int grainSize = 1);
+
+private:
+    struct Task {
+        // Both unowned. fGroup may be NULL.
+        SkRunnable*  fRunnable;
+        SkTaskGroup* fGroup;
     };
+    struct Worker;
+
+    SkTDArray<Worker*>  fWorkers;
+    // Guards sleeping and waking workers only; the deques have their own locks.
+    SkCondVar           fReady;
+    // Number of tasks sitting in deques. May briefly go negative while a task that was just
+    // pushed is stolen before the count catches up.
+    int32_t             fPending;
+    // Number of workers blocked (or about to block) on fReady.
+    int32_t             fSleepers;
+    int32_t             fNextWorker;
+    bool                fDone;
+
+    void push(SkRunnable*, SkTaskGroup*);
+    bool tryRunOne(Worker* self);
+    static void RunTask(const Task&);
+
+    static void Loop(void*);  // Static because we pass in a Worker.
+
+    friend class SkTaskGroup;
+};
+
+/**
+ *  Tracks a set of runnables submitted to an SkThreadPool so that they can be waited on as a
+ *  unit. Tasks in a group may add further tasks to the same group. Destroying the group
+ *  waits for any tasks that are still outstanding.
+ */
+class SkTaskGroup : SkNoncopyable {
+public:
+    explicit SkTaskGroup(SkThreadPool* pool);
+    ~SkTaskGroup();
+
+    /**
+     * Queues up an SkRunnable on the pool as part of this group.  NULL is a safe no-op.
+     * Does not take ownership.
+     */
+    void add(SkRunnable*);
+
+    /**
+     * Blocks until every runnable added to this group has finished running. While waiting,
+     * the calling thread runs queued tasks from the pool rather than idling, so it is safe
+     * to call from inside a task running on the same pool.
+     */
+    void wait();
+
+private:
+    SkThreadPool* fPool;
+    SkCondVar     fDone;
+    // Runnables added but not yet finished.
+    int32_t       fPending;
+    // Threads blocked in wait().
+    int32_t       fWaiters;
+    // Threads between finishing a runnable and their last access to this group.
+    int32_t       fFinishing;
 
-    SkTInternalLList<LinkedRunnable>    fQueue;
-    SkCondVar                           fReady;
-    SkTDArray<SkThread*>                fThreads;
-    bool                            fDone;
+    void taskAdded();
+    void taskQueued();
+    void taskFinished();
 
-    static void Loop(void*);  // Static because we pass in this.
+    friend class SkThreadPool;
 };
 
 #endif
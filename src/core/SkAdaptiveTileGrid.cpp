@@ -0,0 +1,184 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkAdaptiveTileGrid.h"
+#include "SkRTree.h"
+#include "SkTSort.h"
+
+// With fewer elements than this, culling costs little either way, and an
+// R-Tree culls more exactly.
+static const int kMinGridCount = 16;
+
+static const int kMinTileInterval = 64;
+static const int kMaxTileInterval = 1024;
+
+// Tile intervals are grown past kMaxTileInterval to keep a grid to this many tiles.
+static const int kMaxTileCount = 1 << 14;
+
+// Past this, the grid holds too many copies of each element.
+static const int kMaxTilesPerElement = 4;
+
+// Same as SkPicture's default R-Tree
+static const int kRTreeMinChildren = 6;
+static const int kRTreeMaxChildren = 11;
+
+SkAdaptiveTileGrid::SkAdaptiveTileGrid(int width, int height,
+    SkTileGrid::SkTileGridNextDatumFunctionPtr nextDatumFunction)
+    : fWidth(width)
+    , fHeight(height)
+    , fNextDatumFunction(nextDatumFunction)
+    , fHierarchy(NULL) {
+}
+
+SkAdaptiveTileGrid::~SkAdaptiveTileGrid() {
+    SkSafeUnref(fHierarchy);
+}
+
+void SkAdaptiveTileGrid::insert(void* data, const SkIRect& bounds, bool defer) {
+    if (NULL != fHierarchy) {
+        fHierarchy->insert(data, bounds, defer);
+        return;
+    }
+    Insert* insert = fInserts.append();
+    insert->fData = data;
+    insert->fBounds = bounds;
+}
+
+void SkAdaptiveTileGrid::flushDeferredInserts() {
+    if (NULL == fHierarchy) {
+        if (fInserts.isEmpty()) {
+            return;
+        }
+        this->createHierarchy();
+    }
+    fHierarchy->flushDeferredInserts();
+}
+
+void SkAdaptiveTileGrid::search(const SkIRect& query, SkTDArray<void*>* results) {
+    this->flushDeferredInserts();
+    if (NULL == fHierarchy) {
+        results->reset();
+        return;
+    }
+    fHierarchy->search(query, results);
+}
+
+void SkAdaptiveTileGrid::clear() {
+    SkSafeUnref(fHierarchy);
+    fHierarchy = NULL;
+    fInserts.reset();
+}
+
+int SkAdaptiveTileGrid::getCount() const {
+    return NULL != fHierarchy ? fHierarchy->getCount() : fInserts.count();
+}
+
+void SkAdaptiveTileGrid::rewindInserts() {
+    if (NULL != fHierarchy) {
+        fHierarchy->rewindInserts();
+        return;
+    }
+    SkASSERT(fClient);
+    while (!fInserts.isEmpty() && fClient->shouldRewind(fInserts.top().fData)) {
+        fInserts.pop();
+    }
+}
+
+void SkAdaptiveTileGrid::createHierarchy() {
+    SkTDArray<SkIRect> bounds;
+    bounds.setCount(fInserts.count());
+    for (int i = 0; i < fInserts.count(); ++i) {
+        bounds[i] = fInserts[i].fBounds;
+    }
+
+    SkISize interval;
+    if (ChooseTileInterval(bounds.begin(), bounds.count(), fWidth, fHeight, &interval)) {
+        SkTileGridPicture::TileGridInfo info;
+        info.fTileInterval = interval;
+        info.fMargin.setEmpty();
+        info.fOffset.setZero();
+        int xTileCount = (fWidth + interval.width() - 1) / interval.width();
+        int yTileCount = (fHeight + interval.height() - 1) / interval.height();
+        fHierarchy = SkNEW_ARGS(SkTileGrid, (xTileCount, yTileCount, info, fNextDatumFunction));
+    } else {
+        SkScalar aspectRatio = SkScalarDiv(SkIntToScalar(fWidth), SkIntToScalar(fHeight));
+        fHierarchy = SkRTree::Create(kRTreeMinChildren, kRTreeMaxChildren, aspectRatio);
+    }
+    fHierarchy->setClient(fClient);
+
+    for (int i = 0; i < fInserts.count(); ++i) {
+        fHierarchy->insert(fInserts[i].fData, fInserts[i].fBounds, true);
+    }
+    fInserts.reset();
+}
+
+// Returns the tiles of the given interval that bounds, outset as SkTileGrid
+// outsets them, covers on one axis.
+static int covered_tiles(int32_t start, int32_t end, int interval, int tileCount) {
+    int first = SkPin32((start - 1) / interval, 0, tileCount - 1);
+    int last = SkPin32(end / interval, 0, tileCount - 1);
+    return last - first + 1;
+}
+
+bool SkAdaptiveTileGrid::ChooseTileInterval(const SkIRect bounds[], int count,
+                                            int width, int height, SkISize* interval) {
+    if (count < kMinGridCount || width <= 0 || height <= 0) {
+        return false;
+    }
+
+    // Only what lands in the grid matters.
+    const SkIRect gridBounds = SkIRect::MakeWH(width, height);
+    SkTDArray<SkIRect> clipped;
+    SkTDArray<int32_t> widths;
+    SkTDArray<int32_t> heights;
+    for (int i = 0; i < count; ++i) {
+        SkIRect r = bounds[i];
+        if (r.intersect(gridBounds)) {
+            *clipped.append() = r;
+            *widths.append() = r.width();
+            *heights.append() = r.height();
+        }
+    }
+    if (clipped.count() < kMinGridCount) {
+        return false;
+    }
+
+    // Tiles about twice the median size leave most elements in at most four tiles.
+    SkTQSort(widths.begin(), widths.end() - 1);
+    SkTQSort(heights.begin(), heights.end() - 1);
+    int tileWidth = SkPin32(SkNextPow2(2 * widths[widths.count() / 2]),
+                            kMinTileInterval, kMaxTileInterval);
+    int tileHeight = SkPin32(SkNextPow2(2 * heights[heights.count() / 2]),
+                             kMinTileInterval, kMaxTileInterval);
+
+    int xTileCount = (width + tileWidth - 1) / tileWidth;
+    int yTileCount = (height + tileHeight - 1) / tileHeight;
+    while ((int64_t)xTileCount * yTileCount > kMaxTileCount) {
+        if (tileWidth <= tileHeight) {
+            tileWidth *= 2;
+            xTileCount = (width + tileWidth - 1) / tileWidth;
+        } else {
+            tileHeight *= 2;
+            yTileCount = (height + tileHeight - 1) / tileHeight;
+        }
+    }
+
+    // If large elements would be copied into too many tiles, the grid would
+    // cost more memory and search time than an R-Tree.
+    int64_t entries = 0;
+    for (int i = 0; i < clipped.count(); ++i) {
+        const SkIRect& r = clipped[i];
+        entries += (int64_t)covered_tiles(r.fLeft, r.fRight, tileWidth, xTileCount) *
+                   covered_tiles(r.fTop, r.fBottom, tileHeight, yTileCount);
+    }
+    if (entries > (int64_t)kMaxTilesPerElement * clipped.count()) {
+        return false;
+    }
+
+    interval->set(tileWidth, tileHeight);
+    return true;
+}
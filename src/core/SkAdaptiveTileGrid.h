@@ -0,0 +1,78 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkAdaptiveTileGrid_DEFINED
+#define SkAdaptiveTileGrid_DEFINED
+
+#include "SkBBoxHierarchy.h"
+#include "SkSize.h"
+#include "SkTileGrid.h"
+
+/**
+ * Subclass of SkBBoxHierarchy for when the best way to cull isn't known until
+ * everything has been inserted. Insertions are held until the first flush or
+ * search, then the bounds of everything inserted are used to pick the tile
+ * interval of an SkTileGrid; if no interval suits them, an SkRTree is used
+ * instead. Everything held is then inserted into the hierarchy picked, and
+ * later calls are passed on to it.
+ *
+ * The grid is not aligned to any particular tiling of the queries, so its
+ * results are rounded out to the tiles each query touches.
+ */
+class SkAdaptiveTileGrid : public SkBBoxHierarchy {
+public:
+    SkAdaptiveTileGrid(int width, int height,
+                       SkTileGrid::SkTileGridNextDatumFunctionPtr nextDatumFunction);
+
+    virtual ~SkAdaptiveTileGrid();
+
+    virtual void insert(void* data, const SkIRect& bounds, bool defer = false) SK_OVERRIDE;
+
+    /**
+     * Picks the hierarchy to use, if it hasn't been yet, then inserts anything held into it
+     */
+    virtual void flushDeferredInserts() SK_OVERRIDE;
+
+    virtual void search(const SkIRect& query, SkTDArray<void*>* results) SK_OVERRIDE;
+
+    /**
+     * Forgets everything inserted, and the hierarchy picked for it
+     */
+    virtual void clear() SK_OVERRIDE;
+
+    virtual int getCount() const SK_OVERRIDE;
+
+    virtual void rewindInserts() SK_OVERRIDE;
+
+    /**
+     * Picks the tile interval of a grid over a width x height area for count
+     * elements with the given bounds: about twice the median size of the
+     * elements, so that most cover at most four tiles. Returns false if a
+     * grid would do poorly, because there are too few elements to be worth
+     * it or because so many elements are large that the grid would hold each
+     * many times over.
+     */
+    static bool ChooseTileInterval(const SkIRect bounds[], int count, int width, int height,
+                                   SkISize* interval);
+
+private:
+    struct Insert {
+        void* fData;
+        SkIRect fBounds;
+    };
+
+    void createHierarchy();
+
+    int fWidth, fHeight;
+    SkTileGrid::SkTileGridNextDatumFunctionPtr fNextDatumFunction;
+    SkTDArray<Insert> fInserts;
+    SkBBoxHierarchy* fHierarchy;
+
+    typedef SkBBoxHierarchy INHERITED;
+};
+
+#endif
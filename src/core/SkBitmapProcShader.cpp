@@ -92,6 +92,7 @@ bool SkBitmapProcShader::setContext(const SkBitmap& device,
 
     if (!fState.chooseProcs(this->getTotalInverse(), paint)) {
         fState.fOrigBitmap.unlockPixels();
+        fState.endContext();
         this->INHERITED::endContext();
         return false;
     }
@@ -142,6 +143,7 @@ bool SkBitmapProcShader::setContext(const SkBitmap& device,
 
 void SkBitmapProcShader::endContext() {
     fState.fOrigBitmap.unlockPixels();
+    fState.endContext();
     this->INHERITED::endContext();
 }
 
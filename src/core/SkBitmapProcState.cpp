@@ -6,9 +6,11 @@
  * found in the LICENSE file.
  */
 #include "SkBitmapProcState.h"
+#include "SkBitmapScaler.h"
 #include "SkColorPriv.h"
 #include "SkFilterProc.h"
 #include "SkPaint.h"
+#include "SkScaledImageCache.h"
 #include "SkShader.h"   // for tilemodes
 #include "SkUtilsArm.h"
 
@@ -81,6 +83,84 @@ static bool valid_for_filtering(unsigned dimension) {
     return (dimension & ~0x3FFF) == 0;
 }
 
+// Returns the size to resample srcSize pixels to when drawn with the inverse
+// scale invScale, or srcSize if they are not being shrunk.
+static int scaled_dimension(int srcSize, SkScalar invScale) {
+    invScale = SkScalarAbs(invScale);
+    if (invScale <= SK_Scalar1) {
+        return srcSize;
+    }
+    return SkMax32(1, SkScalarRoundToInt(SkScalarDiv(SkIntToScalar(srcSize), invScale)));
+}
+
+/*  When the paint asks for high quality filtering and the bitmap is being
+ *  shrunk by a scale/translate matrix, resample it to the size it is drawn at
+ *  with SkBitmapScaler, which weighs every source pixel rather than just the
+ *  four bilinear filtering reads. The result is cached, so redrawing the image
+ *  at that size costs no more than drawing it unscaled. Returns true and sets
+ *  fScaledBitmap, locked, if it resampled.
+ */
+bool SkBitmapProcState::possiblyScaleImage(const SkMatrix& inv, const SkPaint& paint) {
+    fScaledBitmap.reset();
+
+    if (!paint.isHighQualityFilterBitmap() ||
+        inv.getType() > (SkMatrix::kScale_Mask | SkMatrix::kTranslate_Mask) ||
+        // A8 bitmaps are coverage for the paint's color, not colors.
+        SkBitmap::kA8_Config == fOrigBitmap.config() ||
+        NULL == fOrigBitmap.getPixels()) {
+        return false;
+    }
+
+    int width = scaled_dimension(fOrigBitmap.width(), inv.getScaleX());
+    int height = scaled_dimension(fOrigBitmap.height(), inv.getScaleY());
+    if (width == fOrigBitmap.width() && height == fOrigBitmap.height()) {
+        return false;
+    }
+
+    if (!SkScaledImageCache::Find(fOrigBitmap, width, height, &fScaledBitmap)) {
+        if (!SkBitmapScaler::Resize(&fScaledBitmap, fOrigBitmap,
+                                    SkBitmapScaler::kLanczos3_ResizeMethod,
+                                    width, height)) {
+            fScaledBitmap.reset();
+            return false;
+        }
+        SkScaledImageCache::Add(fOrigBitmap, fScaledBitmap);
+    }
+    fScaledBitmap.lockPixels();
+    return true;
+}
+
+/*  Picks the mip level to sample from when the bitmap is minified, pointing
+ *  fMipBitmap at it, and returns its shift, or 0 to use the original. Mipmaps
+ *  the bitmap built itself are used as they always were. Otherwise only a high
+ *  quality draw that could not be resampled uses a mipmap, shared through
+ *  SkScaledImageCache with other bitmaps with the same pixels, so that what a
+ *  plain filtered draw gives does not depend on what is in the cache.
+ */
+int SkBitmapProcState::chooseMipLevel(const SkMatrix& m, const SkPaint& paint) {
+    const SkFixed sx = SkScalarToFixed(m.getScaleX());
+    const SkFixed sy = SkScalarToFixed(m.getSkewY());
+
+    if (fOrigBitmap.hasMipMap()) {
+        return fOrigBitmap.extractMipLevel(&fMipBitmap, sx, sy);
+    }
+    if (!paint.isHighQualityFilterBitmap() || (SkMipMap::ComputeLevel(sx, sy) >> 16) <= 0) {
+        return 0;
+    }
+
+    fMipMap.reset(SkScaledImageCache::FindMipMap(fOrigBitmap));
+    if (NULL == fMipMap.get()) {
+        fMipMap.reset(SkMipMap::Build(fOrigBitmap));
+        SkScaledImageCache::AddMipMap(fOrigBitmap, fMipMap.get());
+    }
+    return fMipMap.get() ? fMipMap->extractLevel(sx, sy, &fMipBitmap) : 0;
+}
+
+void SkBitmapProcState::endContext() {
+    fScaledBitmap.reset();
+    fMipMap.reset(NULL);
+}
+
 bool SkBitmapProcState::chooseProcs(const SkMatrix& inv, const SkPaint& paint) {
     if (fOrigBitmap.width() == 0 || fOrigBitmap.height() == 0) {
         return false;
@@ -100,11 +180,21 @@ bool SkBitmapProcState::chooseProcs(const SkMatrix& inv, const SkPaint& paint) {
     }
 
     fBitmap = &fOrigBitmap;
-    if (fOrigBitmap.hasMipMap()) {
-        int shift = fOrigBitmap.extractMipLevel(&fMipBitmap,
-                                                SkScalarToFixed(m->getScaleX()),
-                                                SkScalarToFixed(m->getSkewY()));
-
+    if (this->possiblyScaleImage(inv, paint)) {
+        // The unit matrix maps to [0, 1) whatever the bitmap's size, so only
+        // a pixel space inverse needs to land in the smaller bitmap.
+        if (m == &inv) {
+            fUnitInvMatrix = inv;
+            fUnitInvMatrix.postScale(
+                    SkScalarDiv(SkIntToScalar(fScaledBitmap.width()),
+                                SkIntToScalar(fOrigBitmap.width())),
+                    SkScalarDiv(SkIntToScalar(fScaledBitmap.height()),
+                                SkIntToScalar(fOrigBitmap.height())));
+            m = &fUnitInvMatrix;
+        }
+        fBitmap = &fScaledBitmap;
+    } else {
+        int shift = this->chooseMipLevel(*m, paint);
         if (shift > 0) {
             if (m != &fUnitInvMatrix) {
                 fUnitInvMatrix = *m;
@@ -158,7 +248,7 @@ bool SkBitmapProcState::chooseProcs(const SkMatrix& inv, const SkPaint& paint) {
     // of filtering if we're not scaled etc.).
     // note: we explicitly check inv, since m might be scaled due to unitinv
     //       trickery, but we don't want to see that for this test
-    fDoFilter = paint.isFilterBitmap() &&
+    fDoFilter = (paint.isFilterBitmap() || paint.isHighQualityFilterBitmap()) &&
                 (fInvType > SkMatrix::kTranslate_Mask &&
                  valid_for_filtering(fBitmap->width() | fBitmap->height()));
 
@@ -12,6 +12,7 @@
 
 #include "SkBitmap.h"
 #include "SkMatrix.h"
+#include "SkMipMap.h"
 
 #define FractionalInt_IS_64BIT
 
@@ -58,7 +59,7 @@ struct SkBitmapProcState {
     typedef U16CPU (*FixedTileLowBitsProc)(SkFixed, int);   // returns 0..0xF
     typedef U16CPU (*IntTileProc)(int value, int count);   // returns 0..count-1
 
-    const SkBitmap*     fBitmap;            // chooseProcs - orig or mip
+    const SkBitmap*     fBitmap;            // chooseProcs - orig, mip or scaled
     const SkMatrix*     fInvMatrix;         // chooseProcs
     SkMatrix::MapXYProc fInvProc;           // chooseProcs
 
@@ -134,8 +135,14 @@ private:
     SkMatrix            fUnitInvMatrix;     // chooseProcs
     SkBitmap            fOrigBitmap;        // CONSTRUCTOR
     SkBitmap            fMipBitmap;
+    SkBitmap            fScaledBitmap;      // chooseProcs - high quality resample
+    SkAutoTUnref<const SkMipMap> fMipMap;   // chooseProcs - owns fMipBitmap's pixels if shared
 
     MatrixProc chooseMatrixProc(bool trivial_matrix);
+    bool possiblyScaleImage(const SkMatrix& inv, const SkPaint&);
+    int chooseMipLevel(const SkMatrix& m, const SkPaint&);
+    // Releases what chooseProcs resampled or looked up.
+    void endContext();
     bool chooseProcs(const SkMatrix& inv, const SkPaint&);
     ShaderProc32 chooseShaderProc32();
 
@@ -192,5 +199,41 @@ void ClampX_ClampY_nofilter_affine(const SkBitmapProcState& s,
                                    uint32_t xy[], int count, int x, int y);
 void S32_D16_filter_DX(const SkBitmapProcState& s,
                                    const uint32_t* xy, int count, uint16_t* colors);
+void S16_opaque_D32_filter_DX(const SkBitmapProcState& s, const uint32_t xy[],
+                              int count, SkPMColor colors[]);
+void S16_alpha_D32_filter_DX(const SkBitmapProcState& s, const uint32_t xy[],
+                             int count, SkPMColor colors[]);
+void S16_opaque_D32_filter_DXDY(const SkBitmapProcState& s,
+                           const uint32_t xy[], int count, SkPMColor colors[]);
+void S16_alpha_D32_filter_DXDY(const SkBitmapProcState& s,
+                           const uint32_t xy[], int count, SkPMColor colors[]);
+void ClampX_ClampY_filter_persp(const SkBitmapProcState& s,
+                                uint32_t xy[], int count, int x, int y);
+void ClampX_ClampY_nofilter_persp(const SkBitmapProcState& s,
+                                  uint32_t xy[], int count, int x, int y);
+void RepeatX_RepeatY_nofilter_scale(const SkBitmapProcState& s,
+                                    uint32_t xy[], int count, int x, int y);
+void RepeatX_RepeatY_filter_scale(const SkBitmapProcState& s,
+                                  uint32_t xy[], int count, int x, int y);
+void RepeatX_RepeatY_nofilter_affine(const SkBitmapProcState& s,
+                                     uint32_t xy[], int count, int x, int y);
+void RepeatX_RepeatY_filter_affine(const SkBitmapProcState& s,
+                                   uint32_t xy[], int count, int x, int y);
+void RepeatX_RepeatY_nofilter_persp(const SkBitmapProcState& s,
+                                    uint32_t xy[], int count, int x, int y);
+void RepeatX_RepeatY_filter_persp(const SkBitmapProcState& s,
+                                  uint32_t xy[], int count, int x, int y);
+void GeneralXY_nofilter_scale(const SkBitmapProcState& s,
+                              uint32_t xy[], int count, int x, int y);
+void GeneralXY_filter_scale(const SkBitmapProcState& s,
+                            uint32_t xy[], int count, int x, int y);
+void GeneralXY_nofilter_affine(const SkBitmapProcState& s,
+                               uint32_t xy[], int count, int x, int y);
+void GeneralXY_filter_affine(const SkBitmapProcState& s,
+                             uint32_t xy[], int count, int x, int y);
+void GeneralXY_nofilter_persp(const SkBitmapProcState& s,
+                              uint32_t xy[], int count, int x, int y);
+void GeneralXY_filter_persp(const SkBitmapProcState& s,
+                            uint32_t xy[], int count, int x, int y);
 
 #endif
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkBitmapScaler.h"
+#include "SkConvolver.h"
+#include "SkFloatingPoint.h"
+#include "SkMath.h"
+#include "SkTDArray.h"
+
+// How far each filter reaches from its center, in output pixels.
+static float filter_support(SkBitmapScaler::ResizeMethod method) {
+    switch (method) {
+        case SkBitmapScaler::kBox_ResizeMethod:
+            return 0.5f;
+        case SkBitmapScaler::kMitchell_ResizeMethod:
+            return 2.0f;
+        case SkBitmapScaler::kLanczos3_ResizeMethod:
+            return 3.0f;
+    }
+    SkDEBUGFAIL("unknown resize method");
+    return 0.5f;
+}
+
+static float evaluate_box(float x) {
+    return (x >= -0.5f && x < 0.5f) ? 1.0f : 0.0f;
+}
+
+static float evaluate_mitchell(float x) {
+    static const float kB = 1.0f / 3;
+    static const float kC = 1.0f / 3;
+    x = sk_float_abs(x);
+    if (x < 1) {
+        return ((12 - 9 * kB - 6 * kC) * x * x * x +
+                (-18 + 12 * kB + 6 * kC) * x * x +
+                (6 - 2 * kB)) / 6;
+    }
+    if (x < 2) {
+        return ((-kB - 6 * kC) * x * x * x +
+                (6 * kB + 30 * kC) * x * x +
+                (-12 * kB - 48 * kC) * x +
+                (8 * kB + 24 * kC)) / 6;
+    }
+    return 0;
+}
+
+static float evaluate_lanczos3(float x) {
+    if (x <= -3 || x >= 3) {
+        return 0;
+    }
+    if (x > -FLT_EPSILON && x < FLT_EPSILON) {
+        return 1;
+    }
+    float xpi = x * SK_ScalarPI;
+    return (sk_float_sin(xpi) / xpi) * sk_float_sin(xpi / 3) / (xpi / 3);
+}
+
+static float evaluate(SkBitmapScaler::ResizeMethod method, float x) {
+    switch (method) {
+        case SkBitmapScaler::kBox_ResizeMethod:
+            return evaluate_box(x);
+        case SkBitmapScaler::kMitchell_ResizeMethod:
+            return evaluate_mitchell(x);
+        case SkBitmapScaler::kLanczos3_ResizeMethod:
+            return evaluate_lanczos3(x);
+    }
+    return 0;
+}
+
+void SkBitmapScaler::BuildFilter(ResizeMethod method, int srcSize, int destSize,
+                                 SkConvolutionFilter1D* filter) {
+    const float scale = (float)destSize / srcSize;
+    // When downscaling, the filter is stretched to cover every source pixel
+    // that lands in an output pixel. It keeps its own size when upscaling.
+    const float clampedScale = scale < 1 ? scale : 1.0f;
+    const float srcSupport = filter_support(method) / clampedScale;
+    const float invScale = 1 / scale;
+
+    SkTDArray<float> weights;
+    SkTDArray<SkConvolutionFilter1D::ConvolutionFixed> fixedWeights;
+    for (int destI = 0; destI < destSize; ++destI) {
+        // The center of output pixel destI, in source pixels.
+        const float srcCenter = (destI + 0.5f) * invScale;
+        int srcBegin = SkMax32(0, sk_float_floor2int(srcCenter - srcSupport));
+        int srcEnd = SkMin32(srcSize - 1, sk_float_ceil2int(srcCenter + srcSupport));
+
+        weights.reset();
+        float sum = 0;
+        for (int srcI = srcBegin; srcI <= srcEnd; ++srcI) {
+            float weight = evaluate(method, ((srcI + 0.5f) - srcCenter) * clampedScale);
+            *weights.append() = weight;
+            sum += weight;
+        }
+        if (0 == sum) {
+            // Nothing fell under the filter; take the nearest pixel.
+            srcBegin = SkClampMax(sk_float_floor2int(srcCenter), srcSize - 1);
+            weights.reset();
+            *weights.append() = 1;
+            sum = 1;
+        }
+
+        // Normalize, so that the weights sum to exactly one in fixed point,
+        // putting what rounding loses in the middle.
+        fixedWeights.setCount(weights.count());
+        int fixedSum = 0;
+        for (int i = 0; i < weights.count(); ++i) {
+            fixedWeights[i] = SkConvolutionFilter1D::FloatToFixed(weights[i] / sum);
+            fixedSum += fixedWeights[i];
+        }
+        fixedWeights[weights.count() / 2] += (1 << SkConvolutionFilter1D::kShiftBits) - fixedSum;
+
+        filter->addFilter(srcBegin, fixedWeights.begin(), fixedWeights.count());
+    }
+}
+
+bool SkBitmapScaler::Resize(SkBitmap* result, const SkBitmap& source, ResizeMethod method,
+                            int destWidth, int destHeight, SkBitmap::Allocator* allocator) {
+    if (destWidth < 1 || destHeight < 1 || source.width() < 1 || source.height() < 1) {
+        return false;
+    }
+
+    SkBitmap converted;
+    const SkBitmap* src = &source;
+    if (SkBitmap::kARGB_8888_Config != source.config()) {
+        if (!source.copyTo(&converted, SkBitmap::kARGB_8888_Config)) {
+            return false;
+        }
+        src = &converted;
+    }
+    SkAutoLockPixels srcLock(*src);
+    if (!src->readyToDraw()) {
+        return false;
+    }
+
+    SkConvolutionFilter1D filterX, filterY;
+    BuildFilter(method, src->width(), destWidth, &filterX);
+    if (src->width() != src->height() || destWidth != destHeight) {
+        BuildFilter(method, src->height(), destHeight, &filterY);
+    }
+    const SkConvolutionFilter1D& yFilter = filterY.numValues() > 0 ? filterY : filterX;
+
+    SkBitmap dst;
+    dst.setConfig(SkBitmap::kARGB_8888_Config, destWidth, destHeight);
+    if (!dst.allocPixels(allocator, NULL)) {
+        return false;
+    }
+    SkAutoLockPixels dstLock(dst);
+    SkBGRAConvolve2D(src->getAddr32(0, 0), src->rowBytes(), filterX, yFilter,
+                     dst.getAddr32(0, 0), dst.rowBytes());
+    dst.setIsOpaque(src->isOpaque());
+    result->swap(dst);
+    return true;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkBitmapScaler_DEFINED
+#define SkBitmapScaler_DEFINED
+
+#include "SkBitmap.h"
+
+class SkConvolutionFilter1D;
+
+/**
+ *  Resamples bitmaps to another size with a separable filter. Each output
+ *  pixel is the weighted sum of the source pixels under the filter, which is
+ *  widened by the downscaling factor so that every source pixel contributes,
+ *  rather than aliasing as bilinear sampling does.
+ */
+class SkBitmapScaler {
+public:
+    enum ResizeMethod {
+        // Averages the source pixels each output pixel covers. Cheapest, but
+        // blurs and loses fine detail.
+        kBox_ResizeMethod,
+
+        // Mitchell-Netravali cubic with B = C = 1/3: smooth, with little
+        // ringing.
+        kMitchell_ResizeMethod,
+
+        // Windowed sinc with three lobes: the sharpest, at the cost of some
+        // ringing next to hard edges.
+        kLanczos3_ResizeMethod,
+
+        kLast_ResizeMethod = kLanczos3_ResizeMethod
+    };
+
+    /**
+     *  Sets result to source resampled to destWidth x destHeight with the
+     *  given method, as premultiplied 8888 pixels allocated with allocator,
+     *  or the default allocator if NULL. Sources in other configs are
+     *  converted first. Returns false if either size is empty, or if the
+     *  source can't be read or the result allocated.
+     */
+    static bool Resize(SkBitmap* result, const SkBitmap& source, ResizeMethod method,
+                       int destWidth, int destHeight, SkBitmap::Allocator* allocator = NULL);
+
+    /**
+     *  Fills filter with the weights that resample srcSize pixels to destSize
+     *  pixels along one axis with the given method.
+     */
+    static void BuildFilter(ResizeMethod method, int srcSize, int destSize,
+                            SkConvolutionFilter1D* filter);
+};
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkBoxBlurProcs_DEFINED
+#define SkBoxBlurProcs_DEFINED
+
+#include "SkColor.h"
+
+/*  One pass of a separable box blur. Each proc blurs rows [startY, stopY) of
+ *  a width x height source along X. If transpose is true, the blurred row y is
+ *  written as column y of dst, so that the next pass can blur the other
+ *  direction while still reading contiguous memory.
+ *
+ *  The A8 procs are the mask blurs used by SkBlurMask: the kernel reaches
+ *  leftRadius pixels to the left and rightRadius pixels to the right, and each
+ *  output row is newWidth = width + 2 * max(leftRadius, rightRadius) pixels.
+ *  Rows are newWidth apart in dst, and columns are height apart when
+ *  transposing. The interp variant blurs with a non-integer radius: it blends
+ *  the kernels of radius and radius - 1 by outerWeight / 255.
+ *
+ *  The 32-bit proc is the image blur used by SkBlurImageFilter: the kernel
+ *  sums the leftOffset pixels to the left of each pixel, the pixel itself and
+ *  the rightOffset pixels to its right (treating pixels off the row as 0), and
+ *  divides by kernelSize. Output rows are width pixels, and rows (or columns,
+ *  when transposing) are dstRowPixels apart in dst.
+ *
+ *  Each output value is (sum * scale + half) >> 24, with scale the 8.24
+ *  reciprocal of the kernel size; platform procs must match that exactly.
+ */
+typedef void (*SkBoxBlurA8Proc)(const uint8_t* src, int srcRowBytes, uint8_t* dst,
+                                int leftRadius, int rightRadius, int width, int height,
+                                bool transpose, int startY, int stopY);
+typedef void (*SkBoxBlurInterpA8Proc)(const uint8_t* src, int srcRowBytes, uint8_t* dst,
+                                      int radius, int width, int height, bool transpose,
+                                      uint8_t outerWeight, int startY, int stopY);
+typedef void (*SkBoxBlur32Proc)(const SkPMColor* src, int srcRowPixels, SkPMColor* dst,
+                                int dstRowPixels, int kernelSize, int leftOffset,
+                                int rightOffset, int width, int height, bool transpose,
+                                int startY, int stopY);
+
+struct SkBoxBlurProcs {
+    SkBoxBlurA8Proc       fA8;
+    SkBoxBlurInterpA8Proc fInterpA8;
+    SkBoxBlur32Proc       f32;
+};
+
+/**
+ *  Fills in procs with the platform's SIMD versions and returns true, or
+ *  returns false if the platform has nothing faster than the portable procs
+ *  in SkBlurMask.cpp. Implemented in src/opts.
+ */
+bool SkBoxBlurGetPlatformProcs(SkBoxBlurProcs* procs);
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkConvolver.h"
+#include "SkColorPriv.h"
+#include "SkMath.h"
+#include "SkTemplates.h"
+
+SkConvolutionFilter1D::SkConvolutionFilter1D()
+    : fMaxFilter(0) {
+}
+
+void SkConvolutionFilter1D::addFilter(int offset, const ConvolutionFixed weights[], int length) {
+    // Zero weights at the ends cost time without changing anything.
+    int first = 0;
+    while (first < length && 0 == weights[first]) {
+        ++first;
+    }
+    int last = length - 1;
+    while (last >= first && 0 == weights[last]) {
+        --last;
+    }
+
+    FilterInstance* filter = fFilters.append();
+    filter->fDataLocation = fWeights.count();
+    if (first <= last) {
+        filter->fOffset = offset + first;
+        filter->fLength = last - first + 1;
+        fWeights.append(filter->fLength, weights + first);
+    } else {
+        filter->fOffset = offset;
+        filter->fLength = 0;
+    }
+    fMaxFilter = SkMax32(fMaxFilter, filter->fLength);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static const int kHalf = 1 << (SkConvolutionFilter1D::kShiftBits - 1);
+
+static inline unsigned clamp_channel(int32_t sum) {
+    return SkClampMax((sum + kHalf) >> SkConvolutionFilter1D::kShiftBits, 255);
+}
+
+static void convolve_horizontally(const SkPMColor* src, const SkConvolutionFilter1D& filter,
+                                  SkPMColor* dst) {
+    for (int x = 0; x < filter.numValues(); ++x) {
+        int offset, length;
+        const SkConvolutionFilter1D::ConvolutionFixed* weights =
+            filter.filterAt(x, &offset, &length);
+        const SkPMColor* row = src + offset;
+
+        int32_t sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+        for (int i = 0; i < length; ++i) {
+            SkPMColor c = row[i];
+            int32_t w = weights[i];
+            sum0 += w * (int32_t)(c & 0xFF);
+            sum1 += w * (int32_t)((c >> 8) & 0xFF);
+            sum2 += w * (int32_t)((c >> 16) & 0xFF);
+            sum3 += w * (int32_t)(c >> 24);
+        }
+        dst[x] = clamp_channel(sum0) | (clamp_channel(sum1) << 8) |
+                 (clamp_channel(sum2) << 16) | (clamp_channel(sum3) << 24);
+    }
+}
+
+static void convolve_vertically(const SkConvolutionFilter1D::ConvolutionFixed weights[],
+                                int length, const SkPMColor* const rows[], int width,
+                                SkPMColor* dst) {
+    for (int x = 0; x < width; ++x) {
+        int32_t sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+        for (int i = 0; i < length; ++i) {
+            SkPMColor c = rows[i][x];
+            int32_t w = weights[i];
+            sum0 += w * (int32_t)(c & 0xFF);
+            sum1 += w * (int32_t)((c >> 8) & 0xFF);
+            sum2 += w * (int32_t)((c >> 16) & 0xFF);
+            sum3 += w * (int32_t)(c >> 24);
+        }
+        SkPMColor c = clamp_channel(sum0) | (clamp_channel(sum1) << 8) |
+                      (clamp_channel(sum2) << 16) | (clamp_channel(sum3) << 24);
+
+        // Negative lobes can leave a color channel above alpha.
+        unsigned a = SkGetPackedA32(c);
+        dst[x] = SkPackARGB32NoCheck(a, SkMin32(SkGetPackedR32(c), a),
+                                     SkMin32(SkGetPackedG32(c), a),
+                                     SkMin32(SkGetPackedB32(c), a));
+    }
+}
+
+static SkConvolutionProcs convolution_procs_factory() {
+    SkConvolutionProcs procs;
+    if (!SkConvolutionGetPlatformProcs(&procs)) {
+        procs.fConvolveHorizontally = convolve_horizontally;
+        procs.fConvolveVertically = convolve_vertically;
+    }
+    return procs;
+}
+
+static const SkConvolutionProcs& convolution_procs() {
+    static const SkConvolutionProcs gProcs = convolution_procs_factory();
+    return gProcs;
+}
+
+void SkBGRAConvolve2D(const SkPMColor* src, size_t srcRowBytes,
+                      const SkConvolutionFilter1D& filterX,
+                      const SkConvolutionFilter1D& filterY,
+                      SkPMColor* dst, size_t dstRowBytes) {
+    const SkConvolutionProcs& procs = convolution_procs();
+    const int width = filterX.numValues();
+    const int height = filterY.numValues();
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    // Source row y is convolved into ring row y % ringRows. The rows one
+    // output row reads are no further apart than the longest filter, and
+    // vertical filters never move back up, so rows are only overwritten once
+    // no later output row needs them.
+    const int ringRows = SkMax32(filterY.maxFilter(), 1);
+    SkAutoTMalloc<SkPMColor> ring(width * ringRows);
+    SkAutoTMalloc<const SkPMColor*> rows(ringRows);
+    int nextSrcRow = 0;
+
+    for (int y = 0; y < height; ++y) {
+        int offset, length;
+        const SkConvolutionFilter1D::ConvolutionFixed* weights =
+            filterY.filterAt(y, &offset, &length);
+        SkASSERT(offset >= nextSrcRow - ringRows);
+
+        nextSrcRow = SkMax32(nextSrcRow, offset);
+        while (nextSrcRow < offset + length) {
+            const SkPMColor* srcRow = (const SkPMColor*)((const char*)src +
+                                                         nextSrcRow * srcRowBytes);
+            procs.fConvolveHorizontally(srcRow, filterX,
+                                        ring.get() + (nextSrcRow % ringRows) * width);
+            ++nextSrcRow;
+        }
+
+        for (int i = 0; i < length; ++i) {
+            rows[i] = ring.get() + ((offset + i) % ringRows) * width;
+        }
+        SkPMColor* dstRow = (SkPMColor*)((char*)dst + y * dstRowBytes);
+        if (length > 0) {
+            procs.fConvolveVertically(weights, length, rows.get(), width, dstRow);
+        } else {
+            sk_bzero(dstRow, width * sizeof(SkPMColor));
+        }
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkConvolver_DEFINED
+#define SkConvolver_DEFINED
+
+#include "SkColor.h"
+#include "SkTDArray.h"
+
+/**
+ *  One axis of a separable resampling filter. For each output pixel it holds
+ *  the offset of the first input pixel the output reads, and the weights of
+ *  that input pixel and the ones after it. Weights are 2.14 fixed point.
+ */
+class SkConvolutionFilter1D {
+public:
+    typedef int16_t ConvolutionFixed;
+
+    static const int kShiftBits = 14;
+
+    static ConvolutionFixed FloatToFixed(float value) {
+        return static_cast<ConvolutionFixed>(value * (1 << kShiftBits));
+    }
+
+    SkConvolutionFilter1D();
+
+    /**
+     *  Appends the filter of the next output pixel, which reads the length
+     *  input pixels from offset on. Zero weights at either end are trimmed.
+     */
+    void addFilter(int offset, const ConvolutionFixed weights[], int length);
+
+    /** Returns the number of output pixels. */
+    int numValues() const { return fFilters.count(); }
+
+    /** Returns the length of the longest filter. */
+    int maxFilter() const { return fMaxFilter; }
+
+    /**
+     *  Returns the weights of output pixel index, and sets the offset of the
+     *  first input pixel they apply to and their number. The weights may be
+     *  NULL if length is 0.
+     */
+    const ConvolutionFixed* filterAt(int index, int* offset, int* length) const {
+        const FilterInstance& filter = fFilters[index];
+        *offset = filter.fOffset;
+        *length = filter.fLength;
+        return filter.fLength > 0 ? &fWeights[filter.fDataLocation] : NULL;
+    }
+
+private:
+    struct FilterInstance {
+        int fDataLocation;  // index of the first weight in fWeights
+        int fOffset;
+        int fLength;
+    };
+
+    SkTDArray<FilterInstance>   fFilters;
+    SkTDArray<ConvolutionFixed> fWeights;
+    int                         fMaxFilter;
+};
+
+/*  The passes of a separable convolution of premultiplied 32-bit pixels. All
+ *  four channels are convolved alike, and each output channel is the rounded
+ *  sum of the weighted inputs, clamped to [0, 255].
+ *
+ *  The horizontal proc convolves one row with filter, writing
+ *  filter.numValues() pixels to dst.
+ *
+ *  The vertical proc sums the length rows in rows[], weighted by weights, into
+ *  the width pixels of dst. It also clamps each color channel to the alpha,
+ *  since filters with negative weights can make colors that are not
+ *  premultiplied.
+ *
+ *  Platform procs must give the same results as the portable ones.
+ */
+typedef void (*SkConvolveHorizontallyProc)(const SkPMColor* src,
+                                           const SkConvolutionFilter1D& filter,
+                                           SkPMColor* dst);
+typedef void (*SkConvolveVerticallyProc)(const SkConvolutionFilter1D::ConvolutionFixed weights[],
+                                         int length, const SkPMColor* const rows[], int width,
+                                         SkPMColor* dst);
+
+struct SkConvolutionProcs {
+    SkConvolveHorizontallyProc fConvolveHorizontally;
+    SkConvolveVerticallyProc   fConvolveVertically;
+};
+
+/**
+ *  Fills in procs with the platform's SIMD versions and returns true, or
+ *  returns false if the platform has nothing faster than the portable procs
+ *  in SkConvolver.cpp. Implemented in src/opts.
+ */
+bool SkConvolutionGetPlatformProcs(SkConvolutionProcs* procs);
+
+/**
+ *  Resamples src with filterX across and filterY down, writing
+ *  filterX.numValues() x filterY.numValues() pixels to dst. The filters must
+ *  not read outside src. Each source row is convolved horizontally once, into
+ *  a ring of rows as tall as the longest vertical filter.
+ */
+void SkBGRAConvolve2D(const SkPMColor* src, size_t srcRowBytes,
+                      const SkConvolutionFilter1D& filterX,
+                      const SkConvolutionFilter1D& filterY,
+                      SkPMColor* dst, size_t dstRowBytes);
+
+#endif
@@ -173,7 +173,9 @@ void SkDeque::pop_front() {
         fFront = first->fBegin;
     } else {
         first->fBegin = first->fEnd = NULL;  // mark as empty
-        if (NULL == first->fNext) {
+        // The next block may have been emptied by pop_back() and still be
+        // linked in, so check the count rather than the block list.
+        if (0 == fCount) {
             fFront = fBack = NULL;
         } else {
             SkASSERT(NULL != first->fNext->fBegin);
@@ -207,7 +209,9 @@ void SkDeque::pop_back() {
         fBack = last->fEnd - fElemSize;
     } else {
         last->fBegin = last->fEnd = NULL;    // mark as empty
-        if (NULL == last->fPrev) {
+        // The previous block may have been emptied by pop_front() and still
+        // be linked in, so check the count rather than the block list.
+        if (0 == fCount) {
             fFront = fBack = NULL;
         } else {
             SkASSERT(NULL != last->fPrev->fEnd);
@@ -18,6 +18,7 @@
 #include "SkPathEffect.h"
 #include "SkRasterClip.h"
 #include "SkRasterizer.h"
+#include "SkRTConf.h"
 #include "SkScan.h"
 #include "SkShader.h"
 #include "SkString.h"
@@ -1005,6 +1006,10 @@ bool SkDrawTreatAsHairline(const SkPaint& paint, const SkMatrix& matrix,
     return false;
 }
 
+SK_CONF_DECLARE(bool, c_analyticAA, "raster.analyticAA", false,
+                "Antialias all path fills by exact area coverage, as if every paint "
+                "had kAnalyticAA_Flag set.");
+
 void SkDraw::drawPath(const SkPath& origSrcPath, const SkPaint& origPaint,
                       const SkMatrix* prePathMatrix, bool pathIsMutable) const {
     SkDEBUGCODE(this->validate();)
@@ -1114,7 +1119,11 @@ void SkDraw::drawPath(const SkPath& origSrcPath, const SkPaint& origPaint,
     void (*proc)(const SkPath&, const SkRasterClip&, SkBlitter*);
     if (doFill) {
         if (paint->isAntiAlias()) {
-            proc = SkScan::AntiFillPath;
+            if (paint->isAnalyticAA() || c_analyticAA) {
+                proc = SkScan::AnalyticFillPath;
+            } else {
+                proc = SkScan::AntiFillPath;
+            }
         } else {
             proc = SkScan::FillPath;
         }
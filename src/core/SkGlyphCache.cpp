@@ -64,6 +64,16 @@ SkGlyphCache::SkGlyphCache(SkTypeface* typeface, const SkDescriptor* desc)
     fScalerContext = typeface->createScalerContext(desc);
     fScalerContext->getFontMetrics(NULL, &fFontMetricsY);
 
+    fStoreStrike = NULL;
+    fGlyphStore = SkGlyphStore::RefGlobal();
+    if (fGlyphStore) {
+        fStoreStrike = fGlyphStore->findStrike(typeface, desc);
+        if (NULL == fStoreStrike) {
+            fGlyphStore->unref();
+            fGlyphStore = NULL;
+        }
+    }
+
     // init to 0 so that all of the pointers will be null
     memset(fGlyphHash, 0, sizeof(fGlyphHash));
     // init with 0xFF so that the charCode field will be -1, which is invalid
@@ -90,6 +100,7 @@ SkGlyphCache::~SkGlyphCache() {
     }
     SkDescriptor::Free(fDesc);
     SkDELETE(fScalerContext);
+    SkSafeUnref(fGlyphStore);
     this->invokeAndRemoveAuxProcs();
 }
 
@@ -300,7 +311,16 @@ const void* SkGlyphCache::findImage(const SkGlyph& glyph) {
                                         SkChunkAlloc::kReturnNil_AllocFailType);
             // check that alloc() actually succeeded
             if (glyph.fImage) {
-                fScalerContext->getImage(glyph);
+                // ask the persistent store before paying for the scaler
+                if (NULL == fGlyphStore || !fGlyphStore->readImage(fStoreStrike, glyph)) {
+                    uint8_t format = glyph.fMaskFormat;
+                    fScalerContext->getImage(glyph);
+                    // if the scaler changed the format, the image doesn't
+                    // match the metrics we'd look it up by next time
+                    if (fGlyphStore && format == glyph.fMaskFormat) {
+                        fGlyphStore->addImage(fStoreStrike, glyph);
+                    }
+                }
                 // TODO: the scaler may have changed the maskformat during
                 // getImage (e.g. from AA or LCD to BW) which means we may have
                 // overallocated the buffer. Check if the new computedImageSize
@@ -397,27 +417,44 @@ void SkGlyphCache::invokeAndRemoveAuxProcs() {
     }
 #endif
 
+/*  The shared cache is split into shards, each with its own list of strikes,
+    its own mutex and its own share of the font cache limit. A descriptor always
+    maps to the same shard, so threads working with different strikes rarely
+    contend for the same mutex. Each shard purges on its own, and always keeps
+    the strike it just attached, so the limit should leave every shard room for
+    a few strikes. The thread-local cache has a single shard and no mutex.
+*/
+#define SHARED_SHARD_BITCOUNT   3
+#define SHARED_SHARD_COUNT      (1 << SHARED_SHARD_BITCOUNT)
+
+static unsigned desc_to_shardindex(const SkDescriptor* desc) {
+    // Take the shard from the high bits of a mixed checksum, so that it is
+    // independent of the low bits used by desc_to_hashindex.
+    uint32_t n = desc->getChecksum();
+    n ^= n >> 16;
+    n *= 0x85EBCA6B;
+    n ^= n >> 13;
+    n *= 0xC2B2AE35;
+    n ^= n >> 16;
+    return n >> (32 - SHARED_SHARD_BITCOUNT);
+}
+
 #include "SkThread.h"
 
-class SkGlyphCache_Globals {
+class SkGlyphCache_Shard {
 public:
-    enum UseMutex {
-        kNo_UseMutex,  // thread-local cache
-        kYes_UseMutex  // shared cache
-    };
-
-    SkGlyphCache_Globals(UseMutex um) {
+    SkGlyphCache_Shard() {
+        fMutex = NULL;
         fHead = NULL;
         fTotalMemoryUsed = 0;
-        fFontCacheLimit = SK_DEFAULT_FONT_CACHE_LIMIT;
-        fMutex = (kYes_UseMutex == um) ? SkNEW(SkMutex) : NULL;
+        fMemoryLimit = 0;
 
 #ifdef USE_CACHE_HASH
         sk_bzero(fHash, sizeof(fHash));
 #endif
     }
 
-    ~SkGlyphCache_Globals() {
+    ~SkGlyphCache_Shard() {
         SkGlyphCache* cache = fHead;
         while (cache) {
             SkGlyphCache* next = cache->fNext;
@@ -428,9 +465,10 @@ public:
         SkDELETE(fMutex);
     }
 
-    SkMutex*        fMutex;
+    SkMutex*        fMutex;         // NULL for the thread-local cache
     SkGlyphCache*   fHead;
     size_t          fTotalMemoryUsed;
+    size_t          fMemoryLimit;   // this shard's share of the font cache limit
 #ifdef USE_CACHE_HASH
     SkGlyphCache*   fHash[HASH_COUNT];
 #endif
@@ -440,6 +478,39 @@ public:
 #else
     void validate() const {}
 #endif
+};
+
+class SkGlyphCache_Globals {
+public:
+    enum UseMutex {
+        kNo_UseMutex,  // thread-local cache
+        kYes_UseMutex  // shared cache
+    };
+
+    SkGlyphCache_Globals(UseMutex um) {
+        fShardCount = (kYes_UseMutex == um) ? SHARED_SHARD_COUNT : 1;
+        fShards = SkNEW_ARRAY(SkGlyphCache_Shard, fShardCount);
+        for (int i = 0; i < fShardCount; ++i) {
+            fShards[i].fMutex = (kYes_UseMutex == um) ? SkNEW(SkMutex) : NULL;
+        }
+        fFontCacheLimit = SK_DEFAULT_FONT_CACHE_LIMIT;
+        this->setShardLimits();
+    }
+
+    ~SkGlyphCache_Globals() {
+        SkDELETE_ARRAY(fShards);
+    }
+
+    int                 shardCount() const { return fShardCount; }
+    SkGlyphCache_Shard& shard(int index) { return fShards[index]; }
+
+    SkGlyphCache_Shard& shardFor(const SkDescriptor* desc) {
+        return fShards[1 == fShardCount ? 0 : desc_to_shardindex(desc)];
+    }
+
+    // Sums the shards without locking them, so this is only approximate
+    // while other threads are using the cache.
+    size_t  getTotalMemoryUsed() const;
 
     size_t  getFontCacheLimit() const { return fFontCacheLimit; }
     size_t  setFontCacheLimit(size_t limit);
@@ -457,7 +528,13 @@ public:
     static void DeleteTLS() { SkTLS::Delete(CreateTLS); }
 
 private:
-    size_t  fFontCacheLimit;
+    SkGlyphCache_Shard* fShards;
+    int                 fShardCount;
+    size_t              fFontCacheLimit;
+
+    // Splits fFontCacheLimit evenly across the shards, purging any shard
+    // that is now over its share.
+    void setShardLimits();
 
     static void* CreateTLS() {
         return SkNEW_ARGS(SkGlyphCache_Globals, (kNo_UseMutex));
@@ -468,6 +545,28 @@ private:
     }
 };
 
+size_t SkGlyphCache_Globals::getTotalMemoryUsed() const {
+    size_t total = 0;
+    for (int i = 0; i < fShardCount; ++i) {
+        total += fShards[i].fTotalMemoryUsed;
+    }
+    return total;
+}
+
+void SkGlyphCache_Globals::setShardLimits() {
+    size_t shardLimit = fFontCacheLimit / fShardCount;
+    for (int i = 0; i < fShardCount; ++i) {
+        SkGlyphCache_Shard& shard = fShards[i];
+        SkAutoMutexAcquire  ac(shard.fMutex);
+
+        shard.fMemoryLimit = shardLimit;
+        if (shard.fTotalMemoryUsed > shardLimit) {
+            SkGlyphCache::InternalFreeCache(&shard,
+                                            shard.fTotalMemoryUsed - shardLimit);
+        }
+    }
+}
+
 size_t SkGlyphCache_Globals::setFontCacheLimit(size_t newLimit) {
     static const size_t minLimit = 256 * 1024;
     if (newLimit < minLimit) {
@@ -476,18 +575,16 @@ size_t SkGlyphCache_Globals::setFontCacheLimit(size_t newLimit) {
 
     size_t prevLimit = fFontCacheLimit;
     fFontCacheLimit = newLimit;
-
-    size_t currUsed = fTotalMemoryUsed;
-    if (currUsed > newLimit) {
-        SkAutoMutexAcquire    ac(fMutex);
-        SkGlyphCache::InternalFreeCache(this, currUsed - newLimit);
-    }
+    this->setShardLimits();
     return prevLimit;
 }
 
 void SkGlyphCache_Globals::purgeAll() {
-    SkAutoMutexAcquire    ac(fMutex);
-    SkGlyphCache::InternalFreeCache(this, fTotalMemoryUsed);
+    for (int i = 0; i < fShardCount; ++i) {
+        SkGlyphCache_Shard& shard = fShards[i];
+        SkAutoMutexAcquire  ac(shard.fMutex);
+        SkGlyphCache::InternalFreeCache(&shard, shard.fTotalMemoryUsed);
+    }
 }
 
 // Returns the shared globals
@@ -507,18 +604,25 @@ static SkGlyphCache_Globals& getGlobals() {
 void SkGlyphCache::VisitAllCaches(bool (*proc)(SkGlyphCache*, void*),
                                   void* context) {
     SkGlyphCache_Globals& globals = getGlobals();
-    SkAutoMutexAcquire    ac(globals.fMutex);
-    SkGlyphCache*         cache;
 
-    globals.validate();
+    // Only one shard is locked at a time, so the visit is not an atomic
+    // snapshot of the whole cache.
+    for (int i = 0; i < globals.shardCount(); ++i) {
+        SkGlyphCache_Shard& shard = globals.shard(i);
+        SkAutoMutexAcquire  ac(shard.fMutex);
+        SkGlyphCache*       cache;
 
-    for (cache = globals.fHead; cache != NULL; cache = cache->fNext) {
-        if (proc(cache, context)) {
-            break;
+        shard.validate();
+
+        for (cache = shard.fHead; cache != NULL; cache = cache->fNext) {
+            if (proc(cache, context)) {
+                shard.validate();
+                return;
+            }
         }
-    }
 
-    globals.validate();
+        shard.validate();
+    }
 }
 
 /*  This guy calls the visitor from within the mutext lock, so the visitor
@@ -536,26 +640,26 @@ SkGlyphCache* SkGlyphCache::VisitCache(SkTypeface* typeface,
     }
     SkASSERT(desc);
 
-    SkGlyphCache_Globals& globals = getGlobals();
-    SkAutoMutexAcquire    ac(globals.fMutex);
-    SkGlyphCache*         cache;
-    bool                  insideMutex = true;
+    SkGlyphCache_Shard& shard = getGlobals().shardFor(desc);
+    SkAutoMutexAcquire  ac(shard.fMutex);
+    SkGlyphCache*       cache;
+    bool                insideMutex = true;
 
-    globals.validate();
+    shard.validate();
 
 #ifdef USE_CACHE_HASH
-    SkGlyphCache** hash = globals.fHash;
+    SkGlyphCache** hash = shard.fHash;
     unsigned index = desc_to_hashindex(desc);
     cache = hash[index];
     if (cache && *cache->fDesc == *desc) {
-        cache->detach(&globals.fHead);
+        cache->detach(&shard.fHead);
         goto FOUND_IT;
     }
 #endif
 
-    for (cache = globals.fHead; cache != NULL; cache = cache->fNext) {
+    for (cache = shard.fHead; cache != NULL; cache = cache->fNext) {
         if (cache->fDesc->equals(*desc)) {
-            cache->detach(&globals.fHead);
+            cache->detach(&shard.fHead);
             goto FOUND_IT;
         }
     }
@@ -564,7 +668,7 @@ SkGlyphCache* SkGlyphCache::VisitCache(SkTypeface* typeface,
         side-effects like trying to access the cache/mutex (yikes!)
     */
     ac.release();           // release the mutex now
-    insideMutex = false;    // can't use globals anymore
+    insideMutex = false;    // can't use the shard anymore
 
     cache = SkNEW_ARGS(SkGlyphCache, (typeface, desc));
 
@@ -574,15 +678,15 @@ FOUND_IT:
 
     if (proc(cache, context)) {   // stay detached
         if (insideMutex) {
-            SkASSERT(globals.fTotalMemoryUsed >= cache->fMemoryUsed);
-            globals.fTotalMemoryUsed -= cache->fMemoryUsed;
+            SkASSERT(shard.fTotalMemoryUsed >= cache->fMemoryUsed);
+            shard.fTotalMemoryUsed -= cache->fMemoryUsed;
 #ifdef USE_CACHE_HASH
             hash[index] = NULL;
 #endif
         }
     } else {                        // reattach
         if (insideMutex) {
-            cache->attachToHead(&globals.fHead);
+            cache->attachToHead(&shard.fHead);
 #ifdef USE_CACHE_HASH
             hash[index] = cache;
 #endif
@@ -598,31 +702,31 @@ void SkGlyphCache::AttachCache(SkGlyphCache* cache) {
     SkASSERT(cache);
     SkASSERT(cache->fNext == NULL);
 
-    SkGlyphCache_Globals& globals = getGlobals();
-    SkAutoMutexAcquire    ac(globals.fMutex);
+    SkGlyphCache_Shard& shard = getGlobals().shardFor(cache->fDesc);
+    SkAutoMutexAcquire  ac(shard.fMutex);
 
-    globals.validate();
+    shard.validate();
     cache->validate();
 
     // if we have a fixed budget for our cache, do a purge here
     {
-        size_t allocated = globals.fTotalMemoryUsed + cache->fMemoryUsed;
-        size_t budgeted = globals.getFontCacheLimit();
+        size_t allocated = shard.fTotalMemoryUsed + cache->fMemoryUsed;
+        size_t budgeted = shard.fMemoryLimit;
         if (allocated > budgeted) {
-            (void)InternalFreeCache(&globals, allocated - budgeted);
+            (void)InternalFreeCache(&shard, allocated - budgeted);
         }
     }
 
-    cache->attachToHead(&globals.fHead);
-    globals.fTotalMemoryUsed += cache->fMemoryUsed;
+    cache->attachToHead(&shard.fHead);
+    shard.fTotalMemoryUsed += cache->fMemoryUsed;
 
 #ifdef USE_CACHE_HASH
     unsigned index = desc_to_hashindex(cache->fDesc);
-    SkASSERT(globals.fHash[index] != cache);
-    globals.fHash[index] = cache;
+    SkASSERT(shard.fHash[index] != cache);
+    shard.fHash[index] = cache;
 #endif
 
-    globals.validate();
+    shard.validate();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -637,7 +741,7 @@ SkGlyphCache* SkGlyphCache::FindTail(SkGlyphCache* cache) {
 }
 
 #ifdef SK_DEBUG
-void SkGlyphCache_Globals::validate() const {
+void SkGlyphCache_Shard::validate() const {
     size_t computed = 0;
 
     const SkGlyphCache* head = fHead;
@@ -653,39 +757,39 @@ void SkGlyphCache_Globals::validate() const {
 }
 #endif
 
-size_t SkGlyphCache::InternalFreeCache(SkGlyphCache_Globals* globals,
+size_t SkGlyphCache::InternalFreeCache(SkGlyphCache_Shard* shard,
                                        size_t bytesNeeded) {
-    globals->validate();
+    shard->validate();
 
     size_t  bytesFreed = 0;
     int     count = 0;
 
     // don't do any "small" purges
-    size_t minToPurge = globals->fTotalMemoryUsed >> 2;
+    size_t minToPurge = shard->fTotalMemoryUsed >> 2;
     if (bytesNeeded < minToPurge)
         bytesNeeded = minToPurge;
 
-    SkGlyphCache* cache = FindTail(globals->fHead);
+    SkGlyphCache* cache = FindTail(shard->fHead);
     while (cache != NULL && bytesFreed < bytesNeeded) {
         SkGlyphCache* prev = cache->fPrev;
         bytesFreed += cache->fMemoryUsed;
 
 #ifdef USE_CACHE_HASH
         unsigned index = desc_to_hashindex(cache->fDesc);
-        if (cache == globals->fHash[index]) {
-            globals->fHash[index] = NULL;
+        if (cache == shard->fHash[index]) {
+            shard->fHash[index] = NULL;
         }
 #endif
 
-        cache->detach(&globals->fHead);
+        cache->detach(&shard->fHead);
         SkDELETE(cache);
         cache = prev;
         count += 1;
     }
 
-    SkASSERT(bytesFreed <= globals->fTotalMemoryUsed);
-    globals->fTotalMemoryUsed -= bytesFreed;
-    globals->validate();
+    SkASSERT(bytesFreed <= shard->fTotalMemoryUsed);
+    shard->fTotalMemoryUsed -= bytesFreed;
+    shard->validate();
 
 #ifdef SPEW_PURGE_STATUS
     if (count && !gSkSuppressFontCachePurgeSpew) {
@@ -729,7 +833,7 @@ size_t SkGraphics::SetFontCacheLimit(size_t bytes) {
 }
 
 size_t SkGraphics::GetFontCacheUsed() {
-    return getSharedGlobals().fTotalMemoryUsed;
+    return getSharedGlobals().getTotalMemoryUsed();
 }
 
 void SkGraphics::PurgeFontCache() {
@@ -14,6 +14,7 @@
 #include "SkChunkAlloc.h"
 #include "SkDescriptor.h"
 #include "SkGlyph.h"
+#include "SkGlyphStore.h"
 #include "SkScalerContext.h"
 #include "SkTemplates.h"
 #include "SkTDArray.h"
@@ -22,6 +23,7 @@ struct SkDeviceProperties;
 class SkPaint;
 
 class SkGlyphCache_Globals;
+class SkGlyphCache_Shard;
 
 /** \class SkGlyphCache
 
@@ -31,8 +33,10 @@ class SkGlyphCache_Globals;
     either instantly if it is already cahced, or by first generating it and then
     adding it to the strike.
 
-    The strikes are held in a global list, available to all threads. To interact
-    with one, call either VisitCache() or DetachCache().
+    The strikes are held in a global cache, available to all threads. The cache
+    is split into shards by descriptor, each with its own lock and share of the
+    font cache limit. To interact with one, call either VisitCache() or
+    DetachCache().
 */
 class SkGlyphCache {
 public:
@@ -220,6 +224,8 @@ private:
     SkGlyphCache*       fNext, *fPrev;
     SkDescriptor*       fDesc;
     SkScalerContext*    fScalerContext;
+    SkGlyphStore*       fGlyphStore;    // NULL if there is no store, or it can't keep us
+    SkGlyphStore::Strike* fStoreStrike;
     SkPaint::FontMetrics fFontMetricsY;
 
     enum {
@@ -263,12 +269,13 @@ private:
     AuxProcRec* fAuxProcList;
     void invokeAndRemoveAuxProcs();
 
-    // This relies on the caller to have already acquired the mutex to access the global cache
-    static size_t InternalFreeCache(SkGlyphCache_Globals*, size_t bytesNeeded);
+    // This relies on the caller to have already acquired the shard's mutex
+    static size_t InternalFreeCache(SkGlyphCache_Shard*, size_t bytesNeeded);
 
     inline static SkGlyphCache* FindTail(SkGlyphCache* head);
 
     friend class SkGlyphCache_Globals;
+    friend class SkGlyphCache_Shard;
 };
 
 class SkAutoGlyphCache {
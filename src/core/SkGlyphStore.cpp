@@ -0,0 +1,452 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkGlyphStore.h"
+#include "SkChecksum.h"
+#include "SkData.h"
+#include "SkDescriptor.h"
+#include "SkGlyph.h"
+#include "SkGraphics.h"
+#include "SkScalerContext.h"
+#include "SkStream.h"
+#include "SkTemplates.h"
+#include "SkTSearch.h"
+#include "SkTime.h"
+#include "SkTypeface.h"
+
+#include <stdio.h>
+
+SK_DEFINE_INST_COUNT(SkGlyphStore)
+
+// Once the file would grow past this, new glyphs are no longer added.
+#ifndef SK_DEFAULT_GLYPH_STORE_LIMIT
+    #define SK_DEFAULT_GLYPH_STORE_LIMIT    (16 * 1024 * 1024)
+#endif
+
+/*  The file is a FileHeader followed by fStrikeCount strikes. Each strike is
+    a StrikeHeader, its normalized descriptor, and fGlyphCount GlyphRecs, each
+    followed by its image padded to a multiple of 4 bytes. The file only has
+    to be read back by the build that wrote it, so everything is in native
+    byte order, and the checksums are whatever SkChecksum computes today.
+*/
+static const uint32_t kGlyphStoreMagic = SkSetFourByteTag('s', 'k', 'g', 's');
+static const uint32_t kGlyphStoreVersion = 1 | (sizeof(void*) << 16);
+
+struct FileHeader {
+    uint32_t    fMagic;
+    uint32_t    fVersion;
+    uint32_t    fStrikeCount;
+};
+
+struct StrikeHeader {
+    uint32_t    fFontHash;
+    uint32_t    fDescLength;
+    uint32_t    fGlyphCount;
+};
+
+struct GlyphRec {
+    uint32_t    fID;
+    uint16_t    fWidth, fHeight;
+    int16_t     fTop, fLeft;
+    uint8_t     fMaskFormat;
+    uint8_t     fPad[3];
+    uint32_t    fImageSize;
+
+    const void* image() const { return this + 1; }
+    void* image() { return this + 1; }
+    size_t totalSize() const { return sizeof(GlyphRec) + SkAlign4(fImageSize); }
+
+    bool matches(const SkGlyph& glyph) const {
+        return fWidth == glyph.fWidth && fHeight == glyph.fHeight &&
+               fTop == glyph.fTop && fLeft == glyph.fLeft &&
+               fMaskFormat == glyph.fMaskFormat &&
+               fImageSize == glyph.computeImageSize();
+    }
+};
+
+class SkGlyphStore::Strike {
+public:
+    Strike(uint32_t fontHash, SkDescriptor* desc) : fFontHash(fontHash), fDesc(desc) {}
+
+    ~Strike() {
+        SkDescriptor::Free(fDesc);
+        fOwned.freeAll();
+    }
+
+    bool matches(uint32_t fontHash, const SkDescriptor& desc) const {
+        return fFontHash == fontHash && fDesc->equals(desc);
+    }
+
+    const GlyphRec* find(uint32_t id) const {
+        int index = this->search(id);
+        return index >= 0 ? fGlyphs[index] : NULL;
+    }
+
+    // Adds rec, which must not already be in the strike. It is either in the
+    // file's data, or owned is true and it came from sk_malloc.
+    void insert(GlyphRec* rec, bool owned) {
+        int index = this->search(rec->fID);
+        SkASSERT(index < 0);
+        *fGlyphs.insert(~index) = rec;
+        if (owned) {
+            *fOwned.append() = rec;
+        }
+    }
+
+    uint32_t                fFontHash;
+    SkDescriptor*           fDesc;      // normalized, see normalize_descriptor
+    SkTDArray<GlyphRec*>    fGlyphs;    // sorted by fID
+    SkTDArray<GlyphRec*>    fOwned;     // the recs we allocated
+
+private:
+    static int CompareIDs(GlyphRec* const* a, GlyphRec* const* b) {
+        uint32_t idA = (*a)->fID, idB = (*b)->fID;
+        return idA < idB ? -1 : (idA > idB ? 1 : 0);
+    }
+
+    int search(uint32_t id) const {
+        GlyphRec key;
+        key.fID = id;
+        GlyphRec* target = &key;
+        return SkTSearch<GlyphRec*, CompareIDs>(fGlyphs.begin(), fGlyphs.count(),
+                                                target, sizeof(GlyphRec*));
+    }
+};
+
+// Returns a copy of desc without the per-process font IDs, or NULL if desc
+// has entries (path effects, mask filters, rasterizers) besides its Rec,
+// whose flattened form we don't trust to be the same in another process.
+static SkDescriptor* normalize_descriptor(const SkDescriptor* desc) {
+    if (desc->getLength() != SkDescriptor::ComputeOverhead(1) + sizeof(SkScalerContext::Rec)) {
+        return NULL;
+    }
+    SkDescriptor* copy = desc->copy();
+    SkScalerContext::Rec* rec = (SkScalerContext::Rec*)
+            copy->findEntry(kRec_SkDescriptorTag, NULL);
+    if (NULL == rec) {
+        SkDescriptor::Free(copy);
+        return NULL;
+    }
+    rec->fOrigFontID = 0;
+    rec->fFontID = 0;
+    copy->computeChecksum();
+    return copy;
+}
+
+// Checksums the typeface's font data, which identifies it across processes.
+static bool compute_font_hash(SkTypeface* typeface, uint32_t* hash) {
+    int ttcIndex;
+    SkAutoTUnref<SkStream> stream(typeface->openStream(&ttcIndex));
+    if (NULL == stream.get()) {
+        return false;
+    }
+
+    size_t length = stream->getLength();
+    SkAutoTMalloc<uint32_t> storage(SkAlign4(length) >> 2);
+    uint32_t* data = storage.get();
+    if (length & 3) {
+        data[length >> 2] = 0;
+    }
+    if (stream->read(data, length) != length) {
+        return false;
+    }
+
+    *hash = SkChecksum::Compute(data, SkAlign4(length)) ^ (uint32_t)length ^
+            ((uint32_t)ttcIndex << 24);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+SkGlyphStore::SkGlyphStore(const char path[])
+        : fPath(path)
+        , fData(NULL)
+        , fBytes(sizeof(FileHeader)) {
+    this->load();
+}
+
+SkGlyphStore::~SkGlyphStore() {
+    for (int i = 0; i < fStrikes.count(); ++i) {
+        SkDELETE(fStrikes[i]);
+    }
+    SkSafeUnref(fData);
+}
+
+static void unref_stream_proc(const void*, size_t, void* context) {
+    ((SkStream*)context)->unref();
+}
+
+// Reads the file into fData (mapped if we can), and indexes its strikes. A
+// file we can't make sense of is ignored, and will be replaced by flush().
+void SkGlyphStore::load() {
+    SkAutoTUnref<SkStream> stream(SkStream::NewFromFile(fPath.c_str()));
+    if (NULL == stream.get()) {
+        return;
+    }
+
+    size_t length = stream->getLength();
+    const void* base = stream->getMemoryBase();
+    if (base) {
+        SkStream* owner = stream.detach();
+        fData = SkData::NewWithProc(base, length, unref_stream_proc, owner);
+    } else {
+        void* storage = sk_malloc_throw(length);
+        if (stream->read(storage, length) != length) {
+            sk_free(storage);
+            return;
+        }
+        fData = SkData::NewFromMalloc(storage, length);
+    }
+
+    const char* ptr = (const char*)fData->data();
+    const char* stop = ptr + fData->size();
+
+    if ((size_t)(stop - ptr) < sizeof(FileHeader)) {
+        return;
+    }
+    const FileHeader* header = (const FileHeader*)ptr;
+    if (kGlyphStoreMagic != header->fMagic || kGlyphStoreVersion != header->fVersion) {
+        return;
+    }
+    ptr += sizeof(FileHeader);
+
+    SkTDArray<Strike*> strikes;
+    size_t bytes = sizeof(FileHeader);
+    bool valid = true;
+    for (uint32_t i = 0; valid && i < header->fStrikeCount; ++i) {
+        if ((size_t)(stop - ptr) < sizeof(StrikeHeader)) {
+            valid = false;
+            break;
+        }
+        const StrikeHeader* strikeHeader = (const StrikeHeader*)ptr;
+        ptr += sizeof(StrikeHeader);
+
+        uint32_t descLength = strikeHeader->fDescLength;
+        const SkDescriptor* desc = (const SkDescriptor*)ptr;
+        if (descLength < SkDescriptor::ComputeOverhead(1) || !SkIsAlign4(descLength) ||
+                (size_t)(stop - ptr) < descLength || desc->getLength() != descLength) {
+            valid = false;
+            break;
+        }
+        ptr += descLength;
+
+        Strike* strike = SkNEW_ARGS(Strike, (strikeHeader->fFontHash, desc->copy()));
+        *strikes.append() = strike;
+        bytes += sizeof(StrikeHeader) + descLength;
+
+        for (uint32_t j = 0; j < strikeHeader->fGlyphCount; ++j) {
+            const GlyphRec* rec = (const GlyphRec*)ptr;
+            if ((size_t)(stop - ptr) < sizeof(GlyphRec) ||
+                    (size_t)(stop - ptr) < rec->totalSize() ||
+                    NULL != strike->find(rec->fID)) {
+                valid = false;
+                break;
+            }
+            ptr += rec->totalSize();
+            strike->insert(const_cast<GlyphRec*>(rec), false);
+            bytes += rec->totalSize();
+        }
+    }
+
+    if (valid) {
+        fStrikes.swap(strikes);
+        fBytes = bytes;
+    }
+    for (int i = 0; i < strikes.count(); ++i) {
+        SkDELETE(strikes[i]);
+    }
+}
+
+bool SkGlyphStore::findFontHash(uint32_t fontID, uint32_t* hash) const {
+    for (int i = 0; i < fFontHashes.count(); ++i) {
+        if (fFontHashes[i].fFontID == fontID) {
+            *hash = fFontHashes[i].fHash;
+            return true;
+        }
+    }
+    return false;
+}
+
+SkGlyphStore::Strike* SkGlyphStore::findStrike(SkTypeface* typeface,
+                                               const SkDescriptor* desc) {
+    SkDescriptor* key = normalize_descriptor(desc);
+    if (NULL == key) {
+        return NULL;
+    }
+
+    uint32_t fontID = typeface->uniqueID();
+    uint32_t fontHash;
+    bool found;
+    {
+        SkAutoMutexAcquire ac(fMutex);
+        found = this->findFontHash(fontID, &fontHash);
+    }
+    // Reading the font data can be slow, so we don't hold the mutex for it.
+    if (!found && !compute_font_hash(typeface, &fontHash)) {
+        SkDescriptor::Free(key);
+        return NULL;
+    }
+
+    SkAutoMutexAcquire ac(fMutex);
+    if (!found) {
+        uint32_t unused;
+        if (!this->findFontHash(fontID, &unused)) {
+            FontHashRec* rec = fFontHashes.append();
+            rec->fFontID = fontID;
+            rec->fHash = fontHash;
+        }
+    }
+
+    for (int i = 0; i < fStrikes.count(); ++i) {
+        if (fStrikes[i]->matches(fontHash, *key)) {
+            SkDescriptor::Free(key);
+            return fStrikes[i];
+        }
+    }
+
+    Strike* strike = SkNEW_ARGS(Strike, (fontHash, key));
+    *fStrikes.append() = strike;
+    fBytes += sizeof(StrikeHeader) + key->getLength();
+    return strike;
+}
+
+bool SkGlyphStore::readImage(Strike* strike, const SkGlyph& glyph) {
+    SkASSERT(strike);
+    SkASSERT(glyph.fImage);
+
+    SkAutoMutexAcquire ac(fMutex);
+    const GlyphRec* rec = strike->find(glyph.fID);
+    if (NULL == rec || !rec->matches(glyph)) {
+        return false;
+    }
+    memcpy(glyph.fImage, rec->image(), rec->fImageSize);
+    return true;
+}
+
+void SkGlyphStore::addImage(Strike* strike, const SkGlyph& glyph) {
+    SkASSERT(strike);
+    SkASSERT(glyph.fImage);
+
+    size_t imageSize = glyph.computeImageSize();
+    size_t totalSize = sizeof(GlyphRec) + SkAlign4(imageSize);
+
+    SkAutoMutexAcquire ac(fMutex);
+    if (fBytes + totalSize > SK_DEFAULT_GLYPH_STORE_LIMIT ||
+            NULL != strike->find(glyph.fID)) {
+        return;
+    }
+
+    GlyphRec* rec = (GlyphRec*)sk_malloc_throw(totalSize);
+    rec->fID = glyph.fID;
+    rec->fWidth = glyph.fWidth;
+    rec->fHeight = glyph.fHeight;
+    rec->fTop = glyph.fTop;
+    rec->fLeft = glyph.fLeft;
+    rec->fMaskFormat = glyph.fMaskFormat;
+    memset(rec->fPad, 0, sizeof(rec->fPad));
+    rec->fImageSize = SkToU32(imageSize);
+    memcpy(rec->image(), glyph.fImage, imageSize);
+    memset((char*)rec->image() + imageSize, 0, SkAlign4(imageSize) - imageSize);
+
+    strike->insert(rec, true);
+    fBytes += totalSize;
+}
+
+bool SkGlyphStore::flush() {
+    SkAutoMutexAcquire ac(fMutex);
+
+    // Write a new file beside the old one and then rename it over the old
+    // one, so that other processes never map a partly written file.
+    SkString tmpPath;
+    tmpPath.printf("%s.%x.%p.tmp", fPath.c_str(), SkTime::GetMSecs(), this);
+    {
+        SkFILEWStream out(tmpPath.c_str());
+        if (!out.isValid()) {
+            return false;
+        }
+
+        int strikeCount = 0;
+        for (int i = 0; i < fStrikes.count(); ++i) {
+            strikeCount += fStrikes[i]->fGlyphs.count() > 0;
+        }
+
+        FileHeader header;
+        header.fMagic = kGlyphStoreMagic;
+        header.fVersion = kGlyphStoreVersion;
+        header.fStrikeCount = strikeCount;
+        bool ok = out.write(&header, sizeof(header));
+
+        for (int i = 0; ok && i < fStrikes.count(); ++i) {
+            const Strike* strike = fStrikes[i];
+            if (0 == strike->fGlyphs.count()) {
+                continue;
+            }
+            StrikeHeader strikeHeader;
+            strikeHeader.fFontHash = strike->fFontHash;
+            strikeHeader.fDescLength = strike->fDesc->getLength();
+            strikeHeader.fGlyphCount = strike->fGlyphs.count();
+            ok = out.write(&strikeHeader, sizeof(strikeHeader)) &&
+                 out.write(strike->fDesc, strikeHeader.fDescLength);
+
+            for (int j = 0; ok && j < strike->fGlyphs.count(); ++j) {
+                const GlyphRec* rec = strike->fGlyphs[j];
+                ok = out.write(rec, rec->totalSize());
+            }
+        }
+        out.flush();
+
+        if (!ok) {
+            remove(tmpPath.c_str());
+            return false;
+        }
+    }
+
+    if (0 != rename(tmpPath.c_str(), fPath.c_str())) {
+        // some platforms won't rename over an existing file
+        remove(fPath.c_str());
+        if (0 != rename(tmpPath.c_str(), fPath.c_str())) {
+            remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+int SkGlyphStore::countGlyphs() const {
+    SkAutoMutexAcquire ac(fMutex);
+    int count = 0;
+    for (int i = 0; i < fStrikes.count(); ++i) {
+        count += fStrikes[i]->fGlyphs.count();
+    }
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+SK_DECLARE_STATIC_MUTEX(gGlyphStoreMutex);
+static SkGlyphStore* gGlyphStore;
+
+SkGlyphStore* SkGlyphStore::RefGlobal() {
+    SkAutoMutexAcquire ac(gGlyphStoreMutex);
+    return SkSafeRef(gGlyphStore);
+}
+
+void SkGraphics::SetGlyphStorePath(const char path[]) {
+    SkGlyphStore* store = path ? SkNEW_ARGS(SkGlyphStore, (path)) : NULL;
+    {
+        SkAutoMutexAcquire ac(gGlyphStoreMutex);
+        SkTSwap(gGlyphStore, store);
+    }
+    SkSafeUnref(store);
+    // Strikes made before the switch remember the store they started with.
+    PurgeFontCache();
+}
+
+bool SkGraphics::FlushGlyphStore() {
+    SkAutoTUnref<SkGlyphStore> store(SkGlyphStore::RefGlobal());
+    return NULL != store.get() && store->flush();
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkGlyphStore_DEFINED
+#define SkGlyphStore_DEFINED
+
+#include "SkRefCnt.h"
+#include "SkString.h"
+#include "SkTDArray.h"
+#include "SkThread.h"
+#include "SkTypes.h"
+
+class SkData;
+class SkDescriptor;
+class SkGlyph;
+class SkTypeface;
+
+/** \class SkGlyphStore
+
+    A persistent store of glyph images, kept in a file so that a new process
+    can reuse the glyphs earlier processes rasterized instead of asking the
+    scaler for them again. The file is memory-mapped when the store is opened
+    and is never written in place: glyphs rasterized afterwards are kept in
+    memory, and flush() writes them out together with the file's glyphs as a
+    new file that replaces the old one.
+
+    Strikes are keyed by their SkDescriptor, with the per-process font IDs
+    replaced by a checksum of the typeface's font data, so that they match
+    across processes. Only strikes without path effects, mask filters or
+    rasterizers are stored.
+
+    SkGlyphCache consults the store installed by SkGraphics::SetGlyphStorePath()
+    before asking its scaler context for an image.
+*/
+class SkGlyphStore : public SkRefCnt {
+public:
+    SK_DECLARE_INST_COUNT(SkGlyphStore)
+
+    /** Opens the store kept at path. A missing, unreadable or incompatible
+        file gives an empty store, which flush() will create or replace.
+    */
+    explicit SkGlyphStore(const char path[]);
+    virtual ~SkGlyphStore();
+
+    class Strike;
+
+    /** Returns the strike matching desc, creating it if needed, or NULL if
+        the strike can't be stored. Strikes live as long as the store.
+    */
+    Strike* findStrike(SkTypeface*, const SkDescriptor* desc);
+
+    /** If strike has an image for glyph with glyph's current bounds and
+        format, copies it into glyph.fImage and returns true.
+    */
+    bool readImage(Strike*, const SkGlyph& glyph);
+
+    /** Remembers glyph.fImage, just rasterized by the scaler, so that it is
+        written by the next flush(). Does nothing once the store is full.
+    */
+    void addImage(Strike*, const SkGlyph& glyph);
+
+    /** Writes every glyph in the store to its file. Returns false if the file
+        could not be written, in which case the old file is left in place.
+    */
+    bool flush();
+
+    /** Returns the number of glyphs in the store, for tests. */
+    int countGlyphs() const;
+
+    /** Returns the store installed by SkGraphics::SetGlyphStorePath() with a
+        reference the caller must unref(), or NULL if there is none.
+    */
+    static SkGlyphStore* RefGlobal();
+
+private:
+    struct FontHashRec {
+        uint32_t    fFontID;
+        uint32_t    fHash;
+    };
+
+    SkString                fPath;
+    SkData*                 fData;          // the file, as it was when we opened it
+    SkTDArray<Strike*>      fStrikes;
+    SkTDArray<FontHashRec>  fFontHashes;    // font data checksums, by font ID
+    size_t                  fBytes;         // size of the file flush() would write
+    mutable SkMutex         fMutex;
+
+    void load();
+    bool findFontHash(uint32_t fontID, uint32_t* hash) const;
+
+    typedef SkRefCnt INHERITED;
+};
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkGradientProcs_DEFINED
+#define SkGradientProcs_DEFINED
+
+#include "SkColor.h"
+#include "SkFixed.h"
+#include "SkScalar.h"
+
+/*  The inner loops of the gradient shaders' shadeSpan(). Each proc writes
+ *  count colors to dst, looked up in the 32-bit gradient cache: four rows of
+ *  256 colors, one for each cell of the 2x2 dither pattern. toggle is the
+ *  offset of the row the first pixel reads from, and flips between the two
+ *  rows of its dither line (toggle ^ 256) from one pixel to the next.
+ *
+ *  The linear procs step the 16.16 gradient position fx by dx. The clamp proc
+ *  is only handed runs where fx stays within [0, 0xFFFF]; SkClampRange fills
+ *  the pinned ends of the span.
+ *
+ *  The radial procs step the unit-space point (fx, fy) by (dx, dy), and look
+ *  up its distance from the center.
+ *
+ *  The two point conical procs solve for t at each pixel of span, see
+ *  SkTwoPointConicalSpan, and write 0 where the cone does not reach.
+ *
+ *  Platform procs must produce exactly what the portable procs do.
+ */
+
+/**
+ *  The per-span state of a two point conical gradient. t at a pixel is the
+ *  larger root of fA * t^2 + fB * t + C = 0, where
+ *  C = fRelX^2 + fRelY^2 - fRadius2, for which the radius
+ *  fRadius + t * fDRadius is positive; if neither root has a positive radius
+ *  the pixel is not drawn. fRelX, fRelY and fB step by fIncX, fIncY and fDB
+ *  from one pixel to the next.
+ */
+struct SkTwoPointConicalSpan {
+    enum {
+        kDontDrawT  = 0x80000000
+    };
+
+    float   fRadius;
+    float   fDRadius;
+    float   fA;
+    float   fRadius2;
+
+    float   fRelX, fRelY, fIncX, fIncY;
+    float   fB, fDB;
+
+    static bool DontDrawT(SkFixed t) {
+        return kDontDrawT == (uint32_t)t;
+    }
+};
+
+typedef void (*SkGradientLinearProc)(SkFixed dx, SkFixed fx, SkPMColor dst[],
+                                     const SkPMColor cache[], int toggle, int count);
+typedef void (*SkGradientRadialProc)(SkScalar fx, SkScalar dx, SkScalar fy, SkScalar dy,
+                                     SkPMColor dst[], const SkPMColor cache[],
+                                     int count, int toggle);
+typedef void (*SkGradientConicalProc)(SkTwoPointConicalSpan* span, SkPMColor dst[],
+                                      const SkPMColor cache[], int toggle, int count);
+
+struct SkGradientProcs {
+    SkGradientLinearProc    fLinearClamp;
+    SkGradientLinearProc    fLinearRepeat;
+    SkGradientLinearProc    fLinearMirror;
+    SkGradientRadialProc    fRadialClamp;
+    SkGradientRadialProc    fRadialMirror;
+    SkGradientConicalProc   fConicalClamp;
+    SkGradientConicalProc   fConicalRepeat;
+    SkGradientConicalProc   fConicalMirror;
+};
+
+/**
+ *  Fills in the members of procs that the platform has SIMD versions of, and
+ *  returns true, or returns false if it has nothing faster than the portable
+ *  procs in src/effects/gradients. Members it leaves alone should be NULL on
+ *  entry. Implemented in src/opts.
+ */
+bool SkGradientGetPlatformProcs(SkGradientProcs* procs);
+
+#endif
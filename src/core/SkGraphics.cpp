@@ -135,13 +135,16 @@ void SkGraphics::Term() {
 
 static const char kFontCacheLimitStr[] = "font-cache-limit";
 static const size_t kFontCacheLimitLen = sizeof(kFontCacheLimitStr) - 1;
+static const char kImageCacheLimitStr[] = "image-cache-limit";
+static const size_t kImageCacheLimitLen = sizeof(kImageCacheLimitStr) - 1;
 
 static const struct {
     const char* fStr;
     size_t fLen;
     size_t (*fFunc)(size_t);
 } gFlags[] = {
-    { kFontCacheLimitStr, kFontCacheLimitLen, SkGraphics::SetFontCacheLimit }
+    { kFontCacheLimitStr, kFontCacheLimitLen, SkGraphics::SetFontCacheLimit },
+    { kImageCacheLimitStr, kImageCacheLimitLen, SkGraphics::SetImageCacheByteLimit }
 };
 
 /* flags are of the form param; or param=value; */
@@ -0,0 +1,247 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkMipMap.h"
+#include "SkColorPriv.h"
+
+SK_DEFINE_INST_COUNT(SkMipMap)
+
+static void downsampleby2_proc32(SkBitmap* dst, int x, int y,
+                                 const SkBitmap& src) {
+    x <<= 1;
+    y <<= 1;
+    const SkPMColor* p = src.getAddr32(x, y);
+    const SkPMColor* baseP = p;
+    SkPMColor c, ag, rb;
+
+    c = *p; ag = (c >> 8) & 0xFF00FF; rb = c & 0xFF00FF;
+    if (x < src.width() - 1) {
+        p += 1;
+    }
+    c = *p; ag += (c >> 8) & 0xFF00FF; rb += c & 0xFF00FF;
+
+    p = baseP;
+    if (y < src.height() - 1) {
+        p += src.rowBytes() >> 2;
+    }
+    c = *p; ag += (c >> 8) & 0xFF00FF; rb += c & 0xFF00FF;
+    if (x < src.width() - 1) {
+        p += 1;
+    }
+    c = *p; ag += (c >> 8) & 0xFF00FF; rb += c & 0xFF00FF;
+
+    *dst->getAddr32(x >> 1, y >> 1) =
+        ((rb >> 2) & 0xFF00FF) | ((ag << 6) & 0xFF00FF00);
+}
+
+static inline uint32_t expand16(U16CPU c) {
+    return (c & ~SK_G16_MASK_IN_PLACE) | ((c & SK_G16_MASK_IN_PLACE) << 16);
+}
+
+// returns dirt in the top 16bits, but we don't care, since we only
+// store the low 16bits.
+static inline U16CPU pack16(uint32_t c) {
+    return (c & ~SK_G16_MASK_IN_PLACE) | ((c >> 16) & SK_G16_MASK_IN_PLACE);
+}
+
+static void downsampleby2_proc16(SkBitmap* dst, int x, int y,
+                                 const SkBitmap& src) {
+    x <<= 1;
+    y <<= 1;
+    const uint16_t* p = src.getAddr16(x, y);
+    const uint16_t* baseP = p;
+    SkPMColor       c;
+
+    c = expand16(*p);
+    if (x < src.width() - 1) {
+        p += 1;
+    }
+    c += expand16(*p);
+
+    p = baseP;
+    if (y < src.height() - 1) {
+        p += src.rowBytes() >> 1;
+    }
+    c += expand16(*p);
+    if (x < src.width() - 1) {
+        p += 1;
+    }
+    c += expand16(*p);
+
+    *dst->getAddr16(x >> 1, y >> 1) = (uint16_t)pack16(c >> 2);
+}
+
+static uint32_t expand4444(U16CPU c) {
+    return (c & 0xF0F) | ((c & ~0xF0F) << 12);
+}
+
+static U16CPU collaps4444(uint32_t c) {
+    return (c & 0xF0F) | ((c >> 12) & ~0xF0F);
+}
+
+static void downsampleby2_proc4444(SkBitmap* dst, int x, int y,
+                                   const SkBitmap& src) {
+    x <<= 1;
+    y <<= 1;
+    const uint16_t* p = src.getAddr16(x, y);
+    const uint16_t* baseP = p;
+    uint32_t        c;
+
+    c = expand4444(*p);
+    if (x < src.width() - 1) {
+        p += 1;
+    }
+    c += expand4444(*p);
+
+    p = baseP;
+    if (y < src.height() - 1) {
+        p += src.rowBytes() >> 1;
+    }
+    c += expand4444(*p);
+    if (x < src.width() - 1) {
+        p += 1;
+    }
+    c += expand4444(*p);
+
+    *dst->getAddr16(x >> 1, y >> 1) = (uint16_t)collaps4444(c >> 2);
+}
+
+SkMipMap::SkMipMap(Level* levels, int count, SkBitmap::Config config, size_t size)
+    : fLevels(levels)
+    , fCount(count)
+    , fConfig(config)
+    , fSize(size) {
+    SkASSERT(levels);
+    SkASSERT(count > 0);
+}
+
+SkMipMap::~SkMipMap() {
+    sk_free(fLevels);
+}
+
+SkMipMap* SkMipMap::Build(const SkBitmap& src) {
+    void (*proc)(SkBitmap* dst, int x, int y, const SkBitmap& src);
+
+    const SkBitmap::Config config = src.getConfig();
+    switch (config) {
+        case SkBitmap::kARGB_8888_Config:
+            proc = downsampleby2_proc32;
+            break;
+        case SkBitmap::kRGB_565_Config:
+            proc = downsampleby2_proc16;
+            break;
+        case SkBitmap::kARGB_4444_Config:
+            proc = downsampleby2_proc4444;
+            break;
+        case SkBitmap::kIndex8_Config:
+        case SkBitmap::kA8_Config:
+        default:
+            return NULL; // don't build mipmaps for these configs
+    }
+
+    SkAutoLockPixels alp(src);
+    if (!src.readyToDraw()) {
+        return NULL;
+    }
+
+    // whip through our loop to compute the exact size needed
+    size_t  size = 0;
+    int     countLevels = 0;
+    {
+        int width = src.width();
+        int height = src.height();
+        for (;;) {
+            width >>= 1;
+            height >>= 1;
+            if (0 == width || 0 == height) {
+                break;
+            }
+            size += SkBitmap::ComputeRowBytes(config, width) * height;
+            countLevels += 1;
+        }
+    }
+
+    // nothing to build
+    if (0 == countLevels) {
+        return NULL;
+    }
+
+    Sk64 allocSize;
+    allocSize.setMul(countLevels, sizeof(Level));
+    allocSize.add(SkToS32(size));
+    if (allocSize.isNeg() || !allocSize.is32()) {
+        return NULL;
+    }
+    Level* levels = (Level*)sk_malloc_throw(allocSize.get32());
+
+    uint8_t*    addr = (uint8_t*)(levels + countLevels);
+    int         width = src.width();
+    int         height = src.height();
+    uint32_t    rowBytes;
+    SkBitmap    srcBM(src);
+    SkBitmap    dstBM;
+
+    for (int i = 0; i < countLevels; i++) {
+        width >>= 1;
+        height >>= 1;
+        rowBytes = SkToU32(SkBitmap::ComputeRowBytes(config, width));
+
+        levels[i].fPixels   = addr;
+        levels[i].fWidth    = width;
+        levels[i].fHeight   = height;
+        levels[i].fRowBytes = rowBytes;
+
+        dstBM.setConfig(config, width, height, rowBytes);
+        dstBM.setPixels(addr);
+
+        srcBM.lockPixels();
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                proc(&dstBM, x, y, srcBM);
+            }
+        }
+        srcBM.unlockPixels();
+
+        srcBM = dstBM;
+        addr += height * rowBytes;
+    }
+    SkASSERT(addr == (uint8_t*)(levels + countLevels) + size);
+
+    return SkNEW_ARGS(SkMipMap, (levels, countLevels, config, size));
+}
+
+int SkMipMap::extractLevel(SkFixed sx, SkFixed sy, SkBitmap* dst) const {
+    int level = ComputeLevel(sx, sy) >> 16;
+    SkASSERT(level >= 0);
+    if (level <= 0) {
+        return 0;
+    }
+
+    if (level >= fCount) {
+        level = fCount - 1;
+    }
+    if (dst) {
+        const Level& mip = fLevels[level - 1];
+        dst->setConfig(fConfig, mip.fWidth, mip.fHeight, mip.fRowBytes);
+        dst->setPixels(mip.fPixels);
+    }
+    return level;
+}
+
+SkFixed SkMipMap::ComputeLevel(SkFixed sx, SkFixed sy) {
+    sx = SkAbs32(sx);
+    sy = SkAbs32(sy);
+    if (sx < sy) {
+        sx = sy;
+    }
+    if (sx < SK_Fixed1) {
+        return 0;
+    }
+    int clz = SkCLZ(sx);
+    SkASSERT(clz >= 1 && clz <= 15);
+    return SkIntToFixed(15 - clz) + ((unsigned)(sx << (clz + 1)) >> 16);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkMipMap_DEFINED
+#define SkMipMap_DEFINED
+
+#include "SkBitmap.h"
+#include "SkRefCnt.h"
+
+/**
+ *  A chain of box-filtered copies of a bitmap, each half the size of the one
+ *  before, in a single allocation. Mipmaps hold no reference to the bitmap
+ *  they were built from, so one can be shared by every bitmap with the same
+ *  pixels (see SkScaledImageCache).
+ */
+class SkMipMap : public SkRefCnt {
+public:
+    SK_DECLARE_INST_COUNT(SkMipMap)
+
+    /**
+     *  Builds the mipmap of src, or returns NULL if src's config has no
+     *  downsampler, it is too small to have levels, or its pixels can't be
+     *  read. 8888, 565 and 4444 bitmaps are supported.
+     */
+    static SkMipMap* Build(const SkBitmap& src);
+
+    /**
+     *  Given the inverse scale factors sx, sy that the bitmap is drawn with,
+     *  returns the level to sample from, where level n is 1/2^n the original
+     *  size, or 0 if the original should be used. If dst is not NULL and the
+     *  level is not 0, dst is set to point at that level's pixels, which are
+     *  only valid while this mipmap is alive.
+     */
+    int extractLevel(SkFixed sx, SkFixed sy, SkBitmap* dst) const;
+
+    /** Returns the number of bytes of pixels in all the levels. */
+    size_t getSize() const { return fSize; }
+
+    /**
+     *  Returns the (fractional) level that the inverse scale factors sx, sy
+     *  call for, as a fixed point number.
+     */
+    static SkFixed ComputeLevel(SkFixed sx, SkFixed sy);
+
+    virtual ~SkMipMap();
+
+private:
+    struct Level {
+        void*       fPixels;
+        uint32_t    fRowBytes;
+        uint32_t    fWidth, fHeight;
+    };
+
+    SkMipMap(Level* levels, int count, SkBitmap::Config config, size_t size);
+
+    Level*              fLevels;    // also owns the pixels, which follow it
+    int                 fCount;
+    SkBitmap::Config    fConfig;
+    size_t              fSize;
+
+    typedef SkRefCnt INHERITED;
+};
+
+#endif
@@ -224,6 +224,10 @@ void SkPaint::setAutohinted(bool useAutohinter) {
     this->setFlags(SkSetClearMask(fFlags, useAutohinter, kAutoHinting_Flag));
 }
 
+void SkPaint::setAnalyticAA(bool doAnalyticAA) {
+    this->setFlags(SkSetClearMask(fFlags, doAnalyticAA, kAnalyticAA_Flag));
+}
+
 void SkPaint::setLinearText(bool doLinearText) {
     this->setFlags(SkSetClearMask(fFlags, doLinearText, kLinearText_Flag));
 }
@@ -252,6 +256,11 @@ void SkPaint::setFilterBitmap(bool doFilter) {
     this->setFlags(SkSetClearMask(fFlags, doFilter, kFilterBitmap_Flag));
 }
 
+void SkPaint::setHighQualityFilterBitmap(bool doHighQualityFilter) {
+    this->setFlags(SkSetClearMask(fFlags, doHighQualityFilter,
+                                  kHighQualityFilterBitmap_Flag));
+}
+
 void SkPaint::setStyle(Style style) {
     if ((unsigned)style < kStyleCount) {
         GEN_ID_INC_EVAL((unsigned)style != fStyle);
@@ -2364,6 +2373,9 @@ void SkPaint::toString(SkString* str) const {
         SkAddFlagToString(str, this->isVerticalText(), "VerticalText", &needSeparator);
         SkAddFlagToString(str, SkToBool(this->getFlags() & SkPaint::kGenA8FromLCD_Flag),
                           "GenA8FromLCD", &needSeparator);
+        SkAddFlagToString(str, this->isAnalyticAA(), "AnalyticAA", &needSeparator);
+        SkAddFlagToString(str, this->isHighQualityFilterBitmap(), "HighQualityFilterBitmap",
+                          &needSeparator);
     } else {
         str->append("None");
     }
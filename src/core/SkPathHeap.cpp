@@ -6,20 +6,22 @@
  * found in the LICENSE file.
  */
 #include "SkPathHeap.h"
+#include "SkData.h"
 #include "SkPath.h"
 #include "SkStream.h"
 #include "SkFlattenableBuffers.h"
+#include "SkOrderedReadBuffer.h"
 #include <new>
 
 SK_DEFINE_INST_COUNT(SkPathHeap)
 
 #define kPathCount  64
 
-SkPathHeap::SkPathHeap() : fHeap(kPathCount * sizeof(SkPath)) {
+SkPathHeap::SkPathHeap() : fHeap(kPathCount * sizeof(SkPath)), fFlatData(NULL) {
 }
 
 SkPathHeap::SkPathHeap(SkFlattenableReadBuffer& buffer)
-            : fHeap(kPathCount * sizeof(SkPath)) {
+            : fHeap(kPathCount * sizeof(SkPath)), fFlatData(NULL) {
     const int count = buffer.readInt();
 
     fPaths.setCount(count);
@@ -28,19 +30,73 @@ SkPathHeap::SkPathHeap(SkFlattenableReadBuffer& buffer)
 
     for (int i = 0; i < count; i++) {
         new (p) SkPath;
+        (void)buffer.readUInt();    // the flattened size, only needed to skip the path
         buffer.readPath(p);
         *ptr++ = p; // record the pointer
         p++;        // move to the next storage location
     }
 }
 
+SkPathHeap::SkPathHeap(SkOrderedReadBuffer& buffer, SkData* flatData)
+            : fHeap(kPathCount * sizeof(SkPath)), fFlatData(flatData) {
+    fFlatData->ref();
+
+    const int count = buffer.readInt();
+
+    fPaths.setCount(count);
+    fFlatPaths.setCount(count);
+    for (int i = 0; i < count; i++) {
+        fPaths[i] = NULL;
+        fFlatPaths[i] = buffer.skip(buffer.readUInt());
+    }
+}
+
 SkPathHeap::~SkPathHeap() {
     SkPath** iter = fPaths.begin();
     SkPath** stop = fPaths.end();
     while (iter < stop) {
-        (*iter)->~SkPath();
+        if (NULL != *iter) {
+            (*iter)->~SkPath();
+        }
         iter++;
     }
+    SkSafeUnref(fFlatData);
+}
+
+// A path is only published in fPaths once it is fully unflattened, so a
+// reader that sees a non-NULL pointer may use it without taking fMutex.
+static inline SkPath* load_published(SkPath* const* slot) {
+    SkPath* path = *(SkPath* volatile const*)slot;
+#if defined(__GNUC__)
+    __sync_synchronize();
+#endif  // MSVC gives volatile loads acquire semantics
+    return path;
+}
+
+static inline void publish(SkPath** slot, SkPath* path) {
+#if defined(__GNUC__)
+    __sync_synchronize();
+#endif  // MSVC gives volatile stores release semantics
+    *(SkPath* volatile*)slot = path;
+}
+
+const SkPath& SkPathHeap::unflatten(int index) const {
+    SkPath* path = load_published(&fPaths[index]);
+    if (NULL != path) {
+        return *path;
+    }
+
+    SkAutoMutexAcquire ac(fMutex);
+
+    path = fPaths[index];
+    if (NULL == path) {
+        SkPathHeap* self = const_cast<SkPathHeap*>(this);
+        path = (SkPath*)self->fHeap.allocThrow(sizeof(SkPath));
+        new (path) SkPath;
+        path->readFromMemory(fFlatPaths[index]);
+        publish(&self->fPaths[index], path);
+    }
+    return *path;
 }
 
 int SkPathHeap::append(const SkPath& path) {
@@ -54,10 +110,10 @@ void SkPathHeap::flatten(SkFlattenableWriteBuffer& buffer) const {
     int count = fPaths.count();
 
     buffer.writeInt(count);
-    SkPath* const* iter = fPaths.begin();
-    SkPath* const* stop = fPaths.end();
-    while (iter < stop) {
-        buffer.writePath(**iter);
-        iter++;
+    for (int i = 0; i < count; i++) {
+        const SkPath& path = (*this)[i];
+        // Lets a reader find each path without unflattening the ones before it.
+        buffer.writeUInt(path.writeToMemory(NULL));
+        buffer.writePath(path);
     }
 }
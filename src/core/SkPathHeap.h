@@ -11,10 +11,13 @@
 #include "SkRefCnt.h"
 #include "SkChunkAlloc.h"
 #include "SkTDArray.h"
+#include "SkThread.h"
 
+class SkData;
 class SkPath;
 class SkFlattenableReadBuffer;
 class SkFlattenableWriteBuffer;
+class SkOrderedReadBuffer;
 
 class SkPathHeap : public SkRefCnt {
 public:
@@ -22,6 +25,11 @@ public:
 
     SkPathHeap();
     SkPathHeap(SkFlattenableReadBuffer&);
+    /** Reads the heap from a buffer over flatData, but leaves each path
+        flattened in flatData until it is first looked up. The heap refs
+        flatData, which must not change.
+     */
+    SkPathHeap(SkOrderedReadBuffer&, SkData* flatData);
     virtual ~SkPathHeap();
 
     /** Copy the path into the heap, and return the new total number of paths.
@@ -33,6 +41,11 @@ public:
     // called during picture-playback
     int count() const { return fPaths.count(); }
     const SkPath& operator[](int index) const {
+        // Lazily loaded heaps publish each path in fPaths once it has been
+        // unflattened, so they must read it through unflatten().
+        if (NULL != fFlatData) {
+            return this->unflatten(index);
+        }
         return *fPaths[index];
     }
 
@@ -41,9 +54,16 @@ public:
 private:
     // we store the paths in the heap (placement new)
     SkChunkAlloc        fHeap;
-    // we just store ptrs into fHeap here
+    // we just store ptrs into fHeap here, or NULL for paths not yet unflattened
     SkTDArray<SkPath*>  fPaths;
 
+    // for heaps that unflatten their paths when they are first looked up
+    SkData*                 fFlatData;
+    SkTDArray<const void*>  fFlatPaths;     // each path's flattened bytes, in fFlatData
+    mutable SkMutex         fMutex;
+
+    const SkPath& unflatten(int index) const;
+
     typedef SkRefCnt INHERITED;
 };
 
@@ -8,11 +8,13 @@
 
 
 #include "SkPictureFlat.h"
+#include "SkPictureOptimizer.h"
 #include "SkPicturePlayback.h"
 #include "SkPictureRecord.h"
 
 #include "SkCanvas.h"
 #include "SkChunkAlloc.h"
+#include "SkData.h"
 #include "SkDevice.h"
 #include "SkPicture.h"
 #include "SkRegion.h"
@@ -253,6 +255,97 @@ void SkPicture::endRecording() {
     SkASSERT(NULL == fRecord);
 }
 
+void SkPicture::optimize(OptimizeStats* stats) {
+    this->endRecording();
+    if (fPlayback) {
+        SkPictureOptimizer::Optimize(fPlayback, stats);
+    }
+}
+
+void SkPicture::splice(const SkRect& rect, SkPicture* replacement, SkIRect* damage) {
+    this->endRecording();
+
+    SkRect bounds = SkRect::MakeWH(SkIntToScalar(fWidth), SkIntToScalar(fHeight));
+    if (NULL != damage) {
+        rect.roundOut(damage);
+        if (!damage->intersect(0, 0, fWidth, fHeight)) {
+            damage->setEmpty();
+        }
+    }
+
+    // Build up the splices again from the base, leaving out those the new
+    // one covers. Splicing into a picture that was not spliced into makes its
+    // commands the base.
+    SkAutoTUnref<SkPicture> base;
+    const SkPictureSplices* oldSplices = NULL;
+    if (NULL != fPlayback && NULL != fPlayback->splices()) {
+        oldSplices = fPlayback->splices();
+        base.reset(SkRef(oldSplices->base()));
+    } else {
+        base.reset(SkNEW(SkPicture));
+        base->fWidth = fWidth;
+        base->fHeight = fHeight;
+        SkTSwap(base->fPlayback, fPlayback);
+    }
+    const uint32_t recordingFlags = NULL != base->fPlayback &&
+                                    base->fPlayback->hasBoundingHierarchy() ?
+                                    kOptimizeForClippedPlayback_RecordingFlag : 0;
+    if (rect.contains(bounds)) {
+        base.reset(SkNEW(SkPicture));
+        base->fWidth = fWidth;
+        base->fHeight = fHeight;
+    }
+
+    SkAutoTUnref<SkPictureSplices> splices(SkNEW_ARGS(SkPictureSplices, (base)));
+    if (NULL != oldSplices) {
+        for (int i = 0; i < oldSplices->splices().count(); ++i) {
+            const SkPictureSplices::Splice& splice = oldSplices->splices()[i];
+            if (!rect.contains(splice.fRect)) {
+                splices->append(splice.fRect, splice.fPicture);
+            }
+        }
+    }
+    splices->append(rect, replacement);
+    const SkTDArray<SkPictureSplices::Splice>& list = splices->splices();
+
+    SkCanvas* canvas = this->beginRecording(fWidth, fHeight, recordingFlags);
+    canvas->save();
+    for (int i = 0; i < list.count(); ++i) {
+        canvas->clipRect(list[i].fRect, SkRegion::kDifference_Op);
+    }
+    canvas->drawPicture(*base);
+    canvas->restore();
+    for (int i = 0; i < list.count(); ++i) {
+        if (NULL == list[i].fPicture) {
+            continue;
+        }
+        canvas->save();
+        canvas->clipRect(list[i].fRect);
+        for (int j = i + 1; j < list.count(); ++j) {
+            if (SkRect::Intersects(list[i].fRect, list[j].fRect)) {
+                canvas->clipRect(list[j].fRect, SkRegion::kDifference_Op);
+            }
+        }
+        canvas->drawPicture(*list[i].fPicture);
+        canvas->restore();
+    }
+    this->endRecording();
+
+    if (NULL != fPlayback) {
+        fPlayback->setSplices(splices);
+    }
+}
+
+void SkPicture::getAnalysis(Analysis* analysis) const {
+    if (NULL != fPlayback) {
+        *analysis = fPlayback->analysis();
+    } else if (NULL != fRecord) {
+        fRecord->getAnalysis(analysis);
+    } else {
+        *analysis = Analysis();
+    }
+}
+
 void SkPicture::draw(SkCanvas* surface) {
     this->endRecording();
     if (fPlayback) {
@@ -272,7 +365,41 @@ SkPicture::SkPicture(SkStream* stream, bool* success, InstallPixelRefProc proc)
     this->initFromStream(stream, success, proc);
 }
 
-void SkPicture::initFromStream(SkStream* stream, bool* success, InstallPixelRefProc proc) {
+SkPicture* SkPicture::CreateFromData(SkData* data, InstallPixelRefProc proc) {
+    SkMemoryStream stream(data);
+    SkPicture* picture = SkNEW(SkPicture);
+    bool success;
+    picture->initFromStream(&stream, &success, proc, true);
+    if (!success) {
+        picture->unref();
+        return NULL;
+    }
+    return picture;
+}
+
+SkPicture* SkPicture::CreateFromFile(const char path[], InstallPixelRefProc proc) {
+    SkAutoTUnref<SkStream> stream(SkStream::NewFromFile(path));
+    if (NULL == stream.get()) {
+        return NULL;
+    }
+    // NewFromFile() returns an SkMemoryStream over the mapped file when it
+    // can map it.
+    if (NULL != stream->getMemoryBase()) {
+        SkAutoDataUnref data(static_cast<SkMemoryStream*>(stream.get())->copyToData());
+        return CreateFromData(data, proc);
+    }
+
+    bool success;
+    SkPicture* picture = SkNEW_ARGS(SkPicture, (stream, &success, proc));
+    if (!success) {
+        picture->unref();
+        return NULL;
+    }
+    return picture;
+}
+
+void SkPicture::initFromStream(SkStream* stream, bool* success, InstallPixelRefProc proc,
+                               bool inPlace) {
     if (success) {
         *success = false;
     }
@@ -282,15 +409,15 @@ void SkPicture::initFromStream(SkStream* stream, bool* success, InstallPixelRefP
 
     SkPictInfo info;
 
-    if (!stream->read(&info, sizeof(info))) {
+    if (sizeof(info) != stream->read(&info, sizeof(info))) {
         return;
     }
     if (PICTURE_VERSION != info.fVersion) {
         return;
     }
 
-    if (stream->readBool()) {
-        fPlayback = SkNEW_ARGS(SkPicturePlayback, (stream, info, proc));
+    if (stream->readU32()) {
+        fPlayback = SkNEW_ARGS(SkPicturePlayback, (stream, info, proc, inPlace));
     }
 
     // do this at the end, so that they will be zero if we hit an error.
@@ -301,7 +428,7 @@ void SkPicture::initFromStream(SkStream* stream, bool* success, InstallPixelRefP
     }
 }
 
-void SkPicture::serialize(SkWStream* stream, EncodeBitmap encoder) const {
+void SkPicture::serialize(SkWStream* stream, EncodeBitmap encoder, uint32_t flags) const {
     SkPicturePlayback* playback = fPlayback;
 
     if (NULL == playback && fRecord) {
@@ -323,14 +450,15 @@ void SkPicture::serialize(SkWStream* stream, EncodeBitmap encoder) const {
 
     stream->write(&info, sizeof(info));
     if (playback) {
-        stream->writeBool(true);
-        playback->serialize(stream, encoder);
+        // 32 bits, to keep the playback's data aligned.
+        stream->write32(true);
+        playback->serialize(stream, encoder, flags);
         // delete playback if it is a local version (i.e. cons'd up just now)
         if (playback != fPlayback) {
             SkDELETE(playback);
         }
     } else {
-        stream->writeBool(false);
+        stream->write32(false);
     }
 }
 
@@ -405,9 +405,9 @@ public:
         fController->ref();
         // set to 1 since returning a zero from find() indicates failure
         fNextIndex = 1;
-        sk_bzero(fHash, sizeof(fHash));
         // index 0 is always empty since it is used as a signal that find failed
         fIndexedData.push(NULL);
+        this->resetHash(kInitialHashCount);
     }
 
     virtual ~SkFlatDictionary() {
@@ -415,13 +415,17 @@ public:
     }
 
     int count() const {
-        SkASSERT(fIndexedData.count() == fSortedData.count()+1);
-        return fSortedData.count();
+        SkASSERT(fIndexedData.count() == fNextIndex);
+        return fIndexedData.count() - 1;
     }
 
+    /**
+     * Returns the entries in the order they were added, so operator[](i) has
+     * index i + 1.
+     */
     const SkFlatData*  operator[](int index) const {
-        SkASSERT(index >= 0 && index < fSortedData.count());
-        return fSortedData[index];
+        SkASSERT(index >= 0 && index < this->count());
+        return fIndexedData[index + 1];
     }
 
     /**
@@ -429,12 +433,11 @@ public:
      * memory that was allocated for each entry.
      */
     void reset() {
-        fSortedData.reset();
         fIndexedData.rewind();
         // index 0 is always empty since it is used as a signal that find failed
         fIndexedData.push(NULL);
         fNextIndex = 1;
-        sk_bzero(fHash, sizeof(fHash));
+        this->resetHash(kInitialHashCount);
     }
 
     /**
@@ -448,34 +451,24 @@ public:
                                      const SkFlatData* toReplace, bool* added,
                                      bool* replaced) {
         SkASSERT(added != NULL && replaced != NULL);
-        int oldCount = fSortedData.count();
+        int oldCount = this->count();
         const SkFlatData* flat = this->findAndReturnFlat(element);
-        *added = fSortedData.count() == oldCount + 1;
+        *added = this->count() == oldCount + 1;
         *replaced = false;
-        if (*added && toReplace != NULL) {
-            // First, find the index of the one to replace
-            int indexToReplace = fSortedData.find(toReplace);
-            if (indexToReplace >= 0) {
-                // findAndReturnFlat set the index to fNextIndex and increased
-                // fNextIndex by one. Reuse the index from the one being
-                // replaced and reset fNextIndex to the proper value.
-                int oldIndex = flat->index();
-                const_cast<SkFlatData*>(flat)->setIndex(toReplace->index());
-                fIndexedData[toReplace->index()] = flat;
-                fNextIndex--;
-                // Remove from the arrays.
-                fSortedData.remove(indexToReplace);
-                fIndexedData.remove(oldIndex);
-                // Remove from the hash table.
-                int oldHash = ChecksumToHashIndex(toReplace->checksum());
-                if (fHash[oldHash] == toReplace) {
-                    fHash[oldHash] = NULL;
-                }
-                // Delete the actual object.
-                fController->unalloc((void*)toReplace);
-                *replaced = true;
-                SkASSERT(fIndexedData.count() == fSortedData.count()+1);
-            }
+        if (*added && toReplace != NULL && this->contains(toReplace)) {
+            // findAndReturnFlat set the index to fNextIndex and increased
+            // fNextIndex by one. Reuse the index from the one being
+            // replaced and reset fNextIndex to the proper value.
+            int oldIndex = flat->index();
+            const_cast<SkFlatData*>(flat)->setIndex(toReplace->index());
+            fIndexedData[toReplace->index()] = flat;
+            fNextIndex--;
+            fIndexedData.remove(oldIndex);
+            this->removeFromHash(toReplace);
+            // Delete the actual object.
+            fController->unalloc((void*)toReplace);
+            *replaced = true;
+            SkASSERT(fIndexedData.count() == fNextIndex);
         }
         return flat;
     }
@@ -486,7 +479,7 @@ public:
      * added.
      *
      * To make the Compare function fast, we write a sentinel value at the end
-     * of each block. The blocks in our fSortedData[] all have a 0 sentinel. The
+     * of each block. The blocks in the dictionary all have a 0 sentinel. The
      * newly created block we're comparing against has a -1 in the sentinel.
      *
      * This trick allows Compare to always loop until failure. If it fails on
@@ -501,7 +494,7 @@ public:
      *  if there no objects (instead of an empty array).
      */
     SkTRefArray<T>* unflattenToArray() const {
-        int count = fSortedData.count();
+        int count = this->count();
         SkTRefArray<T>* array = NULL;
         if (count > 0) {
             array = SkTRefArray<T>::Create(count);
@@ -514,7 +507,7 @@ public:
      * Unflatten the specific object at the given index
      */
     T* unflatten(int index) const {
-        SkASSERT(fIndexedData.count() == fSortedData.count()+1);
+        SkASSERT(fIndexedData.count() == fNextIndex);
         const SkFlatData* element = fIndexedData[index];
         SkASSERT(index == element->index());
 
@@ -526,30 +519,22 @@ public:
     const SkFlatData* findAndReturnFlat(const T& element) {
         SkFlatData* flat = SkFlatData::Create(fController, &element, fNextIndex, fFlattenProc);
 
-        int hashIndex = ChecksumToHashIndex(flat->checksum());
-        const SkFlatData* candidate = fHash[hashIndex];
-        if (candidate && !SkFlatData::Compare(flat, candidate)) {
-            fController->unalloc(flat);
-            return candidate;
-        }
-
-        int index = SkTSearch<SkFlatData>((const SkFlatData**) fSortedData.begin(),
-                                          fSortedData.count(), flat, sizeof(flat),
-                                          &SkFlatData::Compare);
-        if (index >= 0) {
+        int slot = this->findSlot(flat);
+        if (NULL != fHash[slot]) {
             fController->unalloc(flat);
-            fHash[hashIndex] = fSortedData[index];
-            return fSortedData[index];
+            return fHash[slot];
         }
 
-        index = ~index;
-        *fSortedData.insert(index) = flat;
-        *fIndexedData.insert(flat->index()) = flat;
-        SkASSERT(fSortedData.count() == fNextIndex);
+        *fIndexedData.append() = flat;
+        SkASSERT(flat->index() == fNextIndex);
         fNextIndex++;
         flat->setSentinelInCache();
-        fHash[hashIndex] = flat;
-        SkASSERT(fIndexedData.count() == fSortedData.count()+1);
+        fHash[slot] = flat;
+        if (fIndexedData.count() > (fHash.count() >> 1)) {
+            // Keep the table at most half full, so that probes stay short.
+            this->resetHash(fHash.count() << 1);
+        }
+        SkASSERT(fIndexedData.count() == fNextIndex);
         return flat;
     }
 
@@ -565,52 +550,105 @@ private:
     }
 
     void unflattenIntoArray(T* array) const {
-        const int count = fSortedData.count();
-        SkASSERT(fIndexedData.count() == fSortedData.count()+1);
-        const SkFlatData* const* iter = fSortedData.begin();
+        const int count = this->count();
+        const SkFlatData* const* iter = fIndexedData.begin() + 1;
         for (int i = 0; i < count; ++i) {
             const SkFlatData* element = iter[i];
-            int index = element->index() - 1;
-            SkASSERT((unsigned)index < (unsigned)count);
-            unflatten(&array[index], element);
+            SkASSERT(element->index() == i + 1);
+            unflatten(&array[i], element);
+        }
+    }
+
+    bool contains(const SkFlatData* flat) const {
+        int index = flat->index();
+        return index > 0 && index < fIndexedData.count() && fIndexedData[index] == flat;
+    }
+
+    /**
+     * Returns the slot in fHash that holds the entry equal to flat, or the
+     * empty slot where flat belongs if there is no such entry.
+     */
+    int findSlot(const SkFlatData* flat) const {
+        const int mask = fHash.count() - 1;
+        int slot = ChecksumToHashIndex(flat->checksum()) & mask;
+        for (;;) {
+            const SkFlatData* candidate = fHash[slot];
+            if (NULL == candidate || !SkFlatData::Compare(flat, candidate)) {
+                return slot;
+            }
+            slot = (slot + 1) & mask;
         }
     }
 
+    /**
+     * Sizes fHash to count slots, which must be a power of two, and fills it
+     * with the entries of fIndexedData.
+     */
+    void resetHash(int count) {
+        SkASSERT(SkIsPow2(count));
+        fHash.setCount(count);
+        sk_bzero(fHash.begin(), count * sizeof(const SkFlatData*));
+        const int mask = count - 1;
+        for (int i = 1; i < fIndexedData.count(); ++i) {
+            const SkFlatData* flat = fIndexedData[i];
+            int slot = ChecksumToHashIndex(flat->checksum()) & mask;
+            while (NULL != fHash[slot]) {
+                slot = (slot + 1) & mask;
+            }
+            fHash[slot] = flat;
+        }
+    }
+
+    void removeFromHash(const SkFlatData* flat) {
+        const int mask = fHash.count() - 1;
+        int slot = ChecksumToHashIndex(flat->checksum()) & mask;
+        while (fHash[slot] != flat) {
+            SkASSERT(NULL != fHash[slot]);
+            slot = (slot + 1) & mask;
+        }
+        // Move the entries that follow in the same run back over the hole,
+        // unless that would put them ahead of their own home slot, so that
+        // probes for them don't stop at the hole.
+        int hole = slot;
+        for (;;) {
+            slot = (slot + 1) & mask;
+            const SkFlatData* next = fHash[slot];
+            if (NULL == next) {
+                break;
+            }
+            int home = ChecksumToHashIndex(next->checksum()) & mask;
+            if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+                fHash[hole] = next;
+                hole = slot;
+            }
+        }
+        fHash[hole] = NULL;
+    }
+
     SkFlatController * const     fController;
     int                          fNextIndex;
 
-    // SkFlatDictionary has two copies of the data one indexed by the
-    // SkFlatData's index and the other sorted. The sorted data is used
-    // for finding and uniquification while the indexed copy is used
-    // for standard array-style lookups based on the SkFlatData's index
-    // (as in 'unflatten').
+    // fIndexedData holds the entries by the SkFlatData's index, for
+    // standard array-style lookups (as in 'unflatten'). Slot 0 is unused.
     SkTDArray<const SkFlatData*> fIndexedData;
-    // fSortedData is sorted by checksum/size/data.
-    SkTDArray<const SkFlatData*> fSortedData;
 
     enum {
         // Determined by trying diff values on picture-recording benchmarks
-        // (e.g. PictureRecordBench.cpp), choosing the smallest value that
-        // showed a big improvement. Even better would be to benchmark diff
-        // values on recording representative web-pages or other "real" content.
-        HASH_BITS   = 7,
-        HASH_MASK   = (1 << HASH_BITS) - 1,
-        HASH_COUNT  = 1 << HASH_BITS
+        // (e.g. PictureRecordBench.cpp). Pictures with only a few entries
+        // never need to grow the table.
+        kInitialHashCount = 1 << 7
     };
-    const SkFlatData* fHash[HASH_COUNT];
+    // fHash is an open-addressed hash table of the same entries, with
+    // linear probing. Its size is a power of two, at least twice the number
+    // of entries.
+    SkTDArray<const SkFlatData*> fHash;
 
     static int ChecksumToHashIndex(uint32_t checksum) {
-        int n = checksum;
-        if (HASH_BITS < 32) {
-            n ^= n >> 16;
-        }
-        if (HASH_BITS < 16) {
-            n ^= n >> 8;
-        }
-        if (HASH_BITS < 8) {
-            n ^= n >> 4;
-        }
-        return n & HASH_MASK;
+        // Mix the high bits of the checksum into the low bits the table uses.
+        checksum ^= checksum >> 16;
+        checksum *= 0x85EBCA6B;
+        checksum ^= checksum >> 13;
+        return (int)(checksum & 0x7FFFFFFF);
     }
 };
 
@@ -0,0 +1,882 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkPictureOptimizer.h"
+#include "SkCanvas.h"
+#include "SkColorPriv.h"
+#include "SkData.h"
+#include "SkPicturePlayback.h"
+#include "SkPictureRecord.h"
+#include "SkRRect.h"
+#include "SkShader.h"
+#include "SkXfermode.h"
+
+static bool is_matrix_op(DrawType type) {
+    switch (type) {
+        case CONCAT:
+        case ROTATE:
+        case SCALE:
+        case SET_MATRIX:
+        case SKEW:
+        case TRANSLATE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool is_clip_op(DrawType type) {
+    return CLIP_PATH == type || CLIP_REGION == type || CLIP_RECT == type || CLIP_RRECT == type;
+}
+
+static bool is_draw_op(DrawType type) {
+    return type >= DRAW_BITMAP && type <= DRAW_VERTICES && DRAW_DATA != type;
+}
+
+// Every draw op but these starts with its paint index (which is 0 for a NULL paint).
+static bool has_paint(DrawType type) {
+    return is_draw_op(type) && DRAW_CLEAR != type && DRAW_PICTURE != type;
+}
+
+// Is the supplied paint simply a color?
+static bool is_simple(const SkPaint& p) {
+    intptr_t orAccum = (intptr_t)p.getPathEffect()  |
+                       (intptr_t)p.getShader()      |
+                       (intptr_t)p.getXfermode()    |
+                       (intptr_t)p.getMaskFilter()  |
+                       (intptr_t)p.getColorFilter() |
+                       (intptr_t)p.getRasterizer()  |
+                       (intptr_t)p.getLooper()      |
+                       (intptr_t)p.getImageFilter();
+    return 0 == orAccum;
+}
+
+// Does drawing with the supplied paint replace every pixel it covers?
+static bool is_opaque(const SkPaint& p) {
+    intptr_t orAccum = (intptr_t)p.getPathEffect()  |
+                       (intptr_t)p.getMaskFilter()  |
+                       (intptr_t)p.getColorFilter() |
+                       (intptr_t)p.getRasterizer()  |
+                       (intptr_t)p.getLooper()      |
+                       (intptr_t)p.getImageFilter();
+    if (0 != orAccum) {
+        return false;
+    }
+
+    SkXfermode::Mode mode;
+    if (!SkXfermode::AsMode(p.getXfermode(), &mode)) {
+        return false;
+    }
+    if (SkXfermode::kSrc_Mode == mode) {
+        return true;
+    }
+    const SkShader* shader = p.getShader();
+    return SkXfermode::kSrcOver_Mode == mode && 0xFF == p.getAlpha() &&
+           (NULL == shader || shader->isOpaque());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+// What StateTracker knows of the canvas' state between a save and its restore.
+struct SkPictureOptimizer::State {
+    SkMatrix    fMatrix;
+    SkRect      fBounds;    // contains the clip, if fBounded
+    bool        fBounded;
+    bool        fAA;        // some pixels may be partially inside the clip
+    bool        fExpanded;  // a clip since the save may have grown the clip
+    bool        fLayer;     // this state was pushed by a saveLayer
+    uint32_t    fFlags;     // the SaveFlags that pushed this state
+};
+
+/*  Follows the matrix and clip through the ops, as the canvas would, in the
+    picture's own coordinates. The clip is only known by a rectangle that
+    contains it, since we don't know what the canvas we will be drawn into has
+    for its matrix and clip.
+ */
+class SkPictureOptimizer::StateTracker {
+public:
+    StateTracker() {
+        State* state = fStack.append();
+        state->fMatrix.reset();
+        state->fBounds.setEmpty();
+        state->fBounded = false;
+        state->fAA = false;
+        state->fExpanded = false;
+        state->fLayer = false;
+        state->fFlags = SkCanvas::kMatrixClip_SaveFlag;
+    }
+
+    const State& top() const { return fStack.top(); }
+
+    void save(uint32_t flags, bool layer) {
+        State state = fStack.top();
+        state.fExpanded = false;
+        state.fLayer = layer;
+        state.fFlags = flags;
+        fStack.push(state);
+    }
+
+    // Returns the state that was popped.
+    State restore() {
+        State popped = fStack.top();
+        if (fStack.count() > 1) {
+            fStack.pop();
+            State& state = fStack.top();
+            if (!(popped.fFlags & SkCanvas::kMatrix_SaveFlag)) {
+                state.fMatrix = popped.fMatrix;
+            }
+            if (!(popped.fFlags & SkCanvas::kClip_SaveFlag)) {
+                state.fBounds = popped.fBounds;
+                state.fBounded = popped.fBounded;
+                state.fAA = popped.fAA;
+                state.fExpanded |= popped.fExpanded;
+            }
+        }
+        return popped;
+    }
+
+    void setMatrix(const SkMatrix& matrix) { fStack.top().fMatrix = matrix; }
+    void concat(const SkMatrix& matrix) { fStack.top().fMatrix.preConcat(matrix); }
+
+    // bounds is NULL if the clip's shape is not known in the picture's coordinates.
+    void clip(const SkRect* bounds, SkRegion::Op op, bool doAA) {
+        State& state = fStack.top();
+        state.fAA |= doAA;
+        if (SkRegion::kIntersect_Op == op) {
+            if (NULL != bounds) {
+                SkRect mapped;
+                state.fMatrix.mapRect(&mapped, *bounds);
+                if (!state.fBounded) {
+                    state.fBounds = mapped;
+                    state.fBounded = true;
+                } else if (!state.fBounds.intersect(mapped)) {
+                    state.fBounds.setEmpty();
+                }
+            }
+        } else if (SkRegion::kDifference_Op != op) {
+            state.fBounded = false;
+            state.fExpanded = true;
+        }
+    }
+
+private:
+    SkTDArray<State> fStack;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+SkPictureOptimizer::SkPictureOptimizer(SkPicturePlayback* playback,
+                                       SkPicture::OptimizeStats* stats)
+    : fPlayback(playback)
+    , fStats(stats)
+    , fWords(NULL)
+    , fSize(0) {
+}
+
+SkPictureOptimizer::~SkPictureOptimizer() {
+    sk_free(fWords);
+    fNewPaints.deleteAll();
+}
+
+void SkPictureOptimizer::Optimize(SkPicturePlayback* playback,
+                                  SkPicture::OptimizeStats* stats) {
+    SkPicture::OptimizeStats localStats;
+    if (NULL == stats) {
+        stats = &localStats;
+    }
+    const int removedBefore = stats->removedOpCount();
+    SkPictureOptimizer optimizer(playback, stats);
+    if (!optimizer.parse()) {
+        return;
+    }
+
+    // Folding matrices and removing clips leaves more saves with nothing to
+    // restore, so look for those last.
+    optimizer.foldMatrices();
+    optimizer.removeRedundantClips();
+    optimizer.mergeSaveLayers();
+    optimizer.cullOccludedDraws();
+    optimizer.removeDeadSaveRestores();
+    optimizer.install();
+    playback->fAnalysis.fOpCount -= stats->removedOpCount() - removedBefore;
+}
+
+/*
+ *  Copies the op stream and finds where each op starts, and which saves and
+ *  restores go together. Returns false for streams we can't optimize: those
+ *  from old pictures, whose ops don't record their size.
+ */
+bool SkPictureOptimizer::parse() {
+    const SkData* data = fPlayback->fOpData;
+    if (NULL == data || 0 == data->size() || SkAlign4(data->size()) != data->size()) {
+        return false;
+    }
+    fSize = data->size();
+    fWords = (uint32_t*)sk_malloc_throw(fSize);
+    memcpy(fWords, data->data(), fSize);
+
+    SkTDArray<int> saves;
+    int opCount = 0;
+    uint32_t offset = 0;
+    while (offset < fSize) {
+        uint32_t header = fWords[offset / sizeof(uint32_t)];
+        if ((uint8_t)header == header) {
+            return false;
+        }
+        uint32_t type, size;
+        UNPACK_8_24(header, type, size);
+        uint32_t args = offset + sizeof(uint32_t);
+        if (MASK_24 == size) {
+            if (args >= fSize) {
+                return false;
+            }
+            size = fWords[args / sizeof(uint32_t)];
+            args += sizeof(uint32_t);
+        }
+        if (UNUSED == type || type > LAST_DRAWTYPE_ENUM || SkAlign4(size) != size ||
+            size < args - offset || size > fSize - offset) {
+            return false;
+        }
+
+        int index = fOps.count();
+        Op* op = fOps.append();
+        op->fOffset = offset;
+        op->fArgs = args;
+        op->fSize = size;
+        op->fType = (DrawType)type;
+        op->fMatch = -1;
+        op->fWasLayer = false;
+
+        if (SAVE == type || SAVE_LAYER == type) {
+            saves.push(index);
+        } else if (RESTORE == type && saves.count() > 0) {
+            int save;
+            saves.pop(&save);
+            fOps[save].fMatch = index;
+            op->fMatch = save;
+        }
+        if (NOOP != type) {
+            opCount += 1;
+        }
+        offset += size;
+    }
+
+    fStats->fOpCount += opCount;
+    return true;
+}
+
+/*
+ *  Hands our op stream, and the paints and matrices we added, to the playback.
+ */
+void SkPictureOptimizer::install() {
+    SkData* data = SkData::NewFromMalloc(fWords, fSize);
+    fWords = NULL;
+    fPlayback->fOpData->unref();
+    fPlayback->fOpData = data;
+
+    if (fNewPaints.count() > 0) {
+        const SkTRefArray<SkPaint>* oldPaints = fPlayback->fPaints;
+        int oldCount = NULL != oldPaints ? oldPaints->count() : 0;
+        SkTRefArray<SkPaint>* paints =
+            SkTRefArray<SkPaint>::Create(oldCount + fNewPaints.count());
+        for (int i = 0; i < oldCount; ++i) {
+            paints->writableAt(i) = (*oldPaints)[i];
+        }
+        for (int i = 0; i < fNewPaints.count(); ++i) {
+            paints->writableAt(oldCount + i) = *fNewPaints[i];
+        }
+        SkSafeUnref(oldPaints);
+        fPlayback->fPaints = paints;
+    }
+
+    if (fNewMatrices.count() > 0) {
+        const SkTRefArray<SkMatrix>* oldMatrices = fPlayback->fMatrices;
+        int oldCount = NULL != oldMatrices ? oldMatrices->count() : 0;
+        SkTRefArray<SkMatrix>* matrices =
+            SkTRefArray<SkMatrix>::Create(oldCount + fNewMatrices.count());
+        for (int i = 0; i < oldCount; ++i) {
+            matrices->writableAt(i) = (*oldMatrices)[i];
+        }
+        for (int i = 0; i < fNewMatrices.count(); ++i) {
+            matrices->writableAt(oldCount + i) = fNewMatrices[i];
+        }
+        SkSafeUnref(oldMatrices);
+        fPlayback->fMatrices = matrices;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SkPictureOptimizer::noop(int index) {
+    Op& op = fOps[index];
+    uint32_t* ptr = this->words(op);
+    // Leave the size alone so that the NOOP can be skipped.
+    *ptr = (*ptr & MASK_24) | (NOOP << 24);
+    op.fType = NOOP;
+}
+
+/*
+ *  Replaces an op with one taking a single argument, followed by a NOOP
+ *  covering whatever is left of the old op.
+ */
+void SkPictureOptimizer::rewrite(int index, DrawType type, uint32_t arg) {
+    Op& op = fOps[index];
+    static const uint32_t kNewSize = 2 * sizeof(uint32_t);
+    SkASSERT(op.fSize >= kNewSize && op.fSize - kNewSize < MASK_24);
+
+    uint32_t* ptr = this->words(op);
+    ptr[0] = PACK_8_24(type, kNewSize);
+    ptr[1] = arg;
+    if (op.fSize > kNewSize) {
+        ptr[2] = PACK_8_24(NOOP, (op.fSize - kNewSize));
+    }
+    op.fType = type;
+    op.fArgs = op.fOffset + sizeof(uint32_t);
+    op.fSize = kNewSize;
+}
+
+const SkPaint* SkPictureOptimizer::paint(uint32_t index) const {
+    if (0 == index) {
+        return NULL;
+    }
+    const SkTRefArray<SkPaint>* paints = fPlayback->fPaints;
+    uint32_t oldCount = NULL != paints ? paints->count() : 0;
+    if (index <= oldCount) {
+        return &(*paints)[index - 1];
+    }
+    return fNewPaints[index - oldCount - 1];
+}
+
+uint32_t SkPictureOptimizer::addPaint(const SkPaint& paint) {
+    const SkTRefArray<SkPaint>* paints = fPlayback->fPaints;
+    uint32_t oldCount = NULL != paints ? paints->count() : 0;
+    *fNewPaints.append() = SkNEW_ARGS(SkPaint, (paint));
+    return oldCount + fNewPaints.count();
+}
+
+const SkMatrix& SkPictureOptimizer::matrix(uint32_t index) const {
+    SkASSERT(index > 0);
+    const SkTRefArray<SkMatrix>* matrices = fPlayback->fMatrices;
+    uint32_t oldCount = NULL != matrices ? matrices->count() : 0;
+    if (index <= oldCount) {
+        return (*matrices)[index - 1];
+    }
+    return fNewMatrices[index - oldCount - 1];
+}
+
+uint32_t SkPictureOptimizer::addMatrix(const SkMatrix& matrix) {
+    const SkTRefArray<SkMatrix>* matrices = fPlayback->fMatrices;
+    uint32_t oldCount = NULL != matrices ? matrices->count() : 0;
+    *fNewMatrices.append() = matrix;
+    return oldCount + fNewMatrices.count();
+}
+
+// Returns the matrix a matrix op concatenates with the canvas' (or, for
+// SET_MATRIX, replaces it with).
+void SkPictureOptimizer::getOpMatrix(const Op& op, SkMatrix* matrix) const {
+    const uint32_t* args = this->args(op);
+    const SkScalar* scalars = (const SkScalar*)args;
+    switch (op.fType) {
+        case CONCAT:
+        case SET_MATRIX:
+            *matrix = this->matrix(args[0]);
+            break;
+        case ROTATE:
+            matrix->setRotate(scalars[0]);
+            break;
+        case SCALE:
+            matrix->setScale(scalars[0], scalars[1]);
+            break;
+        case SKEW:
+            matrix->setSkew(scalars[0], scalars[1]);
+            break;
+        case TRANSLATE:
+            matrix->setTranslate(scalars[0], scalars[1]);
+            break;
+        default:
+            SkASSERT(0);
+            matrix->reset();
+            break;
+    }
+}
+
+uint32_t SkPictureOptimizer::saveFlags(const Op& op) const {
+    if (SAVE == op.fType) {
+        return this->args(op)[0];
+    }
+    // SAVE_LAYER's flags are its last argument.
+    SkASSERT(SAVE_LAYER == op.fType);
+    return this->words(op)[op.fSize / sizeof(uint32_t) - 1];
+}
+
+/*
+ *  Computes the bounds, in local coordinates, of what a draw op can touch,
+ *  for the ops where that is cheap. Returns false for the others.
+ */
+bool SkPictureOptimizer::getDrawBounds(const Op& op, SkRect* bounds) const {
+    const uint32_t* args = this->args(op);
+    SkRect rect;
+    switch (op.fType) {
+        case DRAW_OVAL:
+        case DRAW_RECT:
+            rect = *(const SkRect*)(args + 1);
+            break;
+        case DRAW_RRECT: {
+            SkRRect rrect;
+            rrect.readFromMemory(args + 1);
+            rect = rrect.getBounds();
+        } break;
+        case DRAW_PATH: {
+            const SkPath& path = (*fPlayback->fPathHeap)[args[1] - 1];
+            if (path.isInverseFillType()) {
+                return false;
+            }
+            rect = path.getBounds();
+        } break;
+        case DRAW_BITMAP_RECT_TO_RECT: {
+            // paint, bitmap, bool for the src rect, [src rect,] dst rect
+            const uint32_t* dst = args + 3 + (args[2] ? 4 : 0);
+            rect = *(const SkRect*)dst;
+        } break;
+        default:
+            return false;
+    }
+
+    const SkPaint* paint = this->paint(args[0]);
+    if (NULL == paint) {
+        *bounds = rect;
+        return true;
+    }
+    if (!paint->canComputeFastBounds()) {
+        return false;
+    }
+    *bounds = paint->computeFastBounds(rect, bounds);
+    return true;
+}
+
+/*
+ *  Applies a save, restore, matrix or clip op to tracker. Returns false if
+ *  the op was none of these.
+ */
+bool SkPictureOptimizer::trackState(int index, StateTracker* tracker) const {
+    const Op& op = fOps[index];
+    const uint32_t* args = this->args(op);
+    switch (op.fType) {
+        case SAVE:
+            tracker->save(args[0], false);
+            return true;
+        case SAVE_LAYER:
+            tracker->save(this->saveFlags(op), true);
+            return true;
+        case RESTORE:
+            tracker->restore();
+            return true;
+        case SET_MATRIX:
+            tracker->setMatrix(this->matrix(args[0]));
+            return true;
+        case CONCAT:
+        case ROTATE:
+        case SCALE:
+        case SKEW:
+        case TRANSLATE: {
+            SkMatrix matrix;
+            this->getOpMatrix(op, &matrix);
+            tracker->concat(matrix);
+        } return true;
+        case CLIP_RECT: {
+            // rect, clip params, restore offset
+            uint32_t packed = args[4];
+            tracker->clip((const SkRect*)args, ClipParams_unpackRegionOp(packed),
+                          ClipParams_unpackDoAA(packed));
+        } return true;
+        case CLIP_RRECT: {
+            // rrect, clip params, restore offset
+            SkRRect rrect;
+            size_t size = rrect.readFromMemory(args);
+            uint32_t packed = args[size / sizeof(uint32_t)];
+            tracker->clip(&rrect.getBounds(), ClipParams_unpackRegionOp(packed),
+                          ClipParams_unpackDoAA(packed));
+        } return true;
+        case CLIP_PATH: {
+            // path index, clip params, restore offset
+            const SkPath& path = (*fPlayback->fPathHeap)[args[0] - 1];
+            uint32_t packed = args[1];
+            tracker->clip(path.isInverseFillType() ? NULL : &path.getBounds(),
+                          ClipParams_unpackRegionOp(packed), ClipParams_unpackDoAA(packed));
+        } return true;
+        case CLIP_REGION:
+            // Regions are in device coordinates, so tell us nothing about
+            // the clip in ours.
+            tracker->clip(NULL, ClipParams_unpackRegionOp(args[1]), false);
+            return true;
+        default:
+            return false;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ *  Replaces each run of matrix ops with a single CONCAT or SET_MATRIX of
+ *  their product, and removes the runs that have no effect: those that
+ *  multiply out to the identity, and those undone by the restore that follows
+ *  them. This may change the matrix in its last bits.
+ */
+void SkPictureOptimizer::foldMatrices() {
+    SkTDArray<int> run;
+    for (int i = 0; i < fOps.count(); ++i) {
+        DrawType type = fOps[i].fType;
+        if (NOOP == type) {
+            continue;
+        }
+        if (is_matrix_op(type)) {
+            *run.append() = i;
+            continue;
+        }
+        this->foldMatrixRun(run, i);
+        run.rewind();
+    }
+    this->foldMatrixRun(run, -1);
+}
+
+// next is the index of the op after run, or -1 if run ends the picture.
+void SkPictureOptimizer::foldMatrixRun(const SkTDArray<int>& run, int next) {
+    if (0 == run.count()) {
+        return;
+    }
+
+    if (next >= 0 && RESTORE == fOps[next].fType && fOps[next].fMatch >= 0 &&
+        (this->saveFlags(fOps[fOps[next].fMatch]) & SkCanvas::kMatrix_SaveFlag)) {
+        for (int i = 0; i < run.count(); ++i) {
+            this->noop(run[i]);
+        }
+        fStats->fFoldedMatrixOps += run.count();
+        return;
+    }
+
+    // Nothing before the last SET_MATRIX matters.
+    int start = 0;
+    for (int i = 0; i < run.count(); ++i) {
+        if (SET_MATRIX == fOps[run[i]].fType) {
+            start = i;
+        }
+    }
+    for (int i = 0; i < start; ++i) {
+        this->noop(run[i]);
+    }
+    fStats->fFoldedMatrixOps += start;
+
+    bool isSet = SET_MATRIX == fOps[run[start]].fType;
+    SkMatrix product;
+    product.reset();
+    for (int i = start; i < run.count(); ++i) {
+        SkMatrix matrix;
+        this->getOpMatrix(fOps[run[i]], &matrix);
+        product.preConcat(matrix);
+    }
+
+    int count = run.count() - start;
+    if (!isSet && product.isIdentity()) {
+        for (int i = start; i < run.count(); ++i) {
+            this->noop(run[i]);
+        }
+        fStats->fFoldedMatrixOps += count;
+        return;
+    }
+    if (1 == count) {
+        return;
+    }
+
+    this->rewrite(run[start], isSet ? SET_MATRIX : CONCAT, this->addMatrix(product));
+    for (int i = start + 1; i < run.count(); ++i) {
+        this->noop(run[i]);
+    }
+    fStats->fFoldedMatrixOps += count - 1;
+}
+
+/*
+ *  Removes aliased, intersecting clipRects that contain the clip they are
+ *  applied to. Since aliased clips and rects cover the pixels whose centers
+ *  they contain, whatever the canvas' matrix, such a clip cannot remove any
+ *  pixel unless an antialiased clip came before it.
+ */
+void SkPictureOptimizer::removeRedundantClips() {
+    StateTracker tracker;
+    for (int i = 0; i < fOps.count(); ++i) {
+        const Op& op = fOps[i];
+        if (CLIP_RECT == op.fType) {
+            const State& state = tracker.top();
+            const uint32_t* args = this->args(op);
+            uint32_t packed = args[4];
+            if (SkRegion::kIntersect_Op == ClipParams_unpackRegionOp(packed) &&
+                !ClipParams_unpackDoAA(packed) && state.fBounded && !state.fAA &&
+                state.fMatrix.rectStaysRect()) {
+                SkRect mapped;
+                state.fMatrix.mapRect(&mapped, *(const SkRect*)args);
+                if (mapped.contains(state.fBounds)) {
+                    this->noop(i);
+                    fStats->fRedundantClips += 1;
+                    continue;
+                }
+            }
+        }
+        this->trackState(i, &tracker);
+    }
+}
+
+/*
+ *  Turns a saveLayer into a save when drawing its contents straight into the
+ *  canvas gives the same result:
+ *   - its paint is at most an alpha, and it only clips to bounds that its
+ *     draws are inside
+ *   - its draws all use SrcOver, so compositing them later changes nothing
+ *   - if it has an alpha, it holds a single draw that touches each pixel
+ *     once, whose paint can take that alpha instead.
+ */
+void SkPictureOptimizer::mergeSaveLayers() {
+    for (int i = 0; i < fOps.count(); ++i) {
+        const Op& op = fOps[i];
+        if (SAVE_LAYER != op.fType || op.fMatch < 0) {
+            continue;
+        }
+
+        // bool for bounds, [bounds,] paint index, flags
+        const uint32_t* args = this->args(op);
+        const SkRect* bounds = args[0] ? (const SkRect*)(args + 1) : NULL;
+        uint32_t flags = this->saveFlags(op);
+        if (!(flags & SkCanvas::kHasAlphaLayer_SaveFlag)) {
+            // An opaque layer doesn't start out transparent.
+            continue;
+        }
+        const SkPaint* layerPaint = this->paint(args[NULL != bounds ? 5 : 1]);
+        if (NULL != layerPaint && !is_simple(*layerPaint)) {
+            continue;
+        }
+        U8CPU alpha = NULL != layerPaint ? layerPaint->getAlpha() : 0xFF;
+
+        bool mergeable = true;
+        bool matrixChanged = false;
+        int drawCount = 0;
+        int draw = -1;
+        for (int j = i + 1; j < op.fMatch && mergeable; ++j) {
+            const Op& inner = fOps[j];
+            if (is_matrix_op(inner.fType)) {
+                matrixChanged = true;
+                continue;
+            }
+            if (!is_draw_op(inner.fType)) {
+                // Saves, restores and clips are unchanged without the layer.
+                mergeable = SAVE_LAYER != inner.fType;
+                continue;
+            }
+            if (!has_paint(inner.fType)) {
+                // A clear would clear the canvas, and pictures could hold anything.
+                mergeable = false;
+                continue;
+            }
+            const SkPaint* paint = this->paint(this->args(inner)[0]);
+            if (NULL != paint && !SkXfermode::IsMode(paint->getXfermode(),
+                                                     SkXfermode::kSrcOver_Mode)) {
+                mergeable = false;
+                continue;
+            }
+            if (NULL != bounds) {
+                SkRect drawBounds;
+                mergeable = !matrixChanged && this->getDrawBounds(inner, &drawBounds) &&
+                            bounds->contains(drawBounds);
+            }
+            drawCount += 1;
+            draw = j;
+        }
+
+        if (!mergeable) {
+            continue;
+        }
+        if (0xFF != alpha && drawCount > 0) {
+            if (1 != drawCount || !this->mergeLayerAlpha(draw, alpha)) {
+                continue;
+            }
+        }
+
+        this->rewrite(i, SAVE, flags & SkCanvas::kMatrixClip_SaveFlag);
+        fOps[i].fWasLayer = true;
+        fStats->fMergedSaveLayers += 1;
+    }
+}
+
+/*
+ *  Applies a layer's alpha to the draw op at index instead, if the draw
+ *  touches each pixel once and its paint applies alpha last. Returns false if
+ *  it can't.
+ */
+bool SkPictureOptimizer::mergeLayerAlpha(int index, U8CPU alpha) {
+    const Op& op = fOps[index];
+    switch (op.fType) {
+        case DRAW_BITMAP:
+        case DRAW_BITMAP_MATRIX:
+        case DRAW_BITMAP_NINE:
+        case DRAW_BITMAP_RECT_TO_RECT:
+        case DRAW_OVAL:
+        case DRAW_PAINT:
+        case DRAW_PATH:
+        case DRAW_RECT:
+        case DRAW_RRECT:
+        case DRAW_SPRITE:
+            break;
+        default:
+            // Points, glyphs and triangles can overlap each other.
+            return false;
+    }
+
+    uint32_t* paintIndex = this->words(op) + (op.fArgs - op.fOffset) / sizeof(uint32_t);
+    SkPaint paint;
+    const SkPaint* drawPaint = this->paint(*paintIndex);
+    if (NULL != drawPaint) {
+        if (NULL != drawPaint->getColorFilter() || NULL != drawPaint->getLooper() ||
+            NULL != drawPaint->getImageFilter()) {
+            return false;
+        }
+        // Hairlines draw each segment on its own, so they can overlap themselves.
+        if (SkPaint::kFill_Style != drawPaint->getStyle() && 0 == drawPaint->getStrokeWidth()) {
+            return false;
+        }
+        paint = *drawPaint;
+    }
+    paint.setAlpha(SkMulDiv255Round(paint.getAlpha(), alpha));
+    *paintIndex = this->addPaint(paint);
+    return true;
+}
+
+/*
+ *  Removes draws that a later draw into the same layer covers with opaque
+ *  pixels, before the clip has changed: a clear, an opaque drawPaint, or an
+ *  opaque, aliased rect containing the clip. Draws inside nested saves count
+ *  too, as long as their clips only shrank. This assumes the canvas the
+ *  picture is drawn into does not have an antialiased clip.
+ */
+void SkPictureOptimizer::cullOccludedDraws() {
+    StateTracker tracker;
+    SkTDArray<int> pending;     // draws a later opaque draw would hide
+    for (int i = 0; i < fOps.count(); ++i) {
+        const Op& op = fOps[i];
+        DrawType type = op.fType;
+        if (NOOP == type) {
+            continue;
+        }
+        if (SAVE_LAYER == type || is_clip_op(type)) {
+            pending.rewind();
+            this->trackState(i, &tracker);
+            continue;
+        }
+        if (RESTORE == type) {
+            State popped = tracker.restore();
+            if (popped.fLayer || popped.fExpanded) {
+                pending.rewind();
+            }
+            continue;
+        }
+        if (this->trackState(i, &tracker) || !is_draw_op(type)) {
+            continue;
+        }
+
+        if (this->isOccluder(op, tracker.top())) {
+            for (int j = 0; j < pending.count(); ++j) {
+                this->noop(pending[j]);
+            }
+            fStats->fOccludedDraws += pending.count();
+            pending.rewind();
+        }
+        if (DRAW_PICTURE != type) {
+            // A picture's own clips could let it draw outside ours.
+            *pending.append() = i;
+        }
+    }
+}
+
+bool SkPictureOptimizer::isOccluder(const Op& op,
+                                    const State& state) const {
+    if (DRAW_CLEAR == op.fType) {
+        // Clearing ignores the clip.
+        return true;
+    }
+    if (state.fAA) {
+        return false;
+    }
+
+    const uint32_t* args = this->args(op);
+    if (DRAW_PAINT == op.fType) {
+        return is_opaque(*this->paint(args[0]));
+    }
+    if (DRAW_RECT == op.fType) {
+        const SkPaint& paint = *this->paint(args[0]);
+        if (!is_opaque(paint) || paint.isAntiAlias() ||
+            SkPaint::kFill_Style != paint.getStyle()) {
+            return false;
+        }
+        if (!state.fBounded || !state.fMatrix.rectStaysRect()) {
+            return false;
+        }
+        SkRect mapped;
+        state.fMatrix.mapRect(&mapped, *(const SkRect*)(args + 1));
+        return mapped.contains(state.fBounds);
+    }
+    return false;
+}
+
+/*
+ *  Removes save/restore pairs with no matrix or clip op between them, which
+ *  leaves nothing for the restore to undo. A change inside a nested save
+ *  that does not restore it, such as a clip inside a matrix-only save, counts
+ *  as a change of the enclosing level too. Saves that were layers are kept
+ *  for the state tree, which restores them.
+ */
+void SkPictureOptimizer::removeDeadSaveRestores() {
+    struct Level {
+        int     fSave;
+        bool    fMatrixChanged;
+        bool    fClipChanged;
+    };
+    SkTDArray<Level> levels;
+    for (int i = 0; i < fOps.count(); ++i) {
+        DrawType type = fOps[i].fType;
+        if (SAVE == type || SAVE_LAYER == type) {
+            Level* level = levels.append();
+            level->fSave = i;
+            level->fMatrixChanged = false;
+            level->fClipChanged = false;
+        } else if (RESTORE == type) {
+            if (0 == levels.count()) {
+                continue;
+            }
+            Level level;
+            levels.pop(&level);
+            const Op& save = fOps[level.fSave];
+            const uint32_t flags = this->saveFlags(save);
+            if (levels.count() > 0) {
+                Level& parent = levels.top();
+                if (level.fMatrixChanged && !(flags & SkCanvas::kMatrix_SaveFlag)) {
+                    parent.fMatrixChanged = true;
+                }
+                if (level.fClipChanged && !(flags & SkCanvas::kClip_SaveFlag)) {
+                    parent.fClipChanged = true;
+                }
+            }
+            if (!level.fMatrixChanged && !level.fClipChanged &&
+                SAVE == save.fType && !save.fWasLayer && i == save.fMatch) {
+                this->noop(level.fSave);
+                this->noop(i);
+                fStats->fDeadSaveRestores += 1;
+            }
+        } else if (levels.count() > 0) {
+            if (is_matrix_op(type)) {
+                levels.top().fMatrixChanged = true;
+            } else if (is_clip_op(type)) {
+                levels.top().fClipChanged = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkPictureOptimizer_DEFINED
+#define SkPictureOptimizer_DEFINED
+
+#include "SkMatrix.h"
+#include "SkPaint.h"
+#include "SkPicture.h"
+#include "SkPictureFlat.h"
+#include "SkTDArray.h"
+
+class SkPicturePlayback;
+
+/** \class SkPictureOptimizer
+
+    Rewrites the op stream of a finished SkPicturePlayback so that it does less
+    work each time it is played back, without changing what it draws. This is
+    the home for optimizations that need to see the whole picture, where the
+    peepholes in SkPictureRecord only see the ops recorded so far.
+
+    Ops are never moved: the ones that are no longer needed become NOOPs, and
+    rewritten ones are padded out to their old size with a NOOP. That keeps
+    valid every offset into the stream held by clip ops, the bounding box
+    hierarchy and the state tree.
+*/
+class SkPictureOptimizer : SkNoncopyable {
+public:
+    /** Optimizes playback in place, adding what was done to stats if it is
+        not NULL. The playback must not be drawing, or shared with clones.
+    */
+    static void Optimize(SkPicturePlayback* playback, SkPicture::OptimizeStats* stats);
+
+private:
+    struct Op {
+        uint32_t    fOffset;    // of the op code, in bytes
+        uint32_t    fArgs;      // offset of the op's first argument
+        uint32_t    fSize;      // of the whole op, in bytes
+        DrawType    fType;
+        int         fMatch;     // index of the matching save/restore, or -1
+        bool        fWasLayer;  // a SAVE_LAYER that was turned into a SAVE
+    };
+
+    struct State;
+    class StateTracker;
+
+    SkPictureOptimizer(SkPicturePlayback* playback, SkPicture::OptimizeStats* stats);
+    ~SkPictureOptimizer();
+
+    bool parse();
+    void foldMatrices();
+    void removeRedundantClips();
+    void mergeSaveLayers();
+    void cullOccludedDraws();
+    void removeDeadSaveRestores();
+    void install();
+
+    void foldMatrixRun(const SkTDArray<int>& run, int next);
+    bool trackState(int index, StateTracker* tracker) const;
+    bool mergeLayerAlpha(int index, U8CPU alpha);
+    bool isOccluder(const Op& op, const State& state) const;
+
+    uint32_t* words(const Op& op) const { return fWords + op.fOffset / sizeof(uint32_t); }
+    const uint32_t* args(const Op& op) const { return fWords + op.fArgs / sizeof(uint32_t); }
+    void noop(int index);
+    void rewrite(int index, DrawType type, uint32_t arg);
+
+    const SkPaint* paint(uint32_t index) const;
+    uint32_t addPaint(const SkPaint& paint);
+    const SkMatrix& matrix(uint32_t index) const;
+    uint32_t addMatrix(const SkMatrix& matrix);
+    void getOpMatrix(const Op& op, SkMatrix* matrix) const;
+    uint32_t saveFlags(const Op& op) const;
+    bool getDrawBounds(const Op& op, SkRect* bounds) const;
+
+    SkPicturePlayback*          fPlayback;
+    SkPicture::OptimizeStats*   fStats;
+    uint32_t*                   fWords;     // our copy of the op stream
+    size_t                      fSize;
+    SkTDArray<Op>               fOps;
+    SkTDArray<SkPaint*>         fNewPaints;
+    SkTDArray<SkMatrix>         fNewMatrices;
+};
+
+#endif
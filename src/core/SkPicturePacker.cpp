@@ -0,0 +1,290 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkPicturePacker.h"
+#include "SkData.h"
+#include "SkFloatBits.h"
+#include "SkPictureFlat.h"
+#include "SkPictureRecord.h"
+
+// How each argument word is packed.
+enum {
+    kRaw_Form,          // the word's 4 bytes
+    kInt_Form,          // varint of the zigzagged int
+    kWholeFloat_Form,   // varint of the zigzagged float, which is a whole number
+    kFloatDelta_Form,   // varint of the zigzagged whole difference from the
+                        // float in the previous op of this type
+};
+
+// Ops whose size needs a word of its own are flagged in their word count.
+static const uint32_t kExtendedSize_Flag = 1;
+
+// Larger floats aren't worth packing, and may not fit in an int.
+static const float kMaxWholeFloat = 1 << 28;
+
+static inline uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (value >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static inline int varint_size(uint32_t value) {
+    int size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size += 1;
+    }
+    return size;
+}
+
+static inline uint8_t* write_varint(uint8_t* dst, uint32_t value) {
+    while (value >= 0x80) {
+        *dst++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *dst++ = (uint8_t)value;
+    return dst;
+}
+
+// Returns NULL if src runs past stop, or the varint is too long.
+static inline const uint8_t* read_varint(const uint8_t* src, const uint8_t* stop,
+                                         uint32_t* value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (src >= stop) {
+            return NULL;
+        }
+        uint8_t byte = *src++;
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (0 == (byte & 0x80)) {
+            *value = result;
+            return src;
+        }
+    }
+    return NULL;
+}
+
+// If the float in word is a whole number that comes back exactly, sets
+// *whole to it and returns true.
+static inline bool to_whole(uint32_t word, int32_t* whole) {
+    float value = SkBits2Float(word);
+    if (!(value > -kMaxWholeFloat && value < kMaxWholeFloat)) {
+        return false;
+    }
+    *whole = (int32_t)value;
+    return (uint32_t)SkFloat2Bits((float)*whole) == word;
+}
+
+/*
+ *  Picks the form of word that packs smallest, and writes it to dst.
+ *  prev is the word at the same place in the previous op of the same type,
+ *  or NULL.
+ */
+static inline uint8_t* pack_word(uint8_t* dst, uint32_t word, const uint32_t* prev,
+                                 unsigned* form) {
+    uint32_t best = zigzag(word);
+    int bestSize = varint_size(best);
+    *form = kInt_Form;
+
+    int32_t whole;
+    if (bestSize > 1 && to_whole(word, &whole)) {
+        uint32_t packed = zigzag(whole);
+        int size = varint_size(packed);
+        if (size < bestSize) {
+            best = packed;
+            bestSize = size;
+            *form = kWholeFloat_Form;
+        }
+    }
+
+    if (bestSize > 1 && NULL != prev) {
+        float delta = SkBits2Float(word) - SkBits2Float(*prev);
+        if (delta > -kMaxWholeFloat && delta < kMaxWholeFloat) {
+            int32_t wholeDelta = (int32_t)delta;
+            if ((uint32_t)SkFloat2Bits(SkBits2Float(*prev) + (float)wholeDelta) == word) {
+                uint32_t packed = zigzag(wholeDelta);
+                int size = varint_size(packed);
+                if (size < bestSize) {
+                    best = packed;
+                    bestSize = size;
+                    *form = kFloatDelta_Form;
+                }
+            }
+        }
+    }
+
+    if (bestSize >= 4) {
+        memcpy(dst, &word, sizeof(word));
+        *form = kRaw_Form;
+        return dst + sizeof(word);
+    }
+    return write_varint(dst, best);
+}
+
+SkData* SkPicturePacker::Pack(const SkData* ops) {
+    const uint32_t* words = (const uint32_t*)ops->data();
+    const size_t count = ops->size() / sizeof(uint32_t);
+    if (count * sizeof(uint32_t) != ops->size()) {
+        return NULL;
+    }
+
+    // Every word packs into at most 4 bytes and a quarter of a control byte,
+    // and every op adds at most 7 bytes: its type, its word count and a
+    // partly used control byte.
+    size_t worstSize = count * 4 + count / 4 + count * 7;
+    SkAutoTMalloc<uint8_t> storage(worstSize);
+    uint8_t* dst = storage.get();
+
+    // The arguments of the last op of each type, for delta coding.
+    const uint32_t* last[LAST_DRAWTYPE_ENUM + 1];
+    uint32_t lastCount[LAST_DRAWTYPE_ENUM + 1];
+    sk_bzero(lastCount, sizeof(lastCount));
+
+    size_t index = 0;
+    while (index < count) {
+        uint32_t header = words[index];
+        if ((uint8_t)header == header) {
+            // Old pictures don't record the size of each op.
+            return NULL;
+        }
+        uint32_t op, size;
+        UNPACK_8_24(header, op, size);
+        uint32_t headerWords = 1;
+        uint32_t flags = 0;
+        if (MASK_24 == size) {
+            if (index + 1 >= count) {
+                return NULL;
+            }
+            size = words[index + 1];
+            headerWords = 2;
+            flags = kExtendedSize_Flag;
+        }
+        if (op > LAST_DRAWTYPE_ENUM || 0 != (size & 3) ||
+            size < headerWords * sizeof(uint32_t) || size / sizeof(uint32_t) > count - index) {
+            return NULL;
+        }
+        uint32_t argCount = size / sizeof(uint32_t) - headerWords;
+
+        *dst++ = (uint8_t)op;
+        dst = write_varint(dst, (argCount << 1) | flags);
+
+        const uint32_t* args = words + index + headerWords;
+        index += headerWords + argCount;
+        if (NOOP == op) {
+            // Nothing reads what a NOOP holds.
+            continue;
+        }
+
+        const uint32_t* prev = last[op];
+        uint32_t prevCount = lastCount[op];
+        for (uint32_t i = 0; i < argCount; i += 4) {
+            uint8_t* control = dst++;
+            unsigned forms = 0;
+            for (uint32_t j = i; j < argCount && j < i + 4; ++j) {
+                unsigned form;
+                dst = pack_word(dst, args[j], j < prevCount ? &prev[j] : NULL, &form);
+                forms |= form << (2 * (j - i));
+            }
+            *control = (uint8_t)forms;
+        }
+        last[op] = args;
+        lastCount[op] = argCount;
+    }
+
+    // Copy, rather than keep the worst case allocation.
+    return SkData::NewWithCopy(storage.get(), dst - storage.get());
+}
+
+bool SkPicturePacker::Unpack(const void* packed, size_t size, void* dst, size_t dstSize) {
+    const uint8_t* src = (const uint8_t*)packed;
+    const uint8_t* srcStop = src + size;
+    uint32_t* words = (uint32_t*)dst;
+    const size_t count = dstSize / sizeof(uint32_t);
+    if (count * sizeof(uint32_t) != dstSize) {
+        return false;
+    }
+
+    const uint32_t* last[LAST_DRAWTYPE_ENUM + 1];
+    uint32_t lastCount[LAST_DRAWTYPE_ENUM + 1];
+    sk_bzero(lastCount, sizeof(lastCount));
+
+    size_t index = 0;
+    while (index < count) {
+        if (src >= srcStop) {
+            return false;
+        }
+        uint32_t op = *src++;
+        uint32_t countAndFlags;
+        src = read_varint(src, srcStop, &countAndFlags);
+        if (NULL == src || op > LAST_DRAWTYPE_ENUM) {
+            return false;
+        }
+        uint32_t argCount = countAndFlags >> 1;
+        uint32_t headerWords = (countAndFlags & kExtendedSize_Flag) ? 2 : 1;
+        if (headerWords > count - index || argCount > count - index - headerWords) {
+            return false;
+        }
+        uint32_t opSize = (headerWords + argCount) * sizeof(uint32_t);
+        if (2 == headerWords) {
+            words[index] = PACK_8_24(op, MASK_24);
+            words[index + 1] = opSize;
+        } else {
+            if (opSize >= MASK_24) {
+                return false;
+            }
+            words[index] = PACK_8_24(op, opSize);
+        }
+
+        uint32_t* args = words + index + headerWords;
+        index += headerWords + argCount;
+        if (NOOP == op) {
+            sk_bzero(args, argCount * sizeof(uint32_t));
+            continue;
+        }
+
+        const uint32_t* prev = last[op];
+        uint32_t prevCount = lastCount[op];
+        for (uint32_t i = 0; i < argCount; i += 4) {
+            if (src >= srcStop) {
+                return false;
+            }
+            unsigned forms = *src++;
+            for (uint32_t j = i; j < argCount && j < i + 4; ++j, forms >>= 2) {
+                unsigned form = forms & 3;
+                if (kRaw_Form == form) {
+                    if ((size_t)(srcStop - src) < sizeof(uint32_t)) {
+                        return false;
+                    }
+                    memcpy(&args[j], src, sizeof(uint32_t));
+                    src += sizeof(uint32_t);
+                    continue;
+                }
+
+                uint32_t value;
+                src = read_varint(src, srcStop, &value);
+                if (NULL == src) {
+                    return false;
+                }
+                if (kInt_Form == form) {
+                    args[j] = unzigzag(value);
+                } else if (kWholeFloat_Form == form) {
+                    args[j] = SkFloat2Bits((float)unzigzag(value));
+                } else {
+                    if (j >= prevCount) {
+                        return false;
+                    }
+                    args[j] = SkFloat2Bits(SkBits2Float(prev[j]) + (float)unzigzag(value));
+                }
+            }
+        }
+        last[op] = args;
+        lastCount[op] = argCount;
+    }
+    return true;
+}
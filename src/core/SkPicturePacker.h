@@ -0,0 +1,45 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkPicturePacker_DEFINED
+#define SkPicturePacker_DEFINED
+
+#include "SkTypes.h"
+
+class SkData;
+
+/** \class SkPicturePacker
+
+    Packs a picture's op stream into a compact, byte-oriented form for
+    serialization, and unpacks it again. Playback always works on the
+    unpacked stream of 32-bit words; packing only shrinks what is written.
+
+    Each op is packed as its DrawType in a byte followed by its number of
+    argument words as a varint. Each argument word is then written in the
+    smallest of four forms, which a 2-bit code in a control byte ahead of
+    every four words selects: the raw word, a zigzag varint of the word as an
+    int, a zigzag varint of the word as a whole float, or a zigzag varint of
+    the whole difference between the word as a float and the float at the
+    same place in the previous op of the same type. Each form gives back the
+    exact bits of the word, so packing is lossless, except that the contents
+    of NOOPs are dropped.
+*/
+class SkPicturePacker {
+public:
+    /** Returns ops packed, or NULL if they can't be: streams from old
+        pictures don't record the size of each op.
+    */
+    static SkData* Pack(const SkData* ops);
+
+    /** Unpacks size bytes of packed ops into dst, which has room for exactly
+        dstSize bytes of ops. Returns false if packed does not unpack to
+        dstSize bytes of ops.
+    */
+    static bool Unpack(const void* packed, size_t size, void* dst, size_t dstSize);
+};
+
+#endif
@@ -6,6 +6,7 @@
  * found in the LICENSE file.
  */
 #include "SkPicturePlayback.h"
+#include "SkPicturePacker.h"
 #include "SkPictureRecord.h"
 #include "SkTypeface.h"
 #include "SkOrderedReadBuffer.h"
@@ -69,6 +70,7 @@ SkPicturePlayback::SkPicturePlayback(const SkPictureRecord& record, bool deepCop
     record.validate(record.writeStream().size(), 0);
     const SkWriter32& writer = record.writeStream();
     init();
+    record.getAnalysis(&fAnalysis);
     if (writer.size() == 0) {
         fOpData = SkData::NewEmpty();
         return;
@@ -173,6 +175,7 @@ SkPicturePlayback::SkPicturePlayback(const SkPicturePlayback& src, SkPictCopyInf
     fMatrices = SkSafeRef(src.fMatrices);
     fRegions = SkSafeRef(src.fRegions);
     fOpData = SkSafeRef(src.fOpData);
+    fAnalysis = src.fAnalysis;
 
     fBoundingHierarchy = src.fBoundingHierarchy;
     fStateTree = src.fStateTree;
@@ -180,6 +183,12 @@ SkPicturePlayback::SkPicturePlayback(const SkPicturePlayback& src, SkPictCopyInf
     SkSafeRef(fBoundingHierarchy);
     SkSafeRef(fStateTree);
 
+    // Clones must not share the pictures spliced into src, which a later
+    // splice would draw from again; a clone spliced into nests instead.
+    if (NULL == deepCopyInfo) {
+        fSplices = SkSafeRef(src.fSplices);
+    }
+
     if (deepCopyInfo) {
         int paintCount = SafeCount(src.fPaints);
 
@@ -270,6 +279,8 @@ void SkPicturePlayback::init() {
     fFactoryPlayback = NULL;
     fBoundingHierarchy = NULL;
     fStateTree = NULL;
+    fSplices = NULL;
+    fAnalysis = SkPicture::Analysis();
 }
 
 SkPicturePlayback::~SkPicturePlayback() {
@@ -281,6 +292,7 @@ SkPicturePlayback::~SkPicturePlayback() {
     SkSafeUnref(fRegions);
     SkSafeUnref(fBoundingHierarchy);
     SkSafeUnref(fStateTree);
+    SkSafeUnref(fSplices);
 
     for (int i = 0; i < fPictureCount; i++) {
         fPictureRefs[i]->unref();
@@ -304,9 +316,16 @@ void SkPicturePlayback::dumpSize() const {
 ///////////////////////////////////////////////////////////////////////////////
 
 #define PICT_READER_TAG     SkSetFourByteTag('r', 'e', 'a', 'd')
+// The op data, packed by SkPicturePacker: its unpacked size, then the packed
+// bytes, padded to a multiple of 4
+#define PICT_PACKED_READER_TAG  SkSetFourByteTag('p', 'a', 'c', 'k')
 #define PICT_FACTORY_TAG    SkSetFourByteTag('f', 'a', 'c', 't')
 #define PICT_TYPEFACE_TAG   SkSetFourByteTag('t', 'p', 'f', 'c')
 #define PICT_PICTURE_TAG    SkSetFourByteTag('p', 'c', 't', 'r')
+// The SkPicture::Analysis made while recording; its size is in bytes
+#define PICT_ANALYSIS_TAG   SkSetFourByteTag('a', 'n', 'l', 'y')
+// Padding, so that what follows is 4-byte aligned in the stream
+#define PICT_ALIGN_TAG      SkSetFourByteTag('a', 'l', 'g', 'n')
 
 // This tag specifies the size of the ReadBuffer, needed for the following tags
 #define PICT_BUFFER_SIZE_TAG     SkSetFourByteTag('a', 'r', 'a', 'y')
@@ -328,12 +347,61 @@ static void writeTagSize(SkOrderedWriteBuffer& buffer, uint32_t tag,
     buffer.writeUInt(size);
 }
 
+static const uint8_t gZeroPadding[3] = { 0, 0, 0 };
+
 static void writeTagSize(SkWStream* stream, uint32_t tag,
                          uint32_t size) {
     stream->write32(tag);
     stream->write32(size);
 }
 
+enum {
+    kOpaque_AnalysisFlag        = 0x01,
+    kHasText_AnalysisFlag       = 0x02,
+    kHasBitmaps_AnalysisFlag    = 0x04,
+    kHasSaveLayers_AnalysisFlag = 0x08,
+};
+
+static const uint32_t kAnalysisSize = sizeof(SkRect) + 3 * sizeof(uint32_t);
+
+static void writeAnalysis(SkWStream* stream, const SkPicture::Analysis& analysis) {
+    writeTagSize(stream, PICT_ANALYSIS_TAG, kAnalysisSize);
+    stream->write(&analysis.fBounds, sizeof(SkRect));
+    uint32_t flags = 0;
+    if (analysis.fOpaque) {
+        flags |= kOpaque_AnalysisFlag;
+    }
+    if (analysis.fHasText) {
+        flags |= kHasText_AnalysisFlag;
+    }
+    if (analysis.fHasBitmaps) {
+        flags |= kHasBitmaps_AnalysisFlag;
+    }
+    if (analysis.fHasSaveLayers) {
+        flags |= kHasSaveLayers_AnalysisFlag;
+    }
+    stream->write32(flags);
+    stream->write32(analysis.fOpCount);
+    stream->write(&analysis.fRasterCost, sizeof(float));
+}
+
+static void readAnalysis(SkStream* stream, size_t size, SkPicture::Analysis* analysis) {
+    if (size < kAnalysisSize) {
+        stream->skip(size);
+        return;
+    }
+    stream->read(&analysis->fBounds, sizeof(SkRect));
+    uint32_t flags = stream->readU32();
+    analysis->fOpaque = SkToBool(flags & kOpaque_AnalysisFlag);
+    analysis->fHasText = SkToBool(flags & kHasText_AnalysisFlag);
+    analysis->fHasBitmaps = SkToBool(flags & kHasBitmaps_AnalysisFlag);
+    analysis->fHasSaveLayers = SkToBool(flags & kHasSaveLayers_AnalysisFlag);
+    analysis->fOpCount = stream->readS32();
+    stream->read(&analysis->fRasterCost, sizeof(float));
+    // Skip anything a later version added.
+    stream->skip(size - kAnalysisSize);
+}
+
 static void writeFactories(SkWStream* stream, const SkFactorySet& rec) {
     int count = rec.count();
 
@@ -409,14 +477,29 @@ void SkPicturePlayback::flattenToBuffer(SkOrderedWriteBuffer& buffer) const {
 }
 
 void SkPicturePlayback::serialize(SkWStream* stream,
-                                  SkPicture::EncodeBitmap encoder) const {
-    writeTagSize(stream, PICT_READER_TAG, fOpData->size());
-    stream->write(fOpData->bytes(), fOpData->size());
+                                  SkPicture::EncodeBitmap encoder, uint32_t flags) const {
+    SkAutoTUnref<SkData> packed;
+    if (flags & SkPicture::kPackOps_SerializeFlag) {
+        packed.reset(SkPicturePacker::Pack(fOpData));
+    }
+    if (NULL != packed.get()) {
+        size_t padding = SkAlign4(packed->size()) - packed->size();
+        writeTagSize(stream, PICT_PACKED_READER_TAG,
+                     sizeof(uint32_t) + packed->size() + padding);
+        stream->write32(fOpData->size());
+        stream->write(packed->data(), packed->size());
+        stream->write(gZeroPadding, padding);
+    } else {
+        writeTagSize(stream, PICT_READER_TAG, fOpData->size());
+        stream->write(fOpData->bytes(), fOpData->size());
+    }
+
+    writeAnalysis(stream, fAnalysis);
 
     if (fPictureCount > 0) {
         writeTagSize(stream, PICT_PICTURE_TAG, fPictureCount);
         for (int i = 0; i < fPictureCount; i++) {
-            fPictureRefs[i]->serialize(stream, encoder);
+            fPictureRefs[i]->serialize(stream, encoder, flags);
         }
     }
 
@@ -438,8 +521,18 @@ void SkPicturePlayback::serialize(SkWStream* stream,
         // We have to write these to sets into the stream *before* we write
         // the buffer, since parsing that buffer will require that we already
         // have these sets available to use.
-        writeFactories(stream, factSet);
-        writeTypefaces(stream, typefaceSet);
+        SkDynamicMemoryWStream sets;
+        writeFactories(&sets, factSet);
+        writeTypefaces(&sets, typefaceSet);
+        SkAutoDataUnref setsData(sets.copyToData());
+        stream->write(setsData->data(), setsData->size());
+
+        // Pad the sets so that the buffer can be read in place.
+        size_t padding = SkAlign4(setsData->size()) - setsData->size();
+        if (padding > 0) {
+            writeTagSize(stream, PICT_ALIGN_TAG, padding);
+            stream->write(gZeroPadding, padding);
+        }
 
         writeTagSize(stream, PICT_BUFFER_SIZE_TAG, buffer.size());
         buffer.writeToStream(stream);
@@ -473,8 +566,25 @@ static uint32_t pictInfoFlagsToReadBufferFlags(uint32_t pictInfoFlags) {
     return rbMask;
 }
 
+/**
+ *  Returns the next size bytes of stream, which must be an SkMemoryStream,
+ *  without copying them, and skips past them. Returns NULL if they are not
+ *  4-byte aligned, and so can't be read in place.
+ */
+static SkData* in_place_data(SkStream* stream, size_t size) {
+    SkMemoryStream* memory = static_cast<SkMemoryStream*>(stream);
+    if (!SkIsAlign4((intptr_t)memory->getAtPos())) {
+        return NULL;
+    }
+    SkAutoDataUnref data(memory->copyToData());
+    size_t offset = (const char*)memory->getAtPos() - (const char*)memory->getMemoryBase();
+    memory->skip(size);
+    return SkData::NewSubset(data, offset, size);
+}
+
 void SkPicturePlayback::parseStreamTag(SkStream* stream, const SkPictInfo& info, uint32_t tag,
-                                       size_t size, SkPicture::InstallPixelRefProc proc) {
+                                       size_t size, SkPicture::InstallPixelRefProc proc,
+                                       bool inPlace) {
     /*
      *  By the time we encounter BUFFER_SIZE_TAG, we need to have already seen
      *  its dependents: FACTORY_TAG and TYPEFACE_TAG. These two are not required
@@ -488,10 +598,43 @@ void SkPicturePlayback::parseStreamTag(SkStream* stream, const SkPictInfo& info,
 
     switch (tag) {
         case PICT_READER_TAG: {
-            void* storage = sk_malloc_throw(size);
-            stream->read(storage, size);
             SkASSERT(NULL == fOpData);
-            fOpData = SkData::NewFromMalloc(storage, size);
+            if (inPlace) {
+                fOpData = in_place_data(stream, size);
+            }
+            if (NULL == fOpData) {
+                void* storage = sk_malloc_throw(size);
+                stream->read(storage, size);
+                fOpData = SkData::NewFromMalloc(storage, size);
+            }
+        } break;
+        case PICT_PACKED_READER_TAG: {
+            SkASSERT(NULL == fOpData);
+            SkAutoMalloc storage;
+            SkAutoTUnref<SkData> packedData(inPlace ? in_place_data(stream, size) : NULL);
+            const void* packed;
+            if (NULL != packedData.get()) {
+                packed = packedData->data();
+                size = packedData->size();
+            } else {
+                packed = storage.reset(size);
+                size = stream->read(storage.get(), size);
+            }
+
+            // Playing back ops that did not unpack would be unsafe, so
+            // leave them all out.
+            fOpData = SkData::NewEmpty();
+            if (size >= sizeof(uint32_t)) {
+                size_t opSize = *(const uint32_t*)packed;
+                void* ops = sk_malloc_throw(opSize);
+                if (SkPicturePacker::Unpack((const uint32_t*)packed + 1, size - sizeof(uint32_t),
+                                            ops, opSize)) {
+                    fOpData->unref();
+                    fOpData = SkData::NewFromMalloc(ops, opSize);
+                } else {
+                    sk_free(ops);
+                }
+            }
         } break;
         case PICT_FACTORY_TAG: {
             SkASSERT(!haveBuffer);
@@ -516,7 +659,8 @@ void SkPicturePlayback::parseStreamTag(SkStream* stream, const SkPictInfo& info,
             fPictureRefs = SkNEW_ARRAY(SkPicture*, fPictureCount);
             bool success;
             for (int i = 0; i < fPictureCount; i++) {
-                fPictureRefs[i] = SkNEW_ARGS(SkPicture, (stream, &success, proc));
+                fPictureRefs[i] = SkNEW(SkPicture);
+                fPictureRefs[i]->initFromStream(stream, &success, proc, inPlace);
                 // Success can only be false if PICTURE_VERSION does not match
                 // (which should never happen from here, since a sub picture will
                 // have the same PICTURE_VERSION as its parent) or if stream->read
@@ -525,11 +669,25 @@ void SkPicturePlayback::parseStreamTag(SkStream* stream, const SkPictInfo& info,
                 SkASSERT(success);
             }
         } break;
+        case PICT_ANALYSIS_TAG:
+            readAnalysis(stream, size, &fAnalysis);
+            break;
+        case PICT_ALIGN_TAG:
+            stream->skip(size);
+            break;
         case PICT_BUFFER_SIZE_TAG: {
-            SkAutoMalloc storage(size);
-            stream->read(storage.get(), size);
+            SkAutoMalloc storage;
+            SkAutoTUnref<SkData> flatData(inPlace ? in_place_data(stream, size) : NULL);
+            const void* flat;
+            if (NULL != flatData.get()) {
+                flat = flatData->data();
+                size = flatData->size();
+            } else {
+                flat = storage.reset(size);
+                stream->read(storage.get(), size);
+            }
 
-            SkOrderedReadBuffer buffer(storage.get(), size);
+            SkOrderedReadBuffer buffer(flat, size);
             buffer.setFlags(pictInfoFlagsToReadBufferFlags(info.fFlags));
 
             fFactoryPlayback->setupBuffer(buffer);
@@ -539,7 +697,7 @@ void SkPicturePlayback::parseStreamTag(SkStream* stream, const SkPictInfo& info,
             while (!buffer.eof()) {
                 tag = buffer.readUInt();
                 size = buffer.readUInt();
-                this->parseBufferTag(buffer, tag, size);
+                this->parseBufferTag(buffer, tag, size, flatData.get());
             }
             SkDEBUGCODE(haveBuffer = true;)
         } break;
@@ -547,7 +705,7 @@ void SkPicturePlayback::parseStreamTag(SkStream* stream, const SkPictInfo& info,
 }
 
 void SkPicturePlayback::parseBufferTag(SkOrderedReadBuffer& buffer,
-                                       uint32_t tag, size_t size) {
+                                       uint32_t tag, size_t size, SkData* flatData) {
     switch (tag) {
         case PICT_BITMAP_BUFFER_TAG: {
             fBitmaps = SkTRefArray<SkBitmap>::Create(size);
@@ -571,7 +729,13 @@ void SkPicturePlayback::parseBufferTag(SkOrderedReadBuffer& buffer,
         } break;
         case PICT_PATH_BUFFER_TAG:
             if (size > 0) {
-                fPathHeap.reset(SkNEW_ARGS(SkPathHeap, (buffer)));
+                if (NULL != flatData) {
+                    // A clipped playback only draws some of the paths, so
+                    // leave each one flattened until it is drawn.
+                    fPathHeap.reset(SkNEW_ARGS(SkPathHeap, (buffer, flatData)));
+                } else {
+                    fPathHeap.reset(SkNEW_ARGS(SkPathHeap, (buffer)));
+                }
             }
             break;
         case PICT_REGION_BUFFER_TAG: {
@@ -584,17 +748,18 @@ void SkPicturePlayback::parseBufferTag(SkOrderedReadBuffer& buffer,
 }
 
 SkPicturePlayback::SkPicturePlayback(SkStream* stream, const SkPictInfo& info,
-                                     SkPicture::InstallPixelRefProc proc) {
+                                     SkPicture::InstallPixelRefProc proc, bool inPlace) {
     this->init();
 
     for (;;) {
-        uint32_t tag = stream->readU32();
-        if (PICT_EOF_TAG == tag) {
+        uint32_t tag;
+        // Stop at the end of a truncated stream rather than spin on it.
+        if (sizeof(tag) != stream->read(&tag, sizeof(tag)) || PICT_EOF_TAG == tag) {
             break;
         }
 
         uint32_t size = stream->readU32();
-        this->parseStreamTag(stream, info, tag, size, proc);
+        this->parseStreamTag(stream, info, tag, size, proc, inPlace);
     }
 }
 
@@ -57,21 +57,75 @@ struct SkPictCopyInfo {
     SkTDArray<SkFlatData*> paintData;
 };
 
+/**
+ * What SkPicture::splice() has spliced into a picture: the commands the
+ * picture held before its first splice, and the replacement for each rect
+ * spliced over since, oldest first. A spliced picture draws the base clipped
+ * out of every rect, then each replacement clipped to the part of its rect
+ * that no later splice covers. Keeping these lets the next splice rebuild
+ * that small picture without nesting it inside another.
+ */
+class SkPictureSplices : public SkRefCnt {
+public:
+    struct Splice {
+        SkRect      fRect;
+        SkPicture*  fPicture;   // may be NULL
+    };
+
+    explicit SkPictureSplices(SkPicture* base) : fBase(SkRef(base)) {}
+    virtual ~SkPictureSplices() {
+        fBase->unref();
+        for (int i = 0; i < fSplices.count(); ++i) {
+            SkSafeUnref(fSplices[i].fPicture);
+        }
+    }
+
+    SkPicture* base() const { return fBase; }
+    const SkTDArray<Splice>& splices() const { return fSplices; }
+
+    void append(const SkRect& rect, SkPicture* picture) {
+        Splice* splice = fSplices.append();
+        splice->fRect = rect;
+        splice->fPicture = SkSafeRef(picture);
+    }
+
+private:
+    SkPicture*          fBase;
+    SkTDArray<Splice>   fSplices;
+
+    typedef SkRefCnt INHERITED;
+};
+
 class SkPicturePlayback {
 public:
     SkPicturePlayback();
     SkPicturePlayback(const SkPicturePlayback& src, SkPictCopyInfo* deepCopyInfo = NULL);
     explicit SkPicturePlayback(const SkPictureRecord& record, bool deepCopy = false);
-    SkPicturePlayback(SkStream*, const SkPictInfo&, SkPicture::InstallPixelRefProc);
+    /** If inPlace is true, stream must be an SkMemoryStream. The playback then
+        refs the stream's data, and reads its ops and paths from it rather
+        than copying them out.
+    */
+    SkPicturePlayback(SkStream*, const SkPictInfo&, SkPicture::InstallPixelRefProc,
+                      bool inPlace = false);
 
     virtual ~SkPicturePlayback();
 
     void draw(SkCanvas& canvas);
 
-    void serialize(SkWStream*, SkPicture::EncodeBitmap) const;
+    void serialize(SkWStream*, SkPicture::EncodeBitmap, uint32_t flags = 0) const;
 
     void dumpSize() const;
 
+    bool hasBoundingHierarchy() const { return NULL != fBoundingHierarchy; }
+
+    const SkPicture::Analysis& analysis() const { return fAnalysis; }
+
+    /** Returns what was spliced into the picture to make this playback, or
+        NULL if it was not made by SkPicture::splice().
+    */
+    SkPictureSplices* splices() const { return fSplices; }
+    void setSplices(SkPictureSplices* splices) { SkRefCnt_SafeAssign(fSplices, splices); }
+
 #ifdef SK_BUILD_FOR_ANDROID
     // Can be called in the middle of playback (the draw() call). WIll abort the
     // drawing and return from draw() after the "current" op code is done
@@ -192,8 +246,8 @@ public:
 
 private:    // these help us with reading/writing
     void parseStreamTag(SkStream*, const SkPictInfo&, uint32_t tag, size_t size,
-                        SkPicture::InstallPixelRefProc);
-    void parseBufferTag(SkOrderedReadBuffer&, uint32_t tag, size_t size);
+                        SkPicture::InstallPixelRefProc, bool inPlace);
+    void parseBufferTag(SkOrderedReadBuffer&, uint32_t tag, size_t size, SkData* flatData);
     void flattenToBuffer(SkOrderedWriteBuffer&) const;
 
 private:
@@ -217,12 +271,18 @@ private:
     SkBBoxHierarchy* fBoundingHierarchy;
     SkPictureStateTree* fStateTree;
 
+    SkPictureSplices* fSplices;
+
+    SkPicture::Analysis fAnalysis;
+
     SkTypefacePlayback fTFPlayback;
     SkFactoryPlayback* fFactoryPlayback;
 #ifdef SK_BUILD_FOR_ANDROID
     SkMutex fDrawMutex;
     bool fAbortCurrentPlayback;
 #endif
+
+    friend class SkPictureOptimizer;
 };
 
 #endif
@@ -11,6 +11,8 @@
 #include "SkRRect.h"
 #include "SkBBoxHierarchy.h"
 #include "SkPictureStateTree.h"
+#include "SkShader.h"
+#include "SkXfermode.h"
 
 #define MIN_WRITER_SIZE 16384
 #define HEAP_BLOCK_SIZE 4096
@@ -49,6 +51,9 @@ SkPictureRecord::SkPictureRecord(uint32_t flags, SkDevice* device) :
     fFirstSavedLayerIndex = kNoSavedLayerIndex;
 
     fInitialSaveCount = kNoInitialSave;
+
+    fOpaqueBounds.setEmpty();
+    fApproxClipSaveCount = 0;
 }
 
 SkPictureRecord::~SkPictureRecord() {
@@ -133,6 +138,157 @@ static inline uint32_t getPaintOffset(DrawType op, uint32_t opSize) {
     return gPaintOffsets[op] * sizeof(uint32_t) + overflow;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+// Flags describing a draw to analyzeDraw().
+enum AnalyzeFlags {
+    // The draw covers every pixel within its bounds, and covers them opaque
+    // if its paint lets it.
+    kFillsBounds_AnalyzeFlag    = 0x01,
+    // The draw samples a bitmap.
+    kSamples_AnalyzeFlag        = 0x02,
+};
+
+static uint32_t bitmap_analyze_flags(const SkBitmap& bitmap) {
+    return kSamples_AnalyzeFlag | (bitmap.isOpaque() ? kFillsBounds_AnalyzeFlag : 0);
+}
+
+// Does drawing with paint leave every pixel it covers opaque? A NULL paint
+// draws a bitmap as it is.
+static bool paint_covers_opaque(const SkPaint* paint) {
+    if (NULL == paint) {
+        return true;
+    }
+    if (0xFF != paint->getAlpha() || SkPaint::kFill_Style != paint->getStyle() ||
+        NULL != paint->getPathEffect() || NULL != paint->getMaskFilter() ||
+        NULL != paint->getRasterizer() || NULL != paint->getLooper() ||
+        NULL != paint->getImageFilter() || NULL != paint->getColorFilter()) {
+        return false;
+    }
+    if (NULL != paint->getShader() && !paint->getShader()->isOpaque()) {
+        return false;
+    }
+    SkXfermode::Mode mode;
+    return SkXfermode::AsMode(paint->getXfermode(), &mode) &&
+           (SkXfermode::kSrcOver_Mode == mode || SkXfermode::kSrc_Mode == mode);
+}
+
+// Can drawing with paint leave a pixel that was opaque less than opaque?
+static bool paint_can_reduce_alpha(const SkPaint* paint) {
+    if (NULL == paint) {
+        return false;
+    }
+    SkXfermode::Mode mode;
+    if (!SkXfermode::AsMode(paint->getXfermode(), &mode)) {
+        return true;
+    }
+    switch (mode) {
+        case SkXfermode::kClear_Mode:
+        case SkXfermode::kSrc_Mode:
+        case SkXfermode::kSrcIn_Mode:
+        case SkXfermode::kDstIn_Mode:
+        case SkXfermode::kSrcOut_Mode:
+        case SkXfermode::kDstOut_Mode:
+        case SkXfermode::kDstATop_Mode:
+        case SkXfermode::kXor_Mode:
+        case SkXfermode::kModulate_Mode:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void SkPictureRecord::analyzeDraw(const SkRect* bounds, const SkPaint* paint,
+                                  uint32_t analyzeFlags) {
+    if (NULL != paint && NULL != paint->getShader()) {
+        if (SkShader::kNone_BitmapType != paint->getShader()->asABitmap(NULL, NULL, NULL)) {
+            fAnalysis.fHasBitmaps = true;
+        }
+        analyzeFlags |= kSamples_AnalyzeFlag;
+    }
+
+    SkRect devBounds;
+    if (NULL != bounds && (NULL == paint || paint->canComputeFastBounds())) {
+        SkRect sorted = *bounds;
+        sorted.sort();
+        SkRect storage;
+        const SkMatrix& matrix = this->getTotalMatrix();
+        matrix.mapRect(&devBounds, NULL != paint ? paint->computeFastBounds(sorted, &storage)
+                                                 : sorted);
+        if (!matrix.rectStaysRect()) {
+            analyzeFlags &= ~kFillsBounds_AnalyzeFlag;
+        }
+    } else {
+        // The draw may cover the whole clip, but only covers all of it if
+        // it was meant to.
+        SkIRect clipBounds;
+        if (!this->getClipDeviceBounds(&clipBounds)) {
+            return;
+        }
+        devBounds.set(clipBounds);
+        if (NULL != bounds) {
+            analyzeFlags &= ~kFillsBounds_AnalyzeFlag;
+        }
+    }
+    this->analyzeDeviceDraw(devBounds, paint, analyzeFlags,
+                            analyzeFlags & kSamples_AnalyzeFlag ? 2.0f : 1.0f);
+}
+
+void SkPictureRecord::analyzeDeviceDraw(const SkRect& devBounds, const SkPaint* paint,
+                                        uint32_t analyzeFlags, float costPerPixel) {
+    SkIRect clipBounds;
+    if (!this->getClipDeviceBounds(&clipBounds)) {
+        return;
+    }
+    SkRect bounds = devBounds;
+    if (!bounds.intersect(SkRect::Make(clipBounds))) {
+        return;
+    }
+    fAnalysis.fBounds.join(bounds);
+    fAnalysis.fRasterCost += bounds.width() * bounds.height() * costPerPixel;
+
+    // What is drawn to a layer only reaches the device through the layer's
+    // own paint.
+    if (this->isDrawingToLayer()) {
+        return;
+    }
+    if ((analyzeFlags & kFillsBounds_AnalyzeFlag) && paint_covers_opaque(paint) &&
+        kRect_ClipType == this->getClipType() && 0 == fApproxClipSaveCount) {
+        SkIRect opaque;
+        bounds.roundIn(&opaque);
+        this->addOpaqueBounds(opaque);
+    } else if (paint_can_reduce_alpha(paint)) {
+        SkIRect touched;
+        bounds.roundOut(&touched);
+        if (SkIRect::Intersects(touched, fOpaqueBounds)) {
+            fOpaqueBounds.setEmpty();
+        }
+    }
+}
+
+void SkPictureRecord::addOpaqueBounds(const SkIRect& bounds) {
+    if (bounds.isEmpty() || fOpaqueBounds.contains(bounds)) {
+        return;
+    }
+    if (fOpaqueBounds.isEmpty() || bounds.contains(fOpaqueBounds)) {
+        fOpaqueBounds = bounds;
+        return;
+    }
+    // Only one rect is kept, so keep the union if it is a rect, or else the
+    // larger of the two.
+    if ((bounds.fLeft == fOpaqueBounds.fLeft && bounds.fRight == fOpaqueBounds.fRight &&
+         bounds.fTop <= fOpaqueBounds.fBottom && bounds.fBottom >= fOpaqueBounds.fTop) ||
+        (bounds.fTop == fOpaqueBounds.fTop && bounds.fBottom == fOpaqueBounds.fBottom &&
+         bounds.fLeft <= fOpaqueBounds.fRight && bounds.fRight >= fOpaqueBounds.fLeft)) {
+        fOpaqueBounds.join(bounds);
+    } else if ((int64_t)bounds.width() * bounds.height() >
+               (int64_t)fOpaqueBounds.width() * fOpaqueBounds.height()) {
+        fOpaqueBounds = bounds;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 SkDevice* SkPictureRecord::setDevice(SkDevice* device) {
     SkASSERT(!"eeek, don't try to change the device on a recording canvas");
     return this->INHERITED::setDevice(device);
@@ -174,6 +330,9 @@ int SkPictureRecord::saveLayer(const SkRect* bounds, const SkPaint* paint,
     addPaintPtr(paint);
     addInt(flags);
 
+    // Restoring the layer draws it with paint.
+    this->analyzeDraw(bounds, paint);
+
     if (kNoSavedLayerIndex == fFirstSavedLayerIndex) {
         fFirstSavedLayerIndex = fRestoreOffsetStack.count();
     }
@@ -586,7 +745,10 @@ void SkPictureRecord::restore() {
     fRestoreOffsetStack.pop();
 
     validate(initialOffset, size);
-    return this->INHERITED::restore();
+    this->INHERITED::restore();
+    if (this->getSaveCount() < fApproxClipSaveCount) {
+        fApproxClipSaveCount = 0;
+    }
 }
 
 bool SkPictureRecord::translate(SkScalar dx, SkScalar dy) {
@@ -692,6 +854,55 @@ void SkPictureRecord::endRecording() {
     this->restoreToCount(fInitialSaveCount);
 }
 
+void SkPictureRecord::getAnalysis(SkPicture::Analysis* analysis) const {
+    *analysis = fAnalysis;
+
+    // Count the ops that are left, now that optimizations may have removed
+    // some.
+    SkWriter32* writer = const_cast<SkWriter32*>(&fWriter);
+    uint32_t offset = 0;
+    while (offset < writer->size()) {
+        uint32_t size;
+        DrawType op = peek_op_and_size(writer, offset, &size);
+        SkASSERT(size > 0);
+        if (0 == size) {
+            break;
+        }
+        offset += size;
+
+        switch (op) {
+            case DRAW_BITMAP:
+            case DRAW_BITMAP_MATRIX:
+            case DRAW_BITMAP_NINE:
+            case DRAW_BITMAP_RECT_TO_RECT:
+            case DRAW_SPRITE:
+                analysis->fHasBitmaps = true;
+                break;
+            case DRAW_POS_TEXT:
+            case DRAW_POS_TEXT_TOP_BOTTOM:
+            case DRAW_POS_TEXT_H:
+            case DRAW_POS_TEXT_H_TOP_BOTTOM:
+            case DRAW_TEXT:
+            case DRAW_TEXT_ON_PATH:
+            case DRAW_TEXT_TOP_BOTTOM:
+                analysis->fHasText = true;
+                break;
+            case SAVE_LAYER:
+                analysis->fHasSaveLayers = true;
+                break;
+            case NOOP:
+                continue;
+            default:
+                break;
+        }
+        analysis->fOpCount += 1;
+    }
+
+    SkIRect bounds;
+    analysis->fBounds.roundOut(&bounds);
+    analysis->fOpaque = !bounds.isEmpty() && fOpaqueBounds.contains(bounds);
+}
+
 void SkPictureRecord::recordRestoreOffsetPlaceholder(SkRegion::Op op) {
     if (fRestoreOffsetStack.isEmpty()) {
         return;
@@ -752,6 +963,9 @@ bool SkPictureRecord::clipRRect(const SkRRect& rrect, SkRegion::Op op, bool doAA
     validate(initialOffset, size);
 
     if (fRecordFlags & SkPicture::kUsePathBoundsForClip_RecordingFlag) {
+        if (0 == fApproxClipSaveCount) {
+            fApproxClipSaveCount = this->getSaveCount();
+        }
         return this->INHERITED::clipRect(rrect.getBounds(), op, doAA);
     } else {
         return this->INHERITED::clipRRect(rrect, op, doAA);
@@ -780,6 +994,9 @@ bool SkPictureRecord::clipPath(const SkPath& path, SkRegion::Op op, bool doAA) {
     validate(initialOffset, size);
 
     if (fRecordFlags & SkPicture::kUsePathBoundsForClip_RecordingFlag) {
+        if (0 == fApproxClipSaveCount) {
+            fApproxClipSaveCount = this->getSaveCount();
+        }
         return this->INHERITED::clipRect(path.getBounds(), op, doAA);
     } else {
         return this->INHERITED::clipPath(path, op, doAA);
@@ -809,6 +1026,20 @@ void SkPictureRecord::clear(SkColor color) {
     uint32_t initialOffset = this->addDraw(DRAW_CLEAR, &size);
     addInt(color);
     validate(initialOffset, size);
+
+    // Clearing ignores the clip.
+    SkISize deviceSize = this->getDeviceSize();
+    SkIRect deviceBounds = SkIRect::MakeSize(deviceSize);
+    SkRect bounds = SkRect::Make(deviceBounds);
+    fAnalysis.fBounds.join(bounds);
+    fAnalysis.fRasterCost += bounds.width() * bounds.height();
+    if (!this->isDrawingToLayer()) {
+        if (0xFF == SkColorGetA(color)) {
+            this->addOpaqueBounds(deviceBounds);
+        } else {
+            fOpaqueBounds.setEmpty();
+        }
+    }
 }
 
 void SkPictureRecord::drawPaint(const SkPaint& paint) {
@@ -818,6 +1049,8 @@ void SkPictureRecord::drawPaint(const SkPaint& paint) {
     SkASSERT(initialOffset+getPaintOffset(DRAW_PAINT, size) == fWriter.size());
     addPaint(paint);
     validate(initialOffset, size);
+
+    this->analyzeDraw(NULL, &paint, kFillsBounds_AnalyzeFlag);
 }
 
 void SkPictureRecord::drawPoints(PointMode mode, size_t count, const SkPoint pts[],
@@ -831,6 +1064,15 @@ void SkPictureRecord::drawPoints(PointMode mode, size_t count, const SkPoint pts
     addInt(count);
     fWriter.writeMul4(pts, count * sizeof(SkPoint));
     validate(initialOffset, size);
+
+    if (count > 0) {
+        SkRect bounds;
+        bounds.set(pts, count);
+        // Hairlines still cover a pixel.
+        SkScalar outset = SkScalarHalf(SkMaxScalar(paint.getStrokeWidth(), SK_Scalar1));
+        bounds.outset(outset, outset);
+        this->analyzeDraw(&bounds, &paint);
+    }
 }
 
 void SkPictureRecord::drawOval(const SkRect& oval, const SkPaint& paint) {
@@ -841,6 +1083,8 @@ void SkPictureRecord::drawOval(const SkRect& oval, const SkPaint& paint) {
     addPaint(paint);
     addRect(oval);
     validate(initialOffset, size);
+
+    this->analyzeDraw(&oval, &paint);
 }
 
 void SkPictureRecord::drawRect(const SkRect& rect, const SkPaint& paint) {
@@ -851,6 +1095,8 @@ void SkPictureRecord::drawRect(const SkRect& rect, const SkPaint& paint) {
     addPaint(paint);
     addRect(rect);
     validate(initialOffset, size);
+
+    this->analyzeDraw(&rect, &paint, kFillsBounds_AnalyzeFlag);
 }
 
 void SkPictureRecord::drawRRect(const SkRRect& rrect, const SkPaint& paint) {
@@ -878,6 +1124,9 @@ void SkPictureRecord::drawRRect(const SkRRect& rrect, const SkPaint& paint) {
         addRRect(rrect);
     }
     validate(initialOffset, size);
+
+    this->analyzeDraw(&rrect.getBounds(), &paint,
+                      rrect.isRect() ? kFillsBounds_AnalyzeFlag : 0);
 }
 
 void SkPictureRecord::drawPath(const SkPath& path, const SkPaint& paint) {
@@ -888,6 +1137,8 @@ void SkPictureRecord::drawPath(const SkPath& path, const SkPaint& paint) {
     addPaint(paint);
     addPath(path);
     validate(initialOffset, size);
+
+    this->analyzeDraw(path.isInverseFillType() ? NULL : &path.getBounds(), &paint);
 }
 
 void SkPictureRecord::drawBitmap(const SkBitmap& bitmap, SkScalar left, SkScalar top,
@@ -901,6 +1152,10 @@ void SkPictureRecord::drawBitmap(const SkBitmap& bitmap, SkScalar left, SkScalar
     addScalar(left);
     addScalar(top);
     validate(initialOffset, size);
+
+    SkRect bounds = SkRect::MakeXYWH(left, top, SkIntToScalar(bitmap.width()),
+                                     SkIntToScalar(bitmap.height()));
+    this->analyzeDraw(&bounds, paint, bitmap_analyze_flags(bitmap));
 }
 
 void SkPictureRecord::drawBitmapRectToRect(const SkBitmap& bitmap, const SkRect* src,
@@ -919,6 +1174,8 @@ void SkPictureRecord::drawBitmapRectToRect(const SkBitmap& bitmap, const SkRect*
     addRectPtr(src);  // may be null
     addRect(dst);
     validate(initialOffset, size);
+
+    this->analyzeDraw(&dst, paint, bitmap_analyze_flags(bitmap));
 }
 
 void SkPictureRecord::drawBitmapMatrix(const SkBitmap& bitmap, const SkMatrix& matrix,
@@ -931,6 +1188,14 @@ void SkPictureRecord::drawBitmapMatrix(const SkBitmap& bitmap, const SkMatrix& m
     addBitmap(bitmap);
     addMatrix(matrix);
     validate(initialOffset, size);
+
+    SkRect bounds = SkRect::MakeWH(SkIntToScalar(bitmap.width()), SkIntToScalar(bitmap.height()));
+    uint32_t flags = bitmap_analyze_flags(bitmap);
+    if (!matrix.rectStaysRect()) {
+        flags &= ~kFillsBounds_AnalyzeFlag;
+    }
+    matrix.mapRect(&bounds);
+    this->analyzeDraw(&bounds, paint, flags);
 }
 
 void SkPictureRecord::drawBitmapNine(const SkBitmap& bitmap, const SkIRect& center,
@@ -944,6 +1209,8 @@ void SkPictureRecord::drawBitmapNine(const SkBitmap& bitmap, const SkIRect& cent
     addIRect(center);
     addRect(dst);
     validate(initialOffset, size);
+
+    this->analyzeDraw(&dst, paint, bitmap_analyze_flags(bitmap));
 }
 
 void SkPictureRecord::drawSprite(const SkBitmap& bitmap, int left, int top,
@@ -957,6 +1224,12 @@ void SkPictureRecord::drawSprite(const SkBitmap& bitmap, int left, int top,
     addInt(left);
     addInt(top);
     validate(initialOffset, size);
+
+    // Sprites ignore the matrix.
+    SkRect bounds = SkRect::MakeXYWH(SkIntToScalar(left), SkIntToScalar(top),
+                                     SkIntToScalar(bitmap.width()),
+                                     SkIntToScalar(bitmap.height()));
+    this->analyzeDeviceDraw(bounds, paint, bitmap_analyze_flags(bitmap), 2);
 }
 
 // Return fontmetrics.fTop,fBottom in topbot[0,1], after they have been
@@ -984,6 +1257,25 @@ void SkPictureRecord::addFontMetricsTopBottom(const SkPaint& paint, const SkFlat
     addScalar(flat.topBot()[1] + maxY);
 }
 
+// Returns the bounds of text drawn with paint, whose glyph origins are
+// within minX, maxX, minY and maxY.
+static SkRect text_bounds(const SkPaint& paint, const SkFlatData& flat,
+                          SkScalar minX, SkScalar maxX, SkScalar minY, SkScalar maxY) {
+    SkScalar top, bottom;
+    if (flat.isTopBotWritten()) {
+        top = flat.topBot()[0];
+        bottom = flat.topBot()[1];
+    } else {
+        SkPaint::FontMetrics metrics;
+        paint.getFontMetrics(&metrics);
+        top = metrics.fTop;
+        bottom = metrics.fBottom;
+    }
+    // Pad the sides by the height of the glyphs, for want of their widths.
+    SkScalar pad = bottom - top;
+    return SkRect::MakeLTRB(minX - pad, minY + top, maxX + pad, maxY + bottom);
+}
+
 void SkPictureRecord::drawText(const void* text, size_t byteLength, SkScalar x,
                       SkScalar y, const SkPaint& paint) {
     bool fast = !paint.isVerticalText() && paint.canComputeFastBounds();
@@ -1006,6 +1298,27 @@ void SkPictureRecord::drawText(const void* text, size_t byteLength, SkScalar x,
         addFontMetricsTopBottom(paint, *flatPaintData, y, y);
     }
     validate(initialOffset, size);
+
+    if (paint.isVerticalText()) {
+        this->analyzeDraw(NULL, &paint);
+    } else {
+        // Measuring the text would cost every recording a trip through the
+        // glyph cache, so allow each glyph an advance of up to text_bounds'
+        // padding instead.
+        SkRect bounds = text_bounds(paint, *flatPaintData, x, x, y, y);
+        SkScalar width = SkIntToScalar(paint.countText(text, byteLength)) *
+                         SkScalarMul(bounds.height(),
+                                     SkMaxScalar(SK_Scalar1, SkScalarAbs(paint.getTextScaleX())));
+        if (SkPaint::kCenter_Align == paint.getTextAlign()) {
+            bounds.fLeft -= SkScalarHalf(width);
+            bounds.fRight += SkScalarHalf(width);
+        } else if (SkPaint::kRight_Align == paint.getTextAlign()) {
+            bounds.fLeft -= width;
+        } else {
+            bounds.fRight += width;
+        }
+        this->analyzeDraw(&bounds, &paint);
+    }
 }
 
 void SkPictureRecord::drawPosText(const void* text, size_t byteLength,
@@ -1090,6 +1403,19 @@ void SkPictureRecord::drawPosText(const void* text, size_t byteLength,
     fPointWrites += points;
 #endif
     validate(initialOffset, size);
+
+    if (paint.isVerticalText()) {
+        this->analyzeDraw(NULL, &paint);
+    } else {
+        SkScalar minX = pos[0].fX;
+        SkScalar maxX = pos[0].fX;
+        for (size_t index = 1; index < points; index++) {
+            minX = SkMinScalar(minX, pos[index].fX);
+            maxX = SkMaxScalar(maxX, pos[index].fX);
+        }
+        SkRect bounds = text_bounds(paint, *flatPaintData, minX, maxX, minY, maxY);
+        this->analyzeDraw(&bounds, &paint);
+    }
 }
 
 void SkPictureRecord::drawPosTextH(const void* text, size_t byteLength,
@@ -1129,6 +1455,19 @@ void SkPictureRecord::drawPosTextH(const void* text, size_t byteLength,
     fPointWrites += points;
 #endif
     validate(initialOffset, size);
+
+    if (paint.isVerticalText()) {
+        this->analyzeDraw(NULL, &paint);
+    } else {
+        SkScalar minX = xpos[0];
+        SkScalar maxX = xpos[0];
+        for (size_t index = 1; index < points; index++) {
+            minX = SkMinScalar(minX, xpos[index]);
+            maxX = SkMaxScalar(maxX, xpos[index]);
+        }
+        SkRect bounds = text_bounds(paint, *flatPaintData, minX, maxX, constY, constY);
+        this->analyzeDraw(&bounds, &paint);
+    }
 }
 
 void SkPictureRecord::drawTextOnPath(const void* text, size_t byteLength,
@@ -1143,6 +1482,17 @@ void SkPictureRecord::drawTextOnPath(const void* text, size_t byteLength,
     addPath(path);
     addMatrixPtr(matrix);
     validate(initialOffset, size);
+
+    // Glyphs can sit up to their height off the path.
+    SkPaint::FontMetrics metrics;
+    paint.getFontMetrics(&metrics);
+    SkScalar outset = metrics.fBottom - metrics.fTop;
+    SkRect bounds = path.getBounds();
+    if (NULL != matrix) {
+        matrix->mapRect(&bounds);
+    }
+    bounds.outset(outset, outset);
+    this->analyzeDraw(&bounds, &paint);
 }
 
 void SkPictureRecord::drawPicture(SkPicture& picture) {
@@ -1151,6 +1501,24 @@ void SkPictureRecord::drawPicture(SkPicture& picture) {
     uint32_t initialOffset = this->addDraw(DRAW_PICTURE, &size);
     addPicture(picture);
     validate(initialOffset, size);
+
+    SkPicture::Analysis analysis;
+    picture.getAnalysis(&analysis);
+    fAnalysis.fHasText |= analysis.fHasText;
+    fAnalysis.fHasBitmaps |= analysis.fHasBitmaps;
+    fAnalysis.fHasSaveLayers |= analysis.fHasSaveLayers;
+    fAnalysis.fOpCount += analysis.fOpCount;
+    if (!analysis.fBounds.isEmpty()) {
+        const SkMatrix& matrix = this->getTotalMatrix();
+        SkRect bounds;
+        matrix.mapRect(&bounds, analysis.fBounds);
+        // Spread the picture's cost evenly over its bounds.
+        float costPerPixel = analysis.fRasterCost /
+                             (analysis.fBounds.width() * analysis.fBounds.height());
+        uint32_t flags = analysis.fOpaque && matrix.rectStaysRect() ?
+                         kFillsBounds_AnalyzeFlag : 0;
+        this->analyzeDeviceDraw(bounds, NULL, flags, costPerPixel);
+    }
 }
 
 void SkPictureRecord::drawVertices(VertexMode vmode, int vertexCount,
@@ -1200,6 +1568,10 @@ void SkPictureRecord::drawVertices(VertexMode vmode, int vertexCount,
         fWriter.writePad(indices, indexCount * sizeof(uint16_t));
     }
     validate(initialOffset, size);
+
+    SkRect bounds;
+    bounds.set(vertices, vertexCount);
+    this->analyzeDraw(&bounds, &paint);
 }
 
 void SkPictureRecord::drawData(const void* data, size_t length) {
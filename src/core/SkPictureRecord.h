@@ -102,6 +102,9 @@ public:
     void beginRecording();
     void endRecording();
 
+    /** Describes what has been recorded so far. */
+    void getAnalysis(SkPicture::Analysis* analysis) const;
+
 private:
     void handleOptimization(int opt);
     void recordRestoreOffsetPlaceholder(SkRegion::Op);
@@ -175,6 +178,20 @@ private:
 
     int find(const SkBitmap& bitmap);
 
+    /*
+     * Adds a draw to fAnalysis. bounds are in the current coordinates, before
+     * the paint's effects are applied, or NULL if the draw may cover the
+     * whole clip.
+     */
+    void analyzeDraw(const SkRect* bounds, const SkPaint* paint, uint32_t analyzeFlags = 0);
+    /*
+     * Adds a draw to fAnalysis, which costs costPerPixel for each pixel of
+     * devBounds, in device coordinates, that is inside the clip.
+     */
+    void analyzeDeviceDraw(const SkRect& devBounds, const SkPaint* paint, uint32_t analyzeFlags,
+                           float costPerPixel);
+    void addOpaqueBounds(const SkIRect& bounds);
+
 #ifdef SK_DEBUG_DUMP
 public:
     void dumpMatrices();
@@ -237,6 +254,14 @@ private:
     uint32_t fRecordFlags;
     int fInitialSaveCount;
 
+    // What has been found out so far; the ops are only counted when asked.
+    SkPicture::Analysis fAnalysis;
+    // Device pixels known to have been drawn opaque.
+    SkIRect fOpaqueBounds;
+    // The save count at which a clip path was recorded only by its bounds,
+    // or 0. Until it is restored, the clip may be smaller than it looks.
+    int fApproxClipSaveCount;
+
     friend class SkPicturePlayback;
     friend class SkPictureTester; // for unit testing
 
@@ -9,6 +9,10 @@
 #include "SkRTree.h"
 #include "SkTSort.h"
 
+#if SK_CPU_SSE_LEVEL >= SK_CPU_SSE_LEVEL_SSE2
+    #include <emmintrin.h>
+#endif
+
 static inline uint32_t get_area(const SkIRect& rect);
 static inline uint32_t get_overlap(const SkIRect& rect1, const SkIRect& rect2);
 static inline uint32_t get_margin(const SkIRect& rect);
@@ -32,7 +36,8 @@ SkRTree* SkRTree::Create(int minChildren, int maxChildren, SkScalar aspectRatio)
 SkRTree::SkRTree(int minChildren, int maxChildren, SkScalar aspectRatio)
     : fMinChildren(minChildren)
     , fMaxChildren(maxChildren)
-    , fNodeSize(sizeof(Node) + sizeof(Branch) * maxChildren)
+    , fStride(SkAlign4(maxChildren))
+    , fNodeSize(kNodeHeaderSize + (4 * sizeof(int32_t) + sizeof(void*)) * fStride)
     , fCount(0)
     , fNodes(fNodeSize * 256)
     , fAspectRatio(aspectRatio) {
@@ -74,8 +79,8 @@ void SkRTree::insert(void* data, const SkIRect& bounds, bool defer) {
         Node* oldRoot = fRoot.fChild.subtree;
         Node* newRoot = this->allocateNode(oldRoot->fLevel + 1);
         newRoot->fNumChildren = 2;
-        *newRoot->child(0) = fRoot;
-        *newRoot->child(1) = *newSibling;
+        newRoot->setChild(0, fRoot);
+        newRoot->setChild(1, *newSibling);
         fRoot.fChild.subtree = newRoot;
         fRoot.fBounds = this->computeBounds(fRoot.fChild.subtree);
     }
@@ -124,9 +129,17 @@ void SkRTree::clear() {
 }
 
 SkRTree::Node* SkRTree::allocateNode(uint16_t level) {
-    Node* out = static_cast<Node*>(fNodes.allocThrow(fNodeSize));
-    out->fNumChildren = 0;
-    out->fLevel = level;
+    return this->allocateNodes(1, level);
+}
+
+SkRTree::Node* SkRTree::allocateNodes(int count, uint16_t level) {
+    Node* out = static_cast<Node*>(fNodes.allocThrow(fNodeSize * count));
+    for (int i = 0; i < count; ++i) {
+        Node* n = this->nodeAt(out, i);
+        n->fNumChildren = 0;
+        n->fLevel = level;
+        n->fStride = fStride;
+    }
     return out;
 }
 
@@ -134,9 +147,9 @@ SkRTree::Branch* SkRTree::insert(Node* root, Branch* branch, uint16_t level) {
     Branch* toInsert = branch;
     if (root->fLevel != level) {
         int childIndex = this->chooseSubtree(root, branch);
-        toInsert = this->insert(root->child(childIndex)->fChild.subtree, branch, level);
-        root->child(childIndex)->fBounds = this->computeBounds(
-            root->child(childIndex)->fChild.subtree);
+        Node* subtree = root->subtree(childIndex);
+        toInsert = this->insert(subtree, branch, level);
+        root->setBounds(childIndex, this->computeBounds(subtree));
     }
     if (NULL != toInsert) {
         if (root->fNumChildren == fMaxChildren) {
@@ -146,7 +159,7 @@ SkRTree::Branch* SkRTree::insert(Node* root, Branch* branch, uint16_t level) {
             Node* newSibling = this->allocateNode(root->fLevel);
             Branch* toDivide = SkNEW_ARRAY(Branch, fMaxChildren + 1);
             for (int i = 0; i < fMaxChildren; ++i) {
-                toDivide[i] = *root->child(i);
+                toDivide[i] = root->child(i);
             }
             toDivide[fMaxChildren] = *toInsert;
             int splitIndex = this->distributeChildren(toDivide);
@@ -155,10 +168,10 @@ SkRTree::Branch* SkRTree::insert(Node* root, Branch* branch, uint16_t level) {
             root->fNumChildren = splitIndex;
             newSibling->fNumChildren = fMaxChildren + 1 - splitIndex;
             for (int i = 0; i < splitIndex; ++i) {
-                *root->child(i) = toDivide[i];
+                root->setChild(i, toDivide[i]);
             }
             for (int i = splitIndex; i < fMaxChildren + 1; ++i) {
-                *newSibling->child(i - splitIndex) = toDivide[i];
+                newSibling->setChild(i - splitIndex, toDivide[i]);
             }
             SkDELETE_ARRAY(toDivide);
 
@@ -167,7 +180,7 @@ SkRTree::Branch* SkRTree::insert(Node* root, Branch* branch, uint16_t level) {
             branch->fBounds = this->computeBounds(newSibling);
             return branch;
         } else {
-            *root->child(root->fNumChildren) = *toInsert;
+            root->setChild(root->fNumChildren, *toInsert);
             ++root->fNumChildren;
             return NULL;
         }
@@ -183,7 +196,7 @@ int SkRTree::chooseSubtree(Node* root, Branch* branch) {
         int32_t minArea         = SK_MaxS32;
         int32_t bestSubtree     = -1;
         for (int i = 0; i < root->fNumChildren; ++i) {
-            const SkIRect& subtreeBounds = root->child(i)->fBounds;
+            const SkIRect subtreeBounds = root->bounds(i);
             int32_t areaIncrease = get_area_increase(subtreeBounds, branch->fBounds);
             // break ties in favor of subtree with smallest area
             if (areaIncrease < minAreaIncrease || (areaIncrease == minAreaIncrease &&
@@ -201,7 +214,7 @@ int SkRTree::chooseSubtree(Node* root, Branch* branch) {
         int32_t minAreaIncrease    = SK_MaxS32;
         int32_t bestSubtree = -1;
         for (int32_t i = 0; i < root->fNumChildren; ++i) {
-            const SkIRect& subtreeBounds = root->child(i)->fBounds;
+            const SkIRect subtreeBounds = root->bounds(i);
             SkIRect expandedBounds = subtreeBounds;
             join_no_empty_check(branch->fBounds, &expandedBounds);
             int32_t overlap = 0;
@@ -210,7 +223,7 @@ int SkRTree::chooseSubtree(Node* root, Branch* branch) {
                 // Note: this would be more correct if we subtracted the original pre-expanded
                 // overlap, but computing overlaps is expensive and omitting it doesn't seem to
                 // hurt query performance. See get_overlap_increase()
-                overlap += get_overlap(expandedBounds, root->child(j)->fBounds);
+                overlap += get_overlap(expandedBounds, root->bounds(j));
             }
             // break ties with lowest area increase
             if (overlap < minOverlapIncrease || (overlap == minOverlapIncrease &&
@@ -229,9 +242,9 @@ int SkRTree::chooseSubtree(Node* root, Branch* branch) {
 }
 
 SkIRect SkRTree::computeBounds(Node* n) {
-    SkIRect r = n->child(0)->fBounds;
+    SkIRect r = n->bounds(0);
     for (int i = 1; i < n->fNumChildren; ++i) {
-        join_no_empty_check(n->child(i)->fBounds, &r);
+        join_no_empty_check(n->bounds(i), &r);
     }
     return r;
 }
@@ -305,15 +318,72 @@ int SkRTree::distributeChildren(Branch* children) {
 }
 
 void SkRTree::search(Node* root, const SkIRect query, SkTDArray<void*>* results) const {
-    for (int i = 0; i < root->fNumChildren; ++i) {
-        if (SkIRect::IntersectsNoEmptyCheck(root->child(i)->fBounds, query)) {
+    const int32_t* lefts = root->lefts();
+    const int32_t* tops = root->tops();
+    const int32_t* rights = root->rights();
+    const int32_t* bottoms = root->bottoms();
+    void** children = root->children();
+    const int count = root->fNumChildren;
+#if SK_CPU_SSE_LEVEL >= SK_CPU_SSE_LEVEL_SSE2
+    // Test kSideWidth children at a time. The side arrays have room for a whole number of
+    // groups, so the last group may read sides past the children, which are masked off.
+    const __m128i queryLeft = _mm_set1_epi32(query.fLeft);
+    const __m128i queryTop = _mm_set1_epi32(query.fTop);
+    const __m128i queryRight = _mm_set1_epi32(query.fRight);
+    const __m128i queryBottom = _mm_set1_epi32(query.fBottom);
+    for (int i = 0; i < count; i += kSideWidth) {
+        // Same test as SkIRect::IntersectsNoEmptyCheck
+        __m128i hits = _mm_and_si128(
+            _mm_and_si128(
+                _mm_cmplt_epi32(_mm_loadu_si128((const __m128i*)(lefts + i)), queryRight),
+                _mm_cmplt_epi32(_mm_loadu_si128((const __m128i*)(tops + i)), queryBottom)),
+            _mm_and_si128(
+                _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(rights + i)), queryLeft),
+                _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(bottoms + i)), queryTop)));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(hits));
+        if (count - i < kSideWidth) {
+            mask &= (1 << (count - i)) - 1;
+        }
+        for (int j = i; 0 != mask; ++j, mask >>= 1) {
+            if (0 == (mask & 1)) {
+                continue;
+            }
+            if (root->isLeaf()) {
+                results->push(children[j]);
+            } else {
+                this->search(static_cast<Node*>(children[j]), query, results);
+            }
+        }
+    }
+#else
+    for (int i = 0; i < count; ++i) {
+        if (lefts[i] < query.fRight && tops[i] < query.fBottom &&
+            query.fLeft < rights[i] && query.fTop < bottoms[i]) {
             if (root->isLeaf()) {
-                results->push(root->child(i)->fChild.data);
+                results->push(children[i]);
             } else {
-                this->search(root->child(i)->fChild.subtree, query, results);
+                this->search(static_cast<Node*>(children[i]), query, results);
             }
         }
     }
+#endif
+}
+
+// Returns how many branches the next tile of a bulk load takes, which is a full node's worth
+// unless some must be left over to fill up the last node; remainder counts how many that still is.
+static int next_tile_size(int minChildren, int maxChildren, int* remainder) {
+    int size = maxChildren;
+    if (*remainder != 0) {
+        // if need be, omit some nodes to make up for remainder
+        if (*remainder <= maxChildren - minChildren) {
+            size -= *remainder;
+            *remainder = 0;
+        } else {
+            size = minChildren;
+            *remainder -= maxChildren - minChildren;
+        }
+    }
+    return size;
 }
 
 SkRTree::Branch SkRTree::bulkLoad(SkTDArray<Branch>* branches, int level) {
@@ -347,39 +417,36 @@ SkRTree::Branch SkRTree::bulkLoad(SkTDArray<Branch>* branches, int level) {
                                     SkIntToScalar(numStrips));
         int currentBranch = 0;
 
+        // Every tile becomes one node, numBranches of them in all
+        Node* nodes = this->allocateNodes(numBranches, level);
+
         for (int i = 0; i < numStrips; ++i) {
-            int begin = currentBranch;
-            int end = currentBranch + numTiles * fMaxChildren - SkMin32(remainder,
-                      (fMaxChildren - fMinChildren) * numTiles);
+            // Work out where the strip's tiles end, to sort just the branches they take
+            int end = currentBranch;
+            int stripRemainder = remainder;
+            for (int j = 0; j < numTiles && end < branches->count(); ++j) {
+                end += next_tile_size(fMinChildren, fMaxChildren, &stripRemainder);
+            }
             if (end > branches->count()) {
                 end = branches->count();
             }
 
             // Now we sort horizontal strips of rectangles by their x coords
-            SkTQSort(branches->begin() + begin, branches->begin() + end - 1, RectLessX());
+            SkTQSort(branches->begin() + currentBranch, branches->begin() + end - 1, RectLessX());
 
             for (int j = 0; j < numTiles && currentBranch < branches->count(); ++j) {
-                int incrementBy = fMaxChildren;
-                if (remainder != 0) {
-                    // if need be, omit some nodes to make up for remainder
-                    if (remainder <= fMaxChildren - fMinChildren) {
-                        incrementBy -= remainder;
-                        remainder = 0;
-                    } else {
-                        incrementBy = fMinChildren;
-                        remainder -= fMaxChildren - fMinChildren;
-                    }
-                }
-                Node* n = allocateNode(level);
+                int incrementBy = next_tile_size(fMinChildren, fMaxChildren, &remainder);
+                SkASSERT(newBranches < numBranches);
+                Node* n = this->nodeAt(nodes, newBranches);
                 n->fNumChildren = 1;
-                *n->child(0) = (*branches)[currentBranch];
+                n->setChild(0, (*branches)[currentBranch]);
                 Branch b;
                 b.fBounds = (*branches)[currentBranch].fBounds;
                 b.fChild.subtree = n;
                 ++currentBranch;
                 for (int k = 1; k < incrementBy && currentBranch < branches->count(); ++k) {
                     b.fBounds.join((*branches)[currentBranch].fBounds);
-                    *n->child(k) = (*branches)[currentBranch];
+                    n->setChild(k, (*branches)[currentBranch]);
                     ++n->fNumChildren;
                     ++currentBranch;
                 }
@@ -387,6 +454,7 @@ SkRTree::Branch SkRTree::bulkLoad(SkTDArray<Branch>* branches, int level) {
                 ++newBranches;
             }
         }
+        SkASSERT(newBranches == numBranches);
         branches->setCount(newBranches);
         return this->bulkLoad(branches, level + 1);
     }
@@ -417,7 +485,7 @@ int SkRTree::validateSubtree(Node* root, SkIRect bounds, bool isRoot) {
     }
 
     for (int i = 0; i < root->fNumChildren; ++i) {
-        SkASSERT(bounds.contains(root->child(i)->fBounds));
+        SkASSERT(bounds.contains(root->bounds(i)));
     }
 
     if (root->isLeaf()) {
@@ -426,9 +494,8 @@ int SkRTree::validateSubtree(Node* root, SkIRect bounds, bool isRoot) {
     } else {
         int childCount = 0;
         for (int i = 0; i < root->fNumChildren; ++i) {
-            SkASSERT(root->child(i)->fChild.subtree->fLevel == root->fLevel - 1);
-            childCount += this->validateSubtree(root->child(i)->fChild.subtree,
-                                                root->child(i)->fBounds);
+            SkASSERT(root->subtree(i)->fLevel == root->fLevel - 1);
+            childCount += this->validateSubtree(root->subtree(i), root->bounds(i));
         }
         return childCount;
     }
@@ -104,17 +104,55 @@ private:
         SkIRect fBounds;
     };
 
+    enum {
+        // The bounds of a node's children are kept in arrays of this many sides at a time, so
+        // that search() can test them against the query together.
+        kSideWidth = 4,
+        // Room for the node itself, keeping the side arrays that follow it as aligned as it is.
+        kNodeHeaderSize = 16
+    };
+
     /**
      * A node in the tree, has between fMinChildren and fMaxChildren (the root is a special case)
      */
     struct Node {
         uint16_t fNumChildren;
         uint16_t fLevel;
-        bool isLeaf() { return 0 == fLevel; }
+        // Children each side array has room for, fMaxChildren rounded up to kSideWidth
+        uint16_t fStride;
+        bool isLeaf() const { return 0 == fLevel; }
         // Since we want to be able to pick min/max child counts at runtime, we assume the creator
-        // has allocated sufficient space directly after us in memory, and index into that space
-        Branch* child(size_t index) {
-            return reinterpret_cast<Branch*>(this + 1) + index;
+        // has allocated sufficient space directly after us in memory. The lefts, tops, rights and
+        // bottoms of the children's bounds are stored as four arrays there, followed by an array
+        // of the children themselves.
+        int32_t* lefts() {
+            return reinterpret_cast<int32_t*>(reinterpret_cast<char*>(this) + kNodeHeaderSize);
+        }
+        int32_t* tops() { return this->lefts() + fStride; }
+        int32_t* rights() { return this->lefts() + 2 * fStride; }
+        int32_t* bottoms() { return this->lefts() + 3 * fStride; }
+        void** children() { return reinterpret_cast<void**>(this->lefts() + 4 * fStride); }
+
+        Node* subtree(int index) { return static_cast<Node*>(this->children()[index]); }
+        SkIRect bounds(int index) {
+            return SkIRect::MakeLTRB(this->lefts()[index], this->tops()[index],
+                                     this->rights()[index], this->bottoms()[index]);
+        }
+        void setBounds(int index, const SkIRect& bounds) {
+            this->lefts()[index] = bounds.fLeft;
+            this->tops()[index] = bounds.fTop;
+            this->rights()[index] = bounds.fRight;
+            this->bottoms()[index] = bounds.fBottom;
+        }
+        Branch child(int index) {
+            Branch branch;
+            branch.fChild.data = this->children()[index];
+            branch.fBounds = this->bounds(index);
+            return branch;
+        }
+        void setChild(int index, const Branch& branch) {
+            this->children()[index] = branch.fChild.data;
+            this->setBounds(index, branch.fBounds);
         }
     };
 
@@ -130,17 +168,19 @@ private:
         const SkRTree::SortSide fSide;
     };
 
+    // Helpers for sorting by the centers of rects; these compare the sums of opposite sides, as
+    // twice the centers, widened so they can't overflow.
     struct RectLessX {
         bool operator()(const SkRTree::Branch lhs, const SkRTree::Branch rhs) {
-            return ((lhs.fBounds.fRight - lhs.fBounds.fLeft) >> 1) <
-                   ((rhs.fBounds.fRight - lhs.fBounds.fLeft) >> 1);
+            return (int64_t)lhs.fBounds.fLeft + lhs.fBounds.fRight <
+                   (int64_t)rhs.fBounds.fLeft + rhs.fBounds.fRight;
         }
     };
 
     struct RectLessY {
         bool operator()(const SkRTree::Branch lhs, const SkRTree::Branch rhs) {
-            return ((lhs.fBounds.fBottom - lhs.fBounds.fTop) >> 1) <
-                   ((rhs.fBounds.fBottom - lhs.fBounds.fTop) >> 1);
+            return (int64_t)lhs.fBounds.fTop + lhs.fBounds.fBottom <
+                   (int64_t)rhs.fBounds.fTop + rhs.fBounds.fBottom;
         }
     };
 
@@ -162,6 +202,10 @@ private:
      * seems to generally produce better, more consistent trees at significantly lower cost than
      * repeated insertions.
      *
+     * Each level of nodes is allocated as one contiguous array, in the order the tiles are
+     * made, so that siblings, which are near each other spatially, are also near each other in
+     * memory.
+     *
      * This consumes the input array.
      *
      * TODO: Experiment with other bulk-load algorithms (in particular the Hilbert pack variant,
@@ -175,6 +219,7 @@ private:
 
     const int fMinChildren;
     const int fMaxChildren;
+    const int fStride;
     const size_t fNodeSize;
 
     // This is the count of data elements (rather than total nodes in the tree)
@@ -186,6 +231,10 @@ private:
     SkScalar fAspectRatio;
 
     Node* allocateNode(uint16_t level);
+    Node* allocateNodes(int count, uint16_t level);
+    Node* nodeAt(Node* nodes, int index) const {
+        return reinterpret_cast<Node*>(reinterpret_cast<char*>(nodes) + index * fNodeSize);
+    }
 
     typedef SkBBoxHierarchy INHERITED;
 };
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkScaledImageCache.h"
+#include "SkChecksum.h"
+#include "SkGraphics.h"
+#include "SkMipMap.h"
+#include "SkTLRUCache.h"
+#include "SkThread.h"
+
+#ifndef SK_DEFAULT_IMAGE_CACHE_LIMIT
+    #define SK_DEFAULT_IMAGE_CACHE_LIMIT     (8 * 1024 * 1024)
+#endif
+
+namespace {
+
+// Mipmaps are keyed with a scaled size of 0 x 0, which no resampled bitmap
+// has.
+struct Key {
+    uint32_t    fGenID;
+    size_t      fPixelRefOffset;
+    int32_t     fSrcWidth;
+    int32_t     fSrcHeight;
+    int32_t     fWidth;
+    int32_t     fHeight;
+
+    Key(const SkBitmap& orig, int width, int height)
+        : fGenID(orig.getGenerationID())
+        , fPixelRefOffset(orig.pixelRefOffset())
+        , fSrcWidth(orig.width())
+        , fSrcHeight(orig.height())
+        , fWidth(width)
+        , fHeight(height) {}
+
+    bool operator==(const Key& other) const {
+        return fGenID == other.fGenID &&
+               fPixelRefOffset == other.fPixelRefOffset &&
+               fSrcWidth == other.fSrcWidth &&
+               fSrcHeight == other.fSrcHeight &&
+               fWidth == other.fWidth &&
+               fHeight == other.fHeight;
+    }
+
+    uint32_t hash() const {
+        // Hashed field by field, since the struct may have padding.
+        const uint32_t data[] = {
+            fGenID, static_cast<uint32_t>(fPixelRefOffset),
+            static_cast<uint32_t>(fSrcWidth), static_cast<uint32_t>(fSrcHeight),
+            static_cast<uint32_t>(fWidth), static_cast<uint32_t>(fHeight),
+        };
+        return SkChecksum::Compute(data, sizeof(data));
+    }
+};
+
+class Rec {
+public:
+    Rec(const Key& key, const SkBitmap& bitmap)
+        : fKey(key), fHash(key.hash()), fBitmap(bitmap), fMipMap(NULL) {}
+
+    Rec(const Key& key, const SkMipMap* mipMap)
+        : fKey(key), fHash(key.hash()), fMipMap(mipMap) {
+        mipMap->ref();
+    }
+
+    ~Rec() {
+        SkSafeUnref(fMipMap);
+    }
+
+    const Key& getKey() const { return fKey; }
+    uint32_t getHash() const { return fHash; }
+
+    size_t bytesUsed() const {
+        return fMipMap ? fMipMap->getSize() : fBitmap.getSize();
+    }
+
+    const SkBitmap& bitmap() const { return fBitmap; }
+    const SkMipMap* mipMap() const { return fMipMap; }
+
+private:
+    Key             fKey;
+    uint32_t        fHash;
+    SkBitmap        fBitmap;
+    const SkMipMap* fMipMap;
+
+    SK_DECLARE_LRU_CACHE_INTERFACE(Rec);
+};
+
+typedef SkTLRUCache<Rec, Key> Cache;
+
+}  // namespace
+
+SK_DECLARE_STATIC_MUTEX(gMutex);
+
+static Cache& get_cache() {
+    // gMutex must be held.
+    static Cache* gCache;
+    if (NULL == gCache) {
+        gCache = SkNEW_ARGS(Cache, (SK_DEFAULT_IMAGE_CACHE_LIMIT));
+    }
+    return *gCache;
+}
+
+bool SkScaledImageCache::Find(const SkBitmap& orig, int width, int height, SkBitmap* scaled) {
+    if (0 == orig.getGenerationID()) {
+        return false;
+    }
+    SkAutoMutexAcquire ama(gMutex);
+    Key key(orig, width, height);
+    Rec* rec = get_cache().find(key, key.hash());
+    if (NULL == rec) {
+        return false;
+    }
+    *scaled = rec->bitmap();
+    return true;
+}
+
+void SkScaledImageCache::Add(const SkBitmap& orig, const SkBitmap& scaled) {
+    if (0 == orig.getGenerationID()) {
+        return;
+    }
+    SkAutoMutexAcquire ama(gMutex);
+    get_cache().add(SkNEW_ARGS(Rec, (Key(orig, scaled.width(), scaled.height()), scaled)));
+}
+
+const SkMipMap* SkScaledImageCache::FindMipMap(const SkBitmap& orig) {
+    if (0 == orig.getGenerationID()) {
+        return NULL;
+    }
+    SkAutoMutexAcquire ama(gMutex);
+    Key key(orig, 0, 0);
+    Rec* rec = get_cache().find(key, key.hash());
+    if (NULL == rec) {
+        return NULL;
+    }
+    SkASSERT(rec->mipMap());
+    rec->mipMap()->ref();
+    return rec->mipMap();
+}
+
+void SkScaledImageCache::AddMipMap(const SkBitmap& orig, const SkMipMap* mipMap) {
+    if (0 == orig.getGenerationID() || NULL == mipMap) {
+        return;
+    }
+    SkAutoMutexAcquire ama(gMutex);
+    get_cache().add(SkNEW_ARGS(Rec, (Key(orig, 0, 0), mipMap)));
+}
+
+size_t SkScaledImageCache::GetBytesUsed() {
+    SkAutoMutexAcquire ama(gMutex);
+    return get_cache().bytesUsed();
+}
+
+size_t SkScaledImageCache::GetByteLimit() {
+    SkAutoMutexAcquire ama(gMutex);
+    return get_cache().byteLimit();
+}
+
+size_t SkScaledImageCache::SetByteLimit(size_t newLimit) {
+    SkAutoMutexAcquire ama(gMutex);
+    return get_cache().setByteLimit(newLimit);
+}
+
+void SkScaledImageCache::PurgeAll() {
+    SkAutoMutexAcquire ama(gMutex);
+    get_cache().purgeAll();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t SkGraphics::GetImageCacheBytesUsed() {
+    return SkScaledImageCache::GetBytesUsed();
+}
+
+size_t SkGraphics::GetImageCacheByteLimit() {
+    return SkScaledImageCache::GetByteLimit();
+}
+
+size_t SkGraphics::SetImageCacheByteLimit(size_t newLimit) {
+    return SkScaledImageCache::SetByteLimit(newLimit);
+}
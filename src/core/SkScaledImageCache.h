@@ -0,0 +1,66 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkScaledImageCache_DEFINED
+#define SkScaledImageCache_DEFINED
+
+#include "SkBitmap.h"
+
+class SkMipMap;
+
+/**
+ *  Process-wide cache of resampled bitmaps and mipmaps, so that drawing the
+ *  same image minified again does not resample it again. Entries are keyed by
+ *  the generation ID of the source's pixels and its subset, plus the scaled
+ *  size for resampled bitmaps, and are purged least recently used first to
+ *  keep the cache within its byte limit. All methods are thread-safe.
+ *
+ *  Bitmaps and mipmaps handed out by the cache hold a ref on their pixels, so
+ *  they stay valid if the cache purges them while they are in use.
+ */
+class SkScaledImageCache {
+public:
+    /**
+     *  If orig scaled to width x height is in the cache, sets scaled to it and
+     *  returns true. Otherwise returns false and leaves scaled alone.
+     */
+    static bool Find(const SkBitmap& orig, int width, int height, SkBitmap* scaled);
+
+    /**
+     *  Adds scaled as orig resampled to scaled's size, replacing any earlier
+     *  entry for it. Does nothing if orig's pixels have no generation ID.
+     */
+    static void Add(const SkBitmap& orig, const SkBitmap& scaled);
+
+    /**
+     *  Returns the mipmap of orig, ref()ed, or NULL if it is not in the cache.
+     */
+    static const SkMipMap* FindMipMap(const SkBitmap& orig);
+
+    /**
+     *  Adds mipMap as the mipmap of orig, replacing any earlier one. Does
+     *  nothing if orig's pixels have no generation ID.
+     */
+    static void AddMipMap(const SkBitmap& orig, const SkMipMap* mipMap);
+
+    /** Returns the number of bytes of pixels the cache is holding. */
+    static size_t GetBytesUsed();
+
+    /** Returns the most bytes of pixels the cache will hold. */
+    static size_t GetByteLimit();
+
+    /**
+     *  Sets the most bytes of pixels the cache will hold, purging entries if
+     *  needed, and returns the previous limit.
+     */
+    static size_t SetByteLimit(size_t newLimit);
+
+    /** Purges every entry. */
+    static void PurgeAll();
+};
+
+#endif
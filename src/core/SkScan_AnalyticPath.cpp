@@ -0,0 +1,472 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkScanPriv.h"
+#include "SkBlitter.h"
+#include "SkGeometry.h"
+#include "SkPath.h"
+#include "SkRasterClip.h"
+#include "SkRegion.h"
+#include "SkTDArray.h"
+#include "SkTSort.h"
+#include "SkTemplates.h"
+
+/** @file
+    An antialiasing scan converter that computes exact area coverage, rather
+    than supersampling (see SkScan_AntiPath.cpp).
+
+    The path is flattened into line segments. Each segment adds, to every
+    pixel cell it crosses, the signed area between it and the cell's right
+    edge; every cell to its right gets the remaining (full) signed height. A
+    running sum along each row then yields the winding-weighted coverage of
+    each pixel, which the fill rule turns into an alpha. This is the
+    accumulation scheme used by most font rasterizers: each row is touched
+    once, and coverage has 256 levels instead of 16.
+
+    Where edges of the path cross inside a single pixel, the summed signed
+    areas only approximate the true coverage, as they do for font rasterizers.
+
+    Rows are accumulated in strips of kStripHeight, so the buffer stays small
+    however tall the path is.
+ */
+
+static const int kStripHeight = 16;
+
+// Curves are flattened until the chord is within this distance (in pixels) of
+// the curve.
+static const float kFlattenTolerance = 0.125f;
+static const int kMaxCurveLines = 256;
+
+namespace {
+
+struct Line {
+    // fY0 < fY1 always; fDir records which way the original segment went.
+    float fX0, fY0, fX1, fY1;
+    float fDir;
+
+    bool operator<(const Line& other) const {
+        return fY0 < other.fY0;
+    }
+};
+
+// Collects the flattened path, in coordinates relative to the accumulation
+// bounds. Lines are clipped horizontally: whatever lies left of the bounds is
+// pinned to x == 0, so that it still contributes its winding to every pixel,
+// and whatever lies right of them is pinned to x == width, where it cannot.
+class LineBuilder {
+public:
+    LineBuilder(const SkIRect& bounds)
+        : fLeft(SkIntToScalar(bounds.fLeft))
+        , fTop(SkIntToScalar(bounds.fTop))
+        , fWidth(static_cast<float>(bounds.width()))
+        , fHeight(static_cast<float>(bounds.height())) {}
+
+    void addLine(const SkPoint& p0, const SkPoint& p1) {
+        this->addRelative(SkScalarToFloat(p0.fX - fLeft), SkScalarToFloat(p0.fY - fTop),
+                          SkScalarToFloat(p1.fX - fLeft), SkScalarToFloat(p1.fY - fTop));
+    }
+
+    void addQuad(const SkPoint pts[3]) {
+        SkScalar dx = SkScalarAbs(pts[0].fX - 2 * pts[1].fX + pts[2].fX);
+        SkScalar dy = SkScalarAbs(pts[0].fY - 2 * pts[1].fY + pts[2].fY);
+        // The chord of each of n pieces is within |p0 - 2p1 + p2| / (4n^2).
+        int n = count_pieces(SkScalarToFloat(SkMaxScalar(dx, dy)) / 4);
+        SkPoint prev = pts[0];
+        for (int i = 1; i < n; i++) {
+            SkPoint pt;
+            SkEvalQuadAt(pts, SkScalarDiv(SkIntToScalar(i), SkIntToScalar(n)), &pt);
+            this->addLine(prev, pt);
+            prev = pt;
+        }
+        this->addLine(prev, pts[2]);
+    }
+
+    void addCubic(const SkPoint pts[4]) {
+        SkScalar dx = SkMaxScalar(SkScalarAbs(pts[0].fX - 2 * pts[1].fX + pts[2].fX),
+                                  SkScalarAbs(pts[1].fX - 2 * pts[2].fX + pts[3].fX));
+        SkScalar dy = SkMaxScalar(SkScalarAbs(pts[0].fY - 2 * pts[1].fY + pts[2].fY),
+                                  SkScalarAbs(pts[1].fY - 2 * pts[2].fY + pts[3].fY));
+        // Likewise, each piece of a cubic is within 3/4 of its second difference.
+        int n = count_pieces(SkScalarToFloat(SkMaxScalar(dx, dy)) * 3 / 4);
+        SkPoint prev = pts[0];
+        for (int i = 1; i < n; i++) {
+            SkPoint pt;
+            SkEvalCubicAt(pts, SkScalarDiv(SkIntToScalar(i), SkIntToScalar(n)), &pt, NULL, NULL);
+            this->addLine(prev, pt);
+            prev = pt;
+        }
+        this->addLine(prev, pts[3]);
+    }
+
+    SkTDArray<Line>& lines() { return fLines; }
+
+private:
+    static int count_pieces(float deviation) {
+        float n = sk_float_ceil(sk_float_sqrt(deviation / kFlattenTolerance));
+        if (!(n > 1)) {
+            return 1;
+        }
+        return n < kMaxCurveLines ? static_cast<int>(n) : kMaxCurveLines;
+    }
+
+    void addRelative(float x0, float y0, float x1, float y1) {
+        if (y0 == y1) {
+            return;     // horizontal lines cover nothing
+        }
+        float dir = 1;
+        if (y0 > y1) {
+            SkTSwap(x0, x1);
+            SkTSwap(y0, y1);
+            dir = -1;
+        }
+        if (y1 <= 0 || y0 >= fHeight) {
+            return;
+        }
+
+        // Split where the line crosses x == 0 or x == width, in order of y.
+        float splits[2];
+        int splitCount = 0;
+        const float bounds[2] = { 0, fWidth };
+        for (int i = 0; i < 2; i++) {
+            const float b = (x0 < x1) ? bounds[i] : bounds[1 - i];
+            if ((x0 < b && b < x1) || (x1 < b && b < x0)) {
+                splits[splitCount++] = y0 + (y1 - y0) * (b - x0) / (x1 - x0);
+            }
+        }
+
+        float prevX = x0, prevY = y0;
+        for (int i = 0; i <= splitCount; i++) {
+            float nextY = (i < splitCount) ? splits[i] : y1;
+            float nextX = (i < splitCount) ? x0 + (x1 - x0) * (nextY - y0) / (y1 - y0) : x1;
+            this->append(this->pin(prevX), prevY, this->pin(nextX), nextY, dir);
+            prevX = nextX;
+            prevY = nextY;
+        }
+    }
+
+    float pin(float x) const {
+        return x < 0 ? 0 : (x > fWidth ? fWidth : x);
+    }
+
+    void append(float x0, float y0, float x1, float y1, float dir) {
+        if (y0 >= y1) {
+            return;
+        }
+        Line* line = fLines.append();
+        line->fX0 = x0;
+        line->fY0 = y0;
+        line->fX1 = x1;
+        line->fY1 = y1;
+        line->fDir = dir;
+    }
+
+    SkScalar        fLeft, fTop;
+    float           fWidth, fHeight;
+    SkTDArray<Line> fLines;
+};
+
+}  // namespace
+
+static inline float min_float(float a, float b) { return a < b ? a : b; }
+static inline float max_float(float a, float b) { return a > b ? a : b; }
+
+// The cells of a strip are grouped into blocks of kBlockSize, and each row
+// remembers which of its blocks any line has touched. Within the others the
+// winding cannot change, so they are turned into runs wholesale.
+static const int kBlockShift = 4;
+static const int kBlockSize = 1 << kBlockShift;
+
+struct Strip {
+    float*   fCells;    // kStripHeight rows of fStride cells
+    uint8_t* fDirty;    // kStripHeight rows of fBlocks flags
+    int      fStride;
+    int      fBlocks;
+    int      fWidth;    // pixels per row; fStride leaves two spare cells
+    int      fTop;      // first row of the strip, relative to the bounds
+};
+
+// Adds the coverage of line to the rows of strip in [strip.fTop, bottom).
+static void accumulate_line(const Line& line, const Strip& strip, int bottom) {
+    const float dxdy = (line.fX1 - line.fX0) / (line.fY1 - line.fY0);
+    const float yStart = max_float(line.fY0, static_cast<float>(strip.fTop));
+    const float yEnd = min_float(line.fY1, static_cast<float>(bottom));
+    const float maxX = static_cast<float>(strip.fWidth);
+    float x = line.fX0 + (yStart - line.fY0) * dxdy;
+
+    int y = static_cast<int>(yStart);
+    const int yLast = static_cast<int>(sk_float_ceil(yEnd));
+    for (; y < yLast; y++) {
+        float* row = strip.fCells + (y - strip.fTop) * strip.fStride;
+        const float dy = min_float(static_cast<float>(y + 1), yEnd) -
+                         max_float(static_cast<float>(y), yStart);
+        const float xNext = x + dxdy * dy;
+        const float d = dy * line.fDir;
+
+        // Stepping x may drift a hair past the edges it was pinned to.
+        float left = min_float(x, xNext);
+        float right = max_float(x, xNext);
+        left = min_float(max_float(left, 0), maxX);
+        right = min_float(max_float(right, 0), maxX);
+        const float leftFloor = sk_float_floor(left);
+        const int leftI = static_cast<int>(leftFloor);
+        const int rightI = static_cast<int>(sk_float_ceil(right));
+
+        int lastTouched = rightI;
+        if (rightI <= leftI + 1) {
+            // The segment stays within one pixel column.
+            const float mid = 0.5f * (left + right) - leftFloor;
+            row[leftI] += d - d * mid;
+            row[leftI + 1] += d * mid;
+            lastTouched = leftI + 1;
+        } else {
+            const float s = 1 / (right - left);
+            const float leftFrac = left - leftFloor;
+            const float a0 = 0.5f * s * (1 - leftFrac) * (1 - leftFrac);
+            const float rightFrac = right - rightI + 1;
+            const float am = 0.5f * s * rightFrac * rightFrac;
+
+            row[leftI] += d * a0;
+            if (rightI == leftI + 2) {
+                row[leftI + 1] += d * (1 - a0 - am);
+            } else {
+                const float a1 = s * (1.5f - leftFrac);
+                row[leftI + 1] += d * (a1 - a0);
+                for (int xi = leftI + 2; xi < rightI - 1; xi++) {
+                    row[xi] += d * s;
+                }
+                const float a2 = a1 + (rightI - leftI - 3) * s;
+                row[rightI - 1] += d * (1 - a2 - am);
+            }
+            row[rightI] += d * am;
+        }
+
+        uint8_t* dirty = strip.fDirty + (y - strip.fTop) * strip.fBlocks;
+        for (int block = leftI >> kBlockShift; block <= lastTouched >> kBlockShift; block++) {
+            dirty[block] = 1;
+        }
+        x = xNext;
+    }
+}
+
+static inline SkAlpha coverage_to_alpha(float winding, bool evenOdd) {
+    float coverage = sk_float_abs(winding);
+    if (evenOdd) {
+        coverage = coverage - 2 * sk_float_floor(coverage * 0.5f);
+        if (coverage > 1) {
+            coverage = 2 - coverage;
+        }
+    } else if (coverage > 1) {
+        coverage = 1;
+    }
+    return static_cast<SkAlpha>(coverage * 255 + 0.5f);
+}
+
+// Builds the alpha/runs arrays for blitAntiH, merging equal neighbours and
+// leaving out transparent pixels at either end.
+class RunBuilder {
+public:
+    RunBuilder(SkAlpha alpha[], int16_t runs[])
+        : fAlpha(alpha), fRuns(runs), fFirst(-1), fLast(-1), fRunStart(0) {}
+
+    // Appends count pixels of alpha a, starting at x.
+    void add(int x, int count, SkAlpha a) {
+        if (fFirst < 0) {
+            if (0 == a) {
+                return;
+            }
+            fFirst = fRunStart = x;
+            fAlpha[x] = a;
+        } else if (a != fAlpha[fRunStart]) {
+            fRuns[fRunStart] = SkToS16(x - fRunStart);
+            fRunStart = x;
+            fAlpha[x] = a;
+        }
+        if (0 != a) {
+            fLast = x + count - 1;
+        }
+    }
+
+    void blit(SkBlitter* blitter, int left, int y) {
+        if (fFirst < 0) {
+            return;
+        }
+        if (fRunStart > fLast) {
+            fRuns[fRunStart] = 0;   // trim the trailing transparent run
+        } else {
+            fRuns[fRunStart] = SkToS16(fLast + 1 - fRunStart);
+            fRuns[fLast + 1] = 0;
+        }
+        blitter->blitAntiH(left + fFirst, y, fAlpha + fFirst, fRuns + fFirst);
+    }
+
+private:
+    SkAlpha* fAlpha;
+    int16_t* fRuns;
+    int      fFirst, fLast, fRunStart;
+};
+
+// Turns row r of strip into alpha runs, clearing it for the next strip.
+static void blit_row(SkBlitter* blitter, int left, int y, const Strip& strip, int r,
+                     bool evenOdd, SkAlpha alpha[], int16_t runs[]) {
+    float* row = strip.fCells + r * strip.fStride;
+    uint8_t* dirty = strip.fDirty + r * strip.fBlocks;
+    const int width = strip.fWidth;
+    RunBuilder builder(alpha, runs);
+    float winding = 0;
+    for (int block = 0; block < strip.fBlocks; block++) {
+        const int start = block << kBlockShift;
+        if (start >= width) {
+            break;
+        }
+        const int stop = SkMin32(start + kBlockSize, width);
+        if (!dirty[block]) {
+            builder.add(start, stop - start, coverage_to_alpha(winding, evenOdd));
+            continue;
+        }
+        dirty[block] = 0;
+        for (int x = start; x < stop; x++) {
+            winding += row[x];
+            row[x] = 0;
+            builder.add(x, 1, coverage_to_alpha(winding, evenOdd));
+        }
+    }
+    // Anything spilled past the last pixel only needs clearing.
+    for (int x = width; x < strip.fStride; x++) {
+        row[x] = 0;
+    }
+    for (int block = width >> kBlockShift; block < strip.fBlocks; block++) {
+        dirty[block] = 0;
+    }
+    builder.blit(blitter, left, y);
+}
+
+void SkScan::AnalyticFillPath(const SkPath& path, const SkRegion& clip,
+                              SkBlitter* blitter) {
+    if (clip.isEmpty()) {
+        return;
+    }
+
+    // Inverse fills cover the whole clip, which the supersampler already
+    // handles by blitting the rows outside the path directly.
+    SkIRect ir;
+    static const int32_t kMaxCoord = 32767;
+    const SkRect& pathBounds = path.getBounds();
+    if (path.isInverseFillType() ||
+        !(pathBounds.fLeft > -kMaxCoord && pathBounds.fTop > -kMaxCoord &&
+          pathBounds.fRight < kMaxCoord && pathBounds.fBottom < kMaxCoord)) {
+        SkScan::AntiFillPath(path, clip, blitter);
+        return;
+    }
+    pathBounds.roundOut(&ir);
+    if (ir.isEmpty()) {
+        return;
+    }
+
+    SkIRect bounds;
+    if (!bounds.intersect(ir, clip.getBounds())) {
+        return;
+    }
+
+    SkScanClipper clipper(blitter, &clip, ir);
+    blitter = clipper.getBlitter();
+    if (NULL == blitter) {
+        return;     // clipped out
+    }
+
+    LineBuilder builder(bounds);
+    SkPath::Iter iter(path, true);
+    SkPoint pts[4];
+    SkPath::Verb verb;
+    while ((verb = iter.next(pts)) != SkPath::kDone_Verb) {
+        switch (verb) {
+            case SkPath::kLine_Verb:
+                builder.addLine(pts[0], pts[1]);
+                break;
+            case SkPath::kQuad_Verb:
+                builder.addQuad(pts);
+                break;
+            case SkPath::kCubic_Verb:
+                builder.addCubic(pts);
+                break;
+            default:
+                break;
+        }
+    }
+
+    SkTDArray<Line>& lines = builder.lines();
+    if (0 == lines.count()) {
+        return;
+    }
+    SkTQSort<Line>(lines.begin(), lines.end() - 1);
+
+    const int width = bounds.width();
+    const int height = bounds.height();
+    // Lines may spill their last bit of area one cell past the right edge, and
+    // the runs need a terminator there.
+    const int stride = width + 2;
+    const bool evenOdd = SkPath::kEvenOdd_FillType == path.getFillType();
+
+    const int blocks = (stride + kBlockSize - 1) >> kBlockShift;
+    SkAutoTMalloc<float>   cells(stride * kStripHeight);
+    SkAutoTMalloc<uint8_t> dirty(blocks * kStripHeight);
+    SkAutoSTMalloc<256, SkAlpha> alpha(stride);
+    SkAutoSTMalloc<256, int16_t> runs(stride);
+    sk_bzero(cells.get(), stride * kStripHeight * sizeof(float));
+    sk_bzero(dirty.get(), blocks * kStripHeight);
+
+    Strip strip;
+    strip.fCells = cells.get();
+    strip.fDirty = dirty.get();
+    strip.fStride = stride;
+    strip.fBlocks = blocks;
+    strip.fWidth = width;
+
+    // Lines still crossing the current strip, in no particular order.
+    SkTDArray<const Line*> active;
+    int next = 0;
+    for (int top = 0; top < height; top += kStripHeight) {
+        const int rows = SkMin32(kStripHeight, height - top);
+        const float bottom = static_cast<float>(top + rows);
+        strip.fTop = top;
+
+        while (next < lines.count() && lines[next].fY0 < bottom) {
+            *active.append() = &lines[next++];
+        }
+        for (int i = 0; i < active.count(); ) {
+            const Line* line = active[i];
+            accumulate_line(*line, strip, top + rows);
+            if (line->fY1 <= bottom) {
+                active.removeShuffle(i);
+            } else {
+                i++;
+            }
+        }
+
+        for (int r = 0; r < rows; r++) {
+            blit_row(blitter, bounds.fLeft, bounds.fTop + top + r, strip, r, evenOdd,
+                     alpha.get(), runs.get());
+        }
+    }
+}
+
+void SkScan::AnalyticFillPath(const SkPath& path, const SkRasterClip& clip,
+                              SkBlitter* blitter) {
+    if (clip.isEmpty()) {
+        return;
+    }
+
+    if (clip.isBW()) {
+        AnalyticFillPath(path, clip.bwRgn(), blitter);
+    } else {
+        SkRegion        tmp;
+        SkAAClipBlitter aaBlitter;
+
+        tmp.setRect(clip.getBounds());
+        aaBlitter.init(blitter, &clip.aaRgn());
+        SkScan::AnalyticFillPath(path, tmp, &aaBlitter);
+    }
+}
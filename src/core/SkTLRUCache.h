@@ -0,0 +1,131 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkTLRUCache_DEFINED
+#define SkTLRUCache_DEFINED
+
+#include "SkTInternalLList.h"
+
+/**
+ *  This macro creates the member variables required by SkTLRUCache. It
+ *  should be placed in the private section of any class that will be stored
+ *  in the cache.
+ */
+#define SK_DECLARE_LRU_CACHE_INTERFACE(ClassName)                   \
+    template <typename, typename> friend class ::SkTLRUCache;       \
+    SK_DECLARE_INTERNAL_LLIST_INTERFACE(ClassName);                 \
+    ClassName* fBucketNext
+
+/**
+ *  A cache of records that purges the least recently used ones to stay within
+ *  a byte limit. Records are found through a table of buckets by the hash of
+ *  their key, so a lookup does not walk the whole cache. The cache owns its
+ *  records, and SkDELETEs them when they are purged. It does no locking.
+ *
+ *  T must provide
+ *      Key getKey() const;
+ *      uint32_t getHash() const;       // the hash of getKey()
+ *      size_t bytesUsed() const;
+ *  and Key must provide operator==.
+ */
+template <typename T, typename Key> class SkTLRUCache : public SkNoncopyable {
+public:
+    explicit SkTLRUCache(size_t byteLimit) : fBytesUsed(0), fByteLimit(byteLimit) {
+        sk_bzero(fBuckets, sizeof(fBuckets));
+    }
+
+    ~SkTLRUCache() {
+        this->purgeAll();
+    }
+
+    /**
+     *  Returns the record for key, whose hash is hash, and marks it most
+     *  recently used, or returns NULL if it is not in the cache.
+     */
+    T* find(const Key& key, uint32_t hash) {
+        for (T* rec = fBuckets[BucketIndex(hash)]; NULL != rec; rec = rec->fBucketNext) {
+            if (rec->getHash() == hash && rec->getKey() == key) {
+                if (rec != fList.head()) {
+                    fList.remove(rec);
+                    fList.addToHead(rec);
+                }
+                return rec;
+            }
+        }
+        return NULL;
+    }
+
+    /**
+     *  Takes ownership of rec, replacing any record with the same key, then
+     *  purges as needed. rec itself is kept even if it alone is over the
+     *  limit, since the caller is about to use it.
+     */
+    void add(T* rec) {
+        T* prev = this->find(rec->getKey(), rec->getHash());
+        if (NULL != prev) {
+            this->remove(prev);
+        }
+        fList.addToHead(rec);
+        T** bucket = &fBuckets[BucketIndex(rec->getHash())];
+        rec->fBucketNext = *bucket;
+        *bucket = rec;
+        fBytesUsed += rec->bytesUsed();
+        this->purgeAsNeeded();
+    }
+
+    size_t bytesUsed() const { return fBytesUsed; }
+    size_t byteLimit() const { return fByteLimit; }
+
+    /** Sets the byte limit, purging as needed, and returns the previous one. */
+    size_t setByteLimit(size_t newLimit) {
+        size_t prevLimit = fByteLimit;
+        fByteLimit = newLimit;
+        this->purgeAsNeeded();
+        return prevLimit;
+    }
+
+    void purgeAll() {
+        while (NULL != fList.tail()) {
+            this->remove(fList.tail());
+        }
+    }
+
+private:
+    enum {
+        kBucketBits     = 8,
+        kBucketCount    = 1 << kBucketBits,
+        kBucketMask     = kBucketCount - 1
+    };
+
+    static int BucketIndex(uint32_t hash) {
+        return (hash ^ (hash >> 16)) & kBucketMask;
+    }
+
+    void purgeAsNeeded() {
+        while (fBytesUsed > fByteLimit && fList.tail() != fList.head()) {
+            this->remove(fList.tail());
+        }
+    }
+
+    void remove(T* rec) {
+        T** prev = &fBuckets[BucketIndex(rec->getHash())];
+        while (*prev != rec) {
+            prev = &(*prev)->fBucketNext;
+        }
+        *prev = rec->fBucketNext;
+        fList.remove(rec);
+        fBytesUsed -= rec->bytesUsed();
+        SkDELETE(rec);
+    }
+
+    T*                  fBuckets[kBucketCount];
+    SkTInternalLList<T> fList;      // most recently used first
+    size_t              fBytesUsed;
+    size_t              fByteLimit;
+};
+
+#endif
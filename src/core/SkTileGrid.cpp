@@ -23,15 +23,14 @@ SkTileGrid::SkTileGrid(int xTileCount, int yTileCount, const SkTileGridPicture::
     fGridBounds = SkIRect::MakeXYWH(0, 0, fInfo.fTileInterval.width() * fXTileCount,
         fInfo.fTileInterval.height() * fYTileCount);
     fNextDatumFunction = nextDatumFunction;
-    fTileData = SkNEW_ARRAY(SkTDArray<void *>, fTileCount);
+    fTileStarts = (int*)sk_malloc_throw((fTileCount + 1) * sizeof(int));
+    sk_bzero(fTileStarts, (fTileCount + 1) * sizeof(int));
+    fTileData = NULL;
 }
 
 SkTileGrid::~SkTileGrid() {
-    SkDELETE_ARRAY(fTileData);
-}
-
-SkTDArray<void *>& SkTileGrid::tile(int x, int y) {
-    return fTileData[y * fXTileCount + x];
+    sk_free(fTileStarts);
+    sk_free(fTileData);
 }
 
 void SkTileGrid::insert(void* data, const SkIRect& bounds, bool) {
@@ -54,15 +53,69 @@ void SkTileGrid::insert(void* data, const SkIRect& bounds, bool) {
     int maxTileY = SkMax32(SkMin32((dilatedBounds.bottom() -1) / fInfo.fTileInterval.height(),
         fYTileCount -1), 0);
 
-    for (int x = minTileX; x <= maxTileX; x++) {
-        for (int y = minTileY; y <= maxTileY; y++) {
-            this->tile(x, y).push(data);
+    PendingInsert* pending = fPending.append();
+    pending->fData = data;
+    pending->fMinTileX = minTileX;
+    pending->fMaxTileX = maxTileX;
+    pending->fMinTileY = minTileY;
+    pending->fMaxTileY = maxTileY;
+    fInsertionCount++;
+}
+
+void SkTileGrid::flushDeferredInserts() {
+    if (fPending.isEmpty()) {
+        return;
+    }
+
+    // Count what each tile will hold, then turn the counts into where each
+    // tile's elements start.
+    int* newStarts = (int*)sk_malloc_throw((fTileCount + 1) * sizeof(int));
+    newStarts[0] = 0;
+    for (int i = 0; i < fTileCount; ++i) {
+        newStarts[i + 1] = fTileStarts[i + 1] - fTileStarts[i];
+    }
+    for (int i = 0; i < fPending.count(); ++i) {
+        const PendingInsert& pending = fPending[i];
+        for (int y = pending.fMinTileY; y <= pending.fMaxTileY; ++y) {
+            for (int x = pending.fMinTileX; x <= pending.fMaxTileX; ++x) {
+                newStarts[this->tileIndex(x, y) + 1]++;
+            }
         }
     }
-    fInsertionCount++;
+    for (int i = 0; i < fTileCount; ++i) {
+        newStarts[i + 1] += newStarts[i];
+    }
+
+    // The pending insertions were made after everything already in the
+    // tiles, so they follow it in each tile.
+    int total = newStarts[fTileCount];
+    void** newData = total > 0 ? (void**)sk_malloc_throw(total * sizeof(void*)) : NULL;
+    SkAutoTMalloc<int> ends(fTileCount);
+    for (int i = 0; i < fTileCount; ++i) {
+        int count = fTileStarts[i + 1] - fTileStarts[i];
+        if (count > 0) {
+            memcpy(newData + newStarts[i], fTileData + fTileStarts[i], count * sizeof(void*));
+        }
+        ends[i] = newStarts[i] + count;
+    }
+    for (int i = 0; i < fPending.count(); ++i) {
+        const PendingInsert& pending = fPending[i];
+        for (int y = pending.fMinTileY; y <= pending.fMaxTileY; ++y) {
+            for (int x = pending.fMinTileX; x <= pending.fMaxTileX; ++x) {
+                newData[ends[this->tileIndex(x, y)]++] = pending.fData;
+            }
+        }
+    }
+
+    sk_free(fTileStarts);
+    sk_free(fTileData);
+    fTileStarts = newStarts;
+    fTileData = newData;
+    fPending.reset();
 }
 
 void SkTileGrid::search(const SkIRect& query, SkTDArray<void*>* results) {
+    this->flushDeferredInserts();
     SkIRect adjustedQuery = query;
     // The inset is to counteract the outset that was applied in 'insert'
     // The outset/inset is to optimize for lookups of size
@@ -87,37 +140,38 @@ void SkTileGrid::search(const SkIRect& query, SkTDArray<void*>* results) {
 
     int queryTileCount = (tileEndX - tileStartX) * (tileEndY - tileStartY);
     SkASSERT(queryTileCount);
+    results->reset();
     if (queryTileCount == 1) {
-        *results = this->tile(tileStartX, tileStartY);
+        results->append(this->tileCount(tileStartX, tileStartY),
+                        this->tile(tileStartX, tileStartY));
     } else {
-        results->reset();
-        SkTDArray<int> curPositions;
-        curPositions.setCount(queryTileCount);
         // Note: Reserving space for 1024 tile pointers on the stack. If the
         // malloc becomes a bottleneck, we may consider increasing that number.
         // Typical large web page, say 2k x 16k, would require 512 tiles of
         // size 256 x 256 pixels.
-        SkAutoSTArray<1024, SkTDArray<void *>*> storage(queryTileCount);
-        SkTDArray<void *>** tileRange = storage.get();
+        SkAutoSTArray<1024, void**> starts(queryTileCount);
+        SkAutoSTArray<1024, void**> ends(queryTileCount);
         int tile = 0;
         for (int x = tileStartX; x < tileEndX; ++x) {
             for (int y = tileStartY; y < tileEndY; ++y) {
-                tileRange[tile] = &this->tile(x, y);
-                curPositions[tile] = tileRange[tile]->count() ? 0 : kTileFinished;
+                starts[tile] = this->tile(x, y);
+                ends[tile] = starts[tile] + this->tileCount(x, y);
                 ++tile;
             }
         }
         void *nextElement;
-        while(NULL != (nextElement = fNextDatumFunction(tileRange, curPositions))) {
+        while(NULL != (nextElement = fNextDatumFunction(starts.get(), ends.get(),
+                                                        queryTileCount))) {
             results->push(nextElement);
         }
     }
 }
 
 void SkTileGrid::clear() {
-    for (int i = 0; i < fTileCount; i++) {
-        fTileData[i].reset();
-    }
+    sk_bzero(fTileStarts, (fTileCount + 1) * sizeof(int));
+    sk_free(fTileData);
+    fTileData = NULL;
+    fPending.reset();
 }
 
 int SkTileGrid::getCount() const {
@@ -126,9 +180,30 @@ int SkTileGrid::getCount() const {
 
 void SkTileGrid::rewindInserts() {
     SkASSERT(fClient);
+    // The rewound elements are the most recent insertions, so they are at the
+    // back of fPending. Only if all of those are rewound can there be more in
+    // the tiles.
+    while (!fPending.isEmpty() && fClient->shouldRewind(fPending.top().fData)) {
+        fPending.pop();
+    }
+    if (!fPending.isEmpty()) {
+        return;
+    }
+
+    // Drop the rewound elements from the end of each tile, and move the rest
+    // of the tiles down over them.
+    int dst = 0;
     for (int i = 0; i < fTileCount; ++i) {
-        while (!fTileData[i].isEmpty() && fClient->shouldRewind(fTileData[i].top())) {
-            fTileData[i].pop();
+        int start = fTileStarts[i];
+        int end = fTileStarts[i + 1];
+        while (end > start && fClient->shouldRewind(fTileData[end - 1])) {
+            --end;
+        }
+        fTileStarts[i] = dst;
+        if (end > start && dst != start) {
+            memmove(fTileData + dst, fTileData + start, (end - start) * sizeof(void*));
         }
+        dst += end - start;
     }
+    fTileStarts[fTileCount] = dst;
 }
@@ -19,13 +19,20 @@
  * structure that will be use in search() calls is known prior to insertion.
  * Calls to search will return in constant time.
  *
+ * The buckets are stored together, compressed sparse row style: one array
+ * holds the elements of every tile, tile after tile, and another holds where
+ * each tile's elements start. Insertions are collected as ranges of tiles
+ * until the grid is flushed or searched, then added to the buckets in one
+ * pass.
+ *
  * Note: Current implementation of search() only supports looking-up regions
  * that are an exact match to a single tile.  Implementation could be augmented
  * to support arbitrary rectangles, but performance would be sub-optimal.
  */
 class SkTileGrid : public SkBBoxHierarchy {
 public:
-    typedef void* (*SkTileGridNextDatumFunctionPtr)(SkTDArray<void*>** tileData, SkTDArray<int>& tileIndices);
+    typedef void* (*SkTileGridNextDatumFunctionPtr)(void*** tileData, void** const* tileEnds,
+                                                    int tileCount);
 
     SkTileGrid(int xTileCount, int yTileCount, const SkTileGridPicture::TileGridInfo& info,
         SkTileGridNextDatumFunctionPtr nextDatumFunction);
@@ -36,11 +43,15 @@ public:
      * Insert a data pointer and corresponding bounding box
      * @param data The data pointer, may be NULL
      * @param bounds The bounding box, should not be empty
-     * @param defer Ignored, TileArray does not defer insertions
+     * @param defer Ignored, insertions are always added to the tiles when the
+     *              grid is next flushed or searched
      */
     virtual void insert(void* data, const SkIRect& bounds, bool) SK_OVERRIDE;
 
-    virtual void flushDeferredInserts() SK_OVERRIDE {};
+    /**
+     * Adds the insertions made since the last flush to the tiles
+     */
+    virtual void flushDeferredInserts() SK_OVERRIDE;
 
     /**
      * Populate 'results' with data pointers corresponding to bounding boxes that intersect 'query'
@@ -57,16 +68,28 @@ public:
 
     virtual void rewindInserts() SK_OVERRIDE;
 
-    // Used by search() and in SkTileGridHelper implementations
-    enum {
-        kTileFinished = -1,
-    };
 private:
-    SkTDArray<void*>& tile(int x, int y);
+    // An insertion that has yet to be added to the tiles, and the tiles it covers
+    struct PendingInsert {
+        void* fData;
+        int fMinTileX, fMaxTileX, fMinTileY, fMaxTileY;
+    };
+
+    int tileIndex(int x, int y) const { return y * fXTileCount + x; }
+    // Number of elements in a tile, and the first of them
+    int tileCount(int x, int y) const {
+        int index = this->tileIndex(x, y);
+        return fTileStarts[index + 1] - fTileStarts[index];
+    }
+    void** tile(int x, int y) const { return fTileData + fTileStarts[this->tileIndex(x, y)]; }
 
     int fXTileCount, fYTileCount, fTileCount;
     SkTileGridPicture::TileGridInfo fInfo;
-    SkTDArray<void*>* fTileData;
+    // fTileCount + 1 offsets into fTileData: tile i holds the elements from
+    // fTileStarts[i] up to fTileStarts[i + 1]
+    int* fTileStarts;
+    void** fTileData;
+    SkTDArray<PendingInsert> fPending;
     int fInsertionCount;
     SkIRect fGridBounds;
     SkTileGridNextDatumFunctionPtr fNextDatumFunction;
@@ -79,28 +102,27 @@ private:
  * Generic implementation for SkTileGridNextDatumFunctionPtr. user code may instantiate
  * this template to get a valid SkTileGridNextDatumFunction implementation
  *
- * Returns the next element of tileData[i][tileIndices[i]] for all i and advances
- * tileIndices[] past them. The order in which data are returned by successive
+ * Returns the next element of *tileData[i] for all i and advances
+ * tileData[] past them. The order in which data are returned by successive
  * calls to this method must reflect the order in which the were originally
  * recorded into the tile grid.
  *
- * \param tileData array of pointers to arrays of tile data
- * \param tileIndices per-tile data indices, indices are incremented for tiles that contain
- *     the next datum.
+ * \param tileData per-tile pointers to the next datum of each tile; pointers are incremented
+ *     for tiles that contain the next datum.
+ * \param tileEnds per-tile pointers past the last datum of each tile
+ * \param tileCount number of tiles
  * \tparam T a type to which it is safe to cast a datum and that has an operator <
  *     such that 'a < b' is true if 'a' was inserted into the tile grid before 'b'.
  */
 template <typename T>
-void* SkTileGridNextDatum(SkTDArray<void*>** tileData, SkTDArray<int>& tileIndices) {
+void* SkTileGridNextDatum(void*** tileData, void** const* tileEnds, int tileCount) {
     T* minVal = NULL;
-    int tileCount = tileIndices.count();
     int minIndex = tileCount;
     int maxIndex = 0;
     // Find the next Datum; track where it's found so we reduce the size of the second loop.
     for (int tile = 0; tile < tileCount; ++tile) {
-        int pos = tileIndices[tile];
-        if (pos != SkTileGrid::kTileFinished) {
-            T* candidate = (T*)(*tileData[tile])[pos];
+        if (tileData[tile] != tileEnds[tile]) {
+            T* candidate = (T*)*tileData[tile];
             if (NULL == minVal || (*candidate) < (*minVal)) {
                 minVal = candidate;
                 minIndex = tile;
@@ -112,14 +134,11 @@ void* SkTileGridNextDatum(SkTDArray<void*>** tileData, SkTDArray<int>& tileIndic
             }
         }
     }
-    // Increment indices past the next datum
+    // Increment pointers past the next datum
     if (minVal != NULL) {
         for (int tile = minIndex; tile <= maxIndex; ++tile) {
-            int pos = tileIndices[tile];
-            if (pos != SkTileGrid::kTileFinished && (*tileData[tile])[pos] == minVal) {
-                if (++(tileIndices[tile]) >= tileData[tile]->count()) {
-                    tileIndices[tile] = SkTileGrid::kTileFinished;
-                }
+            if (tileData[tile] != tileEnds[tile] && *tileData[tile] == minVal) {
+                ++tileData[tile];
             }
         }
         return minVal;
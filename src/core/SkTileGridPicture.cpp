@@ -7,6 +7,7 @@
 
 #include "SkTileGridPicture.h"
 
+#include "SkAdaptiveTileGrid.h"
 #include "SkPictureStateTree.h"
 #include "SkTileGrid.h"
 
@@ -22,7 +23,18 @@ SkTileGridPicture::SkTileGridPicture(int width, int height, const TileGridInfo&
     fYTileCount = (height + info.fTileInterval.height() - 1) / info.fTileInterval.height();
 }
 
+SkTileGridPicture::SkTileGridPicture(int width, int height) {
+    fInfo.fTileInterval.setEmpty();
+    fInfo.fMargin.setEmpty();
+    fInfo.fOffset.setZero();
+    fXTileCount = fYTileCount = 0;
+}
+
 SkBBoxHierarchy* SkTileGridPicture::createBBoxHierarchy() const {
+    if (fInfo.fTileInterval.isEmpty()) {
+        return SkNEW_ARGS(SkAdaptiveTileGrid, (fWidth, fHeight,
+             SkTileGridNextDatum<SkPictureStateTree::Draw>));
+    }
     return SkNEW_ARGS(SkTileGrid, (fXTileCount, fYTileCount, fInfo,
          SkTileGridNextDatum<SkPictureStateTree::Draw>));
 }
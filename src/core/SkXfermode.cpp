@@ -8,6 +8,7 @@
 
 
 #include "SkXfermode.h"
+#include "SkXfermode_proccoeff.h"
 #include "SkColorPriv.h"
 #include "SkFlattenableBuffers.h"
 #include "SkMathPriv.h"
@@ -629,14 +630,6 @@ static SkPMColor luminosity_modeproc(SkPMColor src, SkPMColor dst) {
 }
 
 
-struct ProcCoeff {
-    SkXfermodeProc      fProc;
-    SkXfermode::Coeff   fSC;
-    SkXfermode::Coeff   fDC;
-};
-
-#define CANNOT_USE_COEFF    SkXfermode::Coeff(-1)
-
 static const ProcCoeff gProcCoeffs[] = {
     { clear_modeproc,   SkXfermode::kZero_Coeff,    SkXfermode::kZero_Coeff },
     { src_modeproc,     SkXfermode::kOne_Coeff,     SkXfermode::kZero_Coeff },
@@ -1031,81 +1024,71 @@ GrEffectRef* DarkenEffect::TestCreate(SkMWCRandom*,
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-class SkProcCoeffXfermode : public SkProcXfermode {
-public:
-    SkProcCoeffXfermode(const ProcCoeff& rec, Mode mode)
-            : INHERITED(rec.fProc) {
-        fMode = mode;
-        // these may be valid, or may be CANNOT_USE_COEFF
-        fSrcCoeff = rec.fSC;
-        fDstCoeff = rec.fDC;
+bool SkProcCoeffXfermode::asMode(Mode* mode) const {
+    if (mode) {
+        *mode = fMode;
     }
+    return true;
+}
 
-    virtual bool asMode(Mode* mode) const SK_OVERRIDE {
-        if (mode) {
-            *mode = fMode;
-        }
-        return true;
+bool SkProcCoeffXfermode::asCoeff(Coeff* sc, Coeff* dc) const {
+    if (CANNOT_USE_COEFF == fSrcCoeff) {
+        return false;
     }
 
-    virtual bool asCoeff(Coeff* sc, Coeff* dc) const SK_OVERRIDE {
-        if (CANNOT_USE_COEFF == fSrcCoeff) {
-            return false;
-        }
-
-        if (sc) {
-            *sc = fSrcCoeff;
-        }
-        if (dc) {
-            *dc = fDstCoeff;
-        }
-        return true;
+    if (sc) {
+        *sc = fSrcCoeff;
     }
+    if (dc) {
+        *dc = fDstCoeff;
+    }
+    return true;
+}
 
 #if SK_SUPPORT_GPU
-    virtual bool asNewEffectOrCoeff(GrContext*,
-                                    GrEffectRef** effect,
-                                    Coeff* src,
-                                    Coeff* dst) const SK_OVERRIDE {
-        if (this->asCoeff(src, dst)) {
-            return true;
-        }
-        if (kDarken_Mode == fMode) {
-            if (NULL != effect) {
-                *effect = DarkenEffect::Create();
-            }
-            return true;
+bool SkProcCoeffXfermode::asNewEffectOrCoeff(GrContext*,
+                                             GrEffectRef** effect,
+                                             Coeff* src,
+                                             Coeff* dst) const {
+    if (this->asCoeff(src, dst)) {
+        return true;
+    }
+    if (kDarken_Mode == fMode) {
+        if (NULL != effect) {
+            *effect = DarkenEffect::Create();
         }
-        return false;
+        return true;
     }
+    return false;
+}
 #endif
 
-    SK_DEVELOPER_TO_STRING()
-    SK_DECLARE_PUBLIC_FLATTENABLE_DESERIALIZATION_PROCS(SkProcCoeffXfermode)
-
-protected:
-    SkProcCoeffXfermode(SkFlattenableReadBuffer& buffer) : INHERITED(buffer) {
-        fMode = (SkXfermode::Mode)buffer.read32();
-
-        const ProcCoeff& rec = gProcCoeffs[fMode];
-        // these may be valid, or may be CANNOT_USE_COEFF
-        fSrcCoeff = rec.fSC;
-        fDstCoeff = rec.fDC;
-        // now update our function-ptr in the super class
-        this->INHERITED::setProc(rec.fProc);
-    }
+SkProcCoeffXfermode::SkProcCoeffXfermode(SkFlattenableReadBuffer& buffer) : INHERITED(buffer) {
+    fMode = (SkXfermode::Mode)buffer.read32();
 
-    virtual void flatten(SkFlattenableWriteBuffer& buffer) const SK_OVERRIDE {
-        this->INHERITED::flatten(buffer);
-        buffer.write32(fMode);
-    }
+    const ProcCoeff& rec = gProcCoeffs[fMode];
+    // these may be valid, or may be CANNOT_USE_COEFF
+    fSrcCoeff = rec.fSC;
+    fDstCoeff = rec.fDC;
+    // now update our function-ptr in the super class
+    this->INHERITED::setProc(rec.fProc);
+}
 
-private:
-    Mode    fMode;
-    Coeff   fSrcCoeff, fDstCoeff;
+SkFlattenable* SkProcCoeffXfermode::CreateProc(SkFlattenableReadBuffer& buffer) {
+    SkProcCoeffXfermode* xfer = SkNEW_ARGS(SkProcCoeffXfermode, (buffer));
+    SkProcCoeffXfermode* platformXfer = SkPlatformXfermodeFactory(gProcCoeffs[xfer->fMode],
+                                                                  xfer->fMode);
+    if (NULL != platformXfer) {
+        xfer->unref();
+        return platformXfer;
+    }
+    return xfer;
+}
 
-    typedef SkProcXfermode INHERITED;
-};
+void SkProcCoeffXfermode::flatten(SkFlattenableWriteBuffer& buffer) const {
+    this->INHERITED::flatten(buffer);
+    buffer.write32(fMode);
+}
 
 const char* SkXfermode::ModeName(Mode mode) {
     SkASSERT((unsigned) mode <= (unsigned)kLastMode);
@@ -1382,8 +1365,13 @@ SkXfermode* SkXfermode::Create(Mode mode) {
             return SkNEW_ARGS(SkDstInXfermode, (rec));
         case kDstOut_Mode:
             return SkNEW_ARGS(SkDstOutXfermode, (rec));
-        default:
+        default: {
+            SkXfermode* xfer = SkPlatformXfermodeFactory(rec, mode);
+            if (NULL != xfer) {
+                return xfer;
+            }
             return SkNEW_ARGS(SkProcCoeffXfermode, (rec, mode));
+        }
     }
 }
 
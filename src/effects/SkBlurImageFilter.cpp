@@ -7,6 +7,7 @@
 
 #include "SkBitmap.h"
 #include "SkBlurImageFilter.h"
+#include "SkBlurMask.h"
 #include "SkColorPriv.h"
 #include "SkFlattenableBuffers.h"
 #if SK_SUPPORT_GPU
@@ -31,94 +32,6 @@ void SkBlurImageFilter::flatten(SkFlattenableWriteBuffer& buffer) const {
     buffer.writeScalar(fSigma.fHeight);
 }
 
-static void boxBlurX(const SkBitmap& src, SkBitmap* dst, int kernelSize,
-                     int leftOffset, int rightOffset)
-{
-    int width = src.width(), height = src.height();
-    int rightBorder = SkMin32(rightOffset + 1, width);
-    for (int y = 0; y < height; ++y) {
-        int sumA = 0, sumR = 0, sumG = 0, sumB = 0;
-        SkPMColor* p = src.getAddr32(0, y);
-        for (int i = 0; i < rightBorder; ++i) {
-            sumA += SkGetPackedA32(*p);
-            sumR += SkGetPackedR32(*p);
-            sumG += SkGetPackedG32(*p);
-            sumB += SkGetPackedB32(*p);
-            p++;
-        }
-
-        const SkColor* sptr = src.getAddr32(0, y);
-        SkColor* dptr = dst->getAddr32(0, y);
-        for (int x = 0; x < width; ++x) {
-            *dptr = SkPackARGB32(sumA / kernelSize,
-                                 sumR / kernelSize,
-                                 sumG / kernelSize,
-                                 sumB / kernelSize);
-            if (x >= leftOffset) {
-                SkColor l = *(sptr - leftOffset);
-                sumA -= SkGetPackedA32(l);
-                sumR -= SkGetPackedR32(l);
-                sumG -= SkGetPackedG32(l);
-                sumB -= SkGetPackedB32(l);
-            }
-            if (x + rightOffset + 1 < width) {
-                SkColor r = *(sptr + rightOffset + 1);
-                sumA += SkGetPackedA32(r);
-                sumR += SkGetPackedR32(r);
-                sumG += SkGetPackedG32(r);
-                sumB += SkGetPackedB32(r);
-            }
-            sptr++;
-            dptr++;
-        }
-    }
-}
-
-static void boxBlurY(const SkBitmap& src, SkBitmap* dst, int kernelSize,
-                     int topOffset, int bottomOffset)
-{
-    int width = src.width(), height = src.height();
-    int bottomBorder = SkMin32(bottomOffset + 1, height);
-    int srcStride = src.rowBytesAsPixels();
-    int dstStride = dst->rowBytesAsPixels();
-    for (int x = 0; x < width; ++x) {
-        int sumA = 0, sumR = 0, sumG = 0, sumB = 0;
-        SkColor* p = src.getAddr32(x, 0);
-        for (int i = 0; i < bottomBorder; ++i) {
-            sumA += SkGetPackedA32(*p);
-            sumR += SkGetPackedR32(*p);
-            sumG += SkGetPackedG32(*p);
-            sumB += SkGetPackedB32(*p);
-            p += srcStride;
-        }
-
-        const SkColor* sptr = src.getAddr32(x, 0);
-        SkColor* dptr = dst->getAddr32(x, 0);
-        for (int y = 0; y < height; ++y) {
-            *dptr = SkPackARGB32(sumA / kernelSize,
-                                 sumR / kernelSize,
-                                 sumG / kernelSize,
-                                 sumB / kernelSize);
-            if (y >= topOffset) {
-                SkColor l = *(sptr - topOffset * srcStride);
-                sumA -= SkGetPackedA32(l);
-                sumR -= SkGetPackedR32(l);
-                sumG -= SkGetPackedG32(l);
-                sumB -= SkGetPackedB32(l);
-            }
-            if (y + bottomOffset + 1 < height) {
-                SkColor r = *(sptr + (bottomOffset + 1) * srcStride);
-                sumA += SkGetPackedA32(r);
-                sumR += SkGetPackedR32(r);
-                sumG += SkGetPackedG32(r);
-                sumB += SkGetPackedB32(r);
-            }
-            sptr += srcStride;
-            dptr += dstStride;
-        }
-    }
-}
-
 static void getBox3Params(SkScalar s, int *kernelSize, int* kernelSize3, int *lowOffset, int *highOffset)
 {
     float pi = SkScalarToFloat(SK_ScalarPI);
@@ -169,21 +82,32 @@ bool SkBlurImageFilter::onFilterImage(Proxy* proxy,
         return false;
     }
 
+    // Every pass blurs along the rows of its source. Transposing as it writes
+    // makes the next pass blur the other direction, so temp and dst are used
+    // as plain buffers of w * h pixels, holding either orientation.
+    int w = src.width(), h = src.height();
+    const SkPMColor* s = src.getAddr32(0, 0);
+    int sRowPixels = src.rowBytesAsPixels();
+    SkPMColor* t = temp.getAddr32(0, 0);
+    SkPMColor* d = dst->getAddr32(0, 0);
+
     if (kernelSizeX > 0 && kernelSizeY > 0) {
-        boxBlurX(src,  &temp, kernelSizeX,  lowOffsetX, highOffsetX);
-        boxBlurY(temp, dst,   kernelSizeY,  lowOffsetY, highOffsetY);
-        boxBlurX(*dst, &temp, kernelSizeX,  highOffsetX,  lowOffsetX);
-        boxBlurY(temp, dst,   kernelSizeY,  highOffsetY,  lowOffsetY);
-        boxBlurX(*dst, &temp, kernelSizeX3, highOffsetX, highOffsetX);
-        boxBlurY(temp, dst,   kernelSizeY3, highOffsetY, highOffsetY);
+        SkBlurMask::BoxBlur32(s, sRowPixels, t, h, kernelSizeX,  lowOffsetX,  highOffsetX, w, h, true);
+        SkBlurMask::BoxBlur32(t, h,          d, w, kernelSizeY,  lowOffsetY,  highOffsetY, h, w, true);
+        SkBlurMask::BoxBlur32(d, w,          t, h, kernelSizeX,  highOffsetX, lowOffsetX,  w, h, true);
+        SkBlurMask::BoxBlur32(t, h,          d, w, kernelSizeY,  highOffsetY, lowOffsetY,  h, w, true);
+        SkBlurMask::BoxBlur32(d, w,          t, h, kernelSizeX3, highOffsetX, highOffsetX, w, h, true);
+        SkBlurMask::BoxBlur32(t, h,          d, w, kernelSizeY3, highOffsetY, highOffsetY, h, w, true);
     } else if (kernelSizeX > 0) {
-        boxBlurX(src,  dst,   kernelSizeX,  lowOffsetX, highOffsetX);
-        boxBlurX(*dst, &temp, kernelSizeX,  highOffsetX,  lowOffsetX);
-        boxBlurX(temp, dst,   kernelSizeX3, highOffsetX, highOffsetX);
+        SkBlurMask::BoxBlur32(s, sRowPixels, d, w, kernelSizeX,  lowOffsetX,  highOffsetX, w, h, false);
+        SkBlurMask::BoxBlur32(d, w,          t, w, kernelSizeX,  highOffsetX, lowOffsetX,  w, h, false);
+        SkBlurMask::BoxBlur32(t, w,          d, w, kernelSizeX3, highOffsetX, highOffsetX, w, h, false);
     } else if (kernelSizeY > 0) {
-        boxBlurY(src,  dst,   kernelSizeY,  lowOffsetY, highOffsetY);
-        boxBlurY(*dst, &temp, kernelSizeY,  highOffsetY, lowOffsetY);
-        boxBlurY(temp, dst,   kernelSizeY3, highOffsetY, highOffsetY);
+        // A kernel of 1 just transposes, so that the Y blurs can read rows.
+        SkBlurMask::BoxBlur32(s, sRowPixels, t, h, 1,            0,           0,           w, h, true);
+        SkBlurMask::BoxBlur32(t, h,          d, h, kernelSizeY,  lowOffsetY,  highOffsetY, h, w, false);
+        SkBlurMask::BoxBlur32(d, h,          t, h, kernelSizeY,  highOffsetY, lowOffsetY,  h, w, false);
+        SkBlurMask::BoxBlur32(t, h,          d, w, kernelSizeY3, highOffsetY, highOffsetY, h, w, true);
     }
     return true;
 }
@@ -8,9 +8,13 @@
 
 
 #include "SkBlurMask.h"
+#include "SkBoxBlurProcs.h"
+#include "SkColorPriv.h"
 #include "SkMath.h"
 #include "SkTemplates.h"
 #include "SkEndian.h"
+#include "SkThread.h"
+#include "SkThreadPool.h"
 
 // scale factor for the blur radius to match the behavior of the all existing blur
 // code (both on the CPU and the GPU).  This magic constant is  1/sqrt(3).
@@ -27,7 +31,8 @@
  * "transpose" parameter is true, it will transpose the pixels on write,
  * such that X and Y are swapped. Reads are always performed from contiguous
  * memory in X, for speed. The destination buffer (dst) must be at least
- * (width + leftRadius + rightRadius) * height bytes in size.
+ * (width + leftRadius + rightRadius) * height bytes in size. Only rows
+ * [startY, stopY) are blurred, so that bands of rows can run in parallel.
  *
  * This is what the inner loop looks like before unrolling, and with the two
  * cases broken out separately (width < diameter, width >= diameter):
@@ -66,9 +71,9 @@
  *          }
  *      }
  */
-static int boxBlur(const uint8_t* src, int src_y_stride, uint8_t* dst,
-                   int leftRadius, int rightRadius, int width, int height,
-                   bool transpose)
+static void boxBlur(const uint8_t* src, int src_y_stride, uint8_t* dst,
+                    int leftRadius, int rightRadius, int width, int height,
+                    bool transpose, int startY, int stopY)
 {
     int diameter = leftRadius + rightRadius;
     int kernelSize = diameter + 1;
@@ -82,7 +87,7 @@ static int boxBlur(const uint8_t* src, int src_y_stride, uint8_t* dst,
 #else
     uint32_t half = 0;
 #endif
-    for (int y = 0; y < height; ++y) {
+    for (int y = startY; y < stopY; ++y) {
         uint32_t sum = 0;
         uint8_t* dptr = dst + y * dst_y_stride;
         const uint8_t* right = src + y * src_y_stride;
@@ -216,7 +221,6 @@ static int boxBlur(const uint8_t* src, int src_y_stride, uint8_t* dst,
         }
         SkASSERT(sum == 0);
     }
-    return new_width;
 }
 
 /**
@@ -269,12 +273,12 @@ static int boxBlur(const uint8_t* src, int src_y_stride, uint8_t* dst,
  *          }
  *      }
  *  }
- *  return new_width;
  */
 
-static int boxBlurInterp(const uint8_t* src, int src_y_stride, uint8_t* dst,
-                         int radius, int width, int height,
-                         bool transpose, uint8_t outer_weight)
+static void boxBlurInterp(const uint8_t* src, int src_y_stride, uint8_t* dst,
+                          int radius, int width, int height,
+                          bool transpose, uint8_t outer_weight,
+                          int startY, int stopY)
 {
     int diameter = radius * 2;
     int kernelSize = diameter + 1;
@@ -292,7 +296,7 @@ static int boxBlurInterp(const uint8_t* src, int src_y_stride, uint8_t* dst,
     int new_width = width + diameter;
     int dst_x_stride = transpose ? height : 1;
     int dst_y_stride = transpose ? 1 : new_width;
-    for (int y = 0; y < height; ++y) {
+    for (int y = startY; y < stopY; ++y) {
         uint32_t outer_sum = 0, inner_sum = 0;
         uint8_t* dptr = dst + y * dst_y_stride;
         const uint8_t* right = src + y * src_y_stride;
@@ -401,9 +405,235 @@ static int boxBlurInterp(const uint8_t* src, int src_y_stride, uint8_t* dst,
 #undef RIGHT_BORDER_ITER
         SkASSERT(outer_sum == 0 && inner_sum == 0);
     }
+}
+
+/**
+ * The 32-bit box blur used by SkBlurImageFilter. Each channel of a pixel
+ * becomes the average of the kernelSize pixels from leftOffset to the left of
+ * it to rightOffset to the right of it, counting pixels off the row as 0. The
+ * output rows are width pixels long, and are written as columns of dst if
+ * "transpose" is true. Only rows [startY, stopY) are blurred.
+ */
+static void boxBlur32(const SkPMColor* src, int srcRowPixels, SkPMColor* dst,
+                      int dstRowPixels, int kernelSize, int leftOffset,
+                      int rightOffset, int width, int height, bool transpose,
+                      int startY, int stopY)
+{
+    int rightBorder = SkMin32(rightOffset + 1, width);
+    int dst_x_stride = transpose ? dstRowPixels : 1;
+    int dst_y_stride = transpose ? 1 : dstRowPixels;
+    uint32_t scale = (1 << 24) / kernelSize;
+#ifndef SK_DISABLE_BLUR_ROUNDING
+    uint32_t half = 1 << 23;
+#else
+    uint32_t half = 0;
+#endif
+    for (int y = startY; y < stopY; ++y) {
+        uint32_t sumA = 0, sumR = 0, sumG = 0, sumB = 0;
+        const SkPMColor* p = src + y * srcRowPixels;
+        for (int i = 0; i < rightBorder; ++i) {
+            sumA += SkGetPackedA32(*p);
+            sumR += SkGetPackedR32(*p);
+            sumG += SkGetPackedG32(*p);
+            sumB += SkGetPackedB32(*p);
+            p++;
+        }
+
+        const SkPMColor* sptr = src + y * srcRowPixels;
+        SkPMColor* dptr = dst + y * dst_y_stride;
+        for (int x = 0; x < width; ++x) {
+            *dptr = SkPackARGB32((sumA * scale + half) >> 24,
+                                 (sumR * scale + half) >> 24,
+                                 (sumG * scale + half) >> 24,
+                                 (sumB * scale + half) >> 24);
+            if (x >= leftOffset) {
+                SkPMColor l = *(sptr - leftOffset);
+                sumA -= SkGetPackedA32(l);
+                sumR -= SkGetPackedR32(l);
+                sumG -= SkGetPackedG32(l);
+                sumB -= SkGetPackedB32(l);
+            }
+            if (x + rightOffset + 1 < width) {
+                SkPMColor r = *(sptr + rightOffset + 1);
+                sumA += SkGetPackedA32(r);
+                sumR += SkGetPackedR32(r);
+                sumG += SkGetPackedG32(r);
+                sumB += SkGetPackedB32(r);
+            }
+            sptr++;
+            dptr += dst_x_stride;
+        }
+    }
+}
+
+static SkBoxBlurProcs box_blur_procs_factory() {
+    SkBoxBlurProcs procs;
+    if (!SkBoxBlurGetPlatformProcs(&procs)) {
+        procs.fA8 = boxBlur;
+        procs.fInterpA8 = boxBlurInterp;
+        procs.f32 = boxBlur32;
+    }
+    return procs;
+}
+
+static const SkBoxBlurProcs& box_blur_procs() {
+    static const SkBoxBlurProcs gProcs = box_blur_procs_factory();
+    return gProcs;
+}
+
+SK_DECLARE_STATIC_MUTEX(gBlurThreadPoolMutex);
+static SkThreadPool* gBlurThreadPool;   // guarded by gBlurThreadPoolMutex
+
+static SkThreadPool* get_blur_thread_pool() {
+    SkAutoMutexAcquire ac(gBlurThreadPoolMutex);
+    return gBlurThreadPool;
+}
+
+SkThreadPool* SkBlurMask::SetThreadPool(SkThreadPool* pool) {
+    SkAutoMutexAcquire ac(gBlurThreadPoolMutex);
+    SkThreadPool* prev = gBlurThreadPool;
+    gBlurThreadPool = pool;
+    return prev;
+}
+
+namespace {
+
+// The arguments of one box blur pass, so that bands of its rows can be blurred
+// on other threads.
+struct BoxBlurPass {
+    enum Kind {
+        kA8_Kind,
+        kInterpA8_Kind,
+        k32_Kind,
+    };
+
+    Kind        fKind;
+    const void* fSrc;
+    int         fSrcStride;     // in bytes for A8, in pixels for 32-bit
+    void*       fDst;
+    int         fDstRowPixels;  // 32-bit only
+    int         fKernelSize;    // 32-bit only
+    int         fLeft;          // radius, or offset for 32-bit
+    int         fRight;         // radius, or offset for 32-bit; unused by interp
+    uint8_t     fOuterWeight;   // interp only
+    int         fWidth;
+    int         fHeight;
+    bool        fTranspose;
+    int         fBandHeight;
+
+    void blurRows(int startY, int stopY) const {
+        const SkBoxBlurProcs& procs = box_blur_procs();
+        switch (fKind) {
+            case kA8_Kind:
+                procs.fA8((const uint8_t*)fSrc, fSrcStride, (uint8_t*)fDst,
+                          fLeft, fRight, fWidth, fHeight, fTranspose, startY, stopY);
+                break;
+            case kInterpA8_Kind:
+                procs.fInterpA8((const uint8_t*)fSrc, fSrcStride, (uint8_t*)fDst,
+                                fLeft, fWidth, fHeight, fTranspose, fOuterWeight,
+                                startY, stopY);
+                break;
+            case k32_Kind:
+                procs.f32((const SkPMColor*)fSrc, fSrcStride, (SkPMColor*)fDst,
+                          fDstRowPixels, fKernelSize, fLeft, fRight, fWidth, fHeight,
+                          fTranspose, startY, stopY);
+                break;
+        }
+    }
+
+    static void BlurBand(void* context, int index) {
+        const BoxBlurPass* pass = static_cast<const BoxBlurPass*>(context);
+        int startY = index * pass->fBandHeight;
+        pass->blurRows(startY, SkMin32(startY + pass->fBandHeight, pass->fHeight));
+    }
+};
+
+}  // namespace
+
+// Passes writing fewer pixels than this are not worth splitting into bands.
+static const int kMinPixelsToThread = 256 * 256;
+// Bands are a whole number of the 16-row tiles that the SIMD procs blur at once.
+static const int kBandAlign = 16;
+
+static void run_box_blur_pass(BoxBlurPass* pass, int dstWidth) {
+    SkThreadPool* pool = get_blur_thread_pool();
+    if (NULL == pool || 0 == pool->count() ||
+        dstWidth * pass->fHeight < kMinPixelsToThread) {
+        pass->blurRows(0, pass->fHeight);
+        return;
+    }
+
+    // A few bands per thread, so that threads finishing early can steal more.
+    int bandCount = pool->count() * 4;
+    int bandHeight = (pass->fHeight + bandCount - 1) / bandCount;
+    bandHeight = (bandHeight + kBandAlign - 1) & ~(kBandAlign - 1);
+    pass->fBandHeight = bandHeight;
+    pool->parallelFor((pass->fHeight + bandHeight - 1) / bandHeight,
+                      BoxBlurPass::BlurBand, pass);
+}
+
+// Runs boxBlur() on every row, and returns the width of the blurred rows.
+static int boxBlurPass(const uint8_t* src, int src_y_stride, uint8_t* dst,
+                       int leftRadius, int rightRadius, int width, int height,
+                       bool transpose)
+{
+    BoxBlurPass pass;
+    pass.fKind = BoxBlurPass::kA8_Kind;
+    pass.fSrc = src;
+    pass.fSrcStride = src_y_stride;
+    pass.fDst = dst;
+    pass.fLeft = leftRadius;
+    pass.fRight = rightRadius;
+    pass.fWidth = width;
+    pass.fHeight = height;
+    pass.fTranspose = transpose;
+
+    int new_width = width + SkMax32(leftRadius, rightRadius) * 2;
+    run_box_blur_pass(&pass, new_width);
+    return new_width;
+}
+
+// Runs boxBlurInterp() on every row, and returns the width of the blurred rows.
+static int boxBlurInterpPass(const uint8_t* src, int src_y_stride, uint8_t* dst,
+                             int radius, int width, int height,
+                             bool transpose, uint8_t outer_weight)
+{
+    BoxBlurPass pass;
+    pass.fKind = BoxBlurPass::kInterpA8_Kind;
+    pass.fSrc = src;
+    pass.fSrcStride = src_y_stride;
+    pass.fDst = dst;
+    pass.fLeft = radius;
+    pass.fOuterWeight = outer_weight;
+    pass.fWidth = width;
+    pass.fHeight = height;
+    pass.fTranspose = transpose;
+
+    int new_width = width + radius * 2;
+    run_box_blur_pass(&pass, new_width);
     return new_width;
 }
 
+void SkBlurMask::BoxBlur32(const SkPMColor* src, int srcRowPixels, SkPMColor* dst,
+                           int dstRowPixels, int kernelSize, int leftOffset,
+                           int rightOffset, int width, int height, bool transpose)
+{
+    BoxBlurPass pass;
+    pass.fKind = BoxBlurPass::k32_Kind;
+    pass.fSrc = src;
+    pass.fSrcStride = srcRowPixels;
+    pass.fDst = dst;
+    pass.fDstRowPixels = dstRowPixels;
+    pass.fKernelSize = kernelSize;
+    pass.fLeft = leftOffset;
+    pass.fRight = rightOffset;
+    pass.fWidth = width;
+    pass.fHeight = height;
+    pass.fTranspose = transpose;
+
+    run_box_blur_pass(&pass, width);
+}
+
 static void get_adjusted_radii(SkScalar passRadius, int *loRadius, int *hiRadius)
 {
     *loRadius = *hiRadius = SkScalarCeil(passRadius);
@@ -888,8 +1118,6 @@ static void apply_kernel_interp(uint8_t dst[], int rx, int ry,
     }
 }
 
-#include "SkColorPriv.h"
-
 static void merge_src_with_blur(uint8_t dst[], int dstRB,
                                 const uint8_t src[], int srcRB,
                                 const uint8_t blur[], int blurRB,
@@ -1021,30 +1249,30 @@ bool SkBlurMask::Blur(SkMask* dst, const SkMask& src,
                 get_adjusted_radii(passRadius, &loRadius, &hiRadius);
                 if (kHigh_Quality == quality) {
                     // Do three X blurs, with a transpose on the final one.
-                    w = boxBlur(sp, src.fRowBytes, tp, loRadius, hiRadius, w, h, false);
-                    w = boxBlur(tp, w,             dp, hiRadius, loRadius, w, h, false);
-                    w = boxBlur(dp, w,             tp, hiRadius, hiRadius, w, h, true);
+                    w = boxBlurPass(sp, src.fRowBytes, tp, loRadius, hiRadius, w, h, false);
+                    w = boxBlurPass(tp, w,             dp, hiRadius, loRadius, w, h, false);
+                    w = boxBlurPass(dp, w,             tp, hiRadius, hiRadius, w, h, true);
                     // Do three Y blurs, with a transpose on the final one.
-                    h = boxBlur(tp, h,             dp, loRadius, hiRadius, h, w, false);
-                    h = boxBlur(dp, h,             tp, hiRadius, loRadius, h, w, false);
-                    h = boxBlur(tp, h,             dp, hiRadius, hiRadius, h, w, true);
+                    h = boxBlurPass(tp, h,             dp, loRadius, hiRadius, h, w, false);
+                    h = boxBlurPass(dp, h,             tp, hiRadius, loRadius, h, w, false);
+                    h = boxBlurPass(tp, h,             dp, hiRadius, hiRadius, h, w, true);
                 } else {
-                    w = boxBlur(sp, src.fRowBytes, tp, rx, rx, w, h, true);
-                    h = boxBlur(tp, h,             dp, ry, ry, h, w, true);
+                    w = boxBlurPass(sp, src.fRowBytes, tp, rx, rx, w, h, true);
+                    h = boxBlurPass(tp, h,             dp, ry, ry, h, w, true);
                 }
             } else {
                 if (kHigh_Quality == quality) {
                     // Do three X blurs, with a transpose on the final one.
-                    w = boxBlurInterp(sp, src.fRowBytes, tp, rx, w, h, false, outerWeight);
-                    w = boxBlurInterp(tp, w,             dp, rx, w, h, false, outerWeight);
-                    w = boxBlurInterp(dp, w,             tp, rx, w, h, true, outerWeight);
+                    w = boxBlurInterpPass(sp, src.fRowBytes, tp, rx, w, h, false, outerWeight);
+                    w = boxBlurInterpPass(tp, w,             dp, rx, w, h, false, outerWeight);
+                    w = boxBlurInterpPass(dp, w,             tp, rx, w, h, true, outerWeight);
                     // Do three Y blurs, with a transpose on the final one.
-                    h = boxBlurInterp(tp, h,             dp, ry, h, w, false, outerWeight);
-                    h = boxBlurInterp(dp, h,             tp, ry, h, w, false, outerWeight);
-                    h = boxBlurInterp(tp, h,             dp, ry, h, w, true, outerWeight);
+                    h = boxBlurInterpPass(tp, h,             dp, ry, h, w, false, outerWeight);
+                    h = boxBlurInterpPass(dp, h,             tp, ry, h, w, false, outerWeight);
+                    h = boxBlurInterpPass(tp, h,             dp, ry, h, w, true, outerWeight);
                 } else {
-                    w = boxBlurInterp(sp, src.fRowBytes, tp, rx, w, h, true, outerWeight);
-                    h = boxBlurInterp(tp, h,             dp, ry, h, w, true, outerWeight);
+                    w = boxBlurInterpPass(sp, src.fRowBytes, tp, rx, w, h, true, outerWeight);
+                    h = boxBlurInterpPass(tp, h,             dp, ry, h, w, true, outerWeight);
                 }
             }
         } else {
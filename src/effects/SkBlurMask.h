@@ -13,6 +13,8 @@
 #include "SkShader.h"
 #include "SkMask.h"
 
+class SkThreadPool;
+
 class SkBlurMask {
 public:
     enum Style {
@@ -40,6 +42,22 @@ public:
                               SkScalar radius, Style style, Quality quality,
                               SkIPoint* margin = NULL);
 
+    /**
+     *  One pass of the separable 32-bit blur used by SkBlurImageFilter. Blurs
+     *  each row of src (which is width x height) along X, and writes it as a
+     *  row of dst, or as a column of dst if transpose is true. See
+     *  SkBoxBlur32Proc for the kernel.
+     */
+    static void BoxBlur32(const SkPMColor* src, int srcRowPixels, SkPMColor* dst,
+                          int dstRowPixels, int kernelSize, int leftOffset,
+                          int rightOffset, int width, int height, bool transpose);
+
+    /**
+     *  Backs SkBlurMaskFilter::SetThreadPool(), which is the public entry
+     *  point. Returns the previous pool.
+     */
+    static SkThreadPool* SetThreadPool(SkThreadPool* pool);
+
 
     // the "ground truth" blur does a gaussian convolution; it's slow
     // but useful for comparison purposes.
@@ -62,6 +62,10 @@ SkMaskFilter* SkBlurMaskFilter::Create(SkScalar radius,
     return SkNEW_ARGS(SkBlurMaskFilterImpl, (radius, style, flags));
 }
 
+SkThreadPool* SkBlurMaskFilter::SetThreadPool(SkThreadPool* pool) {
+    return SkBlurMask::SetThreadPool(pool);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 SkBlurMaskFilterImpl::SkBlurMaskFilterImpl(SkScalar radius,
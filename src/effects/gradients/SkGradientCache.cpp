@@ -0,0 +1,119 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkGradientCache.h"
+#include "SkChecksum.h"
+#include "SkMallocPixelRef.h"
+#include "SkTemplates.h"
+#include "SkThread.h"
+#include "SkTLRUCache.h"
+
+#ifndef SK_DEFAULT_GRADIENT_CACHE_LIMIT
+    #define SK_DEFAULT_GRADIENT_CACHE_LIMIT     (1024 * 1024)
+#endif
+
+namespace {
+
+struct Key {
+    Key(const int32_t data[], int count) : fData(data), fCount(count) {}
+
+    bool operator==(const Key& other) const {
+        return fCount == other.fCount &&
+               !memcmp(fData, other.fData, fCount * sizeof(int32_t));
+    }
+
+    const int32_t*  fData;
+    int             fCount;
+};
+
+class Rec {
+public:
+    Rec(const Key& key, uint32_t hash, SkMallocPixelRef* table)
+        : fKeyData(key.fCount), fKeyCount(key.fCount), fHash(hash), fTable(table)
+        , fBucketNext(NULL) {
+        memcpy(fKeyData.get(), key.fData, key.fCount * sizeof(int32_t));
+        table->ref();
+    }
+
+    ~Rec() {
+        fTable->unref();
+    }
+
+    Key getKey() const { return Key(fKeyData.get(), fKeyCount); }
+    uint32_t getHash() const { return fHash; }
+    size_t bytesUsed() const { return fTable->getSize(); }
+    SkMallocPixelRef* table() const { return fTable; }
+
+private:
+    SkAutoTMalloc<int32_t>  fKeyData;
+    int                     fKeyCount;
+    uint32_t                fHash;
+    SkMallocPixelRef*       fTable;
+
+    SK_DECLARE_LRU_CACHE_INTERFACE(Rec);
+};
+
+typedef SkTLRUCache<Rec, Key> Cache;
+
+}  // namespace
+
+SK_DECLARE_STATIC_MUTEX(gMutex);
+
+static Cache& get_cache() {
+    // gMutex must be held.
+    static Cache* gCache;
+    if (NULL == gCache) {
+        gCache = SkNEW_ARGS(Cache, (SK_DEFAULT_GRADIENT_CACHE_LIMIT));
+    }
+    return *gCache;
+}
+
+static uint32_t compute_hash(const int32_t key[], int count) {
+    return SkChecksum::Compute(reinterpret_cast<const uint32_t*>(key), count * sizeof(int32_t));
+}
+
+SkMallocPixelRef* SkGradientCache::Find(const int32_t key[], int count) {
+    uint32_t hash = compute_hash(key, count);
+    SkAutoMutexAcquire ama(gMutex);
+    Rec* rec = get_cache().find(Key(key, count), hash);
+    if (NULL == rec) {
+        return NULL;
+    }
+    rec->table()->ref();
+    return rec->table();
+}
+
+void SkGradientCache::Add(const int32_t key[], int count, SkMallocPixelRef* table) {
+    // Other threads will read the table and its generation ID without
+    // locking, so settle both before it is shared.
+    table->setImmutable();
+    (void)table->getGenerationID();
+
+    uint32_t hash = compute_hash(key, count);
+    SkAutoMutexAcquire ama(gMutex);
+    get_cache().add(SkNEW_ARGS(Rec, (Key(key, count), hash, table)));
+}
+
+size_t SkGradientCache::GetBytesUsed() {
+    SkAutoMutexAcquire ama(gMutex);
+    return get_cache().bytesUsed();
+}
+
+size_t SkGradientCache::GetByteLimit() {
+    SkAutoMutexAcquire ama(gMutex);
+    return get_cache().byteLimit();
+}
+
+size_t SkGradientCache::SetByteLimit(size_t newLimit) {
+    SkAutoMutexAcquire ama(gMutex);
+    return get_cache().setByteLimit(newLimit);
+}
+
+void SkGradientCache::PurgeAll() {
+    SkAutoMutexAcquire ama(gMutex);
+    get_cache().purgeAll();
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkGradientCache_DEFINED
+#define SkGradientCache_DEFINED
+
+#include "SkTypes.h"
+
+class SkMallocPixelRef;
+
+/**
+ *  Process-wide cache of the color tables gradient shaders build, so that
+ *  shaders created with the same colors and positions share one table rather
+ *  than each building their own. A key is an array of 32-bit words chosen by
+ *  the shader, spelling out everything the table depends on. Entries are
+ *  purged least recently used first to keep the cache within its byte limit.
+ *  All methods are thread-safe.
+ *
+ *  Tables are immutable once added, and the pixel refs handed out are ref()ed,
+ *  so they stay valid if the cache purges them while they are in use.
+ */
+class SkGradientCache {
+public:
+    /**
+     *  Returns the table for key, ref()ed, or NULL if it is not in the cache.
+     */
+    static SkMallocPixelRef* Find(const int32_t key[], int count);
+
+    /**
+     *  Adds table as the table for key, replacing any earlier one, and marks
+     *  it immutable.
+     */
+    static void Add(const int32_t key[], int count, SkMallocPixelRef* table);
+
+    /** Returns the number of bytes of tables the cache is holding. */
+    static size_t GetBytesUsed();
+
+    /** Returns the most bytes of tables the cache will hold. */
+    static size_t GetByteLimit();
+
+    /**
+     *  Sets the most bytes of tables the cache will hold, purging entries if
+     *  needed, and returns the previous limit.
+     */
+    static size_t SetByteLimit(size_t newLimit);
+
+    /** Purges every entry. */
+    static void PurgeAll();
+};
+
+#endif
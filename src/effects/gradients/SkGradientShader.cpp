@@ -6,6 +6,7 @@
  */
 
 #include "SkGradientShaderPriv.h"
+#include "SkGradientCache.h"
 #include "SkLinearGradient.h"
 #include "SkRadialGradient.h"
 #include "SkTwoPointRadialGradient.h"
@@ -13,10 +14,12 @@
 #include "SkSweepGradient.h"
 
 SkGradientShaderBase::SkGradientShaderBase(const SkColor colors[], const SkScalar pos[],
-             int colorCount, SkShader::TileMode mode, SkUnitMapper* mapper) {
+             int colorCount, SkShader::TileMode mode, SkUnitMapper* mapper,
+             uint32_t gradFlags) {
     SkASSERT(colorCount > 1);
 
     fCacheAlpha = 256;  // init to a value that paint.getAlpha() can't return
+    fGradFlags = gradFlags;
 
     fMapper = mapper;
     SkSafeRef(mapper);
@@ -26,8 +29,9 @@ SkGradientShaderBase::SkGradientShaderBase(const SkColor colors[], const SkScala
     fTileMode = mode;
     fTileProc = gTileProcs[mode];
 
-    fCache16 = fCache16Storage = NULL;
+    fCache16 = NULL;
     fCache32 = NULL;
+    fCache16PixelRef = NULL;
     fCache32PixelRef = NULL;
 
     /*  Note: we let the caller skip the first and/or last position.
@@ -135,8 +139,9 @@ SkGradientShaderBase::SkGradientShaderBase(SkFlattenableReadBuffer& buffer) :
 
     fMapper = buffer.readFlattenableT<SkUnitMapper>();
 
-    fCache16 = fCache16Storage = NULL;
+    fCache16 = NULL;
     fCache32 = NULL;
+    fCache16PixelRef = NULL;
     fCache32PixelRef = NULL;
 
     int colorCount = fColorCount = buffer.getArrayCount();
@@ -148,7 +153,10 @@ SkGradientShaderBase::SkGradientShaderBase(SkFlattenableReadBuffer& buffer) :
     }
     buffer.readColorArray(fOrigColors);
 
-    fTileMode = (TileMode)buffer.readUInt();
+    // The flags share a word with the tile mode; see flatten().
+    uint32_t packed = buffer.readUInt();
+    fTileMode = (TileMode)(packed & 0xF);
+    fGradFlags = packed >> 4;
     fTileProc = gTileProcs[fTileMode];
     fRecs = (Rec*)(fOrigColors + colorCount);
     if (colorCount > 2) {
@@ -164,9 +172,7 @@ SkGradientShaderBase::SkGradientShaderBase(SkFlattenableReadBuffer& buffer) :
 }
 
 SkGradientShaderBase::~SkGradientShaderBase() {
-    if (fCache16Storage) {
-        sk_free(fCache16Storage);
-    }
+    SkSafeUnref(fCache16PixelRef);
     SkSafeUnref(fCache32PixelRef);
     if (fOrigColors != fStorage) {
         sk_free(fOrigColors);
@@ -187,7 +193,8 @@ void SkGradientShaderBase::flatten(SkFlattenableWriteBuffer& buffer) const {
     this->INHERITED::flatten(buffer);
     buffer.writeFlattenable(fMapper);
     buffer.writeColorArray(fOrigColors, fColorCount);
-    buffer.writeUInt(fTileMode);
+    // Pictures written before the flags existed read back as no flags.
+    buffer.writeUInt((fGradFlags << 4) | fTileMode);
     if (fColorCount > 2) {
         Rec* recs = fRecs;
         for (int i = 1; i < fColorCount; i++) {
@@ -239,17 +246,35 @@ bool SkGradientShaderBase::setContext(const SkBitmap& device,
 
 void SkGradientShaderBase::setCacheAlpha(U8CPU alpha) const {
     // if the new alpha differs from the previous time we were called, inval our cache
-    // this will trigger the cache to be rebuilt.
-    // we don't care about the first time, since the cache ptrs will already be NULL
+    // this will trigger the cache to be rebuilt (or found in SkGradientCache).
+    // we don't care about the first time, since the cache ptrs will already be NULL.
+    // The 16bit cache ignores alpha, so it stays.
     if (fCacheAlpha != alpha) {
-        fCache16 = NULL;            // inval the cache
         fCache32 = NULL;            // inval the cache
         fCacheAlpha = alpha;        // record the new alpha
-        // inform our subclasses
-        if (fCache32PixelRef) {
-            fCache32PixelRef->notifyPixelsChanged();
-        }
+        // the pixelref may be shared, so rather than changing its pixels we
+        // let go of it, and whoever still holds it keeps the old ones
+        SkSafeUnref(fCache32PixelRef);
+        fCache32PixelRef = NULL;
+    }
+}
+
+// The span procs hard code the layout of the 32-bit cache.
+SK_COMPILE_ASSERT(256 == SkGradientShaderBase::kCache32Count &&
+                  256 == SkGradientShaderBase::kDitherStride32, gradient_procs_expect_256_entries);
+
+static const SkGradientProcs* platform_procs_factory() {
+    static SkGradientProcs gProcs;
+    sk_bzero(&gProcs, sizeof(gProcs));
+    if (!SkGradientGetPlatformProcs(&gProcs)) {
+        sk_bzero(&gProcs, sizeof(gProcs));
     }
+    return &gProcs;
+}
+
+const SkGradientProcs& SkGradientShaderBase::PlatformProcs() {
+    static const SkGradientProcs* gProcs = platform_procs_factory();
+    return *gProcs;
 }
 
 #define Fixed_To_Dot8(x)        (((x) + 0x80) >> 8)
@@ -391,6 +416,54 @@ void SkGradientShaderBase::Build32bitCache(SkPMColor cache[], SkColor c0, SkColo
     }
 }
 
+// c0 + (c1 - c0) * frac / 65536, in 8.8, plus a dither bias below 1, rounded
+// down to 8 bits.
+static inline unsigned lerp_dither_channel(int c0, int c1, int frac, int bias) {
+    return ((c0 << 8) + ((c1 - c0) * frac >> 8) + bias) >> 8;
+}
+
+void SkGradientShaderBase::interpolateSpan(const uint16_t t[], SkPMColor dstC[], int count,
+                                           int toggle) const {
+    // The biases of the four dither rows of the 32-bit cache, in 8.8; see
+    // Build32bitCache().
+    static const int gDitherBias[] = { 0x20, 0xA0, 0xE0, 0x60 };
+    const unsigned paintAlpha = fCacheAlpha;
+
+    for (int i = 0; i < count; ++i) {
+        unsigned fi = t[i];
+        if (fMapper) {
+            fi = fMapper->mapUnit16(fi);
+        }
+
+        // Find the segment around fi, and how far along it fi is, 0...0xFFFF.
+        int index = 1;
+        int frac = fi;
+        if (fColorCount > 2) {
+            // The last position is SK_Fixed1, past any fi.
+            while (fRecs[index].fPos <= (SkFixed)fi) {
+                index += 1;
+            }
+            frac = ((fi - fRecs[index - 1].fPos) * fRecs[index].fScale) >> 8;
+        }
+        SkColor c0 = fOrigColors[index - 1];
+        SkColor c1 = fOrigColors[index];
+
+        int bias = gDitherBias[toggle / kDitherStride32];
+        unsigned a = lerp_dither_channel(SkMulDiv255Round(SkColorGetA(c0), paintAlpha),
+                                         SkMulDiv255Round(SkColorGetA(c1), paintAlpha),
+                                         frac, bias);
+        unsigned r = lerp_dither_channel(SkColorGetR(c0), SkColorGetR(c1), frac, bias);
+        unsigned g = lerp_dither_channel(SkColorGetG(c0), SkColorGetG(c1), frac, bias);
+        unsigned b = lerp_dither_channel(SkColorGetB(c0), SkColorGetB(c1), frac, bias);
+        if (0xFF == a) {
+            dstC[i] = SkPackARGB32(0xFF, r, g, b);
+        } else {
+            dstC[i] = SkPremultiplyARGBInline(a, r, g, b);
+        }
+        toggle = next_dither_toggle(toggle);
+    }
+}
+
 static inline int SkFixedToFFFF(SkFixed x) {
     SkASSERT((unsigned)x <= SK_Fixed1);
     return x - (x >> 16);
@@ -408,130 +481,108 @@ static inline U16CPU bitsTo16(unsigned x, const unsigned bits) {
     return 0;
 }
 
-const uint16_t* SkGradientShaderBase::getCache16() const {
-    if (fCache16 == NULL) {
-        // double the count for dither entries
-        const int entryCount = kCache16Count * 2;
-        const size_t allocSize = sizeof(uint16_t) * entryCount;
+SkMallocPixelRef* SkGradientShaderBase::make16bitCache() const {
+    // double the count for dither entries
+    const int entryCount = kCache16Count * 2;
+    const size_t allocSize = sizeof(uint16_t) * entryCount;
 
-        if (fCache16Storage == NULL) { // set the storage and our working ptr
-            fCache16Storage = (uint16_t*)sk_malloc_throw(allocSize);
-        }
-        fCache16 = fCache16Storage;
-        if (fColorCount == 2) {
-            Build16bitCache(fCache16, fOrigColors[0], fOrigColors[1],
-                            kCache16Count);
-        } else {
-            Rec* rec = fRecs;
-            int prevIndex = 0;
-            for (int i = 1; i < fColorCount; i++) {
-                int nextIndex = SkFixedToFFFF(rec[i].fPos) >> kCache16Shift;
-                SkASSERT(nextIndex < kCache16Count);
-
-                if (nextIndex > prevIndex)
-                    Build16bitCache(fCache16 + prevIndex, fOrigColors[i-1], fOrigColors[i], nextIndex - prevIndex + 1);
-                prevIndex = nextIndex;
-            }
+    SkMallocPixelRef* pr = SkNEW_ARGS(SkMallocPixelRef, (NULL, allocSize, NULL));
+    uint16_t* cache = (uint16_t*)pr->getAddr();
+    if (fColorCount == 2) {
+        Build16bitCache(cache, fOrigColors[0], fOrigColors[1],
+                        kCache16Count);
+    } else {
+        Rec* rec = fRecs;
+        int prevIndex = 0;
+        for (int i = 1; i < fColorCount; i++) {
+            int nextIndex = SkFixedToFFFF(rec[i].fPos) >> kCache16Shift;
+            SkASSERT(nextIndex < kCache16Count);
+
+            if (nextIndex > prevIndex)
+                Build16bitCache(cache + prevIndex, fOrigColors[i-1], fOrigColors[i], nextIndex - prevIndex + 1);
+            prevIndex = nextIndex;
         }
+    }
 
-        if (fMapper) {
-            fCache16Storage = (uint16_t*)sk_malloc_throw(allocSize);
-            uint16_t* linear = fCache16;         // just computed linear data
-            uint16_t* mapped = fCache16Storage;  // storage for mapped data
-            SkUnitMapper* map = fMapper;
-            for (int i = 0; i < kCache16Count; i++) {
-                int index = map->mapUnit16(bitsTo16(i, kCache16Bits)) >> kCache16Shift;
-                mapped[i] = linear[index];
-                mapped[i + kCache16Count] = linear[index + kCache16Count];
-            }
-            sk_free(fCache16);
-            fCache16 = fCache16Storage;
+    if (fMapper) {
+        SkMallocPixelRef* newPR = SkNEW_ARGS(SkMallocPixelRef,
+                                             (NULL, allocSize, NULL));
+        uint16_t* linear = cache;                          // just computed linear data
+        uint16_t* mapped = (uint16_t*)newPR->getAddr();    // storage for mapped data
+        SkUnitMapper* map = fMapper;
+        for (int i = 0; i < kCache16Count; i++) {
+            int index = map->mapUnit16(bitsTo16(i, kCache16Bits)) >> kCache16Shift;
+            mapped[i] = linear[index];
+            mapped[i + kCache16Count] = linear[index + kCache16Count];
         }
+        pr->unref();
+        pr = newPR;
     }
-    return fCache16;
+    return pr;
 }
 
-const SkPMColor* SkGradientShaderBase::getCache32() const {
-    if (fCache32 == NULL) {
-        // double the count for dither entries
-        const int entryCount = kCache32Count * 4;
-        const size_t allocSize = sizeof(SkPMColor) * entryCount;
+SkMallocPixelRef* SkGradientShaderBase::make32bitCache() const {
+    // double the count for dither entries
+    const int entryCount = kCache32Count * 4;
+    const size_t allocSize = sizeof(SkPMColor) * entryCount;
 
-        if (NULL == fCache32PixelRef) {
-            fCache32PixelRef = SkNEW_ARGS(SkMallocPixelRef,
-                                          (NULL, allocSize, NULL));
-        }
-        fCache32 = (SkPMColor*)fCache32PixelRef->getAddr();
-        if (fColorCount == 2) {
-            Build32bitCache(fCache32, fOrigColors[0], fOrigColors[1],
-                            kCache32Count, fCacheAlpha);
-        } else {
-            Rec* rec = fRecs;
-            int prevIndex = 0;
-            for (int i = 1; i < fColorCount; i++) {
-                int nextIndex = SkFixedToFFFF(rec[i].fPos) >> kCache32Shift;
-                SkASSERT(nextIndex < kCache32Count);
-
-                if (nextIndex > prevIndex)
-                    Build32bitCache(fCache32 + prevIndex, fOrigColors[i-1],
-                                    fOrigColors[i],
-                                    nextIndex - prevIndex + 1, fCacheAlpha);
-                prevIndex = nextIndex;
-            }
+    SkMallocPixelRef* pr = SkNEW_ARGS(SkMallocPixelRef, (NULL, allocSize, NULL));
+    SkPMColor* cache = (SkPMColor*)pr->getAddr();
+    if (fColorCount == 2) {
+        Build32bitCache(cache, fOrigColors[0], fOrigColors[1],
+                        kCache32Count, fCacheAlpha);
+    } else {
+        Rec* rec = fRecs;
+        int prevIndex = 0;
+        for (int i = 1; i < fColorCount; i++) {
+            int nextIndex = SkFixedToFFFF(rec[i].fPos) >> kCache32Shift;
+            SkASSERT(nextIndex < kCache32Count);
+
+            if (nextIndex > prevIndex)
+                Build32bitCache(cache + prevIndex, fOrigColors[i-1],
+                                fOrigColors[i],
+                                nextIndex - prevIndex + 1, fCacheAlpha);
+            prevIndex = nextIndex;
         }
+    }
 
-        if (fMapper) {
-            SkMallocPixelRef* newPR = SkNEW_ARGS(SkMallocPixelRef,
-                                                 (NULL, allocSize, NULL));
-            SkPMColor* linear = fCache32;           // just computed linear data
-            SkPMColor* mapped = (SkPMColor*)newPR->getAddr();    // storage for mapped data
-            SkUnitMapper* map = fMapper;
-            for (int i = 0; i < kCache32Count; i++) {
-                int index = map->mapUnit16((i << 8) | i) >> 8;
-                mapped[i + kCache32Count*0] = linear[index + kCache32Count*0];
-                mapped[i + kCache32Count*1] = linear[index + kCache32Count*1];
-                mapped[i + kCache32Count*2] = linear[index + kCache32Count*2];
-                mapped[i + kCache32Count*3] = linear[index + kCache32Count*3];
-            }
-            fCache32PixelRef->unref();
-            fCache32PixelRef = newPR;
-            fCache32 = (SkPMColor*)newPR->getAddr();
+    if (fMapper) {
+        SkMallocPixelRef* newPR = SkNEW_ARGS(SkMallocPixelRef,
+                                             (NULL, allocSize, NULL));
+        SkPMColor* linear = cache;                          // just computed linear data
+        SkPMColor* mapped = (SkPMColor*)newPR->getAddr();    // storage for mapped data
+        SkUnitMapper* map = fMapper;
+        for (int i = 0; i < kCache32Count; i++) {
+            int index = map->mapUnit16((i << 8) | i) >> 8;
+            mapped[i + kCache32Count*0] = linear[index + kCache32Count*0];
+            mapped[i + kCache32Count*1] = linear[index + kCache32Count*1];
+            mapped[i + kCache32Count*2] = linear[index + kCache32Count*2];
+            mapped[i + kCache32Count*3] = linear[index + kCache32Count*3];
         }
+        pr->unref();
+        pr = newPR;
     }
-    return fCache32;
+    return pr;
 }
 
-/*
- *  Because our caller might rebuild the same (logically the same) gradient
- *  over and over, we'd like to return exactly the same "bitmap" if possible,
- *  allowing the client to utilize a cache of our bitmap (e.g. with a GPU).
- *  To do that, we maintain a private cache of built-bitmaps, based on our
- *  colors and positions. Note: we don't try to flatten the fMapper, so if one
- *  is present, we skip the cache for now.
- */
-void SkGradientShaderBase::getGradientTableBitmap(SkBitmap* bitmap) const {
-    // our caller assumes no external alpha, so we ensure that our cache is
-    // built with 0xFF
-    this->setCacheAlpha(0xFF);
-
+int SkGradientShaderBase::makeCacheKey(SkAutoSTMalloc<16, int32_t>* key, int bits,
+                                       U8CPU alpha) const {
     // don't have a way to put the mapper into our cache-key yet
     if (fMapper) {
-        // force our cahce32pixelref to be built
-        (void)this->getCache32();
-        bitmap->setConfig(SkBitmap::kARGB_8888_Config, kCache32Count, 1);
-        bitmap->setPixelRef(fCache32PixelRef);
-        return;
+        return 0;
     }
 
-    // build our key: [numColors + colors[] + {positions[]} ]
-    int count = 1 + fColorCount;
+    // build our key: [bits + alpha + numColors + colors[] + {positions[]} ]
+    int count = 3 + fColorCount;
     if (fColorCount > 2) {
         count += fColorCount - 1;    // fRecs[].fPos
     }
 
-    SkAutoSTMalloc<16, int32_t> storage(count);
-    int32_t* buffer = storage.get();
+    key->reset(count);
+    int32_t* buffer = key->get();
 
+    *buffer++ = bits;
+    *buffer++ = alpha;
     *buffer++ = fColorCount;
     memcpy(buffer, fOrigColors, fColorCount * sizeof(SkColor));
     buffer += fColorCount;
@@ -540,29 +591,67 @@ void SkGradientShaderBase::getGradientTableBitmap(SkBitmap* bitmap) const {
             *buffer++ = fRecs[i].fPos;
         }
     }
-    SkASSERT(buffer - storage.get() == count);
-
-    ///////////////////////////////////
+    SkASSERT(buffer - key->get() == count);
+    return count;
+}
 
-    SK_DECLARE_STATIC_MUTEX(gMutex);
-    static SkBitmapCache* gCache;
-    // each cache cost 1K of RAM, since each bitmap will be 1x256 at 32bpp
-    static const int MAX_NUM_CACHED_GRADIENT_BITMAPS = 32;
-    SkAutoMutexAcquire ama(gMutex);
+/*
+ *  Shaders with the same colors and positions (and no mapper) share their
+ *  caches through SkGradientCache, so a gradient that is recreated over and
+ *  over is only built once.
+ */
+const uint16_t* SkGradientShaderBase::getCache16() const {
+    if (fCache16 == NULL) {
+        SkAutoSTMalloc<16, int32_t> key(0);
+        int keyCount = this->makeCacheKey(&key, 16, 0xFF);
+        if (keyCount) {
+            fCache16PixelRef = SkGradientCache::Find(key, keyCount);
+        }
+        if (NULL == fCache16PixelRef) {
+            fCache16PixelRef = this->make16bitCache();
+            if (keyCount) {
+                SkGradientCache::Add(key, keyCount, fCache16PixelRef);
+            }
+        }
+        fCache16 = (uint16_t*)fCache16PixelRef->getAddr();
+    }
+    return fCache16;
+}
 
-    if (NULL == gCache) {
-        gCache = SkNEW_ARGS(SkBitmapCache, (MAX_NUM_CACHED_GRADIENT_BITMAPS));
+const SkPMColor* SkGradientShaderBase::getCache32() const {
+    if (fCache32 == NULL) {
+        SkAutoSTMalloc<16, int32_t> key(0);
+        int keyCount = this->makeCacheKey(&key, 32, fCacheAlpha);
+        if (keyCount) {
+            fCache32PixelRef = SkGradientCache::Find(key, keyCount);
+        }
+        if (NULL == fCache32PixelRef) {
+            fCache32PixelRef = this->make32bitCache();
+            if (keyCount) {
+                SkGradientCache::Add(key, keyCount, fCache32PixelRef);
+            }
+        }
+        fCache32 = (SkPMColor*)fCache32PixelRef->getAddr();
     }
-    size_t size = count * sizeof(int32_t);
+    return fCache32;
+}
 
-    if (!gCache->find(storage.get(), size, bitmap)) {
-        // force our cahce32pixelref to be built
-        (void)this->getCache32();
-        bitmap->setConfig(SkBitmap::kARGB_8888_Config, kCache32Count, 1);
-        bitmap->setPixelRef(fCache32PixelRef);
+/*
+ *  Because our caller might rebuild the same (logically the same) gradient
+ *  over and over, we'd like to return exactly the same "bitmap" if possible,
+ *  allowing the client to utilize a cache of our bitmap (e.g. with a GPU).
+ *  Our 32bit cache already comes from SkGradientCache when the colors and
+ *  positions match, so the bitmap shares its pixelref and generation ID.
+ */
+void SkGradientShaderBase::getGradientTableBitmap(SkBitmap* bitmap) const {
+    // our caller assumes no external alpha, so we ensure that our cache is
+    // built with 0xFF
+    this->setCacheAlpha(0xFF);
 
-        gCache->add(storage.get(), size, *bitmap);
-    }
+    // force our cache32pixelref to be built
+    (void)this->getCache32();
+    bitmap->setConfig(SkBitmap::kARGB_8888_Config, kCache32Count, 1);
+    bitmap->setPixelRef(fCache32PixelRef);
 }
 
 void SkGradientShaderBase::commonAsAGradient(GradientInfo* info) const {
@@ -644,28 +733,30 @@ SkShader* SkGradientShader::CreateLinear(const SkPoint pts[2],
                                          const SkColor colors[],
                                          const SkScalar pos[], int colorCount,
                                          SkShader::TileMode mode,
-                                         SkUnitMapper* mapper) {
+                                         SkUnitMapper* mapper,
+                                         uint32_t flags) {
     if (NULL == pts || NULL == colors || colorCount < 1) {
         return NULL;
     }
     EXPAND_1_COLOR(colorCount);
 
     return SkNEW_ARGS(SkLinearGradient,
-                      (pts, colors, pos, colorCount, mode, mapper));
+                      (pts, colors, pos, colorCount, mode, mapper, flags));
 }
 
 SkShader* SkGradientShader::CreateRadial(const SkPoint& center, SkScalar radius,
                                          const SkColor colors[],
                                          const SkScalar pos[], int colorCount,
                                          SkShader::TileMode mode,
-                                         SkUnitMapper* mapper) {
+                                         SkUnitMapper* mapper,
+                                         uint32_t flags) {
     if (radius <= 0 || NULL == colors || colorCount < 1) {
         return NULL;
     }
     EXPAND_1_COLOR(colorCount);
 
     return SkNEW_ARGS(SkRadialGradient,
-                      (center, radius, colors, pos, colorCount, mode, mapper));
+                      (center, radius, colors, pos, colorCount, mode, mapper, flags));
 }
 
 SkShader* SkGradientShader::CreateTwoPointRadial(const SkPoint& start,
@@ -729,6 +820,18 @@ SK_DEFINE_FLATTENABLE_REGISTRAR_GROUP_START(SkGradientShader)
     SK_DEFINE_FLATTENABLE_REGISTRAR_ENTRY(SkTwoPointConicalGradient)
 SK_DEFINE_FLATTENABLE_REGISTRAR_GROUP_END
 
+size_t SkGradientShader::GetCacheBytesUsed() {
+    return SkGradientCache::GetBytesUsed();
+}
+
+size_t SkGradientShader::GetCacheByteLimit() {
+    return SkGradientCache::GetByteLimit();
+}
+
+size_t SkGradientShader::SetCacheByteLimit(size_t newLimit) {
+    return SkGradientCache::SetByteLimit(newLimit);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 #if SK_SUPPORT_GPU
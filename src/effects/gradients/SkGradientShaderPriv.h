@@ -12,11 +12,11 @@
 #include "SkClampRange.h"
 #include "SkColorPriv.h"
 #include "SkFlattenableBuffers.h"
+#include "SkGradientProcs.h"
 #include "SkMallocPixelRef.h"
 #include "SkUnitMapper.h"
 #include "SkUtils.h"
 #include "SkTemplates.h"
-#include "SkBitmapCache.h"
 #include "SkShader.h"
 
 static inline void sk_memset32_dither(uint32_t dst[], uint32_t v0, uint32_t v1,
@@ -83,7 +83,8 @@ static const TileProc gTileProcs[] = {
 class SkGradientShaderBase : public SkShader {
 public:
     SkGradientShaderBase(const SkColor colors[], const SkScalar pos[],
-                int colorCount, SkShader::TileMode mode, SkUnitMapper* mapper);
+                int colorCount, SkShader::TileMode mode, SkUnitMapper* mapper,
+                uint32_t gradFlags = 0);
     virtual ~SkGradientShaderBase();
 
     virtual bool setContext(const SkBitmap&, const SkPaint&, const SkMatrix&) SK_OVERRIDE;
@@ -92,6 +93,12 @@ public:
 
     void getGradientTableBitmap(SkBitmap*) const;
 
+    /**
+     *  Returns the platform's SIMD span procs. Where a member is NULL the
+     *  subclasses should use their portable proc.
+     */
+    static const SkGradientProcs& PlatformProcs();
+
     enum {
         /// Seems like enough for visual accuracy. TODO: if pos[] deserves
         /// it, use a larger cache.
@@ -111,6 +118,10 @@ public:
         /// if dithering is disabled.
         kDitherStride32 = kCache32Count,
         kDitherStride16 = kCache16Count,
+
+        /// How many positions the shaders hand interpolateSpan() at a time.
+        /// Even, so that every chunk starts on the same dither toggle.
+        kInterpolateChunk = 64,
     };
 
 
@@ -138,6 +149,20 @@ protected:
     const uint16_t*     getCache16() const;
     const SkPMColor*    getCache32() const;
 
+    // True if shadeSpan() should call interpolateSpan() rather than read the
+    // 32-bit cache.
+    bool interpolatesColors() const {
+        return SkToBool(fGradFlags & SkGradientShader::kInterpolateColors_Flag);
+    }
+
+    /**
+     *  For SkGradientShader::kInterpolateColors_Flag: writes count colors to
+     *  dstC, interpolated between the stops around each t[], which are
+     *  positions after tiling, 0...0xFFFF. The colors are dithered like the
+     *  32-bit cache, starting with the row toggle.
+     */
+    void interpolateSpan(const uint16_t t[], SkPMColor dstC[], int count, int toggle) const;
+
     void commonAsAGradient(GradientInfo*) const;
 
 private:
@@ -149,17 +174,23 @@ private:
     SkColor     fStorage[(kStorageSize + 3) >> 2];
     SkColor*    fOrigColors; // original colors, before modulation by paint in setContext
     bool        fColorsAreOpaque;
+    uint32_t    fGradFlags;  // SkGradientShader::Flags
 
     mutable uint16_t*   fCache16;   // working ptr. If this is NULL, we need to recompute the cache values
     mutable SkPMColor*  fCache32;   // working ptr. If this is NULL, we need to recompute the cache values
 
-    mutable uint16_t*   fCache16Storage;    // storage for fCache16, allocated on demand
+    mutable SkMallocPixelRef* fCache16PixelRef;
     mutable SkMallocPixelRef* fCache32PixelRef;
     mutable unsigned    fCacheAlpha;        // the alpha value we used when we computed the cache. larger than 8bits so we can store uninitialized value
 
     static void Build16bitCache(uint16_t[], SkColor c0, SkColor c1, int count);
     static void Build32bitCache(SkPMColor[], SkColor c0, SkColor c1, int count,
                                 U8CPU alpha);
+    SkMallocPixelRef* make16bitCache() const;
+    SkMallocPixelRef* make32bitCache() const;
+    // Sets key to what SkGradientCache knows our cache with bits per color
+    // and alpha by, and returns its length, or 0 if our cache can't be shared.
+    int makeCacheKey(SkAutoSTMalloc<16, int32_t>* key, int bits, U8CPU alpha) const;
     void setCacheAlpha(U8CPU alpha) const;
     void initCommon();
 
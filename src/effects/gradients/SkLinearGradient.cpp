@@ -67,8 +67,9 @@ SkLinearGradient::SkLinearGradient(const SkPoint pts[2],
                                    const SkScalar pos[],
                                    int colorCount,
                                    SkShader::TileMode mode,
-                                   SkUnitMapper* mapper)
-    : SkGradientShaderBase(colors, pos, colorCount, mode, mapper)
+                                   SkUnitMapper* mapper,
+                                   uint32_t flags)
+    : SkGradientShaderBase(colors, pos, colorCount, mode, mapper, flags)
     , fStart(pts[0])
     , fEnd(pts[1]) {
     pts_to_unit_matrix(pts, &fPtsToUnit);
@@ -116,10 +117,6 @@ bool SkLinearGradient::setContext(const SkBitmap& device, const SkPaint& paint,
 
 namespace {
 
-typedef void (*LinearShadeProc)(TileProc proc, SkFixed dx, SkFixed fx,
-                                SkPMColor* dstC, const SkPMColor* cache,
-                                int toggle, int count);
-
 // Linear interpolation (lerp) is unnecessary if there are no sharp
 // discontinuities in the gradient - which must be true if there are
 // only 2 colors - but it's cheap.
@@ -146,7 +143,26 @@ void shadeSpan_linear_vertical_lerp(TileProc proc, SkFixed dx, SkFixed fx,
     sk_memset32_dither(dstC, lerp, dlerp, count);
 }
 
-void shadeSpan_linear_clamp(TileProc proc, SkFixed dx, SkFixed fx,
+// The part of a clamped span that SkClampRange found to need no pinning.
+void shadeSpan_linear_unpinned(SkFixed dx, SkFixed fx,
+                               SkPMColor* SK_RESTRICT dstC,
+                               const SkPMColor* SK_RESTRICT cache,
+                               int toggle, int count) {
+    int unroll = count >> 3;
+    for (int i = 0; i < unroll; i++) {
+        NO_CHECK_ITER;  NO_CHECK_ITER;
+        NO_CHECK_ITER;  NO_CHECK_ITER;
+        NO_CHECK_ITER;  NO_CHECK_ITER;
+        NO_CHECK_ITER;  NO_CHECK_ITER;
+    }
+    if ((count &= 7) > 0) {
+        do {
+            NO_CHECK_ITER;
+        } while (--count != 0);
+    }
+}
+
+void shadeSpan_linear_clamp(SkGradientLinearProc unpinnedProc, SkFixed dx, SkFixed fx,
                             SkPMColor* SK_RESTRICT dstC,
                             const SkPMColor* SK_RESTRICT cache,
                             int toggle, int count) {
@@ -161,18 +177,10 @@ void shadeSpan_linear_clamp(TileProc proc, SkFixed dx, SkFixed fx,
         dstC += count;
     }
     if ((count = range.fCount1) > 0) {
-        int unroll = count >> 3;
-        fx = range.fFx1;
-        for (int i = 0; i < unroll; i++) {
-            NO_CHECK_ITER;  NO_CHECK_ITER;
-            NO_CHECK_ITER;  NO_CHECK_ITER;
-            NO_CHECK_ITER;  NO_CHECK_ITER;
-            NO_CHECK_ITER;  NO_CHECK_ITER;
-        }
-        if ((count &= 7) > 0) {
-            do {
-                NO_CHECK_ITER;
-            } while (--count != 0);
+        unpinnedProc(dx, range.fFx1, dstC, cache, toggle, count);
+        dstC += count;
+        if (count & 1) {
+            toggle = next_dither_toggle(toggle);
         }
     }
     if ((count = range.fCount2) > 0) {
@@ -183,7 +191,7 @@ void shadeSpan_linear_clamp(TileProc proc, SkFixed dx, SkFixed fx,
     }
 }
 
-void shadeSpan_linear_mirror(TileProc proc, SkFixed dx, SkFixed fx,
+void shadeSpan_linear_mirror(SkFixed dx, SkFixed fx,
                              SkPMColor* SK_RESTRICT dstC,
                              const SkPMColor* SK_RESTRICT cache,
                              int toggle, int count) {
@@ -196,7 +204,7 @@ void shadeSpan_linear_mirror(TileProc proc, SkFixed dx, SkFixed fx,
     } while (--count != 0);
 }
 
-void shadeSpan_linear_repeat(TileProc proc, SkFixed dx, SkFixed fx,
+void shadeSpan_linear_repeat(SkFixed dx, SkFixed fx,
         SkPMColor* SK_RESTRICT dstC,
         const SkPMColor* SK_RESTRICT cache,
         int toggle, int count) {
@@ -218,9 +226,14 @@ void SkLinearGradient::shadeSpan(int x, int y, SkPMColor* SK_RESTRICT dstC,
     SkPoint             srcPt;
     SkMatrix::MapXYProc dstProc = fDstToIndexProc;
     TileProc            proc = fTileProc;
-    const SkPMColor* SK_RESTRICT cache = this->getCache32();
     int                 toggle = init_dither_toggle(x, y);
 
+    if (this->interpolatesColors()) {
+        this->shadeSpanInterpolated(x, y, dstC, count);
+        return;
+    }
+    const SkPMColor* SK_RESTRICT cache = this->getCache32();
+
     if (fDstToIndexClass != kPerspective_MatrixClass) {
         dstProc(fDstToIndex, SkIntToScalar(x) + SK_ScalarHalf,
                              SkIntToScalar(y) + SK_ScalarHalf, &srcPt);
@@ -235,17 +248,23 @@ void SkLinearGradient::shadeSpan(int x, int y, SkPMColor* SK_RESTRICT dstC,
             dx = SkScalarToFixed(fDstToIndex.getScaleX());
         }
 
-        LinearShadeProc shadeProc = shadeSpan_linear_repeat;
+        const SkGradientProcs& platform = PlatformProcs();
         if (0 == dx) {
-            shadeProc = shadeSpan_linear_vertical_lerp;
+            shadeSpan_linear_vertical_lerp(proc, dx, fx, dstC, cache, toggle, count);
         } else if (SkShader::kClamp_TileMode == fTileMode) {
-            shadeProc = shadeSpan_linear_clamp;
+            SkGradientLinearProc unpinnedProc = platform.fLinearClamp ? platform.fLinearClamp
+                                                                      : shadeSpan_linear_unpinned;
+            shadeSpan_linear_clamp(unpinnedProc, dx, fx, dstC, cache, toggle, count);
         } else if (SkShader::kMirror_TileMode == fTileMode) {
-            shadeProc = shadeSpan_linear_mirror;
+            SkGradientLinearProc shadeProc = platform.fLinearMirror ? platform.fLinearMirror
+                                                                    : shadeSpan_linear_mirror;
+            (*shadeProc)(dx, fx, dstC, cache, toggle, count);
         } else {
             SkASSERT(SkShader::kRepeat_TileMode == fTileMode);
+            SkGradientLinearProc shadeProc = platform.fLinearRepeat ? platform.fLinearRepeat
+                                                                    : shadeSpan_linear_repeat;
+            (*shadeProc)(dx, fx, dstC, cache, toggle, count);
         }
-        (*shadeProc)(proc, dx, fx, dstC, cache, toggle, count);
     } else {
         SkScalar    dstX = SkIntToScalar(x);
         SkScalar    dstY = SkIntToScalar(y);
@@ -260,6 +279,57 @@ void SkLinearGradient::shadeSpan(int x, int y, SkPMColor* SK_RESTRICT dstC,
     }
 }
 
+// Like shadeSpan(), but has the base class interpolate the colors at the
+// tiled positions, a chunk of pixels at a time.
+void SkLinearGradient::shadeSpanInterpolated(int x, int y, SkPMColor* SK_RESTRICT dstC,
+                                             int count) {
+    SkPoint             srcPt;
+    SkMatrix::MapXYProc dstProc = fDstToIndexProc;
+    TileProc            proc = fTileProc;
+    int                 toggle = init_dither_toggle(x, y);
+    uint16_t            t[kInterpolateChunk];
+
+    if (fDstToIndexClass != kPerspective_MatrixClass) {
+        dstProc(fDstToIndex, SkIntToScalar(x) + SK_ScalarHalf,
+                             SkIntToScalar(y) + SK_ScalarHalf, &srcPt);
+        SkFixed dx, fx = SkScalarToFixed(srcPt.fX);
+
+        if (fDstToIndexClass == kFixedStepInX_MatrixClass) {
+            SkFixed dxStorage[1];
+            (void)fDstToIndex.fixedStepInX(SkIntToScalar(y), dxStorage, NULL);
+            dx = dxStorage[0];
+        } else {
+            SkASSERT(fDstToIndexClass == kLinear_MatrixClass);
+            dx = SkScalarToFixed(fDstToIndex.getScaleX());
+        }
+
+        while (count > 0) {
+            int n = SkMin32(count, kInterpolateChunk);
+            for (int i = 0; i < n; ++i) {
+                t[i] = proc(fx);
+                fx += dx;
+            }
+            this->interpolateSpan(t, dstC, n, toggle);
+            dstC += n;
+            count -= n;
+        }
+    } else {
+        SkScalar    dstX = SkIntToScalar(x);
+        SkScalar    dstY = SkIntToScalar(y);
+        while (count > 0) {
+            int n = SkMin32(count, kInterpolateChunk);
+            for (int i = 0; i < n; ++i) {
+                dstProc(fDstToIndex, dstX, dstY, &srcPt);
+                t[i] = proc(SkScalarToFixed(srcPt.fX));
+                dstX += SK_Scalar1;
+            }
+            this->interpolateSpan(t, dstC, n, toggle);
+            dstC += n;
+            count -= n;
+        }
+    }
+}
+
 SkShader::BitmapType SkLinearGradient::asABitmap(SkBitmap* bitmap,
                                                 SkMatrix* matrix,
                                                 TileMode xy[]) const {
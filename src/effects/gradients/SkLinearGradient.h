@@ -15,7 +15,7 @@ class SkLinearGradient : public SkGradientShaderBase {
 public:
     SkLinearGradient(const SkPoint pts[2],
                      const SkColor colors[], const SkScalar pos[], int colorCount,
-                     SkShader::TileMode mode, SkUnitMapper* mapper);
+                     SkShader::TileMode mode, SkUnitMapper* mapper, uint32_t flags);
 
     virtual bool setContext(const SkBitmap&, const SkPaint&, const SkMatrix&) SK_OVERRIDE;
     virtual void shadeSpan(int x, int y, SkPMColor dstC[], int count) SK_OVERRIDE;
@@ -32,6 +32,8 @@ protected:
     virtual void flatten(SkFlattenableWriteBuffer& buffer) const SK_OVERRIDE;
 
 private:
+    void shadeSpanInterpolated(int x, int y, SkPMColor dstC[], int count);
+
     typedef SkGradientShaderBase INHERITED;
     const SkPoint fStart;
     const SkPoint fEnd;
@@ -154,8 +154,8 @@ void shadeSpan16_radial_repeat(SkScalar sfx, SkScalar sdx,
 
 SkRadialGradient::SkRadialGradient(const SkPoint& center, SkScalar radius,
                 const SkColor colors[], const SkScalar pos[], int colorCount,
-                SkShader::TileMode mode, SkUnitMapper* mapper)
-    : SkGradientShaderBase(colors, pos, colorCount, mode, mapper),
+                SkShader::TileMode mode, SkUnitMapper* mapper, uint32_t flags)
+    : SkGradientShaderBase(colors, pos, colorCount, mode, mapper, flags),
       fCenter(center),
       fRadius(radius)
 {
@@ -300,11 +300,6 @@ inline bool no_need_for_radial_pin(int fx, int dx,
     fx += dx; \
     fy += dy;
 
-typedef void (* RadialShadeProc)(SkScalar sfx, SkScalar sdx,
-        SkScalar sfy, SkScalar sdy,
-        SkPMColor* dstC, const SkPMColor* cache,
-        int count, int toggle);
-
 // On Linux, this is faster with SkPMColor[] params than SkPMColor* SK_RESTRICT
 void shadeSpan_radial_clamp(SkScalar sfx, SkScalar sdx,
         SkScalar sfy, SkScalar sdy,
@@ -420,6 +415,11 @@ void SkRadialGradient::shadeSpan(int x, int y,
                                 SkPMColor* SK_RESTRICT dstC, int count) {
     SkASSERT(count > 0);
 
+    if (this->interpolatesColors()) {
+        this->shadeSpanInterpolated(x, y, dstC, count);
+        return;
+    }
+
     SkPoint             srcPt;
     SkMatrix::MapXYProc dstProc = fDstToIndexProc;
     TileProc            proc = fTileProc;
@@ -442,13 +442,15 @@ void SkRadialGradient::shadeSpan(int x, int y,
             SkASSERT(fDstToIndexClass == kLinear_MatrixClass);
         }
 
-        RadialShadeProc shadeProc = shadeSpan_radial_repeat;
+        const SkGradientProcs& platform = PlatformProcs();
+        SkGradientRadialProc shadeProc;
         if (SkShader::kClamp_TileMode == fTileMode) {
-            shadeProc = shadeSpan_radial_clamp;
+            shadeProc = platform.fRadialClamp ? platform.fRadialClamp : shadeSpan_radial_clamp;
         } else if (SkShader::kMirror_TileMode == fTileMode) {
-            shadeProc = shadeSpan_radial_mirror;
+            shadeProc = platform.fRadialMirror ? platform.fRadialMirror : shadeSpan_radial_mirror;
         } else {
             SkASSERT(SkShader::kRepeat_TileMode == fTileMode);
+            shadeProc = shadeSpan_radial_repeat;
         }
         (*shadeProc)(srcPt.fX, sdx, srcPt.fY, sdy, dstC, cache, count, toggle);
     } else {    // perspective case
@@ -464,6 +466,62 @@ void SkRadialGradient::shadeSpan(int x, int y,
     }
 }
 
+// Like shadeSpan(), but has the base class interpolate the colors at the
+// tiled distances, a chunk of pixels at a time.
+void SkRadialGradient::shadeSpanInterpolated(int x, int y, SkPMColor* SK_RESTRICT dstC,
+                                             int count) {
+    SkPoint             srcPt;
+    SkMatrix::MapXYProc dstProc = fDstToIndexProc;
+    TileProc            proc = fTileProc;
+    int                 toggle = init_dither_toggle(x, y);
+    uint16_t            t[kInterpolateChunk];
+
+    if (fDstToIndexClass != kPerspective_MatrixClass) {
+        dstProc(fDstToIndex, SkIntToScalar(x) + SK_ScalarHalf,
+                             SkIntToScalar(y) + SK_ScalarHalf, &srcPt);
+        SkScalar fx = srcPt.fX;
+        SkScalar fy = srcPt.fY;
+        SkScalar sdx = fDstToIndex.getScaleX();
+        SkScalar sdy = fDstToIndex.getSkewY();
+
+        if (fDstToIndexClass == kFixedStepInX_MatrixClass) {
+            SkFixed storage[2];
+            (void)fDstToIndex.fixedStepInX(SkIntToScalar(y),
+                                           &storage[0], &storage[1]);
+            sdx = SkFixedToScalar(storage[0]);
+            sdy = SkFixedToScalar(storage[1]);
+        } else {
+            SkASSERT(fDstToIndexClass == kLinear_MatrixClass);
+        }
+
+        while (count > 0) {
+            int n = SkMin32(count, kInterpolateChunk);
+            for (int i = 0; i < n; ++i) {
+                t[i] = proc(SkScalarToFixed(SkPoint::Length(fx, fy)));
+                fx += sdx;
+                fy += sdy;
+            }
+            this->interpolateSpan(t, dstC, n, toggle);
+            dstC += n;
+            count -= n;
+        }
+    } else {    // perspective case
+        SkScalar dstX = SkIntToScalar(x);
+        SkScalar dstY = SkIntToScalar(y);
+        while (count > 0) {
+            int n = SkMin32(count, kInterpolateChunk);
+            for (int i = 0; i < n; ++i) {
+                dstProc(fDstToIndex, dstX, dstY, &srcPt);
+                t[i] = proc(SkScalarToFixed(srcPt.length()));
+                dstX += SK_Scalar1;
+            }
+            this->interpolateSpan(t, dstC, n, toggle);
+            dstC += n;
+            count -= n;
+        }
+    }
+}
+
 /////////////////////////////////////////////////////////////////////
 
 #if SK_SUPPORT_GPU
@@ -15,7 +15,7 @@ class SkRadialGradient : public SkGradientShaderBase {
 public:
     SkRadialGradient(const SkPoint& center, SkScalar radius,
                     const SkColor colors[], const SkScalar pos[], int colorCount,
-                    SkShader::TileMode mode, SkUnitMapper* mapper);
+                    SkShader::TileMode mode, SkUnitMapper* mapper, uint32_t flags);
     virtual void shadeSpan(int x, int y, SkPMColor* dstC, int count)
         SK_OVERRIDE;
     virtual void shadeSpan16(int x, int y, uint16_t* dstCParam,
@@ -34,6 +34,8 @@ protected:
     virtual void flatten(SkFlattenableWriteBuffer& buffer) const SK_OVERRIDE;
 
 private:
+    void shadeSpanInterpolated(int x, int y, SkPMColor dstC[], int count);
+
     typedef SkGradientShaderBase INHERITED;
     const SkPoint fCenter;
     const SkScalar fRadius;
@@ -85,43 +85,41 @@ void TwoPtRadial::setup(SkScalar fx, SkScalar fy, SkScalar dfx, SkScalar dfy) {
     fDB = -2 * (fDCenterX * fIncX + fDCenterY * fIncY);
 }
 
-SkFixed TwoPtRadial::nextT() {
+// Returns t at the current pixel of rec, and steps it to the next one.
+static SkFixed next_t(SkTwoPointConicalSpan* rec) {
     float roots[2];
 
-    float C = sqr(fRelX) + sqr(fRelY) - fRadius2;
-    int countRoots = find_quad_roots(fA, fB, C, roots);
+    float C = sqr(rec->fRelX) + sqr(rec->fRelY) - rec->fRadius2;
+    int countRoots = find_quad_roots(rec->fA, rec->fB, C, roots);
 
-    fRelX += fIncX;
-    fRelY += fIncY;
-    fB += fDB;
+    rec->fRelX += rec->fIncX;
+    rec->fRelY += rec->fIncY;
+    rec->fB += rec->fDB;
 
     if (0 == countRoots) {
-        return kDontDrawT;
+        return SkTwoPointConicalSpan::kDontDrawT;
     }
 
     // Prefer the bigger t value if both give a radius(t) > 0
     // find_quad_roots returns the values sorted, so we start with the last
     float t = roots[countRoots - 1];
-    float r = lerp(fRadius, fDRadius, t);
+    float r = lerp(rec->fRadius, rec->fDRadius, t);
     if (r <= 0) {
         t = roots[0];   // might be the same as roots[countRoots-1]
-        r = lerp(fRadius, fDRadius, t);
+        r = lerp(rec->fRadius, rec->fDRadius, t);
         if (r <= 0) {
-            return kDontDrawT;
+            return SkTwoPointConicalSpan::kDontDrawT;
         }
     }
     return SkFloatToFixed(t);
 }
 
-typedef void (*TwoPointConicalProc)(TwoPtRadial* rec, SkPMColor* dstC,
-                                    const SkPMColor* cache, int toggle, int count);
-
-static void twopoint_clamp(TwoPtRadial* rec, SkPMColor* SK_RESTRICT dstC,
+static void twopoint_clamp(SkTwoPointConicalSpan* rec, SkPMColor* SK_RESTRICT dstC,
                            const SkPMColor* SK_RESTRICT cache, int toggle,
                            int count) {
     for (; count > 0; --count) {
-        SkFixed t = rec->nextT();
-        if (TwoPtRadial::DontDrawT(t)) {
+        SkFixed t = next_t(rec);
+        if (SkTwoPointConicalSpan::DontDrawT(t)) {
             *dstC++ = 0;
         } else {
             SkFixed index = SkClampMax(t, 0xFFFF);
@@ -133,12 +131,12 @@ static void twopoint_clamp(TwoPtRadial* rec, SkPMColor* SK_RESTRICT dstC,
     }
 }
 
-static void twopoint_repeat(TwoPtRadial* rec, SkPMColor* SK_RESTRICT dstC,
+static void twopoint_repeat(SkTwoPointConicalSpan* rec, SkPMColor* SK_RESTRICT dstC,
                             const SkPMColor* SK_RESTRICT cache, int toggle,
                             int count) {
     for (; count > 0; --count) {
-        SkFixed t = rec->nextT();
-        if (TwoPtRadial::DontDrawT(t)) {
+        SkFixed t = next_t(rec);
+        if (SkTwoPointConicalSpan::DontDrawT(t)) {
             *dstC++ = 0;
         } else {
             SkFixed index = repeat_tileproc(t);
@@ -150,12 +148,12 @@ static void twopoint_repeat(TwoPtRadial* rec, SkPMColor* SK_RESTRICT dstC,
     }
 }
 
-static void twopoint_mirror(TwoPtRadial* rec, SkPMColor* SK_RESTRICT dstC,
+static void twopoint_mirror(SkTwoPointConicalSpan* rec, SkPMColor* SK_RESTRICT dstC,
                             const SkPMColor* SK_RESTRICT cache, int toggle,
                             int count) {
     for (; count > 0; --count) {
-        SkFixed t = rec->nextT();
-        if (TwoPtRadial::DontDrawT(t)) {
+        SkFixed t = next_t(rec);
+        if (SkTwoPointConicalSpan::DontDrawT(t)) {
             *dstC++ = 0;
         } else {
             SkFixed index = mirror_tileproc(t);
@@ -209,13 +207,15 @@ void SkTwoPointConicalGradient::shadeSpan(int x, int y, SkPMColor* dstCParam,
 
     const SkPMColor* SK_RESTRICT cache = this->getCache32();
 
-    TwoPointConicalProc shadeProc = twopoint_repeat;
+    const SkGradientProcs& platform = PlatformProcs();
+    SkGradientConicalProc shadeProc;
     if (SkShader::kClamp_TileMode == fTileMode) {
-        shadeProc = twopoint_clamp;
+        shadeProc = platform.fConicalClamp ? platform.fConicalClamp : twopoint_clamp;
     } else if (SkShader::kMirror_TileMode == fTileMode) {
-        shadeProc = twopoint_mirror;
+        shadeProc = platform.fConicalMirror ? platform.fConicalMirror : twopoint_mirror;
     } else {
         SkASSERT(SkShader::kRepeat_TileMode == fTileMode);
+        shadeProc = platform.fConicalRepeat ? platform.fConicalRepeat : twopoint_repeat;
     }
 
     if (fDstToIndexClass != kPerspective_MatrixClass) {
@@ -11,32 +11,15 @@
 
 #include "SkGradientShaderPriv.h"
 
-struct TwoPtRadial {
-    enum {
-        kDontDrawT  = 0x80000000
-    };
-
+struct TwoPtRadial : public SkTwoPointConicalSpan {
     float   fCenterX, fCenterY;
     float   fDCenterX, fDCenterY;
-    float   fRadius;
-    float   fDRadius;
-    float   fA;
-    float   fRadius2;
     float   fRDR;
 
     void init(const SkPoint& center0, SkScalar rad0,
               const SkPoint& center1, SkScalar rad1);
 
-    // used by setup and nextT
-    float   fRelX, fRelY, fIncX, fIncY;
-    float   fB, fDB;
-
     void setup(SkScalar fx, SkScalar fy, SkScalar dfx, SkScalar dfy);
-    SkFixed nextT();
-
-    static bool DontDrawT(SkFixed t) {
-        return kDontDrawT == (uint32_t)t;
-    }
 };
 
 
@@ -0,0 +1,374 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*  SSE2 versions of the matrix procs in core/SkBitmapProcState_matrix.h.
+ *
+ *  Define these before including this file:
+ *      MAKENAME(suffix)        name of each generated proc
+ *      TILE_PROCF(f, max)      scalar tile, as in SkBitmapProcState_matrix.h
+ *      TILE_LOW_BITS(f, max)   scalar low bits, as in SkBitmapProcState_matrix.h
+ *      TILE_PARAM(max)         the 32 bit value the wide versions are given
+ *      WIDE_TILE(f, param)     TILE_PROCF on four SkFixed at once
+ *      WIDE_LOW_BITS(f, param) TILE_LOW_BITS on four SkFixed at once
+ *
+ *  Define PERSP_ONLY to only generate the perspective procs.
+ */
+
+#define PACK_FILTER_NAME        MAKENAME(_pack_filter)
+#define WIDE_PACK_FILTER_NAME   MAKENAME(_wide_pack_filter)
+
+// declare functions externally to suppress warnings.
+#ifndef PERSP_ONLY
+void MAKENAME(_nofilter_scale)(const SkBitmapProcState& s,
+                               uint32_t xy[], int count, int x, int y);
+void MAKENAME(_filter_scale)(const SkBitmapProcState& s,
+                             uint32_t xy[], int count, int x, int y);
+void MAKENAME(_nofilter_affine)(const SkBitmapProcState& s,
+                                uint32_t xy[], int count, int x, int y);
+void MAKENAME(_filter_affine)(const SkBitmapProcState& s,
+                              uint32_t xy[], int count, int x, int y);
+#endif
+void MAKENAME(_nofilter_persp)(const SkBitmapProcState& s,
+                               uint32_t* SK_RESTRICT xy,
+                               int count, int x, int y);
+void MAKENAME(_filter_persp)(const SkBitmapProcState& s,
+                             uint32_t* SK_RESTRICT xy, int count,
+                             int x, int y);
+
+static inline uint32_t PACK_FILTER_NAME(SkFixed f, unsigned max, SkFixed one) {
+    unsigned i = TILE_PROCF(f, max);
+    i = (i << 4) | TILE_LOW_BITS(f, max);
+    return (i << 14) | TILE_PROCF((f + one), max);
+}
+
+static inline __m128i WIDE_PACK_FILTER_NAME(__m128i f, __m128i param,
+                                            __m128i one) {
+    __m128i i = _mm_slli_epi32(WIDE_TILE(f, param), 4);
+    i = _mm_or_si128(i, WIDE_LOW_BITS(f, param));
+    return _mm_or_si128(_mm_slli_epi32(i, 14),
+                        WIDE_TILE(_mm_add_epi32(f, one), param));
+}
+
+#ifndef PERSP_ONLY
+
+void MAKENAME(_nofilter_scale)(const SkBitmapProcState& s,
+                               uint32_t xy[], int count, int x, int y) {
+    SkASSERT((s.fInvType & ~(SkMatrix::kTranslate_Mask |
+                             SkMatrix::kScale_Mask)) == 0);
+
+    // we store y, x, x, x, x, x
+    const unsigned maxX = s.fBitmap->width() - 1;
+    SkPoint pt;
+    s.fInvProc(*s.fInvMatrix, SkIntToScalar(x) + SK_ScalarHalf,
+                              SkIntToScalar(y) + SK_ScalarHalf, &pt);
+    *xy++ = TILE_PROCF(SkFractionalIntToFixed(SkScalarToFractionalInt(pt.fY)),
+                       s.fBitmap->height() - 1);
+
+    if (0 == maxX) {
+        // all of the following X values must be 0
+        memset(xy, 0, count * sizeof(uint16_t));
+        return;
+    }
+
+    SkFractionalInt fx = SkScalarToFractionalInt(pt.fX);
+    const SkFractionalInt dx = s.fInvSxFractionalInt;
+    uint16_t* xx = reinterpret_cast<uint16_t*>(xy);
+
+    if (count >= 8) {
+        __m128i wide_param = _mm_set1_epi32(TILE_PARAM(maxX));
+        FractionalIntX4 wide_low(fx, dx, 8);
+        FractionalIntX4 wide_high(fx + dx * 4, dx, 8);
+
+        do {
+            __m128i wide_out_low = WIDE_TILE(wide_low.toFixed(), wide_param);
+            __m128i wide_out_high = WIDE_TILE(wide_high.toFixed(), wide_param);
+
+            // The indices may not fit in a signed 16 bit integer, and
+            // _mm_packs_epi32 saturates, so sign extend them first to have
+            // it pack their low 16 bits unchanged.
+            wide_out_low = _mm_srai_epi32(_mm_slli_epi32(wide_out_low, 16), 16);
+            wide_out_high = _mm_srai_epi32(_mm_slli_epi32(wide_out_high, 16), 16);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(xx),
+                             _mm_packs_epi32(wide_out_low, wide_out_high));
+
+            wide_low.step();
+            wide_high.step();
+            fx += dx * 8;
+            xx += 8;
+            count -= 8;
+        } while (count >= 8);
+    }
+
+    while (count-- > 0) {
+        *xx++ = TILE_PROCF(SkFractionalIntToFixed(fx), maxX);
+        fx += dx;
+    }
+}
+
+void MAKENAME(_filter_scale)(const SkBitmapProcState& s,
+                             uint32_t xy[], int count, int x, int y) {
+    SkASSERT((s.fInvType & ~(SkMatrix::kTranslate_Mask |
+                             SkMatrix::kScale_Mask)) == 0);
+    SkASSERT(s.fInvKy == 0);
+
+    const unsigned maxX = s.fBitmap->width() - 1;
+    const SkFixed one = s.fFilterOneX;
+    const SkFractionalInt dx = s.fInvSxFractionalInt;
+
+    SkPoint pt;
+    s.fInvProc(*s.fInvMatrix, SkIntToScalar(x) + SK_ScalarHalf,
+                              SkIntToScalar(y) + SK_ScalarHalf, &pt);
+    const SkFixed fy = SkScalarToFixed(pt.fY) - (s.fFilterOneY >> 1);
+    // compute our two Y values up front
+    *xy++ = PACK_FILTER_NAME(fy, s.fBitmap->height() - 1, s.fFilterOneY);
+    SkFractionalInt fx = SkScalarToFractionalInt(pt.fX) -
+                         (SkFixedToFractionalInt(one) >> 1);
+
+    if (count >= 4) {
+        __m128i wide_param = _mm_set1_epi32(TILE_PARAM(maxX));
+        __m128i wide_one = _mm_set1_epi32(one);
+        FractionalIntX4 wide_fx(fx, dx, 4);
+
+        do {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(xy),
+                             WIDE_PACK_FILTER_NAME(wide_fx.toFixed(),
+                                                   wide_param, wide_one));
+
+            wide_fx.step();
+            fx += dx * 4;
+            xy += 4;
+            count -= 4;
+        } while (count >= 4);
+    }
+
+    while (count-- > 0) {
+        *xy++ = PACK_FILTER_NAME(SkFractionalIntToFixed(fx), maxX, one);
+        fx += dx;
+    }
+}
+
+void MAKENAME(_nofilter_affine)(const SkBitmapProcState& s,
+                                uint32_t xy[], int count, int x, int y) {
+    SkASSERT(s.fInvType & SkMatrix::kAffine_Mask);
+    SkASSERT((s.fInvType & ~(SkMatrix::kTranslate_Mask |
+                             SkMatrix::kScale_Mask |
+                             SkMatrix::kAffine_Mask)) == 0);
+
+    SkPoint srcPt;
+    s.fInvProc(*s.fInvMatrix,
+               SkIntToScalar(x) + SK_ScalarHalf,
+               SkIntToScalar(y) + SK_ScalarHalf, &srcPt);
+
+    SkFractionalInt fx = SkScalarToFractionalInt(srcPt.fX);
+    SkFractionalInt fy = SkScalarToFractionalInt(srcPt.fY);
+    SkFractionalInt dx = s.fInvSxFractionalInt;
+    SkFractionalInt dy = s.fInvKyFractionalInt;
+    unsigned maxX = s.fBitmap->width() - 1;
+    unsigned maxY = s.fBitmap->height() - 1;
+
+    if (count >= 4) {
+        __m128i wide_paramX = _mm_set1_epi32(TILE_PARAM(maxX));
+        __m128i wide_paramY = _mm_set1_epi32(TILE_PARAM(maxY));
+        FractionalIntX4 wide_fx(fx, dx, 4);
+        FractionalIntX4 wide_fy(fy, dy, 4);
+
+        do {
+            __m128i wide_i = _mm_slli_epi32(WIDE_TILE(wide_fy.toFixed(), wide_paramY), 16);
+            wide_i = _mm_or_si128(wide_i, WIDE_TILE(wide_fx.toFixed(), wide_paramX));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(xy), wide_i);
+
+            wide_fx.step();
+            wide_fy.step();
+            fx += dx * 4;
+            fy += dy * 4;
+            xy += 4;
+            count -= 4;
+        } while (count >= 4);
+    }
+
+    while (count-- > 0) {
+        *xy++ = (TILE_PROCF(SkFractionalIntToFixed(fy), maxY) << 16) |
+                 TILE_PROCF(SkFractionalIntToFixed(fx), maxX);
+        fx += dx;
+        fy += dy;
+    }
+}
+
+void MAKENAME(_filter_affine)(const SkBitmapProcState& s,
+                              uint32_t xy[], int count, int x, int y) {
+    SkASSERT(s.fInvType & SkMatrix::kAffine_Mask);
+    SkASSERT((s.fInvType & ~(SkMatrix::kTranslate_Mask |
+                             SkMatrix::kScale_Mask |
+                             SkMatrix::kAffine_Mask)) == 0);
+
+    SkPoint srcPt;
+    s.fInvProc(*s.fInvMatrix,
+               SkIntToScalar(x) + SK_ScalarHalf,
+               SkIntToScalar(y) + SK_ScalarHalf, &srcPt);
+
+    SkFixed oneX = s.fFilterOneX;
+    SkFixed oneY = s.fFilterOneY;
+    SkFixed fx = SkScalarToFixed(srcPt.fX) - (oneX >> 1);
+    SkFixed fy = SkScalarToFixed(srcPt.fY) - (oneY >> 1);
+    SkFixed dx = s.fInvSx;
+    SkFixed dy = s.fInvKy;
+    unsigned maxX = s.fBitmap->width() - 1;
+    unsigned maxY = s.fBitmap->height() - 1;
+
+    if (count >= 4) {
+        __m128i wide_paramX = _mm_set1_epi32(TILE_PARAM(maxX));
+        __m128i wide_paramY = _mm_set1_epi32(TILE_PARAM(maxY));
+        __m128i wide_oneX = _mm_set1_epi32(oneX);
+        __m128i wide_oneY = _mm_set1_epi32(oneY);
+        __m128i wide_dx4 = _mm_set1_epi32(dx * 4);
+        __m128i wide_dy4 = _mm_set1_epi32(dy * 4);
+        __m128i wide_fx = _mm_set_epi32(fx + dx * 3, fx + dx * 2,
+                                        fx + dx, fx);
+        __m128i wide_fy = _mm_set_epi32(fy + dy * 3, fy + dy * 2,
+                                        fy + dy, fy);
+
+        do {
+            __m128i wide_y = WIDE_PACK_FILTER_NAME(wide_fy, wide_paramY, wide_oneY);
+            __m128i wide_x = WIDE_PACK_FILTER_NAME(wide_fx, wide_paramX, wide_oneX);
+
+            // we store y, x for each pixel
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(xy),
+                             _mm_unpacklo_epi32(wide_y, wide_x));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(xy + 4),
+                             _mm_unpackhi_epi32(wide_y, wide_x));
+
+            wide_fx = _mm_add_epi32(wide_fx, wide_dx4);
+            wide_fy = _mm_add_epi32(wide_fy, wide_dy4);
+            fx += dx * 4;
+            fy += dy * 4;
+            xy += 8;
+            count -= 4;
+        } while (count >= 4);
+    }
+
+    while (count-- > 0) {
+        *xy++ = PACK_FILTER_NAME(fy, maxY, oneY);
+        fy += dy;
+        *xy++ = PACK_FILTER_NAME(fx, maxX, oneX);
+        fx += dx;
+    }
+}
+
+#endif  // PERSP_ONLY
+
+void MAKENAME(_nofilter_persp)(const SkBitmapProcState& s,
+                               uint32_t* SK_RESTRICT xy,
+                               int count, int x, int y) {
+    SkASSERT(s.fInvType & SkMatrix::kPerspective_Mask);
+
+    unsigned maxX = s.fBitmap->width() - 1;
+    unsigned maxY = s.fBitmap->height() - 1;
+    __m128i wide_paramX = _mm_set1_epi32(TILE_PARAM(maxX));
+    __m128i wide_paramY = _mm_set1_epi32(TILE_PARAM(maxY));
+
+    SkPerspIter   iter(*s.fInvMatrix,
+                       SkIntToScalar(x) + SK_ScalarHalf,
+                       SkIntToScalar(y) + SK_ScalarHalf, count);
+
+    while ((count = iter.next()) != 0) {
+        const SkFixed* SK_RESTRICT srcXY = iter.getXY();
+
+        while (count >= 4) {
+            __m128i wide_fx, wide_fy;
+            persp_load_xy_SSE2(srcXY, &wide_fx, &wide_fy);
+
+            __m128i wide_i = _mm_slli_epi32(WIDE_TILE(wide_fy, wide_paramY), 16);
+            wide_i = _mm_or_si128(wide_i, WIDE_TILE(wide_fx, wide_paramX));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(xy), wide_i);
+
+            srcXY += 8;
+            xy += 4;
+            count -= 4;
+        }
+
+        while (--count >= 0) {
+            *xy++ = (TILE_PROCF(srcXY[1], maxY) << 16) |
+                     TILE_PROCF(srcXY[0], maxX);
+            srcXY += 2;
+        }
+    }
+}
+
+void MAKENAME(_filter_persp)(const SkBitmapProcState& s,
+                             uint32_t* SK_RESTRICT xy, int count,
+                             int x, int y) {
+    SkASSERT(s.fInvType & SkMatrix::kPerspective_Mask);
+
+    unsigned maxX = s.fBitmap->width() - 1;
+    unsigned maxY = s.fBitmap->height() - 1;
+    SkFixed oneX = s.fFilterOneX;
+    SkFixed oneY = s.fFilterOneY;
+    __m128i wide_paramX = _mm_set1_epi32(TILE_PARAM(maxX));
+    __m128i wide_paramY = _mm_set1_epi32(TILE_PARAM(maxY));
+    __m128i wide_oneX = _mm_set1_epi32(oneX);
+    __m128i wide_oneY = _mm_set1_epi32(oneY);
+    __m128i wide_halfX = _mm_set1_epi32(oneX >> 1);
+    __m128i wide_halfY = _mm_set1_epi32(oneY >> 1);
+
+    SkPerspIter   iter(*s.fInvMatrix,
+                       SkIntToScalar(x) + SK_ScalarHalf,
+                       SkIntToScalar(y) + SK_ScalarHalf, count);
+
+    while ((count = iter.next()) != 0) {
+        const SkFixed* SK_RESTRICT srcXY = iter.getXY();
+
+        while (count >= 4) {
+            __m128i wide_fx, wide_fy;
+            persp_load_xy_SSE2(srcXY, &wide_fx, &wide_fy);
+            wide_fx = _mm_sub_epi32(wide_fx, wide_halfX);
+            wide_fy = _mm_sub_epi32(wide_fy, wide_halfY);
+
+            __m128i wide_y = WIDE_PACK_FILTER_NAME(wide_fy, wide_paramY, wide_oneY);
+            __m128i wide_x = WIDE_PACK_FILTER_NAME(wide_fx, wide_paramX, wide_oneX);
+
+            // we store y, x for each pixel
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(xy),
+                             _mm_unpacklo_epi32(wide_y, wide_x));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(xy + 4),
+                             _mm_unpackhi_epi32(wide_y, wide_x));
+
+            srcXY += 8;
+            xy += 8;
+            count -= 4;
+        }
+
+        while (--count >= 0) {
+            *xy++ = PACK_FILTER_NAME(srcXY[1] - (oneY >> 1), maxY, oneY);
+            *xy++ = PACK_FILTER_NAME(srcXY[0] - (oneX >> 1), maxX, oneX);
+            srcXY += 2;
+        }
+    }
+}
+
+#ifndef PERSP_ONLY
+const SkBitmapProcState::MatrixProc MAKENAME(_Procs)[] = {
+    MAKENAME(_nofilter_scale),
+    MAKENAME(_filter_scale),
+    MAKENAME(_nofilter_affine),
+    MAKENAME(_filter_affine),
+    MAKENAME(_nofilter_persp),
+    MAKENAME(_filter_persp)
+};
+#endif
+
+#undef MAKENAME
+#undef TILE_PROCF
+#undef TILE_LOW_BITS
+#undef TILE_PARAM
+#undef WIDE_TILE
+#undef WIDE_LOW_BITS
+#ifdef PERSP_ONLY
+    #undef PERSP_ONLY
+#endif
+
+#undef PACK_FILTER_NAME
+#undef WIDE_PACK_FILTER_NAME
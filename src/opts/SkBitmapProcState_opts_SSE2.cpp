@@ -9,6 +9,8 @@
 
 #include <emmintrin.h>
 #include "SkBitmapProcState_opts_SSE2.h"
+#include "SkColorPriv.h"
+#include "SkPerspIter.h"
 #include "SkUtils.h"
 
 void S32_opaque_D32_filter_DX_SSE2(const SkBitmapProcState& s,
@@ -763,3 +765,404 @@ void S32_D16_filter_DX_SSE2(const SkBitmapProcState& s,
 
     } while (--count > 0);
 }
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*  Wide tile procs for SkBitmapProcState_matrix_SSE2.h. Each handles four
+ *  SkFixed at once, given a vector of TILE_PARAM(max).
+ */
+
+// SkClampMax(f >> 16, max) for any f, without the 16 bit limits of
+// _mm_min_epi16 and _mm_max_epi16.
+static inline __m128i clamp_tile_SSE2(__m128i f, __m128i max) {
+    __m128i i = _mm_srai_epi32(f, 16);
+    i = _mm_andnot_si128(_mm_srai_epi32(i, 31), i);
+    __m128i over = _mm_cmpgt_epi32(i, max);
+    return _mm_or_si128(_mm_and_si128(over, max), _mm_andnot_si128(over, i));
+}
+
+static inline __m128i clamp_low_bits_SSE2(__m128i f, __m128i) {
+    return _mm_and_si128(_mm_srli_epi32(f, 12), _mm_set1_epi32(0xF));
+}
+
+// ((f & 0xFFFF) * (max + 1)) >> 16. The high half of each lane of scale is 0,
+// so the high half of f drops out of both products.
+static inline __m128i repeat_tile_SSE2(__m128i f, __m128i scale) {
+    return _mm_mulhi_epu16(f, scale);
+}
+
+static inline __m128i repeat_low_bits_SSE2(__m128i f, __m128i scale) {
+    return _mm_srli_epi32(_mm_mullo_epi16(f, scale), 12);
+}
+
+// Like fixed_mirror(), flip the fraction on odd intervals before scaling it.
+static inline __m128i mirror_tile_SSE2(__m128i f, __m128i scale) {
+    __m128i odd = _mm_srai_epi32(_mm_slli_epi32(f, 15), 31);
+    return _mm_mulhi_epu16(_mm_xor_si128(f, odd), scale);
+}
+
+static inline unsigned mirror_fixed(SkFixed f) {
+    SkFixed s = -((f >> 16) & 1);
+    return (f ^ s) & 0xFFFF;
+}
+
+// Splits the next four (x, y) pairs of an SkPerspIter into x and y vectors.
+static inline void persp_load_xy_SSE2(const SkFixed* srcXY,
+                                      __m128i* fx, __m128i* fy) {
+    __m128i xy01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcXY));
+    __m128i xy23 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcXY + 4));
+
+    // (x0, y0, x1, y1) -> (x0, x1, y0, y1)
+    xy01 = _mm_shuffle_epi32(xy01, _MM_SHUFFLE(3, 1, 2, 0));
+    xy23 = _mm_shuffle_epi32(xy23, _MM_SHUFFLE(3, 1, 2, 0));
+
+    *fx = _mm_unpacklo_epi64(xy01, xy23);
+    *fy = _mm_unpackhi_epi64(xy01, xy23);
+}
+
+/*  Steps x, x + dx, x + 2dx and x + 3dx, n * dx at a time, keeping the full
+ *  SkFractionalInt precision the portable scale procs use so that the SSE2
+ *  procs pick the same pixels.
+ */
+class FractionalIntX4 {
+public:
+    FractionalIntX4(SkFractionalInt x, SkFractionalInt dx, int n) {
+#ifdef FractionalInt_IS_64BIT
+        fX01 = _mm_set_epi64x(x + dx, x);
+        fX23 = _mm_set_epi64x(x + dx * 3, x + dx * 2);
+        fStep = _mm_set1_epi64x(dx * n);
+#else
+        fX = _mm_set_epi32(x + dx * 3, x + dx * 2, x + dx, x);
+        fStep = _mm_set1_epi32(dx * n);
+#endif
+    }
+
+    // SkFractionalIntToFixed of each.
+    __m128i toFixed() const {
+#ifdef FractionalInt_IS_64BIT
+        // SkFixed48ToFixed keeps the high 32 bits.
+        return _mm_unpacklo_epi64(_mm_shuffle_epi32(fX01, _MM_SHUFFLE(3, 1, 3, 1)),
+                                  _mm_shuffle_epi32(fX23, _MM_SHUFFLE(3, 1, 3, 1)));
+#else
+        return fX;
+#endif
+    }
+
+    void step() {
+#ifdef FractionalInt_IS_64BIT
+        fX01 = _mm_add_epi64(fX01, fStep);
+        fX23 = _mm_add_epi64(fX23, fStep);
+#else
+        fX = _mm_add_epi32(fX, fStep);
+#endif
+    }
+
+private:
+#ifdef FractionalInt_IS_64BIT
+    __m128i fX01;
+    __m128i fX23;
+#else
+    __m128i fX;
+#endif
+    __m128i fStep;
+};
+
+// The scale and affine clamp procs above special-case decal spans, so only
+// take the perspective ones from the template.
+#define MAKENAME(suffix)            ClampX_ClampY ## suffix ## _SSE2
+#define TILE_PROCF(f, max)          SkClampMax((f) >> 16, max)
+#define TILE_LOW_BITS(f, max)       (((f) >> 12) & 0xF)
+#define TILE_PARAM(max)             (max)
+#define WIDE_TILE(f, param)         clamp_tile_SSE2(f, param)
+#define WIDE_LOW_BITS(f, param)     clamp_low_bits_SSE2(f, param)
+#define PERSP_ONLY
+#include "SkBitmapProcState_matrix_SSE2.h"
+
+#define MAKENAME(suffix)            RepeatX_RepeatY ## suffix ## _SSE2
+#define TILE_PROCF(f, max)          ((((f) & 0xFFFF) * ((max) + 1)) >> 16)
+#define TILE_LOW_BITS(f, max)       ((((f) & 0xFFFF) * ((max) + 1) >> 12) & 0xF)
+#define TILE_PARAM(max)             ((max) + 1)
+#define WIDE_TILE(f, param)         repeat_tile_SSE2(f, param)
+#define WIDE_LOW_BITS(f, param)     repeat_low_bits_SSE2(f, param)
+#include "SkBitmapProcState_matrix_SSE2.h"
+
+// mirror and repeat have the same low bits, see choose_tile_lowbits_proc().
+#define MAKENAME(suffix)            MirrorX_MirrorY ## suffix ## _SSE2
+#define TILE_PROCF(f, max)          ((mirror_fixed(f) * ((max) + 1)) >> 16)
+#define TILE_LOW_BITS(f, max)       ((((f) & 0xFFFF) * ((max) + 1) >> 12) & 0xF)
+#define TILE_PARAM(max)             ((max) + 1)
+#define WIDE_TILE(f, param)         mirror_tile_SSE2(f, param)
+#define WIDE_LOW_BITS(f, param)     repeat_low_bits_SSE2(f, param)
+#include "SkBitmapProcState_matrix_SSE2.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*  Filters one 8888 pixel exactly as Filter_32_opaque does, returning its
+ *  components in the four 32 bit lanes. Interleaving a00 with a01 and a10
+ *  with a11 lets _mm_madd_epi16 weigh and add each pair in one instruction.
+ */
+static inline __m128i S32_filter_SSE2(const uint32_t* row0,
+                                      const uint32_t* row1,
+                                      uint32_t XX, unsigned subY) {
+    unsigned x0 = XX >> 18;
+    unsigned x1 = XX & 0x3FFF;
+    unsigned subX = (XX >> 14) & 0xF;
+    __m128i zero = _mm_setzero_si128();
+
+    __m128i top = _mm_unpacklo_epi8(_mm_cvtsi32_si128(row0[x0]),
+                                    _mm_cvtsi32_si128(row0[x1]));
+    __m128i bottom = _mm_unpacklo_epi8(_mm_cvtsi32_si128(row1[x0]),
+                                       _mm_cvtsi32_si128(row1[x1]));
+    top = _mm_unpacklo_epi8(top, zero);
+    bottom = _mm_unpacklo_epi8(bottom, zero);
+
+    // (w01 << 16 | w00) and (w11 << 16 | w10)
+    top = _mm_madd_epi16(top, _mm_set1_epi32(((16 - subX) * (16 - subY)) |
+                                             ((subX * (16 - subY)) << 16)));
+    bottom = _mm_madd_epi16(bottom, _mm_set1_epi32(((16 - subX) * subY) |
+                                                   ((subX * subY) << 16)));
+
+    // The weights sum to 256.
+    return _mm_srli_epi32(_mm_add_epi32(top, bottom), 8);
+}
+
+// Packs four 32 bit components, each 0..255, into an SkPMColor.
+static inline SkPMColor pack_components_SSE2(__m128i c) {
+    c = _mm_packs_epi32(c, c);
+    return _mm_cvtsi128_si32(_mm_packus_epi16(c, c));
+}
+
+static inline void S32_D32_filter_DXDY_SSE2(const SkBitmapProcState& s,
+                                            const uint32_t* xy, int count,
+                                            uint32_t* colors,
+                                            unsigned alphaScale) {
+    const char* srcAddr = static_cast<const char*>(s.fBitmap->getPixels());
+    size_t rb = s.fBitmap->rowBytes();
+    __m128i alpha = _mm_set1_epi32(alphaScale);
+
+    do {
+        uint32_t XY = *xy++;    // y0:14 | 4 | y1:14
+        unsigned y0 = XY >> 14;
+        const uint32_t* row0 = reinterpret_cast<const uint32_t*>(srcAddr + (y0 >> 4) * rb);
+        const uint32_t* row1 = reinterpret_cast<const uint32_t*>(srcAddr + (XY & 0x3FFF) * rb);
+
+        __m128i c = S32_filter_SSE2(row0, row1, *xy++, y0 & 0xF);
+        if (alphaScale < 256) {
+            // Each product fits in the low 16 bits of its lane.
+            c = _mm_srli_epi32(_mm_mullo_epi16(c, alpha), 8);
+        }
+        *colors++ = pack_components_SSE2(c);
+    } while (--count > 0);
+}
+
+void S32_opaque_D32_filter_DXDY_SSE2(const SkBitmapProcState& s,
+                                     const uint32_t* xy,
+                                     int count, uint32_t* colors) {
+    SkASSERT(count > 0 && colors != NULL);
+    SkASSERT(s.fDoFilter);
+    SkASSERT(s.fBitmap->config() == SkBitmap::kARGB_8888_Config);
+    SkASSERT(s.fAlphaScale == 256);
+
+    S32_D32_filter_DXDY_SSE2(s, xy, count, colors, 256);
+}
+
+void S32_alpha_D32_filter_DXDY_SSE2(const SkBitmapProcState& s,
+                                    const uint32_t* xy,
+                                    int count, uint32_t* colors) {
+    SkASSERT(count > 0 && colors != NULL);
+    SkASSERT(s.fDoFilter);
+    SkASSERT(s.fBitmap->config() == SkBitmap::kARGB_8888_Config);
+    SkASSERT(s.fAlphaScale < 256);
+
+    S32_D32_filter_DXDY_SSE2(s, xy, count, colors, s.fAlphaScale);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*  Loads the four 565 samples of one pixel into the low four 16 bit lanes of
+ *  taps, and their Filter_565_Expanded weights, which sum to 32, into weights.
+ */
+static inline void S16_load_filter_SSE2(const uint16_t* row0,
+                                        const uint16_t* row1,
+                                        uint32_t XX, unsigned subY,
+                                        __m128i* taps, __m128i* weights) {
+    unsigned x0 = XX >> 18;
+    unsigned x1 = XX & 0x3FFF;
+    unsigned subX = (XX >> 14) & 0xF;
+    int xy = subX * subY >> 3;
+
+    *taps = _mm_setr_epi16(row0[x0], row0[x1], row1[x0], row1[x1],
+                           0, 0, 0, 0);
+    *weights = _mm_setr_epi16(32 - 2*subY - 2*subX + xy, 2*subX - xy,
+                              2*subY - xy, xy, 0, 0, 0, 0);
+}
+
+/*  Filters the two pixels whose samples and weights are in the low and high
+ *  halves of taps and weights, returning them as SkPMColors in the low two
+ *  lanes. Each component gets the same result as Filter_565_Expanded followed
+ *  by SkExpanded_565_To_PMColor.
+ */
+static inline __m128i S16_filter_SSE2(__m128i taps, __m128i weights) {
+    __m128i r = _mm_and_si128(_mm_srli_epi16(taps, SK_R16_SHIFT),
+                              _mm_set1_epi16(SK_R16_MASK));
+    __m128i g = _mm_and_si128(_mm_srli_epi16(taps, SK_G16_SHIFT),
+                              _mm_set1_epi16(SK_G16_MASK));
+    __m128i b = _mm_and_si128(_mm_srli_epi16(taps, SK_B16_SHIFT),
+                              _mm_set1_epi16(SK_B16_MASK));
+
+    // Weigh (a00, a01) and (a10, a11) into one lane each, then add the two
+    // lanes of each pixel, leaving pixel 0 in lane 0 and pixel 1 in lane 2.
+    r = _mm_madd_epi16(r, weights);
+    g = _mm_madd_epi16(g, weights);
+    b = _mm_madd_epi16(b, weights);
+    r = _mm_add_epi32(r, _mm_shuffle_epi32(r, _MM_SHUFFLE(2, 3, 0, 1)));
+    g = _mm_add_epi32(g, _mm_shuffle_epi32(g, _MM_SHUFFLE(2, 3, 0, 1)));
+    b = _mm_add_epi32(b, _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    // 5 bits * 32 -> 8 bits, 6 bits * 32 -> 8 bits
+    __m128i c = _mm_set1_epi32(0xFF << SK_A32_SHIFT);
+    c = _mm_or_si128(c, _mm_slli_epi32(_mm_srli_epi32(r, 2), SK_R32_SHIFT));
+    c = _mm_or_si128(c, _mm_slli_epi32(_mm_srli_epi32(g, 3), SK_G32_SHIFT));
+    c = _mm_or_si128(c, _mm_slli_epi32(_mm_srli_epi32(b, 2), SK_B32_SHIFT));
+
+    return _mm_shuffle_epi32(c, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+// SkAlphaMulQ on the two SkPMColors in the low lanes of c.
+static inline __m128i S16_scale_by_alpha_SSE2(__m128i c, __m128i alpha) {
+    __m128i zero = _mm_setzero_si128();
+    c = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(c, zero), alpha), 8);
+    return _mm_packus_epi16(c, zero);
+}
+
+static inline void S16_D32_filter_DX_SSE2(const SkBitmapProcState& s,
+                                          const uint32_t* xy, int count,
+                                          uint32_t* colors,
+                                          unsigned alphaScale) {
+    const char* srcAddr = static_cast<const char*>(s.fBitmap->getPixels());
+    size_t rb = s.fBitmap->rowBytes();
+    uint32_t XY = *xy++;
+    unsigned y0 = XY >> 14;
+    const uint16_t* row0 = reinterpret_cast<const uint16_t*>(srcAddr + (y0 >> 4) * rb);
+    const uint16_t* row1 = reinterpret_cast<const uint16_t*>(srcAddr + (XY & 0x3FFF) * rb);
+    unsigned subY = y0 & 0xF;
+    __m128i alpha = _mm_set1_epi16(alphaScale);
+
+    while (count >= 2) {
+        __m128i taps0, weights0, taps1, weights1;
+        S16_load_filter_SSE2(row0, row1, xy[0], subY, &taps0, &weights0);
+        S16_load_filter_SSE2(row0, row1, xy[1], subY, &taps1, &weights1);
+
+        __m128i c = S16_filter_SSE2(_mm_unpacklo_epi64(taps0, taps1),
+                                    _mm_unpacklo_epi64(weights0, weights1));
+        if (alphaScale < 256) {
+            c = S16_scale_by_alpha_SSE2(c, alpha);
+        }
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(colors), c);
+
+        xy += 2;
+        colors += 2;
+        count -= 2;
+    }
+
+    if (count > 0) {
+        __m128i taps, weights;
+        S16_load_filter_SSE2(row0, row1, *xy, subY, &taps, &weights);
+        __m128i c = S16_filter_SSE2(taps, weights);
+        if (alphaScale < 256) {
+            c = S16_scale_by_alpha_SSE2(c, alpha);
+        }
+        *colors = _mm_cvtsi128_si32(c);
+    }
+}
+
+// Reads one pixel's y and x from a DXDY buffer and loads it as above.
+static inline void S16_load_filter_DXDY_SSE2(const char* srcAddr, size_t rb,
+                                             const uint32_t* xy,
+                                             __m128i* taps, __m128i* weights) {
+    uint32_t XY = xy[0];    // y0:14 | 4 | y1:14
+    unsigned y0 = XY >> 14;
+    const uint16_t* row0 = reinterpret_cast<const uint16_t*>(srcAddr + (y0 >> 4) * rb);
+    const uint16_t* row1 = reinterpret_cast<const uint16_t*>(srcAddr + (XY & 0x3FFF) * rb);
+    S16_load_filter_SSE2(row0, row1, xy[1], y0 & 0xF, taps, weights);
+}
+
+static inline void S16_D32_filter_DXDY_SSE2(const SkBitmapProcState& s,
+                                            const uint32_t* xy, int count,
+                                            uint32_t* colors,
+                                            unsigned alphaScale) {
+    const char* srcAddr = static_cast<const char*>(s.fBitmap->getPixels());
+    size_t rb = s.fBitmap->rowBytes();
+    __m128i alpha = _mm_set1_epi16(alphaScale);
+
+    while (count >= 2) {
+        __m128i taps0, weights0, taps1, weights1;
+        S16_load_filter_DXDY_SSE2(srcAddr, rb, xy, &taps0, &weights0);
+        S16_load_filter_DXDY_SSE2(srcAddr, rb, xy + 2, &taps1, &weights1);
+
+        __m128i c = S16_filter_SSE2(_mm_unpacklo_epi64(taps0, taps1),
+                                    _mm_unpacklo_epi64(weights0, weights1));
+        if (alphaScale < 256) {
+            c = S16_scale_by_alpha_SSE2(c, alpha);
+        }
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(colors), c);
+
+        xy += 4;
+        colors += 2;
+        count -= 2;
+    }
+
+    if (count > 0) {
+        __m128i taps, weights;
+        S16_load_filter_DXDY_SSE2(srcAddr, rb, xy, &taps, &weights);
+        __m128i c = S16_filter_SSE2(taps, weights);
+        if (alphaScale < 256) {
+            c = S16_scale_by_alpha_SSE2(c, alpha);
+        }
+        *colors = _mm_cvtsi128_si32(c);
+    }
+}
+
+void S16_opaque_D32_filter_DX_SSE2(const SkBitmapProcState& s,
+                                   const uint32_t* xy,
+                                   int count, uint32_t* colors) {
+    SkASSERT(count > 0 && colors != NULL);
+    SkASSERT(s.fDoFilter);
+    SkASSERT(s.fBitmap->config() == SkBitmap::kRGB_565_Config);
+    SkASSERT(s.fAlphaScale == 256);
+
+    S16_D32_filter_DX_SSE2(s, xy, count, colors, 256);
+}
+
+void S16_alpha_D32_filter_DX_SSE2(const SkBitmapProcState& s,
+                                  const uint32_t* xy,
+                                  int count, uint32_t* colors) {
+    SkASSERT(count > 0 && colors != NULL);
+    SkASSERT(s.fDoFilter);
+    SkASSERT(s.fBitmap->config() == SkBitmap::kRGB_565_Config);
+    SkASSERT(s.fAlphaScale < 256);
+
+    S16_D32_filter_DX_SSE2(s, xy, count, colors, s.fAlphaScale);
+}
+
+void S16_opaque_D32_filter_DXDY_SSE2(const SkBitmapProcState& s,
+                                     const uint32_t* xy,
+                                     int count, uint32_t* colors) {
+    SkASSERT(count > 0 && colors != NULL);
+    SkASSERT(s.fDoFilter);
+    SkASSERT(s.fBitmap->config() == SkBitmap::kRGB_565_Config);
+    SkASSERT(s.fAlphaScale == 256);
+
+    S16_D32_filter_DXDY_SSE2(s, xy, count, colors, 256);
+}
+
+void S16_alpha_D32_filter_DXDY_SSE2(const SkBitmapProcState& s,
+                                    const uint32_t* xy,
+                                    int count, uint32_t* colors) {
+    SkASSERT(count > 0 && colors != NULL);
+    SkASSERT(s.fDoFilter);
+    SkASSERT(s.fBitmap->config() == SkBitmap::kRGB_565_Config);
+    SkASSERT(s.fAlphaScale < 256);
+
+    S16_D32_filter_DXDY_SSE2(s, xy, count, colors, s.fAlphaScale);
+}
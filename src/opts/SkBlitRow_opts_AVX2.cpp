@@ -0,0 +1,316 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkBlitRow_opts_AVX2.h"
+#include "SkColorPriv.h"
+#include "SkUtils.h"
+
+#include <immintrin.h>
+
+/* These are the SSE2 procs from SkBlitRow_opts_SSE2.cpp widened to 8 pixels
+ * per iteration. They compute exactly the same results as the SSE2 and the
+ * portable versions (core/SkBlitRow_D32.cpp). The 16-bit shuffles work within
+ * each 128-bit lane, which is all the pixel-at-a-time math needs.
+ *
+ * This file must only be compiled with -mavx2, and its procs must only be
+ * called after checking for AVX2 at runtime (see opts_check_SSE2.cpp).
+ */
+
+/* AVX2 version of S32_Blend_BlitRow32()
+ * portable version is in core/SkBlitRow_D32.cpp
+ */
+void S32_Blend_BlitRow32_AVX2(SkPMColor* SK_RESTRICT dst,
+                              const SkPMColor* SK_RESTRICT src,
+                              int count, U8CPU alpha) {
+    SkASSERT(alpha <= 255);
+    if (count <= 0) {
+        return;
+    }
+
+    uint32_t src_scale = SkAlpha255To256(alpha);
+    uint32_t dst_scale = 256 - src_scale;
+
+    if (count >= 8) {
+        SkASSERT(((size_t)dst & 0x03) == 0);
+        while (((size_t)dst & 0x1F) != 0) {
+            *dst = SkAlphaMulQ(*src, src_scale) + SkAlphaMulQ(*dst, dst_scale);
+            src++;
+            dst++;
+            count--;
+        }
+
+        const __m256i* s = reinterpret_cast<const __m256i*>(src);
+        __m256i* d = reinterpret_cast<__m256i*>(dst);
+        const __m256i rb_mask = _mm256_set1_epi32(0x00FF00FF);
+        const __m256i ag_mask = _mm256_set1_epi32(0xFF00FF00);
+
+        // Move scale factors to upper byte of word
+        const __m256i src_scale_wide = _mm256_set1_epi16(src_scale << 8);
+        const __m256i dst_scale_wide = _mm256_set1_epi16(dst_scale << 8);
+        while (count >= 8) {
+            __m256i src_pixel = _mm256_loadu_si256(s);
+            __m256i dst_pixel = _mm256_load_si256(d);
+
+            // Red and blue in the low byte of each word, scaled; the high byte
+            // of the product lands back in the low byte.
+            __m256i src_rb = _mm256_mulhi_epu16(_mm256_and_si256(rb_mask, src_pixel),
+                                                src_scale_wide);
+            __m256i dst_rb = _mm256_mulhi_epu16(_mm256_and_si256(rb_mask, dst_pixel),
+                                                dst_scale_wide);
+
+            // Alpha and green in the high byte of each word, scaled, keeping
+            // only the high byte of the product.
+            __m256i src_ag = _mm256_mulhi_epu16(_mm256_and_si256(ag_mask, src_pixel),
+                                                src_scale_wide);
+            src_ag = _mm256_and_si256(src_ag, ag_mask);
+            __m256i dst_ag = _mm256_mulhi_epu16(_mm256_and_si256(ag_mask, dst_pixel),
+                                                dst_scale_wide);
+            dst_ag = _mm256_and_si256(dst_ag, ag_mask);
+
+            src_pixel = _mm256_or_si256(src_rb, src_ag);
+            dst_pixel = _mm256_or_si256(dst_rb, dst_ag);
+
+            _mm256_store_si256(d, _mm256_add_epi8(src_pixel, dst_pixel));
+            s++;
+            d++;
+            count -= 8;
+        }
+        src = reinterpret_cast<const SkPMColor*>(s);
+        dst = reinterpret_cast<SkPMColor*>(d);
+    }
+
+    while (count > 0) {
+        *dst = SkAlphaMulQ(*src, src_scale) + SkAlphaMulQ(*dst, dst_scale);
+        src++;
+        dst++;
+        count--;
+    }
+}
+
+void S32A_Opaque_BlitRow32_AVX2(SkPMColor* SK_RESTRICT dst,
+                                const SkPMColor* SK_RESTRICT src,
+                                int count, U8CPU alpha) {
+    SkASSERT(alpha == 255);
+    if (count <= 0) {
+        return;
+    }
+
+    if (count >= 8) {
+        SkASSERT(((size_t)dst & 0x03) == 0);
+        while (((size_t)dst & 0x1F) != 0) {
+            *dst = SkPMSrcOver(*src, *dst);
+            src++;
+            dst++;
+            count--;
+        }
+
+        const __m256i* s = reinterpret_cast<const __m256i*>(src);
+        __m256i* d = reinterpret_cast<__m256i*>(dst);
+        const __m256i rb_mask = _mm256_set1_epi32(0x00FF00FF);
+#ifdef SK_USE_ACCURATE_BLENDING
+        const __m256i c_128 = _mm256_set1_epi16(128);
+        const __m256i c_255 = _mm256_set1_epi16(255);
+#else
+        const __m256i c_256 = _mm256_set1_epi16(0x0100);
+#endif
+        while (count >= 8) {
+            __m256i src_pixel = _mm256_loadu_si256(s);
+
+            // Runs of fully opaque or fully transparent source pixels are
+            // common, and need no math at all.
+            const __m256i src_alpha = _mm256_srli_epi32(src_pixel, 24);
+            const int opaque = _mm256_movemask_epi8(
+                    _mm256_cmpeq_epi32(src_alpha, _mm256_set1_epi32(0xFF)));
+            if (-1 == opaque) {
+                _mm256_store_si256(d, src_pixel);
+            } else if (-1 != _mm256_movemask_epi8(
+                    _mm256_cmpeq_epi32(src_pixel, _mm256_setzero_si256()))) {
+                __m256i dst_pixel = _mm256_load_si256(d);
+                __m256i dst_rb = _mm256_and_si256(rb_mask, dst_pixel);
+                __m256i dst_ag = _mm256_srli_epi16(dst_pixel, 8);
+#ifdef SK_USE_ACCURATE_BLENDING
+                // Copy alpha to the upper word of each pixel, and take it from 255.
+                __m256i alpha = _mm256_or_si256(src_alpha, _mm256_slli_epi32(src_alpha, 16));
+                alpha = _mm256_sub_epi16(c_255, alpha);
+
+                dst_rb = _mm256_mullo_epi16(dst_rb, alpha);
+                dst_ag = _mm256_mullo_epi16(dst_ag, alpha);
+
+                // (x + (x >> 8) + 128) >> 8
+                dst_rb = _mm256_add_epi16(dst_rb, _mm256_srli_epi16(dst_rb, 8));
+                dst_rb = _mm256_srli_epi16(_mm256_add_epi16(dst_rb, c_128), 8);
+                dst_ag = _mm256_add_epi16(dst_ag, _mm256_srli_epi16(dst_ag, 8));
+                dst_ag = _mm256_andnot_si256(rb_mask, _mm256_add_epi16(dst_ag, c_128));
+#else
+                // (a0, g0, a1, g1, ...) -> (a0, a0, a1, a1, ...), taken from 256.
+                __m256i alpha = _mm256_srli_epi16(src_pixel, 8);
+                alpha = _mm256_shufflehi_epi16(alpha, 0xF5);
+                alpha = _mm256_shufflelo_epi16(alpha, 0xF5);
+                alpha = _mm256_sub_epi16(c_256, alpha);
+
+                dst_rb = _mm256_mullo_epi16(dst_rb, alpha);
+                dst_ag = _mm256_mullo_epi16(dst_ag, alpha);
+
+                // Divide by 256.
+                dst_rb = _mm256_srli_epi16(dst_rb, 8);
+                dst_ag = _mm256_andnot_si256(rb_mask, dst_ag);
+#endif
+                dst_pixel = _mm256_or_si256(dst_rb, dst_ag);
+                _mm256_store_si256(d, _mm256_add_epi8(src_pixel, dst_pixel));
+            }
+            s++;
+            d++;
+            count -= 8;
+        }
+        src = reinterpret_cast<const SkPMColor*>(s);
+        dst = reinterpret_cast<SkPMColor*>(d);
+    }
+
+    while (count > 0) {
+        *dst = SkPMSrcOver(*src, *dst);
+        src++;
+        dst++;
+        count--;
+    }
+}
+
+void S32A_Blend_BlitRow32_AVX2(SkPMColor* SK_RESTRICT dst,
+                               const SkPMColor* SK_RESTRICT src,
+                               int count, U8CPU alpha) {
+    SkASSERT(alpha <= 255);
+    if (count <= 0) {
+        return;
+    }
+
+    if (count >= 8) {
+        while (((size_t)dst & 0x1F) != 0) {
+            *dst = SkBlendARGB32(*src, *dst, alpha);
+            src++;
+            dst++;
+            count--;
+        }
+
+        uint32_t src_scale = SkAlpha255To256(alpha);
+
+        const __m256i* s = reinterpret_cast<const __m256i*>(src);
+        __m256i* d = reinterpret_cast<__m256i*>(dst);
+        const __m256i src_scale_wide = _mm256_set1_epi16(src_scale << 8);
+        const __m256i rb_mask = _mm256_set1_epi32(0x00FF00FF);
+        const __m256i c_256 = _mm256_set1_epi16(256);
+        while (count >= 8) {
+            __m256i src_pixel = _mm256_loadu_si256(s);
+            __m256i dst_pixel = _mm256_load_si256(d);
+
+            __m256i dst_rb = _mm256_and_si256(rb_mask, dst_pixel);
+            __m256i src_rb = _mm256_and_si256(rb_mask, src_pixel);
+            __m256i dst_ag = _mm256_srli_epi16(dst_pixel, 8);
+            __m256i src_ag = _mm256_srli_epi16(src_pixel, 8);
+
+            // Per-pixel source alpha in both words of each pixel, scaled by
+            // the global alpha (mulhi leaves it in the low byte), from 256.
+            __m256i dst_alpha = _mm256_shufflehi_epi16(src_ag, 0xF5);
+            dst_alpha = _mm256_shufflelo_epi16(dst_alpha, 0xF5);
+            dst_alpha = _mm256_mulhi_epu16(dst_alpha, src_scale_wide);
+            dst_alpha = _mm256_sub_epi16(c_256, dst_alpha);
+
+            dst_rb = _mm256_mullo_epi16(dst_rb, dst_alpha);
+            dst_ag = _mm256_mullo_epi16(dst_ag, dst_alpha);
+            src_rb = _mm256_mulhi_epu16(src_rb, src_scale_wide);
+            src_ag = _mm256_mulhi_epu16(src_ag, src_scale_wide);
+
+            dst_rb = _mm256_srli_epi16(dst_rb, 8);
+            dst_ag = _mm256_andnot_si256(rb_mask, dst_ag);
+            src_ag = _mm256_slli_epi16(src_ag, 8);
+
+            dst_pixel = _mm256_or_si256(dst_rb, dst_ag);
+            src_pixel = _mm256_or_si256(src_rb, src_ag);
+
+            _mm256_store_si256(d, _mm256_add_epi8(src_pixel, dst_pixel));
+            s++;
+            d++;
+            count -= 8;
+        }
+        src = reinterpret_cast<const SkPMColor*>(s);
+        dst = reinterpret_cast<SkPMColor*>(d);
+    }
+
+    while (count > 0) {
+        *dst = SkBlendARGB32(*src, *dst, alpha);
+        src++;
+        dst++;
+        count--;
+    }
+}
+
+/* AVX2 version of Color32()
+ * portable version is in core/SkBlitRow_D32.cpp
+ */
+void Color32_AVX2(SkPMColor dst[], const SkPMColor src[], int count,
+                  SkPMColor color) {
+    if (count <= 0) {
+        return;
+    }
+
+    if (0 == color) {
+        if (src != dst) {
+            memcpy(dst, src, count * sizeof(SkPMColor));
+        }
+        return;
+    }
+
+    unsigned colorA = SkGetPackedA32(color);
+    if (255 == colorA) {
+        sk_memset32(dst, color, count);
+        return;
+    }
+
+    unsigned scale = 256 - SkAlpha255To256(colorA);
+
+    if (count >= 8) {
+        SkASSERT(((size_t)dst & 0x03) == 0);
+        while (((size_t)dst & 0x1F) != 0) {
+            *dst = color + SkAlphaMulQ(*src, scale);
+            src++;
+            dst++;
+            count--;
+        }
+
+        const __m256i* s = reinterpret_cast<const __m256i*>(src);
+        __m256i* d = reinterpret_cast<__m256i*>(dst);
+        const __m256i rb_mask = _mm256_set1_epi32(0x00FF00FF);
+        const __m256i src_scale_wide = _mm256_set1_epi16(scale);
+        const __m256i color_wide = _mm256_set1_epi32(color);
+        while (count >= 8) {
+            __m256i src_pixel = _mm256_loadu_si256(s);
+
+            __m256i src_rb = _mm256_and_si256(rb_mask, src_pixel);
+            __m256i src_ag = _mm256_srli_epi16(src_pixel, 8);
+
+            src_rb = _mm256_mullo_epi16(src_rb, src_scale_wide);
+            src_ag = _mm256_mullo_epi16(src_ag, src_scale_wide);
+
+            // Divide by 256.
+            src_rb = _mm256_srli_epi16(src_rb, 8);
+            src_ag = _mm256_andnot_si256(rb_mask, src_ag);
+
+            src_pixel = _mm256_or_si256(src_rb, src_ag);
+            _mm256_store_si256(d, _mm256_add_epi8(color_wide, src_pixel));
+            s++;
+            d++;
+            count -= 8;
+        }
+        src = reinterpret_cast<const SkPMColor*>(s);
+        dst = reinterpret_cast<SkPMColor*>(d);
+    }
+
+    while (count > 0) {
+        *dst = color + SkAlphaMulQ(*src, scale);
+        src++;
+        dst++;
+        count--;
+    }
+}
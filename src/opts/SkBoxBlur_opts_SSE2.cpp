@@ -0,0 +1,438 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <emmintrin.h>
+#include <string.h>
+
+#include "SkBoxBlur_opts_SSE2.h"
+#include "SkColor_opts_SSE2.h"
+#include "SkTemplates.h"
+
+/*  The A8 blurs work on tiles of 16 rows. Each tile is transposed into a
+ *  buffer holding one 16-byte vector per column, so that a single running
+ *  sum vector blurs all 16 rows at once, and the sliding window becomes a
+ *  walk over aligned vectors. The blurred tile is then transposed back to
+ *  rows, or, when the pass transposes, written as 16 contiguous bytes of each
+ *  dst column. The 32-bit blur keeps the four channels of a pixel in one
+ *  vector. All of them round exactly like the portable procs in SkBlurMask.cpp.
+ */
+
+#ifndef SK_DISABLE_BLUR_ROUNDING
+static const uint32_t kHalf = 1 << 23;
+#else
+static const uint32_t kHalf = 0;
+#endif
+
+static const int kTileRows = 16;
+
+// count vectors of storage, 16-byte aligned. sk_malloc() only promises the
+// alignment of the largest scalar type, so the buffer is over-allocated and
+// the pointer rounded up.
+class AutoTileStorage_SSE2 : SkNoncopyable {
+public:
+    explicit AutoTileStorage_SSE2(int count) : fStorage(count * sizeof(__m128i) + 15) {
+        uintptr_t addr = (reinterpret_cast<uintptr_t>(fStorage.get()) + 15) & ~(uintptr_t)15;
+        fTile = reinterpret_cast<__m128i*>(addr);
+    }
+
+    __m128i* get() const { return fTile; }
+
+private:
+    SkAutoTMalloc<uint8_t>  fStorage;
+    __m128i*                fTile;
+};
+
+// Transposes the 16x16 bytes held in v[0..15]. Each round moves the high bit
+// of the row index to the low bit of the column index, so four rounds swap
+// rows and columns.
+static void transpose16x16_SSE2(__m128i v[16]) {
+    __m128i t[16];
+    for (int round = 0; round < 4; round += 2) {
+        for (int i = 0; i < 8; ++i) {
+            t[2 * i]     = _mm_unpacklo_epi8(v[i], v[i + 8]);
+            t[2 * i + 1] = _mm_unpackhi_epi8(v[i], v[i + 8]);
+        }
+        for (int i = 0; i < 8; ++i) {
+            v[2 * i]     = _mm_unpacklo_epi8(t[i], t[i + 8]);
+            v[2 * i + 1] = _mm_unpackhi_epi8(t[i], t[i + 8]);
+        }
+    }
+}
+
+// Reads columns [0, width) of rows [0, rows) of src into tile, one vector per
+// column. Lanes for rows past the end are 0.
+static void load_tile_SSE2(const uint8_t* src, int srcRowBytes, int width, int rows,
+                           __m128i* tile) {
+    __m128i v[kTileRows];
+    int x = 0;
+    for (; x + kTileRows <= width; x += kTileRows) {
+        for (int r = 0; r < kTileRows; ++r) {
+            v[r] = r < rows ? _mm_loadu_si128((const __m128i*)(src + r * srcRowBytes + x))
+                            : _mm_setzero_si128();
+        }
+        transpose16x16_SSE2(v);
+        for (int i = 0; i < kTileRows; ++i) {
+            _mm_store_si128(tile + x + i, v[i]);
+        }
+    }
+    for (; x < width; ++x) {
+        uint8_t* column = (uint8_t*)(tile + x);
+        for (int r = 0; r < kTileRows; ++r) {
+            column[r] = r < rows ? src[r * srcRowBytes + x] : 0;
+        }
+    }
+}
+
+// Writes the first rows lanes of tile[0, width) to dst, as rows if transpose
+// is false, or as the start of each of width columns otherwise.
+static void store_tile_SSE2(const __m128i* tile, int width, int rows, uint8_t* dst,
+                            int dstStride, bool transpose) {
+    if (transpose) {
+        for (int x = 0; x < width; ++x) {
+            if (kTileRows == rows) {
+                _mm_storeu_si128((__m128i*)(dst + x * dstStride), tile[x]);
+            } else {
+                memcpy(dst + x * dstStride, tile + x, rows);
+            }
+        }
+        return;
+    }
+
+    __m128i v[kTileRows];
+    int x = 0;
+    for (; x + kTileRows <= width; x += kTileRows) {
+        for (int i = 0; i < kTileRows; ++i) {
+            v[i] = _mm_load_si128(tile + x + i);
+        }
+        transpose16x16_SSE2(v);
+        for (int r = 0; r < rows; ++r) {
+            _mm_storeu_si128((__m128i*)(dst + r * dstStride + x), v[r]);
+        }
+    }
+    for (; x < width; ++x) {
+        const uint8_t* column = (const uint8_t*)(tile + x);
+        for (int r = 0; r < rows; ++r) {
+            dst[r * dstStride + x] = column[r];
+        }
+    }
+}
+
+namespace {
+
+// Sixteen 32-bit running sums, one per row of a tile, for any kernel size.
+struct TileSum32_SSE2 {
+    __m128i f0, f1, f2, f3;
+
+    // The 8.24 scale, in every lane.
+    struct Scale {
+        explicit Scale(uint32_t scale) : fScale(_mm_set1_epi32(scale)) {}
+        __m128i fScale;
+    };
+
+    TileSum32_SSE2() {
+        f0 = f1 = f2 = f3 = _mm_setzero_si128();
+    }
+
+    void add(const __m128i& column) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i lo = _mm_unpacklo_epi8(column, zero);
+        __m128i hi = _mm_unpackhi_epi8(column, zero);
+        f0 = _mm_add_epi32(f0, _mm_unpacklo_epi16(lo, zero));
+        f1 = _mm_add_epi32(f1, _mm_unpackhi_epi16(lo, zero));
+        f2 = _mm_add_epi32(f2, _mm_unpacklo_epi16(hi, zero));
+        f3 = _mm_add_epi32(f3, _mm_unpackhi_epi16(hi, zero));
+    }
+
+    void sub(const __m128i& column) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i lo = _mm_unpacklo_epi8(column, zero);
+        __m128i hi = _mm_unpackhi_epi8(column, zero);
+        f0 = _mm_sub_epi32(f0, _mm_unpacklo_epi16(lo, zero));
+        f1 = _mm_sub_epi32(f1, _mm_unpackhi_epi16(lo, zero));
+        f2 = _mm_sub_epi32(f2, _mm_unpacklo_epi16(hi, zero));
+        f3 = _mm_sub_epi32(f3, _mm_unpackhi_epi16(hi, zero));
+    }
+
+    // (sum * scale + half) >> 24 for each row.
+    static __m128i Blurred(const TileSum32_SSE2& sum, const Scale& scale) {
+        const __m128i half = _mm_set1_epi32(kHalf);
+#define BLUR_LANE(f) \
+        _mm_srli_epi32(_mm_add_epi32(Multiply32_SSE2(sum.f, scale.fScale), half), 24)
+        return pack_bytes_SSE2(BLUR_LANE(f0), BLUR_LANE(f1), BLUR_LANE(f2), BLUR_LANE(f3));
+#undef BLUR_LANE
+    }
+
+    // (outer * outerScale + inner * innerScale + half) >> 24 for each row.
+    static __m128i BlurredInterp(const TileSum32_SSE2& outer, const Scale& outerScale,
+                                 const TileSum32_SSE2& inner, const Scale& innerScale) {
+        const __m128i half = _mm_set1_epi32(kHalf);
+#define BLUR_LANE(f) \
+        _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(Multiply32_SSE2(outer.f, outerScale.fScale), \
+                                                   Multiply32_SSE2(inner.f, innerScale.fScale)), \
+                                     half), 24)
+        return pack_bytes_SSE2(BLUR_LANE(f0), BLUR_LANE(f1), BLUR_LANE(f2), BLUR_LANE(f3));
+#undef BLUR_LANE
+    }
+
+    // Each uint32 lane fits in a byte, so the saturating packs just narrow.
+    static __m128i pack_bytes_SSE2(const __m128i& a, const __m128i& b,
+                                   const __m128i& c, const __m128i& d) {
+        return _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+    }
+};
+
+/*  Sixteen 16-bit running sums, for kernels of at most kMaxKernelSize pixels,
+ *  whose sums always fit. Splitting the 8.24 scale into its high and low 16
+ *  bits, sum * scale + half is
+ *      (sum * scaleHi + mulhi(sum, scaleLo) + (half >> 16)) << 16
+ *  plus a low part below 1 << 16 that cannot carry into bit 24. The result
+ *  is at most 255, so every term above already fits in 16 bits.
+ */
+struct TileSum16_SSE2 {
+    __m128i f0, f1;
+
+    enum {
+        kMaxKernelSize = 0xFFFF / 255
+    };
+
+    struct Scale {
+        explicit Scale(uint32_t scale)
+            : fHi(_mm_set1_epi16(scale >> 16))
+            , fLo(_mm_set1_epi16((short)(scale & 0xFFFF))) {}
+        __m128i fHi, fLo;
+    };
+
+    TileSum16_SSE2() {
+        f0 = f1 = _mm_setzero_si128();
+    }
+
+    void add(const __m128i& column) {
+        const __m128i zero = _mm_setzero_si128();
+        f0 = _mm_add_epi16(f0, _mm_unpacklo_epi8(column, zero));
+        f1 = _mm_add_epi16(f1, _mm_unpackhi_epi8(column, zero));
+    }
+
+    void sub(const __m128i& column) {
+        const __m128i zero = _mm_setzero_si128();
+        f0 = _mm_sub_epi16(f0, _mm_unpacklo_epi8(column, zero));
+        f1 = _mm_sub_epi16(f1, _mm_unpackhi_epi8(column, zero));
+    }
+
+    // (sum * scale + half) >> 24, as (sum * scale + half) >> 16 >> 8.
+    static __m128i Blurred(const TileSum16_SSE2& sum, const Scale& scale) {
+        const __m128i half = _mm_set1_epi16(kHalf >> 16);
+#define BLUR_LANE(f) \
+        _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(sum.f, scale.fHi), \
+                                                   _mm_mulhi_epu16(sum.f, scale.fLo)), \
+                                     half), 8)
+        return _mm_packus_epi16(BLUR_LANE(f0), BLUR_LANE(f1));
+#undef BLUR_LANE
+    }
+
+    // (outer * outerScale + inner * innerScale + half) >> 24. Here the two
+    // low parts can carry into bit 16, so the carry is added back in.
+    static __m128i BlurredInterp(const TileSum16_SSE2& outer, const Scale& outerScale,
+                                 const TileSum16_SSE2& inner, const Scale& innerScale) {
+        return _mm_packus_epi16(BlendLane(outer.f0, outerScale, inner.f0, innerScale),
+                                BlendLane(outer.f1, outerScale, inner.f1, innerScale));
+    }
+
+    static __m128i BlendLane(const __m128i& outer, const Scale& outerScale,
+                             const __m128i& inner, const Scale& innerScale) {
+        __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(outer, outerScale.fHi),
+                                                 _mm_mulhi_epu16(outer, outerScale.fLo)),
+                                   _mm_add_epi16(_mm_mullo_epi16(inner, innerScale.fHi),
+                                                 _mm_mulhi_epu16(inner, innerScale.fLo)));
+        // a + b overflows 16 bits exactly when a > ~b, compared unsigned.
+        __m128i a = _mm_mullo_epi16(outer, outerScale.fLo);
+        __m128i b = _mm_mullo_epi16(inner, innerScale.fLo);
+        __m128i carry = _mm_cmpgt_epi16(_mm_xor_si128(a, _mm_set1_epi16((short)0x8000)),
+                                        _mm_xor_si128(b, _mm_set1_epi16(0x7FFF)));
+        hi = _mm_sub_epi16(hi, carry);
+        return _mm_srli_epi16(_mm_add_epi16(hi, _mm_set1_epi16(kHalf >> 16)), 8);
+    }
+};
+
+}  // namespace
+
+// Follows boxBlur() in SkBlurMask.cpp, for the 16 rows of a tile at once.
+template <typename TileSum>
+static void box_blur_tile_SSE2(const __m128i* tile, __m128i* out, int leftRadius,
+                               int rightRadius, int width) {
+    int diameter = leftRadius + rightRadius;
+    int kernelSize = diameter + 1;
+    int border = SkMin32(width, diameter);
+    const typename TileSum::Scale scale((1 << 24) / kernelSize);
+    const __m128i* right = tile;
+    const __m128i* left = tile;
+    TileSum sum;
+
+    for (int x = 0; x < rightRadius - leftRadius; ++x) {
+        *out++ = _mm_setzero_si128();
+    }
+    for (int x = 0; x < border; ++x) {
+        sum.add(*right++);
+        *out++ = TileSum::Blurred(sum, scale);
+    }
+    if (width < diameter) {
+        __m128i blurred = TileSum::Blurred(sum, scale);
+        for (int x = width; x < diameter; ++x) {
+            *out++ = blurred;
+        }
+    }
+    for (int x = diameter; x < width; ++x) {
+        sum.add(*right++);
+        *out++ = TileSum::Blurred(sum, scale);
+        sum.sub(*left++);
+    }
+    for (int x = 0; x < border; ++x) {
+        *out++ = TileSum::Blurred(sum, scale);
+        sum.sub(*left++);
+    }
+    for (int x = 0; x < leftRadius - rightRadius; ++x) {
+        *out++ = _mm_setzero_si128();
+    }
+}
+
+// Follows boxBlurInterp() in SkBlurMask.cpp, for the 16 rows of a tile at once.
+template <typename TileSum>
+static void box_blur_interp_tile_SSE2(const __m128i* tile, __m128i* out, int radius,
+                                      int width, uint8_t outerWeight) {
+    int diameter = radius * 2;
+    int kernelSize = diameter + 1;
+    int border = SkMin32(width, diameter);
+    int innerWeight = 255 - outerWeight;
+    outerWeight += outerWeight >> 7;
+    innerWeight += innerWeight >> 7;
+    const typename TileSum::Scale outerScale((outerWeight << 16) / kernelSize);
+    const typename TileSum::Scale innerScale((innerWeight << 16) / (kernelSize - 2));
+    const __m128i* right = tile;
+    const __m128i* left = tile;
+    TileSum outer, inner;
+
+    for (int x = 0; x < border; ++x) {
+        inner = outer;
+        outer.add(*right++);
+        *out++ = TileSum::BlurredInterp(outer, outerScale, inner, innerScale);
+    }
+    if (width < diameter) {
+        __m128i blurred = TileSum::BlurredInterp(outer, outerScale, inner, innerScale);
+        for (int x = width; x < diameter; ++x) {
+            *out++ = blurred;
+        }
+    }
+    for (int x = diameter; x < width; ++x) {
+        inner = outer;
+        inner.sub(*left);
+        outer.add(*right++);
+        *out++ = TileSum::BlurredInterp(outer, outerScale, inner, innerScale);
+        outer.sub(*left++);
+    }
+    for (int x = 0; x < border; ++x) {
+        inner = outer;
+        inner.sub(*left++);
+        *out++ = TileSum::BlurredInterp(outer, outerScale, inner, innerScale);
+        outer = inner;
+    }
+}
+
+static void box_blur_A8_SSE2(const uint8_t* src, int srcRowBytes, uint8_t* dst,
+                             int leftRadius, int rightRadius, int width, int height,
+                             bool transpose, int startY, int stopY) {
+    int newWidth = width + SkMax32(leftRadius, rightRadius) * 2;
+    bool narrowSums = leftRadius + rightRadius + 1 <= TileSum16_SSE2::kMaxKernelSize;
+    AutoTileStorage_SSE2 tile(width);
+    AutoTileStorage_SSE2 out(newWidth);
+    for (int y = startY; y < stopY; y += kTileRows) {
+        int rows = SkMin32(kTileRows, stopY - y);
+        load_tile_SSE2(src + y * srcRowBytes, srcRowBytes, width, rows, tile.get());
+        if (narrowSums) {
+            box_blur_tile_SSE2<TileSum16_SSE2>(tile.get(), out.get(), leftRadius, rightRadius,
+                                               width);
+        } else {
+            box_blur_tile_SSE2<TileSum32_SSE2>(tile.get(), out.get(), leftRadius, rightRadius,
+                                               width);
+        }
+        if (transpose) {
+            store_tile_SSE2(out.get(), newWidth, rows, dst + y, height, true);
+        } else {
+            store_tile_SSE2(out.get(), newWidth, rows, dst + y * newWidth, newWidth, false);
+        }
+    }
+}
+
+static void box_blur_interp_A8_SSE2(const uint8_t* src, int srcRowBytes, uint8_t* dst,
+                                    int radius, int width, int height, bool transpose,
+                                    uint8_t outerWeight, int startY, int stopY) {
+    int newWidth = width + radius * 2;
+    bool narrowSums = radius * 2 + 1 <= TileSum16_SSE2::kMaxKernelSize;
+    AutoTileStorage_SSE2 tile(width);
+    AutoTileStorage_SSE2 out(newWidth);
+    for (int y = startY; y < stopY; y += kTileRows) {
+        int rows = SkMin32(kTileRows, stopY - y);
+        load_tile_SSE2(src + y * srcRowBytes, srcRowBytes, width, rows, tile.get());
+        if (narrowSums) {
+            box_blur_interp_tile_SSE2<TileSum16_SSE2>(tile.get(), out.get(), radius, width,
+                                                      outerWeight);
+        } else {
+            box_blur_interp_tile_SSE2<TileSum32_SSE2>(tile.get(), out.get(), radius, width,
+                                                      outerWeight);
+        }
+        if (transpose) {
+            store_tile_SSE2(out.get(), newWidth, rows, dst + y, height, true);
+        } else {
+            store_tile_SSE2(out.get(), newWidth, rows, dst + y * newWidth, newWidth, false);
+        }
+    }
+}
+
+// The four bytes of c, one per 32-bit lane, in memory order.
+static inline __m128i unpack_pixel_SSE2(SkPMColor c) {
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(c), zero), zero);
+}
+
+static void box_blur_32_SSE2(const SkPMColor* src, int srcRowPixels, SkPMColor* dst,
+                             int dstRowPixels, int kernelSize, int leftOffset,
+                             int rightOffset, int width, int height, bool transpose,
+                             int startY, int stopY) {
+    int rightBorder = SkMin32(rightOffset + 1, width);
+    int dstXStride = transpose ? dstRowPixels : 1;
+    int dstYStride = transpose ? 1 : dstRowPixels;
+    const __m128i scale = _mm_set1_epi32((1 << 24) / kernelSize);
+    const __m128i half = _mm_set1_epi32(kHalf);
+    for (int y = startY; y < stopY; ++y) {
+        __m128i sum = _mm_setzero_si128();
+        const SkPMColor* p = src + y * srcRowPixels;
+        for (int i = 0; i < rightBorder; ++i) {
+            sum = _mm_add_epi32(sum, unpack_pixel_SSE2(*p++));
+        }
+
+        const SkPMColor* sptr = src + y * srcRowPixels;
+        SkPMColor* dptr = dst + y * dstYStride;
+        for (int x = 0; x < width; ++x) {
+            __m128i result = _mm_srli_epi32(_mm_add_epi32(Multiply32_SSE2(sum, scale), half), 24);
+            result = _mm_packs_epi32(result, result);
+            *dptr = _mm_cvtsi128_si32(_mm_packus_epi16(result, result));
+            if (x >= leftOffset) {
+                sum = _mm_sub_epi32(sum, unpack_pixel_SSE2(*(sptr - leftOffset)));
+            }
+            if (x + rightOffset + 1 < width) {
+                sum = _mm_add_epi32(sum, unpack_pixel_SSE2(*(sptr + rightOffset + 1)));
+            }
+            sptr++;
+            dptr += dstXStride;
+        }
+    }
+}
+
+bool SkBoxBlurGetPlatformProcs_SSE2(SkBoxBlurProcs* procs) {
+    procs->fA8 = box_blur_A8_SSE2;
+    procs->fInterpA8 = box_blur_interp_A8_SSE2;
+    procs->f32 = box_blur_32_SSE2;
+    return true;
+}
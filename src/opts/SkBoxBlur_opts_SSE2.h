@@ -0,0 +1,15 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkBoxBlur_opts_SSE2_DEFINED
+#define SkBoxBlur_opts_SSE2_DEFINED
+
+#include "SkBoxBlurProcs.h"
+
+bool SkBoxBlurGetPlatformProcs_SSE2(SkBoxBlurProcs* procs);
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkColor_opts_SSE2_DEFINED
+#define SkColor_opts_SSE2_DEFINED
+
+#include <emmintrin.h>
+
+#include "SkColorPriv.h"
+
+/*  SSE2 counterparts of the SkColorPriv helpers. Each 32-bit lane holds one
+ *  pixel (or one component of one pixel), and every function gives exactly
+ *  the result of its scalar namesake for each lane.
+ */
+
+static inline __m128i SkGetPackedA32_SSE2(const __m128i& src) {
+    return _mm_srli_epi32(_mm_slli_epi32(src, 24 - SK_A32_SHIFT), 24);
+}
+
+static inline __m128i SkGetPackedR32_SSE2(const __m128i& src) {
+    return _mm_srli_epi32(_mm_slli_epi32(src, 24 - SK_R32_SHIFT), 24);
+}
+
+static inline __m128i SkGetPackedG32_SSE2(const __m128i& src) {
+    return _mm_srli_epi32(_mm_slli_epi32(src, 24 - SK_G32_SHIFT), 24);
+}
+
+static inline __m128i SkGetPackedB32_SSE2(const __m128i& src) {
+    return _mm_srli_epi32(_mm_slli_epi32(src, 24 - SK_B32_SHIFT), 24);
+}
+
+static inline __m128i SkPackARGB32_SSE2(const __m128i& a, const __m128i& r,
+                                        const __m128i& g, const __m128i& b) {
+    return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(a, SK_A32_SHIFT),
+                                     _mm_slli_epi32(r, SK_R32_SHIFT)),
+                        _mm_or_si128(_mm_slli_epi32(g, SK_G32_SHIFT),
+                                     _mm_slli_epi32(b, SK_B32_SHIFT)));
+}
+
+// Low 32 bits of the product of each lane, like _mm_mullo_epi32 in SSE4.1.
+static inline __m128i Multiply32_SSE2(const __m128i& a, const __m128i& b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Product of lanes holding 0..255, which always fits in the low 16 bits.
+static inline __m128i SkMulU8_SSE2(const __m128i& a, const __m128i& b) {
+    return _mm_mullo_epi16(a, b);
+}
+
+static inline __m128i SkDiv255Round_SSE2(const __m128i& prod) {
+    __m128i tmp = _mm_add_epi32(prod, _mm_set1_epi32(128));
+    return _mm_srli_epi32(_mm_add_epi32(tmp, _mm_srli_epi32(tmp, 8)), 8);
+}
+
+static inline __m128i SkAlphaMulAlpha_SSE2(const __m128i& a, const __m128i& b) {
+    return SkDiv255Round_SSE2(SkMulU8_SSE2(a, b));
+}
+
+static inline __m128i SkAlpha255To256_SSE2(const __m128i& alpha) {
+    return _mm_add_epi32(alpha, _mm_set1_epi32(1));
+}
+
+// Like SkAlphaMulQ(), with the 0..256 scale of each pixel in its lane.
+static inline __m128i SkAlphaMulQ_SSE2(const __m128i& c, const __m128i& scale) {
+    const __m128i mask = _mm_set1_epi32(0x00FF00FF);
+    // Put the scale in both 16-bit halves of each lane.
+    __m128i s = _mm_or_si128(_mm_slli_epi32(scale, 16), scale);
+
+    __m128i rb = _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(mask, c), s), 8);
+    __m128i ag = _mm_mullo_epi16(_mm_srli_epi16(c, 8), s);
+    return _mm_or_si128(_mm_and_si128(rb, mask), _mm_andnot_si128(mask, ag));
+}
+
+// Like SkFourByteInterp256(), with the 0..256 scale of each pixel in its lane.
+static inline __m128i SkFourByteInterp256_SSE2(const __m128i& src, const __m128i& dst,
+                                               const __m128i& scale) {
+    const __m128i mask = _mm_set1_epi32(0x00FF00FF);
+    __m128i s = _mm_or_si128(_mm_slli_epi32(scale, 16), scale);
+    __m128i ds = _mm_sub_epi16(_mm_set1_epi16(256), s);
+
+    // dst + ((src - dst) * s >> 8) == (src * s + dst * (256 - s)) >> 8, and the
+    // latter never leaves the unsigned 16-bit range.
+    __m128i rb = _mm_add_epi16(_mm_mullo_epi16(_mm_and_si128(mask, src), s),
+                               _mm_mullo_epi16(_mm_and_si128(mask, dst), ds));
+    __m128i ag = _mm_add_epi16(_mm_mullo_epi16(_mm_srli_epi16(src, 8), s),
+                               _mm_mullo_epi16(_mm_srli_epi16(dst, 8), ds));
+    return _mm_or_si128(_mm_srli_epi16(rb, 8), _mm_andnot_si128(mask, ag));
+}
+
+static inline __m128i SkPixel16ToPixel32_SSE2(const __m128i& src) {
+    __m128i r = _mm_and_si128(_mm_srli_epi32(src, SK_R16_SHIFT), _mm_set1_epi32(SK_R16_MASK));
+    __m128i g = _mm_and_si128(_mm_srli_epi32(src, SK_G16_SHIFT), _mm_set1_epi32(SK_G16_MASK));
+    __m128i b = _mm_and_si128(_mm_srli_epi32(src, SK_B16_SHIFT), _mm_set1_epi32(SK_B16_MASK));
+
+    r = _mm_or_si128(_mm_slli_epi32(r, 8 - SK_R16_BITS), _mm_srli_epi32(r, 2 * SK_R16_BITS - 8));
+    g = _mm_or_si128(_mm_slli_epi32(g, 8 - SK_G16_BITS), _mm_srli_epi32(g, 2 * SK_G16_BITS - 8));
+    b = _mm_or_si128(_mm_slli_epi32(b, 8 - SK_B16_BITS), _mm_srli_epi32(b, 2 * SK_B16_BITS - 8));
+
+    return SkPackARGB32_SSE2(_mm_set1_epi32(0xFF), r, g, b);
+}
+
+static inline __m128i SkPixel32ToPixel16_SSE2(const __m128i& src) {
+    __m128i r = _mm_and_si128(_mm_srli_epi32(src, SK_R32_SHIFT + (8 - SK_R16_BITS)),
+                              _mm_set1_epi32(SK_R16_MASK));
+    __m128i g = _mm_and_si128(_mm_srli_epi32(src, SK_G32_SHIFT + (8 - SK_G16_BITS)),
+                              _mm_set1_epi32(SK_G16_MASK));
+    __m128i b = _mm_and_si128(_mm_srli_epi32(src, SK_B32_SHIFT + (8 - SK_B16_BITS)),
+                              _mm_set1_epi32(SK_B16_MASK));
+    return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, SK_R16_SHIFT),
+                                     _mm_slli_epi32(g, SK_G16_SHIFT)),
+                        _mm_slli_epi32(b, SK_B16_SHIFT));
+}
+
+#endif
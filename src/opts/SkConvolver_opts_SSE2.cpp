@@ -0,0 +1,147 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <emmintrin.h>
+
+#include "SkConvolver_opts_SSE2.h"
+
+/*  Both passes widen channels to 16 bits and interleave two input pixels, so
+ *  that _mm_madd_epi16 multiplies each channel of both by their weights and
+ *  adds the products into one 32-bit sum per channel. The horizontal pass
+ *  pairs neighbouring pixels of a row; the vertical pass pairs the same pixel
+ *  of two rows, and does four output pixels at a time. Sums are exact, so the
+ *  results match the portable procs in SkConvolver.cpp.
+ */
+
+typedef SkConvolutionFilter1D::ConvolutionFixed ConvolutionFixed;
+
+static const int kHalf = 1 << (SkConvolutionFilter1D::kShiftBits - 1);
+
+static inline __m128i weight_pair(ConvolutionFixed w0, ConvolutionFixed w1) {
+    return _mm_set1_epi32((uint16_t)w0 | ((uint32_t)(uint16_t)w1 << 16));
+}
+
+// Sums the channels of the two pixels held as 16-bit channels in widened,
+// weighted by weights.
+static inline __m128i madd_neighbours(__m128i widened, __m128i weights) {
+    __m128i paired = _mm_unpacklo_epi16(widened, _mm_srli_si128(widened, 8));
+    return _mm_madd_epi16(paired, weights);
+}
+
+// Rounds and clamps the four 32-bit channel sums in sums to bytes, in the
+// low 32 bits.
+static inline __m128i pack_sums(__m128i sums) {
+    sums = _mm_srai_epi32(_mm_add_epi32(sums, _mm_set1_epi32(kHalf)),
+                          SkConvolutionFilter1D::kShiftBits);
+    sums = _mm_packs_epi32(sums, sums);
+    return _mm_packus_epi16(sums, sums);
+}
+
+static void convolve_horizontally_SSE2(const SkPMColor* src, const SkConvolutionFilter1D& filter,
+                                       SkPMColor* dst) {
+    const __m128i zero = _mm_setzero_si128();
+    for (int x = 0; x < filter.numValues(); ++x) {
+        int offset, length;
+        const ConvolutionFixed* weights = filter.filterAt(x, &offset, &length);
+        const SkPMColor* row = src + offset;
+
+        __m128i sums = zero;
+        int i = 0;
+        for (; i + 4 <= length; i += 4) {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+            sums = _mm_add_epi32(sums, madd_neighbours(_mm_unpacklo_epi8(pixels, zero),
+                                                       weight_pair(weights[i], weights[i + 1])));
+            sums = _mm_add_epi32(sums, madd_neighbours(_mm_unpackhi_epi8(pixels, zero),
+                                                       weight_pair(weights[i + 2],
+                                                                   weights[i + 3])));
+        }
+        if (i + 2 <= length) {
+            __m128i pixels = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + i));
+            sums = _mm_add_epi32(sums, madd_neighbours(_mm_unpacklo_epi8(pixels, zero),
+                                                       weight_pair(weights[i], weights[i + 1])));
+            i += 2;
+        }
+        if (i < length) {
+            __m128i pixel = _mm_unpacklo_epi8(_mm_cvtsi32_si128(row[i]), zero);
+            sums = _mm_add_epi32(sums, _mm_madd_epi16(_mm_unpacklo_epi16(pixel, zero),
+                                                      weight_pair(weights[i], 0)));
+        }
+        dst[x] = _mm_cvtsi128_si32(pack_sums(sums));
+    }
+}
+
+// Clamps the color channels of the pixels in pixels to their alpha.
+static inline __m128i clamp_to_alpha(__m128i pixels) {
+    __m128i alpha = _mm_and_si128(_mm_srli_epi32(pixels, SK_A32_SHIFT), _mm_set1_epi32(0xFF));
+    alpha = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 8));
+    alpha = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 16));
+    return _mm_min_epu8(pixels, alpha);
+}
+
+static void convolve_vertically_SSE2(const ConvolutionFixed weights[], int length,
+                                     const SkPMColor* const rows[], int width, SkPMColor* dst) {
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i sums0 = zero, sums1 = zero, sums2 = zero, sums3 = zero;
+        for (int i = 0; i < length; i += 2) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[i] + x));
+            __m128i b;
+            __m128i w;
+            if (i + 1 < length) {
+                b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[i + 1] + x));
+                w = weight_pair(weights[i], weights[i + 1]);
+            } else {
+                b = zero;
+                w = weight_pair(weights[i], 0);
+            }
+            __m128i aLo = _mm_unpacklo_epi8(a, zero);
+            __m128i bLo = _mm_unpacklo_epi8(b, zero);
+            __m128i aHi = _mm_unpackhi_epi8(a, zero);
+            __m128i bHi = _mm_unpackhi_epi8(b, zero);
+            sums0 = _mm_add_epi32(sums0, _mm_madd_epi16(_mm_unpacklo_epi16(aLo, bLo), w));
+            sums1 = _mm_add_epi32(sums1, _mm_madd_epi16(_mm_unpackhi_epi16(aLo, bLo), w));
+            sums2 = _mm_add_epi32(sums2, _mm_madd_epi16(_mm_unpacklo_epi16(aHi, bHi), w));
+            sums3 = _mm_add_epi32(sums3, _mm_madd_epi16(_mm_unpackhi_epi16(aHi, bHi), w));
+        }
+        const __m128i half = _mm_set1_epi32(kHalf);
+        const int shift = SkConvolutionFilter1D::kShiftBits;
+        sums0 = _mm_srai_epi32(_mm_add_epi32(sums0, half), shift);
+        sums1 = _mm_srai_epi32(_mm_add_epi32(sums1, half), shift);
+        sums2 = _mm_srai_epi32(_mm_add_epi32(sums2, half), shift);
+        sums3 = _mm_srai_epi32(_mm_add_epi32(sums3, half), shift);
+        __m128i pixels = _mm_packus_epi16(_mm_packs_epi32(sums0, sums1),
+                                          _mm_packs_epi32(sums2, sums3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), clamp_to_alpha(pixels));
+    }
+
+    for (; x < width; ++x) {
+        __m128i sums = zero;
+        for (int i = 0; i < length; i += 2) {
+            __m128i a = _mm_cvtsi32_si128(rows[i][x]);
+            __m128i b;
+            __m128i w;
+            if (i + 1 < length) {
+                b = _mm_cvtsi32_si128(rows[i + 1][x]);
+                w = weight_pair(weights[i], weights[i + 1]);
+            } else {
+                b = zero;
+                w = weight_pair(weights[i], 0);
+            }
+            __m128i paired = _mm_unpacklo_epi16(_mm_unpacklo_epi8(a, zero),
+                                                _mm_unpacklo_epi8(b, zero));
+            sums = _mm_add_epi32(sums, _mm_madd_epi16(paired, w));
+        }
+        dst[x] = _mm_cvtsi128_si32(clamp_to_alpha(pack_sums(sums)));
+    }
+}
+
+bool SkConvolutionGetPlatformProcs_SSE2(SkConvolutionProcs* procs) {
+    procs->fConvolveHorizontally = convolve_horizontally_SSE2;
+    procs->fConvolveVertically = convolve_vertically_SSE2;
+    return true;
+}
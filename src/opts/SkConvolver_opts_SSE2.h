@@ -0,0 +1,15 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkConvolver_opts_SSE2_DEFINED
+#define SkConvolver_opts_SSE2_DEFINED
+
+#include "SkConvolver.h"
+
+bool SkConvolutionGetPlatformProcs_SSE2(SkConvolutionProcs* procs);
+
+#endif
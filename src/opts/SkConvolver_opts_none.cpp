@@ -0,0 +1,13 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkConvolver.h"
+
+// The portable procs in SkConvolver.cpp are all we have.
+bool SkConvolutionGetPlatformProcs(SkConvolutionProcs* procs) {
+    return false;
+}
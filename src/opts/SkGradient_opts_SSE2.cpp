@@ -0,0 +1,217 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <emmintrin.h>
+
+#include "SkGradient_opts_SSE2.h"
+
+/*  Each proc computes the cache indices of four pixels at a time, and then
+ *  looks them up one by one, since SSE2 has no gather. Positions that the
+ *  portable procs step in floating point are accumulated one pixel at a time
+ *  here too, so that every lane sees exactly the value the portable loop
+ *  would have; only the math that follows is done four wide. A last partial
+ *  group computes all four lanes and stores count of them.
+ */
+
+static const int kDitherStride = 256;
+
+// The dither rows read by four consecutive pixels, the first on toggle.
+static inline __m128i toggles_SSE2(int toggle) {
+    int next = toggle ^ kDitherStride;
+    return _mm_setr_epi32(toggle, next, toggle, next);
+}
+
+// Writes the first count (at most four) of the cache colors indexed by index.
+static inline void lookup_SSE2(__m128i index, SkPMColor* dst, const SkPMColor* cache,
+                               int count) {
+    if (count >= 4) {
+        dst[0] = cache[_mm_cvtsi128_si32(index)];
+        dst[1] = cache[_mm_cvtsi128_si32(_mm_shuffle_epi32(index, 0x55))];
+        dst[2] = cache[_mm_cvtsi128_si32(_mm_shuffle_epi32(index, 0xAA))];
+        dst[3] = cache[_mm_cvtsi128_si32(_mm_shuffle_epi32(index, 0xFF))];
+        return;
+    }
+    int32_t i[4];
+    _mm_storeu_si128((__m128i*)i, index);
+    switch (count) {
+        case 3: dst[2] = cache[i[2]];
+        case 2: dst[1] = cache[i[1]];
+        case 1: dst[0] = cache[i[0]];
+    }
+}
+
+// Same, but writes 0 where skip is set.
+static inline void lookup_or_skip_SSE2(__m128i index, __m128i skip, SkPMColor* dst,
+                                       const SkPMColor* cache, int count) {
+    int32_t i[4], s[4];
+    _mm_storeu_si128((__m128i*)i, index);
+    _mm_storeu_si128((__m128i*)s, skip);
+    for (int n = 0; n < count && n < 4; ++n) {
+        dst[n] = s[n] ? 0 : cache[i[n]];
+    }
+}
+
+static inline __m128i select_SSE2(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline __m128 select_SSE2(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+enum Tile {
+    kClamp_Tile,
+    kRepeat_Tile,
+    kMirror_Tile,
+};
+
+// SkClampMax(x, 0xFFFF), repeat_tileproc() or mirror_tileproc().
+template <Tile tile>
+static inline __m128i tile_SSE2(__m128i x) {
+    const __m128i max = _mm_set1_epi32(0xFFFF);
+    if (kClamp_Tile == tile) {
+        x = _mm_andnot_si128(_mm_srai_epi32(x, 31), x);
+        return select_SSE2(_mm_cmpgt_epi32(x, max), max, x);
+    }
+    if (kMirror_Tile == tile) {
+        x = _mm_xor_si128(x, _mm_srai_epi32(_mm_slli_epi32(x, 15), 31));
+    }
+    return _mm_and_si128(x, max);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Linear
+
+// fx, fx + dx, fx + 2 * dx and fx + 3 * dx, wrapping like the portable loops.
+static inline __m128i linear_steps_SSE2(SkFixed fx, SkFixed dx) {
+    __m128i odd = _mm_setr_epi32(0, dx, 0, dx);
+    __m128i high = _mm_setr_epi32(0, 0, dx, dx);
+    return _mm_add_epi32(_mm_add_epi32(_mm_set1_epi32(fx), odd), _mm_add_epi32(high, high));
+}
+
+// Only mirror is here: the portable clamp and repeat loops cost about as much
+// per pixel as the lookups alone.
+static void linear_mirror_SSE2(SkFixed dx, SkFixed fx, SkPMColor dst[],
+                               const SkPMColor cache[], int toggle, int count) {
+    const __m128i toggles = toggles_SSE2(toggle);
+    const __m128i step = _mm_slli_epi32(_mm_set1_epi32(dx), 2);
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    __m128i x = linear_steps_SSE2(fx, dx);
+    for (; count > 0; count -= 4) {
+        __m128i fi = _mm_srai_epi32(x, 8);
+        __m128i s = _mm_srai_epi32(_mm_slli_epi32(fi, 23), 31);
+        fi = _mm_and_si128(_mm_xor_si128(fi, s), mask);
+        lookup_SSE2(_mm_add_epi32(fi, toggles), dst, cache, count);
+        x = _mm_add_epi32(x, step);
+        dst += 4;
+    }
+}
+
+#ifdef SK_SCALAR_IS_FLOAT
+
+///////////////////////////////////////////////////////////////////////////////
+// Radial and sweep
+
+// Four consecutive positions, starting at *v and stepping by d. Leaves *v at
+// the fifth.
+static inline __m128 accumulate_SSE2(float* v, float d) {
+    float v0 = *v;
+    float v1 = v0 + d;
+    float v2 = v1 + d;
+    float v3 = v2 + d;
+    *v = v3 + d;
+    return _mm_setr_ps(v0, v1, v2, v3);
+}
+
+// Mirror only: the portable clamp proc looks the distance up in a table,
+// which is cheaper than the square roots, and the portable repeat proc takes
+// them in fixed point, which this does not match.
+template <Tile tile>
+static void radial_SSE2(SkScalar fx, SkScalar dx, SkScalar fy, SkScalar dy,
+                        SkPMColor dst[], const SkPMColor cache[], int count, int toggle) {
+    const __m128i toggles = toggles_SSE2(toggle);
+    const __m128 fixed1 = _mm_set1_ps(SK_Fixed1);
+    for (; count > 0; count -= 4) {
+        __m128 x = accumulate_SSE2(&fx, dx);
+        __m128 y = accumulate_SSE2(&fy, dy);
+        __m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+        __m128i fi = tile_SSE2<tile>(_mm_cvttps_epi32(_mm_mul_ps(dist, fixed1)));
+        lookup_SSE2(_mm_add_epi32(_mm_srli_epi32(fi, 8), toggles), dst, cache, count);
+        dst += 4;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Two point conical
+
+// next_t() in SkTwoPointConicalGradient.cpp for four pixels; lanes the cone
+// does not reach are kDontDrawT.
+static inline __m128i conical_t_SSE2(SkTwoPointConicalSpan* rec) {
+    const __m128 zero = _mm_setzero_ps();
+    __m128 relX = accumulate_SSE2(&rec->fRelX, rec->fIncX);
+    __m128 relY = accumulate_SSE2(&rec->fRelY, rec->fIncY);
+    __m128 b = accumulate_SSE2(&rec->fB, rec->fDB);
+    __m128 c = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(relX, relX), _mm_mul_ps(relY, relY)),
+                          _mm_set1_ps(rec->fRadius2));
+
+    __m128 valid, lo, hi;
+    if (0 == rec->fA) {
+        valid = _mm_cmpneq_ps(b, zero);
+        lo = hi = _mm_div_ps(_mm_xor_ps(c, _mm_set1_ps(-0.0f)), b);
+    } else {
+        const __m128 a = _mm_set1_ps(rec->fA);
+        __m128 disc = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(_mm_set1_ps(4 * rec->fA), c));
+        valid = _mm_cmpnlt_ps(disc, zero);
+        __m128 r = _mm_sqrt_ps(disc);
+        __m128 q = select_SSE2(_mm_cmplt_ps(b, zero), _mm_sub_ps(b, r), _mm_add_ps(b, r));
+        q = _mm_mul_ps(q, _mm_set1_ps(-0.5f));
+        __m128 r0 = _mm_div_ps(q, a);
+        __m128 r1 = _mm_div_ps(c, q);
+        __m128 qIsZero = _mm_cmpeq_ps(q, zero);
+        lo = _mm_andnot_ps(qIsZero, _mm_min_ps(r0, r1));
+        hi = _mm_andnot_ps(qIsZero, _mm_max_ps(r0, r1));
+    }
+
+    // Prefer the bigger t if both give a positive radius.
+    const __m128 radius = _mm_set1_ps(rec->fRadius);
+    const __m128 dRadius = _mm_set1_ps(rec->fDRadius);
+    __m128 hiIsBehind = _mm_cmple_ps(_mm_add_ps(radius, _mm_mul_ps(hi, dRadius)), zero);
+    __m128 loIsBehind = _mm_cmple_ps(_mm_add_ps(radius, _mm_mul_ps(lo, dRadius)), zero);
+    __m128 t = select_SSE2(hiIsBehind, lo, hi);
+    __m128 skip = _mm_andnot_ps(valid, _mm_castsi128_ps(_mm_set1_epi32(-1)));
+    skip = _mm_or_ps(skip, _mm_and_ps(hiIsBehind, loIsBehind));
+
+    __m128i fixed = _mm_cvttps_epi32(_mm_mul_ps(t, _mm_set1_ps(SK_Fixed1)));
+    return select_SSE2(_mm_castps_si128(skip),
+                       _mm_set1_epi32((int32_t)SkTwoPointConicalSpan::kDontDrawT), fixed);
+}
+
+template <Tile tile>
+static void conical_SSE2(SkTwoPointConicalSpan* rec, SkPMColor dst[], const SkPMColor cache[],
+                         int toggle, int count) {
+    const __m128i toggles = toggles_SSE2(toggle);
+    const __m128i dontDraw = _mm_set1_epi32((int32_t)SkTwoPointConicalSpan::kDontDrawT);
+    for (; count > 0; count -= 4) {
+        __m128i t = conical_t_SSE2(rec);
+        __m128i fi = _mm_add_epi32(_mm_srli_epi32(tile_SSE2<tile>(t), 8), toggles);
+        lookup_or_skip_SSE2(fi, _mm_cmpeq_epi32(t, dontDraw), dst, cache, count);
+        dst += 4;
+    }
+}
+
+#endif
+
+bool SkGradientGetPlatformProcs_SSE2(SkGradientProcs* procs) {
+    procs->fLinearMirror = linear_mirror_SSE2;
+#ifdef SK_SCALAR_IS_FLOAT
+    procs->fRadialMirror = radial_SSE2<kMirror_Tile>;
+    procs->fConicalClamp = conical_SSE2<kClamp_Tile>;
+    procs->fConicalRepeat = conical_SSE2<kRepeat_Tile>;
+    procs->fConicalMirror = conical_SSE2<kMirror_Tile>;
+#endif
+    return true;
+}
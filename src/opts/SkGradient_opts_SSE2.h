@@ -0,0 +1,15 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef SkGradient_opts_SSE2_DEFINED
+#define SkGradient_opts_SSE2_DEFINED
+
+#include "SkGradientProcs.h"
+
+bool SkGradientGetPlatformProcs_SSE2(SkGradientProcs* procs);
+
+#endif
@@ -0,0 +1,745 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkColorPriv.h"
+#include "SkColor_opts_SSE2.h"
+#include "SkMathPriv.h"
+#include "SkXfermode.h"
+#include "SkXfermode_opts_SSE2.h"
+#include "SkXfermode_proccoeff.h"
+
+/*  These are the procs of src/core/SkXfermode.cpp, computing four pixels at a
+ *  time. They follow the scalar code step for step (branches become selects)
+ *  so that they give bit-identical results; XfermodeTest checks that they do.
+ */
+
+typedef __m128i (*SkXfermodeProcSIMD)(const __m128i& src, const __m128i& dst);
+
+////////////////////////////////////////////////////////////////////////////////
+// Helpers
+
+// Returns a where mask is set, and b elsewhere.
+static inline __m128i select_SSE2(const __m128i& mask, const __m128i& a, const __m128i& b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline __m128i SkMin32_SSE2(const __m128i& a, const __m128i& b) {
+    return select_SSE2(_mm_cmplt_epi32(a, b), a, b);
+}
+
+static inline __m128i SkMax32_SSE2(const __m128i& a, const __m128i& b) {
+    return select_SSE2(_mm_cmpgt_epi32(a, b), a, b);
+}
+
+// Truncating a / b, for |a| < 2^16 and 0 < |b| <= 255. A quotient that is
+// not an integer is at least 1/255 away from one, which is more than the
+// float's rounding error, so truncating the float quotient is exact.
+static inline __m128i SkDiv32_SSE2(const __m128i& a, const __m128i& b) {
+    return _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(a), _mm_cvtepi32_ps(b)));
+}
+
+// Like SkMulDiv(): a * b / c, truncated, without overflowing the product.
+// Our products stay far below 2^53, so the doubles are exact.
+static inline __m128i SkMulDiv_SSE2(const __m128i& a, const __m128i& b, const __m128i& c) {
+    __m128d lo = _mm_mul_pd(_mm_cvtepi32_pd(a), _mm_cvtepi32_pd(b));
+    __m128d hi = _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(a, 8)),
+                            _mm_cvtepi32_pd(_mm_srli_si128(b, 8)));
+    lo = _mm_div_pd(lo, _mm_cvtepi32_pd(c));
+    hi = _mm_div_pd(hi, _mm_cvtepi32_pd(_mm_srli_si128(c, 8)));
+    return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+static inline __m128i saturated_add_SSE2(const __m128i& a, const __m128i& b) {
+    return SkMin32_SSE2(_mm_add_epi32(a, b), _mm_set1_epi32(255));
+}
+
+static inline __m128i clamp_signed_byte_SSE2(const __m128i& n) {
+    return SkMax32_SSE2(SkMin32_SSE2(n, _mm_set1_epi32(255)), _mm_setzero_si128());
+}
+
+static inline __m128i clamp_div255round_SSE2(const __m128i& prod) {
+    // SkDiv255Round() of anything out of range is garbage, but is replaced.
+    __m128i ret = SkDiv255Round_SSE2(prod);
+    ret = _mm_andnot_si128(_mm_cmplt_epi32(prod, _mm_set1_epi32(1)), ret);
+    return select_SSE2(_mm_cmpgt_epi32(prod, _mm_set1_epi32(255 * 255 - 1)),
+                       _mm_set1_epi32(255), ret);
+}
+
+static inline __m128i srcover_byte_SSE2(const __m128i& a, const __m128i& b) {
+    return _mm_sub_epi32(_mm_add_epi32(a, b), SkAlphaMulAlpha_SSE2(a, b));
+}
+
+// sc * (255 - da) + dc * (255 - sa), which most separable modes add in.
+static inline __m128i blendfunc_byte_SSE2(const __m128i& sc, const __m128i& dc,
+                                          const __m128i& sa, const __m128i& da) {
+    const __m128i c_255 = _mm_set1_epi32(255);
+    return _mm_add_epi32(SkMulU8_SSE2(sc, _mm_sub_epi32(c_255, da)),
+                         SkMulU8_SSE2(dc, _mm_sub_epi32(c_255, sa)));
+}
+
+/*  Most modes are defined one component at a time; this unpacks the pixels,
+ *  applies byteProc to each color component, and packs the result with the
+ *  srcover alpha that all of those modes share.
+ */
+typedef __m128i (*BlendByteProc_SSE2)(const __m128i& sc, const __m128i& dc,
+                                      const __m128i& sa, const __m128i& da);
+
+template <BlendByteProc_SSE2 byteProc>
+static __m128i separable_modeproc_SSE2(const __m128i& src, const __m128i& dst) {
+    __m128i sa = SkGetPackedA32_SSE2(src);
+    __m128i da = SkGetPackedA32_SSE2(dst);
+
+    __m128i a = srcover_byte_SSE2(sa, da);
+    __m128i r = byteProc(SkGetPackedR32_SSE2(src), SkGetPackedR32_SSE2(dst), sa, da);
+    __m128i g = byteProc(SkGetPackedG32_SSE2(src), SkGetPackedG32_SSE2(dst), sa, da);
+    __m128i b = byteProc(SkGetPackedB32_SSE2(src), SkGetPackedB32_SSE2(dst), sa, da);
+    return SkPackARGB32_SSE2(a, r, g, b);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Porter-Duff modes
+
+//  kDst_Mode,      //!< [Da, Dc]
+static __m128i dst_modeproc_SSE2(const __m128i& src, const __m128i& dst) {
+    return dst;
+}
+
+//  kDstOver_Mode,  //!< [Sa + Da - Sa*Da, Dc + (1 - Da)*Sc]
+static __m128i dstover_modeproc_SSE2(const __m128i& src, const __m128i& dst) {
+    __m128i da = SkGetPackedA32_SSE2(dst);
+    return _mm_add_epi32(dst, SkAlphaMulQ_SSE2(src, _mm_sub_epi32(_mm_set1_epi32(256), da)));
+}
+
+//  kSrcIn_Mode,    //!< [Sa * Da, Sc * Da]
+static __m128i srcin_modeproc_SSE2(const __m128i& src, const __m128i& dst) {
+    __m128i da = SkGetPackedA32_SSE2(dst);
+    return SkAlphaMulQ_SSE2(src, SkAlpha255To256_SSE2(da));
+}
+
+//  kSrcOut_Mode,   //!< [Sa * (1 - Da), Sc * (1 - Da)]
+static __m128i srcout_modeproc_SSE2(const __m128i& src, const __m128i& dst) {
+    __m128i ida = _mm_sub_epi32(_mm_set1_epi32(255), SkGetPackedA32_SSE2(dst));
+    return SkAlphaMulQ_SSE2(src, SkAlpha255To256_SSE2(ida));
+}
+
+//  kSrcATop_Mode,  //!< [Da, Sc * Da + (1 - Sa) * Dc]
+static __m128i srcatop_modeproc_SSE2(const __m128i& src, const __m128i& dst) {
+    __m128i sa = SkGetPackedA32_SSE2(src);
+    __m128i da = SkGetPackedA32_SSE2(dst);
+    __m128i isa = _mm_sub_epi32(_mm_set1_epi32(255), sa);
+
+    __m128i r = _mm_add_epi32(SkAlphaMulAlpha_SSE2(da, SkGetPackedR32_SSE2(src)),
+                              SkAlphaMulAlpha_SSE2(isa, SkGetPackedR32_SSE2(dst)));
+    __m128i g = _mm_add_epi32(SkAlphaMulAlpha_SSE2(da, SkGetPackedG32_SSE2(src)),
+                              SkAlphaMulAlpha_SSE2(isa, SkGetPackedG32_SSE2(dst)));
+    __m128i b = _mm_add_epi32(SkAlphaMulAlpha_SSE2(da, SkGetPackedB32_SSE2(src)),
+                              SkAlphaMulAlpha_SSE2(isa, SkGetPackedB32_SSE2(dst)));
+    return SkPackARGB32_SSE2(da, r, g, b);
+}
+
+//  kDstATop_Mode,  //!< [Sa, Sa * Dc + Sc * (1 - Da)]
+static __m128i dstatop_modeproc_SSE2(const __m128i& src, const __m128i& dst) {
+    __m128i sa = SkGetPackedA32_SSE2(src);
+    __m128i da = SkGetPackedA32_SSE2(dst);
+    __m128i ida = _mm_sub_epi32(_mm_set1_epi32(255), da);
+
+    __m128i r = _mm_add_epi32(SkAlphaMulAlpha_SSE2(ida, SkGetPackedR32_SSE2(src)),
+                              SkAlphaMulAlpha_SSE2(sa, SkGetPackedR32_SSE2(dst)));
+    __m128i g = _mm_add_epi32(SkAlphaMulAlpha_SSE2(ida, SkGetPackedG32_SSE2(src)),
+                              SkAlphaMulAlpha_SSE2(sa, SkGetPackedG32_SSE2(dst)));
+    __m128i b = _mm_add_epi32(SkAlphaMulAlpha_SSE2(ida, SkGetPackedB32_SSE2(src)),
+                              SkAlphaMulAlpha_SSE2(sa, SkGetPackedB32_SSE2(dst)));
+    return SkPackARGB32_SSE2(sa, r, g, b);
+}
+
+//  kXor_Mode   [Sa + Da - 2 * Sa * Da, Sc * (1 - Da) + (1 - Sa) * Dc]
+static __m128i xor_modeproc_SSE2(const __m128i& src, const __m128i& dst) {
+    __m128i sa = SkGetPackedA32_SSE2(src);
+    __m128i da = SkGetPackedA32_SSE2(dst);
+    __m128i isa = _mm_sub_epi32(_mm_set1_epi32(255), sa);
+    __m128i ida = _mm_sub_epi32(_mm_set1_epi32(255), da);
+
+    __m128i a = _mm_sub_epi32(_mm_add_epi32(sa, da),
+                              _mm_slli_epi32(SkAlphaMulAlpha_SSE2(sa, da), 1));
+    __m128i r = _mm_add_epi32(SkAlphaMulAlpha_SSE2(ida, SkGetPackedR32_SSE2(src)),
+                              SkAlphaMulAlpha_SSE2(isa, SkGetPackedR32_SSE2(dst)));
+    __m128i g = _mm_add_epi32(SkAlphaMulAlpha_SSE2(ida, SkGetPackedG32_SSE2(src)),
+                              SkAlphaMulAlpha_SSE2(isa, SkGetPackedG32_SSE2(dst)));
+    __m128i b = _mm_add_epi32(SkAlphaMulAlpha_SSE2(ida, SkGetPackedB32_SSE2(src)),
+                              SkAlphaMulAlpha_SSE2(isa, SkGetPackedB32_SSE2(dst)));
+    return SkPackARGB32_SSE2(a, r, g, b);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Separable modes
+
+// kPlus_Mode
+static __m128i plus_modeproc_SSE2(const __m128i& src, const __m128i& dst) {
+    __m128i b = saturated_add_SSE2(SkGetPackedB32_SSE2(src), SkGetPackedB32_SSE2(dst));
+    __m128i g = saturated_add_SSE2(SkGetPackedG32_SSE2(src), SkGetPackedG32_SSE2(dst));
+    __m128i r = saturated_add_SSE2(SkGetPackedR32_SSE2(src), SkGetPackedR32_SSE2(dst));
+    __m128i a = saturated_add_SSE2(SkGetPackedA32_SSE2(src), SkGetPackedA32_SSE2(dst));
+    return SkPackARGB32_SSE2(a, r, g, b);
+}
+
+// kModulate_Mode
+static __m128i modulate_modeproc_SSE2(const __m128i& src, const __m128i& dst) {
+    __m128i a = SkAlphaMulAlpha_SSE2(SkGetPackedA32_SSE2(src), SkGetPackedA32_SSE2(dst));
+    __m128i r = SkAlphaMulAlpha_SSE2(SkGetPackedR32_SSE2(src), SkGetPackedR32_SSE2(dst));
+    __m128i g = SkAlphaMulAlpha_SSE2(SkGetPackedG32_SSE2(src), SkGetPackedG32_SSE2(dst));
+    __m128i b = SkAlphaMulAlpha_SSE2(SkGetPackedB32_SSE2(src), SkGetPackedB32_SSE2(dst));
+    return SkPackARGB32_SSE2(a, r, g, b);
+}
+
+// kMultiply_Mode
+static inline __m128i multiply_byte_SSE2(const __m128i& sc, const __m128i& dc,
+                                         const __m128i& sa, const __m128i& da) {
+    return clamp_div255round_SSE2(_mm_add_epi32(blendfunc_byte_SSE2(sc, dc, sa, da),
+                                                SkMulU8_SSE2(sc, dc)));
+}
+
+// kScreen_Mode
+static inline __m128i screen_byte_SSE2(const __m128i& sc, const __m128i& dc,
+                                       const __m128i&, const __m128i&) {
+    return srcover_byte_SSE2(sc, dc);
+}
+
+// kOverlay_Mode
+static inline __m128i overlay_byte_SSE2(const __m128i& sc, const __m128i& dc,
+                                        const __m128i& sa, const __m128i& da) {
+    __m128i tmp = blendfunc_byte_SSE2(sc, dc, sa, da);
+    __m128i lo = _mm_slli_epi32(SkMulU8_SSE2(sc, dc), 1);
+    __m128i hi = _mm_sub_epi32(SkMulU8_SSE2(sa, da),
+                               _mm_slli_epi32(Multiply32_SSE2(_mm_sub_epi32(da, dc),
+                                                              _mm_sub_epi32(sa, sc)), 1));
+    __m128i rc = select_SSE2(_mm_cmpgt_epi32(_mm_slli_epi32(dc, 1), da), hi, lo);
+    return clamp_div255round_SSE2(_mm_add_epi32(rc, tmp));
+}
+
+// kDarken_Mode
+static inline __m128i darken_byte_SSE2(const __m128i& sc, const __m128i& dc,
+                                       const __m128i& sa, const __m128i& da) {
+    // Whichever of srcover and dstover is darker subtracts the larger product.
+    __m128i sd = SkMulU8_SSE2(sc, da);
+    __m128i ds = SkMulU8_SSE2(dc, sa);
+    return _mm_sub_epi32(_mm_add_epi32(sc, dc), SkDiv255Round_SSE2(SkMax32_SSE2(sd, ds)));
+}
+
+// kLighten_Mode
+static inline __m128i lighten_byte_SSE2(const __m128i& sc, const __m128i& dc,
+                                        const __m128i& sa, const __m128i& da) {
+    __m128i sd = SkMulU8_SSE2(sc, da);
+    __m128i ds = SkMulU8_SSE2(dc, sa);
+    return _mm_sub_epi32(_mm_add_epi32(sc, dc), SkDiv255Round_SSE2(SkMin32_SSE2(sd, ds)));
+}
+
+// kColorDodge_Mode
+static inline __m128i colordodge_byte_SSE2(const __m128i& sc, const __m128i& dc,
+                                           const __m128i& sa, const __m128i& da) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i diff = _mm_sub_epi32(sa, sc);
+    __m128i diffIsZero = _mm_cmpeq_epi32(diff, zero);
+    __m128i tmp = blendfunc_byte_SSE2(sc, dc, sa, da);
+
+    // 0 == diff
+    __m128i rc1 = _mm_add_epi32(SkMulU8_SSE2(sa, da), tmp);
+
+    // otherwise; the division is harmlessly redirected where diff is 0
+    __m128i q = SkDiv32_SSE2(SkMulU8_SSE2(dc, sa),
+                             select_SSE2(diffIsZero, _mm_set1_epi32(1), diff));
+    __m128i rc2 = _mm_add_epi32(Multiply32_SSE2(sa, SkMin32_SSE2(da, q)), tmp);
+
+    __m128i rc = clamp_div255round_SSE2(select_SSE2(diffIsZero, rc1, rc2));
+
+    // 0 == dc
+    __m128i rc0 = SkAlphaMulAlpha_SSE2(sc, _mm_sub_epi32(_mm_set1_epi32(255), da));
+    return select_SSE2(_mm_cmpeq_epi32(dc, zero), rc0, rc);
+}
+
+// kColorBurn_Mode
+static inline __m128i colorburn_byte_SSE2(const __m128i& sc, const __m128i& dc,
+                                          const __m128i& sa, const __m128i& da) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i scIsZero = _mm_cmpeq_epi32(sc, zero);
+    __m128i tmp = blendfunc_byte_SSE2(sc, dc, sa, da);
+
+    // dc == da
+    __m128i rc1 = _mm_add_epi32(SkMulU8_SSE2(sa, da), tmp);
+
+    // otherwise; the division is harmlessly redirected where sc is 0
+    __m128i q = SkDiv32_SSE2(Multiply32_SSE2(_mm_sub_epi32(da, dc), sa),
+                             select_SSE2(scIsZero, _mm_set1_epi32(1), sc));
+    __m128i rc2 = _mm_add_epi32(Multiply32_SSE2(sa, _mm_sub_epi32(da, SkMin32_SSE2(da, q))),
+                                tmp);
+
+    // 0 == sc
+    __m128i rc0 = SkAlphaMulAlpha_SSE2(dc, _mm_sub_epi32(_mm_set1_epi32(255), sa));
+
+    __m128i dcIsDa = _mm_cmpeq_epi32(dc, da);
+    __m128i rc = clamp_div255round_SSE2(select_SSE2(dcIsDa, rc1, rc2));
+    return select_SSE2(_mm_andnot_si128(dcIsDa, scIsZero), rc0, rc);
+}
+
+// kHardLight_Mode
+static inline __m128i hardlight_byte_SSE2(const __m128i& sc, const __m128i& dc,
+                                          const __m128i& sa, const __m128i& da) {
+    __m128i lo = _mm_slli_epi32(SkMulU8_SSE2(sc, dc), 1);
+    __m128i hi = _mm_sub_epi32(SkMulU8_SSE2(sa, da),
+                               _mm_slli_epi32(Multiply32_SSE2(_mm_sub_epi32(da, dc),
+                                                              _mm_sub_epi32(sa, sc)), 1));
+    __m128i rc = select_SSE2(_mm_cmpgt_epi32(_mm_slli_epi32(sc, 1), sa), hi, lo);
+    return clamp_div255round_SSE2(_mm_add_epi32(rc, blendfunc_byte_SSE2(sc, dc, sa, da)));
+}
+
+// returns 255 * sqrt(n/255), exactly as SkSqrtBits(n, 15+4) does
+static inline __m128i sqrt_unit_byte_SSE2(const __m128i& n) {
+    // The square root of an integer below 2^52 is correctly rounded, so it
+    // truncates to the integer square root.
+    const __m128d c_256 = _mm_set1_pd(256);
+    __m128d lo = _mm_sqrt_pd(_mm_mul_pd(_mm_cvtepi32_pd(n), c_256));
+    __m128d hi = _mm_sqrt_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(n, 8)), c_256));
+    return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+// kSoftLight_Mode
+static inline __m128i softlight_byte_SSE2(const __m128i& sc, const __m128i& dc,
+                                          const __m128i& sa, const __m128i& da) {
+    const __m128i c_256 = _mm_set1_epi32(256);
+    __m128i daIsZero = _mm_cmpeq_epi32(da, _mm_setzero_si128());
+    __m128i m = SkDiv32_SSE2(_mm_slli_epi32(dc, 8),
+                             select_SSE2(daIsZero, _mm_set1_epi32(1), da));
+    m = _mm_andnot_si128(daIsZero, m);
+
+    __m128i sc2 = _mm_slli_epi32(sc, 1);
+    __m128i dc4 = _mm_slli_epi32(dc, 2);
+    __m128i twoScMinusSa = _mm_sub_epi32(sc2, sa);
+
+    // 2 * sc <= sa
+    __m128i rc1 = _mm_srai_epi32(Multiply32_SSE2(twoScMinusSa, _mm_sub_epi32(c_256, m)), 8);
+    rc1 = Multiply32_SSE2(dc, _mm_add_epi32(sa, rc1));
+
+    // 4 * dc <= da
+    __m128i m4 = _mm_slli_epi32(m, 2);
+    __m128i tmp2 = Multiply32_SSE2(Multiply32_SSE2(m4, _mm_add_epi32(m4, c_256)),
+                                   _mm_sub_epi32(m, c_256));
+    tmp2 = _mm_add_epi32(_mm_srai_epi32(tmp2, 16), Multiply32_SSE2(m, _mm_set1_epi32(7)));
+
+    // otherwise
+    __m128i tmp3 = _mm_sub_epi32(sqrt_unit_byte_SSE2(m), m);
+
+    __m128i tmp = select_SSE2(_mm_cmpgt_epi32(dc4, da), tmp3, tmp2);
+    __m128i rc23 = _mm_srai_epi32(Multiply32_SSE2(Multiply32_SSE2(da, twoScMinusSa), tmp), 8);
+    rc23 = _mm_add_epi32(SkMulU8_SSE2(dc, sa), rc23);
+
+    __m128i rc = select_SSE2(_mm_cmpgt_epi32(sc2, sa), rc23, rc1);
+    return clamp_div255round_SSE2(_mm_add_epi32(rc, blendfunc_byte_SSE2(sc, dc, sa, da)));
+}
+
+// kDifference_Mode
+static inline __m128i difference_byte_SSE2(const __m128i& sc, const __m128i& dc,
+                                           const __m128i& sa, const __m128i& da) {
+    __m128i tmp = SkMin32_SSE2(SkMulU8_SSE2(sc, da), SkMulU8_SSE2(dc, sa));
+    return clamp_signed_byte_SSE2(_mm_sub_epi32(_mm_add_epi32(sc, dc),
+                                                _mm_slli_epi32(SkDiv255Round_SSE2(tmp), 1)));
+}
+
+// kExclusion_Mode
+static inline __m128i exclusion_byte_SSE2(const __m128i& sc, const __m128i& dc,
+                                          const __m128i& sa, const __m128i& da) {
+    __m128i r = _mm_add_epi32(SkMulU8_SSE2(sc, da), SkMulU8_SSE2(dc, sa));
+    r = _mm_sub_epi32(r, _mm_slli_epi32(SkMulU8_SSE2(sc, dc), 1));
+    return clamp_div255round_SSE2(_mm_add_epi32(r, blendfunc_byte_SSE2(sc, dc, sa, da)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Non-separable modes
+
+static inline __m128i Lum_SSE2(const __m128i& r, const __m128i& g, const __m128i& b) {
+    __m128i sum = _mm_add_epi32(Multiply32_SSE2(r, _mm_set1_epi32(77)),
+                                Multiply32_SSE2(g, _mm_set1_epi32(150)));
+    sum = _mm_add_epi32(sum, Multiply32_SSE2(b, _mm_set1_epi32(28)));
+    return SkDiv255Round_SSE2(sum);
+}
+
+static inline __m128i minimum_SSE2(const __m128i& a, const __m128i& b, const __m128i& c) {
+    return SkMin32_SSE2(SkMin32_SSE2(a, b), c);
+}
+
+static inline __m128i maximum_SSE2(const __m128i& a, const __m128i& b, const __m128i& c) {
+    return SkMax32_SSE2(SkMax32_SSE2(a, b), c);
+}
+
+static inline __m128i Sat_SSE2(const __m128i& r, const __m128i& g, const __m128i& b) {
+    return _mm_sub_epi32(maximum_SSE2(r, g, b), minimum_SSE2(r, g, b));
+}
+
+/*  The scalar SetSat() sorts the components and scales the middle one; here
+ *  each component works out its own role. Ties make no difference: scaling a
+ *  component equal to Cmin gives 0, and one equal to Cmax gives s.
+ */
+static inline __m128i setSaturationComponent_SSE2(const __m128i& c, const __m128i& cmin,
+                                                  const __m128i& cmax, const __m128i& s) {
+    __m128i range = _mm_sub_epi32(cmax, cmin);
+    __m128i hasRange = _mm_cmpgt_epi32(cmax, cmin);
+    __m128i mid = SkMulDiv_SSE2(_mm_sub_epi32(c, cmin), s,
+                                select_SSE2(hasRange, range, _mm_set1_epi32(1)));
+    __m128i ret = select_SSE2(_mm_cmpeq_epi32(c, cmax), s, mid);
+    ret = _mm_andnot_si128(_mm_cmpeq_epi32(c, cmin), ret);
+    return _mm_and_si128(hasRange, ret);
+}
+
+static inline void SetSat_SSE2(__m128i* r, __m128i* g, __m128i* b, const __m128i& s) {
+    __m128i cmin = minimum_SSE2(*r, *g, *b);
+    __m128i cmax = maximum_SSE2(*r, *g, *b);
+    *r = setSaturationComponent_SSE2(*r, cmin, cmax, s);
+    *g = setSaturationComponent_SSE2(*g, cmin, cmax, s);
+    *b = setSaturationComponent_SSE2(*b, cmin, cmax, s);
+}
+
+// L + (c - L) * num / denom, where mask is set
+static inline __m128i clipComponent_SSE2(const __m128i& mask, const __m128i& c,
+                                         const __m128i& L, const __m128i& num,
+                                         const __m128i& denom) {
+    __m128i safeDenom = select_SSE2(mask, denom, _mm_set1_epi32(1));
+    __m128i clipped = _mm_add_epi32(L, SkMulDiv_SSE2(_mm_sub_epi32(c, L), num, safeDenom));
+    return select_SSE2(mask, clipped, c);
+}
+
+static inline void clipColor_SSE2(__m128i* r, __m128i* g, __m128i* b, const __m128i& a) {
+    __m128i L = Lum_SSE2(*r, *g, *b);
+    __m128i n = minimum_SSE2(*r, *g, *b);
+    __m128i x = maximum_SSE2(*r, *g, *b);
+
+    // Both clips are rare, so skip the divisions unless some pixel needs them.
+    __m128i mask = _mm_cmplt_epi32(n, _mm_setzero_si128());
+    if (_mm_movemask_epi8(mask)) {
+        __m128i denom = _mm_sub_epi32(L, n);
+        *r = clipComponent_SSE2(mask, *r, L, L, denom);
+        *g = clipComponent_SSE2(mask, *g, L, L, denom);
+        *b = clipComponent_SSE2(mask, *b, L, L, denom);
+    }
+
+    mask = _mm_cmpgt_epi32(x, a);
+    if (_mm_movemask_epi8(mask)) {
+        __m128i num = _mm_sub_epi32(a, L);
+        __m128i denom = _mm_sub_epi32(x, L);
+        *r = clipComponent_SSE2(mask, *r, L, num, denom);
+        *g = clipComponent_SSE2(mask, *g, L, num, denom);
+        *b = clipComponent_SSE2(mask, *b, L, num, denom);
+    }
+}
+
+static inline void SetLum_SSE2(__m128i* r, __m128i* g, __m128i* b, const __m128i& a,
+                               const __m128i& l) {
+    __m128i d = _mm_sub_epi32(l, Lum_SSE2(*r, *g, *b));
+    *r = _mm_add_epi32(*r, d);
+    *g = _mm_add_epi32(*g, d);
+    *b = _mm_add_epi32(*b, d);
+
+    clipColor_SSE2(r, g, b, a);
+}
+
+// non-separable blend modes are done in non-premultiplied alpha
+static inline __m128i blendfunc_nonsep_byte_SSE2(const __m128i& sc, const __m128i& dc,
+                                                 const __m128i& sa, const __m128i& da,
+                                                 const __m128i& blendval) {
+    return clamp_div255round_SSE2(_mm_add_epi32(blendfunc_byte_SSE2(sc, dc, sa, da), blendval));
+}
+
+/*  All four non-separable modes unpack the same way, only blend where both
+ *  alphas are non-zero, and combine the same way; only the SetSat/SetLum
+ *  step differs.
+ */
+enum NonSepMode {
+    kHue_NonSepMode,
+    kSaturation_NonSepMode,
+    kColor_NonSepMode,
+    kLuminosity_NonSepMode,
+};
+
+template <NonSepMode mode>
+static __m128i nonseparable_modeproc_SSE2(const __m128i& src, const __m128i& dst) {
+    __m128i sr = SkGetPackedR32_SSE2(src);
+    __m128i sg = SkGetPackedG32_SSE2(src);
+    __m128i sb = SkGetPackedB32_SSE2(src);
+    __m128i sa = SkGetPackedA32_SSE2(src);
+
+    __m128i dr = SkGetPackedR32_SSE2(dst);
+    __m128i dg = SkGetPackedG32_SSE2(dst);
+    __m128i db = SkGetPackedB32_SSE2(dst);
+    __m128i da = SkGetPackedA32_SSE2(dst);
+
+    __m128i Br, Bg, Bb;
+    __m128i sada = SkMulU8_SSE2(sa, da);
+    switch (mode) {
+        case kHue_NonSepMode:
+            Br = SkMulU8_SSE2(sr, sa);
+            Bg = SkMulU8_SSE2(sg, sa);
+            Bb = SkMulU8_SSE2(sb, sa);
+            SetSat_SSE2(&Br, &Bg, &Bb, SkMulU8_SSE2(Sat_SSE2(dr, dg, db), sa));
+            SetLum_SSE2(&Br, &Bg, &Bb, sada, SkMulU8_SSE2(Lum_SSE2(dr, dg, db), sa));
+            break;
+        case kSaturation_NonSepMode:
+            Br = SkMulU8_SSE2(dr, sa);
+            Bg = SkMulU8_SSE2(dg, sa);
+            Bb = SkMulU8_SSE2(db, sa);
+            SetSat_SSE2(&Br, &Bg, &Bb, SkMulU8_SSE2(Sat_SSE2(sr, sg, sb), da));
+            SetLum_SSE2(&Br, &Bg, &Bb, sada, SkMulU8_SSE2(Lum_SSE2(dr, dg, db), sa));
+            break;
+        case kColor_NonSepMode:
+            Br = SkMulU8_SSE2(sr, da);
+            Bg = SkMulU8_SSE2(sg, da);
+            Bb = SkMulU8_SSE2(sb, da);
+            SetLum_SSE2(&Br, &Bg, &Bb, sada, SkMulU8_SSE2(Lum_SSE2(dr, dg, db), sa));
+            break;
+        case kLuminosity_NonSepMode:
+            Br = SkMulU8_SSE2(dr, sa);
+            Bg = SkMulU8_SSE2(dg, sa);
+            Bb = SkMulU8_SSE2(db, sa);
+            SetLum_SSE2(&Br, &Bg, &Bb, sada, SkMulU8_SSE2(Lum_SSE2(sr, sg, sb), da));
+            break;
+    }
+
+    // sa * da is zero exactly when either alpha is
+    __m128i blend = _mm_cmpgt_epi32(sada, _mm_setzero_si128());
+    Br = _mm_and_si128(blend, Br);
+    Bg = _mm_and_si128(blend, Bg);
+    Bb = _mm_and_si128(blend, Bb);
+
+    __m128i a = srcover_byte_SSE2(sa, da);
+    __m128i r = blendfunc_nonsep_byte_SSE2(sr, dr, sa, da, Br);
+    __m128i g = blendfunc_nonsep_byte_SSE2(sg, dg, sa, da, Bg);
+    __m128i b = blendfunc_nonsep_byte_SSE2(sb, db, sa, da, Bb);
+    return SkPackARGB32_SSE2(a, r, g, b);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Spreads four bytes out to one per 32-bit lane.
+static inline __m128i unpack_four_SSE2(uint32_t packed) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = _mm_cvtsi32_si128(packed);
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(a, zero), zero);
+}
+
+static inline uint32_t read_four(const SkAlpha* bytes) {
+    uint32_t packed;
+    memcpy(&packed, bytes, sizeof(packed));
+    return packed;
+}
+
+// Blends res over dst by coverage, exactly as SkFourByteInterp() would,
+// leaving dst alone where the coverage is zero.
+static inline __m128i coverage_interp_SSE2(const __m128i& res, const __m128i& dst,
+                                           const __m128i& coverage) {
+    __m128i ret = SkFourByteInterp256_SSE2(res, dst, SkAlpha255To256_SSE2(coverage));
+    return select_SSE2(_mm_cmpeq_epi32(coverage, _mm_setzero_si128()), dst, ret);
+}
+
+void SkSSE2ProcCoeffXfermode::xfer32(SkPMColor dst[], const SkPMColor src[],
+                                     int count, const SkAlpha aa[]) const {
+    SkASSERT(dst && src && count >= 0);
+
+    SkXfermodeProc proc = this->getProc();
+    SkXfermodeProcSIMD procSIMD = reinterpret_cast<SkXfermodeProcSIMD>(fProcSIMD);
+    SkASSERT(procSIMD != NULL);
+
+    if (NULL == aa) {
+        while (count >= 4) {
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<__m128i*>(dst));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), procSIMD(s, d));
+            src += 4;
+            dst += 4;
+            count -= 4;
+        }
+        for (int i = count - 1; i >= 0; --i) {
+            dst[i] = proc(src[i], dst[i]);
+        }
+    } else {
+        while (count >= 4) {
+            uint32_t coverage = read_four(aa);
+            if (0 != coverage) {
+                __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+                __m128i d = _mm_loadu_si128(reinterpret_cast<__m128i*>(dst));
+                __m128i res = procSIMD(s, d);
+                if (0xFFFFFFFF != coverage) {
+                    res = coverage_interp_SSE2(res, d, unpack_four_SSE2(coverage));
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), res);
+            }
+            src += 4;
+            dst += 4;
+            aa += 4;
+            count -= 4;
+        }
+        for (int i = count - 1; i >= 0; --i) {
+            unsigned a = aa[i];
+            if (0 != a) {
+                SkPMColor dstC = dst[i];
+                SkPMColor C = proc(src[i], dstC);
+                if (a != 0xFF) {
+                    C = SkFourByteInterp(C, dstC, a);
+                }
+                dst[i] = C;
+            }
+        }
+    }
+}
+
+void SkSSE2ProcCoeffXfermode::xfer16(uint16_t dst[], const SkPMColor src[],
+                                     int count, const SkAlpha aa[]) const {
+    SkASSERT(dst && src && count >= 0);
+
+    SkXfermodeProc proc = this->getProc();
+    SkXfermodeProcSIMD procSIMD = reinterpret_cast<SkXfermodeProcSIMD>(fProcSIMD);
+    SkASSERT(procSIMD != NULL);
+    const __m128i zero = _mm_setzero_si128();
+
+    while (count >= 4) {
+        uint32_t coverage = (NULL == aa) ? 0xFFFFFFFF : read_four(aa);
+        if (0 != coverage) {
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            __m128i d = _mm_loadl_epi64(reinterpret_cast<__m128i*>(dst));
+            d = SkPixel16ToPixel32_SSE2(_mm_unpacklo_epi16(d, zero));
+            __m128i res = procSIMD(s, d);
+            if (0xFFFFFFFF != coverage) {
+                res = coverage_interp_SSE2(res, d, unpack_four_SSE2(coverage));
+            }
+            // Sign-extend so that the saturating pack keeps all 16 bits.
+            res = SkPixel32ToPixel16_SSE2(res);
+            res = _mm_srai_epi32(_mm_slli_epi32(res, 16), 16);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packs_epi32(res, res));
+        }
+        src += 4;
+        dst += 4;
+        if (NULL != aa) {
+            aa += 4;
+        }
+        count -= 4;
+    }
+
+    if (NULL == aa) {
+        for (int i = count - 1; i >= 0; --i) {
+            SkPMColor dstC = SkPixel16ToPixel32(dst[i]);
+            dst[i] = SkPixel32ToPixel16_ToU16(proc(src[i], dstC));
+        }
+    } else {
+        for (int i = count - 1; i >= 0; --i) {
+            unsigned a = aa[i];
+            if (0 != a) {
+                SkPMColor dstC = SkPixel16ToPixel32(dst[i]);
+                SkPMColor C = proc(src[i], dstC);
+                if (0xFF != a) {
+                    C = SkFourByteInterp(C, dstC, a);
+                }
+                dst[i] = SkPixel32ToPixel16_ToU16(C);
+            }
+        }
+    }
+}
+
+void SkSSE2ProcCoeffXfermode::xferA8(SkAlpha dst[], const SkPMColor src[],
+                                     int count, const SkAlpha aa[]) const {
+    SkASSERT(dst && src && count >= 0);
+
+    SkXfermodeProc proc = this->getProc();
+    SkXfermodeProcSIMD procSIMD = reinterpret_cast<SkXfermodeProcSIMD>(fProcSIMD);
+    SkASSERT(procSIMD != NULL);
+
+    while (count >= 4) {
+        uint32_t coverage = (NULL == aa) ? 0xFFFFFFFF : read_four(aa);
+        if (0 != coverage) {
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            __m128i da = unpack_four_SSE2(read_four(dst));
+            __m128i A = SkGetPackedA32_SSE2(procSIMD(s, _mm_slli_epi32(da, SK_A32_SHIFT)));
+            if (0xFFFFFFFF != coverage) {
+                // SkAlphaBlend() is the same one-byte interpolation.
+                A = coverage_interp_SSE2(A, da, unpack_four_SSE2(coverage));
+            }
+            A = _mm_packs_epi32(A, A);
+            A = _mm_packus_epi16(A, A);
+            uint32_t packed = _mm_cvtsi128_si32(A);
+            memcpy(dst, &packed, sizeof(packed));
+        }
+        src += 4;
+        dst += 4;
+        if (NULL != aa) {
+            aa += 4;
+        }
+        count -= 4;
+    }
+
+    if (NULL == aa) {
+        for (int i = count - 1; i >= 0; --i) {
+            SkPMColor res = proc(src[i], dst[i] << SK_A32_SHIFT);
+            dst[i] = SkToU8(SkGetPackedA32(res));
+        }
+    } else {
+        for (int i = count - 1; i >= 0; --i) {
+            unsigned a = aa[i];
+            if (0 != a) {
+                SkAlpha dstA = dst[i];
+                SkPMColor res = proc(src[i], dstA << SK_A32_SHIFT);
+                unsigned A = SkGetPackedA32(res);
+                if (0xFF != a) {
+                    A = SkAlphaBlend(A, dstA, SkAlpha255To256(a));
+                }
+                dst[i] = SkToU8(A);
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static const SkXfermodeProcSIMD gSSE2XfermodeProcs[] = {
+    NULL, // kClear_Mode is special-cased in SkXfermode.cpp
+    NULL, // kSrc_Mode is special-cased in SkXfermode.cpp
+    dst_modeproc_SSE2,
+    NULL, // kSrcOver_Mode is handled by SkBlitRow
+    dstover_modeproc_SSE2,
+    srcin_modeproc_SSE2,
+    NULL, // kDstIn_Mode is special-cased in SkXfermode.cpp
+    srcout_modeproc_SSE2,
+    NULL, // kDstOut_Mode is special-cased in SkXfermode.cpp
+    srcatop_modeproc_SSE2,
+    dstatop_modeproc_SSE2,
+    xor_modeproc_SSE2,
+
+    plus_modeproc_SSE2,
+    modulate_modeproc_SSE2,
+    separable_modeproc_SSE2<screen_byte_SSE2>,
+    separable_modeproc_SSE2<overlay_byte_SSE2>,
+    separable_modeproc_SSE2<darken_byte_SSE2>,
+    separable_modeproc_SSE2<lighten_byte_SSE2>,
+    separable_modeproc_SSE2<colordodge_byte_SSE2>,
+    separable_modeproc_SSE2<colorburn_byte_SSE2>,
+    separable_modeproc_SSE2<hardlight_byte_SSE2>,
+    separable_modeproc_SSE2<softlight_byte_SSE2>,
+    separable_modeproc_SSE2<difference_byte_SSE2>,
+    separable_modeproc_SSE2<exclusion_byte_SSE2>,
+    separable_modeproc_SSE2<multiply_byte_SSE2>,
+
+    nonseparable_modeproc_SSE2<kHue_NonSepMode>,
+    nonseparable_modeproc_SSE2<kSaturation_NonSepMode>,
+    nonseparable_modeproc_SSE2<kColor_NonSepMode>,
+    nonseparable_modeproc_SSE2<kLuminosity_NonSepMode>,
+};
+
+SK_COMPILE_ASSERT(SK_ARRAY_COUNT(gSSE2XfermodeProcs) == SkXfermode::kLastMode + 1,
+                  mode_count);
+
+SkProcCoeffXfermode* SkPlatformXfermodeFactory_impl_SSE2(const ProcCoeff& rec,
+                                                         SkXfermode::Mode mode) {
+    void* procSIMD = reinterpret_cast<void*>(gSSE2XfermodeProcs[mode]);
+
+    if (NULL != procSIMD) {
+        return SkNEW_ARGS(SkSSE2ProcCoeffXfermode, (rec, mode, procSIMD));
+    }
+    return NULL;
+}
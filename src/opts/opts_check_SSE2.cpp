@@ -11,8 +11,14 @@
 #include "SkBlitRow.h"
 #include "SkBlitRect_opts_SSE2.h"
 #include "SkBlitRow_opts_SSE2.h"
+#include "SkBlitRow_opts_AVX2.h"
+#include "SkBoxBlur_opts_SSE2.h"
+#include "SkConvolver_opts_SSE2.h"
+#include "SkGradient_opts_SSE2.h"
+#include "SkShader.h"
 #include "SkUtils_opts_SSE2.h"
 #include "SkUtils.h"
+#include "SkXfermode_opts_SSE2.h"
 
 #if defined(_MSC_VER) && defined(_WIN64)
 #include <intrin.h>
@@ -27,10 +33,11 @@
 #ifdef _MSC_VER
 static inline void getcpuid(int info_type, int info[4]) {
 #if defined(_WIN64)
-    __cpuid(info, info_type);
+    __cpuidex(info, info_type, 0);
 #else
     __asm {
         mov    eax, [info_type]
+        xor    ecx, ecx
         cpuid
         mov    edi, [info]
         mov    [edi], eax
@@ -46,7 +53,7 @@ static inline void getcpuid(int info_type, int info[4]) {
     asm volatile (
         "cpuid \n\t"
         : "=a"(info[0]), "=b"(info[1]), "=c"(info[2]), "=d"(info[3])
-        : "a"(info_type)
+        : "a"(info_type), "c"(0)
     );
 }
 #else
@@ -58,7 +65,7 @@ static inline void getcpuid(int info_type, int info[4]) {
         "movl %%ebx, %1   \n\t"
         "popl %%ebx       \n\t"
         : "=a"(info[0]), "=r"(info[1]), "=c"(info[2]), "=d"(info[3])
-        : "a"(info_type)
+        : "a"(info_type), "c"(0)
     );
 }
 #endif
@@ -92,6 +99,52 @@ static inline bool hasSSSE3() {
 }
 #endif
 
+/* Leaf 7 (structured extended features) needs ecx cleared, which getcpuid()
+   does. AVX2 is only usable if the OS also saves the ymm registers, which
+   xgetbv reports. */
+static inline uint64_t getxcr0() {
+#ifdef _MSC_VER
+#if defined(_WIN64)
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm {
+        xor    ecx, ecx
+        _emit  0x0f
+        _emit  0x01
+        _emit  0xd0
+        mov    [lo], eax
+        mov    [hi], edx
+    }
+    return ((uint64_t)hi << 32) | lo;
+#endif
+#else
+    uint32_t lo, hi;
+    // xgetbv, spelled out for assemblers that predate it.
+    asm volatile (".byte 0x0f, 0x01, 0xd0" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+static inline bool hasAVX2() {
+    int cpu_info[4] = { 0 };
+    getcpuid(0, cpu_info);
+    if (cpu_info[0] < 7) {
+        return false;
+    }
+    getcpuid(1, cpu_info);
+    const int kOSXSAVE_AVX = (1 << 27) | (1 << 28);
+    if ((cpu_info[2] & kOSXSAVE_AVX) != kOSXSAVE_AVX) {
+        return false;
+    }
+    // XMM and YMM state must both be enabled.
+    if ((getxcr0() & 0x6) != 0x6) {
+        return false;
+    }
+    getcpuid(7, cpu_info);
+    return (cpu_info[1] & (1 << 5)) != 0;
+}
+
 static bool cachedHasSSE2() {
     static bool gHasSSE2 = hasSSE2();
     return gHasSSE2;
@@ -102,6 +155,43 @@ static bool cachedHasSSSE3() {
     return gHasSSSE3;
 }
 
+static bool cachedHasAVX2() {
+    static bool gHasAVX2 = hasAVX2();
+    return gHasAVX2;
+}
+
+static const SkBitmapProcState::MatrixProc gRepeatProcs[] = {
+    RepeatX_RepeatY_nofilter_scale,
+    RepeatX_RepeatY_filter_scale,
+    RepeatX_RepeatY_nofilter_affine,
+    RepeatX_RepeatY_filter_affine,
+    RepeatX_RepeatY_nofilter_persp,
+    RepeatX_RepeatY_filter_persp
+};
+
+static const SkBitmapProcState::MatrixProc gGeneralProcs[] = {
+    GeneralXY_nofilter_scale,
+    GeneralXY_filter_scale,
+    GeneralXY_nofilter_affine,
+    GeneralXY_filter_affine,
+    GeneralXY_nofilter_persp,
+    GeneralXY_filter_persp
+};
+
+// If proc is one of the portable procs, replaces it with its SSE2 version.
+// The tables are passed by reference so that their sizes must match.
+template <size_t N>
+static void replace_matrix_proc(SkBitmapProcState::MatrixProc* proc,
+                                const SkBitmapProcState::MatrixProc (&portable)[N],
+                                const SkBitmapProcState::MatrixProc (&sse2)[N]) {
+    for (size_t i = 0; i < N; ++i) {
+        if (*proc == portable[i]) {
+            *proc = sse2[i];
+            return;
+        }
+    }
+}
+
 void SkBitmapProcState::platformProcs() {
     if (cachedHasSSSE3()) {
 #if !defined(SK_BUILD_FOR_ANDROID)
@@ -128,6 +218,12 @@ void SkBitmapProcState::platformProcs() {
         if (fSampleProc16 == S32_D16_filter_DX) {
             fSampleProc16 = S32_D16_filter_DX_SSE2;
         }
+
+        if (fSampleProc32 == S32_opaque_D32_filter_DXDY) {
+            fSampleProc32 = S32_opaque_D32_filter_DXDY_SSE2;
+        } else if (fSampleProc32 == S32_alpha_D32_filter_DXDY) {
+            fSampleProc32 = S32_alpha_D32_filter_DXDY_SSE2;
+        }
     }
 
     if (cachedHasSSSE3() || cachedHasSSE2()) {
@@ -142,6 +238,36 @@ void SkBitmapProcState::platformProcs() {
         } else if (fMatrixProc == ClampX_ClampY_nofilter_affine) {
             fMatrixProc = ClampX_ClampY_nofilter_affine_SSE2;
         }
+
+        if (fMatrixProc == ClampX_ClampY_filter_persp) {
+            fMatrixProc = ClampX_ClampY_filter_persp_SSE2;
+        } else if (fMatrixProc == ClampX_ClampY_nofilter_persp) {
+            fMatrixProc = ClampX_ClampY_nofilter_persp_SSE2;
+        }
+
+        // The SSE2 repeat and mirror procs scale by the bitmap's size in 16
+        // bit lanes.
+        if (fBitmap->width() <= 0xFFFF && fBitmap->height() <= 0xFFFF) {
+            if (SkShader::kRepeat_TileMode == fTileModeX &&
+                SkShader::kRepeat_TileMode == fTileModeY) {
+                replace_matrix_proc(&fMatrixProc, gRepeatProcs,
+                                    RepeatX_RepeatY_Procs_SSE2);
+            } else if (SkShader::kMirror_TileMode == fTileModeX &&
+                       SkShader::kMirror_TileMode == fTileModeY) {
+                replace_matrix_proc(&fMatrixProc, gGeneralProcs,
+                                    MirrorX_MirrorY_Procs_SSE2);
+            }
+        }
+
+        if (fSampleProc32 == S16_opaque_D32_filter_DX) {
+            fSampleProc32 = S16_opaque_D32_filter_DX_SSE2;
+        } else if (fSampleProc32 == S16_alpha_D32_filter_DX) {
+            fSampleProc32 = S16_alpha_D32_filter_DX_SSE2;
+        } else if (fSampleProc32 == S16_opaque_D32_filter_DXDY) {
+            fSampleProc32 = S16_opaque_D32_filter_DXDY_SSE2;
+        } else if (fSampleProc32 == S16_alpha_D32_filter_DXDY) {
+            fSampleProc32 = S16_alpha_D32_filter_DXDY_SSE2;
+        }
     }
 }
 
@@ -152,6 +278,13 @@ static SkBlitRow::Proc32 platform_32_procs[] = {
     S32A_Blend_BlitRow32_SSE2,          // S32A_Blend,
 };
 
+static SkBlitRow::Proc32 platform_32_procs_AVX2[] = {
+    NULL,                               // S32_Opaque,
+    S32_Blend_BlitRow32_AVX2,           // S32_Blend,
+    S32A_Opaque_BlitRow32_AVX2,         // S32A_Opaque
+    S32A_Blend_BlitRow32_AVX2,          // S32A_Blend,
+};
+
 SkBlitRow::Proc SkBlitRow::PlatformProcs4444(unsigned flags) {
     return NULL;
 }
@@ -161,7 +294,9 @@ SkBlitRow::Proc SkBlitRow::PlatformProcs565(unsigned flags) {
 }
 
 SkBlitRow::ColorProc SkBlitRow::PlatformColorProc() {
-    if (cachedHasSSE2()) {
+    if (cachedHasAVX2()) {
+        return Color32_AVX2;
+    } else if (cachedHasSSE2()) {
         return Color32_SSE2;
     } else {
         return NULL;
@@ -169,7 +304,9 @@ SkBlitRow::ColorProc SkBlitRow::PlatformColorProc() {
 }
 
 SkBlitRow::Proc32 SkBlitRow::PlatformProcs32(unsigned flags) {
-    if (cachedHasSSE2()) {
+    if (cachedHasAVX2()) {
+        return platform_32_procs_AVX2[flags];
+    } else if (cachedHasSSE2()) {
         return platform_32_procs[flags];
     } else {
         return NULL;
@@ -244,3 +381,36 @@ SkBlitRow::ColorRectProc PlatformColorRectProcFactory() {
         return NULL;
     }
 }
+
+SkProcCoeffXfermode* SkPlatformXfermodeFactory(const ProcCoeff& rec,
+                                               SkXfermode::Mode mode) {
+    if (cachedHasSSE2()) {
+        return SkPlatformXfermodeFactory_impl_SSE2(rec, mode);
+    } else {
+        return NULL;
+    }
+}
+
+bool SkBoxBlurGetPlatformProcs(SkBoxBlurProcs* procs) {
+    if (cachedHasSSE2()) {
+        return SkBoxBlurGetPlatformProcs_SSE2(procs);
+    } else {
+        return false;
+    }
+}
+
+bool SkConvolutionGetPlatformProcs(SkConvolutionProcs* procs) {
+    if (cachedHasSSE2()) {
+        return SkConvolutionGetPlatformProcs_SSE2(procs);
+    } else {
+        return false;
+    }
+}
+
+bool SkGradientGetPlatformProcs(SkGradientProcs* procs) {
+    if (cachedHasSSE2()) {
+        return SkGradientGetPlatformProcs_SSE2(procs);
+    } else {
+        return false;
+    }
+}
@@ -18,6 +18,7 @@
 #include "SkMask.h"
 #include "SkMaskGamma.h"
 #include "SkAdvancedTypefaceMetrics.h"
+#include "SkRTConf.h"
 #include "SkScalerContext.h"
 #include "SkStream.h"
 #include "SkString.h"
@@ -78,14 +79,53 @@ static bool isLCD(const SkScalerContext::Rec& rec) {
 
 struct SkFaceRec;
 
+/*  FreeType objects are not thread safe, so rather than one FT_Library behind
+    one global mutex we keep a small pool of libraries, each with its own mutex
+    and its own list of open faces. A scaler context is bound to one library
+    for its whole life (its FT_Size belongs to that library's copy of the face),
+    so contexts bound to different libraries generate glyphs concurrently.
+*/
+#ifndef SK_FREETYPE_LIBRARY_COUNT
+    #define SK_FREETYPE_LIBRARY_COUNT       4
+#endif
+
+/*  Faces that no scaler context is using any more stay open, most recently
+    used first, until their library has more than this many faces open. 0
+    closes every face as soon as its last scaler context goes away.
+*/
+#ifndef SK_FREETYPE_FACE_CACHE_LIMIT
+    #define SK_FREETYPE_FACE_CACHE_LIMIT    16
+#endif
+
+SK_CONF_DECLARE(int, c_FTFaceCacheLimit, "freetype.faceCacheLimit",
+                SK_FREETYPE_FACE_CACHE_LIMIT,
+                "Maximum number of open FreeType faces per library.");
+
+struct SkFTLibrary {
+    SkMutex     fMutex;
+    FT_Library  fLibrary;       // NULL until something needs it
+    int         fContextCount;  // scaler contexts bound to this library
+    SkFaceRec*  fFaceHead;      // open faces, most recently used first
+    int         fFaceCount;
+
+    SkFTLibrary() : fLibrary(NULL), fContextCount(0), fFaceHead(NULL), fFaceCount(0) {}
+};
+
 SK_DECLARE_STATIC_MUTEX(gFTMutex);
-static int          gFTCount;
-static FT_Library   gFTLibrary;
-static SkFaceRec*   gFaceRecHead;
 static bool         gLCDSupportValid;  // true iff |gLCDSupport| has been set.
 static bool         gLCDSupport;  // true iff LCD is supported by the runtime.
 static int          gLCDExtra;  // number of extra pixels for filtering.
 
+// Sticky copy of gLCDSupport that may be read without gFTMutex: zero until the
+// answer is known, then one of the values below. It is a single word, so a
+// reader sees either zero or the final answer.
+enum {
+    kLCDSupportUnknown,
+    kLCDSupported,
+    kLCDUnsupported
+};
+static volatile int32_t gLCDSupportSticky;
+
 /////////////////////////////////////////////////////////////////////////
 
 // FT_Library_SetLcdFilterWeights was introduced in FreeType 2.4.0.
@@ -97,61 +137,84 @@ static int          gLCDExtra;  // number of extra pixels for filtering.
 // Android >= Gingerbread (good)
 typedef FT_Error (*FT_Library_SetLcdFilterWeightsProc)(FT_Library, unsigned char*);
 
-// Caller must lock gFTMutex before calling this function.
-static bool InitFreetype() {
-    FT_Error err = FT_Init_FreeType(&gFTLibrary);
-    if (err) {
-        return false;
-    }
-
-    // Setup LCD filtering. This reduces color fringes for LCD smoothed glyphs.
+// Sets up LCD filtering on ftLibrary, and returns true if the runtime
+// supports it. This reduces color fringes for LCD smoothed glyphs.
+static bool setup_lcd_filter(FT_Library ftLibrary) {
 #ifdef FT_LCD_FILTER_H
     // Use default { 0x10, 0x40, 0x70, 0x40, 0x10 }, as it adds up to 0x110, simulating ink spread.
     // SetLcdFilter must be called before SetLcdFilterWeights.
-    err = FT_Library_SetLcdFilter(gFTLibrary, FT_LCD_FILTER_DEFAULT);
-    if (0 == err) {
-        gLCDSupport = true;
-        gLCDExtra = 2; //Using a filter adds one full pixel to each side.
+    FT_Error err = FT_Library_SetLcdFilter(ftLibrary, FT_LCD_FILTER_DEFAULT);
+    if (err) {
+        return false;
+    }
 
 #ifdef SK_FONTHOST_FREETYPE_USE_NORMAL_LCD_FILTER
-        // This also adds to 0x110 simulating ink spread, but provides better results than default.
-        static unsigned char gGaussianLikeHeavyWeights[] = { 0x1A, 0x43, 0x56, 0x43, 0x1A, };
+    // This also adds to 0x110 simulating ink spread, but provides better results than default.
+    static unsigned char gGaussianLikeHeavyWeights[] = { 0x1A, 0x43, 0x56, 0x43, 0x1A, };
 
 #if defined(SK_FONTHOST_FREETYPE_RUNTIME_VERSION) && \
-            SK_FONTHOST_FREETYPE_RUNTIME_VERSION > 0x020400
-        err = FT_Library_SetLcdFilterWeights(gFTLibrary, gGaussianLikeHeavyWeights);
+        SK_FONTHOST_FREETYPE_RUNTIME_VERSION > 0x020400
+    err = FT_Library_SetLcdFilterWeights(ftLibrary, gGaussianLikeHeavyWeights);
 #elif defined(SK_CAN_USE_DLOPEN) && SK_CAN_USE_DLOPEN == 1
-        //The FreeType library is already loaded, so symbols are available in process.
-        void* self = dlopen(NULL, RTLD_LAZY);
-        if (NULL != self) {
-            FT_Library_SetLcdFilterWeightsProc setLcdFilterWeights;
-            //The following cast is non-standard, but safe for POSIX.
-            *reinterpret_cast<void**>(&setLcdFilterWeights) = dlsym(self, "FT_Library_SetLcdFilterWeights");
-            dlclose(self);
-
-            if (NULL != setLcdFilterWeights) {
-                err = setLcdFilterWeights(gFTLibrary, gGaussianLikeHeavyWeights);
-            }
+    //The FreeType library is already loaded, so symbols are available in process.
+    void* self = dlopen(NULL, RTLD_LAZY);
+    if (NULL != self) {
+        FT_Library_SetLcdFilterWeightsProc setLcdFilterWeights;
+        //The following cast is non-standard, but safe for POSIX.
+        *reinterpret_cast<void**>(&setLcdFilterWeights) = dlsym(self, "FT_Library_SetLcdFilterWeights");
+        dlclose(self);
+
+        if (NULL != setLcdFilterWeights) {
+            err = setLcdFilterWeights(ftLibrary, gGaussianLikeHeavyWeights);
         }
+    }
 #endif
 #endif
-    }
+    return true;
 #else
-    gLCDSupport = false;
+    return false;
 #endif
-    gLCDSupportValid = true;
+}
+
+// Records whether the runtime supports LCD filtering. The globals are shared
+// by every pooled library, so only the first answer is kept.
+// Caller must lock gFTMutex before calling this function.
+static void set_lcd_support(bool lcdSupport) {
+    if (!gLCDSupportValid) {
+        gLCDSupport = lcdSupport;
+        gLCDExtra = lcdSupport ? 2 : 0; //Using a filter adds one full pixel to each side.
+        gLCDSupportValid = true;
+        gLCDSupportSticky = lcdSupport ? kLCDSupported : kLCDUnsupported;
+    }
+}
 
+// Caller must lock the mutex guarding *library before calling this function.
+static bool InitFreetype(FT_Library* library) {
+    FT_Error err = FT_Init_FreeType(library);
+    if (err) {
+        return false;
+    }
+    bool lcdSupport = setup_lcd_filter(*library);
+
+    SkAutoMutexAcquire  ac(gFTMutex);
+    set_lcd_support(lcdSupport);
     return true;
 }
 
 // Lazy, once, wrapper to ask the FreeType Library if it can support LCD text
 static bool is_lcd_supported() {
-    if (!gLCDSupportValid) {
-        SkAutoMutexAcquire  ac(gFTMutex);
+    int32_t sticky = gLCDSupportSticky;
+    if (kLCDSupportUnknown != sticky) {
+        return kLCDSupported == sticky;
+    }
+
+    SkAutoMutexAcquire  ac(gFTMutex);
 
-        if (!gLCDSupportValid) {
-            InitFreetype();
-            FT_Done_FreeType(gFTLibrary);
+    if (!gLCDSupportValid) {
+        FT_Library library;
+        if (0 == FT_Init_FreeType(&library)) {
+            set_lcd_support(setup_lcd_filter(library));
+            FT_Done_FreeType(library);
         }
     }
     return gLCDSupport;
@@ -180,8 +243,9 @@ protected:
     virtual SkUnichar generateGlyphToChar(uint16_t glyph) SK_OVERRIDE;
 
 private:
+    SkFTLibrary* fLibrary;          // the pooled library we are bound to
     SkFaceRec*  fFaceRec;
-    FT_Face     fFace;              // reference to shared face in gFaceRecHead
+    FT_Face     fFace;              // reference to shared face in fLibrary
     FT_Size     fFTSize;            // our own copy
     SkFixed     fScaleX, fScaleY;
     FT_Matrix   fMatrix22;
@@ -192,7 +256,7 @@ private:
     FT_Error setupSize();
     void getBBoxForCurrentGlyph(SkGlyph* glyph, FT_BBox* bbox,
                                 bool snapToPixelBoundary = false);
-    // Caller must lock gFTMutex before calling this function.
+    // Caller must lock fLibrary->fMutex before calling this function.
     void updateGlyphIfLCD(SkGlyph* glyph);
 };
 
@@ -258,17 +322,90 @@ SkFaceRec::SkFaceRec(SkStream* strm, uint32_t fontID)
     fFTStream.close = sk_stream_close;
 }
 
+// Returns the pool of libraries. We leak this, so we don't incur any shutdown
+// cost of closing every face.
+static SkFTLibrary* get_library_pool() {
+    static SkFTLibrary* gPool = SkNEW_ARRAY(SkFTLibrary, SK_FREETYPE_LIBRARY_COUNT);
+    return gPool;
+}
+
+// Picks the library for a new scaler context, spreading them round-robin.
+static SkFTLibrary* next_library() {
+    static int32_t gNextLibrary;
+    int32_t index = sk_atomic_inc(&gNextLibrary) & 0x7FFFFFFF;
+    return &get_library_pool()[index % SK_FREETYPE_LIBRARY_COUNT];
+}
+
+// Caller must lock library->fMutex before calling this function.
+static bool ref_ft_library(SkFTLibrary* library) {
+    if (NULL == library->fLibrary && !InitFreetype(&library->fLibrary)) {
+        library->fLibrary = NULL;
+        return false;
+    }
+    return true;
+}
+
+// Closes the library once no scaler context or face is left in it.
+// Caller must lock library->fMutex before calling this function.
+static void unref_ft_library(SkFTLibrary* library) {
+    if (0 == library->fContextCount && NULL == library->fFaceHead &&
+            NULL != library->fLibrary) {
+//        SkDEBUGF(("FT_Done_FreeType\n"));
+        FT_Done_FreeType(library->fLibrary);
+        library->fLibrary = NULL;
+    }
+}
+
+// Closes the least recently used faces that nobody references until the
+// library is back within the face cache limit.
+// Caller must lock library->fMutex before calling this function.
+static void purge_ft_faces(SkFTLibrary* library) {
+    while (library->fFaceCount > SkMax32(c_FTFaceCacheLimit, 0)) {
+        SkFaceRec* victim = NULL;
+        SkFaceRec* victimPrev = NULL;
+        SkFaceRec* prev = NULL;
+        for (SkFaceRec* rec = library->fFaceHead; rec; rec = rec->fNext) {
+            if (0 == rec->fRefCnt) {
+                victim = rec;
+                victimPrev = prev;
+            }
+            prev = rec;
+        }
+        if (NULL == victim) {
+            return;     // every open face is in use
+        }
+
+        if (victimPrev) {
+            victimPrev->fNext = victim->fNext;
+        } else {
+            library->fFaceHead = victim->fNext;
+        }
+        library->fFaceCount -= 1;
+        FT_Done_Face(victim->fFace);
+        SkDELETE(victim);
+    }
+}
+
 // Will return 0 on failure
-// Caller must lock gFTMutex before calling this function.
-static SkFaceRec* ref_ft_face(const SkTypeface* typeface) {
+// Caller must lock library->fMutex, and have initialized library->fLibrary,
+// before calling this function.
+static SkFaceRec* ref_ft_face(SkFTLibrary* library, const SkTypeface* typeface) {
     const SkFontID fontID = typeface->uniqueID();
-    SkFaceRec* rec = gFaceRecHead;
+    SkFaceRec* rec = library->fFaceHead;
+    SkFaceRec* prev = NULL;
     while (rec) {
         if (rec->fFontID == fontID) {
             SkASSERT(rec->fFace);
             rec->fRefCnt += 1;
+            // move to the front, to keep the list in LRU order
+            if (prev) {
+                prev->fNext = rec->fNext;
+                rec->fNext = library->fFaceHead;
+                library->fFaceHead = rec;
+            }
             return rec;
         }
+        prev = rec;
         rec = rec->fNext;
     }
 
@@ -296,7 +433,7 @@ static SkFaceRec* ref_ft_face(const SkTypeface* typeface) {
         args.stream = &rec->fFTStream;
     }
 
-    FT_Error err = FT_Open_Face(gFTLibrary, &args, face_index, &rec->fFace);
+    FT_Error err = FT_Open_Face(library->fLibrary, &args, face_index, &rec->fFace);
     if (err) {    // bad filename, try the default font
         fprintf(stderr, "ERROR: unable to open font '%x'\n", fontID);
         SkDELETE(rec);
@@ -304,36 +441,42 @@ static SkFaceRec* ref_ft_face(const SkTypeface* typeface) {
     } else {
         SkASSERT(rec->fFace);
         //fprintf(stderr, "Opened font '%s'\n", filename.c_str());
-        rec->fNext = gFaceRecHead;
-        gFaceRecHead = rec;
+        rec->fNext = library->fFaceHead;
+        library->fFaceHead = rec;
+        library->fFaceCount += 1;
+        purge_ft_faces(library);
         return rec;
     }
 }
 
-// Caller must lock gFTMutex before calling this function.
-static void unref_ft_face(FT_Face face) {
-    SkFaceRec*  rec = gFaceRecHead;
-    SkFaceRec*  prev = NULL;
-    while (rec) {
-        SkFaceRec* next = rec->fNext;
-        if (rec->fFace == face) {
-            if (--rec->fRefCnt == 0) {
-                if (prev) {
-                    prev->fNext = next;
-                } else {
-                    gFaceRecHead = next;
-                }
-                FT_Done_Face(face);
-                SkDELETE(rec);
-            }
-            return;
-        }
-        prev = rec;
-        rec = next;
+// The face stays open for the next scaler context that wants it, until
+// purge_ft_faces() evicts it.
+// Caller must lock library->fMutex before calling this function.
+static void unref_ft_face(SkFTLibrary* library, SkFaceRec* rec) {
+    SkASSERT(rec->fRefCnt > 0);
+    if (--rec->fRefCnt == 0) {
+        purge_ft_faces(library);
     }
-    SkDEBUGFAIL("shouldn't get here, face not in list");
 }
 
+// Locks a library from the pool, initializing it if needed, for a one-off
+// query that is not bound to a scaler context.
+class SkAutoFTLibrary : SkNoncopyable {
+public:
+    SkAutoFTLibrary() : fLibrary(next_library()), fAcquire(fLibrary->fMutex) {
+        if (!ref_ft_library(fLibrary)) {
+            sk_throw();
+        }
+    }
+    ~SkAutoFTLibrary() { unref_ft_library(fLibrary); }
+
+    SkFTLibrary* get() const { return fLibrary; }
+
+private:
+    SkFTLibrary*        fLibrary;
+    SkAutoMutexAcquire  fAcquire;
+};
+
 ///////////////////////////////////////////////////////////////////////////
 
 // Work around for old versions of freetype.
@@ -451,15 +594,8 @@ SkAdvancedTypefaceMetrics* SkTypeface_FreeType::onGetAdvancedTypefaceMetrics(
 #if defined(SK_BUILD_FOR_MAC)
     return NULL;
 #else
-    SkAutoMutexAcquire ac(gFTMutex);
-    FT_Library libInit = NULL;
-    if (gFTCount == 0) {
-        if (!InitFreetype())
-            sk_throw();
-        libInit = gFTLibrary;
-    }
-    SkAutoTCallIProc<struct FT_LibraryRec_, FT_Done_FreeType> ftLib(libInit);
-    SkFaceRec* rec = ref_ft_face(this);
+    SkAutoFTLibrary library;
+    SkFaceRec* rec = ref_ft_face(library.get(), this);
     if (NULL == rec)
         return NULL;
     FT_Face face = rec->fFace;
@@ -624,7 +760,7 @@ SkAdvancedTypefaceMetrics* SkTypeface_FreeType::onGetAdvancedTypefaceMetrics(
     if (!canEmbed(face))
         info->fType = SkAdvancedTypefaceMetrics::kNotEmbeddable_Font;
 
-    unref_ft_face(face);
+    unref_ft_face(library.get(), rec);
     return info;
 #endif
 }
@@ -696,20 +832,13 @@ void SkTypeface_FreeType::onFilterRec(SkScalerContextRec* rec) const {
 }
 
 int SkTypeface_FreeType::onGetUPEM() const {
-    SkAutoMutexAcquire ac(gFTMutex);
-    FT_Library libInit = NULL;
-    if (gFTCount == 0) {
-        if (!InitFreetype())
-            sk_throw();
-        libInit = gFTLibrary;
-    }
-    SkAutoTCallIProc<struct FT_LibraryRec_, FT_Done_FreeType> ftLib(libInit);
-    SkFaceRec *rec = ref_ft_face(this);
+    SkAutoFTLibrary library;
+    SkFaceRec *rec = ref_ft_face(library.get(), this);
     int unitsPerEm = 0;
 
     if (rec != NULL && rec->fFace != NULL) {
         unitsPerEm = rec->fFace->units_per_EM;
-        unref_ft_face(rec->fFace);
+        unref_ft_face(library.get(), rec);
     }
 
     return unitsPerEm;
@@ -718,19 +847,18 @@ int SkTypeface_FreeType::onGetUPEM() const {
 SkScalerContext_FreeType::SkScalerContext_FreeType(SkTypeface* typeface,
                                                    const SkDescriptor* desc)
         : SkScalerContext_FreeType_Base(typeface, desc) {
-    SkAutoMutexAcquire  ac(gFTMutex);
+    fLibrary = next_library();
+    SkAutoMutexAcquire  ac(fLibrary->fMutex);
 
-    if (gFTCount == 0) {
-        if (!InitFreetype()) {
-            sk_throw();
-        }
+    if (!ref_ft_library(fLibrary)) {
+        sk_throw();
     }
-    ++gFTCount;
+    ++fLibrary->fContextCount;
 
     // load the font file
     fFTSize = NULL;
     fFace = NULL;
-    fFaceRec = ref_ft_face(typeface);
+    fFaceRec = ref_ft_face(fLibrary, typeface);
     if (NULL == fFaceRec) {
         return;
     }
@@ -896,20 +1024,17 @@ SkScalerContext_FreeType::SkScalerContext_FreeType(SkTypeface* typeface,
 }
 
 SkScalerContext_FreeType::~SkScalerContext_FreeType() {
-    SkAutoMutexAcquire  ac(gFTMutex);
+    SkAutoMutexAcquire  ac(fLibrary->fMutex);
 
     if (fFTSize != NULL) {
         FT_Done_Size(fFTSize);
     }
 
-    if (fFace != NULL) {
-        unref_ft_face(fFace);
-    }
-    if (--gFTCount == 0) {
-//        SkDEBUGF(("FT_Done_FreeType\n"));
-        FT_Done_FreeType(gFTLibrary);
-        SkDEBUGCODE(gFTLibrary = NULL;)
+    if (fFaceRec != NULL) {
+        unref_ft_face(fLibrary, fFaceRec);
     }
+    --fLibrary->fContextCount;
+    unref_ft_library(fLibrary);
 }
 
 /*  We call this before each use of the fFace, since we may be sharing
@@ -959,7 +1084,7 @@ void SkScalerContext_FreeType::generateAdvance(SkGlyph* glyph) {
     * which are very cheap to compute with some font formats...
     */
     if (fDoLinearMetrics) {
-        SkAutoMutexAcquire  ac(gFTMutex);
+        SkAutoMutexAcquire  ac(fLibrary->fMutex);
 
         if (this->setupSize()) {
             glyph->zeroMetrics();
@@ -1038,7 +1163,7 @@ void SkScalerContext_FreeType::updateGlyphIfLCD(SkGlyph* glyph) {
 }
 
 void SkScalerContext_FreeType::generateMetrics(SkGlyph* glyph) {
-    SkAutoMutexAcquire  ac(gFTMutex);
+    SkAutoMutexAcquire  ac(fLibrary->fMutex);
 
     glyph->fRsbDelta = 0;
     glyph->fLsbDelta = 0;
@@ -1091,7 +1216,7 @@ void SkScalerContext_FreeType::generateMetrics(SkGlyph* glyph) {
       case FT_GLYPH_FORMAT_BITMAP:
         if (fRec.fFlags & kEmbolden_Flag) {
             FT_GlyphSlot_Own_Bitmap(fFace->glyph);
-            FT_Bitmap_Embolden(gFTLibrary, &fFace->glyph->bitmap, kBitmapEmboldenStrength, 0);
+            FT_Bitmap_Embolden(fLibrary->fLibrary, &fFace->glyph->bitmap, kBitmapEmboldenStrength, 0);
         }
 
         if (fRec.fFlags & SkScalerContext::kVertical_Flag) {
@@ -1146,7 +1271,7 @@ void SkScalerContext_FreeType::generateMetrics(SkGlyph* glyph) {
 
 
 void SkScalerContext_FreeType::generateImage(const SkGlyph& glyph) {
-    SkAutoMutexAcquire  ac(gFTMutex);
+    SkAutoMutexAcquire  ac(fLibrary->fMutex);
 
     FT_Error    err;
 
@@ -1169,7 +1294,7 @@ void SkScalerContext_FreeType::generateImage(const SkGlyph& glyph) {
 
 void SkScalerContext_FreeType::generatePath(const SkGlyph& glyph,
                                             SkPath* path) {
-    SkAutoMutexAcquire  ac(gFTMutex);
+    SkAutoMutexAcquire  ac(fLibrary->fMutex);
 
     SkASSERT(&glyph && path);
 
@@ -1210,7 +1335,7 @@ void SkScalerContext_FreeType::generateFontMetrics(SkPaint::FontMetrics* mx,
         return;
     }
 
-    SkAutoMutexAcquire  ac(gFTMutex);
+    SkAutoMutexAcquire  ac(fLibrary->fMutex);
 
     if (this->setupSize()) {
         ERROR:
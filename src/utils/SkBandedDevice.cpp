@@ -0,0 +1,270 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkBandedDevice.h"
+#include "SkDraw.h"
+#include "SkPath.h"
+#include "SkRasterClip.h"
+#include "SkShader.h"
+#include "SkTemplates.h"
+#include "SkThreadPool.h"
+
+// Issues one draw call through whichever (band-clipped) SkDraw it is handed.
+class SkBandDrawer {
+public:
+    virtual ~SkBandDrawer() {}
+    virtual void draw(const SkDraw&, const SkPaint&) const = 0;
+};
+
+class RectBandDrawer : public SkBandDrawer {
+public:
+    RectBandDrawer(const SkRect& rect) : fRect(rect) {}
+
+    virtual void draw(const SkDraw& draw, const SkPaint& paint) const SK_OVERRIDE {
+        draw.drawRect(fRect, paint);
+    }
+
+private:
+    const SkRect& fRect;
+};
+
+class PathBandDrawer : public SkBandDrawer {
+public:
+    PathBandDrawer(const SkPath& path, const SkMatrix* prePathMatrix)
+        : fPath(path)
+        , fPrePathMatrix(prePathMatrix) {}
+
+    virtual void draw(const SkDraw& draw, const SkPaint& paint) const SK_OVERRIDE {
+        // The path is shared by every band, so it must never be modified in place.
+        draw.drawPath(fPath, paint, fPrePathMatrix, false);
+    }
+
+private:
+    const SkPath&   fPath;
+    const SkMatrix* fPrePathMatrix;
+};
+
+class BitmapBandDrawer : public SkBandDrawer {
+public:
+    BitmapBandDrawer(const SkBitmap& bitmap, const SkMatrix& matrix)
+        : fBitmap(bitmap)
+        , fMatrix(matrix) {}
+
+    virtual void draw(const SkDraw& draw, const SkPaint& paint) const SK_OVERRIDE {
+        draw.drawBitmap(fBitmap, fMatrix, paint);
+    }
+
+private:
+    const SkBitmap& fBitmap;
+    const SkMatrix& fMatrix;
+};
+
+struct Band {
+    SkRasterClip fRC;
+    SkDraw       fDraw;
+    SkPaint      fPaint;
+};
+
+struct BandContext {
+    const SkBandDrawer* fDrawer;
+    Band*               fBands;
+};
+
+static void draw_band(void* context, int index) {
+    BandContext* ctx = static_cast<BandContext*>(context);
+    const Band& band = ctx->fBands[index];
+    ctx->fDrawer->draw(band.fDraw, band.fPaint);
+}
+
+static bool is_plain_bitmap_shader(const SkShader* shader) {
+    return SkShader::kDefault_BitmapType == shader->asABitmap(NULL, NULL, NULL);
+}
+
+// Shaders keep per-draw state in setContext(), so no two bands may share one. Bitmap
+// shaders (which is what drawBitmapRect uses) are cheap to recreate.
+static SkShader* clone_bitmap_shader(const SkShader* shader) {
+    SkBitmap bitmap;
+    SkShader::TileMode xy[2];
+    if (SkShader::kDefault_BitmapType != shader->asABitmap(&bitmap, NULL, xy)) {
+        return NULL;
+    }
+    SkShader* clone = SkShader::CreateBitmapShader(bitmap, xy[0], xy[1]);
+    if (NULL != clone) {
+        clone->setLocalMatrix(shader->getLocalMatrix());
+    }
+    return clone;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+SkBandedDevice::SkBandedDevice(const SkBitmap& bitmap, SkThreadPool* pool)
+    : INHERITED(bitmap)
+    , fPool(pool)
+    , fMinPixelsToBand(kDefaultMinPixelsToBand) {
+    SkASSERT(NULL != pool);
+}
+
+SkBandedDevice::SkBandedDevice(SkBitmap::Config config, int width, int height, bool isOpaque,
+                               SkThreadPool* pool)
+    : INHERITED(config, width, height, isOpaque)
+    , fPool(pool)
+    , fMinPixelsToBand(kDefaultMinPixelsToBand) {
+    SkASSERT(NULL != pool);
+}
+
+SkDevice* SkBandedDevice::onCreateCompatibleDevice(SkBitmap::Config config,
+                                                   int width, int height,
+                                                   bool isOpaque,
+                                                   Usage usage) {
+    // Layers get the same treatment as the base device.
+    SkBandedDevice* device = SkNEW_ARGS(SkBandedDevice, (config, width, height, isOpaque,
+                                                         fPool));
+    device->setMinPixelsToBand(fMinPixelsToBand);
+    return device;
+}
+
+bool SkBandedDevice::canBand(const SkDraw& draw, const SkPaint& paint) const {
+    if (0 == fPool->count() || paint.isNoDrawAnnotation()) {
+        return false;
+    }
+    // Bounders and procs expect to be called once per draw, from the calling thread.
+    if (NULL != draw.fBounder || NULL != draw.fProcs || draw.fMatrix->hasPerspective()) {
+        return false;
+    }
+    // Mask filters and rasterizers work on the whole geometry at once, and path effects
+    // would be recomputed for every band.
+    if (NULL != paint.getMaskFilter() || NULL != paint.getRasterizer() ||
+        NULL != paint.getPathEffect()) {
+        return false;
+    }
+    if (NULL != paint.getShader() && !is_plain_bitmap_shader(paint.getShader())) {
+        return false;
+    }
+    return true;
+}
+
+bool SkBandedDevice::drawInBands(const SkDraw& draw, const SkPaint& paint,
+                                 const SkRect& devBounds, const SkBandDrawer& drawer) {
+    SkIRect bounds;
+    devBounds.roundOut(&bounds);
+    // Antialiasing and hairlines may touch the pixels just outside the geometry.
+    bounds.outset(1, 1);
+    if (!bounds.intersect(draw.fRC->getBounds())) {
+        return false;
+    }
+    if (static_cast<int64_t>(bounds.width()) * bounds.height() < fMinPixelsToBand) {
+        return false;
+    }
+
+    // A couple of bands per thread (counting the caller, which helps) evens out bands that
+    // happen to be cheaper than others.
+    const int bandCount = SkMin32(bounds.height() / kMinBandHeight, 2 * (fPool->count() + 1));
+    if (bandCount < 2) {
+        return false;
+    }
+
+    SkAutoTArray<Band> bands(bandCount);
+    for (int i = 0; i < bandCount; i++) {
+        Band& band = bands[i];
+        const int top = bounds.fTop + bounds.height() * i / bandCount;
+        const int bottom = bounds.fTop + bounds.height() * (i + 1) / bandCount;
+        band.fRC.op(SkIRect::MakeLTRB(bounds.fLeft, top, bounds.fRight, bottom),
+                    SkRegion::kReplace_Op);
+        band.fRC.op(*draw.fRC, SkRegion::kIntersect_Op);
+
+        band.fDraw = draw;
+        band.fDraw.fRC = &band.fRC;
+        band.fDraw.fClip = &band.fRC.forceGetBW();
+
+        band.fPaint = paint;
+        if (NULL != paint.getShader()) {
+            SkShader* shader = clone_bitmap_shader(paint.getShader());
+            if (NULL == shader) {
+                return false;
+            }
+            band.fPaint.setShader(shader)->unref();
+        }
+    }
+
+    BandContext context;
+    context.fDrawer = &drawer;
+    context.fBands = bands.get();
+    fPool->parallelFor(bandCount, draw_band, &context);
+    return true;
+}
+
+void SkBandedDevice::drawRect(const SkDraw& draw, const SkRect& r, const SkPaint& paint) {
+    if (this->canBand(draw, paint) && paint.canComputeFastBounds()) {
+        SkRect sorted = r;
+        sorted.sort();
+        SkRect storage, devBounds;
+        draw.fMatrix->mapRect(&devBounds, paint.computeFastBounds(sorted, &storage));
+
+        RectBandDrawer drawer(r);
+        if (this->drawInBands(draw, paint, devBounds, drawer)) {
+            return;
+        }
+    }
+    this->INHERITED::drawRect(draw, r, paint);
+}
+
+void SkBandedDevice::drawPath(const SkDraw& draw, const SkPath& path, const SkPaint& paint,
+                              const SkMatrix* prePathMatrix, bool pathIsMutable) {
+    if (this->canBand(draw, paint) && paint.canComputeFastBounds()) {
+        SkRect devBounds;
+        if (path.isInverseFillType()) {
+            devBounds.set(draw.fRC->getBounds());
+        } else {
+            SkRect pathBounds = path.getBounds();
+            if (NULL != prePathMatrix) {
+                prePathMatrix->mapRect(&pathBounds);
+            }
+            SkRect storage;
+            draw.fMatrix->mapRect(&devBounds, paint.computeFastBounds(pathBounds, &storage));
+        }
+
+        // SkPath computes its bounds and convexity lazily; do it now, before the bands share
+        // the path across threads.
+        path.updateBoundsCache();
+        (void)path.getConvexity();
+
+        PathBandDrawer drawer(path, prePathMatrix);
+        if (this->drawInBands(draw, paint, devBounds, drawer)) {
+            return;
+        }
+    }
+    this->INHERITED::drawPath(draw, path, paint, prePathMatrix, pathIsMutable);
+}
+
+void SkBandedDevice::drawBitmap(const SkDraw& draw, const SkBitmap& bitmap,
+                                const SkIRect* srcRect, const SkMatrix& matrix,
+                                const SkPaint& paint) {
+    if (this->canBand(draw, paint)) {
+        SkBitmap tmp;    // storage if we need a subset of bitmap
+        const SkBitmap* bitmapPtr = &bitmap;
+        if (srcRect) {
+            if (!bitmap.extractSubset(&tmp, *srcRect)) {
+                return;     // extraction failed
+            }
+            bitmapPtr = &tmp;
+        }
+
+        SkMatrix total;
+        total.setConcat(*draw.fMatrix, matrix);
+        SkRect devBounds;
+        total.mapRect(&devBounds, SkRect::MakeWH(SkIntToScalar(bitmapPtr->width()),
+                                                 SkIntToScalar(bitmapPtr->height())));
+
+        // Lock once up front, rather than having every band race to decode the pixels.
+        SkAutoLockPixels alp(*bitmapPtr);
+        BitmapBandDrawer drawer(*bitmapPtr, matrix);
+        if (this->drawInBands(draw, paint, devBounds, drawer)) {
+            return;
+        }
+    }
+    this->INHERITED::drawBitmap(draw, bitmap, srcRect, matrix, paint);
+}
@@ -10,6 +10,8 @@
 
 #include "SkChunkAlloc.h"
 #include "SkColorFilter.h"
+#include "SkCondVar.h"
+#include "SkDeque.h"
 #include "SkDevice.h"
 #include "SkDrawFilter.h"
 #include "SkGPipe.h"
@@ -17,6 +19,7 @@
 #include "SkPaintPriv.h"
 #include "SkRRect.h"
 #include "SkShader.h"
+#include "SkThreadUtils.h"
 
 enum {
     // Deferred canvas will auto-flush when recording reaches this limit
@@ -24,6 +27,13 @@ enum {
     kDeferredCanvasBitmapSizeThreshold = ~0U, // Disables this feature
 };
 
+// Threaded playback needs SkCondVar, which only works with these.
+#if defined(SK_USE_POSIX_THREADS) || defined(SK_BUILD_FOR_WIN32)
+    #define SK_DEFERRED_CANVAS_THREADS 1
+#else
+    #define SK_DEFERRED_CANVAS_THREADS 0
+#endif
+
 enum PlaybackMode {
     kNormal_PlaybackMode,
     kSilent_PlaybackMode,
@@ -66,9 +76,12 @@ public:
     virtual ~DeferredPipeController();
     virtual void* requestBlock(size_t minRequest, size_t* actual) SK_OVERRIDE;
     virtual void notifyWritten(size_t bytes) SK_OVERRIDE;
-    void playback(bool silent);
-    bool hasPendingCommands() const { return fAllocator.blockCount() != 0; }
-    size_t storageAllocatedForRecording() const { return fAllocator.totalCapacity(); }
+    virtual void playback(bool silent);
+    virtual bool hasPendingCommands() const { return fAllocator.blockCount() != 0; }
+    virtual size_t storageAllocatedForRecording() const { return fAllocator.totalCapacity(); }
+    virtual void setMaxStorage(size_t) {}
+protected:
+    SkGPipeReader fReader;
 private:
     enum {
         kMinBlockSize = 4096
@@ -82,7 +95,6 @@ private:
     size_t fBytesWritten;
     SkChunkAlloc fAllocator;
     SkTDArray<PipeBlock> fBlockList;
-    SkGPipeReader fReader;
 };
 
 DeferredPipeController::DeferredPipeController() :
@@ -133,6 +145,225 @@ void DeferredPipeController::playback(bool silent) {
     fAllocator.reset();
 }
 
+#if SK_DEFERRED_CANVAS_THREADS
+
+//-----------------------------------------------------------------------------
+// ThreadedPipeController
+//-----------------------------------------------------------------------------
+
+// Plays commands back on a thread of its own as they are recorded. Written
+// bytes are handed over a range at a time, and the thread frees each block
+// once it has played all of it. The recording thread only waits when the
+// blocks not yet freed would take more than the maximum storage, or when
+// playback() asks it to wait for everything handed over to be played.
+// The writer must use SkGPipeWriter::kCrossProcess_Flag, so that no state,
+// such as the bitmap heap, is shared between the two threads.
+class ThreadedPipeController : public DeferredPipeController {
+public:
+    ThreadedPipeController(size_t maxStorage);
+    virtual ~ThreadedPipeController();
+    virtual void* requestBlock(size_t minRequest, size_t* actual) SK_OVERRIDE;
+    virtual void notifyWritten(size_t bytes) SK_OVERRIDE;
+    virtual void playback(bool silent) SK_OVERRIDE;
+    // Anything handed over is played before playback() returns, so only the
+    // current block can hold commands at any other time.
+    virtual bool hasPendingCommands() const SK_OVERRIDE { return NULL != fBlock; }
+    virtual size_t storageAllocatedForRecording() const SK_OVERRIDE;
+    virtual void setMaxStorage(size_t maxStorage) SK_OVERRIDE;
+private:
+    enum {
+        kMinBlockSize = 16 * 1024,
+        // Written bytes are handed over once there are this many, so that
+        // playback starts long before the block is full.
+        kMinSubmitSize = 1024
+    };
+    struct PipeRange {
+        void* fBlock;
+        size_t fOffset;
+        size_t fSize;
+        size_t fCapacity;
+        bool fLast;         // the thread frees fBlock after playing this range
+    };
+
+    // Hands what has been written to the current block over to the thread.
+    void submit(bool lastRange);
+    void run();
+    static void Run(void* controller);
+
+    // Producer state
+    void* fBlock;
+    size_t fBlockCapacity;
+    size_t fBytesWritten;
+    size_t fBytesSubmitted;
+
+    // Shared state, guarded by fCondVar
+    mutable SkCondVar fCondVar;
+    SkDeque fRanges;
+    size_t fStorageAllocated;
+    size_t fMaxStorage;
+    bool fPlaying;
+    bool fSilent;
+    bool fDone;
+
+    SkThread fThread;
+
+    typedef DeferredPipeController INHERITED;
+};
+
+ThreadedPipeController::ThreadedPipeController(size_t maxStorage)
+    : fBlock(NULL)
+    , fBlockCapacity(0)
+    , fBytesWritten(0)
+    , fBytesSubmitted(0)
+    , fRanges(sizeof(PipeRange), 16)
+    , fStorageAllocated(0)
+    , fMaxStorage(maxStorage)
+    , fPlaying(false)
+    , fSilent(false)
+    , fDone(false)
+    , fThread(&ThreadedPipeController::Run, this) {
+    fThread.start();
+}
+
+ThreadedPipeController::~ThreadedPipeController() {
+    fCondVar.lock();
+    fDone = true;
+    fCondVar.signal();
+    fCondVar.unlock();
+    fThread.join();
+
+    // Anything left was never meant to be drawn.
+    while (!fRanges.empty()) {
+        PipeRange* range = static_cast<PipeRange*>(fRanges.front());
+        if (range->fLast) {
+            sk_free(range->fBlock);
+        }
+        fRanges.pop_front();
+    }
+    sk_free(fBlock);
+}
+
+void ThreadedPipeController::Run(void* controller) {
+    static_cast<ThreadedPipeController*>(controller)->run();
+}
+
+void ThreadedPipeController::run() {
+    fCondVar.lock();
+    for (;;) {
+        while (fRanges.empty() && !fDone) {
+            fCondVar.wait();
+        }
+        if (fDone) {
+            break;
+        }
+        PipeRange range = *static_cast<PipeRange*>(fRanges.front());
+        fRanges.pop_front();
+        uint32_t flags = fSilent ? SkGPipeReader::kSilent_PlaybackFlag : 0;
+        fPlaying = true;
+        fCondVar.unlock();
+
+        if (range.fSize > 0) {
+            fReader.playback(static_cast<char*>(range.fBlock) + range.fOffset, range.fSize,
+                             flags);
+        }
+        if (range.fLast) {
+            sk_free(range.fBlock);
+        }
+
+        fCondVar.lock();
+        fPlaying = false;
+        if (range.fLast) {
+            fStorageAllocated -= range.fCapacity;
+        }
+        // The recording thread may be waiting for room, or for playback to finish.
+        fCondVar.broadcast();
+    }
+    fCondVar.unlock();
+}
+
+void ThreadedPipeController::submit(bool lastRange) {
+    SkASSERT(NULL != fBlock);
+    PipeRange range;
+    range.fBlock = fBlock;
+    range.fOffset = fBytesSubmitted;
+    range.fSize = fBytesWritten - fBytesSubmitted;
+    range.fCapacity = fBlockCapacity;
+    range.fLast = lastRange;
+    fBytesSubmitted = fBytesWritten;
+
+    fCondVar.lock();
+    *static_cast<PipeRange*>(fRanges.push_back()) = range;
+    fCondVar.signal();
+    fCondVar.unlock();
+
+    if (lastRange) {
+        fBlock = NULL;
+    }
+}
+
+void* ThreadedPipeController::requestBlock(size_t minRequest, size_t* actual) {
+    if (fBlock) {
+        this->submit(true);
+    }
+    size_t blockSize = SkMax32(minRequest, kMinBlockSize);
+
+    fCondVar.lock();
+    // Wait for the thread to free enough blocks, as long as it has any to free.
+    while (fStorageAllocated > 0 && fStorageAllocated + blockSize > fMaxStorage) {
+        fCondVar.wait();
+    }
+    fStorageAllocated += blockSize;
+    fCondVar.unlock();
+
+    fBlock = sk_malloc_throw(blockSize);
+    fBlockCapacity = blockSize;
+    fBytesWritten = 0;
+    fBytesSubmitted = 0;
+    *actual = blockSize;
+    return fBlock;
+}
+
+void ThreadedPipeController::notifyWritten(size_t bytes) {
+    fBytesWritten += bytes;
+    if (fBytesWritten - fBytesSubmitted >= kMinSubmitSize) {
+        this->submit(false);
+    }
+}
+
+void ThreadedPipeController::playback(bool silent) {
+    if (NULL == fBlock) {
+        return;
+    }
+    fCondVar.lock();
+    // Whatever has been handed over but not played yet is skipped as well.
+    fSilent = silent;
+    fCondVar.unlock();
+
+    this->submit(true);
+
+    fCondVar.lock();
+    while (!fRanges.empty() || fPlaying) {
+        fCondVar.wait();
+    }
+    fSilent = false;
+    fCondVar.unlock();
+}
+
+size_t ThreadedPipeController::storageAllocatedForRecording() const {
+    fCondVar.lock();
+    size_t storageAllocated = fStorageAllocated;
+    fCondVar.unlock();
+    return storageAllocated;
+}
+
+void ThreadedPipeController::setMaxStorage(size_t maxStorage) {
+    fCondVar.lock();
+    fMaxStorage = maxStorage;
+    fCondVar.unlock();
+}
+
+#endif
+
 //-----------------------------------------------------------------------------
 // DeferredDevice
 //-----------------------------------------------------------------------------
@@ -156,6 +387,8 @@ public:
     void skipPendingCommands();
     void setMaxRecordingStorage(size_t);
     void recordedDrawCommand();
+    void setThreadedPlayback(bool threaded);
+    bool isThreadedPlayback() const { return fThreadedPlayback; }
 
     virtual uint32_t getDeviceCapabilities() SK_OVERRIDE;
     virtual int width() const SK_OVERRIDE;
@@ -237,8 +470,9 @@ private:
     virtual void flush();
 
     void beginRecording();
+    void endRecording();
 
-    DeferredPipeController fPipeController;
+    DeferredPipeController* fPipeController;
     SkGPipeWriter  fPipeWriter;
     SkDevice* fImmediateDevice;
     SkCanvas* fImmediateCanvas;
@@ -248,6 +482,7 @@ private:
     size_t fMaxRecordingStorageBytes;
     size_t fPreviousStorageAllocated;
     size_t fBitmapSizeThreshold;
+    bool fThreadedPlayback;
 };
 
 DeferredDevice::DeferredDevice(
@@ -256,42 +491,78 @@ DeferredDevice::DeferredDevice(
              immediateDevice->width(), immediateDevice->height(),
              immediateDevice->isOpaque(),
              immediateDevice->getDeviceProperties())
+    , fPipeController(NULL)
     , fRecordingCanvas(NULL)
     , fFreshFrame(true)
     , fPreviousStorageAllocated(0)
-    , fBitmapSizeThreshold(kDeferredCanvasBitmapSizeThreshold){
+    , fBitmapSizeThreshold(kDeferredCanvasBitmapSizeThreshold)
+    , fThreadedPlayback(false) {
 
     fMaxRecordingStorageBytes = kDefaultMaxRecordingStorageBytes;
     fNotificationClient = notificationClient;
     fImmediateDevice = immediateDevice; // ref counted via fImmediateCanvas
     fImmediateCanvas = SkNEW_ARGS(SkCanvas, (fImmediateDevice));
-    fPipeController.setPlaybackCanvas(fImmediateCanvas);
     this->beginRecording();
 }
 
 DeferredDevice::~DeferredDevice() {
     this->flushPendingCommands(kSilent_PlaybackMode);
+    this->endRecording();
     SkSafeUnref(fImmediateCanvas);
 }
 
 void DeferredDevice::setMaxRecordingStorage(size_t maxStorage) {
     fMaxRecordingStorageBytes = maxStorage;
+    fPipeController->setMaxStorage(maxStorage);
     this->recordingCanvas(); // Accessing the recording canvas applies the new limit.
 }
 
+void DeferredDevice::setThreadedPlayback(bool threaded) {
+#if !SK_DEFERRED_CANVAS_THREADS
+    // Playback stays on the recording thread.
+    threaded = false;
+#endif
+    if (threaded != fThreadedPlayback) {
+        this->flushPendingCommands(kNormal_PlaybackMode);
+        this->endRecording();
+        fThreadedPlayback = threaded;
+        this->beginRecording();
+    }
+}
+
 void DeferredDevice::beginRecording() {
     SkASSERT(NULL == fRecordingCanvas);
-    fRecordingCanvas = fPipeWriter.startRecording(&fPipeController, 0,
+    SkASSERT(NULL == fPipeController);
+    uint32_t flags = 0;
+#if SK_DEFERRED_CANVAS_THREADS
+    if (fThreadedPlayback) {
+        fPipeController = SkNEW_ARGS(ThreadedPipeController, (fMaxRecordingStorageBytes));
+        // Nothing may be shared with the playback thread.
+        flags = SkGPipeWriter::kCrossProcess_Flag;
+    } else
+#endif
+    {
+        fPipeController = SkNEW(DeferredPipeController);
+    }
+    fPipeController->setPlaybackCanvas(fImmediateCanvas);
+    fRecordingCanvas = fPipeWriter.startRecording(fPipeController, flags,
         fImmediateDevice->width(), fImmediateDevice->height());
 }
 
+void DeferredDevice::endRecording() {
+    fPipeWriter.endRecording();
+    fRecordingCanvas = NULL;
+    SkDELETE(fPipeController);
+    fPipeController = NULL;
+}
+
 void DeferredDevice::setNotificationClient(
     SkDeferredCanvas::NotificationClient* notificationClient) {
     fNotificationClient = notificationClient;
 }
 
 void DeferredDevice::skipPendingCommands() {
-    if (!fRecordingCanvas->isDrawingToLayer() && fPipeController.hasPendingCommands()) {
+    if (!fRecordingCanvas->isDrawingToLayer() && fPipeController->hasPendingCommands()) {
         fFreshFrame = true;
         flushPendingCommands(kSilent_PlaybackMode);
         if (fNotificationClient) {
@@ -307,18 +578,18 @@ bool DeferredDevice::isFreshFrame() {
 }
 
 bool DeferredDevice::hasPendingCommands() {
-    return fPipeController.hasPendingCommands();
+    return fPipeController->hasPendingCommands();
 }
 
 void DeferredDevice::flushPendingCommands(PlaybackMode playbackMode) {
-    if (!fPipeController.hasPendingCommands()) {
+    if (!fPipeController->hasPendingCommands()) {
         return;
     }
     if (playbackMode == kNormal_PlaybackMode && fNotificationClient) {
         fNotificationClient->prepareForDraw();
     }
     fPipeWriter.flushRecording(true);
-    fPipeController.playback(kSilent_PlaybackMode == playbackMode);
+    fPipeController->playback(kSilent_PlaybackMode == playbackMode);
     if (playbackMode == kNormal_PlaybackMode && fNotificationClient) {
         fNotificationClient->flushedDrawCommands();
     }
@@ -345,7 +616,7 @@ void DeferredDevice::setBitmapSizeThreshold(size_t sizeThreshold) {
 }
 
 size_t DeferredDevice::storageAllocatedForRecording() const {
-    return (fPipeController.storageAllocatedForRecording()
+    return (fPipeController->storageAllocatedForRecording()
             + fPipeWriter.storageAllocatedForRecording());
 }
 
@@ -565,6 +836,15 @@ void SkDeferredCanvas::silentFlush() {
     }
 }
 
+void SkDeferredCanvas::setThreadedPlayback(bool threaded) {
+    this->validate(); // Must set device before calling this method
+    this->getDeferredDevice()->setThreadedPlayback(threaded);
+}
+
+bool SkDeferredCanvas::isThreadedPlayback() const {
+    return this->getDeferredDevice()->isThreadedPlayback();
+}
+
 SkDeferredCanvas::~SkDeferredCanvas() {
 }
 
@@ -6,8 +6,11 @@
  */
 
 #include "SkJSON.h"
+#include "SkStream.h"
 #include "SkString.h"
 
+#include <stdarg.h>
+
 #ifdef SK_DEBUG
 //    #define TRACE_SKJSON_LEAKS
 #endif
@@ -364,67 +367,81 @@ bool SkJSON::Object::remove(const char name[], Type t) {
 
 ///////////////////////////////////////////////////////////////////////////////
 
-static void tabForLevel(int level) {
+static void writef(SkWStream* stream, const char format[], ...) {
+    SkString str;
+    va_list args;
+    va_start(args, format);
+    str.appendf(format, args);
+    va_end(args);
+    stream->write(str.c_str(), str.size());
+}
+
+static void tabForLevel(SkWStream* stream, int level) {
     for (int i = 0; i < level; ++i) {
-        SkDebugf("    ");
+        stream->writeText("    ");
     }
 }
 
 void SkJSON::Object::toDebugf() const {
-    SkDebugf("{\n");
-    this->dumpLevel(0);
-    SkDebugf("}\n");
+    SkDebugWStream stream;
+    this->toStream(&stream);
+}
+
+void SkJSON::Object::toStream(SkWStream* stream) const {
+    stream->writeText("{\n");
+    this->dumpLevel(stream, 0);
+    stream->writeText("}\n");
 }
 
-void SkJSON::Object::dumpLevel(int level) const {
+void SkJSON::Object::dumpLevel(SkWStream* stream, int level) const {
     for (Slot* slot = fHead; slot; slot = slot->fNext) {
         Type t = slot->type();
-        tabForLevel(level + 1);
-        SkDebugf("\"%s\" : ", slot->name());
+        tabForLevel(stream, level + 1);
+        writef(stream, "\"%s\" : ", slot->name());
         switch (slot->type()) {
             case kObject:
                 if (slot->fValue.fObject) {
-                    SkDebugf("{\n");
-                    slot->fValue.fObject->dumpLevel(level + 1);
-                    tabForLevel(level + 1);
-                    SkDebugf("}");
+                    stream->writeText("{\n");
+                    slot->fValue.fObject->dumpLevel(stream, level + 1);
+                    tabForLevel(stream, level + 1);
+                    stream->writeText("}");
                 } else {
-                    SkDebugf("null");
+                    stream->writeText("null");
                 }
                 break;
             case kArray:
                 if (slot->fValue.fArray) {
-                    SkDebugf("[");
-                    slot->fValue.fArray->dumpLevel(level + 1);
-                    SkDebugf("]");
+                    stream->writeText("[");
+                    slot->fValue.fArray->dumpLevel(stream, level + 1);
+                    stream->writeText("]");
                 } else {
-                    SkDebugf("null");
+                    stream->writeText("null");
                 }
                 break;
             case kString:
-                SkDebugf("\"%s\"", slot->fValue.fString);
+                writef(stream, "\"%s\"", slot->fValue.fString);
                 break;
             case kInt:
-                SkDebugf("%d", slot->fValue.fInt);
+                writef(stream, "%d", slot->fValue.fInt);
                 break;
             case kFloat:
-                SkDebugf("%g", slot->fValue.fFloat);
+                writef(stream, "%g", slot->fValue.fFloat);
                 break;
             case kBool:
-                SkDebugf("%s", slot->fValue.fBool ? "true" : "false");
+                writef(stream, "%s", slot->fValue.fBool ? "true" : "false");
                 break;
             default:
                 SkASSERT(!"how did I get here");
                 break;
         }
         if (slot->fNext) {
-            SkDebugf(",");
+            stream->writeText(",");
         }
-        SkDebugf("\n");
+        stream->writeText("\n");
     }
 }
 
-void SkJSON::Array::dumpLevel(int level) const {
+void SkJSON::Array::dumpLevel(SkWStream* stream, int level) const {
     if (0 == fCount) {
         return;
     }
@@ -432,62 +449,62 @@ void SkJSON::Array::dumpLevel(int level) const {
 
     switch (this->type()) {
         case kObject: {
-            SkDebugf("\n");
+            stream->writeText("\n");
             for (int i = 0; i <= last; ++i) {
                 Object* obj = fArray.fObjects[i];
-                tabForLevel(level + 1);
+                tabForLevel(stream, level + 1);
                 if (obj) {
-                    SkDebugf("{\n");
-                    obj->dumpLevel(level + 1);
-                    tabForLevel(level + 1);
-                    SkDebugf(i < last ? "}," : "}");
+                    stream->writeText("{\n");
+                    obj->dumpLevel(stream, level + 1);
+                    tabForLevel(stream, level + 1);
+                    stream->writeText(i < last ? "}," : "}");
                 } else {
-                    SkDebugf(i < last ? "null," : "null");
+                    stream->writeText(i < last ? "null," : "null");
                 }
-                SkDebugf("\n");
+                stream->writeText("\n");
             }
         } break;
         case kArray: {
-            SkDebugf("\n");
+            stream->writeText("\n");
             for (int i = 0; i <= last; ++i) {
                 Array* array = fArray.fArrays[i];
-                tabForLevel(level + 1);
+                tabForLevel(stream, level + 1);
                 if (array) {
-                    SkDebugf("[");
-                    array->dumpLevel(level + 1);
-                    tabForLevel(level + 1);
-                    SkDebugf(i < last ? "]," : "]");
+                    stream->writeText("[");
+                    array->dumpLevel(stream, level + 1);
+                    tabForLevel(stream, level + 1);
+                    stream->writeText(i < last ? "]," : "]");
                 } else {
-                    SkDebugf(i < last ? "null," : "null");
+                    stream->writeText(i < last ? "null," : "null");
                 }
-                SkDebugf("\n");
+                stream->writeText("\n");
             }
         } break;
         case kString: {
             for (int i = 0; i < last; ++i) {
                 const char* str = fArray.fStrings[i];
-                SkDebugf(str ? " \"%s\"," : " null,", str);
+                writef(stream, str ? " \"%s\"," : " null,", str);
             }
             const char* str = fArray.fStrings[last];
-            SkDebugf(str ? " \"%s\" " : " null ", str);
+            writef(stream, str ? " \"%s\" " : " null ", str);
         } break;
         case kInt: {
             for (int i = 0; i < last; ++i) {
-                SkDebugf(" %d,", fArray.fInts[i]);
+                writef(stream, " %d,", fArray.fInts[i]);
             }
-            SkDebugf(" %d ", fArray.fInts[last]);
+            writef(stream, " %d ", fArray.fInts[last]);
         } break;
         case kFloat: {
             for (int i = 0; i < last; ++i) {
-                SkDebugf(" %g,", fArray.fFloats[i]);
+                writef(stream, " %g,", fArray.fFloats[i]);
             }
-            SkDebugf(" %g ", fArray.fFloats[last]);
+            writef(stream, " %g ", fArray.fFloats[last]);
         } break;
         case kBool: {
             for (int i = 0; i < last; ++i) {
-                SkDebugf(" %s,", fArray.fBools[i] ? "true" : "false");
+                writef(stream, " %s,", fArray.fBools[i] ? "true" : "false");
             }
-            SkDebugf(" %s ", fArray.fInts[last] ? "true" : "false");
+            writef(stream, " %s ", fArray.fInts[last] ? "true" : "false");
         } break;
         default:
             SkASSERT(!"unsupported array type");
@@ -12,6 +12,8 @@
 #include "SkPixelRef.h"
 #include "SkShader.h"
 #include "SkRRect.h"
+#include "SkThread.h"
+#include "SkThreadPool.h"
 
 class PixelRefSet {
 public:
@@ -223,3 +225,73 @@ SkData* SkPictureUtils::GatherPixelRefs(SkPicture* pict, const SkRect& area) {
     }
     return data;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct ParallelDraw {
+    SkPicture**         fPictures;  // one per task, each used by one thread at a time
+    const SkBitmap*     fDst;
+    SkTDArray<SkIRect>  fTiles;
+    int32_t             fNextTile;  // shared by all tasks
+};
+
+}  // namespace
+
+static void draw_tiles_proc(void* context, int index) {
+    ParallelDraw* draw = static_cast<ParallelDraw*>(context);
+    SkPicture* picture = draw->fPictures[index];
+
+    // Claim tiles one at a time rather than drawing a fixed range, so that
+    // threads which happen to get cheap tiles keep helping until every tile
+    // is drawn.
+    int i;
+    while ((i = sk_atomic_inc(&draw->fNextTile)) < draw->fTiles.count()) {
+        const SkIRect& tile = draw->fTiles[i];
+        SkBitmap subset;
+        if (!draw->fDst->extractSubset(&subset, tile)) {
+            continue;
+        }
+        SkCanvas canvas(subset);
+        canvas.translate(-SkIntToScalar(tile.fLeft), -SkIntToScalar(tile.fTop));
+        picture->draw(&canvas);
+    }
+}
+
+void SkPictureUtils::DrawParallel(SkPicture* pict, const SkBitmap& dst, SkThreadPool* pool,
+                                  int tileWidth, int tileHeight) {
+    SkASSERT(tileWidth > 0 && tileHeight > 0);
+
+    // Finish recording here, rather than racing to do it inside draw().
+    pict->endRecording();
+
+    ParallelDraw draw;
+    draw.fDst = &dst;
+    draw.fNextTile = 0;
+    for (int y = 0; y < dst.height(); y += tileHeight) {
+        for (int x = 0; x < dst.width(); x += tileWidth) {
+            draw.fTiles.append()->setXYWH(x, y, SkMin32(tileWidth, dst.width() - x),
+                                          SkMin32(tileHeight, dst.height() - y));
+        }
+    }
+
+    int taskCount = SkMin32(NULL == pool ? 1 : pool->count() + 1, draw.fTiles.count());
+    if (taskCount <= 1) {
+        SkCanvas canvas(dst);
+        pict->draw(&canvas);
+        return;
+    }
+
+    // The calling thread can use pict itself; the others get clones.
+    SkAutoTArray<SkPicture> clones(taskCount - 1);
+    pict->clone(clones.get(), taskCount - 1);
+    SkAutoTMalloc<SkPicture*> pictures(taskCount);
+    pictures[0] = pict;
+    for (int i = 1; i < taskCount; ++i) {
+        pictures[i] = &clones[i - 1];
+    }
+    draw.fPictures = pictures.get();
+
+    pool->parallelFor(taskCount, draw_tiles_proc, &draw);
+}
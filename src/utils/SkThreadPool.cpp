@@ -6,83 +6,322 @@
  */
 
 #include "SkThreadPool.h"
+#include "SkDeque.h"
 #include "SkRunnable.h"
+#include "SkTemplates.h"
+#include "SkThread.h"
 #include "SkThreadUtils.h"
+#include "SkTLS.h"
+
+// Tasks are small, so grab a few at a time when a deque needs another block.
+static const int kDequeAllocCount = 16;
+
+struct SkThreadPool::Worker {
+    Worker(SkThreadPool* pool, int index)
+        : fPool(pool)
+        , fIndex(index)
+        , fDeque(sizeof(Task), kDequeAllocCount)
+        , fThread(NULL) {}
+
+    void pushBack(const Task& task) {
+        SkAutoMutexAcquire lock(fMutex);
+        *static_cast<Task*>(fDeque.push_back()) = task;
+    }
+
+    // The owning thread takes its newest task, which is the most likely to be cache-hot.
+    bool popBack(Task* task) {
+        SkAutoMutexAcquire lock(fMutex);
+        if (fDeque.empty()) {
+            return false;
+        }
+        *task = *static_cast<Task*>(fDeque.back());
+        fDeque.pop_back();
+        return true;
+    }
+
+    // Other threads steal the oldest task, which keeps them away from the owner's end.
+    bool popFront(Task* task) {
+        SkAutoMutexAcquire lock(fMutex);
+        if (fDeque.empty()) {
+            return false;
+        }
+        *task = *static_cast<Task*>(fDeque.front());
+        fDeque.pop_front();
+        return true;
+    }
+
+    SkThreadPool* fPool;
+    const int     fIndex;
+    SkMutex       fMutex;  // Guards fDeque.
+    SkDeque       fDeque;  // Of Task.
+    SkThread*     fThread;
+};
+
+// Each pool thread records its Worker in TLS, so that add() can tell whether it is being
+// called from inside one of its own tasks.
+static void* new_worker_slot() {
+    void** slot = SkNEW(void*);
+    *slot = NULL;
+    return slot;
+}
+
+static void delete_worker_slot(void* slot) {
+    SkDELETE(static_cast<void**>(slot));
+}
+
+static void* current_worker() {
+    void** slot = static_cast<void**>(SkTLS::Find(new_worker_slot));
+    return slot ? *slot : NULL;
+}
+
+// Atomically reads a counter that other threads update with sk_atomic_*.
+static int32_t atomic_read(int32_t* addr) {
+    return sk_atomic_add(addr, 0);
+}
 
 SkThreadPool::SkThreadPool(const int count)
-: fDone(false) {
+: fPending(0)
+, fSleepers(0)
+, fNextWorker(0)
+, fDone(false) {
+    // Every worker must exist before any thread starts, since threads steal from each other.
+    for (int i = 0; i < count; i++) {
+        *fWorkers.append() = SkNEW_ARGS(Worker, (this, i));
+    }
     // Create count threads, all running SkThreadPool::Loop.
     for (int i = 0; i < count; i++) {
-        SkThread* thread = SkNEW_ARGS(SkThread, (&SkThreadPool::Loop, this));
-        *fThreads.append() = thread;
-        thread->start();
+        Worker* worker = fWorkers[i];
+        worker->fThread = SkNEW_ARGS(SkThread, (&SkThreadPool::Loop, worker));
+        worker->fThread->start();
     }
 }
 
 SkThreadPool::~SkThreadPool() {
-    fDone = true;
     fReady.lock();
+    fDone = true;
     fReady.broadcast();
     fReady.unlock();
 
-    // Wait for all threads to stop.
-    for (int i = 0; i < fThreads.count(); i++) {
-        fThreads[i]->join();
-        SkDELETE(fThreads[i]);
+    // Wait for all threads to drain the deques and stop.
+    for (int i = 0; i < fWorkers.count(); i++) {
+        fWorkers[i]->fThread->join();
+        SkDELETE(fWorkers[i]->fThread);
+    }
+    fWorkers.deleteAll();
+}
+
+/*static*/ void SkThreadPool::RunTask(const Task& task) {
+    task.fRunnable->run();
+    if (NULL != task.fGroup) {
+        task.fGroup->taskFinished();
     }
 }
 
+bool SkThreadPool::tryRunOne(Worker* self) {
+    Task task;
+    bool found = NULL != self && self->popBack(&task);
+
+    // Our own deque is empty, so go stealing, starting with our neighbour so that thieves
+    // spread out over the victims rather than all hitting the first worker.
+    const int count = fWorkers.count();
+    const int start = NULL != self ? self->fIndex + 1 : 0;
+    for (int i = 0; !found && i < count; i++) {
+        Worker* victim = fWorkers[(start + i) % count];
+        if (victim != self) {
+            found = victim->popFront(&task);
+        }
+    }
+    if (!found) {
+        return false;
+    }
+
+    sk_atomic_dec(&fPending);
+    RunTask(task);
+    return true;
+}
+
 /*static*/ void SkThreadPool::Loop(void* arg) {
-    // The SkThreadPool passes itself as arg to each thread as they're created.
-    SkThreadPool* pool = static_cast<SkThreadPool*>(arg);
+    // The SkThreadPool passes each thread its own Worker as they're created.
+    Worker* self = static_cast<Worker*>(arg);
+    SkThreadPool* pool = self->fPool;
+    *static_cast<void**>(SkTLS::Get(new_worker_slot, delete_worker_slot)) = self;
 
     while (true) {
-        // We have to be holding the lock to read the queue and to call wait.
+        // Run our own tasks, then everyone else's, without touching fReady.
+        if (pool->tryRunOne(self)) {
+            continue;
+        }
+
+        // Nothing left to run. Announce that we are going to sleep before checking fPending
+        // one last time: push() bumps fPending before it checks fSleepers, so at least one of
+        // us sees the other, and no wakeup is lost.
         pool->fReady.lock();
-        while(pool->fQueue.isEmpty()) {
-            // Is it time to die?
-            if (pool->fDone) {
-                pool->fReady.unlock();
-                return;
-            }
+        sk_atomic_inc(&pool->fSleepers);
+        while (pool->fPending <= 0 && !pool->fDone) {
             // wait yields the lock while waiting, but will have it again when awoken.
             pool->fReady.wait();
         }
-        // We've got the lock back here, no matter if we ran wait or not.
-
-        // The queue is not empty, so we have something to run.  Claim it.
-        LinkedRunnable* r = pool->fQueue.tail();
+        sk_atomic_dec(&pool->fSleepers);
+        // Is it time to die?  Only once everything that was queued has been run.
+        const bool finished = pool->fDone && pool->fPending <= 0;
+        pool->fReady.unlock();
+        if (finished) {
+            return;
+        }
+    }
+}
 
-        pool->fQueue.remove(r);
+void SkThreadPool::push(SkRunnable* r, SkTaskGroup* group) {
+    Task task;
+    task.fRunnable = r;
+    task.fGroup = group;
+    if (NULL != group) {
+        group->taskAdded();
+    }
 
-        // Having claimed our SkRunnable, we now give up the lock while we run it.
-        // Otherwise, we'd only ever do work on one thread at a time, which rather
-        // defeats the point of this code.
-        pool->fReady.unlock();
+    // If we don't have any threads, obligingly just run the thing now.
+    if (fWorkers.isEmpty()) {
+        RunTask(task);
+        return;
+    }
 
-        // OK, now really do the work.
-        r->fRunnable->run();
-        SkDELETE(r);
+    // Tasks spawned by our own threads stay local; others are dealt out round-robin.
+    Worker* worker = static_cast<Worker*>(current_worker());
+    if (NULL == worker || worker->fPool != this) {
+        uint32_t next = static_cast<uint32_t>(sk_atomic_inc(&fNextWorker));
+        worker = fWorkers[next % fWorkers.count()];
     }
+    worker->pushBack(task);
+    sk_atomic_inc(&fPending);
 
-    SkASSERT(false); // Unreachable.  The only exit happens when pool->fDone.
+    // Only pay for the lock if somebody might be asleep.
+    if (atomic_read(&fSleepers) > 0) {
+        fReady.lock();
+        fReady.signal();
+        fReady.unlock();
+    }
+    if (NULL != group) {
+        group->taskQueued();
+    }
 }
 
 void SkThreadPool::add(SkRunnable* r) {
     if (NULL == r) {
         return;
     }
+    this->push(r, NULL);
+}
 
-    // If we don't have any threads, obligingly just run the thing now.
-    if (fThreads.isEmpty()) {
-        return r->run();
+// Runs the indices [fStart, fEnd) of a parallelFor().
+class SkParallelForChunk : public SkRunnable {
+public:
+    void set(SkThreadPool::ParallelForProc proc, void* context, int start, int end) {
+        fProc = proc;
+        fContext = context;
+        fStart = start;
+        fEnd = end;
     }
 
-    // We have some threads.  Queue it up!
-    fReady.lock();
-    LinkedRunnable* linkedRunnable = SkNEW(LinkedRunnable);
-    linkedRunnable->fRunnable = r;
-    fQueue.addToHead(linkedRunnable);
-    fReady.signal();
-    fReady.unlock();
+    virtual void run() SK_OVERRIDE {
+        for (int i = fStart; i < fEnd; i++) {
+            fProc(fContext, i);
+        }
+    }
+
+private:
+    SkThreadPool::ParallelForProc fProc;
+    void*                         fContext;
+    int                           fStart;
+    int                           fEnd;
+};
+
+void SkThreadPool::parallelFor(int count, ParallelForProc proc, void* context, int grainSize) {
+    SkASSERT(grainSize >= 1);
+    if (count <= 0) {
+        return;
+    }
+
+    const int chunkCount = (count + grainSize - 1) / grainSize;
+    SkAutoTArray<SkParallelForChunk> chunks(chunkCount);
+    SkTaskGroup group(this);
+    for (int i = 0; i < chunkCount; i++) {
+        const int start = i * grainSize;
+        chunks[i].set(proc, context, start, SkMin32(start + grainSize, count));
+        group.add(&chunks[i]);
+    }
+    group.wait();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+SkTaskGroup::SkTaskGroup(SkThreadPool* pool)
+: fPool(pool)
+, fPending(0)
+, fWaiters(0)
+, fFinishing(0) {
+    SkASSERT(NULL != pool);
+}
+
+SkTaskGroup::~SkTaskGroup() {
+    this->wait();
+}
+
+void SkTaskGroup::add(SkRunnable* r) {
+    if (NULL == r) {
+        return;
+    }
+    fPool->push(r, this);
+}
+
+void SkTaskGroup::taskAdded() {
+    sk_atomic_inc(&fPending);
+}
+
+void SkTaskGroup::taskQueued() {
+    // A waiter may have gone to sleep because there was nothing it could help with.
+    if (atomic_read(&fWaiters) > 0) {
+        fDone.lock();
+        fDone.broadcast();
+        fDone.unlock();
+    }
+}
+
+void SkTaskGroup::taskFinished() {
+    // wait() will not return while fFinishing is non-zero, which keeps the group alive until
+    // we are completely done with it below.
+    sk_atomic_inc(&fFinishing);
+    if (1 == sk_atomic_dec(&fPending)) {
+        fDone.lock();
+        fDone.broadcast();
+        fDone.unlock();
+    }
+    sk_atomic_dec(&fFinishing);
+}
+
+void SkTaskGroup::wait() {
+    SkThreadPool::Worker* self = static_cast<SkThreadPool::Worker*>(current_worker());
+    if (NULL != self && self->fPool != fPool) {
+        self = NULL;
+    }
+
+    while (atomic_read(&fPending) > 0) {
+        // Rather than idle, help with whatever is queued, ours or not.
+        if (fPool->tryRunOne(self)) {
+            continue;
+        }
+
+        // Nothing is queued, so the rest of this group is running on other threads.  Sleep
+        // until one of them finishes, or queues something new for us to help with.
+        fDone.lock();
+        sk_atomic_inc(&fWaiters);
+        if (fPending > 0 && atomic_read(&fPool->fPending) <= 0) {
+            fDone.wait();
+        }
+        sk_atomic_dec(&fWaiters);
+        fDone.unlock();
+    }
+
+    while (atomic_read(&fFinishing) > 0) {
+        // Spin: the last finisher is between its final decrement and returning.
+    }
 }
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkBitmap.h"
+#include "SkCanvas.h"
+#include "SkPaint.h"
+#include "SkPath.h"
+#include "Test.h"
+
+static const int kSize = 64;
+
+static void draw_path(SkBitmap* bitmap, const SkPath& path, bool analytic) {
+    bitmap->setConfig(SkBitmap::kA8_Config, kSize, kSize);
+    bitmap->allocPixels();
+    bitmap->eraseColor(SK_ColorTRANSPARENT);
+
+    SkCanvas canvas(*bitmap);
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    paint.setAnalyticAA(analytic);
+    canvas.drawPath(path, paint);
+}
+
+static bool near(int a, int b, int tolerance) {
+    return SkAbs32(a - b) <= tolerance;
+}
+
+// Partially covered pixels get exactly the area they are covered by.
+static void test_rect_coverage(skiatest::Reporter* reporter) {
+    SkPath path;
+    path.addRect(SkRect::MakeLTRB(10.5f, 10.25f, 30.5f, 20.75f));
+    SkBitmap bitmap;
+    draw_path(&bitmap, path, true);
+
+    REPORTER_ASSERT(reporter, 0 == *bitmap.getAddr8(9, 15));
+    REPORTER_ASSERT(reporter, near(*bitmap.getAddr8(10, 15), 128, 1));
+    REPORTER_ASSERT(reporter, 255 == *bitmap.getAddr8(11, 15));
+    REPORTER_ASSERT(reporter, 255 == *bitmap.getAddr8(29, 15));
+    REPORTER_ASSERT(reporter, near(*bitmap.getAddr8(30, 15), 128, 1));
+    REPORTER_ASSERT(reporter, near(*bitmap.getAddr8(20, 10), 191, 1));
+    REPORTER_ASSERT(reporter, near(*bitmap.getAddr8(20, 20), 191, 1));
+    REPORTER_ASSERT(reporter, near(*bitmap.getAddr8(10, 10), 96, 1));
+    REPORTER_ASSERT(reporter, 0 == *bitmap.getAddr8(20, 21));
+}
+
+// Geometry beyond the device must still contribute its winding.
+static void test_clipped(skiatest::Reporter* reporter) {
+    SkPath path;
+    path.moveTo(-100, -50);
+    path.lineTo(500, 10);
+    path.lineTo(500, 200);
+    path.lineTo(-100, 200);
+    path.close();
+    SkBitmap bitmap;
+    draw_path(&bitmap, path, true);
+
+    bool allCovered = true;
+    for (int y = 20; y < kSize; y++) {
+        for (int x = 0; x < kSize; x++) {
+            allCovered &= (255 == *bitmap.getAddr8(x, y));
+        }
+    }
+    REPORTER_ASSERT(reporter, allCovered);
+}
+
+static void test_fill_types(skiatest::Reporter* reporter) {
+    SkPath path;
+    path.addRect(SkRect::MakeLTRB(4, 4, 40, 40));
+    path.addRect(SkRect::MakeLTRB(20, 20, 60, 60));
+    SkBitmap bitmap;
+
+    draw_path(&bitmap, path, true);
+    REPORTER_ASSERT(reporter, 255 == *bitmap.getAddr8(30, 30));
+    REPORTER_ASSERT(reporter, 255 == *bitmap.getAddr8(10, 10));
+
+    path.setFillType(SkPath::kEvenOdd_FillType);
+    draw_path(&bitmap, path, true);
+    REPORTER_ASSERT(reporter, 0 == *bitmap.getAddr8(30, 30));
+    REPORTER_ASSERT(reporter, 255 == *bitmap.getAddr8(10, 10));
+    REPORTER_ASSERT(reporter, 255 == *bitmap.getAddr8(50, 50));
+
+    // Inverse fills go through the supersampler, but must still be honored.
+    path.setFillType(SkPath::kInverseWinding_FillType);
+    draw_path(&bitmap, path, true);
+    REPORTER_ASSERT(reporter, 0 == *bitmap.getAddr8(30, 30));
+    REPORTER_ASSERT(reporter, 255 == *bitmap.getAddr8(1, 62));
+}
+
+// Curves should cover about the same pixels as the supersampler does; the
+// supersampler only has 16 levels of coverage, so allow for that.
+static void compare_with_supersampling(skiatest::Reporter* reporter, const SkPath& path) {
+    SkBitmap analytic, supersampled;
+    draw_path(&analytic, path, true);
+    draw_path(&supersampled, path, false);
+
+    int maxDiff = 0;
+    int64_t analyticSum = 0, supersampledSum = 0;
+    for (int y = 0; y < kSize; y++) {
+        for (int x = 0; x < kSize; x++) {
+            int a = *analytic.getAddr8(x, y);
+            int s = *supersampled.getAddr8(x, y);
+            maxDiff = SkMax32(maxDiff, SkAbs32(a - s));
+            analyticSum += a;
+            supersampledSum += s;
+        }
+    }
+    REPORTER_ASSERT(reporter, maxDiff <= 48);
+    REPORTER_ASSERT(reporter, SkAbs32((int)(analyticSum - supersampledSum)) <
+                              (int)(supersampledSum / 100));
+}
+
+static void test_curves(skiatest::Reporter* reporter) {
+    SkPath circle;
+    circle.addCircle(30.3f, 31.7f, 25.1f);
+    compare_with_supersampling(reporter, circle);
+
+    SkPath curves;
+    curves.moveTo(2, 60);
+    curves.cubicTo(20, -10, 50, 80, 62, 3);
+    curves.quadTo(40, 50, 2, 60);
+    compare_with_supersampling(reporter, curves);
+
+    SkPath oval;
+    oval.addOval(SkRect::MakeLTRB(3.1f, 20.4f, 61.7f, 44.9f));
+    oval.addCircle(40, 32, 7.5f, SkPath::kCCW_Direction);
+    compare_with_supersampling(reporter, oval);
+}
+
+static void TestAnalyticAA(skiatest::Reporter* reporter) {
+    test_rect_coverage(reporter);
+    test_clipped(reporter);
+    test_fill_types(reporter);
+    test_curves(reporter);
+}
+
+#include "TestClassDef.h"
+DEFINE_TESTCLASS("AnalyticAA", AnalyticAATestClass, TestAnalyticAA)
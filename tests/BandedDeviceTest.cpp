@@ -0,0 +1,185 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkBandedDevice.h"
+#include "SkCanvas.h"
+#include "SkColorPriv.h"
+#include "SkPath.h"
+#include "SkRRect.h"
+#include "SkShader.h"
+#include "SkThreadPool.h"
+#include "Test.h"
+
+static const int kWidth = 300;
+static const int kHeight = 400;
+
+typedef void (*DrawProc)(SkCanvas*);
+
+static void draw_aa_path(SkCanvas* canvas) {
+    SkPath path;
+    path.moveTo(10, 5);
+    path.cubicTo(290, 20, -40, 300, 280, 390);
+    path.lineTo(20, 380);
+    path.close();
+    path.addCircle(150, 200, 90);
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    paint.setColor(0xC0336699);
+    canvas->drawPath(path, paint);
+}
+
+static void draw_poly(SkCanvas* canvas) {
+    SkPath path;
+    path.moveTo(10, 5);
+    path.lineTo(290, 40);
+    path.lineTo(20, 395);
+    path.lineTo(150, 100);
+    path.close();
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    canvas->drawPath(path, paint);
+    paint.setAntiAlias(false);
+    canvas->translate(3, 0);
+    canvas->drawPath(path, paint);
+}
+
+static void draw_stroked_path(SkCanvas* canvas) {
+    SkPath path;
+    path.moveTo(20, 20);
+    path.quadTo(280, 60, 40, 380);
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    paint.setStyle(SkPaint::kStroke_Style);
+    paint.setStrokeWidth(13);
+    paint.setColor(SK_ColorRED);
+    canvas->rotate(SkIntToScalar(7));
+    canvas->drawPath(path, paint);
+}
+
+static void draw_clipped_rect(SkCanvas* canvas) {
+    SkRRect rrect;
+    rrect.setRectXY(SkRect::MakeLTRB(15, 25, 285, 370), 60, 40);
+    canvas->clipRRect(rrect, SkRegion::kIntersect_Op, true);
+    SkPaint paint;
+    paint.setColor(SK_ColorBLUE);
+    canvas->drawRect(SkRect::MakeWH(kWidth, kHeight), paint);
+}
+
+static void draw_aa_rect(SkCanvas* canvas) {
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    paint.setColor(0x8000FF00);
+    canvas->drawRect(SkRect::MakeLTRB(SK_Scalar1 / 3, 2.5f, 297.25f, 398.75f), paint);
+}
+
+static void make_checker(SkBitmap* bitmap) {
+    bitmap->setConfig(SkBitmap::kARGB_8888_Config, 16, 16);
+    bitmap->allocPixels();
+    for (int y = 0; y < 16; y++) {
+        for (int x = 0; x < 16; x++) {
+            *bitmap->getAddr32(x, y) = SkPackARGB32(0xFF, x * 16, y * 16, (x ^ y) * 16);
+        }
+    }
+}
+
+static void draw_bitmap_rect(SkCanvas* canvas) {
+    SkBitmap bitmap;
+    make_checker(&bitmap);
+    SkPaint paint;
+    paint.setFilterBitmap(true);
+    SkRect src = SkRect::MakeLTRB(SK_Scalar1 / 2, 1, 15, 14);
+    canvas->drawBitmapRectToRect(bitmap, &src, SkRect::MakeLTRB(3, 7, 290, 395), &paint);
+}
+
+static void draw_bitmap_shader(SkCanvas* canvas) {
+    SkBitmap bitmap;
+    make_checker(&bitmap);
+    SkShader* shader = SkShader::CreateBitmapShader(bitmap, SkShader::kRepeat_TileMode,
+                                                    SkShader::kMirror_TileMode);
+    SkPaint paint;
+    paint.setShader(shader)->unref();
+    paint.setAntiAlias(true);
+    canvas->drawCircle(150, 200, 120, paint);
+}
+
+static void draw_with(SkDevice* device, DrawProc proc) {
+    device->accessBitmap(true).eraseColor(SK_ColorWHITE);
+    SkCanvas canvas(device);
+    proc(&canvas);
+}
+
+// Returns how many pixels differ between the two bitmaps.
+static int count_differences(const SkBitmap& a, const SkBitmap& b) {
+    SkAutoLockPixels alpa(a);
+    SkAutoLockPixels alpb(b);
+    int differences = 0;
+    for (int y = 0; y < a.height(); y++) {
+        for (int x = 0; x < a.width(); x++) {
+            if (*a.getAddr32(x, y) != *b.getAddr32(x, y)) {
+                differences++;
+            }
+        }
+    }
+    return differences;
+}
+
+static void TestBandedDevice(skiatest::Reporter* reporter) {
+    // Rects and bitmaps rasterize identically whatever the clip, so banding them must not
+    // change a single pixel.
+    static const DrawProc kExactProcs[] = {
+        draw_clipped_rect, draw_aa_rect, draw_bitmap_rect,
+    };
+    // Edges of other paths are clipped to each band, just as they would be by a clip or a
+    // tiled renderer, which may nudge the coverage of the few pixels along the seams.
+    static const DrawProc kSeamProcs[] = {
+        draw_poly, draw_aa_path, draw_stroked_path, draw_bitmap_shader,
+    };
+    static const int kMaxSeamDifferences = kWidth * kHeight / 100;
+
+    SkThreadPool pool(3);
+    SkDevice* expected = SkNEW_ARGS(SkDevice,
+                                    (SkBitmap::kARGB_8888_Config, kWidth, kHeight, true));
+    SkBandedDevice* banded = SkNEW_ARGS(SkBandedDevice,
+                                        (SkBitmap::kARGB_8888_Config, kWidth, kHeight, true,
+                                         &pool));
+    // Make sure every draw above actually gets split.
+    banded->setMinPixelsToBand(1);
+
+    for (size_t i = 0; i < SK_ARRAY_COUNT(kExactProcs); i++) {
+        draw_with(expected, kExactProcs[i]);
+        draw_with(banded, kExactProcs[i]);
+        REPORTER_ASSERT(reporter, 0 == count_differences(expected->accessBitmap(false),
+                                                         banded->accessBitmap(false)));
+    }
+    for (size_t i = 0; i < SK_ARRAY_COUNT(kSeamProcs); i++) {
+        draw_with(expected, kSeamProcs[i]);
+        draw_with(banded, kSeamProcs[i]);
+        int differences = count_differences(expected->accessBitmap(false),
+                                            banded->accessBitmap(false));
+        REPORTER_ASSERT(reporter, differences <= kMaxSeamDifferences);
+    }
+
+    // Without any threads the device must behave exactly like SkDevice.
+    SkThreadPool noThreads(0);
+    SkBandedDevice* serial = SkNEW_ARGS(SkBandedDevice,
+                                        (SkBitmap::kARGB_8888_Config, kWidth, kHeight, true,
+                                         &noThreads));
+    serial->setMinPixelsToBand(1);
+    for (size_t i = 0; i < SK_ARRAY_COUNT(kSeamProcs); i++) {
+        draw_with(expected, kSeamProcs[i]);
+        draw_with(serial, kSeamProcs[i]);
+        REPORTER_ASSERT(reporter, 0 == count_differences(expected->accessBitmap(false),
+                                                         serial->accessBitmap(false)));
+    }
+
+    expected->unref();
+    banded->unref();
+    serial->unref();
+}
+
+#include "TestClassDef.h"
+DEFINE_TESTCLASS("BandedDevice", BandedDeviceTestClass, TestBandedDevice)
@@ -0,0 +1,279 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkBitmap.h"
+#include "SkBitmapScaler.h"
+#include "SkCanvas.h"
+#include "SkColorPriv.h"
+#include "SkConvolver.h"
+#include "SkRandom.h"
+#include "SkScaledImageCache.h"
+#include "Test.h"
+
+static const SkBitmapScaler::ResizeMethod gMethods[] = {
+    SkBitmapScaler::kBox_ResizeMethod,
+    SkBitmapScaler::kMitchell_ResizeMethod,
+    SkBitmapScaler::kLanczos3_ResizeMethod,
+};
+
+static void make_noise(SkBitmap* bitmap, int width, int height, SkRandom* rand) {
+    bitmap->setConfig(SkBitmap::kARGB_8888_Config, width, height);
+    bitmap->allocPixels();
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            *bitmap->getAddr32(x, y) = SkPreMultiplyColor(rand->nextU());
+        }
+    }
+}
+
+static void make_checkerboard(SkBitmap* bitmap, int size) {
+    bitmap->setConfig(SkBitmap::kARGB_8888_Config, size, size);
+    bitmap->allocPixels();
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            *bitmap->getAddr32(x, y) = ((x ^ y) & 1) ? SK_ColorWHITE : SK_ColorBLACK;
+        }
+    }
+    bitmap->setIsOpaque(true);
+}
+
+// Every filter's weights must add up to one, or flat areas change color.
+static void test_filter_weights(skiatest::Reporter* reporter) {
+    static const int kSizes[][2] = {
+        { 100, 10 }, { 100, 33 }, { 7, 3 }, { 5, 1 }, { 1, 1 }, { 10, 10 }, { 10, 25 },
+    };
+    for (size_t m = 0; m < SK_ARRAY_COUNT(gMethods); ++m) {
+        for (size_t i = 0; i < SK_ARRAY_COUNT(kSizes); ++i) {
+            const int srcSize = kSizes[i][0];
+            const int destSize = kSizes[i][1];
+            SkConvolutionFilter1D filter;
+            SkBitmapScaler::BuildFilter(gMethods[m], srcSize, destSize, &filter);
+            REPORTER_ASSERT(reporter, filter.numValues() == destSize);
+            for (int x = 0; x < filter.numValues(); ++x) {
+                int offset, length;
+                const SkConvolutionFilter1D::ConvolutionFixed* weights =
+                        filter.filterAt(x, &offset, &length);
+                REPORTER_ASSERT(reporter, offset >= 0 && offset + length <= srcSize);
+                int sum = 0;
+                for (int j = 0; j < length; ++j) {
+                    sum += weights[j];
+                }
+                REPORTER_ASSERT(reporter, (1 << SkConvolutionFilter1D::kShiftBits) == sum);
+            }
+        }
+    }
+}
+
+static unsigned round_and_clamp(int sum) {
+    sum = (sum + (1 << (SkConvolutionFilter1D::kShiftBits - 1))) >>
+          SkConvolutionFilter1D::kShiftBits;
+    return SkClampMax(sum, 255);
+}
+
+// Convolves src the slow way, a whole pass at a time.
+static void reference_convolve(const SkBitmap& src, const SkConvolutionFilter1D& filterX,
+                               const SkConvolutionFilter1D& filterY, SkBitmap* dst) {
+    const int width = filterX.numValues();
+    const int height = filterY.numValues();
+    SkBitmap rows;
+    rows.setConfig(SkBitmap::kARGB_8888_Config, width, src.height());
+    rows.allocPixels();
+    for (int y = 0; y < src.height(); ++y) {
+        for (int x = 0; x < width; ++x) {
+            int offset, length;
+            const SkConvolutionFilter1D::ConvolutionFixed* weights =
+                    filterX.filterAt(x, &offset, &length);
+            uint32_t result = 0;
+            for (int shift = 0; shift < 32; shift += 8) {
+                int sum = 0;
+                for (int i = 0; i < length; ++i) {
+                    sum += weights[i] * ((*src.getAddr32(offset + i, y) >> shift) & 0xFF);
+                }
+                result |= round_and_clamp(sum) << shift;
+            }
+            *rows.getAddr32(x, y) = result;
+        }
+    }
+
+    dst->setConfig(SkBitmap::kARGB_8888_Config, width, height);
+    dst->allocPixels();
+    for (int y = 0; y < height; ++y) {
+        int offset, length;
+        const SkConvolutionFilter1D::ConvolutionFixed* weights =
+                filterY.filterAt(y, &offset, &length);
+        for (int x = 0; x < width; ++x) {
+            unsigned channels[4];
+            for (int c = 0; c < 4; ++c) {
+                int sum = 0;
+                for (int i = 0; i < length; ++i) {
+                    sum += weights[i] * ((*rows.getAddr32(x, offset + i) >> (c * 8)) & 0xFF);
+                }
+                channels[c] = round_and_clamp(sum);
+            }
+            unsigned a = (SK_A32_SHIFT / 8) < 4 ? channels[SK_A32_SHIFT / 8] : 255;
+            uint32_t result = 0;
+            for (int c = 0; c < 4; ++c) {
+                result |= SkMin32(channels[c], a) << (c * 8);
+            }
+            *dst->getAddr32(x, y) = result;
+        }
+    }
+}
+
+// Whichever procs the platform picks, the result must be exactly the two
+// rounded passes.
+static void test_matches_reference(skiatest::Reporter* reporter) {
+    static const int kSizes[][4] = {
+        { 37, 29, 11, 7 }, { 64, 64, 17, 17 }, { 20, 30, 45, 13 }, { 9, 9, 3, 27 },
+    };
+    SkRandom rand;
+    for (size_t m = 0; m < SK_ARRAY_COUNT(gMethods); ++m) {
+        for (size_t i = 0; i < SK_ARRAY_COUNT(kSizes); ++i) {
+            SkBitmap src;
+            make_noise(&src, kSizes[i][0], kSizes[i][1], &rand);
+            SkConvolutionFilter1D filterX, filterY;
+            SkBitmapScaler::BuildFilter(gMethods[m], kSizes[i][0], kSizes[i][2], &filterX);
+            SkBitmapScaler::BuildFilter(gMethods[m], kSizes[i][1], kSizes[i][3], &filterY);
+
+            SkBitmap expected, actual;
+            reference_convolve(src, filterX, filterY, &expected);
+            REPORTER_ASSERT(reporter, SkBitmapScaler::Resize(&actual, src, gMethods[m],
+                                                             kSizes[i][2], kSizes[i][3]));
+            REPORTER_ASSERT(reporter, actual.width() == expected.width() &&
+                                      actual.height() == expected.height());
+
+            bool same = true;
+            bool premultiplied = true;
+            for (int y = 0; y < actual.height(); ++y) {
+                for (int x = 0; x < actual.width(); ++x) {
+                    SkPMColor c = *actual.getAddr32(x, y);
+                    same &= c == *expected.getAddr32(x, y);
+                    unsigned a = SkGetPackedA32(c);
+                    premultiplied &= SkGetPackedR32(c) <= a && SkGetPackedG32(c) <= a &&
+                                     SkGetPackedB32(c) <= a;
+                }
+            }
+            REPORTER_ASSERT(reporter, same);
+            REPORTER_ASSERT(reporter, premultiplied);
+        }
+    }
+}
+
+static void test_solid_color(skiatest::Reporter* reporter) {
+    SkBitmap src;
+    src.setConfig(SkBitmap::kARGB_8888_Config, 100, 80);
+    src.allocPixels();
+    src.eraseColor(SkColorSetARGB(0xC0, 0x20, 0x80, 0xF0));
+    const SkPMColor color = *src.getAddr32(0, 0);
+
+    for (size_t m = 0; m < SK_ARRAY_COUNT(gMethods); ++m) {
+        SkBitmap dst;
+        REPORTER_ASSERT(reporter, SkBitmapScaler::Resize(&dst, src, gMethods[m], 13, 7));
+        bool solid = true;
+        for (int y = 0; y < dst.height(); ++y) {
+            for (int x = 0; x < dst.width(); ++x) {
+                solid &= *dst.getAddr32(x, y) == color;
+            }
+        }
+        REPORTER_ASSERT(reporter, solid);
+    }
+}
+
+static void test_bad_sizes(skiatest::Reporter* reporter) {
+    SkBitmap src, dst;
+    src.setConfig(SkBitmap::kARGB_8888_Config, 10, 10);
+    src.allocPixels();
+    REPORTER_ASSERT(reporter, !SkBitmapScaler::Resize(&dst, src,
+                                                      SkBitmapScaler::kBox_ResizeMethod, 0, 5));
+    REPORTER_ASSERT(reporter, !SkBitmapScaler::Resize(&dst, SkBitmap(),
+                                                      SkBitmapScaler::kBox_ResizeMethod, 5, 5));
+    REPORTER_ASSERT(reporter, dst.isNull());
+}
+
+static void draw_minified(const SkBitmap& src, bool highQuality, SkBitmap* dst) {
+    dst->setConfig(SkBitmap::kARGB_8888_Config, src.width() / 4, src.height() / 4);
+    dst->allocPixels();
+    dst->eraseColor(SK_ColorTRANSPARENT);
+    SkCanvas canvas(*dst);
+    canvas.scale(0.25f, 0.25f);
+    SkPaint paint;
+    paint.setFilterBitmap(true);
+    paint.setHighQualityFilterBitmap(highQuality);
+    canvas.drawBitmap(src, 0, 0, &paint);
+}
+
+// A one pixel checkerboard shrunk to a quarter should be flat gray.
+static void test_draw(skiatest::Reporter* reporter) {
+    SkBitmap src;
+    make_checkerboard(&src, 128);
+
+    size_t bytesBefore = SkScaledImageCache::GetBytesUsed();
+    SkBitmap dst;
+    draw_minified(src, true, &dst);
+    int worst = 0;
+    for (int y = 0; y < dst.height(); ++y) {
+        for (int x = 0; x < dst.width(); ++x) {
+            worst = SkMax32(worst, SkAbs32((int)SkGetPackedG32(*dst.getAddr32(x, y)) - 128));
+        }
+    }
+    REPORTER_ASSERT(reporter, worst <= 4);
+
+    // The resampled bitmap is cached, and drawing again uses it.
+    SkBitmap cached;
+    REPORTER_ASSERT(reporter, SkScaledImageCache::Find(src, 32, 32, &cached));
+    REPORTER_ASSERT(reporter, SkScaledImageCache::GetBytesUsed() >= bytesBefore);
+    SkBitmap again;
+    draw_minified(src, true, &again);
+    SkAutoLockPixels alp0(dst), alp1(again);
+    REPORTER_ASSERT(reporter, 0 == memcmp(dst.getPixels(), again.getPixels(), dst.getSize()));
+
+    // Changing the pixels changes the generation ID, so the old entry is not
+    // found.
+    src.eraseColor(SK_ColorRED);
+    REPORTER_ASSERT(reporter, !SkScaledImageCache::Find(src, 32, 32, &cached));
+    draw_minified(src, true, &dst);
+    REPORTER_ASSERT(reporter, SK_ColorRED == *dst.getAddr32(5, 5));
+}
+
+static void test_cache_limit(skiatest::Reporter* reporter) {
+    const size_t prevLimit = SkScaledImageCache::GetByteLimit();
+    SkScaledImageCache::SetByteLimit(16 * 1024);
+
+    SkRandom rand;
+    SkBitmap first;
+    for (int i = 0; i < 8; ++i) {
+        SkBitmap src, scaled;
+        make_noise(&src, 64, 64, &rand);
+        REPORTER_ASSERT(reporter, SkBitmapScaler::Resize(&scaled, src,
+                                                         SkBitmapScaler::kBox_ResizeMethod,
+                                                         32, 32));
+        SkScaledImageCache::Add(src, scaled);
+        REPORTER_ASSERT(reporter, SkScaledImageCache::GetBytesUsed() <= 16 * 1024);
+        if (0 == i) {
+            first = src;
+        }
+    }
+    // The oldest entry was purged to make room.
+    SkBitmap found;
+    REPORTER_ASSERT(reporter, !SkScaledImageCache::Find(first, 32, 32, &found));
+
+    SkScaledImageCache::PurgeAll();
+    REPORTER_ASSERT(reporter, 0 == SkScaledImageCache::GetBytesUsed());
+    REPORTER_ASSERT(reporter, 16 * 1024 == SkScaledImageCache::SetByteLimit(prevLimit));
+}
+
+static void TestBitmapScaler(skiatest::Reporter* reporter) {
+    test_filter_weights(reporter);
+    test_matches_reference(reporter);
+    test_solid_color(reporter);
+    test_bad_sizes(reporter);
+    test_draw(reporter);
+    test_cache_limit(reporter);
+}
+
+#include "TestClassDef.h"
+DEFINE_TESTCLASS("BitmapScaler", BitmapScalerTestClass, TestBitmapScaler)
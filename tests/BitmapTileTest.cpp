@@ -0,0 +1,180 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkBitmap.h"
+#include "SkCanvas.h"
+#include "SkColorPriv.h"
+#include "SkFloatingPoint.h"
+#include "SkShader.h"
+#include "Test.h"
+
+static const int kSrcSize = 32;
+static const int kDstSize = 64;
+
+// A bitmap whose channels are smooth and periodic across its edges, so that
+// neighbouring samples stay close wherever the tiling wraps them.
+static void make_bitmap(SkBitmap* bitmap, SkBitmap::Config config) {
+    bitmap->setConfig(config, kSrcSize, kSrcSize);
+    bitmap->allocPixels();
+    for (int y = 0; y < kSrcSize; ++y) {
+        for (int x = 0; x < kSrcSize; ++x) {
+            float ax = 2 * SK_ScalarPI * x / kSrcSize;
+            float ay = 2 * SK_ScalarPI * y / kSrcSize;
+            unsigned r = (unsigned)(128 + 100 * sk_float_cos(ax));
+            unsigned g = (unsigned)(128 + 100 * sk_float_sin(ay));
+            unsigned b = (unsigned)(128 + 100 * sk_float_cos(ax + ay));
+            if (SkBitmap::kRGB_565_Config == config) {
+                *bitmap->getAddr16(x, y) = SkPack888ToRGB16(r, g, b);
+            } else {
+                *bitmap->getAddr32(x, y) = SkPackARGB32(0xFF, r, g, b);
+            }
+        }
+    }
+    bitmap->setIsOpaque(true);
+}
+
+static SkPMColor get_pixel(const SkBitmap& bitmap, int x, int y) {
+    if (SkBitmap::kRGB_565_Config == bitmap.config()) {
+        return SkPixel16ToPixel32(*bitmap.getAddr16(x, y));
+    }
+    return *bitmap.getAddr32(x, y);
+}
+
+static int tile(int i, SkShader::TileMode mode) {
+    if (SkShader::kRepeat_TileMode == mode) {
+        i %= kSrcSize;
+        return i < 0 ? i + kSrcSize : i;
+    }
+    i %= 2 * kSrcSize;
+    if (i < 0) {
+        i += 2 * kSrcSize;
+    }
+    return i < kSrcSize ? i : 2 * kSrcSize - 1 - i;
+}
+
+static float lerp(float a, float b, float t) {
+    return a + (b - a) * t;
+}
+
+// Samples channel shift of src at (u, v), bilinearly if filter is set.
+static float sample(const SkBitmap& src, float u, float v, SkShader::TileMode mode,
+                    bool filter, int shift) {
+    if (!filter) {
+        return (float)((get_pixel(src, tile(sk_float_floor2int(u), mode),
+                                  tile(sk_float_floor2int(v), mode)) >> shift) & 0xFF);
+    }
+    u -= 0.5f;
+    v -= 0.5f;
+    int x = sk_float_floor2int(u);
+    int y = sk_float_floor2int(v);
+    float tx = u - x;
+    float ty = v - y;
+    float c[4];
+    for (int i = 0; i < 4; ++i) {
+        c[i] = (float)((get_pixel(src, tile(x + (i & 1), mode),
+                                  tile(y + (i >> 1), mode)) >> shift) & 0xFF);
+    }
+    return lerp(lerp(c[0], c[1], tx), lerp(c[2], c[3], tx), ty);
+}
+
+static bool match(const SkBitmap& src, SkPMColor c, float u, float v,
+                  SkShader::TileMode mode, bool filter, float tolerance) {
+    static const int kShifts[] = { SK_R32_SHIFT, SK_G32_SHIFT, SK_B32_SHIFT };
+    // Without filtering, fixed point rounding may pick the texel next to the
+    // one the float reference lands in.
+    const int reach = filter ? 0 : 1;
+    for (int dy = -reach; dy <= reach; ++dy) {
+        for (int dx = -reach; dx <= reach; ++dx) {
+            size_t i = 0;
+            for (; i < SK_ARRAY_COUNT(kShifts); ++i) {
+                float expected = sample(src, u + dx, v + dy, mode, filter, kShifts[i]);
+                if (sk_float_abs(expected - ((c >> kShifts[i]) & 0xFF)) > tolerance) {
+                    break;
+                }
+            }
+            if (SK_ARRAY_COUNT(kShifts) == i) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Draws src through a tiled shader and checks the result against a float
+// reference. Filtering steps in 1/16 of a pixel and perspective is
+// interpolated between exact points, so the odd pixel may still be off; more
+// than that means the sampling is wrong.
+static void test_draw(skiatest::Reporter* reporter, const SkBitmap& src,
+                      SkShader::TileMode mode, const SkMatrix& matrix, bool filter) {
+    SkShader* shader = SkShader::CreateBitmapShader(src, mode, mode);
+    shader->setLocalMatrix(matrix);
+    SkPaint paint;
+    paint.setShader(shader)->unref();
+    paint.setFilterBitmap(filter);
+
+    SkBitmap dst;
+    dst.setConfig(SkBitmap::kARGB_8888_Config, kDstSize, kDstSize);
+    dst.allocPixels();
+    dst.eraseColor(SK_ColorBLACK);
+    SkCanvas canvas(dst);
+    canvas.drawPaint(paint);
+
+    SkMatrix inverse;
+    REPORTER_ASSERT(reporter, matrix.invert(&inverse));
+    const float tolerance = SkBitmap::kRGB_565_Config == src.config() ? 10.f : 6.f;
+    int bad = 0;
+    for (int y = 0; y < kDstSize; ++y) {
+        for (int x = 0; x < kDstSize; ++x) {
+            SkPoint pt;
+            inverse.mapXY(x + SK_ScalarHalf, y + SK_ScalarHalf, &pt);
+            SkPMColor c = *dst.getAddr32(x, y);
+            if (!match(src, c, SkScalarToFloat(pt.fX), SkScalarToFloat(pt.fY), mode, filter,
+                       tolerance)) {
+                ++bad;
+            }
+        }
+    }
+    REPORTER_ASSERT(reporter, bad * 50 <= kDstSize * kDstSize);
+}
+
+static void TestBitmapTile(skiatest::Reporter* reporter) {
+    static const SkBitmap::Config gConfigs[] = {
+        SkBitmap::kARGB_8888_Config,
+        SkBitmap::kRGB_565_Config,
+    };
+    static const SkShader::TileMode gModes[] = {
+        SkShader::kRepeat_TileMode,
+        SkShader::kMirror_TileMode,
+    };
+
+    SkMatrix matrices[4];
+    matrices[0].setScale(1.37f, 0.71f);
+    matrices[0].postTranslate(-13.3f, 7.9f);
+    matrices[1].setScale(-0.63f, 1.21f);
+    matrices[1].postTranslate(5.1f, -40.2f);
+    matrices[2].setRotate(27);
+    matrices[2].postScale(0.9f, 1.1f);
+    matrices[2].postTranslate(-3.7f, 11.3f);
+    matrices[3].setRotate(-15);
+    matrices[3].postTranslate(2.3f, -6.1f);
+    matrices[3].setPerspX(0.002f);
+    matrices[3].setPerspY(-0.001f);
+
+    for (size_t c = 0; c < SK_ARRAY_COUNT(gConfigs); ++c) {
+        SkBitmap src;
+        make_bitmap(&src, gConfigs[c]);
+        for (size_t m = 0; m < SK_ARRAY_COUNT(gModes); ++m) {
+            for (size_t i = 0; i < SK_ARRAY_COUNT(matrices); ++i) {
+                test_draw(reporter, src, gModes[m], matrices[i], false);
+                test_draw(reporter, src, gModes[m], matrices[i], true);
+            }
+        }
+    }
+}
+
+#include "TestClassDef.h"
+DEFINE_TESTCLASS("BitmapTile", BitmapTileTestClass, TestBitmapTile)
@@ -7,9 +7,11 @@
  */
 #include "Test.h"
 #include "SkBitmap.h"
+#include "SkBlitRow.h"
 #include "SkCanvas.h"
 #include "SkColorPriv.h"
 #include "SkGradientShader.h"
+#include "SkRandom.h"
 #include "SkRect.h"
 
 static inline const char* boolStr(bool value) {
@@ -267,9 +269,88 @@ static void test_diagonal(skiatest::Reporter* reporter) {
     }
 }
 
+static SkPMColor random_pmcolor(SkRandom* rand) {
+    // Favor fully opaque and fully transparent pixels, which procs may
+    // special-case.
+    switch (rand->nextU() % 4) {
+        case 0:
+            return 0;
+        case 1:
+            return rand->nextU() | (0xFF << SK_A32_SHIFT);
+        default: {
+            unsigned a = rand->nextU() & 0xFF;
+            return SkPackARGB32(a, rand->nextULessThan(a + 1), rand->nextULessThan(a + 1),
+                                rand->nextULessThan(a + 1));
+        }
+    }
+}
+
+// The portable definition of each SkBlitRow::Proc32, one pixel at a time.
+static SkPMColor blend32(unsigned flags, SkPMColor src, SkPMColor dst, U8CPU alpha) {
+    switch (flags) {
+        case 0:
+            return src;
+        case SkBlitRow::kGlobalAlpha_Flag32: {
+            unsigned scale = SkAlpha255To256(alpha);
+            return SkAlphaMulQ(src, scale) + SkAlphaMulQ(dst, 256 - scale);
+        }
+        case SkBlitRow::kSrcPixelAlpha_Flag32:
+            return SkPMSrcOver(src, dst);
+        default:
+            return SkBlendARGB32(src, dst, alpha);
+    }
+}
+
+/*  Whatever procs the platform picks (SSE2, AVX2, NEON...) must give exactly
+ *  the portable results, for every length and alignment of the rows.
+ */
+static void test_procs32(skiatest::Reporter* reporter) {
+    static const int kMaxCount = 70;
+    // Callers only ask for kGlobalAlpha_Flag32 when the alpha is not opaque.
+    static const U8CPU gAlphas[] = { 0, 1, 0x80, 0xFE };
+    SkRandom rand;
+    SkPMColor src[kMaxCount + 8], dst[kMaxCount + 8], expected[kMaxCount + 8];
+
+    for (unsigned flags = 0; flags < 4; flags++) {
+        SkBlitRow::Proc32 proc = SkBlitRow::Factory32(flags);
+        for (size_t a = 0; a < SK_ARRAY_COUNT(gAlphas); a++) {
+            const U8CPU alpha = (flags & SkBlitRow::kGlobalAlpha_Flag32) ? gAlphas[a] : 0xFF;
+            for (int count = 0; count <= kMaxCount; count++) {
+                const int srcOffset = rand.nextULessThan(8);
+                const int dstOffset = rand.nextULessThan(8);
+                for (int i = 0; i < kMaxCount + 8; i++) {
+                    src[i] = random_pmcolor(&rand);
+                    dst[i] = expected[i] = random_pmcolor(&rand);
+                }
+                for (int i = 0; i < count; i++) {
+                    expected[dstOffset + i] = blend32(flags, src[srcOffset + i],
+                                                      dst[dstOffset + i], alpha);
+                }
+                proc(dst + dstOffset, src + srcOffset, count, alpha);
+                REPORTER_ASSERT(reporter, !memcmp(dst, expected, sizeof(dst)));
+            }
+        }
+    }
+
+    SkBlitRow::ColorProc colorProc = SkBlitRow::ColorProcFactory();
+    for (int count = 0; count <= kMaxCount; count++) {
+        const int srcOffset = rand.nextULessThan(8);
+        const int dstOffset = rand.nextULessThan(8);
+        const SkPMColor color = random_pmcolor(&rand);
+        for (int i = 0; i < kMaxCount + 8; i++) {
+            src[i] = random_pmcolor(&rand);
+            dst[i] = expected[i] = random_pmcolor(&rand);
+        }
+        SkBlitRow::Color32(expected + dstOffset, src + srcOffset, count, color);
+        colorProc(dst + dstOffset, src + srcOffset, count, color);
+        REPORTER_ASSERT(reporter, !memcmp(dst, expected, sizeof(dst)));
+    }
+}
+
 static void TestBlitRow(skiatest::Reporter* reporter) {
     test_00_FF(reporter);
     test_diagonal(reporter);
+    test_procs32(reporter);
 }
 
 #include "TestClassDef.h"
@@ -6,10 +6,15 @@
  * found in the LICENSE file.
  */
 #include "Test.h"
+#include "SkBlurMask.h"
 #include "SkBlurMaskFilter.h"
+#include "SkBoxBlurProcs.h"
 #include "SkCanvas.h"
+#include "SkColorPriv.h"
 #include "SkMath.h"
 #include "SkPaint.h"
+#include "SkRandom.h"
+#include "SkThreadPool.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -157,5 +162,214 @@ static void test_blur(skiatest::Reporter* reporter) {
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SK_DISABLE_BLUR_ROUNDING
+static const uint32_t kHalf = 1 << 23;
+#else
+static const uint32_t kHalf = 0;
+#endif
+
+// Straightforward versions of the box blur passes described in SkBoxBlurProcs.h.
+
+static void ref_blur_A8(const uint8_t* src, int srcRowBytes, uint8_t* dst,
+                        int leftRadius, int rightRadius, int width, int height,
+                        bool transpose) {
+    int diameter = leftRadius + rightRadius;
+    uint32_t scale = (1 << 24) / (diameter + 1);
+    int pad = SkMax32(rightRadius - leftRadius, 0);
+    int newWidth = width + 2 * SkMax32(leftRadius, rightRadius);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < newWidth; ++x) {
+            // Output x sums the source pixels [j - diameter, j].
+            int j = x - pad;
+            uint32_t sum = 0;
+            if (j >= 0 && j < width + diameter) {
+                for (int i = SkMax32(j - diameter, 0); i <= SkMin32(j, width - 1); ++i) {
+                    sum += src[y * srcRowBytes + i];
+                }
+            }
+            uint8_t value = (sum * scale + kHalf) >> 24;
+            if (transpose) {
+                dst[x * height + y] = value;
+            } else {
+                dst[y * newWidth + x] = value;
+            }
+        }
+    }
+}
+
+static void ref_blur_interp_A8(const uint8_t* src, int srcRowBytes, uint8_t* dst,
+                               int radius, int width, int height, bool transpose,
+                               uint8_t outerWeight) {
+    int diameter = radius * 2;
+    int kernelSize = diameter + 1;
+    int innerWeight = 255 - outerWeight;
+    int outer = outerWeight + (outerWeight >> 7);
+    int inner = innerWeight + (innerWeight >> 7);
+    uint32_t outerScale = (outer << 16) / kernelSize;
+    uint32_t innerScale = (inner << 16) / (kernelSize - 2);
+    int newWidth = width + diameter;
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = src + y * srcRowBytes;
+        uint32_t outerSum = 0, innerSum = 0;
+        for (int x = 0; x < newWidth; ++x) {
+            // Add the pixel entering the outer kernel and take away the one
+            // that left it. The inner kernel leaves out both ends of the
+            // outer one, but is not updated between the two borders when the
+            // row is narrower than the kernel, like SkBlurMask's loops.
+            int leaving = x - diameter - 1;
+            if (leaving >= 0 && leaving < width) {
+                outerSum -= row[leaving];
+            }
+            if (x < width) {
+                innerSum = outerSum;
+                if (x - diameter >= 0) {
+                    innerSum -= row[x - diameter];
+                }
+                outerSum += row[x];
+            } else if (x >= diameter) {
+                innerSum = outerSum - row[x - diameter];
+            }
+            uint8_t value = (outerSum * outerScale + innerSum * innerScale + kHalf) >> 24;
+            if (transpose) {
+                dst[x * height + y] = value;
+            } else {
+                dst[y * newWidth + x] = value;
+            }
+        }
+    }
+}
+
+static void ref_blur_32(const SkPMColor* src, int srcRowPixels, SkPMColor* dst,
+                        int dstRowPixels, int kernelSize, int leftOffset, int rightOffset,
+                        int width, int height, bool transpose) {
+    uint32_t scale = (1 << 24) / kernelSize;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint32_t a = 0, r = 0, g = 0, b = 0;
+            for (int i = SkMax32(x - leftOffset, 0);
+                 i <= SkMin32(x + rightOffset, width - 1); ++i) {
+                SkPMColor c = src[y * srcRowPixels + i];
+                a += SkGetPackedA32(c);
+                r += SkGetPackedR32(c);
+                g += SkGetPackedG32(c);
+                b += SkGetPackedB32(c);
+            }
+            SkPMColor value = SkPackARGB32((a * scale + kHalf) >> 24,
+                                           (r * scale + kHalf) >> 24,
+                                           (g * scale + kHalf) >> 24,
+                                           (b * scale + kHalf) >> 24);
+            if (transpose) {
+                dst[x * dstRowPixels + y] = value;
+            } else {
+                dst[y * dstRowPixels + x] = value;
+            }
+        }
+    }
+}
+
+static SkPMColor random_pmcolor(SkRandom* rand) {
+    U8CPU a = rand->nextU() & 0xFF;
+    return SkPackARGB32(a, rand->nextULessThan(a + 1), rand->nextULessThan(a + 1),
+                        rand->nextULessThan(a + 1));
+}
+
+// Checks the platform's SIMD box blur procs, if it has any, against the
+// reference blurs, over sizes that leave partial tiles and kernels wider than
+// the image.
+static void test_box_blur_procs(skiatest::Reporter* reporter) {
+    SkBoxBlurProcs procs;
+    if (!SkBoxBlurGetPlatformProcs(&procs)) {
+        return;
+    }
+
+    static const int kSizes[] = { 1, 5, 16, 23, 40 };
+    static const int kRadii[] = { 1, 2, 7, 30 };
+    SkRandom rand;
+    for (size_t wi = 0; wi < SK_ARRAY_COUNT(kSizes); ++wi) {
+        for (size_t hi = 0; hi < SK_ARRAY_COUNT(kSizes); ++hi) {
+            int w = kSizes[wi], h = kSizes[hi];
+            int srcRowBytes = w + 3;
+            SkAutoTMalloc<uint8_t> src(srcRowBytes * h);
+            SkAutoTMalloc<SkPMColor> src32(srcRowBytes * h);
+            for (int i = 0; i < srcRowBytes * h; ++i) {
+                src[i] = rand.nextU() & 0xFF;
+                src32[i] = random_pmcolor(&rand);
+            }
+
+            for (size_t ri = 0; ri < SK_ARRAY_COUNT(kRadii); ++ri) {
+                int radius = kRadii[ri];
+                int lo = radius - (int)(rand.nextU() & 1);
+                int size = (w + 2 * radius) * h;
+                SkAutoTMalloc<uint8_t> expected(size), actual(size);
+                SkAutoTMalloc<SkPMColor> expected32(w * h), actual32(w * h);
+                for (int transpose = 0; transpose < 2; ++transpose) {
+                    ref_blur_A8(src.get(), srcRowBytes, expected.get(), lo, radius, w, h,
+                                SkToBool(transpose));
+                    procs.fA8(src.get(), srcRowBytes, actual.get(), lo, radius, w, h,
+                              SkToBool(transpose), 0, h);
+                    REPORTER_ASSERT(reporter, !memcmp(expected.get(), actual.get(), size));
+
+                    uint8_t outerWeight = rand.nextU() & 0xFF;
+                    ref_blur_interp_A8(src.get(), srcRowBytes, expected.get(), radius, w, h,
+                                       SkToBool(transpose), outerWeight);
+                    procs.fInterpA8(src.get(), srcRowBytes, actual.get(), radius, w, h,
+                                    SkToBool(transpose), outerWeight, 0, h);
+                    REPORTER_ASSERT(reporter, !memcmp(expected.get(), actual.get(), size));
+
+                    int dstRowPixels = transpose ? h : w;
+                    ref_blur_32(src32.get(), srcRowBytes, expected32.get(), dstRowPixels,
+                                lo + radius + 1, lo, radius, w, h, SkToBool(transpose));
+                    procs.f32(src32.get(), srcRowBytes, actual32.get(), dstRowPixels,
+                              lo + radius + 1, lo, radius, w, h, SkToBool(transpose), 0, h);
+                    REPORTER_ASSERT(reporter, !memcmp(expected32.get(), actual32.get(),
+                                                      w * h * sizeof(SkPMColor)));
+                }
+            }
+        }
+    }
+}
+
+// Blurs big enough to be split into bands must match the single threaded blur.
+static void test_threaded_blur(skiatest::Reporter* reporter) {
+    SkMask src;
+    src.fBounds.set(0, 0, 300, 250);
+    src.fRowBytes = src.fBounds.width();
+    src.fFormat = SkMask::kA8_Format;
+    src.fImage = SkMask::AllocImage(src.computeImageSize());
+    SkRandom rand;
+    for (size_t i = 0; i < src.computeImageSize(); ++i) {
+        src.fImage[i] = rand.nextU() & 0xFF;
+    }
+
+    static const SkScalar kRadii[] = { SkIntToScalar(8), SkFloatToScalar(20.5f) };
+    SkThreadPool pool(3);
+    for (size_t i = 0; i < SK_ARRAY_COUNT(kRadii); ++i) {
+        for (int quality = 0; quality < 2; ++quality) {
+            SkMask expected, actual;
+            SkBlurMask::BlurSeparable(&expected, src, kRadii[i], SkBlurMask::kNormal_Style,
+                                      (SkBlurMask::Quality)quality);
+            SkBlurMaskFilter::SetThreadPool(&pool);
+            SkBlurMask::BlurSeparable(&actual, src, kRadii[i], SkBlurMask::kNormal_Style,
+                                      (SkBlurMask::Quality)quality);
+            SkBlurMaskFilter::SetThreadPool(NULL);
+
+            REPORTER_ASSERT(reporter, expected.fBounds == actual.fBounds);
+            REPORTER_ASSERT(reporter, !memcmp(expected.fImage, actual.fImage,
+                                              expected.computeImageSize()));
+            SkMask::FreeImage(expected.fImage);
+            SkMask::FreeImage(actual.fImage);
+        }
+    }
+    SkMask::FreeImage(src.fImage);
+}
+
+static void test_blurs(skiatest::Reporter* reporter) {
+    test_blur(reporter);
+    test_box_blur_procs(reporter);
+    test_threaded_blur(reporter);
+}
+
 #include "TestClassDef.h"
-DEFINE_TESTCLASS("BlurMaskFilter", BlurTestClass, test_blur)
+DEFINE_TESTCLASS("BlurMaskFilter", BlurTestClass, test_blurs)
@@ -11,6 +11,7 @@
 #include "SkDeferredCanvas.h"
 #include "SkDevice.h"
 #include "SkGradientShader.h"
+#include "SkRandom.h"
 #include "SkShader.h"
 
 static const int gWidth = 2;
@@ -465,6 +466,86 @@ static void TestDeferredCanvasBitmapSizeThreshold(skiatest::Reporter* reporter)
     }
 }
 
+static void draw_random_content(SkCanvas* canvas, SkRandom* rand, const SkBitmap& sourceImage,
+                                int count) {
+    SkPaint paint;
+    for (int i = 0; i < count; i++) {
+        SkRect rect = SkRect::MakeXYWH(rand->nextRangeScalar(-20, 200),
+                                       rand->nextRangeScalar(-20, 200),
+                                       rand->nextRangeScalar(1, 60),
+                                       rand->nextRangeScalar(1, 60));
+        paint.setColor(rand->nextU());
+        paint.setAntiAlias(rand->nextBool());
+        if (i % 50 == 0) {
+            canvas->drawBitmap(sourceImage, rect.fLeft, rect.fTop, &paint);
+        } else {
+            canvas->drawRect(rect, paint);
+        }
+    }
+}
+
+static void TestDeferredCanvasThreadedPlayback(skiatest::Reporter* reporter) {
+    static const size_t kMaxStorage = 64 * 1024;
+    static const int kDrawCount = 5000;
+
+    SkBitmap store;
+    store.setConfig(SkBitmap::kARGB_8888_Config, 200, 200);
+    store.allocPixels();
+    store.eraseColor(SK_ColorWHITE);
+    SkDevice device(store);
+    SkDeferredCanvas canvas(&device);
+    canvas.setMaxRecordingStorage(kMaxStorage);
+    // Playback stays on this thread in builds without SkCondVar, and the
+    // results must be the same either way.
+    canvas.setThreadedPlayback(true);
+#if defined(SK_BUILD_FOR_UNIX) || defined(SK_BUILD_FOR_MAC) || \
+    defined(SK_BUILD_FOR_ANDROID) || defined(SK_BUILD_FOR_WIN32)
+    // These platforms have SkCondVar, so a build that loses the threaded
+    // path (e.g. by not defining SK_USE_POSIX_THREADS) must fail here.
+    REPORTER_ASSERT(reporter, canvas.isThreadedPlayback());
+#endif
+
+    SkBitmap expected;
+    expected.setConfig(SkBitmap::kARGB_8888_Config, 200, 200);
+    expected.allocPixels();
+    expected.eraseColor(SK_ColorWHITE);
+    SkCanvas expectedCanvas(expected);
+
+    SkBitmap sourceImage;
+    sourceImage.setConfig(SkBitmap::kARGB_8888_Config, 20, 20);
+    sourceImage.allocPixels();
+    sourceImage.eraseColor(SK_ColorBLUE);
+
+    SkRandom rand;
+    SkRandom expectedRand;
+    draw_random_content(&canvas, &rand, sourceImage, kDrawCount);
+    draw_random_content(&expectedCanvas, &expectedRand, sourceImage, kDrawCount);
+
+    // Recording waits for playback rather than storing more than the limit.
+    REPORTER_ASSERT(reporter, canvas.storageAllocatedForRecording() <= kMaxStorage);
+    REPORTER_ASSERT(reporter, canvas.hasPendingCommands());
+
+    // Accessing the pixels waits for all of the commands to be drawn.
+    canvas.getDevice()->accessBitmap(false);
+    REPORTER_ASSERT(reporter, !canvas.hasPendingCommands());
+    {
+        SkAutoLockPixels alp(store);
+        SkAutoLockPixels alpExpected(expected);
+        REPORTER_ASSERT(reporter, 0 == memcmp(store.getPixels(), expected.getPixels(),
+                                              store.getSize()));
+    }
+
+    // Commands recorded in one mode are drawn before switching to the other.
+    bool switching = canvas.isThreadedPlayback();
+    canvas.clear(SK_ColorRED);
+    canvas.setThreadedPlayback(false);
+    REPORTER_ASSERT(reporter, !canvas.isThreadedPlayback());
+    if (switching) {
+        SkAutoLockPixels alp(store);
+        REPORTER_ASSERT(reporter, store.getColor(0, 0) == SK_ColorRED);
+    }
+}
+
 static void TestDeferredCanvas(skiatest::Reporter* reporter) {
     TestDeferredCanvasBitmapAccess(reporter);
     TestDeferredCanvasFlush(reporter);
@@ -474,6 +555,7 @@ static void TestDeferredCanvas(skiatest::Reporter* reporter) {
     TestDeferredCanvasSkip(reporter);
     TestDeferredCanvasBitmapShaderNoLeak(reporter);
     TestDeferredCanvasBitmapSizeThreshold(reporter);
+    TestDeferredCanvasThreadedPlayback(reporter);
 }
 
 #include "TestClassDef.h"
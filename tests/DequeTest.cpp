@@ -161,11 +161,44 @@ static void TestSub(skiatest::Reporter* reporter, int allocCount) {
     assert_blocks(reporter, deq, allocCount);
 }
 
+// Emptying a deque from both ends leaves an empty block linked in at each
+// end. Pushing afterwards must still give a valid front and back.
+static void TestMixedPops(skiatest::Reporter* reporter, int allocCount) {
+    SkDeque deq(sizeof(int), allocCount);
+    int i;
+
+    for (i = 0; i < 2 * allocCount; i++) {
+        *(int*)deq.push_back() = i;
+    }
+    for (i = 0; i < allocCount; i++) {
+        deq.pop_back();
+    }
+    for (i = 0; i < allocCount; i++) {
+        deq.pop_front();
+    }
+    assert_count(reporter, deq, 0);
+
+    *(int*)deq.push_back() = 1;
+    assert_count(reporter, deq, 1);
+    assert_iter(reporter, deq, 1, 1);
+    deq.pop_front();
+    assert_count(reporter, deq, 0);
+
+    *(int*)deq.push_front() = 1;
+    assert_count(reporter, deq, 1);
+    assert_iter(reporter, deq, 1, 1);
+    deq.pop_back();
+    assert_count(reporter, deq, 0);
+}
+
 static void TestDeque(skiatest::Reporter* reporter) {
     // test it once with the default allocation count
     TestSub(reporter, 1);
     // test it again with a generous allocation count
     TestSub(reporter, 10);
+
+    TestMixedPops(reporter, 1);
+    TestMixedPops(reporter, 10);
 }
 #include "TestClassDef.h"
 DEFINE_TESTCLASS("Deque", TestDequeClass, TestDeque)
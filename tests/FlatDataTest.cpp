@@ -50,6 +50,62 @@ static void testCreate(skiatest::Reporter* reporter, const void* obj,
     REPORTER_ASSERT(reporter, SkFlatData::Compare(data1, data2) == 0);
 }
 
+static void set_matrix(SkMatrix* matrix, int i) {
+    matrix->setTranslate(SkIntToScalar(i), SkIntToScalar(i % 7));
+}
+
+/**
+ * Verify that an SkFlatDictionary gives each unique object one index, after
+ * growing its hash table and after replacing entries.
+ */
+static void testDictionary(skiatest::Reporter* reporter) {
+    static const int kCount = 1000;
+    Controller controller;
+    SkMatrixDictionary dictionary(&controller);
+
+    SkMatrix matrix;
+    for (int i = 0; i < kCount; ++i) {
+        set_matrix(&matrix, i);
+        REPORTER_ASSERT(reporter, dictionary.find(matrix) == i + 1);
+    }
+    REPORTER_ASSERT(reporter, dictionary.count() == kCount);
+    for (int i = kCount - 1; i >= 0; --i) {
+        set_matrix(&matrix, i);
+        REPORTER_ASSERT(reporter, dictionary.find(matrix) == i + 1);
+        REPORTER_ASSERT(reporter, dictionary[i]->index() == i + 1);
+    }
+    REPORTER_ASSERT(reporter, dictionary.count() == kCount);
+
+    SkTRefArray<SkMatrix>* array = dictionary.unflattenToArray();
+    REPORTER_ASSERT(reporter, NULL != array && array->count() == kCount);
+    for (int i = 0; NULL != array && i < kCount; ++i) {
+        set_matrix(&matrix, i);
+        REPORTER_ASSERT(reporter, (*array)[i] == matrix);
+    }
+    SkSafeUnref(array);
+
+    // Replace every other entry, which takes its index.
+    for (int i = 0; i < kCount; i += 2) {
+        bool added, replaced;
+        const SkFlatData* toReplace = dictionary[i];
+        set_matrix(&matrix, kCount + i);
+        const SkFlatData* flat = dictionary.findAndReplace(matrix, toReplace, &added, &replaced);
+        REPORTER_ASSERT(reporter, added && replaced);
+        REPORTER_ASSERT(reporter, flat->index() == i + 1);
+    }
+    REPORTER_ASSERT(reporter, dictionary.count() == kCount);
+    for (int i = 0; i < kCount; ++i) {
+        set_matrix(&matrix, i & 1 ? i : kCount + i);
+        REPORTER_ASSERT(reporter, dictionary.find(matrix) == i + 1);
+    }
+    REPORTER_ASSERT(reporter, dictionary.count() == kCount);
+
+    dictionary.reset();
+    REPORTER_ASSERT(reporter, dictionary.count() == 0);
+    set_matrix(&matrix, 1);
+    REPORTER_ASSERT(reporter, dictionary.find(matrix) == 1);
+}
+
 static void Tests(skiatest::Reporter* reporter) {
     // Test flattening SkShader
     SkPoint points[2];
@@ -85,6 +141,8 @@ static void Tests(skiatest::Reporter* reporter) {
     SkXfermode* xfer = SkXfermode::Create(SkXfermode::kDstOver_Mode);
     SkAutoUnref aurxf(xfer);
     testCreate(reporter, xfer, &flattenFlattenableProc);
+
+    testDictionary(reporter);
 }
 
 #include "TestClassDef.h"
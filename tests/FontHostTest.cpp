@@ -6,9 +6,13 @@
  */
 
 #include "Test.h"
+#include "SkBitmap.h"
+#include "SkCanvas.h"
+#include "SkGraphics.h"
 #include "SkPaint.h"
 #include "SkFontStream.h"
 #include "SkStream.h"
+#include "SkThreadPool.h"
 #include "SkTypeface.h"
 #include "SkEndian.h"
 
@@ -233,10 +237,57 @@ static void test_advances(skiatest::Reporter* reporter) {
     }
 }
 
+static const int kThreadedSizeCount = 24;
+
+static void draw_glyphs_at_size(void* context, int index) {
+    SkBitmap* bitmaps = (SkBitmap*)context;
+    SkBitmap& bm = bitmaps[index];
+    bm.setConfig(SkBitmap::kARGB_8888_Config, 128, 64);
+    bm.allocPixels();
+    bm.eraseColor(SK_ColorWHITE);
+
+    SkCanvas canvas(bm);
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    paint.setTextSize(SkIntToScalar(8 + index));
+
+    const char text[] = "Sphinx of black quartz";
+    canvas.drawText(text, strlen(text), 0, SkIntToScalar(48), paint);
+}
+
+/*
+ * Generates glyphs for many strikes at once from several threads, starting
+ * from an empty glyph cache, and checks they match glyphs generated on one
+ * thread.
+ */
+static void test_threaded_glyphs(skiatest::Reporter* reporter) {
+    SkBitmap expected[kThreadedSizeCount];
+    SkGraphics::PurgeFontCache();
+    for (int i = 0; i < kThreadedSizeCount; ++i) {
+        draw_glyphs_at_size(expected, i);
+    }
+
+    SkBitmap actual[kThreadedSizeCount];
+    SkGraphics::PurgeFontCache();
+    {
+        SkThreadPool pool(4);
+        pool.parallelFor(kThreadedSizeCount, draw_glyphs_at_size, actual);
+    }
+
+    for (int i = 0; i < kThreadedSizeCount; ++i) {
+        SkAutoLockPixels alpe(expected[i]);
+        SkAutoLockPixels alpa(actual[i]);
+        REPORTER_ASSERT(reporter, 0 == memcmp(expected[i].getPixels(),
+                                              actual[i].getPixels(),
+                                              expected[i].getSize()));
+    }
+}
+
 static void TestFontHost(skiatest::Reporter* reporter) {
     test_tables(reporter);
     test_fontstream(reporter);
     test_advances(reporter);
+    test_threaded_glyphs(reporter);
 }
 
 // need tests for SkStrSearch
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "Test.h"
+#include "SkBitmap.h"
+#include "SkCanvas.h"
+#include "SkGlyphCache.h"
+#include "SkGlyphStore.h"
+#include "SkGraphics.h"
+#include "SkOSFile.h"
+#include "SkPaint.h"
+#include "SkThreadPool.h"
+
+static const char gText[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+static void measure_at_size(int size) {
+    SkPaint paint;
+    paint.setTextSize(SkIntToScalar(size));
+    paint.measureText(gText, strlen(gText));
+}
+
+static bool count_proc(SkGlyphCache*, void* context) {
+    *(int*)context += 1;
+    return false;
+}
+
+static bool stop_proc(SkGlyphCache*, void* context) {
+    *(int*)context += 1;
+    return true;
+}
+
+static int count_caches() {
+    int count = 0;
+    SkGlyphCache::VisitAllCaches(count_proc, &count);
+    return count;
+}
+
+// VisitAllCaches has to see every strike, whichever shard it landed in.
+static void test_visit_all(skiatest::Reporter* reporter) {
+    SkGraphics::PurgeFontCache();
+    REPORTER_ASSERT(reporter, 0 == SkGraphics::GetFontCacheUsed());
+    REPORTER_ASSERT(reporter, 0 == count_caches());
+
+    static const int kSizeCount = 16;
+    for (int i = 0; i < kSizeCount; ++i) {
+        measure_at_size(10 + i);
+    }
+    REPORTER_ASSERT(reporter, kSizeCount == count_caches());
+    REPORTER_ASSERT(reporter, SkGraphics::GetFontCacheUsed() > 0);
+
+    int visited = 0;
+    SkGlyphCache::VisitAllCaches(stop_proc, &visited);
+    REPORTER_ASSERT(reporter, 1 == visited);
+
+    SkGraphics::PurgeFontCache();
+    REPORTER_ASSERT(reporter, 0 == SkGraphics::GetFontCacheUsed());
+    REPORTER_ASSERT(reporter, 0 == count_caches());
+}
+
+static void measure_proc(void*, int index) {
+    measure_at_size(8 + index);
+}
+
+// Many threads filling the shared cache with far more strikes than fit in its
+// budget must leave it within that budget. Each shard always keeps the strike
+// it just attached, so the budget has to leave every shard room for a few.
+static void test_threaded_budget(skiatest::Reporter* reporter) {
+    const size_t limit = 2 * 1024 * 1024;
+    size_t prevLimit = SkGraphics::SetFontCacheLimit(limit);
+
+    {
+        SkThreadPool pool(4);
+        for (int i = 0; i < 4; ++i) {
+            pool.parallelFor(256, measure_proc, NULL);
+        }
+    }
+    REPORTER_ASSERT(reporter, SkGraphics::GetFontCacheUsed() <= limit);
+    REPORTER_ASSERT(reporter, count_caches() > 0);
+
+    SkGraphics::SetFontCacheLimit(prevLimit);
+    SkGraphics::PurgeFontCache();
+}
+
+static void draw_text(SkBitmap* bm) {
+    bm->setConfig(SkBitmap::kARGB_8888_Config, 256, 64);
+    bm->allocPixels();
+    bm->eraseColor(SK_ColorWHITE);
+
+    SkCanvas canvas(*bm);
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    paint.setTextSize(SkIntToScalar(20));
+    canvas.drawText(gText, strlen(gText), 0, SkIntToScalar(40), paint);
+}
+
+static int count_stored_glyphs() {
+    SkAutoTUnref<SkGlyphStore> store(SkGlyphStore::RefGlobal());
+    return store.get() ? store->countGlyphs() : -1;
+}
+
+// Glyphs flushed to a glyph store must come back, unchanged, when the file
+// is opened again.
+static void test_glyph_store(skiatest::Reporter* reporter, const char* tmpDir) {
+    SkString path(tmpDir);
+    if (!path.endsWith(SkPATH_SEPARATOR)) {
+        path.appendUnichar(SkPATH_SEPARATOR);
+    }
+    path.append("glyph_store_test");
+
+    SkBitmap expected;
+    SkGraphics::SetGlyphStorePath(NULL);
+    draw_text(&expected);
+
+    // Start from an empty store, and fill it.
+    SkGraphics::SetGlyphStorePath(path.c_str());
+    if (!SkGraphics::FlushGlyphStore()) {
+        SkString msg;
+        msg.printf("Failed to write glyph store %s\n", path.c_str());
+        reporter->reportFailed(msg.c_str());
+        return;
+    }
+    SkGraphics::SetGlyphStorePath(path.c_str());
+    REPORTER_ASSERT(reporter, 0 == count_stored_glyphs());
+
+    SkBitmap filled;
+    draw_text(&filled);
+    int glyphCount = count_stored_glyphs();
+    REPORTER_ASSERT(reporter, glyphCount > 0);
+    REPORTER_ASSERT(reporter, SkGraphics::FlushGlyphStore());
+
+    // Reopen it, and draw from it.
+    SkGraphics::SetGlyphStorePath(path.c_str());
+    REPORTER_ASSERT(reporter, glyphCount == count_stored_glyphs());
+
+    SkBitmap reloaded;
+    draw_text(&reloaded);
+    REPORTER_ASSERT(reporter, glyphCount == count_stored_glyphs());
+
+    SkAutoLockPixels alpe(expected);
+    SkAutoLockPixels alpf(filled);
+    SkAutoLockPixels alpr(reloaded);
+    REPORTER_ASSERT(reporter, 0 == memcmp(expected.getPixels(), filled.getPixels(),
+                                          expected.getSize()));
+    REPORTER_ASSERT(reporter, 0 == memcmp(expected.getPixels(), reloaded.getPixels(),
+                                          expected.getSize()));
+
+    SkGraphics::SetGlyphStorePath(NULL);
+    remove(path.c_str());
+}
+
+static void TestGlyphCache(skiatest::Reporter* reporter) {
+    test_visit_all(reporter);
+    test_threaded_budget(reporter);
+    if (!skiatest::Test::GetTmpDir().isEmpty()) {
+        test_glyph_store(reporter, skiatest::Test::GetTmpDir().c_str());
+    }
+}
+
+#include "TestClassDef.h"
+DEFINE_TESTCLASS("GlyphCache", GlyphCacheTestClass, TestGlyphCache)
@@ -6,12 +6,16 @@
  * found in the LICENSE file.
  */
 #include "Test.h"
+#include "SkCanvas.h"
+#include "SkColorPriv.h"
 #include "SkDevice.h"
 #include "SkTemplates.h"
 #include "SkShader.h"
 #include "SkColorShader.h"
 #include "SkEmptyShader.h"
 #include "SkGradientShader.h"
+#include "SkOrderedReadBuffer.h"
+#include "SkOrderedWriteBuffer.h"
 
 struct GradRec {
     int             fColorCount;
@@ -192,9 +196,161 @@ static void TestGradientShaders(skiatest::Reporter* reporter) {
     }
 }
 
+static SkShader* make_cache_test_shader(SkColor lastColor) {
+    static const SkPoint gPts[] = { { 0, 0 }, { 16, 0 } };
+    const SkColor colors[] = { 0xFF123456, 0xFF654321, lastColor };
+    static const SkScalar gPos[] = { 0, SK_Scalar1 / 3, SK_Scalar1 };
+    return SkGradientShader::CreateLinear(gPts, colors, gPos, SK_ARRAY_COUNT(colors),
+                                          SkShader::kMirror_TileMode);
+}
+
+static void draw_cache_test_shader(SkBitmap* dst, SkShader* shader, U8CPU alpha) {
+    dst->setConfig(SkBitmap::kARGB_8888_Config, 16, 4);
+    dst->allocPixels();
+    dst->eraseColor(0);
+    SkCanvas canvas(*dst);
+    SkPaint paint;
+    paint.setShader(shader);
+    paint.setAlpha(alpha);
+    canvas.drawPaint(paint);
+}
+
+static bool same_pixels(const SkBitmap& a, const SkBitmap& b) {
+    SkAutoLockPixels alpa(a);
+    SkAutoLockPixels alpb(b);
+    return a.getSize() == b.getSize() && !memcmp(a.getPixels(), b.getPixels(), a.getSize());
+}
+
+// Nine stops, alternating black and white, so that each segment only gets
+// 32 entries of the 256-entry cache.
+static const int kInterpWidth = 1024;
+static const int kInterpSegments = 8;
+
+static SkShader* make_interp_test_shader(bool radial, uint32_t flags) {
+    SkColor colors[kInterpSegments + 1];
+    for (int i = 0; i <= kInterpSegments; ++i) {
+        colors[i] = (i & 1) ? SK_ColorWHITE : SK_ColorBLACK;
+    }
+    if (radial) {
+        SkPoint center = { 0, 0 };
+        return SkGradientShader::CreateRadial(center, SkIntToScalar(kInterpWidth), colors,
+                                              NULL, SK_ARRAY_COUNT(colors),
+                                              SkShader::kClamp_TileMode, NULL, flags);
+    }
+    static const SkPoint gPts[] = { { 0, 0 }, { SkIntToScalar(kInterpWidth), 0 } };
+    return SkGradientShader::CreateLinear(gPts, colors, NULL, SK_ARRAY_COUNT(colors),
+                                          SkShader::kClamp_TileMode, NULL, flags);
+}
+
+static void draw_interp_test_shader(SkBitmap* dst, SkShader* shader) {
+    dst->setConfig(SkBitmap::kARGB_8888_Config, kInterpWidth, 2);
+    dst->allocPixels();
+    dst->eraseColor(0);
+    SkCanvas canvas(*dst);
+    SkPaint paint;
+    paint.setShader(shader);
+    canvas.drawPaint(paint);
+}
+
+// Returns the largest difference between the red of the top row of bitmap
+// and the exact gradient.
+static float max_interp_error(const SkBitmap& bitmap, bool radial) {
+    SkAutoLockPixels alp(bitmap);
+    float maxError = 0;
+    for (int x = 0; x < kInterpWidth; ++x) {
+        float px = x + 0.5f;
+        float dist = radial ? sk_float_sqrt(px * px + 0.25f) : px;
+        float pos = dist * kInterpSegments / kInterpWidth;
+        int segment = (int)pos;
+        float frac = pos - segment;
+        float exact = 255 * ((segment & 1) ? 1 - frac : frac);
+        float error = sk_float_abs(SkGetPackedR32(*bitmap.getAddr32(x, 0)) - exact);
+        if (error > maxError) {
+            maxError = error;
+        }
+    }
+    return maxError;
+}
+
+static SkFlattenable* reincarnate_flattenable(SkFlattenable* obj) {
+    SkOrderedWriteBuffer wb(1024);
+    wb.writeFlattenable(obj);
+
+    size_t size = wb.size();
+    SkAutoSMalloc<1024> storage(size);
+    wb.writeToMemory(storage.get());
+
+    SkOrderedReadBuffer rb(storage.get(), size);
+    return rb.readFlattenable();
+}
+
+// The cache bands wide gradients with many stops; interpolated colors should
+// stay within the dither of the exact ones.
+static void TestInterpolateColors(skiatest::Reporter* reporter) {
+    for (int radial = 0; radial <= 1; ++radial) {
+        SkAutoTUnref<SkShader> cached(make_interp_test_shader(SkToBool(radial), 0));
+        SkAutoTUnref<SkShader> interp(make_interp_test_shader(
+                SkToBool(radial), SkGradientShader::kInterpolateColors_Flag));
+
+        SkBitmap drawnCached, drawnInterp;
+        draw_interp_test_shader(&drawnCached, cached);
+        draw_interp_test_shader(&drawnInterp, interp);
+        REPORTER_ASSERT(reporter, max_interp_error(drawnCached, SkToBool(radial)) > 2);
+        REPORTER_ASSERT(reporter, max_interp_error(drawnInterp, SkToBool(radial)) <= 1);
+
+        // The flag survives flattening.
+        SkAutoTUnref<SkShader> copy((SkShader*)reincarnate_flattenable(interp));
+        SkBitmap drawnCopy;
+        draw_interp_test_shader(&drawnCopy, copy);
+        REPORTER_ASSERT(reporter, same_pixels(drawnInterp, drawnCopy));
+    }
+}
+
+// Shaders with the same colors and positions should share one color table.
+static void TestGradientCache(skiatest::Reporter* reporter) {
+    // Each table is 4 dither rows of 256 colors.
+    static const size_t kTableSize = 4 * 256 * sizeof(SkPMColor);
+
+    // Leave at most one table from earlier tests in the cache.
+    size_t prevLimit = SkGradientShader::SetCacheByteLimit(0);
+    SkGradientShader::SetCacheByteLimit(1024 * 1024);
+    size_t used = SkGradientShader::GetCacheBytesUsed();
+
+    SkAutoTUnref<SkShader> a(make_cache_test_shader(0xFFABCDEF));
+    SkAutoTUnref<SkShader> b(make_cache_test_shader(0xFFABCDEF));
+    SkAutoTUnref<SkShader> c(make_cache_test_shader(0xFFFEDCBA));
+
+    SkBitmap drawnA, drawnB, drawnC, drawnAlpha;
+    draw_cache_test_shader(&drawnA, a, 0xFF);
+    REPORTER_ASSERT(reporter, used + kTableSize == SkGradientShader::GetCacheBytesUsed());
+    draw_cache_test_shader(&drawnB, b, 0xFF);
+    REPORTER_ASSERT(reporter, used + kTableSize == SkGradientShader::GetCacheBytesUsed());
+    REPORTER_ASSERT(reporter, same_pixels(drawnA, drawnB));
+
+    draw_cache_test_shader(&drawnC, c, 0xFF);
+    REPORTER_ASSERT(reporter, used + 2 * kTableSize == SkGradientShader::GetCacheBytesUsed());
+    REPORTER_ASSERT(reporter, !same_pixels(drawnA, drawnC));
+
+    // The paint's alpha is built into the table.
+    draw_cache_test_shader(&drawnAlpha, b, 0x80);
+    REPORTER_ASSERT(reporter, used + 3 * kTableSize == SkGradientShader::GetCacheBytesUsed());
+    REPORTER_ASSERT(reporter, !same_pixels(drawnA, drawnAlpha));
+
+    // Purging the cache must not take tables away from the shaders using them.
+    SkGradientShader::SetCacheByteLimit(0);
+    REPORTER_ASSERT(reporter, SkGradientShader::GetCacheBytesUsed() <= kTableSize);
+    SkBitmap drawnAgain;
+    draw_cache_test_shader(&drawnAgain, a, 0xFF);
+    REPORTER_ASSERT(reporter, same_pixels(drawnA, drawnAgain));
+
+    SkGradientShader::SetCacheByteLimit(prevLimit);
+}
+
 static void TestGradients(skiatest::Reporter* reporter) {
     TestGradientShaders(reporter);
     TestConstantGradient(reporter);
+    TestGradientCache(reporter);
+    TestInterpolateColors(reporter);
 }
 #include "TestClassDef.h"
 DEFINE_TESTCLASS("Gradients", TestGradientsClass, TestGradients)
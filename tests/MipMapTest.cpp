@@ -0,0 +1,152 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkBitmap.h"
+#include "SkCanvas.h"
+#include "SkColorPriv.h"
+#include "SkMipMap.h"
+#include "SkRandom.h"
+#include "SkScaledImageCache.h"
+#include "Test.h"
+
+static void make_bitmap(SkBitmap* bitmap, int width, int height) {
+    bitmap->setConfig(SkBitmap::kARGB_8888_Config, width, height);
+    bitmap->allocPixels();
+    SkRandom rand;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            *bitmap->getAddr32(x, y) = rand.nextU() | 0xFF000000;
+        }
+    }
+    bitmap->setIsOpaque(true);
+}
+
+static void test_levels(skiatest::Reporter* reporter) {
+    SkBitmap src;
+    make_bitmap(&src, 64, 40);
+    SkAutoTUnref<SkMipMap> mip(SkMipMap::Build(src));
+    REPORTER_ASSERT(reporter, mip.get());
+
+    // 32x20, 16x10, 8x5, 4x2 and 2x1.
+    REPORTER_ASSERT(reporter, (32 * 20 + 16 * 10 + 8 * 5 + 4 * 2 + 2 * 1) * 4 == mip->getSize());
+
+    SkBitmap level;
+    REPORTER_ASSERT(reporter, 0 == mip->extractLevel(SK_Fixed1, SK_Fixed1, &level));
+    REPORTER_ASSERT(reporter, 1 == mip->extractLevel(2 * SK_Fixed1, SK_Fixed1, &level));
+    REPORTER_ASSERT(reporter, 32 == level.width() && 20 == level.height());
+    REPORTER_ASSERT(reporter, 2 == mip->extractLevel(SK_Fixed1, -5 * SK_Fixed1, &level));
+    REPORTER_ASSERT(reporter, 16 == level.width() && 10 == level.height());
+
+    // Each level-1 pixel averages the 2x2 block under it.
+    REPORTER_ASSERT(reporter, 1 == mip->extractLevel(2 * SK_Fixed1, 2 * SK_Fixed1, &level));
+    bool averaged = true;
+    for (int y = 0; y < level.height(); ++y) {
+        for (int x = 0; x < level.width(); ++x) {
+            int sum = 0;
+            for (int i = 0; i < 4; ++i) {
+                sum += SkGetPackedG32(*src.getAddr32(2 * x + (i & 1), 2 * y + (i >> 1)));
+            }
+            averaged &= (unsigned)(sum >> 2) == SkGetPackedG32(*level.getAddr32(x, y));
+        }
+    }
+    REPORTER_ASSERT(reporter, averaged);
+
+    SkBitmap tiny, a8;
+    tiny.setConfig(SkBitmap::kARGB_8888_Config, 1, 8);
+    tiny.allocPixels();
+    REPORTER_ASSERT(reporter, NULL == SkMipMap::Build(tiny));
+    a8.setConfig(SkBitmap::kA8_Config, 8, 8);
+    a8.allocPixels();
+    REPORTER_ASSERT(reporter, NULL == SkMipMap::Build(a8));
+}
+
+// Copies of a bitmap share one mipmap through the cache, and it is only
+// accounted for once.
+static void test_shared(skiatest::Reporter* reporter) {
+    SkScaledImageCache::PurgeAll();
+
+    SkBitmap src;
+    make_bitmap(&src, 64, 64);
+    SkBitmap copy(src);
+
+    src.buildMipMap();
+    REPORTER_ASSERT(reporter, src.hasMipMap());
+    REPORTER_ASSERT(reporter, !copy.hasMipMap());
+    const size_t bytesUsed = SkScaledImageCache::GetBytesUsed();
+    REPORTER_ASSERT(reporter, bytesUsed > 0);
+
+    copy.buildMipMap();
+    REPORTER_ASSERT(reporter, copy.hasMipMap());
+    REPORTER_ASSERT(reporter, SkScaledImageCache::GetBytesUsed() == bytesUsed);
+
+    SkBitmap srcLevel, copyLevel;
+    REPORTER_ASSERT(reporter, 2 == src.extractMipLevel(&srcLevel, 4 * SK_Fixed1, 4 * SK_Fixed1));
+    REPORTER_ASSERT(reporter, 2 == copy.extractMipLevel(&copyLevel, 4 * SK_Fixed1, 4 * SK_Fixed1));
+    REPORTER_ASSERT(reporter, srcLevel.getPixels() == copyLevel.getPixels());
+
+    // Purging only drops the cache's ref; the bitmaps keep theirs.
+    SkScaledImageCache::PurgeAll();
+    REPORTER_ASSERT(reporter, 0 == SkScaledImageCache::GetBytesUsed());
+    REPORTER_ASSERT(reporter, 2 == copy.extractMipLevel(&copyLevel, 4 * SK_Fixed1, 4 * SK_Fixed1));
+    REPORTER_ASSERT(reporter, srcLevel.getPixels() == copyLevel.getPixels());
+}
+
+static void draw_rotated(const SkBitmap& src, const SkPaint& paint, SkBitmap* dst) {
+    dst->setConfig(SkBitmap::kARGB_8888_Config, 32, 32);
+    dst->allocPixels();
+    dst->eraseColor(SK_ColorTRANSPARENT);
+    SkCanvas canvas(*dst);
+    canvas.translate(16, 0);
+    canvas.rotate(30);
+    canvas.scale(0.2f, 0.2f);
+    canvas.drawBitmap(src, 0, 0, &paint);
+}
+
+// Plain filtered draws only use a bitmap's own mipmap, whatever is in the
+// cache. High quality draws that can't be resampled share mipmaps through it.
+static void test_draw(skiatest::Reporter* reporter) {
+    SkScaledImageCache::PurgeAll();
+
+    SkBitmap src;
+    make_bitmap(&src, 128, 128);
+    SkPaint paint;
+    paint.setFilterBitmap(true);
+
+    SkBitmap plain;
+    draw_rotated(src, paint, &plain);
+    REPORTER_ASSERT(reporter, 0 == SkScaledImageCache::GetBytesUsed());
+
+    SkBitmap owner(src);
+    owner.buildMipMap();
+    SkBitmap withOwnMip, withCachedMip;
+    draw_rotated(owner, paint, &withOwnMip);
+    draw_rotated(src, paint, &withCachedMip);
+    SkAutoLockPixels alp0(plain), alp1(withOwnMip), alp2(withCachedMip);
+    REPORTER_ASSERT(reporter, 0 != memcmp(plain.getPixels(), withOwnMip.getPixels(),
+                                          plain.getSize()));
+    REPORTER_ASSERT(reporter, 0 == memcmp(plain.getPixels(), withCachedMip.getPixels(),
+                                          plain.getSize()));
+
+    SkScaledImageCache::PurgeAll();
+    SkBitmap other;
+    make_bitmap(&other, 128, 128);
+    paint.setFilterBitmap(false);
+    paint.setHighQualityFilterBitmap(true);
+    SkBitmap hq;
+    draw_rotated(other, paint, &hq);
+    SkAutoTUnref<const SkMipMap> mip(SkScaledImageCache::FindMipMap(other));
+    REPORTER_ASSERT(reporter, mip.get());
+}
+
+static void TestMipMap(skiatest::Reporter* reporter) {
+    test_levels(reporter);
+    test_shared(reporter);
+    test_draw(reporter);
+}
+
+#include "TestClassDef.h"
+DEFINE_TESTCLASS("MipMap", MipMapTestClass, TestMipMap)
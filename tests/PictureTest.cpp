@@ -8,12 +8,17 @@
 #include "SkCanvas.h"
 #include "SkColorPriv.h"
 #include "SkData.h"
+#include "SkGradientShader.h"
+#include "SkOSFile.h"
 #include "SkPaint.h"
 #include "SkPicture.h"
+#include "SkPicturePacker.h"
+#include "SkPictureRecord.h"
 #include "SkRandom.h"
 #include "SkRRect.h"
 #include "SkShader.h"
 #include "SkStream.h"
+#include "SkThreadPool.h"
 
 #include "SkPictureUtils.h"
 
@@ -419,6 +424,608 @@ static void test_clone_empty(skiatest::Reporter* reporter) {
     }
 }
 
+static void record_parallel_scene(SkPicture* picture, uint32_t recordFlags) {
+    SkCanvas* canvas = picture->beginRecording(200, 150, recordFlags);
+    SkRandom rand;
+    SkPaint paint;
+    // Edges are rasterized relative to the device origin, and clipped to the
+    // tile, so antialiased, curved or sloped ones can come out slightly
+    // differently in a tile. Stick to rectangles on whole pixels.
+    for (int i = 0; i < 40; ++i) {
+        SkRect r = SkRect::MakeXYWH(SkIntToScalar(rand.nextRangeU(0, 220)) - 20,
+                                    SkIntToScalar(rand.nextRangeU(0, 170)) - 20,
+                                    SkIntToScalar(rand.nextRangeU(5, 60)),
+                                    SkIntToScalar(rand.nextRangeU(5, 60)));
+        paint.setColor(rand.nextU() | 0xFF000000);
+        canvas->drawRect(r, paint);
+    }
+
+    SkPoint pts[] = { { 0, 0 }, { SkIntToScalar(200), SkIntToScalar(150) } };
+    SkColor colors[] = { SK_ColorRED, SK_ColorBLUE };
+    paint.setShader(SkGradientShader::CreateLinear(pts, colors, NULL, 2,
+                                                   SkShader::kClamp_TileMode))->unref();
+    canvas->drawRectCoords(SkIntToScalar(60), SkIntToScalar(20),
+                           SkIntToScalar(140), SkIntToScalar(100), paint);
+    paint.setShader(NULL);
+
+    paint.setAntiAlias(true);
+    paint.setColor(SK_ColorBLACK);
+    paint.setTextSize(SkIntToScalar(18));
+    canvas->drawText("parallel", 8, SkIntToScalar(30), SkIntToScalar(120), paint);
+    picture->endRecording();
+}
+
+// Returns true if every channel of every pixel differs by at most tolerance.
+static bool bitmaps_match(const SkBitmap& a, const SkBitmap& b, int tolerance) {
+    SkAutoLockPixels alpa(a);
+    SkAutoLockPixels alpb(b);
+    for (int y = 0; y < a.height(); ++y) {
+        for (int x = 0; x < a.width(); ++x) {
+            SkPMColor ca = *a.getAddr32(x, y);
+            SkPMColor cb = *b.getAddr32(x, y);
+            if (SkAbs32(SkGetPackedA32(ca) - SkGetPackedA32(cb)) > tolerance ||
+                SkAbs32(SkGetPackedR32(ca) - SkGetPackedR32(cb)) > tolerance ||
+                SkAbs32(SkGetPackedG32(ca) - SkGetPackedG32(cb)) > tolerance ||
+                SkAbs32(SkGetPackedB32(ca) - SkGetPackedB32(cb)) > tolerance) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Drawing a picture tile by tile from several threads must give the same
+// pixels as drawing it in one go, with or without a bounding box hierarchy.
+// Gradients step from each tile's left edge, which can round their colors by
+// one either way.
+static void test_draw_parallel(skiatest::Reporter* reporter) {
+    static const uint32_t gRecordFlags[] = {
+        0,
+        SkPicture::kOptimizeForClippedPlayback_RecordingFlag,
+    };
+
+    SkThreadPool pool(3);
+    for (size_t i = 0; i < SK_ARRAY_COUNT(gRecordFlags); ++i) {
+        SkPicture picture;
+        record_parallel_scene(&picture, gRecordFlags[i]);
+
+        SkBitmap expected, actual;
+        make_bm(&expected, 200, 150, SK_ColorWHITE, false);
+        make_bm(&actual, 200, 150, SK_ColorWHITE, false);
+        {
+            SkCanvas canvas(expected);
+            picture.draw(&canvas);
+        }
+        // Tiles that don't divide the bitmap evenly, and more tiles than threads.
+        SkPictureUtils::DrawParallel(&picture, actual, &pool, 37, 29);
+        REPORTER_ASSERT(reporter, bitmaps_match(expected, actual, 1));
+
+        // Without a pool the picture is simply drawn.
+        actual.eraseColor(SK_ColorWHITE);
+        SkPictureUtils::DrawParallel(&picture, actual, NULL);
+        REPORTER_ASSERT(reporter, bitmaps_match(expected, actual, 0));
+    }
+}
+
+static void record_optimizable_scene(SkPicture* picture, uint32_t recordFlags) {
+    SkCanvas* canvas = picture->beginRecording(100, 100, recordFlags);
+    SkPaint paint;
+
+    // Drawn over by the opaque drawPaint below.
+    paint.setColor(SK_ColorRED);
+    canvas->drawRect(SkRect::MakeWH(SkIntToScalar(50), SkIntToScalar(50)), paint);
+    paint.setColor(SK_ColorWHITE);
+    canvas->drawPaint(paint);
+
+    // A save with nothing to restore, and translates that fold into one.
+    canvas->save();
+    paint.setColor(SK_ColorGREEN);
+    canvas->drawRect(SkRect::MakeXYWH(SkIntToScalar(5), SkIntToScalar(5),
+                                      SkIntToScalar(20), SkIntToScalar(20)), paint);
+    canvas->restore();
+    canvas->translate(SkIntToScalar(10), 0);
+    canvas->translate(0, SkIntToScalar(10));
+
+    // The second clip contains the first.
+    canvas->save();
+    canvas->clipRect(SkRect::MakeXYWH(SkIntToScalar(20), SkIntToScalar(20),
+                                      SkIntToScalar(40), SkIntToScalar(40)));
+    canvas->clipRect(SkRect::MakeXYWH(SkIntToScalar(10), SkIntToScalar(10),
+                                      SkIntToScalar(60), SkIntToScalar(60)));
+    paint.setColor(SK_ColorBLUE);
+    canvas->drawRect(SkRect::MakeWH(SkIntToScalar(80), SkIntToScalar(80)), paint);
+    canvas->restore();
+
+    // A layer whose alpha can go into its only draw.
+    canvas->saveLayerAlpha(NULL, 0x80);
+    paint.setColor(SK_ColorBLACK);
+    canvas->drawOval(SkRect::MakeXYWH(SkIntToScalar(30), SkIntToScalar(30),
+                                      SkIntToScalar(40), SkIntToScalar(30)), paint);
+    canvas->restore();
+    picture->endRecording();
+}
+
+// Optimizing a picture must remove the work each pass looks for, and leave
+// what it draws unchanged, except for rounding the layer's alpha.
+static void test_optimize(skiatest::Reporter* reporter) {
+    static const uint32_t gRecordFlags[] = {
+        0,
+        SkPicture::kOptimizeForClippedPlayback_RecordingFlag,
+    };
+
+    for (size_t i = 0; i < SK_ARRAY_COUNT(gRecordFlags); ++i) {
+        SkPicture picture;
+        record_optimizable_scene(&picture, gRecordFlags[i]);
+
+        SkBitmap expected, actual;
+        make_bm(&expected, 100, 100, SK_ColorTRANSPARENT, false);
+        make_bm(&actual, 100, 100, SK_ColorTRANSPARENT, false);
+        {
+            SkCanvas canvas(expected);
+            picture.draw(&canvas);
+        }
+
+        SkPicture::OptimizeStats stats;
+        picture.optimize(&stats);
+        REPORTER_ASSERT(reporter, stats.fOpCount > 0);
+        REPORTER_ASSERT(reporter, 1 == stats.fOccludedDraws);
+        REPORTER_ASSERT(reporter, 1 == stats.fDeadSaveRestores);
+        REPORTER_ASSERT(reporter, 1 == stats.fFoldedMatrixOps);
+        REPORTER_ASSERT(reporter, 1 == stats.fRedundantClips);
+        REPORTER_ASSERT(reporter, 1 == stats.fMergedSaveLayers);
+        REPORTER_ASSERT(reporter, 5 == stats.removedOpCount());
+        {
+            SkCanvas canvas(actual);
+            picture.draw(&canvas);
+        }
+        REPORTER_ASSERT(reporter, bitmaps_match(expected, actual, 1));
+
+        // Optimized pictures still serialize. Optimizing again only finds the
+        // save the layer became, which was kept for the state tree.
+        SkDynamicMemoryWStream stream;
+        picture.serialize(&stream);
+        SkAutoDataUnref data(stream.copyToData());
+        SkMemoryStream input(data);
+        bool success;
+        SkPicture copy(&input, &success, NULL);
+        REPORTER_ASSERT(reporter, success);
+        if (success) {
+            SkPicture::OptimizeStats copyStats;
+            copy.optimize(&copyStats);
+            REPORTER_ASSERT(reporter, 1 == copyStats.fDeadSaveRestores);
+            REPORTER_ASSERT(reporter, 2 == copyStats.removedOpCount());
+            REPORTER_ASSERT(reporter, 0 == copyStats.fMergedSaveLayers);
+
+            actual.eraseColor(SK_ColorTRANSPARENT);
+            SkCanvas canvas(actual);
+            copy.draw(&canvas);
+            REPORTER_ASSERT(reporter, bitmaps_match(expected, actual, 1));
+        }
+    }
+}
+
+// A clip inside a matrix-only save outlives that save, so the save around
+// both must be kept to undo it.
+static void test_optimize_nested_save(skiatest::Reporter* reporter) {
+    SkPicture picture;
+    SkCanvas* canvas = picture.beginRecording(100, 100);
+    SkPaint paint;
+    canvas->save();
+    canvas->save(SkCanvas::kMatrix_SaveFlag);
+    canvas->clipRect(SkRect::MakeWH(SkIntToScalar(10), SkIntToScalar(10)));
+    canvas->drawRect(SkRect::MakeWH(SkIntToScalar(100), SkIntToScalar(100)), paint);
+    canvas->restore();
+    canvas->restore();
+    paint.setColor(SK_ColorBLUE);
+    canvas->drawRect(SkRect::MakeXYWH(SkIntToScalar(50), SkIntToScalar(50),
+                                      SkIntToScalar(50), SkIntToScalar(50)), paint);
+    picture.endRecording();
+
+    SkBitmap expected, actual;
+    make_bm(&expected, 100, 100, SK_ColorWHITE, false);
+    make_bm(&actual, 100, 100, SK_ColorWHITE, false);
+    {
+        SkCanvas canvas(expected);
+        picture.draw(&canvas);
+    }
+    SkPicture::OptimizeStats stats;
+    picture.optimize(&stats);
+    // Only the save the recording wraps around the whole picture is dead.
+    REPORTER_ASSERT(reporter, 1 == stats.fDeadSaveRestores);
+    {
+        SkCanvas canvas(actual);
+        picture.draw(&canvas);
+    }
+    SkAutoLockPixels alp(actual);
+    REPORTER_ASSERT(reporter, SK_ColorBLUE == actual.getColor(75, 75));
+    REPORTER_ASSERT(reporter, bitmaps_match(expected, actual, 0));
+}
+
+static void record_path_scene(SkPicture* picture) {
+    SkCanvas* canvas = picture->beginRecording(100, 100);
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    SkRandom rand;
+    for (int i = 0; i < 20; ++i) {
+        SkPath path;
+        path.moveTo(rand.nextRangeScalar(0, 100), rand.nextRangeScalar(0, 100));
+        path.quadTo(rand.nextRangeScalar(0, 100), rand.nextRangeScalar(0, 100),
+                    rand.nextRangeScalar(0, 100), rand.nextRangeScalar(0, 100));
+        path.lineTo(rand.nextRangeScalar(0, 100), rand.nextRangeScalar(0, 100));
+        paint.setColor(rand.nextU() | 0xFF000000);
+        canvas->drawPath(path, paint);
+    }
+
+    SkAutoTUnref<SkPicture> child(SkNEW(SkPicture));
+    SkCanvas* childCanvas = child->beginRecording(50, 50);
+    SkPath circle;
+    circle.addCircle(SkIntToScalar(25), SkIntToScalar(25), SkIntToScalar(20));
+    childCanvas->drawPath(circle, paint);
+    child->endRecording();
+    canvas->drawPicture(*child);
+
+    paint.setTextSize(SkIntToScalar(14));
+    canvas->drawText("in place", 8, SkIntToScalar(10), SkIntToScalar(90), paint);
+    picture->endRecording();
+}
+
+static void draw_picture(SkPicture* picture, SkBitmap* bm) {
+    make_bm(bm, 100, 100, SK_ColorWHITE, false);
+    SkCanvas canvas(*bm);
+    picture->draw(&canvas);
+}
+
+// A picture read in place from its serialized data, or from a mapped file,
+// must draw just as one read from a stream, and keep the data it reads from.
+static void test_create_from_data(skiatest::Reporter* reporter) {
+    SkPicture picture;
+    record_path_scene(&picture);
+    SkBitmap expected;
+    draw_picture(&picture, &expected);
+
+    SkDynamicMemoryWStream stream;
+    picture.serialize(&stream);
+    SkAutoDataUnref data(stream.copyToData());
+
+    SkAutoTUnref<SkPicture> inPlace(SkPicture::CreateFromData(data));
+    REPORTER_ASSERT(reporter, NULL != inPlace.get());
+    if (NULL == inPlace.get()) {
+        return;
+    }
+    REPORTER_ASSERT(reporter, data->getRefCnt() > 1);
+    REPORTER_ASSERT(reporter, 100 == inPlace->width() && 100 == inPlace->height());
+
+    SkBitmap actual;
+    draw_picture(inPlace, &actual);
+    REPORTER_ASSERT(reporter, bitmaps_match(expected, actual, 0));
+
+    // It serializes back to the same data.
+    SkDynamicMemoryWStream restream;
+    inPlace->serialize(&restream);
+    SkAutoDataUnref redata(restream.copyToData());
+    REPORTER_ASSERT(reporter, data->equals(redata));
+
+    // Data that is not a picture gives no picture.
+    SkAutoDataUnref truncated(SkData::NewSubset(data, 0, 8));
+    REPORTER_ASSERT(reporter, NULL == SkPicture::CreateFromData(truncated));
+
+    const SkString& tmpDir = skiatest::Test::GetTmpDir();
+    if (tmpDir.isEmpty()) {
+        return;
+    }
+    SkString path(tmpDir);
+    if (!path.endsWith(SkPATH_SEPARATOR)) {
+        path.appendUnichar(SkPATH_SEPARATOR);
+    }
+    path.append("in_place_test.skp");
+    {
+        SkFILEWStream file(path.c_str());
+        file.write(data->data(), data->size());
+    }
+    SkAutoTUnref<SkPicture> mapped(SkPicture::CreateFromFile(path.c_str()));
+    REPORTER_ASSERT(reporter, NULL != mapped.get());
+    if (NULL != mapped.get()) {
+        actual.eraseColor(SK_ColorWHITE);
+        draw_picture(mapped, &actual);
+        REPORTER_ASSERT(reporter, bitmaps_match(expected, actual, 0));
+    }
+    remove(path.c_str());
+}
+
+// Packing a picture's ops must shrink it, and give back the same ops.
+static void test_packed_ops(skiatest::Reporter* reporter) {
+    SkPicture picture;
+    record_parallel_scene(&picture, 0);
+    SkBitmap expected;
+    draw_picture(&picture, &expected);
+
+    SkDynamicMemoryWStream plainStream, packedStream;
+    picture.serialize(&plainStream);
+    picture.serialize(&packedStream, NULL, SkPicture::kPackOps_SerializeFlag);
+    SkAutoDataUnref plain(plainStream.copyToData());
+    SkAutoDataUnref packed(packedStream.copyToData());
+    REPORTER_ASSERT(reporter, packed->size() < plain->size());
+
+    SkMemoryStream stream(packed);
+    bool success;
+    SkPicture unpacked(&stream, &success, NULL);
+    REPORTER_ASSERT(reporter, success);
+    SkAutoTUnref<SkPicture> inPlace(SkPicture::CreateFromData(packed));
+    REPORTER_ASSERT(reporter, NULL != inPlace.get());
+    if (!success || NULL == inPlace.get()) {
+        return;
+    }
+
+    SkPicture* pictures[] = { &unpacked, inPlace.get() };
+    for (size_t i = 0; i < SK_ARRAY_COUNT(pictures); ++i) {
+        SkDynamicMemoryWStream restream;
+        pictures[i]->serialize(&restream);
+        SkAutoDataUnref redata(restream.copyToData());
+        REPORTER_ASSERT(reporter, plain->equals(redata));
+
+        SkBitmap actual;
+        draw_picture(pictures[i], &actual);
+        REPORTER_ASSERT(reporter, bitmaps_match(expected, actual, 0));
+    }
+
+    // Truncated packings, or ones of other ops, don't unpack.
+    const uint32_t ops[] = {
+        PACK_8_24(TRANSLATE, 12), SkFloat2Bits(10), SkFloat2Bits(-2.5f),
+        PACK_8_24(TRANSLATE, 12), SkFloat2Bits(12), SkFloat2Bits(-2.5f),
+    };
+    SkAutoDataUnref opData(SkData::NewWithCopy(ops, sizeof(ops)));
+    SkAutoDataUnref packedOps(SkPicturePacker::Pack(opData));
+    uint32_t unpackedOps[SK_ARRAY_COUNT(ops)];
+    REPORTER_ASSERT(reporter, SkPicturePacker::Unpack(packedOps->data(), packedOps->size(),
+                                                      unpackedOps, sizeof(ops)));
+    REPORTER_ASSERT(reporter, 0 == memcmp(ops, unpackedOps, sizeof(ops)));
+    REPORTER_ASSERT(reporter, !SkPicturePacker::Unpack(packedOps->data(), packedOps->size() - 1,
+                                                       unpackedOps, sizeof(ops)));
+    REPORTER_ASSERT(reporter, !SkPicturePacker::Unpack(packedOps->data(), packedOps->size(),
+                                                       unpackedOps, sizeof(ops) - 4));
+}
+
+static const SkRect gWidgets[] = {
+    { 10, 10, 45, 45 }, { 55, 10, 90, 45 }, { 10, 55, 45, 90 }, { 55, 55, 90, 90 },
+};
+
+// Four widgets on a grey background, and a bar across the top two.
+static void draw_dashboard(SkCanvas* canvas, const SkColor colors[4]) {
+    canvas->drawColor(SK_ColorLTGRAY);
+    SkPaint paint;
+    for (size_t i = 0; i < SK_ARRAY_COUNT(gWidgets); ++i) {
+        paint.setColor(colors[i]);
+        canvas->drawRect(gWidgets[i], paint);
+    }
+    paint.setColor(SK_ColorBLACK);
+    canvas->drawRectCoords(0, SkIntToScalar(30), SkIntToScalar(100), SkIntToScalar(36), paint);
+}
+
+static SkPicture* record_dashboard(const SkColor colors[4], uint32_t recordFlags) {
+    SkPicture* picture = SkNEW(SkPicture);
+    draw_dashboard(picture->beginRecording(100, 100, recordFlags), colors);
+    picture->endRecording();
+    return picture;
+}
+
+// Splicing a new recording over part of a picture must draw just as recording
+// the whole picture again would, and report the area that changed.
+static void test_splice(skiatest::Reporter* reporter) {
+    const SkColor colorsA[] = { SK_ColorRED, SK_ColorGREEN, SK_ColorBLUE, SK_ColorYELLOW };
+    const SkColor colorsB[] = { SK_ColorCYAN, SK_ColorGREEN, SK_ColorBLUE, SK_ColorYELLOW };
+    const SkColor colorsC[] = { SK_ColorMAGENTA, SK_ColorGREEN, SK_ColorBLUE, SK_ColorBLACK };
+    const SkRect overlap = SkRect::MakeLTRB(30, 30, 70, 70);
+
+    const uint32_t flags[] = { 0, SkPicture::kOptimizeForClippedPlayback_RecordingFlag };
+    for (size_t f = 0; f < SK_ARRAY_COUNT(flags); ++f) {
+        SkAutoTUnref<SkPicture> picture(record_dashboard(colorsA, flags[f]));
+        SkPicture copy(*picture);
+        SkBitmap original;
+        draw_picture(picture, &original);
+
+        // The first widget changes.
+        SkAutoTUnref<SkPicture> widget(record_dashboard(colorsB, flags[f]));
+        SkIRect damage;
+        picture->splice(gWidgets[0], widget, &damage);
+        REPORTER_ASSERT(reporter, damage == SkIRect::MakeLTRB(10, 10, 45, 45));
+
+        SkBitmap expected, actual;
+        make_bm(&expected, 100, 100, SK_ColorWHITE, false);
+        SkCanvas expectedCanvas(expected);
+        draw_dashboard(&expectedCanvas, colorsB);
+        draw_picture(picture, &actual);
+        REPORTER_ASSERT(reporter, bitmaps_match(expected, actual, 0));
+
+        // Copies made before keep drawing the original.
+        draw_picture(&copy, &actual);
+        REPORTER_ASSERT(reporter, bitmaps_match(original, actual, 0));
+
+        // A replacement need only draw what is inside its rect, and a later
+        // splice over part of an earlier one keeps the rest of it.
+        SkAutoTUnref<SkPicture> partial(SkNEW(SkPicture));
+        SkCanvas* canvas = partial->beginRecording(100, 100, flags[f]);
+        canvas->clipRect(overlap);
+        draw_dashboard(canvas, colorsC);
+        partial->endRecording();
+        picture->splice(overlap, partial, &damage);
+        REPORTER_ASSERT(reporter, damage == SkIRect::MakeLTRB(30, 30, 70, 70));
+
+        expectedCanvas.save();
+        expectedCanvas.clipRect(overlap);
+        draw_dashboard(&expectedCanvas, colorsC);
+        expectedCanvas.restore();
+        draw_picture(picture, &actual);
+        REPORTER_ASSERT(reporter, bitmaps_match(expected, actual, 0));
+
+        // It serializes as it draws.
+        SkDynamicMemoryWStream stream;
+        picture->serialize(&stream);
+        SkAutoDataUnref data(stream.copyToData());
+        SkAutoTUnref<SkPicture> loaded(SkPicture::CreateFromData(data));
+        REPORTER_ASSERT(reporter, NULL != loaded.get());
+        if (NULL != loaded.get()) {
+            draw_picture(loaded, &actual);
+            REPORTER_ASSERT(reporter, bitmaps_match(expected, actual, 0));
+        }
+
+        // Splicing nothing over the whole picture leaves nothing to draw, and
+        // the damage within its bounds.
+        picture->splice(SkRect::MakeLTRB(-10, -10, 200, 200), NULL, &damage);
+        REPORTER_ASSERT(reporter, damage == SkIRect::MakeWH(100, 100));
+        make_bm(&expected, 100, 100, SK_ColorWHITE, false);
+        draw_picture(picture, &actual);
+        REPORTER_ASSERT(reporter, bitmaps_match(expected, actual, 0));
+    }
+}
+
+// Returns the analysis made while recording picture, after it has been
+// serialized and read back.
+static void get_serialized_analysis(SkPicture* picture, SkPicture::Analysis* analysis) {
+    SkDynamicMemoryWStream stream;
+    picture->serialize(&stream);
+    SkAutoDataUnref data(stream.copyToData());
+    SkMemoryStream readStream(data);
+    SkPicture copy(&readStream);
+    copy.getAnalysis(analysis);
+}
+
+// Recording must find out a picture's bounds and opacity, what it draws and
+// how many ops it has, and keep them when it is serialized.
+static void test_analysis(skiatest::Reporter* reporter) {
+    SkPicture::Analysis analysis;
+    {
+        SkPicture picture;
+        picture.getAnalysis(&analysis);
+        REPORTER_ASSERT(reporter, analysis.fBounds.isEmpty() && !analysis.fOpaque);
+        picture.beginRecording(100, 100);
+        picture.endRecording();
+        picture.getAnalysis(&analysis);
+        REPORTER_ASSERT(reporter, analysis.fBounds.isEmpty() && !analysis.fOpaque);
+        REPORTER_ASSERT(reporter, 0 == analysis.fRasterCost);
+    }
+
+    SkPaint paint;
+    const SkRect background = SkRect::MakeWH(100, 100);
+    const SkRect inner = SkRect::MakeXYWH(10, 20, 30, 40);
+    SkBitmap bitmap;
+    make_bm(&bitmap, 10, 10, SK_ColorBLUE, true);
+
+    // An opaque background, with text and a bitmap over it.
+    SkPicture page;
+    SkCanvas* canvas = page.beginRecording(100, 100);
+    canvas->drawRect(background, paint);
+    paint.setColor(SK_ColorRED);
+    canvas->drawText("Hello", 5, 10, 50, paint);
+    canvas->drawBitmap(bitmap, 50, 50, NULL);
+    page.getAnalysis(&analysis);
+    REPORTER_ASSERT(reporter, analysis.fBounds == background && analysis.fOpaque);
+    REPORTER_ASSERT(reporter, analysis.fHasText && analysis.fHasBitmaps &&
+                              !analysis.fHasSaveLayers);
+    // The initial save and the three draws.
+    REPORTER_ASSERT(reporter, 4 == analysis.fOpCount);
+    REPORTER_ASSERT(reporter, analysis.fRasterCost >= 100 * 100);
+    page.endRecording();
+    page.getAnalysis(&analysis);
+    REPORTER_ASSERT(reporter, analysis.fOpaque && 5 == analysis.fOpCount);
+
+    SkPicture::Analysis serialized;
+    get_serialized_analysis(&page, &serialized);
+    REPORTER_ASSERT(reporter, serialized.fBounds == analysis.fBounds);
+    REPORTER_ASSERT(reporter, serialized.fOpaque && serialized.fHasText &&
+                              serialized.fHasBitmaps && !serialized.fHasSaveLayers);
+    REPORTER_ASSERT(reporter, serialized.fOpCount == analysis.fOpCount);
+    REPORTER_ASSERT(reporter, serialized.fRasterCost == analysis.fRasterCost);
+
+    // Opaque over only part of the picture.
+    {
+        SkPicture picture;
+        canvas = picture.beginRecording(100, 100);
+        canvas->clipRect(inner);
+        canvas->drawPaint(paint);
+        picture.endRecording();
+        picture.getAnalysis(&analysis);
+        REPORTER_ASSERT(reporter, analysis.fBounds == inner && analysis.fOpaque);
+    }
+
+    // Translucent draws, draws that punch holes and layers are not opaque.
+    {
+        SkPicture picture;
+        canvas = picture.beginRecording(100, 100);
+        SkPaint translucent;
+        translucent.setColor(0x80FF0000);
+        canvas->drawRect(background, translucent);
+        picture.endRecording();
+        picture.getAnalysis(&analysis);
+        REPORTER_ASSERT(reporter, analysis.fBounds == background && !analysis.fOpaque);
+    }
+    {
+        SkPicture picture;
+        canvas = picture.beginRecording(100, 100);
+        canvas->drawRect(background, paint);
+        SkPaint clear;
+        clear.setXfermodeMode(SkXfermode::kClear_Mode);
+        canvas->drawRect(inner, clear);
+        picture.endRecording();
+        picture.getAnalysis(&analysis);
+        REPORTER_ASSERT(reporter, !analysis.fOpaque);
+    }
+    {
+        SkPicture picture;
+        canvas = picture.beginRecording(100, 100);
+        canvas->saveLayer(NULL, NULL);
+        canvas->drawRect(background, paint);
+        canvas->restore();
+        picture.endRecording();
+        picture.getAnalysis(&analysis);
+        REPORTER_ASSERT(reporter, analysis.fHasSaveLayers && !analysis.fOpaque);
+    }
+    {
+        // Text is not measured while recording, but its bounds must still
+        // cover every glyph it can punch out.
+        SkPicture picture;
+        canvas = picture.beginRecording(100, 100);
+        canvas->drawRect(background, paint);
+        SkPaint clear;
+        clear.setXfermodeMode(SkXfermode::kClear_Mode);
+        clear.setTextAlign(SkPaint::kRight_Align);
+        canvas->drawText("WWWWW", 5, 100, 50, clear);
+        picture.endRecording();
+        picture.getAnalysis(&analysis);
+        REPORTER_ASSERT(reporter, !analysis.fOpaque);
+    }
+
+    // A round rect clip only seen as its bounds does not make what is drawn
+    // inside it opaque.
+    {
+        SkPicture picture;
+        canvas = picture.beginRecording(100, 100,
+                                        SkPicture::kUsePathBoundsForClip_RecordingFlag);
+        SkRRect rrect;
+        rrect.setRectXY(background, 30, 30);
+        canvas->clipRRect(rrect);
+        canvas->drawRect(background, paint);
+        picture.endRecording();
+        picture.getAnalysis(&analysis);
+        REPORTER_ASSERT(reporter, !analysis.fOpaque);
+    }
+
+    // Nested pictures add what they draw where they are drawn.
+    {
+        SkPicture picture;
+        canvas = picture.beginRecording(200, 200);
+        canvas->translate(50, 50);
+        canvas->drawPicture(page);
+        picture.endRecording();
+        picture.getAnalysis(&analysis);
+        REPORTER_ASSERT(reporter, analysis.fBounds == SkRect::MakeXYWH(50, 50, 100, 100));
+        REPORTER_ASSERT(reporter, analysis.fOpaque && analysis.fHasText &&
+                                  analysis.fHasBitmaps);
+        SkPicture::Analysis pageAnalysis;
+        page.getAnalysis(&pageAnalysis);
+        REPORTER_ASSERT(reporter, analysis.fOpCount > pageAnalysis.fOpCount);
+    }
+}
+
 static void TestPicture(skiatest::Reporter* reporter) {
 #ifdef SK_DEBUG
     test_deleting_empty_playback();
@@ -430,6 +1037,13 @@ static void TestPicture(skiatest::Reporter* reporter) {
     test_gatherpixelrefs(reporter);
     test_bitmap_with_encoded_data(reporter);
     test_clone_empty(reporter);
+    test_draw_parallel(reporter);
+    test_optimize(reporter);
+    test_optimize_nested_save(reporter);
+    test_create_from_data(reporter);
+    test_packed_ops(reporter);
+    test_splice(reporter);
+    test_analysis(reporter);
 }
 
 #include "TestClassDef.h"
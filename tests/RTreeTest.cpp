@@ -18,6 +18,8 @@ static const int NUM_RECTS = 200;
 static const size_t NUM_ITERATIONS = 100;
 static const size_t NUM_QUERIES = 50;
 
+static const int NUM_LARGE_RECTS = 5000;
+
 struct DataRect {
     SkIRect rect;
     void* data;
@@ -42,11 +44,11 @@ static void random_data_rects(SkMWCRandom& rand, DataRect out[], int n) {
     }
 }
 
-static bool verify_query(SkIRect query, DataRect rects[],
+static bool verify_query(SkIRect query, DataRect rects[], int numRects,
                          SkTDArray<void*>& found) {
     SkTDArray<void*> expected;
     // manually intersect with every rectangle
-    for (int i = 0; i < NUM_RECTS; ++i) {
+    for (int i = 0; i < numRects; ++i) {
         if (SkIRect::IntersectsNoEmptyCheck(query, rects[i].rect)) {
             expected.push(rects[i].data);
         }
@@ -69,15 +71,39 @@ static bool verify_query(SkIRect query, DataRect rects[],
 }
 
 static void runQueries(skiatest::Reporter* reporter, SkMWCRandom& rand, DataRect rects[],
-                       SkRTree& tree) {
+                       SkRTree& tree, int numRects = NUM_RECTS) {
     for (size_t i = 0; i < NUM_QUERIES; ++i) {
         SkTDArray<void*> hits;
         SkIRect query = random_rect(rand);
         tree.search(query, &hits);
-        REPORTER_ASSERT(reporter, verify_query(query, rects, hits));
+        REPORTER_ASSERT(reporter, verify_query(query, rects, numRects, hits));
     }
 }
 
+// Bulk loads enough rects for several levels of tiles, with child counts that do and don't fill
+// whole groups of the sides search() tests together.
+static void TestLargeBulkLoad(skiatest::Reporter* reporter, SkMWCRandom& rand,
+                              int minChildren, int maxChildren) {
+    SkAutoTMalloc<DataRect> rects(NUM_LARGE_RECTS);
+    random_data_rects(rand, rects.get(), NUM_LARGE_RECTS);
+
+    SkRTree* rtree = SkRTree::Create(minChildren, maxChildren);
+    SkAutoUnref au(rtree);
+    REPORTER_ASSERT(reporter, NULL != rtree);
+
+    for (int i = 0; i < NUM_LARGE_RECTS; ++i) {
+        rtree->insert(rects[i].data, rects[i].rect, true);
+    }
+    rtree->flushDeferredInserts();
+    REPORTER_ASSERT(reporter, NUM_LARGE_RECTS == rtree->getCount());
+    runQueries(reporter, rand, rects.get(), *rtree, NUM_LARGE_RECTS);
+
+    // Every rect is found by a query that covers them all
+    SkTDArray<void*> hits;
+    rtree->search(SkIRect::MakeLTRB(-1000, -1000, 1000, 1000), &hits);
+    REPORTER_ASSERT(reporter, NUM_LARGE_RECTS == hits.count());
+}
+
 static void TestRTree(skiatest::Reporter* reporter) {
     DataRect rects[NUM_RECTS];
     SkMWCRandom rand;
@@ -139,6 +165,10 @@ static void TestRTree(skiatest::Reporter* reporter) {
         rtree->clear();
         REPORTER_ASSERT(reporter, 0 == rtree->getCount());
     }
+
+    TestLargeBulkLoad(reporter, rand, 5, 16);
+    TestLargeBulkLoad(reporter, rand, 6, 11);
+    TestLargeBulkLoad(reporter, rand, 2, 3);
 }
 
 #include "TestClassDef.h"
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "SkRunnable.h"
+#include "SkTDArray.h"
+#include "SkThread.h"
+#include "SkThreadPool.h"
+#include "Test.h"
+
+class CountingRunnable : public SkRunnable {
+public:
+    explicit CountingRunnable(int32_t* counter) : fCounter(counter) {}
+
+    virtual void run() SK_OVERRIDE {
+        sk_atomic_inc(fCounter);
+    }
+
+private:
+    int32_t* fCounter;
+};
+
+// Adds kChildren more runnables to its own group from inside the pool.
+class SpawningRunnable : public SkRunnable {
+public:
+    enum { kChildren = 8 };
+
+    SpawningRunnable(SkTaskGroup* group, int32_t* counter)
+        : fGroup(group)
+        , fChild(counter) {}
+
+    virtual void run() SK_OVERRIDE {
+        for (int i = 0; i < kChildren; i++) {
+            fGroup->add(&fChild);
+        }
+    }
+
+private:
+    SkTaskGroup*     fGroup;
+    CountingRunnable fChild;
+};
+
+static void test_add(skiatest::Reporter* reporter, int threadCount) {
+    static const int kTasks = 500;
+    int32_t counter = 0;
+    SkTDArray<CountingRunnable*> runnables;
+    {
+        SkThreadPool pool(threadCount);
+        for (int i = 0; i < kTasks; i++) {
+            *runnables.append() = SkNEW_ARGS(CountingRunnable, (&counter));
+            pool.add(runnables[i]);
+        }
+        // The destructor runs everything that was queued.
+    }
+    REPORTER_ASSERT(reporter, kTasks == counter);
+    runnables.deleteAll();
+}
+
+static void test_group(skiatest::Reporter* reporter, int threadCount) {
+    static const int kSpawners = 50;
+    SkThreadPool pool(threadCount);
+    int32_t counter = 0;
+    SkTDArray<SpawningRunnable*> spawners;
+    SkTaskGroup group(&pool);
+    for (int i = 0; i < kSpawners; i++) {
+        *spawners.append() = SkNEW_ARGS(SpawningRunnable, (&group, &counter));
+        group.add(spawners[i]);
+    }
+    group.wait();
+    REPORTER_ASSERT(reporter, kSpawners * SpawningRunnable::kChildren == counter);
+
+    // A group can be reused once it has been waited on.
+    CountingRunnable extra(&counter);
+    group.add(&extra);
+    group.wait();
+    REPORTER_ASSERT(reporter, kSpawners * SpawningRunnable::kChildren + 1 == counter);
+    spawners.deleteAll();
+}
+
+struct ParallelForData {
+    SkThreadPool* fPool;
+    int32_t*      fHits;
+    int           fInnerCount;
+};
+
+static void mark_hit(void* context, int index) {
+    ParallelForData* data = static_cast<ParallelForData*>(context);
+    sk_atomic_inc(&data->fHits[index]);
+}
+
+// Runs a nested parallelFor from inside the pool, which must not deadlock.
+static void nested_for(void* context, int index) {
+    ParallelForData* data = static_cast<ParallelForData*>(context);
+    ParallelForData inner = *data;
+    inner.fHits = data->fHits + index * data->fInnerCount;
+    data->fPool->parallelFor(data->fInnerCount, mark_hit, &inner, 3);
+}
+
+static void test_parallel_for(skiatest::Reporter* reporter, int threadCount) {
+    static const int kOuter = 16;
+    static const int kInner = 40;
+    SkThreadPool pool(threadCount);
+    int32_t hits[kOuter * kInner];
+    sk_bzero(hits, sizeof(hits));
+
+    ParallelForData data;
+    data.fPool = &pool;
+    data.fHits = hits;
+    data.fInnerCount = kInner;
+
+    pool.parallelFor(kOuter * kInner, mark_hit, &data, 7);
+    pool.parallelFor(kOuter, nested_for, &data);
+
+    bool allTwice = true;
+    for (int i = 0; i < kOuter * kInner; i++) {
+        allTwice &= (2 == hits[i]);
+    }
+    REPORTER_ASSERT(reporter, allTwice);
+
+    // Empty ranges are a no-op.
+    pool.parallelFor(0, mark_hit, &data);
+}
+
+static void TestThreadPool(skiatest::Reporter* reporter) {
+    static const int kThreadCounts[] = { 0, 1, 4 };
+    for (size_t i = 0; i < SK_ARRAY_COUNT(kThreadCounts); i++) {
+        test_add(reporter, kThreadCounts[i]);
+        test_group(reporter, kThreadCounts[i]);
+        test_parallel_for(reporter, kThreadCounts[i]);
+    }
+}
+
+#include "TestClassDef.h"
+DEFINE_TESTCLASS("ThreadPool", ThreadPoolTestClass, TestThreadPool)
@@ -7,6 +7,8 @@
  */
 
 #include "Test.h"
+#include "SkAdaptiveTileGrid.h"
+#include "SkRandom.h"
 #include "SkTileGrid.h"
 #include "SkTileGridPicture.h"
 #include "SkCanvas.h"
@@ -35,6 +37,18 @@ public:
 
     SkTDArray<SkRect> fRects;
 };
+
+// Rewinds the data, taken as integers, above fLast.
+class RewindClient : public SkBBoxHierarchyClient {
+public:
+    RewindClient() : fLast(0) {}
+
+    virtual bool shouldRewind(void* data) SK_OVERRIDE {
+        return reinterpret_cast<intptr_t>(data) > fLast;
+    }
+
+    intptr_t fLast;
+};
 }
 
 class TileGridTest {
@@ -47,13 +61,14 @@ public:
         info.fTileInterval.set(10 - 2 * borderPixels, 10 - 2 * borderPixels);
         SkTileGrid grid(2, 2, info, NULL);
         grid.insert(NULL, rect, false);
-        REPORTER_ASSERT(reporter, grid.tile(0,0).count() ==
+        grid.flushDeferredInserts();
+        REPORTER_ASSERT(reporter, grid.tileCount(0,0) ==
             ((tileMask & kTopLeft_Tile)? 1 : 0));
-        REPORTER_ASSERT(reporter, grid.tile(1,0).count() ==
+        REPORTER_ASSERT(reporter, grid.tileCount(1,0) ==
             ((tileMask & kTopRight_Tile)? 1 : 0));
-        REPORTER_ASSERT(reporter, grid.tile(0,1).count() ==
+        REPORTER_ASSERT(reporter, grid.tileCount(0,1) ==
             ((tileMask & kBottomLeft_Tile)? 1 : 0));
-        REPORTER_ASSERT(reporter, grid.tile(1,1).count() ==
+        REPORTER_ASSERT(reporter, grid.tileCount(1,1) ==
             ((tileMask & kBottomRight_Tile)? 1 : 0));
     }
 
@@ -228,6 +243,156 @@ public:
         }
     }
 
+    static void TestChooseTileInterval(skiatest::Reporter* reporter) {
+        static const int kCount = 1000;
+        SkIRect bounds[kCount];
+        SkMWCRandom rand;
+        SkISize interval;
+
+        // Twice the median size, rounded up to a power of two
+        for (int i = 0; i < kCount; ++i) {
+            bounds[i] = SkIRect::MakeXYWH(rand.nextULessThan(1900), rand.nextULessThan(1900),
+                                          i < kCount / 2 ? 20 : 100, i < kCount / 2 ? 50 : 10);
+        }
+        REPORTER_ASSERT(reporter, SkAdaptiveTileGrid::ChooseTileInterval(bounds, kCount,
+                                                                         2000, 2000, &interval));
+        REPORTER_ASSERT(reporter, 256 == interval.width() && 128 == interval.height());
+
+        // Too few elements to be worth a grid
+        REPORTER_ASSERT(reporter, !SkAdaptiveTileGrid::ChooseTileInterval(bounds, 10,
+                                                                          2000, 2000, &interval));
+
+        // Elements outside the grid don't count
+        REPORTER_ASSERT(reporter, !SkAdaptiveTileGrid::ChooseTileInterval(bounds, kCount,
+                                                                          10, 10, &interval));
+
+        // Tiles are kept small enough to cull, and large enough not to be too many
+        for (int i = 0; i < kCount; ++i) {
+            bounds[i] = SkIRect::MakeXYWH(rand.nextULessThan(30000), rand.nextULessThan(30000),
+                                          2, 2);
+        }
+        REPORTER_ASSERT(reporter, SkAdaptiveTileGrid::ChooseTileInterval(bounds, kCount,
+                                                                         30000, 30000, &interval));
+        REPORTER_ASSERT(reporter, interval.width() >= 64 && interval.height() >= 64);
+        REPORTER_ASSERT(reporter, ((30000 + interval.width() - 1) / interval.width()) *
+                                  ((30000 + interval.height() - 1) / interval.height()) <=
+                                  1 << 14);
+
+        // Large elements among small ones would each be held by many tiles
+        for (int i = 0; i < kCount; ++i) {
+            bounds[i] = i % 3 ? SkIRect::MakeXYWH(rand.nextULessThan(1990),
+                                                  rand.nextULessThan(1990), 10, 10)
+                              : SkIRect::MakeWH(2000, 2000);
+        }
+        REPORTER_ASSERT(reporter, !SkAdaptiveTileGrid::ChooseTileInterval(bounds, kCount,
+                                                                          2000, 2000, &interval));
+    }
+
+    // Records rects into a picture that picks its own tile size, then checks that playing back
+    // a few views of it draws every rect in each view, in order.
+    static void TestAdaptivePicture(skiatest::Reporter* reporter, const SkRect rects[],
+                                    int count) {
+        SkTileGridPicture picture(1000, 1000);
+        SkCanvas* canvas = picture.beginRecording(1000, 1000,
+                                                  SkPicture::kOptimizeForClippedPlayback_RecordingFlag);
+        SkPaint paint;
+        for (int i = 0; i < count; ++i) {
+            canvas->drawRect(rects[i], paint);
+        }
+        picture.endRecording();
+
+        SkBitmap store;
+        store.setConfig(SkBitmap::kARGB_8888_Config, 100, 100);
+        store.allocPixels();
+        for (int y = 0; y < 1000; y += 150) {
+            for (int x = 0; x < 1000; x += 150) {
+                SkDevice device(store);
+                MockCanvas mockCanvas(&device);
+                mockCanvas.translate(SkIntToScalar(-x), SkIntToScalar(-y));
+                picture.draw(&mockCanvas);
+
+                const SkRect view = SkRect::MakeXYWH(SkIntToScalar(x), SkIntToScalar(y),
+                                                     SkIntToScalar(100), SkIntToScalar(100));
+                int drawn = 0;
+                for (int i = 0; i < count; ++i) {
+                    if (!SkRect::Intersects(rects[i], view)) {
+                        continue;
+                    }
+                    // Rects outside the view may be drawn too, but in order
+                    while (drawn < mockCanvas.fRects.count() &&
+                           mockCanvas.fRects[drawn] != rects[i]) {
+                        ++drawn;
+                    }
+                    REPORTER_ASSERT(reporter, drawn < mockCanvas.fRects.count());
+                }
+            }
+        }
+    }
+
+    static void TestAdaptive(skiatest::Reporter* reporter) {
+        static const int kCount = 300;
+        SkRect rects[kCount];
+        SkMWCRandom rand;
+
+        // Small rects, for a grid
+        for (int i = 0; i < kCount; ++i) {
+            rects[i] = SkRect::MakeXYWH(SkIntToScalar(rand.nextULessThan(980)),
+                                        SkIntToScalar(rand.nextULessThan(980)),
+                                        SkIntToScalar(1 + rand.nextULessThan(20)),
+                                        SkIntToScalar(1 + rand.nextULessThan(20)));
+        }
+        TestAdaptivePicture(reporter, rects, kCount);
+
+        // Some large rects, for an R-Tree
+        for (int i = 0; i < kCount; i += 3) {
+            rects[i] = SkRect::MakeXYWH(SkIntToScalar(rand.nextULessThan(200)),
+                                        SkIntToScalar(rand.nextULessThan(200)),
+                                        SkIntToScalar(800), SkIntToScalar(800));
+        }
+        TestAdaptivePicture(reporter, rects, kCount);
+
+        // Too few rects for a grid
+        TestAdaptivePicture(reporter, rects, 5);
+    }
+
+    // Rewinding drops the most recent insertions, whether or not they have
+    // been added to the tiles yet.
+    static void TestRewind(skiatest::Reporter* reporter) {
+        SkTileGridPicture::TileGridInfo info;
+        info.fMargin.setEmpty();
+        info.fOffset.setZero();
+        info.fTileInterval.set(10, 10);
+        SkTileGrid grid(2, 2, info, NULL);
+        RewindClient client;
+        grid.setClient(&client);
+
+        // 1 and 2 are in the tiles, 3 and 4 are pending.
+        grid.insert(reinterpret_cast<void*>(1), SkIRect::MakeXYWH(0, 0, 20, 20), false);
+        grid.insert(reinterpret_cast<void*>(2), SkIRect::MakeXYWH(0, 0, 5, 5), false);
+        grid.flushDeferredInserts();
+        grid.insert(reinterpret_cast<void*>(3), SkIRect::MakeXYWH(15, 15, 5, 5), false);
+        grid.insert(reinterpret_cast<void*>(4), SkIRect::MakeXYWH(0, 0, 20, 20), false);
+
+        // Only pending insertions are rewound.
+        client.fLast = 3;
+        grid.rewindInserts();
+        grid.flushDeferredInserts();
+        REPORTER_ASSERT(reporter, 2 == grid.tileCount(0, 0));
+        REPORTER_ASSERT(reporter, 1 == grid.tileCount(1, 0));
+        REPORTER_ASSERT(reporter, 2 == grid.tileCount(1, 1));
+
+        // The pending insertions and some in the tiles are rewound.
+        grid.insert(reinterpret_cast<void*>(5), SkIRect::MakeXYWH(0, 0, 5, 5), false);
+        client.fLast = 1;
+        grid.rewindInserts();
+        grid.flushDeferredInserts();
+        REPORTER_ASSERT(reporter, 1 == grid.tileCount(0, 0));
+        REPORTER_ASSERT(reporter, 1 == grid.tileCount(1, 0));
+        REPORTER_ASSERT(reporter, 1 == grid.tileCount(0, 1));
+        REPORTER_ASSERT(reporter, 1 == grid.tileCount(1, 1));
+        REPORTER_ASSERT(reporter, reinterpret_cast<void*>(1) == *grid.tile(1, 1));
+    }
+
     static void Test(skiatest::Reporter* reporter) {
         // Out of bounds
         verifyTileHits(reporter, SkIRect::MakeXYWH(30, 0, 1, 1),  0);
@@ -258,6 +423,9 @@ public:
 
         TestUnalignedQuery(reporter);
         TestOverlapOffsetQueryAlignment(reporter);
+        TestChooseTileInterval(reporter);
+        TestAdaptive(reporter);
+        TestRewind(reporter);
     }
 };
 
@@ -7,6 +7,9 @@
  */
 #include "Test.h"
 #include "SkColor.h"
+#include "SkColorPriv.h"
+#include "SkRandom.h"
+#include "SkString.h"
 #include "SkXfermode.h"
 
 static SkPMColor bogusXfermodeProc(SkPMColor src, SkPMColor dst) {
@@ -63,9 +66,103 @@ static void test_IsMode(skiatest::Reporter* reporter) {
     }
 }
 
+static SkPMColor random_pmcolor(SkRandom* rand) {
+    // Favor the extremes, which most modes treat specially.
+    switch (rand->nextU() % 4) {
+        case 0:
+            return 0;
+        case 1:
+            return rand->nextU() | (0xFF << SK_A32_SHIFT);
+        default: {
+            unsigned a = rand->nextU() & 0xFF;
+            return SkPackARGB32(a, rand->nextULessThan(a + 1), rand->nextULessThan(a + 1),
+                                rand->nextULessThan(a + 1));
+        }
+    }
+}
+
+static SkAlpha random_coverage(SkRandom* rand) {
+    switch (rand->nextU() % 4) {
+        case 0:
+            return 0;
+        case 1:
+            return 0xFF;
+        default:
+            return rand->nextU() & 0xFF;
+    }
+}
+
+/*  However a mode's xfer procs are implemented (the platform may blend several
+ *  pixels at once), they must match applying the mode's SkXfermodeProc to one
+ *  pixel at a time.
+ */
+static void test_xfer_procs(skiatest::Reporter* reporter) {
+    static const int kCount = 67;
+    SkRandom rand;
+    SkPMColor src[kCount], dst32[kCount], expected32[kCount];
+    uint16_t dst16[kCount], expected16[kCount];
+    SkAlpha dstA8[kCount], expectedA8[kCount], coverage[kCount];
+
+    // Clear and Src apply coverage their own way, so they are left out.
+    for (int mode = SkXfermode::kDst_Mode; mode <= SkXfermode::kLastMode; mode++) {
+        SkXfermode* xfer = SkXfermode::Create((SkXfermode::Mode)mode);
+        if (NULL == xfer) {
+            continue;
+        }
+        SkXfermodeProc proc = SkXfermode::GetProc((SkXfermode::Mode)mode);
+
+        for (int iter = 0; iter < 20; iter++) {
+            const bool useCoverage = SkToBool(iter & 1);
+            const SkAlpha* aa = useCoverage ? coverage : NULL;
+            for (int i = 0; i < kCount; i++) {
+                src[i] = random_pmcolor(&rand);
+                dst32[i] = random_pmcolor(&rand);
+                dst16[i] = SkToU16(rand.nextU());
+                dstA8[i] = SkToU8(rand.nextU());
+                coverage[i] = random_coverage(&rand);
+
+                unsigned a = useCoverage ? coverage[i] : 0xFF;
+                SkPMColor dstC = SkPixel16ToPixel32(dst16[i]);
+                SkPMColor C = proc(src[i], dstC);
+                expected32[i] = a ? SkFourByteInterp(proc(src[i], dst32[i]), dst32[i], a)
+                                  : dst32[i];
+                expected16[i] = a ? SkPixel32ToPixel16_ToU16(SkFourByteInterp(C, dstC, a))
+                                  : dst16[i];
+                unsigned A = SkGetPackedA32(proc(src[i], dstA8[i] << SK_A32_SHIFT));
+                expectedA8[i] = a ? SkToU8(SkAlphaBlend(A, dstA8[i], SkAlpha255To256(a)))
+                                  : dstA8[i];
+            }
+
+            // Start and stop anywhere, so that every leftover count is exercised.
+            int start = rand.nextULessThan(4);
+            int count = kCount - start - rand.nextULessThan(4);
+            xfer->xfer32(dst32 + start, src + start, count, aa ? aa + start : NULL);
+            xfer->xfer16(dst16 + start, src + start, count, aa ? aa + start : NULL);
+            xfer->xferA8(dstA8 + start, src + start, count, aa ? aa + start : NULL);
+
+            bool match32 = true, match16 = true, matchA8 = true;
+            for (int i = start; i < start + count; i++) {
+                match32 &= expected32[i] == dst32[i];
+                match16 &= expected16[i] == dst16[i];
+                matchA8 &= expectedA8[i] == dstA8[i];
+            }
+            if (!match32 || !match16 || !matchA8) {
+                SkString str;
+                str.printf("%s mode xfer procs don't match its SkXfermodeProc (32:%d 16:%d A8:%d)",
+                           SkXfermode::ModeName((SkXfermode::Mode)mode),
+                           match32, match16, matchA8);
+                reporter->reportFailed(str);
+                break;
+            }
+        }
+        xfer->unref();
+    }
+}
+
 static void test_xfermodes(skiatest::Reporter* reporter) {
     test_asMode(reporter);
     test_IsMode(reporter);
+    test_xfer_procs(reporter);
 }
 
 #include "TestClassDef.h"
@@ -0,0 +1,292 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "PictureProfiler.h"
+#include "SkBBoxRecord.h"
+#include "SkCanvas.h"
+#include "SkDevice.h"
+#include "SkPicture.h"
+#include "SkPicturePlayback.h"
+#include "SkStream.h"
+#include "SkTSearch.h"
+
+#if defined(SK_BUILD_FOR_WIN32)
+    #include "BenchSysTimer_windows.h"
+#elif defined(SK_BUILD_FOR_MAC)
+    #include "BenchSysTimer_mach.h"
+#elif defined(SK_BUILD_FOR_UNIX) || defined(SK_BUILD_FOR_ANDROID)
+    #include "BenchSysTimer_posix.h"
+#else
+    #include "BenchSysTimer_c.h"
+#endif
+
+namespace sk_tools {
+
+#ifdef SK_DEVELOPER
+
+// Times each command between SkPicturePlayback's profiling stubs.
+class PictureProfiler::Playback : public SkPicturePlayback {
+public:
+    Playback(const SkPicturePlayback& src, PictureProfiler* profiler)
+        : INHERITED(src)
+        , fProfiler(profiler) {
+    }
+
+protected:
+    virtual size_t preDraw(size_t offset, int type) SK_OVERRIDE {
+        fProfiler->beginCommand(offset, (DrawType)type);
+        fTimer.startWall();
+        return 0;
+    }
+
+    virtual void postDraw(size_t offset) SK_OVERRIDE {
+        double time = fTimer.endWall();
+        fProfiler->endCommand(time);
+    }
+
+private:
+    PictureProfiler*    fProfiler;
+    BenchSysTimer       fTimer;
+
+    typedef SkPicturePlayback INHERITED;
+};
+
+// A copy of a picture that plays back through a Playback.
+class PictureProfiler::Picture : public SkPicture {
+public:
+    Picture(const SkPicture& src, PictureProfiler* profiler) : INHERITED(src) {
+        if (NULL != fPlayback) {
+            SkPicturePlayback* playback = SkNEW_ARGS(Playback, (*fPlayback, profiler));
+            SkDELETE(fPlayback);
+            fPlayback = playback;
+        }
+    }
+
+private:
+    typedef SkPicture INHERITED;
+};
+
+// Works out the pixels each command covers from the bounds SkBBoxRecord
+// computes for it, in place of drawing it.
+class PictureProfiler::CoverageCanvas : public SkBBoxRecord {
+public:
+    CoverageCanvas(SkDevice* device, PictureProfiler* profiler)
+        : INHERITED(0, device)
+        , fProfiler(profiler) {
+    }
+
+    virtual void handleBBox(const SkRect& bounds) SK_OVERRIDE {
+        SkIRect pixels;
+        bounds.roundOut(&pixels);
+        SkIRect clip;
+        if (this->getClipDeviceBounds(&clip) && pixels.intersect(clip)) {
+            fProfiler->addCoverage((int64_t)pixels.width() * pixels.height());
+        }
+    }
+
+private:
+    PictureProfiler* fProfiler;
+
+    typedef SkBBoxRecord INHERITED;
+};
+
+#endif
+
+PictureProfiler::PictureProfiler() {
+    this->reset();
+}
+
+void PictureProfiler::reset() {
+    fCommands.reset();
+    fCurrent = -1;
+    fTiming = false;
+    fRuns = 0;
+    fTotalTime = 0;
+    fWidth = fHeight = 0;
+}
+
+bool PictureProfiler::profile(SkPicture* picture, SkCanvas* canvas, int repeats) {
+#ifdef SK_DEVELOPER
+    Picture profiled(*picture, this);
+    fWidth = picture->width();
+    fHeight = picture->height();
+
+    fTiming = true;
+    for (int i = 0; i < repeats; ++i) {
+        int saveCount = canvas->save();
+        profiled.draw(canvas);
+        canvas->restoreToCount(saveCount);
+        fRuns += 1;
+    }
+
+    // Measure coverage after timing, so that commands a bounding box
+    // hierarchy culls from canvas are not added.
+    fTiming = false;
+    for (int i = 0; i < fCommands.count(); ++i) {
+        fCommands[i].fPixels = 0;
+    }
+    SkBitmap bitmap;
+    bitmap.setConfig(SkBitmap::kNo_Config, fWidth, fHeight);
+    SkAutoTUnref<SkDevice> device(SkNEW_ARGS(SkDevice, (bitmap)));
+    SkAutoTUnref<CoverageCanvas> coverage(SkNEW_ARGS(CoverageCanvas, (device, this)));
+    coverage->beginRecording();
+    profiled.draw(coverage);
+    coverage->endRecording();
+    fCurrent = -1;
+    return true;
+#else
+    return false;
+#endif
+}
+
+static int compare_offsets(const PictureProfiler::Command* a, const PictureProfiler::Command* b) {
+    return a->fOffset < b->fOffset ? -1 : (a->fOffset > b->fOffset ? 1 : 0);
+}
+
+void PictureProfiler::beginCommand(size_t offset, DrawType type) {
+    // Playback goes through the commands in order, so look past the last
+    // one first.
+    int index = fCurrent + 1;
+    if (index >= fCommands.count() || fCommands[index].fOffset != offset) {
+        Command key;
+        key.fOffset = offset;
+        index = SkTSearch<Command>(fCommands.begin(), fCommands.count(), key, sizeof(Command),
+                                   compare_offsets);
+    }
+    if (index < 0) {
+        if (!fTiming) {
+            // Only measure commands that have been timed.
+            fCurrent = -1;
+            return;
+        }
+        index = ~index;
+        Command* command = fCommands.insert(index);
+        command->fOffset = offset;
+        command->fType = type;
+        command->fCalls = 0;
+        command->fTime = 0;
+        command->fPixels = 0;
+    }
+    fCurrent = index;
+}
+
+void PictureProfiler::endCommand(double time) {
+    if (!fTiming || fCurrent < 0) {
+        return;
+    }
+    fCommands[fCurrent].fCalls += 1;
+    fCommands[fCurrent].fTime += time;
+    fTotalTime += time;
+}
+
+void PictureProfiler::addCoverage(int64_t pixels) {
+    if (fCurrent >= 0) {
+        fCommands[fCurrent].fPixels += pixels;
+    }
+}
+
+static int32_t clamp_pixels(int64_t pixels) {
+    return pixels > SK_MaxS32 ? SK_MaxS32 : (int32_t)pixels;
+}
+
+static SkJSON::Object* create_entry(const PictureProfiler::Command& command, int runs) {
+    SkJSON::Object* entry = SkNEW(SkJSON::Object);
+    entry->addString("type", PictureProfiler::TypeName(command.fType));
+    entry->addInt("calls", command.fCalls);
+    entry->addFloat("time", (float)(command.fTime / runs));
+    entry->addInt("pixels", clamp_pixels(command.fPixels));
+    return entry;
+}
+
+SkJSON::Object* PictureProfiler::createReport() const {
+    const int runs = SkMax32(fRuns, 1);
+    SkJSON::Object* report = SkNEW(SkJSON::Object);
+    report->addInt("width", fWidth);
+    report->addInt("height", fHeight);
+    report->addInt("runs", fRuns);
+    report->addFloat("time", (float)(fTotalTime / runs));
+
+    SkJSON::Array* commands = SkNEW_ARGS(SkJSON::Array, (SkJSON::kObject, fCommands.count()));
+    Command types[LAST_DRAWTYPE_ENUM + 1];
+    sk_bzero(types, sizeof(types));
+    for (int i = 0; i < fCommands.count(); ++i) {
+        const Command& command = fCommands[i];
+        SkJSON::Object* entry = create_entry(command, runs);
+        entry->addInt("index", i);
+        entry->addInt("offset", (int32_t)command.fOffset);
+        commands->setObject(i, entry);
+
+        Command& type = types[command.fType];
+        type.fType = command.fType;
+        type.fCalls += command.fCalls;
+        type.fTime += command.fTime;
+        type.fPixels += command.fPixels;
+    }
+    report->addArray("commands", commands);
+
+    int typeCount = 0;
+    for (int i = 0; i <= LAST_DRAWTYPE_ENUM; ++i) {
+        typeCount += types[i].fCalls > 0;
+    }
+    SkJSON::Array* typeTotals = SkNEW_ARGS(SkJSON::Array, (SkJSON::kObject, typeCount));
+    for (int i = 0, index = 0; i <= LAST_DRAWTYPE_ENUM; ++i) {
+        if (types[i].fCalls > 0) {
+            typeTotals->setObject(index++, create_entry(types[i], runs));
+        }
+    }
+    report->addArray("types", typeTotals);
+    return report;
+}
+
+void PictureProfiler::writeReport(SkWStream* stream) const {
+    SkAutoTDelete<SkJSON::Object> report(this->createReport());
+    report->toStream(stream);
+}
+
+const char* PictureProfiler::TypeName(DrawType type) {
+    switch (type) {
+        case CLIP_PATH: return "CLIP_PATH";
+        case CLIP_REGION: return "CLIP_REGION";
+        case CLIP_RECT: return "CLIP_RECT";
+        case CLIP_RRECT: return "CLIP_RRECT";
+        case CONCAT: return "CONCAT";
+        case DRAW_BITMAP: return "DRAW_BITMAP";
+        case DRAW_BITMAP_MATRIX: return "DRAW_BITMAP_MATRIX";
+        case DRAW_BITMAP_NINE: return "DRAW_BITMAP_NINE";
+        case DRAW_BITMAP_RECT_TO_RECT: return "DRAW_BITMAP_RECT_TO_RECT";
+        case DRAW_CLEAR: return "DRAW_CLEAR";
+        case DRAW_DATA: return "DRAW_DATA";
+        case DRAW_OVAL: return "DRAW_OVAL";
+        case DRAW_PAINT: return "DRAW_PAINT";
+        case DRAW_PATH: return "DRAW_PATH";
+        case DRAW_PICTURE: return "DRAW_PICTURE";
+        case DRAW_POINTS: return "DRAW_POINTS";
+        case DRAW_POS_TEXT: return "DRAW_POS_TEXT";
+        case DRAW_POS_TEXT_TOP_BOTTOM: return "DRAW_POS_TEXT_TOP_BOTTOM";
+        case DRAW_POS_TEXT_H: return "DRAW_POS_TEXT_H";
+        case DRAW_POS_TEXT_H_TOP_BOTTOM: return "DRAW_POS_TEXT_H_TOP_BOTTOM";
+        case DRAW_RECT: return "DRAW_RECT";
+        case DRAW_RRECT: return "DRAW_RRECT";
+        case DRAW_SPRITE: return "DRAW_SPRITE";
+        case DRAW_TEXT: return "DRAW_TEXT";
+        case DRAW_TEXT_ON_PATH: return "DRAW_TEXT_ON_PATH";
+        case DRAW_TEXT_TOP_BOTTOM: return "DRAW_TEXT_TOP_BOTTOM";
+        case DRAW_VERTICES: return "DRAW_VERTICES";
+        case RESTORE: return "RESTORE";
+        case ROTATE: return "ROTATE";
+        case SAVE: return "SAVE";
+        case SAVE_LAYER: return "SAVE_LAYER";
+        case SCALE: return "SCALE";
+        case SET_MATRIX: return "SET_MATRIX";
+        case SKEW: return "SKEW";
+        case TRANSLATE: return "TRANSLATE";
+        case NOOP: return "NOOP";
+        default: return "UNKNOWN";
+    }
+}
+
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2013 Google Inc.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef PictureProfiler_DEFINED
+#define PictureProfiler_DEFINED
+
+#include "SkJSON.h"
+#include "SkPictureFlat.h"
+#include "SkTDArray.h"
+
+class SkCanvas;
+class SkPicture;
+class SkWStream;
+
+namespace sk_tools {
+
+/**
+ * Profiles the playback of an SkPicture command by command, to find which
+ * commands make a slow picture slow. Each command is timed as it is drawn,
+ * and the pixels it covers are estimated from its device bounds, clipped,
+ * when the whole picture is drawn at its own size.
+ *
+ * This needs a build with SK_DEVELOPER defined, where SkPicturePlayback calls
+ * back before and after each command; profile() fails in other builds.
+ */
+class PictureProfiler {
+public:
+    struct Command {
+        size_t      fOffset;    // of the command in the picture's op stream
+        DrawType    fType;
+        int         fCalls;     // times the command was drawn
+        double      fTime;      // total wall time drawing it, in milliseconds
+        int64_t     fPixels;    // pixels it covers
+    };
+
+    PictureProfiler();
+
+    /**
+     * Draws picture into canvas repeats times, adding the time each command
+     * takes to what has been profiled. Commands a bounding box hierarchy
+     * culls are not drawn, so are not counted. Returns false if this build
+     * can't profile.
+     */
+    bool profile(SkPicture* picture, SkCanvas* canvas, int repeats = 1);
+
+    /** Forgets everything profiled so far, to profile another picture. */
+    void reset();
+
+    /** Returns the commands drawn so far, in the order they are in the picture. */
+    const SkTDArray<Command>& commands() const { return fCommands; }
+
+    /** Returns the number of times the picture has been drawn. */
+    int runs() const { return fRuns; }
+
+    /** Returns the total wall time spent in the picture's commands, in milliseconds. */
+    double totalTime() const { return fTotalTime; }
+
+    /**
+     * Returns a new JSON report of what has been profiled, for the caller to
+     * delete. It holds the picture's size, the number of runs and the
+     * average time per run, a "commands" array with the index, offset, type,
+     * calls, average time per run and pixels of each command, and a "types"
+     * array with the same totals for each type of command drawn.
+     */
+    SkJSON::Object* createReport() const;
+
+    /** Writes the report createReport() returns to stream as JSON text. */
+    void writeReport(SkWStream* stream) const;
+
+    /** Returns the name of a picture command type, e.g. "DRAW_RECT". */
+    static const char* TypeName(DrawType type);
+
+private:
+    class CoverageCanvas;
+    class Playback;
+    class Picture;
+
+    void beginCommand(size_t offset, DrawType type);
+    void endCommand(double time);
+    void addCoverage(int64_t pixels);
+
+    SkTDArray<Command>  fCommands;
+    int                 fCurrent;   // index of the command being drawn, or -1
+    bool                fTiming;    // whether commands are being timed, or measured
+    int                 fRuns;
+    double              fTotalTime;
+    int                 fWidth;
+    int                 fHeight;
+};
+
+}
+
+#endif  // PictureProfiler_DEFINED
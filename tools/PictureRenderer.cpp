@@ -27,6 +27,7 @@
 #include "SkTemplates.h"
 #include "SkTileGridPicture.h"
 #include "SkTDArray.h"
+#include "SkThread.h"
 #include "SkThreadUtils.h"
 #include "SkTypes.h"
 #include "SkData.h"
@@ -593,17 +594,14 @@ SkString TiledPictureRenderer::getConfigNameInternal() {
 class CloneData : public SkRunnable {
 
 public:
-    CloneData(SkPicture* clone, SkCanvas* canvas, SkTDArray<SkRect>& rects, int start, int end,
-              SkRunnable* done)
+    CloneData(SkPicture* clone, SkCanvas* canvas, SkTDArray<SkRect>& rects, int32_t* nextTile)
         : fClone(clone)
         , fCanvas(canvas)
         , fPath(NULL)
         , fRects(rects)
-        , fStart(start)
-        , fEnd(end)
-        , fSuccess(NULL)
-        , fDone(done) {
-        SkASSERT(fDone != NULL);
+        , fNextTile(nextTile)
+        , fSuccess(NULL) {
+        SkASSERT(fNextTile != NULL);
     }
 
     virtual void run() SK_OVERRIDE {
@@ -615,7 +613,10 @@ public:
             setup_bitmap(&bitmap, SkScalarFloorToInt(fRects[0].width()), SkScalarFloorToInt(fRects[0].height()));
         }
 
-        for (int i = fStart; i < fEnd; i++) {
+        // Claim tiles one at a time rather than drawing a fixed range, so that threads which
+        // happen to get cheap tiles keep helping until every tile is drawn.
+        int i;
+        while ((i = sk_atomic_inc(fNextTile)) < fRects.count()) {
             DrawTileToCanvas(fCanvas, fRects[i], fClone);
             if (fPath != NULL && !writeAppendNumber(fCanvas, fPath, i)
                 && fSuccess != NULL) {
@@ -635,7 +636,6 @@ public:
                 }
             }
         }
-        fDone->run();
     }
 
     void setPathAndSuccess(const SkString* path, bool* success) {
@@ -654,18 +654,16 @@ private:
     SkCanvas*          fCanvas;     // Canvas to draw to. Reused for each tile.
     const SkString*    fPath;       // If non-null, path to write the result to as a PNG.
     SkTDArray<SkRect>& fRects;      // All tiles of the picture.
-    const int          fStart;      // Range of tiles drawn by this thread.
-    const int          fEnd;
+    int32_t*           fNextTile;   // Index of the next tile to draw. Shared by all threads.
     bool*              fSuccess;    // Only meaningful if path is non-null. Shared by all threads,
                                     // and only set to false upon failure to write to a PNG.
-    SkRunnable*        fDone;
     SkBitmap*          fBitmap;
 };
 
 MultiCorePictureRenderer::MultiCorePictureRenderer(int threadCount)
 : fNumThreads(threadCount)
 , fThreadPool(threadCount)
-, fCountdown(threadCount) {
+, fNextTile(0) {
     // Only need to create fNumThreads - 1 clones, since one thread will use the base
     // picture.
     fPictureClones = SkNEW_ARRAY(SkPicture, fNumThreads - 1);
@@ -680,10 +678,8 @@ void MultiCorePictureRenderer::init(SkPicture *pict) {
     }
     // Only need to create fNumThreads - 1 clones, since one thread will use the base picture.
     fPicture->clone(fPictureClones, fNumThreads - 1);
-    // Populate each thread with the appropriate data.
-    // Group the tiles into nearly equal size chunks, rounding up so we're sure to cover them all.
-    const int chunkSize = (fTileRects.count() + fNumThreads - 1) / fNumThreads;
-
+    // Populate each thread with the appropriate data. The tiles themselves are handed out
+    // dynamically, as each thread finishes its previous one.
     for (int i = 0; i < fNumThreads; i++) {
         SkPicture* pic;
         if (i == fNumThreads-1) {
@@ -692,17 +688,14 @@ void MultiCorePictureRenderer::init(SkPicture *pict) {
         } else {
             pic = &fPictureClones[i];
         }
-        const int start = i * chunkSize;
-        const int end = SkMin32(start + chunkSize, fTileRects.count());
-        fCloneData[i] = SkNEW_ARGS(CloneData,
-                                   (pic, fCanvasPool[i], fTileRects, start, end, &fCountdown));
+        fCloneData[i] = SkNEW_ARGS(CloneData, (pic, fCanvasPool[i], fTileRects, &fNextTile));
     }
 }
 
 bool MultiCorePictureRenderer::render(const SkString *path, SkBitmap** out) {
     bool success = true;
     if (path != NULL) {
-        for (int i = 0; i < fNumThreads-1; i++) {
+        for (int i = 0; i < fNumThreads; i++) {
             fCloneData[i]->setPathAndSuccess(path, &success);
         }
     }
@@ -719,11 +712,12 @@ bool MultiCorePictureRenderer::render(const SkString *path, SkBitmap** out) {
         }
     }
 
-    fCountdown.reset(fNumThreads);
+    fNextTile = 0;
+    SkTaskGroup group(&fThreadPool);
     for (int i = 0; i < fNumThreads; i++) {
-        fThreadPool.add(fCloneData[i]);
+        group.add(fCloneData[i]);
     }
-    fCountdown.wait();
+    group.wait();
 
     return success;
 }
@@ -795,6 +789,9 @@ SkPicture* PictureRenderer::createPicture() {
         case kTileGrid_BBoxHierarchyType:
             return SkNEW_ARGS(SkTileGridPicture, (fPicture->width(),
                 fPicture->height(), fGridInfo));
+        case kAdaptiveGrid_BBoxHierarchyType:
+            return SkNEW_ARGS(SkTileGridPicture, (fPicture->width(),
+                fPicture->height()));
     }
     SkASSERT(0); // invalid bbhType
     return NULL;
@@ -9,7 +9,6 @@
 #define PictureRenderer_DEFINED
 
 #include "SkCanvas.h"
-#include "SkCountdown.h"
 #include "SkDrawFilter.h"
 #include "SkMath.h"
 #include "SkPaint.h"
@@ -54,6 +53,7 @@ public:
         kNone_BBoxHierarchyType = 0,
         kRTree_BBoxHierarchyType,
         kTileGrid_BBoxHierarchyType,
+        kAdaptiveGrid_BBoxHierarchyType,
     };
 
     // this uses SkPaint::Flags as a base and adds additional flags
@@ -197,6 +197,8 @@ public:
             config.append("_rtree");
         } else if (kTileGrid_BBoxHierarchyType == fBBoxHierarchyType) {
             config.append("_grid");
+        } else if (kAdaptiveGrid_BBoxHierarchyType == fBBoxHierarchyType) {
+            config.append("_adaptive");
         }
 #if SK_SUPPORT_GPU
         switch (fDeviceType) {
@@ -508,7 +510,7 @@ private:
     SkThreadPool         fThreadPool;
     SkPicture*           fPictureClones;
     CloneData**          fCloneData;
-    SkCountdown          fCountdown;
+    int32_t              fNextTile;
 
     typedef TiledPictureRenderer INHERITED;
 };
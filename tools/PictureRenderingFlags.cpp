@@ -22,11 +22,12 @@
 
 // Alphabetized list of flags used by this file or bench_ and render_pictures.
 DEFINE_string(bbh, "none", "bbhType [width height]: Set the bounding box hierarchy type to "
-              "be used. Accepted values are: none, rtree, grid. "
+              "be used. Accepted values are: none, rtree, grid, adaptive. "
               "Not compatible with --pipe. With value "
               "'grid', width and height must be specified. 'grid' can "
               "only be used with modes tile, record, and "
-              "playbackCreation.");
+              "playbackCreation. 'adaptive' picks the grid's tile size from "
+              "the picture, or uses an rtree if no size suits it.");
 // Although this config does not support all the same options as gm, the names should be kept
 // consistent.
 #if SK_ANGLE
@@ -304,6 +305,8 @@ sk_tools::PictureRenderer* parseRenderer(SkString& error, PictureTool tool) {
             int gridHeight = atoi(FLAGS_bbh[2]);
             renderer->setGridSize(gridWidth, gridHeight);
 
+        } else if (0 == strcmp(type, "adaptive")) {
+            bbhType = sk_tools::PictureRenderer::kAdaptiveGrid_BBoxHierarchyType;
         } else {
             error.printf("%s is not a valid value for --bbhType\n", type);
             return NULL;
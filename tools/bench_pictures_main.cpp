@@ -8,6 +8,7 @@
 #include "BenchTimer.h"
 #include "CopyTilesRenderer.h"
 #include "PictureBenchmark.h"
+#include "PictureProfiler.h"
 #include "PictureRenderingFlags.h"
 #include "SkBenchLogger.h"
 #include "SkCommandLineFlags.h"
@@ -40,6 +41,8 @@ DEFINE_string(logFile, "", "Destination for writing log output, in addition to s
 DEFINE_bool(logPerIter, false, "Log each repeat timer instead of mean.");
 DEFINE_bool(min, false, "Print the minimum times (instead of average).");
 DECLARE_int32(multi);
+DEFINE_string(profile, "", "Directory to write a JSON profile of each picture's commands to, as "
+              "<name>.json, after benchmarking it. Needs a build with SK_DEVELOPER.");
 DECLARE_string(readPath);
 DEFINE_int32(repeat, 1, "Set the number of times to repeat each test.");
 DEFINE_bool(timeIndividualTiles, false, "Report times for drawing individual tiles, rather than "
@@ -152,6 +155,33 @@ static int32_t gTotalCacheHits;
 static int32_t gTotalCacheMisses;
 #endif
 
+// Profiles each command of picture drawn whole, and writes the report to
+// <FLAGS_profile>/<name>.json.
+static bool profile_picture(SkPicture* picture, const SkString& name) {
+    SkBitmap bitmap;
+    sk_tools::setup_bitmap(&bitmap, picture->width(), picture->height());
+    SkCanvas canvas(bitmap);
+    sk_tools::PictureProfiler profiler;
+    if (!profiler.profile(picture, &canvas, FLAGS_repeat)) {
+        gLogger.logError("--profile needs a build with SK_DEVELOPER\n");
+        return false;
+    }
+
+    SkString path;
+    SkString jsonName(name);
+    jsonName.append(".json");
+    sk_tools::make_filepath(&path, SkString(FLAGS_profile[0]), jsonName);
+    SkFILEWStream stream(path.c_str());
+    if (!stream.isValid()) {
+        SkString err;
+        err.printf("Could not open %s for writing\n", path.c_str());
+        gLogger.logError(err);
+        return false;
+    }
+    profiler.writeReport(&stream);
+    return true;
+}
+
 static bool run_single_benchmark(const SkString& inputPath,
                                  sk_tools::PictureBenchmark& benchmark) {
     SkFILEStream inputStream;
@@ -197,6 +227,10 @@ static bool run_single_benchmark(const SkString& inputPath,
 
     benchmark.run(picture);
 
+    if (FLAGS_profile.count() == 1 && !profile_picture(picture, filename)) {
+        return false;
+    }
+
 #if LAZY_CACHE_STATS
     if (FLAGS_trackDeferredCaching) {
         int32_t cacheHits = SkLazyPixelRef::GetCacheHits();